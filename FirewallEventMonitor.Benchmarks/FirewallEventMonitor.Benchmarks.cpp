@@ -0,0 +1,148 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+// os headers
+#include <windows.h>
+// c++ headers
+#include <string>
+// ntl headers
+#include "ntlString.hpp"
+
+#include "HotPathBenchmark.h"
+
+using namespace FirewallEventMonitor;
+
+// Relative to this program, where the build puts it: FirewallEventMonitor.Benchmarks\output\<configuration>\<platform>.
+const wchar_t DEFAULT_ETL_FILE[] = L"..\\..\\..\\..\\FirewallEventMonitor.UnitTests\\TestTraceSession.etl";
+const unsigned long DEFAULT_SYNTHETIC_EVENTS = 65536;
+const unsigned long long DEFAULT_EVENTS_PER_REPETITION = 200000;
+const unsigned long DEFAULT_REPETITIONS = 7;
+
+// Names the build in the results, so results from many builds can be told apart in one file.
+std::wstring GetDefaultLabel()
+{
+    std::wstring label;
+#ifdef _DEBUG
+    label = L"Debug";
+#else
+    label = L"Release";
+#endif
+#ifdef _WIN64
+    label += L" x64";
+#else
+    label += L" Win32";
+#endif
+    return label;
+}
+
+// The unit tests' saved capture, wherever the program is started from.
+std::wstring GetDefaultEtlFile()
+{
+    WCHAR modulePath[MAX_PATH] = {};
+    DWORD length = ::GetModuleFileNameW(nullptr, modulePath, ARRAYSIZE(modulePath));
+    if (length == 0 || length == ARRAYSIZE(modulePath))
+    {
+        return DEFAULT_ETL_FILE;
+    }
+
+    std::wstring path(modulePath, length);
+    path.resize(path.find_last_of(L'\\') + 1);
+    path.append(DEFAULT_ETL_FILE);
+
+    WCHAR fullPath[MAX_PATH] = {};
+    length = ::GetFullPathNameW(path.c_str(), ARRAYSIZE(fullPath), fullPath, nullptr);
+    return (length == 0 || length >= ARRAYSIZE(fullPath)) ? path : std::wstring(fullPath, length);
+}
+
+void PrintUsage()
+{
+    fwprintf(stderr,
+        L"Times each stage of the event path and writes the results as CSV to the console.\n"
+        L"\n"
+        L"FirewallEventMonitor.Benchmarks.exe [-Etl <file>] [-SyntheticEvents <count>] [-Events <count>] [-Repetitions <count>] [-Label <name>]\n"
+        L"\n"
+        L"-Etl <file>                 Saved capture whose rule match events are one corpus (default %ls).\n"
+        L"                            None skips the stages that need ETW records.\n"
+        L"-SyntheticEvents <count>    Events made up for the other corpus (default %lu). 0 skips it.\n"
+        L"-Events <count>             Events each stage runs through per repetition (default %llu).\n"
+        L"-Repetitions <count>        Timed repetitions per stage; the median is reported (default %lu).\n"
+        L"-Label <name>               First column of every line (default the build, as in \"%ls\").\n",
+        GetDefaultEtlFile().c_str(),
+        DEFAULT_SYNTHETIC_EVENTS,
+        DEFAULT_EVENTS_PER_REPETITION,
+        DEFAULT_REPETITIONS,
+        GetDefaultLabel().c_str());
+}
+
+INT __cdecl wmain(
+    INT argc,
+    __in_ecount(argc) const wchar_t** argv
+) try
+{
+    std::wstring etlFile = GetDefaultEtlFile();
+    unsigned long syntheticEvents = DEFAULT_SYNTHETIC_EVENTS;
+    unsigned long long eventsPerRepetition = DEFAULT_EVENTS_PER_REPETITION;
+    unsigned long repetitions = DEFAULT_REPETITIONS;
+    std::wstring label = GetDefaultLabel();
+
+    for (INT i = 1; i < argc; ++i)
+    {
+        std::wstring option = argv[i];
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return ERROR_INVALID_DATA;
+        }
+
+        std::wstring value = argv[++i];
+        if (ntl::String::iordinal_equals(option, L"-Etl"))
+        {
+            etlFile = ntl::String::iordinal_equals(value, L"None") ? L"" : value;
+        }
+        else if (ntl::String::iordinal_equals(option, L"-SyntheticEvents"))
+        {
+            syntheticEvents = std::stoul(value);
+        }
+        else if (ntl::String::iordinal_equals(option, L"-Events"))
+        {
+            eventsPerRepetition = std::stoull(value);
+        }
+        else if (ntl::String::iordinal_equals(option, L"-Repetitions"))
+        {
+            repetitions = std::stoul(value);
+        }
+        else if (ntl::String::iordinal_equals(option, L"-Label"))
+        {
+            // A comma or quote would need the field quoted.
+            if (value.find_first_of(L",\"") != std::wstring::npos)
+            {
+                fwprintf(stderr, L"Error: -Label cannot contain commas or quotes.\n");
+                return ERROR_INVALID_DATA;
+            }
+            label = value;
+        }
+        else
+        {
+            PrintUsage();
+            return ERROR_INVALID_DATA;
+        }
+    }
+
+    HotPathBenchmark benchmark(eventsPerRepetition, repetitions);
+    if (!etlFile.empty())
+    {
+        benchmark.LoadEtlCorpus(etlFile);
+    }
+    if (syntheticEvents > 0)
+    {
+        benchmark.LoadSyntheticCorpus(syntheticEvents);
+    }
+
+    HotPathBenchmark::WriteCsv(label, benchmark.Run());
+    return ERROR_SUCCESS;
+}
+catch (const std::exception &ex)
+{
+    fwprintf(stderr, L"Error: %S.\n", ex.what());
+    return ERROR_GEN_FAILURE;
+}
\ No newline at end of file
@@ -0,0 +1,412 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "HotPathBenchmark.h"
+#include "AllocationCounter.h"
+#include "BinaryEventFormat.h"
+#include "EventFormatter.h"
+#include "EventPredicate.h"
+#include "LatencyMonitor.h"
+#include "SyntheticEventGenerator.h"
+
+// c++ headers
+#include <algorithm>
+#include <climits>
+#include <set>
+// ntl headers
+#include "ntlEtwReader.hpp"
+
+namespace FirewallEventMonitor
+{
+    // 2017-09-14 22:42:28 UTC, when the test capture was taken; synthetic events follow 100us apart.
+    const LONGLONG SYNTHETIC_START_TIME_STAMP = 131499025480000000;
+    const LONGLONG SYNTHETIC_TIME_STAMP_STEP = 1000;
+    const unsigned long SYNTHETIC_SEED = 1;
+
+    HotPathBenchmark::HotPathBenchmark(
+        unsigned long long eventsPerRepetition,
+        unsigned long repetitions)
+        : m_EventsPerRepetition(eventsPerRepetition),
+        m_Repetitions(repetitions),
+        m_Sink(0)
+    {
+        if (m_EventsPerRepetition == 0 || m_Repetitions == 0)
+        {
+            throw std::exception("HotPathBenchmark needs at least one event and one repetition");
+        }
+    }
+
+    template <typename Stage>
+    StageBenchmarkResult HotPathBenchmark::MeasureStage(
+        const std::wstring& stageName,
+        const std::wstring& corpusName,
+        size_t corpusEvents,
+        Stage stage)
+    {
+        // Cycles through the corpus without dividing for every event.
+        auto runRepetition = [&]()
+        {
+            size_t index = 0;
+            for (unsigned long long i = 0; i < m_EventsPerRepetition; ++i)
+            {
+                stage(index);
+                if (++index == corpusEvents)
+                {
+                    index = 0;
+                }
+            }
+        };
+
+        // Grows every reused buffer to its size before the allocations are counted.
+        runRepetition();
+
+        std::vector<double> nanosecondsPerEvent;
+        nanosecondsPerEvent.reserve(m_Repetitions);
+        double nanosecondsPerTick = GetNanosecondsPerTick();
+
+        unsigned long long allocations = AllocationCounter::GetAllocationCount();
+        unsigned long long bytesAllocated = AllocationCounter::GetAllocatedBytes();
+        for (unsigned long repetition = 0; repetition < m_Repetitions; ++repetition)
+        {
+            LONGLONG start = LatencyMonitor::Now();
+            runRepetition();
+            LONGLONG elapsed = LatencyMonitor::Now() - start;
+            nanosecondsPerEvent.push_back(static_cast<double>(elapsed) * nanosecondsPerTick / static_cast<double>(m_EventsPerRepetition));
+        }
+
+        return Summarize(
+            stageName,
+            corpusName,
+            corpusEvents,
+            m_EventsPerRepetition,
+            nanosecondsPerEvent,
+            AllocationCounter::GetAllocationCount() - allocations,
+            AllocationCounter::GetAllocatedBytes() - bytesAllocated);
+    }
+
+    bool HotPathBenchmark::CorpusReader::operator()(
+        const PEVENT_RECORD pEventRecord)
+    {
+        if (!FirewallEtwTraceCallback::IsRuleMatchEvent(pEventRecord->EventHeader.EventDescriptor.Id))
+        {
+            return false;
+        }
+
+        if (totals == nullptr)
+        {
+            benchmark->m_EtlRecords.emplace_back(pEventRecord);
+            const ntl::EtwRecord& record = benchmark->m_EtlRecords.back();
+
+            RawEnumValues values;
+            record.queryEventProperty(L"Direction", values.direction);
+            record.queryEventProperty(L"RuleType", values.ruleType);
+            record.queryEventProperty(L"IpProtocol", values.protocol);
+            record.queryEventProperty(L"IcmpType", values.icmpType);
+            benchmark->m_EtlEnumValues.push_back(values);
+            benchmark->m_DecodeRecord.assign(pEventRecord);
+            return false;
+        }
+
+        // Timed here, as TDH decodes the event, since the schema is only sure to be found while
+        // the capture is open. Includes reading the performance counter twice.
+        unsigned long long allocations = AllocationCounter::GetAllocationCount();
+        unsigned long long bytesAllocated = AllocationCounter::GetAllocatedBytes();
+        LONGLONG start = LatencyMonitor::Now();
+        benchmark->m_DecodeRecord.assign(pEventRecord);
+        benchmark->m_Sink += benchmark->m_DecodeRecord.getEventId();
+        totals->ticks += LatencyMonitor::Now() - start;
+        totals->allocations += AllocationCounter::GetAllocationCount() - allocations;
+        totals->bytesAllocated += AllocationCounter::GetAllocatedBytes() - bytesAllocated;
+        ++totals->events;
+
+        // The reader never keeps the events itself.
+        return false;
+    }
+
+    void HotPathBenchmark::LoadEtlCorpus(
+        const std::wstring& filePath)
+    {
+        m_EtlName = filePath.substr(filePath.find_last_of(L"\\/") + 1);
+        m_EtlRecords.clear();
+        m_EtlEnumValues.clear();
+
+        {
+            CorpusReader corpusReader = { this, nullptr };
+            ntl::EtwReader<CorpusReader> reader(corpusReader);
+            reader.OpenSavedSession(filePath.c_str());
+            reader.WaitForSession();
+        }
+
+        if (m_EtlRecords.empty())
+        {
+            throw std::exception("The capture has no rule match events");
+        }
+
+        std::vector<double> nanosecondsPerEvent;
+        DecodeTotals allTotals;
+        double nanosecondsPerTick = GetNanosecondsPerTick();
+        for (unsigned long repetition = 0; repetition < m_Repetitions; ++repetition)
+        {
+            DecodeTotals totals;
+            CorpusReader corpusReader = { this, &totals };
+            ntl::EtwReader<CorpusReader> reader(corpusReader);
+            reader.OpenSavedSession(filePath.c_str());
+            reader.WaitForSession();
+
+            nanosecondsPerEvent.push_back(static_cast<double>(totals.ticks) * nanosecondsPerTick / static_cast<double>(totals.events));
+            allTotals.allocations += totals.allocations;
+            allTotals.bytesAllocated += totals.bytesAllocated;
+        }
+        m_DecodeResults.push_back(Summarize(
+            L"Decode",
+            m_EtlName,
+            m_EtlRecords.size(),
+            m_EtlRecords.size(),
+            nanosecondsPerEvent,
+            allTotals.allocations,
+            allTotals.bytesAllocated));
+
+        std::vector<VfpEventData> events;
+        events.reserve(m_EtlRecords.size());
+        for (const auto& record : m_EtlRecords)
+        {
+            events.push_back(FirewallEtwTraceCallback::CollectEventData(record));
+        }
+        AddCorpus(m_EtlName, events);
+    }
+
+    void HotPathBenchmark::LoadSyntheticCorpus(
+        unsigned long count)
+    {
+        SyntheticTrafficProfile profile;
+        profile.seed = SYNTHETIC_SEED;
+        SyntheticEventGenerator generator(profile);
+
+        std::vector<VfpEventData> events(count);
+        for (unsigned long i = 0; i < count; ++i)
+        {
+            generator.Generate(SYNTHETIC_START_TIME_STAMP + i * SYNTHETIC_TIME_STAMP_STEP, events[i]);
+        }
+        AddCorpus(L"synthetic", events);
+    }
+
+    void HotPathBenchmark::AddCorpus(
+        const std::wstring& name,
+        _Inout_ std::vector<VfpEventData>& events)
+    {
+        Corpus corpus;
+        corpus.name = name;
+        corpus.events.swap(events);
+        corpus.utf8Events.resize(corpus.events.size());
+        for (size_t i = 0; i < corpus.events.size(); ++i)
+        {
+            EventFormatter::ConvertToUtf8(corpus.events[i], corpus.utf8Events[i]);
+        }
+        m_Corpora.push_back(std::move(corpus));
+    }
+
+    std::vector<StageBenchmarkResult> HotPathBenchmark::Run()
+    {
+        std::vector<StageBenchmarkResult> results(m_DecodeResults);
+
+        if (!m_EtlRecords.empty())
+        {
+            RunRecordStages(results);
+        }
+
+        for (const auto& corpus : m_Corpora)
+        {
+            RunEventStages(corpus, results);
+        }
+
+        // The same for every event, so run once without a corpus.
+        EventCounter eventCounter(ULONG_MAX);
+        results.push_back(MeasureStage(L"IncrementEventCount", L"none", 1, [&](size_t)
+        {
+            eventCounter.IncrementEventCount();
+        }));
+
+        return results;
+    }
+
+    void HotPathBenchmark::RunRecordStages(
+        _Inout_ std::vector<StageBenchmarkResult>& results)
+    {
+        VfpEventData eventData;
+        results.push_back(MeasureStage(L"CollectEventData", m_EtlName, m_EtlRecords.size(), [&](size_t i)
+        {
+            FirewallEtwTraceCallback::CollectEventData(m_EtlRecords[i], eventData);
+            m_Sink += eventData.source.size();
+        }));
+
+        results.push_back(MeasureStage(L"Translate", m_EtlName, m_EtlEnumValues.size(), [&](size_t i)
+        {
+            const RawEnumValues& values = m_EtlEnumValues[i];
+            FirewallEtwTraceCallback::TranslateDirection(values.direction, eventData.direction);
+            FirewallEtwTraceCallback::TranslateRuleType(values.ruleType, eventData.ruleType);
+            FirewallEtwTraceCallback::TranslateProtocol(values.protocol, eventData.protocol);
+            FirewallEtwTraceCallback::TranslateIcmpType(values.icmpType, eventData.icmpType);
+            m_Sink += eventData.protocol.size();
+        }));
+    }
+
+    void HotPathBenchmark::RunEventStages(
+        const Corpus& corpus,
+        _Inout_ std::vector<StageBenchmarkResult>& results)
+    {
+        const auto& events = corpus.events;
+        const auto& utf8Events = corpus.utf8Events;
+
+        {
+            // The callback's MatchFilters is its EventPredicate, built from the same parameters.
+            EventPredicate predicate(GetFilterParameters(corpus), 0);
+            results.push_back(MeasureStage(L"MatchFilters", corpus.name, events.size(), [&](size_t i)
+            {
+                m_Sink += predicate.Matches(events[i]) ? 1 : 0;
+            }));
+        }
+
+        std::wstring date;
+        std::wstring time;
+        results.push_back(MeasureStage(L"GetDateAndTime", corpus.name, events.size(), [&](size_t i)
+        {
+            LARGE_INTEGER timeStamp;
+            timeStamp.QuadPart = events[i].timeStamp;
+            Timer::GetDateAndTime(timeStamp, &date, &time);
+            m_Sink += date.size();
+        }));
+
+        std::string buffer;
+        results.push_back(MeasureStage(L"AppendTimestamp", corpus.name, events.size(), [&](size_t i)
+        {
+            buffer.clear();
+            EventFormatter::AppendTimestamp(events[i].timeStamp, buffer);
+            m_Sink += buffer.size();
+        }));
+
+        Utf8EventData utf8EventData;
+        results.push_back(MeasureStage(L"ConvertToUtf8", corpus.name, events.size(), [&](size_t i)
+        {
+            EventFormatter::ConvertToUtf8(events[i], utf8EventData);
+            m_Sink += utf8EventData.source.size();
+        }));
+
+        results.push_back(MeasureStage(L"FormatText", corpus.name, events.size(), [&](size_t i)
+        {
+            buffer.clear();
+            EventFormatter::FormatText(utf8Events[i], buffer);
+            m_Sink += buffer.size();
+        }));
+
+        results.push_back(MeasureStage(L"FormatJson", corpus.name, events.size(), [&](size_t i)
+        {
+            buffer.clear();
+            EventFormatter::FormatJson(utf8Events[i], buffer);
+            m_Sink += buffer.size();
+        }));
+
+        results.push_back(MeasureStage(L"FormatCsv", corpus.name, events.size(), [&](size_t i)
+        {
+            buffer.clear();
+            EventFormatter::FormatCsv(utf8Events[i], buffer);
+            m_Sink += buffer.size();
+        }));
+
+        BinaryEventEncoder encoder;
+        encoder.Reset(buffer);
+        results.push_back(MeasureStage(L"EncodeBinary", corpus.name, events.size(), [&](size_t i)
+        {
+            buffer.clear();
+            encoder.Encode(events[i], buffer);
+            m_Sink += buffer.size();
+        }));
+    }
+
+    StageBenchmarkResult HotPathBenchmark::Summarize(
+        const std::wstring& stageName,
+        const std::wstring& corpusName,
+        size_t corpusEvents,
+        unsigned long long eventsPerRepetition,
+        _Inout_ std::vector<double>& nanosecondsPerEvent,
+        unsigned long long allocations,
+        unsigned long long bytesAllocated)
+    {
+        std::sort(nanosecondsPerEvent.begin(), nanosecondsPerEvent.end());
+        double eventsTimed = static_cast<double>(eventsPerRepetition) * static_cast<double>(nanosecondsPerEvent.size());
+
+        StageBenchmarkResult result;
+        result.stage = stageName;
+        result.corpus = corpusName;
+        result.corpusEvents = corpusEvents;
+        result.eventsPerRepetition = eventsPerRepetition;
+        result.nanosecondsPerEvent = nanosecondsPerEvent[nanosecondsPerEvent.size() / 2];
+        result.minimumNanosecondsPerEvent = nanosecondsPerEvent.front();
+        result.allocationsPerEvent = static_cast<double>(allocations) / eventsTimed;
+        result.bytesAllocatedPerEvent = static_cast<double>(bytesAllocated) / eventsTimed;
+        return result;
+    }
+
+    Parameters HotPathBenchmark::GetFilterParameters(
+        const Corpus& corpus)
+    {
+        // Every other address and rule, in the order first seen, until all but four filters are
+        // taken; the four left match nothing, as filters for quiet hosts would.
+        const size_t matchingFilterCount = FilterCount - 4;
+        Parameters parameters;
+        parameters.outputToConsole = false;
+
+        std::set<std::wstring> sourcesSeen;
+        std::set<std::wstring> rulesSeen;
+        for (const auto& eventData : corpus.events)
+        {
+            if (sourcesSeen.insert(eventData.source).second &&
+                sourcesSeen.size() % 2 == 1 &&
+                parameters.ipAddressFilters.size() < matchingFilterCount)
+            {
+                parameters.ipAddressFilters.push_back(eventData.source);
+            }
+
+            if (rulesSeen.insert(eventData.ruleId).second &&
+                rulesSeen.size() % 2 == 1 &&
+                parameters.ruleIdFilters.size() < matchingFilterCount)
+            {
+                parameters.ruleIdFilters.push_back(eventData.ruleId);
+            }
+        }
+
+        for (size_t i = 1; i <= 4; ++i)
+        {
+            // TEST-NET-2 addresses, which VFP does not log.
+            parameters.ipAddressFilters.push_back(L"198.51.100." + std::to_wstring(i));
+            parameters.ruleIdFilters.push_back(L"{00000000-0000-0000-0000-00000000000" + std::to_wstring(i) + L"}");
+        }
+        return parameters;
+    }
+
+    double HotPathBenchmark::GetNanosecondsPerTick()
+    {
+        LARGE_INTEGER frequency;
+        ::QueryPerformanceFrequency(&frequency);
+        return 1e9 / static_cast<double>(frequency.QuadPart);
+    }
+
+    void HotPathBenchmark::WriteCsv(
+        const std::wstring& label,
+        const std::vector<StageBenchmarkResult>& results)
+    {
+        wprintf(L"label,stage,corpus,corpusEvents,eventsPerRepetition,nanosecondsPerEvent,minimumNanosecondsPerEvent,allocationsPerEvent,bytesAllocatedPerEvent\n");
+        for (const auto& result : results)
+        {
+            wprintf(L"%ls,%ls,%ls,%llu,%llu,%.1f,%.1f,%.3f,%.1f\n",
+                label.c_str(),
+                result.stage.c_str(),
+                result.corpus.c_str(),
+                result.corpusEvents,
+                result.eventsPerRepetition,
+                result.nanosecondsPerEvent,
+                result.minimumNanosecondsPerEvent,
+                result.allocationsPerEvent,
+                result.bytesAllocatedPerEvent);
+        }
+    }
+}
\ No newline at end of file
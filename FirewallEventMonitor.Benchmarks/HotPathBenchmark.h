@@ -0,0 +1,156 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <memory>
+#include <string>
+#include <vector>
+// ntl headers
+#include "ntlEtwRecord.hpp"
+
+#include "FirewallCaptureSession.h"
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    // What one stage of the event path costs, averaged over the events of a corpus.
+    struct StageBenchmarkResult
+    {
+    public:
+        std::wstring stage;
+        std::wstring corpus;
+        // Distinct events in the corpus; the stage cycles through them.
+        unsigned long long corpusEvents = 0;
+        // Events run through the stage in each timed repetition.
+        unsigned long long eventsPerRepetition = 0;
+        // The median repetition, and the fastest.
+        double nanosecondsPerEvent = 0.0;
+        double minimumNanosecondsPerEvent = 0.0;
+        // Calls to operator new, over every timed repetition.
+        double allocationsPerEvent = 0.0;
+        double bytesAllocatedPerEvent = 0.0;
+    };
+
+    // Times each stage a rule match event goes through, one stage at a time over fixed corpora:
+    // the rule match events of a saved capture, and events made up by a SyntheticEventGenerator
+    // with a fixed seed. The same corpora give comparable numbers from build to build.
+    //
+    // Stages run single threaded on events already in memory, so the numbers are the cost of the
+    // code alone: no disk, no console, and caches as warm as the corpus allows.
+    class HotPathBenchmark
+    {
+    public:
+        HotPathBenchmark(
+            unsigned long long eventsPerRepetition,
+            unsigned long repetitions);
+
+        // Reads the rule match events of a saved capture (.etl) once to keep, then once per
+        // repetition to time their decoding. Throws if it has none.
+        void LoadEtlCorpus(const std::wstring& filePath);
+
+        // Makes count events with a fixed seed, so every build measures the same events.
+        void LoadSyntheticCorpus(unsigned long count);
+
+        // Times every stage on every corpus loaded.
+        std::vector<StageBenchmarkResult> Run();
+
+        // Writes the results as CSV, one line per stage and corpus, each prefixed by label.
+        static void WriteCsv(
+            const std::wstring& label,
+            const std::vector<StageBenchmarkResult>& results);
+
+        // Constants
+        // Filters the Filter stage matches against, taken from the corpus; the last few match nothing.
+        static const size_t FilterCount = 16;
+
+        HotPathBenchmark(HotPathBenchmark const&) = delete;
+        HotPathBenchmark& operator=(HotPathBenchmark const&) = delete;
+
+    private:
+        // The numbers VFP logs, before translation into names.
+        struct RawEnumValues
+        {
+            std::wstring direction;
+            std::wstring ruleType;
+            std::wstring protocol;
+            std::wstring icmpType;
+        };
+
+        struct DecodeTotals
+        {
+            LONGLONG ticks = 0;
+            unsigned long long allocations = 0;
+            unsigned long long bytesAllocated = 0;
+            unsigned long long events = 0;
+        };
+
+        // Handed each event of the capture by ntl::EtwReader, which keeps a copy.
+        struct CorpusReader
+        {
+            HotPathBenchmark* benchmark;
+            // Null on the first read, which keeps the events; later reads time their decoding.
+            DecodeTotals* totals;
+
+            bool operator()(const PEVENT_RECORD pEventRecord);
+        };
+
+        struct Corpus
+        {
+            std::wstring name;
+            std::vector<VfpEventData> events;
+            std::vector<Utf8EventData> utf8Events;
+        };
+
+        unsigned long long m_EventsPerRepetition;
+        unsigned long m_Repetitions;
+        // The capture's file name, and its events as decoded by ntl::EtwRecord.
+        std::wstring m_EtlName;
+        std::vector<ntl::EtwRecord> m_EtlRecords;
+        std::vector<RawEnumValues> m_EtlEnumValues;
+        // Decoded into again for every event, as the event callback does; grown while the capture is loaded.
+        ntl::EtwRecord m_DecodeRecord;
+        // Decoding is timed as the capture is read, so its result is ready before Run.
+        std::vector<StageBenchmarkResult> m_DecodeResults;
+        std::vector<Corpus> m_Corpora;
+        // Results of the stages are summed here, so the optimizer cannot leave any out.
+        volatile unsigned long long m_Sink;
+
+        // Runs stage(i) for i from 0 to eventsPerRepetition - 1, once to warm up and then
+        // m_Repetitions times timed.
+        template <typename Stage>
+        StageBenchmarkResult MeasureStage(
+            const std::wstring& stageName,
+            const std::wstring& corpusName,
+            size_t corpusEvents,
+            Stage stage);
+
+        // The median and fastest of the repetitions, and the allocations per event over all of them.
+        static StageBenchmarkResult Summarize(
+            const std::wstring& stageName,
+            const std::wstring& corpusName,
+            size_t corpusEvents,
+            unsigned long long eventsPerRepetition,
+            _Inout_ std::vector<double>& nanosecondsPerEvent,
+            unsigned long long allocations,
+            unsigned long long bytesAllocated);
+
+        void AddCorpus(
+            const std::wstring& name,
+            _Inout_ std::vector<VfpEventData>& events);
+
+        void RunRecordStages(_Inout_ std::vector<StageBenchmarkResult>& results);
+
+        void RunEventStages(
+            const Corpus& corpus,
+            _Inout_ std::vector<StageBenchmarkResult>& results);
+
+        // The address and rule filters of the Filter stage for corpus.
+        static Parameters GetFilterParameters(const Corpus& corpus);
+
+        static double GetNanosecondsPerTick();
+    };
+}
\ No newline at end of file
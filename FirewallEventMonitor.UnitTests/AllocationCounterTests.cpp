@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "AllocationCounter.h"
+// c++ headers
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(AllocationCounterTests)
+    {
+    public:
+
+        TEST_METHOD(CountsEachCallToOperatorNew)
+        {
+            Logger::WriteMessage(L"CountsEachCallToOperatorNew");
+
+            unsigned long long allocations = AllocationCounter::GetAllocationCount();
+            unsigned long long allocatedBytes = AllocationCounter::GetAllocatedBytes();
+            // Kept by the test, so the compiler cannot leave the allocations out.
+            m_Scalar.reset(new int(1));
+            m_Array.reset(new char[100]);
+            Assert::AreEqual(2ull, AllocationCounter::GetAllocationCount() - allocations);
+            Assert::AreEqual(static_cast<unsigned long long>(sizeof(int) + 100), AllocationCounter::GetAllocatedBytes() - allocatedBytes);
+
+            // Reusing a buffer that has grown allocates nothing.
+            std::vector<int> values;
+            values.reserve(16);
+            allocations = AllocationCounter::GetAllocationCount();
+            for (int i = 0; i < 4; ++i)
+            {
+                values.clear();
+                values.assign(16, i);
+            }
+            Assert::AreEqual(0ull, AllocationCounter::GetAllocationCount() - allocations);
+        }
+
+        TEST_METHOD(CountsOnlyTheCallingThread)
+        {
+            Logger::WriteMessage(L"CountsOnlyTheCallingThread");
+
+            unsigned long long workerAllocations = 0;
+            std::thread worker([&workerAllocations]()
+            {
+                unsigned long long start = AllocationCounter::GetAllocationCount();
+                std::unique_ptr<std::wstring> allocated(new std::wstring(100, L'x'));
+                workerAllocations = AllocationCounter::GetAllocationCount() - start;
+            });
+            // Read once the thread has been started, which allocates on this thread.
+            unsigned long long allocations = AllocationCounter::GetAllocationCount();
+            worker.join();
+
+            // The string and its buffer.
+            Assert::IsTrue(workerAllocations >= 2);
+            Assert::AreEqual(allocations, AllocationCounter::GetAllocationCount());
+        }
+
+        std::unique_ptr<int> m_Scalar;
+        std::unique_ptr<char[]> m_Array;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,200 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "BinaryEventFormat.h"
+#include "BinaryLogger.h"
+#include "BinaryLogReader.h"
+#include "Timer.h"
+// c++ headers
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(BinaryLogTests)
+    {
+    public:
+
+        TEST_METHOD_INITIALIZE(MethodInit)
+        {
+            // 2017-09-14 22:42:28 UTC
+            m_EventData.timeStamp = 131499025480000000;
+            LARGE_INTEGER timeStamp;
+            timeStamp.QuadPart = m_EventData.timeStamp;
+            Timer::GetDateAndTime(timeStamp, &m_EventData.date, &m_EventData.time);
+
+            m_EventData.direction = L"Inbound";
+            m_EventData.ruleType = L"Allow";
+            m_EventData.status = L"STATUS_SUCCESS";
+            m_EventData.portId = L"4";
+            m_EventData.portName = L"07312833-61E0-4D4E-BB4C-BFC46E86D345";
+            m_EventData.portFriendlyName = L"NULL";
+            m_EventData.source = L"192.168.100.21";
+            m_EventData.destination = L"192.168.100.22";
+            m_EventData.protocol = L"TCP";
+            m_EventData.sourcePort = L"49152";
+            m_EventData.destinationPort = L"443";
+            m_EventData.isTcpSyn = L"1";
+            m_EventData.ruleId = L"43cff06e-a520-4ad3-9fd9-1894f4a3489b";
+            m_EventData.layerId = L"FW_CONTROLLER_LAYER_ID";
+            m_EventData.groupId = L"FW_GROUP_IPv4_IN_ID";
+            m_EventData.gftFlags = L"0";
+        }
+
+        TEST_METHOD(EncodeDecodeRoundTrip)
+        {
+            Logger::WriteMessage(L"EncodeDecodeRoundTrip");
+
+            VfpEventData second = m_EventData;
+            second.timeStamp -= 10000000; // Timestamps may go backwards.
+            LARGE_INTEGER timeStamp;
+            timeStamp.QuadPart = second.timeStamp;
+            Timer::GetDateAndTime(timeStamp, &second.date, &second.time);
+            second.source = L"fe80::1";
+            second.destination = L"not an address";
+            second.portId = L"007";
+            second.sourcePort.clear();
+            second.destinationPort.clear();
+            second.icmpType = L"V6EchoRequest";
+
+            VfpEventData flow = m_EventData;
+            flow.eventCount = 1000000;
+            flow.synCount = 2;
+            flow.lastTimeStamp = flow.timeStamp + 600000000; // 1 minute later.
+
+            BinaryEventEncoder encoder;
+            std::string buffer;
+            encoder.Reset(buffer);
+            encoder.Encode(m_EventData, buffer);
+            encoder.Encode(second, buffer);
+            encoder.Encode(flow, buffer);
+
+            std::vector<VfpEventData> decoded;
+            BinaryEventDecoder decoder;
+            size_t offset = BinaryEventDecoder::DecodeHeader(buffer.data(), buffer.size());
+            while (offset < buffer.size())
+            {
+                VfpEventData eventData;
+                bool eventDecoded = false;
+                size_t consumed = decoder.DecodeRecord(buffer.data() + offset, buffer.size() - offset, &eventData, &eventDecoded);
+                Assert::IsTrue(consumed > 0);
+                offset += consumed;
+                if (eventDecoded)
+                {
+                    decoded.push_back(eventData);
+                }
+            }
+
+            Assert::AreEqual(static_cast<size_t>(3), decoded.size());
+            AssertEventsEqual(m_EventData, decoded[0]);
+            AssertEventsEqual(second, decoded[1]);
+            AssertEventsEqual(flow, decoded[2]);
+        }
+
+        TEST_METHOD(RepeatedStringsAreWrittenOnce)
+        {
+            Logger::WriteMessage(L"RepeatedStringsAreWrittenOnce");
+
+            BinaryEventEncoder encoder;
+            std::string first;
+            std::string repeated;
+            encoder.Reset(first);
+            encoder.Encode(m_EventData, first);
+            m_EventData.timeStamp += 10000;
+            encoder.Encode(m_EventData, repeated);
+
+            // Only ids, ports, addresses and a timestamp delta remain.
+            Logger::WriteMessage(std::to_wstring(repeated.size()).c_str());
+            Assert::IsTrue(repeated.size() < 40);
+            Assert::IsTrue(repeated.size() * 4 < first.size());
+        }
+
+        TEST_METHOD(DecodeRecordWaitsForCompleteRecord)
+        {
+            Logger::WriteMessage(L"DecodeRecordWaitsForCompleteRecord");
+
+            BinaryEventEncoder encoder;
+            std::string header;
+            std::string buffer;
+            encoder.Reset(header);
+            encoder.Encode(m_EventData, buffer);
+
+            VfpEventData eventData;
+            bool eventDecoded = false;
+            BinaryEventDecoder decoder;
+            // The first record is a dictionary entry; cut it short.
+            Assert::AreEqual(static_cast<size_t>(0), decoder.DecodeRecord(buffer.data(), 3, &eventData, &eventDecoded));
+            Assert::IsFalse(eventDecoded);
+        }
+
+        TEST_METHOD(ChoosesReaderByExtension)
+        {
+            Logger::WriteMessage(L"ChoosesReaderByExtension");
+
+            Assert::IsTrue(BinaryLogReader::IsBinaryLog(L"C:\\temp\\FirewallEventMonitor.20170914T224228.bin"));
+            Assert::IsTrue(BinaryLogReader::IsBinaryLog(L"C:\\temp\\FirewallEventMonitor.20170914T224228.BIN.xpress"));
+            Assert::IsFalse(BinaryLogReader::IsBinaryLog(L"C:\\traces\\host1.etl"));
+            Assert::IsFalse(BinaryLogReader::IsBinaryLog(L"bin"));
+        }
+
+        TEST_METHOD(BinaryLoggerFileReadsBack)
+        {
+            Logger::WriteMessage(L"BinaryLoggerFileReadsBack");
+
+            BinaryLogger binaryLogger(L"");
+            binaryLogger.CreateLogFile();
+            binaryLogger.WriteEvent(m_EventData);
+            binaryLogger.WriteEvent(m_EventData);
+            binaryLogger.CloseLogFile();
+
+            BinaryLogReader reader(binaryLogger.GetLogFilePath());
+            VfpEventData eventData;
+            unsigned long eventCount = 0;
+            while (reader.ReadNext(&eventData))
+            {
+                AssertEventsEqual(m_EventData, eventData);
+                ++eventCount;
+            }
+
+            Assert::AreEqual(2ul, eventCount);
+        }
+
+    private:
+        VfpEventData m_EventData;
+
+        static void AssertEventsEqual(
+            const VfpEventData& expected,
+            const VfpEventData& actual)
+        {
+            Assert::IsTrue(expected.timeStamp == actual.timeStamp);
+            Assert::AreEqual(expected.date, actual.date);
+            Assert::AreEqual(expected.time, actual.time);
+            Assert::AreEqual(expected.direction, actual.direction);
+            Assert::AreEqual(expected.ruleType, actual.ruleType);
+            Assert::AreEqual(expected.status, actual.status);
+            Assert::AreEqual(expected.portId, actual.portId);
+            Assert::AreEqual(expected.portName, actual.portName);
+            Assert::AreEqual(expected.portFriendlyName, actual.portFriendlyName);
+            Assert::AreEqual(expected.source, actual.source);
+            Assert::AreEqual(expected.destination, actual.destination);
+            Assert::AreEqual(expected.protocol, actual.protocol);
+            Assert::AreEqual(expected.sourcePort, actual.sourcePort);
+            Assert::AreEqual(expected.destinationPort, actual.destinationPort);
+            Assert::AreEqual(expected.icmpType, actual.icmpType);
+            Assert::AreEqual(expected.isTcpSyn, actual.isTcpSyn);
+            Assert::AreEqual(expected.ruleId, actual.ruleId);
+            Assert::AreEqual(expected.layerId, actual.layerId);
+            Assert::AreEqual(expected.groupId, actual.groupId);
+            Assert::AreEqual(expected.gftFlags, actual.gftFlags);
+            Assert::IsTrue(expected.eventCount == actual.eventCount);
+            Assert::IsTrue(expected.synCount == actual.synCount);
+            Assert::IsTrue(expected.lastTimeStamp == actual.lastTimeStamp);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "BloomFilter.h"
+#include "EventKeys.h"
+// c++ headers
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(BloomFilterTests)
+    {
+    public:
+
+        TEST_METHOD(NoFalseNegativesAndFewFalsePositives)
+        {
+            Logger::WriteMessage(L"NoFalseNegativesAndFewFalsePositives");
+
+            const unsigned long long keyCount = 10000;
+            BloomFilter filter(keyCount);
+            Assert::AreEqual(static_cast<size_t>(keyCount * BloomFilter::DefaultBitsPerKey), filter.GetBitCount());
+
+            for (unsigned long long i = 0; i < keyCount; ++i)
+            {
+                filter.Add(HashOf(i));
+            }
+
+            for (unsigned long long i = 0; i < keyCount; ++i)
+            {
+                Assert::IsTrue(filter.MayContain(HashOf(i)));
+            }
+
+            // About 1% at 10 bits per key.
+            unsigned long long falsePositives = 0;
+            for (unsigned long long i = keyCount; i < keyCount * 11; ++i)
+            {
+                if (filter.MayContain(HashOf(i)))
+                {
+                    ++falsePositives;
+                }
+            }
+            Assert::IsTrue(falsePositives < keyCount * 10 / 50);
+        }
+
+        TEST_METHOD(EncodeDecodeRoundTrip)
+        {
+            Logger::WriteMessage(L"EncodeDecodeRoundTrip");
+
+            BloomFilter filter(100);
+            for (unsigned long long i = 0; i < 100; ++i)
+            {
+                filter.Add(HashOf(i));
+            }
+
+            std::string buffer;
+            filter.Encode(buffer);
+
+            BloomFilter decoded;
+            Assert::IsFalse(decoded.MayContain(HashOf(0)));
+
+            const char* data = buffer.data();
+            decoded.Decode(data, buffer.data() + buffer.size());
+            Assert::IsTrue(data == buffer.data() + buffer.size());
+            Assert::AreEqual(filter.GetBitCount(), decoded.GetBitCount());
+            for (unsigned long long i = 0; i < 1000; ++i)
+            {
+                Assert::AreEqual(filter.MayContain(HashOf(i)), decoded.MayContain(HashOf(i)));
+            }
+
+            // Truncated.
+            Assert::ExpectException<std::exception>([&]()
+            {
+                const char* truncated = buffer.data();
+                decoded.Decode(truncated, buffer.data() + buffer.size() - 1);
+            });
+        }
+
+    private:
+        static unsigned long long HashOf(unsigned long long value)
+        {
+            EventKey key = {};
+            memcpy_s(key.bytes, sizeof(key.bytes), &value, sizeof(value));
+            return EventKeys::Hash(key);
+        }
+    };
+}
\ No newline at end of file
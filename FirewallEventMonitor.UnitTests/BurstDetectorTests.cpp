@@ -0,0 +1,164 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "BurstDetector.h"
+// c++ headers
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    // 2017-09-07T22:00:00Z as a FILETIME.
+    const LONGLONG BurstStartTimeStamp = 13149295200LL * 10000000LL;
+    const LONGLONG BurstTicksPerSecond = 10000000LL;
+
+    // Adds count denies spread over the given second.
+    void AddDenies(
+        BurstDetector& detector,
+        const EventKeys& eventKeys,
+        LONGLONG second,
+        unsigned long long count,
+        std::vector<BurstDetector::Alert>& alerts)
+    {
+        for (unsigned long long i = 0; i < count; ++i)
+        {
+            LONGLONG timeStamp = BurstStartTimeStamp + second * BurstTicksPerSecond + static_cast<LONGLONG>(i * 1000);
+            detector.AddDeny(eventKeys, timeStamp, alerts);
+        }
+    }
+
+    EventKeys ParseBurstKeys(const wchar_t* portId)
+    {
+        VfpEventData eventData;
+        eventData.portId = portId;
+        eventData.ruleId = L"11111111-1111-1111-1111-111111111111";
+        eventData.ruleType = L"Deny";
+        EventKeys eventKeys;
+        eventKeys.Parse(eventData);
+        return eventKeys;
+    }
+
+    TEST_CLASS(BurstDetectorTests)
+    {
+    public:
+
+        TEST_METHOD(SteadyDeniesDoNotAlertAndABurstDoes)
+        {
+            Logger::WriteMessage(L"SteadyDeniesDoNotAlertAndABurstDoes");
+
+            BurstDetector detector(4.0, 0);
+            EventKeys eventKeys = ParseBurstKeys(L"4");
+            std::vector<BurstDetector::Alert> alerts;
+
+            // A minute of 20 to 30 denies a second.
+            for (LONGLONG second = 0; second < 60; ++second)
+            {
+                AddDenies(detector, eventKeys, second, 20 + (second * 7) % 11, alerts);
+            }
+            Assert::AreEqual(size_t(0), alerts.size());
+
+            // Then 500 in one second: one alert for the port and one for the rule, raised as
+            // soon as the count crosses the threshold.
+            AddDenies(detector, eventKeys, 60, 500, alerts);
+            Assert::AreEqual(size_t(2), alerts.size());
+            Assert::AreEqual(2ull, detector.GetAlertCount());
+            Assert::IsTrue(alerts[0].field == EventKeys::PortId);
+            Assert::IsTrue(alerts[1].field == EventKeys::RuleId);
+            Assert::IsTrue(alerts[0].average > 20.0 && alerts[0].average < 30.0);
+            double threshold = alerts[0].average + 4.0 * alerts[0].deviation;
+            Assert::IsTrue(static_cast<double>(alerts[0].count) > threshold);
+            Assert::IsTrue(static_cast<double>(alerts[0].count) <= threshold + 1.0);
+            Assert::IsTrue(alerts[0].count < 500);
+
+            std::string buffer;
+            BurstDetector::FormatAlert(alerts[0], buffer);
+            Logger::WriteMessage(buffer.c_str());
+            Assert::IsTrue(buffer.find("2017-09-07T22:01:00.") == 0);
+            Assert::IsTrue(buffer.find(" Deny burst on ") != std::string::npos);
+            Assert::IsTrue(buffer.find(" denies this second, baseline ") != std::string::npos);
+
+            // The burst going on widens the deviation, so it is not reported again every second.
+            alerts.clear();
+            AddDenies(detector, eventKeys, 61, 500, alerts);
+            Assert::AreEqual(size_t(0), alerts.size());
+        }
+
+        TEST_METHOD(NothingAlertsDuringWarmUp)
+        {
+            Logger::WriteMessage(L"NothingAlertsDuringWarmUp");
+
+            BurstDetector detector(4.0, 0);
+            EventKeys eventKeys = ParseBurstKeys(L"4");
+            std::vector<BurstDetector::Alert> alerts;
+
+            AddDenies(detector, eventKeys, 0, 1, alerts);
+            AddDenies(detector, eventKeys, BurstDetector::WarmUpSeconds - 1, 500, alerts);
+            Assert::AreEqual(size_t(0), alerts.size());
+
+            // A port first seen after the warm-up starts from a zero baseline.
+            EventKeys newPort = ParseBurstKeys(L"5");
+            AddDenies(detector, newPort, BurstDetector::WarmUpSeconds, BurstDetector::MinimumBurst - 1, alerts);
+            Assert::AreEqual(size_t(0), alerts.size());
+            AddDenies(detector, newPort, BurstDetector::WarmUpSeconds, 1, alerts);
+            Assert::AreEqual(size_t(1), alerts.size());
+            Assert::IsTrue(alerts[0].field == EventKeys::PortId);
+            Assert::AreEqual(0.0, alerts[0].average);
+        }
+
+        TEST_METHOD(QuietKeysDecayAndAlertAgain)
+        {
+            Logger::WriteMessage(L"QuietKeysDecayAndAlertAgain");
+
+            BurstDetector detector(4.0, 0);
+            EventKeys eventKeys = ParseBurstKeys(L"4");
+            std::vector<BurstDetector::Alert> alerts;
+
+            AddDenies(detector, eventKeys, 0, 1, alerts);
+            // A long attack becomes the baseline.
+            for (LONGLONG second = 100; second < 400; ++second)
+            {
+                AddDenies(detector, eventKeys, second, 200, alerts);
+            }
+            alerts.clear();
+            AddDenies(detector, eventKeys, 400, 200, alerts);
+            Assert::AreEqual(size_t(0), alerts.size());
+
+            // Ten quiet minutes later it is news again.
+            AddDenies(detector, eventKeys, 1000, 200, alerts);
+            Assert::AreEqual(size_t(2), alerts.size());
+            Assert::IsTrue(alerts[0].average < 1.0);
+        }
+
+        TEST_METHOD(HighFidelityFollowsAnAlert)
+        {
+            Logger::WriteMessage(L"HighFidelityFollowsAnAlert");
+
+            BurstDetector detector(4.0, 5);
+            EventKeys burstPort = ParseBurstKeys(L"4");
+            VfpEventData eventData;
+            eventData.portId = L"5";
+            eventData.ruleId = L"22222222-2222-2222-2222-222222222222";
+            EventKeys quietPort;
+            quietPort.Parse(eventData);
+            std::vector<BurstDetector::Alert> alerts;
+
+            AddDenies(detector, burstPort, 0, 1, alerts);
+            AddDenies(detector, quietPort, 0, 1, alerts);
+            LONGLONG burstSecond = 100;
+            Assert::IsFalse(detector.IsHighFidelity(burstPort, BurstStartTimeStamp + burstSecond * BurstTicksPerSecond));
+
+            AddDenies(detector, burstPort, burstSecond, 100, alerts);
+            Assert::AreEqual(size_t(2), alerts.size());
+
+            Assert::IsTrue(detector.IsHighFidelity(burstPort, BurstStartTimeStamp + burstSecond * BurstTicksPerSecond));
+            Assert::IsTrue(detector.IsHighFidelity(burstPort, BurstStartTimeStamp + (burstSecond + 5) * BurstTicksPerSecond));
+            Assert::IsFalse(detector.IsHighFidelity(burstPort, BurstStartTimeStamp + (burstSecond + 6) * BurstTicksPerSecond));
+            Assert::IsFalse(detector.IsHighFidelity(quietPort, BurstStartTimeStamp + burstSecond * BurstTicksPerSecond));
+        }
+    };
+}
\ No newline at end of file
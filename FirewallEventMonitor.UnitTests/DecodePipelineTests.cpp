@@ -0,0 +1,231 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "DecodePipeline.h"
+// c++ headers
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(DecodePipelineTests)
+    {
+    public:
+
+        TEST_METHOD(BatchCopiesPayloads)
+        {
+            Logger::WriteMessage(L"BatchCopiesPayloads");
+
+            EventRecordBatch batch;
+            std::vector<std::string> userData = { "first", "", "third record" };
+            ULONGLONG extendedData = 0x1122334455667788ull;
+            for (size_t i = 0; i < userData.size(); ++i)
+            {
+                std::string data(userData[i]);
+                EVENT_HEADER_EXTENDED_DATA_ITEM item = {};
+                item.DataSize = sizeof(extendedData);
+                item.DataPtr = reinterpret_cast<ULONGLONG>(&extendedData);
+
+                EVENT_RECORD record = {};
+                record.EventHeader.TimeStamp.QuadPart = static_cast<LONGLONG>(i);
+                record.UserDataLength = static_cast<USHORT>(data.size());
+                record.UserData = &data[0];
+                record.ExtendedDataCount = (i == 2) ? 1 : 0;
+                record.ExtendedData = (i == 2) ? &item : nullptr;
+                batch.Add(record);
+
+                // The batch keeps its own copy.
+                data.assign(data.size(), 'x');
+                item.DataPtr = 0;
+            }
+            extendedData = 0;
+            batch.Seal();
+
+            Assert::AreEqual(userData.size(), batch.size());
+            for (size_t i = 0; i < userData.size(); ++i)
+            {
+                EVENT_RECORD& record = batch[i];
+                Assert::AreEqual(static_cast<LONGLONG>(i), record.EventHeader.TimeStamp.QuadPart);
+                Assert::AreEqual(userData[i], std::string(static_cast<const char*>(record.UserData), record.UserDataLength));
+            }
+            Assert::IsNull(batch[1].UserData);
+            Assert::IsNull(batch[0].ExtendedData);
+            Assert::IsTrue(batch[2].ExtendedDataCount == 1);
+            Assert::AreEqual(0x1122334455667788ull, *reinterpret_cast<const ULONGLONG*>(batch[2].ExtendedData[0].DataPtr));
+
+            batch.Clear();
+            Assert::IsTrue(batch.empty());
+        }
+
+        TEST_METHOD(DeliversInOrder)
+        {
+            Logger::WriteMessage(L"DeliversInOrder");
+
+            std::vector<LONGLONG> delivered;
+            size_t payloadsMismatched = 0;
+            {
+                // Every third batch is slow to decode, so later batches finish first.
+                const size_t batchSize = 7;
+                DecodePipeline pipeline(
+                    4,
+                    [&](EVENT_RECORD& record, VfpEventData& eventData)
+                    {
+                        LONGLONG index = record.EventHeader.TimeStamp.QuadPart;
+                        if (index % (batchSize * 3) == 0)
+                        {
+                            ::Sleep(2);
+                        }
+                        eventData.timeStamp = index;
+                        eventData.ruleId.assign(static_cast<const wchar_t*>(record.UserData), record.UserDataLength / sizeof(wchar_t));
+                        // Every fifth event is filtered out.
+                        return index % 5 != 0;
+                    },
+                    [&](VfpEventData& eventData)
+                    {
+                        // Asserts on a worker would not reach the test.
+                        if (eventData.ruleId != std::to_wstring(eventData.timeStamp))
+                        {
+                            ++payloadsMismatched;
+                        }
+                        delivered.push_back(eventData.timeStamp);
+                    },
+                    batchSize);
+
+                for (LONGLONG i = 0; i < 1000; ++i)
+                {
+                    std::wstring ruleId(std::to_wstring(i));
+                    EVENT_RECORD record = {};
+                    record.EventHeader.TimeStamp.QuadPart = i;
+                    record.UserDataLength = static_cast<USHORT>(ruleId.size() * sizeof(wchar_t));
+                    record.UserData = &ruleId[0];
+                    pipeline.AddEventRecord(record);
+                }
+                pipeline.Drain();
+
+                DecodePipelineResults results = pipeline.GetResults();
+                Assert::AreEqual(1000ull, results.eventsQueued);
+                Assert::AreEqual(800ull, results.eventsDelivered);
+                Assert::AreEqual(143ull, results.batchesQueued);
+            }
+
+            Assert::AreEqual(static_cast<size_t>(0), payloadsMismatched);
+            Assert::AreEqual(static_cast<size_t>(800), delivered.size());
+            LONGLONG expected = 0;
+            for (LONGLONG timeStamp : delivered)
+            {
+                if (expected % 5 == 0)
+                {
+                    ++expected;
+                }
+                Assert::AreEqual(expected, timeStamp);
+                ++expected;
+            }
+        }
+
+        TEST_METHOD(ReorderDepthStaysNearTheWorkerCount)
+        {
+            Logger::WriteMessage(L"ReorderDepthStaysNearTheWorkerCount");
+
+            // Every batch takes as long to decode, and the producer keeps every worker's queue full.
+            const size_t workerCount = 4;
+            const size_t batchSize = 8;
+            DecodePipeline pipeline(
+                workerCount,
+                [&](EVENT_RECORD& record, VfpEventData& eventData)
+                {
+                    if (record.EventHeader.TimeStamp.QuadPart % batchSize == 0)
+                    {
+                        ::Sleep(1);
+                    }
+                    eventData.timeStamp = record.EventHeader.TimeStamp.QuadPart;
+                    return true;
+                },
+                [&](VfpEventData&)
+                {
+                },
+                batchSize);
+
+            for (LONGLONG i = 0; i < 2000; ++i)
+            {
+                EVENT_RECORD record = {};
+                record.EventHeader.TimeStamp.QuadPart = i;
+                pipeline.AddEventRecord(record);
+            }
+            pipeline.Drain();
+
+            // Up to MaxQueuedBatchesPerWorker times as many could be held back if workers ran
+            // their newest batch first.
+            DecodePipelineResults results = pipeline.GetResults();
+            Assert::AreEqual(250ull, results.batchesQueued);
+            Assert::IsTrue(results.maximumReorderDepth <= 2 * workerCount);
+        }
+
+        TEST_METHOD(FlushCheckAndDrainPassABlockedProducer)
+        {
+            Logger::WriteMessage(L"FlushCheckAndDrainPassABlockedProducer");
+
+            const LONGLONG eventCount = static_cast<LONGLONG>(DecodePipeline::MaxQueuedBatchesPerWorker) + 4;
+            std::atomic<bool> sinkOpen(false);
+            std::vector<LONGLONG> delivered;
+            {
+                // One event per batch, and a sink that holds every batch until it is opened.
+                DecodePipeline pipeline(
+                    1,
+                    [&](EVENT_RECORD& record, VfpEventData& eventData)
+                    {
+                        eventData.timeStamp = record.EventHeader.TimeStamp.QuadPart;
+                        return true;
+                    },
+                    [&](VfpEventData& eventData)
+                    {
+                        while (!sinkOpen)
+                        {
+                            ::Sleep(1);
+                        }
+                        delivered.push_back(eventData.timeStamp);
+                    },
+                    1);
+
+                std::thread producer([&]()
+                {
+                    for (LONGLONG i = 0; i < eventCount; ++i)
+                    {
+                        EVENT_RECORD record = {};
+                        record.EventHeader.TimeStamp.QuadPart = i;
+                        pipeline.AddEventRecord(record);
+                    }
+                });
+
+                while (pipeline.GetResults().backpressureWaits == 0)
+                {
+                    ::Sleep(1);
+                }
+
+                // The producer is waiting for room; neither of these may wait behind it.
+                pipeline.FlushCheck();
+                std::thread drain([&]() { pipeline.Drain(); });
+
+                sinkOpen = true;
+                producer.join();
+                drain.join();
+                pipeline.Drain();
+
+                DecodePipelineResults results = pipeline.GetResults();
+                Assert::AreEqual(static_cast<unsigned long long>(eventCount), results.eventsDelivered);
+            }
+
+            Assert::AreEqual(static_cast<size_t>(eventCount), delivered.size());
+            for (LONGLONG i = 0; i < eventCount; ++i)
+            {
+                Assert::AreEqual(i, delivered[i]);
+            }
+        }
+    };
+}
\ No newline at end of file
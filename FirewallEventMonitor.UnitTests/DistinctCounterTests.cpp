@@ -0,0 +1,128 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "DistinctCounter.h"
+// c++ headers
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(DistinctCounterTests)
+    {
+    public:
+
+        TEST_METHOD(ScanAndNoisyClientAreTold)
+        {
+            Logger::WriteMessage(L"ScanAndNoisyClientAreTold");
+
+            DistinctCounter counter;
+            VfpEventData eventData;
+            eventData.portId = L"4";
+
+            // A single client hammering one port.
+            eventData.ruleId = L"11111111-1111-1111-1111-111111111111";
+            eventData.source = L"192.168.100.21";
+            eventData.destinationPort = L"443";
+            for (int i = 0; i < 1000; ++i)
+            {
+                counter.AddEvent(eventData);
+            }
+
+            // 200 sources each probing 5 ports.
+            eventData.ruleId = L"22222222-2222-2222-2222-222222222222";
+            for (int i = 0; i < 1000; ++i)
+            {
+                eventData.source = L"10.0.0." + std::to_wstring(i % 200);
+                eventData.destinationPort = std::to_wstring(i / 200);
+                counter.AddEvent(eventData);
+            }
+
+            std::string buffer;
+            counter.Report(DistinctCounter::ReportedKeys, 10, buffer);
+            Logger::WriteMessage(buffer.c_str());
+
+            // The scan is listed first.
+            size_t scan = buffer.find("    22222222-2222-2222-2222-222222222222 ");
+            size_t client = buffer.find("    11111111-1111-1111-1111-111111111111 ");
+            Assert::IsTrue(scan != std::string::npos);
+            Assert::IsTrue(client != std::string::npos);
+            Assert::IsTrue(scan < client);
+
+            // About 200 sources and exactly 5 ports for the scan.
+            std::vector<std::string> scanRow = ParseRow(buffer, scan);
+            Assert::AreEqual(static_cast<size_t>(6), scanRow.size());
+            Assert::IsTrue(scanRow[1] == "1000");
+            unsigned long sources = std::stoul(scanRow[2]);
+            Assert::IsTrue(sources >= 190 && sources <= 220);
+            Assert::IsTrue(scanRow[3] == "5");
+
+            // A single client counts exactly one of each.
+            std::vector<std::string> clientRow = ParseRow(buffer, client);
+            std::vector<std::string> expected = { "11111111-1111-1111-1111-111111111111", "1000", "1", "1", "1", "1" };
+            Assert::IsTrue(clientRow == expected);
+        }
+
+        TEST_METHOD(IntervalsRollIntoTotals)
+        {
+            Logger::WriteMessage(L"IntervalsRollIntoTotals");
+
+            DistinctCounter counter;
+            VfpEventData eventData;
+            eventData.ruleId = L"11111111-1111-1111-1111-111111111111";
+            eventData.destinationPort = L"80";
+
+            eventData.source = L"192.168.100.21";
+            counter.AddEvent(eventData);
+            std::string buffer;
+            counter.Report(DistinctCounter::ReportedKeys, 10, buffer);
+
+            eventData.source = L"192.168.100.22";
+            counter.AddEvent(eventData);
+            buffer.clear();
+            counter.Report(DistinctCounter::ReportedKeys, 10, buffer);
+            Logger::WriteMessage(buffer.c_str());
+            Assert::IsTrue(buffer.find("    11111111-1111-1111-1111-111111111111               1             1             1             2             1\r\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("  Port Id                                         Events       Sources     Dst ports   All sources All dst ports\r\n    none\r\n") != std::string::npos);
+        }
+
+        TEST_METHOD(FullTableDropsNewKeys)
+        {
+            Logger::WriteMessage(L"FullTableDropsNewKeys");
+
+            DistinctCounter counter;
+            VfpEventData eventData;
+            eventData.source = L"192.168.100.21";
+            for (size_t i = 0; i <= DistinctCounter::MaxKeys; ++i)
+            {
+                eventData.portId = std::to_wstring(i);
+                counter.AddEvent(eventData);
+            }
+            Assert::AreEqual(1ull, counter.GetDroppedEvents());
+        }
+
+    private:
+        // Splits the report row starting at offset into its columns: the key, events, sources,
+        // destination ports, all sources and all destination ports.
+        static std::vector<std::string> ParseRow(
+            const std::string& buffer,
+            size_t offset)
+        {
+            size_t end = buffer.find("\r\n", offset);
+            std::istringstream row(buffer.substr(offset, end - offset));
+            std::vector<std::string> columns;
+            std::string column;
+            while (row >> column)
+            {
+                columns.push_back(column);
+            }
+            return columns;
+        }
+    };
+}
\ No newline at end of file
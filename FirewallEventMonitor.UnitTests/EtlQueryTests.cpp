@@ -0,0 +1,86 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "EtlQuery.h"
+#include "EventPredicate.h"
+#include "UserInput.h"
+// c++ headers
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(EtlQueryTests)
+    {
+    public:
+
+        TEST_METHOD(MergeIsInTimeOrderAndStable)
+        {
+            Logger::WriteMessage(L"MergeIsInTimeOrderAndStable");
+
+            std::vector<std::vector<EtlQuery::MatchedEvent>> runs(4);
+            runs[0] = { { 1, "a1" }, { 4, "a4" }, { 4, "a4'" }, { 9, "a9" } };
+            runs[1] = { { 2, "b2" }, { 4, "b4" } };
+            // runs[2] is empty.
+            runs[3] = { { 0, "d0" }, { 10, "d10" } };
+
+            std::vector<std::string> merged;
+            EtlQuery::MergeByTimeStamp(runs, [&](const EtlQuery::MatchedEvent& match) { merged.push_back(match.text); });
+
+            std::vector<std::string> expected = { "d0", "a1", "b2", "a4", "a4'", "b4", "a9", "d10" };
+            Assert::IsTrue(expected == merged);
+        }
+
+        TEST_METHOD(QueriesSavedCaptures)
+        {
+            Logger::WriteMessage(L"QueriesSavedCaptures");
+
+            Parameters parameters;
+            EventPredicate predicate(parameters, 0);
+            std::vector<std::wstring> files(3, TestTraceFile);
+
+            EtlQuery ordered(predicate, true, 2);
+            EtlQueryResults orderedResults = ordered.Run(files);
+            Assert::AreEqual(3ull, orderedResults.filesRead);
+            Assert::AreEqual(0ull, orderedResults.filesFailed);
+            Assert::IsTrue(orderedResults.eventsScanned > 0);
+            Assert::AreEqual(orderedResults.eventsScanned, orderedResults.eventsMatched);
+
+            // Every copy holds the same events, however many threads read them.
+            EtlQuery unordered(predicate, false, 4);
+            EtlQueryResults unorderedResults = unordered.Run(files);
+            Assert::AreEqual(orderedResults.eventsScanned, unorderedResults.eventsScanned);
+
+            EtlQueryResults singleResults = unordered.Run(std::vector<std::wstring>(1, TestTraceFile));
+            Assert::AreEqual(orderedResults.eventsScanned, singleResults.eventsScanned * 3);
+        }
+
+        TEST_METHOD(FiltersAndUnreadableFiles)
+        {
+            Logger::WriteMessage(L"FiltersAndUnreadableFiles");
+
+            Parameters parameters;
+            parameters.ipAddressFilters.push_back(L"0.0.0.0");
+            EventPredicate predicate(parameters, 0);
+
+            std::vector<std::wstring> files;
+            files.push_back(TestTraceFile);
+            files.push_back(L"NoSuchCapture.etl");
+
+            EtlQuery query(predicate, true, 2);
+            EtlQueryResults results = query.Run(files);
+            Assert::AreEqual(1ull, results.filesRead);
+            Assert::AreEqual(1ull, results.filesFailed);
+            Assert::IsTrue(results.eventsScanned > 0);
+            Assert::AreEqual(0ull, results.eventsMatched);
+        }
+
+    private:
+        const std::wstring TestTraceFile = L"..\\..\\..\\TestTraceSession.etl";
+    };
+}
\ No newline at end of file
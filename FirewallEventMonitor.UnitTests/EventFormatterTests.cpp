@@ -0,0 +1,208 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "EventFormatter.h"
+// ntl headers
+#include "ntlString.hpp"
+// c++ headers
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(EventFormatterTests)
+    {
+    public:
+
+        TEST_METHOD(FormatTextMatchesStreamLayout)
+        {
+            Logger::WriteMessage(L"FormatTextMatchesStreamLayout");
+
+            VfpEventData eventData;
+            eventData.date = L"20170907";
+            eventData.time = L"224228";
+            eventData.direction = L"Inbound";
+            eventData.ruleType = L"Allow";
+            eventData.status = L"STATUS_SUCCESS";
+            eventData.portId = L"4";
+            eventData.portName = L"07312833-61E0-4D4E-BB4C-BFC46E86D345";
+            eventData.portFriendlyName = L"NULL";
+            eventData.source = L"192.168.100.21";
+            eventData.destination = L"192.168.100.22";
+            eventData.protocol = L"ICMPv4";
+            eventData.icmpType = L"V4EchoRequest";
+            eventData.ruleId = L"43cff06e-a520-4ad3-9fd9-1894f4a3489b";
+            eventData.layerId = L"FW_CONTROLLER_LAYER_ID";
+            eventData.groupId = L"FW_GROUP_IPv4_IN_ID";
+            eventData.gftFlags = L"0";
+
+            std::string expected =
+                "[20170907 224228] Inbound Allow rule status = STATUS_SUCCESS \r\n"
+                "  port {id = 4, portName = 07312833-61E0-4D4E-BB4C-BFC46E86D345, portFriendlyName = NULL} \r\n"
+                "  flow {src = 192.168.100.21, dst = 192.168.100.22, protocol = ICMPv4, icmp type = V4EchoRequest} \r\n"
+                "  rule {id = 43cff06e-a520-4ad3-9fd9-1894f4a3489b, layer = FW_CONTROLLER_LAYER_ID, group = FW_GROUP_IPv4_IN_ID, gftFlags = 0} \r\n\r\n";
+
+            std::string buffer;
+            Utf8EventData utf8EventData;
+            EventFormatter::ConvertToUtf8(eventData, utf8EventData);
+            EventFormatter::FormatText(utf8EventData, buffer);
+            Logger::WriteMessage(buffer.c_str());
+
+            Assert::IsTrue(buffer == expected);
+        }
+
+        TEST_METHOD(AppendUtf8EncodesNonAscii)
+        {
+            Logger::WriteMessage(L"AppendUtf8EncodesNonAscii");
+
+            // 'a', U+00E9, U+4E2D, U+1F600 (surrogate pair)
+            std::wstring value = L"a\x00E9\x4E2D\xD83D\xDE00";
+            std::string expected = "a\xC3\xA9\xE4\xB8\xAD\xF0\x9F\x98\x80";
+
+            std::string buffer;
+            ntl::String::append_utf8(value, buffer);
+
+            Assert::IsTrue(buffer == expected);
+        }
+
+        TEST_METHOD(AppendUtf8MixesAsciiRunsAndNonAscii)
+        {
+            Logger::WriteMessage(L"AppendUtf8MixesAsciiRunsAndNonAscii");
+
+            // ASCII runs longer than 8 code units, split by non-ASCII and an unpaired surrogate.
+            std::wstring value = L"portFriendlyName-\x00E9-vm01.contoso.com\xD800tail0123456789";
+            std::string expected = "portFriendlyName-\xC3\xA9-vm01.contoso.com\xEF\xBF\xBDtail0123456789";
+
+            std::string buffer = "prefix ";
+            ntl::String::append_utf8(value, buffer);
+
+            Assert::IsTrue(buffer == "prefix " + expected);
+            Assert::IsTrue(ntl::String::convert_to_string(value) == expected);
+        }
+
+        TEST_METHOD(FormatJsonEscapesStrings)
+        {
+            Logger::WriteMessage(L"FormatJsonEscapesStrings");
+
+            VfpEventData eventData;
+            eventData.timeStamp = 131492977481230000LL; // 2017-09-07T22:42:28.123Z
+            eventData.direction = L"Outbound";
+            eventData.ruleType = L"Deny";
+            eventData.status = L"STATUS_SUCCESS";
+            eventData.portId = L"12";
+            eventData.portFriendlyName = L"vm \"web\\1\"\t\x00E9";
+            eventData.source = L"10.0.0.1";
+            eventData.destination = L"10.0.0.2";
+            eventData.protocol = L"TCP";
+            eventData.sourcePort = L"50000";
+            eventData.destinationPort = L"443";
+            eventData.gftFlags = L"0";
+
+            std::string expected =
+                "{\"time\":\"2017-09-07T22:42:28.123Z\",\"direction\":\"Outbound\",\"ruleType\":\"Deny\","
+                "\"status\":\"STATUS_SUCCESS\",\"portId\":12,\"portName\":\"\","
+                "\"portFriendlyName\":\"vm \\\"web\\\\1\\\"\\t\xC3\xA9\",\"src\":\"10.0.0.1\",\"dst\":\"10.0.0.2\","
+                "\"protocol\":\"TCP\",\"srcPort\":50000,\"dstPort\":443,\"ruleId\":\"\",\"layer\":\"\",\"group\":\"\",\"gftFlags\":\"0\"}\n";
+
+            std::string buffer;
+            Utf8EventData utf8EventData;
+            EventFormatter::ConvertToUtf8(eventData, utf8EventData);
+            EventFormatter::FormatJson(utf8EventData, buffer);
+            Logger::WriteMessage(buffer.c_str());
+
+            Assert::IsTrue(buffer == expected);
+        }
+
+        TEST_METHOD(FormatJsonTypesFieldsByName)
+        {
+            Logger::WriteMessage(L"FormatJsonTypesFieldsByName");
+
+            // All-digit names stay strings; a port that is not a number is null, not a string.
+            VfpEventData eventData;
+            eventData.timeStamp = 131492977481230000LL; // 2017-09-07T22:42:28.123Z
+            eventData.direction = L"Inbound";
+            eventData.ruleType = L"Allow";
+            eventData.status = L"0";
+            eventData.portId = L"7";
+            eventData.portName = L"0042";
+            eventData.portFriendlyName = L"12345";
+            eventData.protocol = L"TCP";
+            eventData.sourcePort = L"80";
+            eventData.destinationPort = L"http";
+            eventData.ruleId = L"100";
+            eventData.layerId = L"2";
+            eventData.groupId = L"3";
+            eventData.gftFlags = L"1";
+
+            std::string expected =
+                "{\"time\":\"2017-09-07T22:42:28.123Z\",\"direction\":\"Inbound\",\"ruleType\":\"Allow\","
+                "\"status\":\"0\",\"portId\":7,\"portName\":\"0042\",\"portFriendlyName\":\"12345\","
+                "\"src\":\"\",\"dst\":\"\",\"protocol\":\"TCP\",\"srcPort\":80,\"dstPort\":null,"
+                "\"ruleId\":\"100\",\"layer\":\"2\",\"group\":\"3\",\"gftFlags\":\"1\"}\n";
+
+            std::string buffer;
+            Utf8EventData utf8EventData;
+            EventFormatter::ConvertToUtf8(eventData, utf8EventData);
+            EventFormatter::FormatJson(utf8EventData, buffer);
+            Logger::WriteMessage(buffer.c_str());
+
+            Assert::IsTrue(buffer == expected);
+        }
+
+        TEST_METHOD(FormatCsvQuotesFields)
+        {
+            Logger::WriteMessage(L"FormatCsvQuotesFields");
+
+            VfpEventData eventData;
+            eventData.timeStamp = 131492977481230000LL; // 2017-09-07T22:42:28.123Z
+            eventData.direction = L"Inbound";
+            eventData.ruleType = L"Allow";
+            eventData.portFriendlyName = L"web, \"blue\"";
+            eventData.protocol = L"UDP";
+
+            std::string expected =
+                "2017-09-07T22:42:28.123Z,Inbound,Allow,,,,\"web, \"\"blue\"\"\",,,UDP,,,,,,,,\r\n";
+
+            std::string buffer;
+            Utf8EventData utf8EventData;
+            EventFormatter::ConvertToUtf8(eventData, utf8EventData);
+            EventFormatter::FormatCsv(utf8EventData, buffer);
+            Logger::WriteMessage(buffer.c_str());
+
+            Assert::IsTrue(buffer == expected);
+        }
+
+        TEST_METHOD(FormatCsvAppendsFlowColumns)
+        {
+            Logger::WriteMessage(L"FormatCsvAppendsFlowColumns");
+
+            VfpEventData eventData;
+            eventData.timeStamp = 131492977481230000LL; // 2017-09-07T22:42:28.123Z
+            eventData.direction = L"Inbound";
+            eventData.ruleType = L"Deny";
+            eventData.protocol = L"TCP";
+            eventData.eventCount = 1000000;
+            eventData.synCount = 3;
+            eventData.lastTimeStamp = eventData.timeStamp + 25000000LL; // 2.5 seconds later.
+
+            std::string expected =
+                "2017-09-07T22:42:28.123Z,Inbound,Deny,,,,,,,TCP,,,,,,,,,1000000,3,2017-09-07T22:42:30.623Z\r\n";
+
+            std::string buffer;
+            Utf8EventData utf8EventData;
+            EventFormatter::ConvertToUtf8(eventData, utf8EventData);
+            EventFormatter::FormatCsv(utf8EventData, buffer);
+            Logger::WriteMessage(buffer.c_str());
+
+            Assert::IsTrue(buffer == expected);
+
+            std::string header;
+            EventFormatter::FormatCsvHeader(header, true);
+            Assert::IsTrue(header.find(",gftFlags,count,synCount,lastTime\r\n") != std::string::npos);
+        }
+    };
+}
\ No newline at end of file
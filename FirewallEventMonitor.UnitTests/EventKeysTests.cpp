@@ -0,0 +1,92 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "EventKeys.h"
+// c++ headers
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(EventKeysTests)
+    {
+    public:
+
+        TEST_METHOD(ParseKeys)
+        {
+            Logger::WriteMessage(L"ParseKeys");
+
+            EventKey ipv4;
+            EventKey mapped;
+            Assert::IsTrue(EventKeys::ParseAddress(L"192.168.100.21", &ipv4));
+            Assert::IsTrue(EventKeys::ParseAddress(L"::ffff:192.168.100.21", &mapped));
+            Assert::IsTrue(EventKeys::Equal(ipv4, mapped));
+
+            EventKey key;
+            Assert::IsTrue(EventKeys::ParseAddress(L"fe80::1", &key));
+            Assert::IsFalse(EventKeys::ParseAddress(L"", &key));
+            Assert::IsFalse(EventKeys::ParseAddress(L"NULL", &key));
+
+            Assert::IsTrue(EventKeys::ParseNumber(L"443", &key));
+            Assert::IsFalse(EventKeys::ParseNumber(L"", &key));
+            Assert::IsFalse(EventKeys::ParseNumber(L"44a", &key));
+            Assert::IsFalse(EventKeys::ParseNumber(L"12345678901234567890", &key));
+
+            Assert::IsTrue(EventKeys::ParseRuleId(L"{43CFF06E-A520-4AD3-9FD9-1894F4A3489B}", &key));
+            Assert::IsFalse(EventKeys::ParseRuleId(L"rule", &key));
+        }
+
+        TEST_METHOD(ParseMarksEachField)
+        {
+            Logger::WriteMessage(L"ParseMarksEachField");
+
+            VfpEventData eventData;
+            eventData.source = L"192.168.100.21";
+            eventData.destination = L"NULL";
+            eventData.destinationPort = L"443";
+            eventData.ruleId = L"43cff06e-a520-4ad3-9fd9-1894f4a3489b";
+
+            EventKeys eventKeys;
+            eventKeys.Parse(eventData);
+            Assert::IsTrue(eventKeys.parsed[EventKeys::SourceAddress]);
+            Assert::IsFalse(eventKeys.parsed[EventKeys::DestinationAddress]);
+            Assert::IsTrue(eventKeys.parsed[EventKeys::DestinationPort]);
+            Assert::IsTrue(eventKeys.parsed[EventKeys::RuleId]);
+            Assert::IsFalse(eventKeys.parsed[EventKeys::PortId]);
+            Assert::AreEqual(EventKeys::Hash(eventKeys.keys[EventKeys::SourceAddress]), eventKeys.hashes[EventKeys::SourceAddress]);
+
+            std::string text;
+            EventKeys::AppendKey(EventKeys::SourceAddress, eventKeys.keys[EventKeys::SourceAddress], text);
+            text.push_back(' ');
+            EventKeys::AppendKey(EventKeys::DestinationPort, eventKeys.keys[EventKeys::DestinationPort], text);
+            text.push_back(' ');
+            EventKeys::AppendKey(EventKeys::RuleId, eventKeys.keys[EventKeys::RuleId], text);
+            Assert::IsTrue(text == "192.168.100.21 443 43cff06e-a520-4ad3-9fd9-1894f4a3489b");
+        }
+
+        TEST_METHOD(HashSpreadsAdjacentAddresses)
+        {
+            Logger::WriteMessage(L"HashSpreadsAdjacentAddresses");
+
+            // HyperLogLog indexes by the top bits, so neighbouring addresses must not share them.
+            const size_t buckets = 64;
+            size_t counts[buckets] = {};
+            for (unsigned int i = 0; i < 64 * 256; ++i)
+            {
+                std::wstring address = L"10.0." + std::to_wstring(i / 256) + L"." + std::to_wstring(i % 256);
+                EventKey key;
+                Assert::IsTrue(EventKeys::ParseAddress(address, &key));
+                ++counts[EventKeys::Hash(key) >> 58];
+            }
+
+            for (const auto count : counts)
+            {
+                Assert::IsTrue(count > 192 && count < 320);
+            }
+        }
+    };
+}
\ No newline at end of file
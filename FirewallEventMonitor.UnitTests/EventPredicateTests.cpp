@@ -0,0 +1,118 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "EventPredicate.h"
+#include "UserInput.h"
+// c++ headers
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(EventPredicateTests)
+    {
+    public:
+
+        TEST_METHOD(EmptyPredicateMatchesEverything)
+        {
+            Logger::WriteMessage(L"EmptyPredicateMatchesEverything");
+
+            Parameters parameters;
+            EventPredicate predicate(parameters, 0);
+
+            Assert::IsTrue(predicate.Matches(MakeEvent(L"TCP", L"Allow", L"49152", L"443")));
+            Assert::IsTrue(predicate.Matches(MakeEvent(L"ICMPv4", L"Deny", L"", L"")));
+        }
+
+        TEST_METHOD(AddressAndRuleFiltersMatchLikeCapture)
+        {
+            Logger::WriteMessage(L"AddressAndRuleFiltersMatchLikeCapture");
+
+            Parameters parameters;
+            parameters.ipAddressFilters.push_back(L"10.0.0.1");
+            parameters.ruleIdFilters.push_back(RuleA);
+            EventPredicate predicate(parameters, 0);
+
+            VfpEventData eventData = MakeEvent(L"TCP", L"Allow", L"49152", L"443");
+            Assert::IsTrue(predicate.Matches(eventData));
+
+            // Either address may match.
+            std::swap(eventData.source, eventData.destination);
+            Assert::IsTrue(predicate.Matches(eventData));
+
+            eventData.destination = L"10.0.0.2";
+            Assert::IsFalse(predicate.Matches(eventData));
+
+            eventData = MakeEvent(L"TCP", L"Allow", L"49152", L"443");
+            eventData.ruleId = L"0b5a3c2e-8f47-4d21-9c1b-77e6a0d4f5c3";
+            Assert::IsFalse(predicate.Matches(eventData));
+        }
+
+        TEST_METHOD(PortActionProtocolAndTimeFilters)
+        {
+            Logger::WriteMessage(L"PortActionProtocolAndTimeFilters");
+
+            Parameters parameters;
+            parameters.portFilters.push_back(L"443");
+            parameters.portFilters.push_back(L"3389");
+            parameters.actionFilter = L"Deny";
+            parameters.protocolFilters.push_back(L"TCP");
+            parameters.protocolFilters.push_back(L"UDP");
+            EventPredicate predicate(parameters, BaseTimeStamp);
+
+            Assert::IsTrue(predicate.Matches(MakeEvent(L"TCP", L"Deny", L"49152", L"443")));
+            // Either port may match.
+            Assert::IsTrue(predicate.Matches(MakeEvent(L"UDP", L"Deny", L"3389", L"49152")));
+            Assert::IsFalse(predicate.Matches(MakeEvent(L"TCP", L"Deny", L"49152", L"80")));
+            Assert::IsFalse(predicate.Matches(MakeEvent(L"TCP", L"Allow", L"49152", L"443")));
+            Assert::IsFalse(predicate.Matches(MakeEvent(L"GRE", L"Deny", L"49152", L"443")));
+
+            // Protocols compare without case.
+            Assert::IsTrue(predicate.Matches(MakeEvent(L"tcp", L"Deny", L"49152", L"443")));
+
+            // Portless events never pass a port filter.
+            Parameters icmpParameters;
+            icmpParameters.portFilters.push_back(L"0");
+            EventPredicate icmpPredicate(icmpParameters, 0);
+            Assert::IsFalse(icmpPredicate.Matches(MakeEvent(L"ICMPv4", L"Deny", L"", L"")));
+
+            VfpEventData eventData = MakeEvent(L"TCP", L"Deny", L"49152", L"443");
+            eventData.timeStamp = BaseTimeStamp - 1;
+            Assert::IsFalse(predicate.Matches(eventData));
+
+            // A flow record matches while any of its events are recent enough.
+            eventData.eventCount = 2;
+            eventData.lastTimeStamp = BaseTimeStamp;
+            Assert::IsTrue(predicate.Matches(eventData));
+        }
+
+    private:
+        // 2017-09-14 22:42:28 UTC
+        const LONGLONG BaseTimeStamp = 131499025480000000;
+        const std::wstring RuleA = L"43cff06e-a520-4ad3-9fd9-1894f4a3489b";
+
+        VfpEventData MakeEvent(
+            const std::wstring& protocol,
+            const std::wstring& ruleType,
+            const std::wstring& sourcePort,
+            const std::wstring& destinationPort) const
+        {
+            VfpEventData eventData;
+            eventData.timeStamp = BaseTimeStamp;
+            eventData.direction = L"Inbound";
+            eventData.ruleType = ruleType;
+            eventData.portId = L"4";
+            eventData.source = L"10.0.0.1";
+            eventData.destination = L"192.168.1.1";
+            eventData.protocol = protocol;
+            eventData.sourcePort = sourcePort;
+            eventData.destinationPort = destinationPort;
+            eventData.ruleId = RuleA;
+            return eventData;
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,197 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "BinaryLogger.h"
+#include "BinaryLogReader.h"
+#include "EventReplayer.h"
+#include "FirewallCaptureSession.h"
+// c++ headers
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(EventReplayerTests)
+    {
+    public:
+
+        TEST_METHOD(OffsetScalesWithSpeed)
+        {
+            Logger::WriteMessage(L"OffsetScalesWithSpeed");
+
+            const LONGLONG first = 131500000000000000;
+            const LONGLONG tenSeconds = 100000000;
+
+            Assert::AreEqual(tenSeconds, EventReplayer::GetReplayOffset(first + tenSeconds, first, 1.0));
+            Assert::AreEqual(tenSeconds / 4, EventReplayer::GetReplayOffset(first + tenSeconds, first, 4.0));
+            Assert::AreEqual(tenSeconds * 2, EventReplayer::GetReplayOffset(first + tenSeconds, first, 0.5));
+
+            // Out of order events are due straight away, as is everything at the maximum speed.
+            Assert::AreEqual(0ll, EventReplayer::GetReplayOffset(first - tenSeconds, first, 1.0));
+            Assert::AreEqual(0ll, EventReplayer::GetReplayOffset(first + tenSeconds, first, 0.0));
+        }
+
+        TEST_METHOD(ReplaysBinaryLogAtItsSpacing)
+        {
+            Logger::WriteMessage(L"ReplaysBinaryLogAtItsSpacing");
+
+            // Five events a second apart, replayed twenty times faster.
+            std::vector<LONGLONG> timeStamps = WriteLog(L"EventReplayerInput.bin", 5);
+            const double speed = 20.0;
+
+            FILETIME fileTime;
+            ::GetSystemTimeAsFileTime(&fileTime);
+            ULARGE_INTEGER beforeStart;
+            beforeStart.LowPart = fileTime.dwLowDateTime;
+            beforeStart.HighPart = fileTime.dwHighDateTime;
+
+            auto outputLogger = std::make_shared<BinaryLogger>(L"");
+            EventReplayResults results = Replay(L"EventReplayerInput.bin", speed, 10000, std::make_shared<Timer>(0, true), outputLogger);
+
+            Assert::AreEqual(5ull, results.eventsRead);
+            Assert::AreEqual(0ull, results.eventsDropped);
+            // The last event is due 4 seconds / 20 after the first; less than a millisecond early is on time.
+            Assert::IsTrue(results.elapsedInSeconds >= 0.199);
+
+            // Delivered in order, stamped with the time they were due.
+            std::vector<VfpEventData> delivered = ReadLog(outputLogger->GetLogFilePath());
+            Assert::AreEqual(timeStamps.size(), delivered.size());
+            Assert::IsTrue(delivered[0].timeStamp >= static_cast<LONGLONG>(beforeStart.QuadPart));
+            for (size_t i = 0; i < delivered.size(); ++i)
+            {
+                Assert::AreEqual(L"10.0.0." + std::to_wstring(i + 1), delivered[i].source);
+                Assert::AreEqual(
+                    EventReplayer::GetReplayOffset(timeStamps[i], timeStamps[0], speed),
+                    delivered[i].timeStamp - delivered[0].timeStamp);
+            }
+
+            ::DeleteFileW(outputLogger->GetLogFilePath().c_str());
+            ::DeleteFileW(L"EventReplayerInput.bin");
+        }
+
+        TEST_METHOD(ReplayStopsAtThrottleAndTimeLimit)
+        {
+            Logger::WriteMessage(L"ReplayStopsAtThrottleAndTimeLimit");
+
+            WriteLog(L"EventReplayerInput.bin", 5);
+
+            // Only two events fit in the epoch, which nothing resets during the replay.
+            auto throttledLogger = std::make_shared<BinaryLogger>(L"");
+            EventReplayResults results = Replay(L"EventReplayerInput.bin", 0.0, 2, std::make_shared<Timer>(0, true), throttledLogger);
+            Assert::AreEqual(5ull, results.eventsRead);
+            Assert::AreEqual(3ull, results.eventsDropped);
+            Assert::AreEqual(static_cast<size_t>(2), ReadLog(throttledLogger->GetLogFilePath()).size());
+            ::DeleteFileW(throttledLogger->GetLogFilePath().c_str());
+
+            // A time limit of zero has passed before the first event.
+            auto timedOutLogger = std::make_shared<BinaryLogger>(L"");
+            results = Replay(L"EventReplayerInput.bin", 0.0, 10000, std::make_shared<Timer>(0), timedOutLogger);
+            Assert::AreEqual(5ull, results.eventsRead);
+            Assert::AreEqual(5ull, results.eventsDropped);
+            Assert::AreEqual(static_cast<size_t>(0), ReadLog(timedOutLogger->GetLogFilePath()).size());
+            ::DeleteFileW(timedOutLogger->GetLogFilePath().c_str());
+
+            ::DeleteFileW(L"EventReplayerInput.bin");
+        }
+
+        TEST_METHOD(ReplaysSavedCaptureRecords)
+        {
+            Logger::WriteMessage(L"ReplaysSavedCaptureRecords");
+
+            auto outputLogger = std::make_shared<BinaryLogger>(L"");
+            EventReplayResults results = Replay(L"..\\..\\..\\TestTraceSession.etl", 0.0, 10000, std::make_shared<Timer>(0, true), outputLogger);
+
+            // Every rule match record reaches the callback, decoded from the stamped copy.
+            Assert::IsTrue(results.eventsRead > 0);
+            Assert::AreEqual(0ull, results.eventsDropped);
+            std::vector<VfpEventData> delivered = ReadLog(outputLogger->GetLogFilePath());
+            Assert::AreEqual(static_cast<size_t>(results.eventsRead), delivered.size());
+            for (size_t i = 1; i < delivered.size(); ++i)
+            {
+                Assert::IsTrue(delivered[i].timeStamp >= delivered[i - 1].timeStamp);
+            }
+
+            ::DeleteFileW(outputLogger->GetLogFilePath().c_str());
+        }
+
+    private:
+        // Writes eventCount events a second apart and returns their time stamps.
+        static std::vector<LONGLONG> WriteLog(
+            const std::wstring& filePath,
+            int eventCount)
+        {
+            VfpEventData eventData;
+            eventData.direction = L"Inbound";
+            eventData.ruleType = L"Allow";
+            eventData.destination = L"192.168.100.22";
+            eventData.protocol = L"TCP";
+
+            std::vector<LONGLONG> timeStamps;
+            BinaryLogger binaryLogger(L"");
+            binaryLogger.CreateLogFile();
+            for (int i = 0; i < eventCount; ++i)
+            {
+                // 2017-09-14 22:42:28 UTC onwards.
+                eventData.timeStamp = 131499025480000000 + i * 10000000ll;
+                eventData.source = L"10.0.0." + std::to_wstring(i + 1);
+                binaryLogger.WriteEvent(eventData);
+                timeStamps.push_back(eventData.timeStamp);
+            }
+            binaryLogger.CloseLogFile();
+
+            Assert::IsTrue(::MoveFileExW(binaryLogger.GetLogFilePath().c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE);
+            return timeStamps;
+        }
+
+        // Replays filePath through a callback that writes what it is given to outputLogger.
+        static EventReplayResults Replay(
+            const std::wstring& filePath,
+            double speed,
+            unsigned long maxEventsPerEpoc,
+            const std::shared_ptr<Timer>& timer,
+            const std::shared_ptr<BinaryLogger>& outputLogger)
+        {
+            Parameters parameters;
+            parameters.outputToConsole = false;
+            parameters.outputToBinaryFile = true;
+
+            CallbackDependencies dependencies;
+            dependencies.binaryLogger = outputLogger;
+            dependencies.timer = timer;
+            dependencies.eventCounter = std::make_shared<EventCounter>(maxEventsPerEpoc);
+            // Records from a saved capture are only decoded while the session is open.
+            auto session = std::make_shared<FirewallCaptureSession>(parameters);
+            FirewallEtwTraceCallback callback(std::weak_ptr<FirewallCaptureSession>(session), parameters, dependencies);
+
+            outputLogger->CreateLogFile();
+            EventReplayer replayer(filePath, speed, callback);
+            replayer.Start();
+            while (!replayer.IsFinished())
+            {
+                ::Sleep(1);
+            }
+            replayer.Stop();
+            outputLogger->CloseLogFile();
+
+            return replayer.GetResults();
+        }
+
+        static std::vector<VfpEventData> ReadLog(const std::wstring& filePath)
+        {
+            std::vector<VfpEventData> events;
+            BinaryLogReader reader(filePath);
+            VfpEventData eventData;
+            while (reader.ReadNext(&eventData))
+            {
+                events.push_back(eventData);
+            }
+            return events;
+        }
+    };
+}
\ No newline at end of file
@@ -7,6 +7,8 @@
 // c++ headers
 #include <memory>
 #include <fstream>
+#include <string>
+#include <vector>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace FirewallEventMonitor;
@@ -55,6 +57,193 @@ namespace FirewallEventMonitorUnitTest
             Assert::IsTrue(foundLogFile);
         }
 
+        TEST_METHOD(LogFileWritesAreBufferedUntilFlush)
+        {
+            Logger::WriteMessage(L"LogFileWritesAreBufferedUntilFlush");
+
+            std::string line = "buffered line\r\n";
+
+            m_FileLogger->CreateLogFile();
+            m_FileLogger->Write(line.data(), line.size());
+
+            std::ifstream beforeFlush(m_FileLogger->GetLogFilePath(), std::ios::binary | std::ios::ate);
+            Assert::IsTrue(beforeFlush.tellg() == std::streampos(0));
+            beforeFlush.close();
+
+            m_FileLogger->Flush();
+
+            std::ifstream afterFlush(m_FileLogger->GetLogFilePath(), std::ios::binary | std::ios::ate);
+            Assert::IsTrue(afterFlush.tellg() == static_cast<std::streampos>(line.size()));
+            afterFlush.close();
+
+            m_FileLogger->CloseLogFile();
+        }
+
+        TEST_METHOD(LogFileRotatesAtSizeLimit)
+        {
+            Logger::WriteMessage(L"LogFileRotatesAtSizeLimit");
+
+            LogRotationPolicy policy;
+            policy.maxFileSizeInBytes = 64;
+            policy.maxFileAgeInSeconds = 0;
+            FileLogger fileLogger(L"", L".log", false, policy);
+
+            std::string line(48, 'x');
+
+            fileLogger.CreateLogFile();
+            fileLogger.Write(line.data(), line.size());
+            Assert::IsFalse(fileLogger.RotateIfDue());
+
+            // Pre-opens the next file; rotation renames it.
+            fileLogger.MaintenanceCheck();
+            std::wstring firstFilePath = fileLogger.GetLogFilePath();
+            fileLogger.Write(line.data(), line.size());
+            Assert::IsTrue(fileLogger.RotateIfDue());
+            Assert::IsTrue(firstFilePath != fileLogger.GetLogFilePath());
+
+            // Both writes went whole to the first file.
+            fileLogger.MaintenanceCheck();
+            std::ifstream firstFile(firstFilePath, std::ios::binary | std::ios::ate);
+            Assert::IsTrue(firstFile.tellg() == static_cast<std::streampos>(2 * line.size()));
+            firstFile.close();
+
+            fileLogger.CloseLogFile();
+        }
+
+        TEST_METHOD(LogFileSwitchLeavesFileSystemWorkToFinishRotation)
+        {
+            Logger::WriteMessage(L"LogFileSwitchLeavesFileSystemWorkToFinishRotation");
+
+            // A directory of its own, so no earlier test's file already has the new file's name.
+            std::wstring directory = m_FileLogger->GetLogDirectory() + L"\\LogSwitchTest";
+            ::CreateDirectoryW(directory.c_str(), NULL);
+
+            LogRotationPolicy policy;
+            policy.maxFileSizeInBytes = 64;
+            policy.maxFileAgeInSeconds = 0;
+            FileLogger fileLogger(directory, L".log", false, policy);
+
+            std::string line(48, 'x');
+            std::string nextLine(16, 'y');
+
+            fileLogger.CreateLogFile();
+            fileLogger.MaintenanceCheck();
+            std::wstring firstFilePath = fileLogger.GetLogFilePath();
+            fileLogger.Write(line.data(), line.size());
+            fileLogger.Write(line.data(), line.size());
+
+            // The switch neither writes out the old file nor names the new one.
+            Assert::IsTrue(fileLogger.SwitchLogFileIfDue());
+            std::wstring secondFilePath = fileLogger.GetLogFilePath();
+            Assert::IsTrue(firstFilePath != secondFilePath);
+            Assert::IsTrue(::GetFileAttributesW(secondFilePath.c_str()) == INVALID_FILE_ATTRIBUTES);
+            std::ifstream beforeFinish(firstFilePath, std::ios::binary | std::ios::ate);
+            Assert::IsTrue(beforeFinish.tellg() == std::streampos(0));
+            beforeFinish.close();
+
+            // Writes after the switch go to the new file only.
+            fileLogger.Write(nextLine.data(), nextLine.size());
+            fileLogger.FinishRotation();
+            Assert::IsTrue(::GetFileAttributesW(secondFilePath.c_str()) != INVALID_FILE_ATTRIBUTES);
+            std::ifstream afterFinish(firstFilePath, std::ios::binary | std::ios::ate);
+            Assert::IsTrue(afterFinish.tellg() == static_cast<std::streampos>(2 * line.size()));
+            afterFinish.close();
+
+            fileLogger.CloseLogFile();
+            std::ifstream secondFile(secondFilePath, std::ios::binary | std::ios::ate);
+            Assert::IsTrue(secondFile.tellg() == static_cast<std::streampos>(nextLine.size()));
+            secondFile.close();
+
+            ::DeleteFileW(firstFilePath.c_str());
+            ::DeleteFileW(secondFilePath.c_str());
+        }
+
+        TEST_METHOD(LogRetentionDeletesOldestFiles)
+        {
+            Logger::WriteMessage(L"LogRetentionDeletesOldestFiles");
+
+            std::wstring directory = m_FileLogger->GetLogDirectory() + L"\\LogRetentionTest";
+            ::CreateDirectoryW(directory.c_str(), NULL);
+
+            LogRotationPolicy policy;
+            policy.maxFileSizeInBytes = 100;
+            policy.maxFileAgeInSeconds = 0;
+            policy.maxTotalSizeInBytes = 250;
+            FileLogger fileLogger(directory, L".log", false, policy);
+
+            std::string data(150, 'x');
+            std::vector<std::wstring> filePaths;
+
+            fileLogger.CreateLogFile();
+            for (int i = 0; i < 4; ++i)
+            {
+                filePaths.push_back(fileLogger.GetLogFilePath());
+                fileLogger.Write(data.data(), data.size());
+                fileLogger.MaintenanceCheck();
+                Assert::IsTrue(fileLogger.RotateIfDue());
+            }
+            fileLogger.CloseLogFile();
+
+            // 150 bytes each against a 250 byte quota: only the newest full file survives.
+            for (size_t i = 0; i < filePaths.size(); ++i)
+            {
+                bool exists = ::GetFileAttributesW(filePaths[i].c_str()) != INVALID_FILE_ATTRIBUTES;
+                Assert::AreEqual(i == filePaths.size() - 1, exists);
+                ::DeleteFileW(filePaths[i].c_str());
+            }
+            ::DeleteFileW(fileLogger.GetLogFilePath().c_str());
+        }
+
+        TEST_METHOD(LogRetentionKeepsOtherWritersFiles)
+        {
+            Logger::WriteMessage(L"LogRetentionKeepsOtherWritersFiles");
+
+            std::wstring directory = m_FileLogger->GetLogDirectory() + L"\\LogRetentionForeignTest";
+            ::CreateDirectoryW(directory.c_str(), NULL);
+
+            // Older than any of the logger's files and sharing its extension.
+            std::vector<std::wstring> foreignFilePaths;
+            foreignFilePaths.push_back(directory + L"\\FirewallEventMonitor.rates.csv");
+            foreignFilePaths.push_back(directory + L"\\FirewallEventMonitor.20170914T224228.rules.csv");
+            for (const auto& foreignFilePath : foreignFilePaths)
+            {
+                std::ofstream foreignFile(foreignFilePath, std::ios::binary);
+                foreignFile << std::string(200, 'r');
+            }
+
+            LogRotationPolicy policy;
+            policy.maxFileSizeInBytes = 100;
+            policy.maxFileAgeInSeconds = 0;
+            policy.maxTotalSizeInBytes = 250;
+            FileLogger fileLogger(directory, L".csv", false, policy);
+
+            std::string data(150, 'x');
+            std::vector<std::wstring> filePaths;
+
+            fileLogger.CreateLogFile();
+            for (int i = 0; i < 3; ++i)
+            {
+                filePaths.push_back(fileLogger.GetLogFilePath());
+                fileLogger.Write(data.data(), data.size());
+                fileLogger.MaintenanceCheck();
+                Assert::IsTrue(fileLogger.RotateIfDue());
+            }
+            fileLogger.CloseLogFile();
+
+            // The logger pruned its own files only.
+            Assert::IsTrue(::GetFileAttributesW(filePaths[0].c_str()) == INVALID_FILE_ATTRIBUTES);
+            for (const auto& foreignFilePath : foreignFilePaths)
+            {
+                Assert::IsTrue(::GetFileAttributesW(foreignFilePath.c_str()) != INVALID_FILE_ATTRIBUTES);
+                ::DeleteFileW(foreignFilePath.c_str());
+            }
+            for (const auto& filePath : filePaths)
+            {
+                ::DeleteFileW(filePath.c_str());
+            }
+            ::DeleteFileW(fileLogger.GetLogFilePath().c_str());
+        }
+
     private:
         std::shared_ptr<FileLogger> m_FileLogger;
     };
@@ -4,8 +4,10 @@
 #include <CppUnitTest.h>
 // code under test headers
 #include "FirewallCaptureSession.h"
+#include "MemoryEventSource.h"
 // c++ headers
 #include <memory>
+#include <vector>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace FirewallEventMonitor;
@@ -21,74 +23,47 @@ namespace FirewallEventMonitorUnitTest
             m_Params.outputToConsole = false;
         }
 
-        TEST_METHOD(EmptyFilterListMatchesAnyAddress)
+        TEST_METHOD(RunsOnAnyEventSource)
         {
-            Logger::WriteMessage(L"EmptyFilterListMatchesAnyAddress");
-
-            m_Params.ipAddressFilters.clear();
-            FirewallCaptureSession reader(m_Params);
-            bool result = reader.MatchIpAddressFilter(correctAddress);
-
-            Assert::IsTrue(result);
-        }
-
-        TEST_METHOD(FilterMatchesCorrectAddress)
-        {
-            Logger::WriteMessage(L"FilterMatchesCorrectAddress");
+            Logger::WriteMessage(L"RunsOnAnyEventSource");
 
             m_Params.ipAddressFilters.clear();
             m_Params.ipAddressFilters.push_back(correctAddress);
-            FirewallCaptureSession reader(m_Params);
-            bool result = reader.MatchIpAddressFilter(correctAddress);
-
-            Assert::IsTrue(result);
-        }
-
-        TEST_METHOD(FilterDropsIncorrectAddress)
-        {
-            Logger::WriteMessage(L"FilterDropsIncorrectAddress");
-
-            m_Params.ipAddressFilters.clear();
-            m_Params.ipAddressFilters.push_back(correctAddress);
-            FirewallCaptureSession reader(m_Params);
-            bool result = reader.MatchIpAddressFilter(incorrectAddress);
-
-            Assert::IsFalse(result);
-        }
-
-        TEST_METHOD(EmptyFilterListMatchesAnyRule)
-        {
-            Logger::WriteMessage(L"EmptyFilterListMatchesAnyRule");
-
-            m_Params.ruleIdFilters.clear();
-            FirewallCaptureSession reader(m_Params);
-            bool result = reader.MatchRuleIdFilter(correctRuleId);
-
-            Assert::IsTrue(result);
-        }
-
-        TEST_METHOD(FilterMatchesCorrectRule)
-        {
-            Logger::WriteMessage(L"FilterMatchesCorrectRule");
-
-            m_Params.ruleIdFilters.clear();
-            m_Params.ruleIdFilters.push_back(correctRuleId);
-            FirewallCaptureSession reader(m_Params);
-            bool result = reader.MatchRuleIdFilter(correctRuleId);
-
-            Assert::IsTrue(result);
-        }
-
-        TEST_METHOD(FilterDropsIncorrectRule)
-        {
-            Logger::WriteMessage(L"FilterDropsIncorrectRule");
-
-            m_Params.ruleIdFilters.clear();
-            m_Params.ruleIdFilters.push_back(correctRuleId);
-            FirewallCaptureSession reader(m_Params);
-            bool result = reader.MatchRuleIdFilter(incorrectRuleId);
-
-            Assert::IsFalse(result);
+            std::vector<VfpEventData> events(2);
+            events[0].source = correctAddress;
+            events[0].destination = incorrectAddress;
+            events[1].source = incorrectAddress;
+            events[1].destination = incorrectAddress;
+
+            auto timer = std::make_shared<Timer>(m_Params.maxRuntimeInSeconds, true);
+            auto eventCounter = std::make_shared<EventCounter>(m_Params.maxEventsPerEpoc);
+            MemoryEventSource* memorySource = nullptr;
+            FirewallCaptureSession session(
+                m_Params,
+                std::make_shared<FileLogger>(L""),
+                std::make_shared<BinaryLogger>(L""),
+                std::make_shared<FileLogger>(L"", L".jsonl"),
+                std::make_shared<FileLogger>(L"", L".csv"),
+                timer,
+                eventCounter,
+                [&](const FirewallEtwTraceCallback& callback)
+                {
+                    auto source = std::make_unique<MemoryEventSource>(events, 50, callback, eventCounter, timer);
+                    memorySource = source.get();
+                    return std::unique_ptr<EventSource>(std::move(source));
+                });
+
+            session.OpenSession();
+            while (session.CaptureSessionRunning())
+            {
+                ::Sleep(1);
+            }
+            session.CloseSession();
+
+            Assert::AreEqual(100ull, memorySource->GetResults().eventsDelivered);
+            // The filters (see EventPredicateTests) run behind the source: only the events from the
+            // filtered address count.
+            Assert::AreEqual(50ul, eventCounter->GetEventCountTotal());
         }
 
     private:
@@ -96,8 +71,5 @@ namespace FirewallEventMonitorUnitTest
 
         std::wstring correctAddress = L"100.100.100.100";
         std::wstring incorrectAddress = L"200.200.200.200";
-
-        std::wstring correctRuleId = L"29959cda-8d97-48ea-92ce-4c0164aac7f4";
-        std::wstring incorrectRuleId = L"1bd92312-2f5d-447b-b2b3-90edc728b374";
     };
 }
\ No newline at end of file
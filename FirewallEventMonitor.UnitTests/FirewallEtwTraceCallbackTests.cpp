@@ -4,15 +4,56 @@
 #include <CppUnitTest.h>
 // code under test headers
 #include "FirewallCaptureSession.h"
+#include "EventFormatter.h"
 // c++ headers
+#include <algorithm>
 #include <memory>
 #include <fstream>
+#include <string>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace FirewallEventMonitor;
 
 namespace FirewallEventMonitorUnitTest
 {
+    // The allocations counted while the live path handled one record over and over.
+    struct RepeatedRecordResults
+    {
+        bool handled = false;
+        unsigned long long warmUpAllocations = 0;
+        unsigned long long allocationsOnceWarm = 0;
+    };
+
+    // Hands the first rule match record of a saved capture to the callback's operator(), as ETW
+    // would: once to warm the callback's reused record and event, then ten times more.
+    struct RepeatedRecordHandler
+    {
+        FirewallEtwTraceCallback* callback;
+        LatencyMonitor* latencyMonitor;
+        RepeatedRecordResults* results;
+
+        bool operator()(const PEVENT_RECORD pEventRecord)
+        {
+            if (results->handled ||
+                !FirewallEtwTraceCallback::IsRuleMatchEvent(pEventRecord->EventHeader.EventDescriptor.Id))
+            {
+                return false;
+            }
+            results->handled = true;
+
+            (*callback)(pEventRecord);
+            results->warmUpAllocations = latencyMonitor->GetAllocationCount(LatencyMonitor::Total);
+            for (int i = 0; i < 10; ++i)
+            {
+                (*callback)(pEventRecord);
+            }
+            results->allocationsOnceWarm = latencyMonitor->GetAllocationCount(LatencyMonitor::Total) - results->warmUpAllocations;
+
+            // The reader must not keep the record.
+            return false;
+        }
+    };
+
     TEST_CLASS(FirewallEtwTraceCallbackTests)
     {
     public:
@@ -27,13 +68,21 @@ namespace FirewallEventMonitorUnitTest
             m_EventCounter = std::make_shared<EventCounter>(10000);
             m_Timer = std::make_shared<Timer>(-1);
             m_FileLogger = std::make_shared<FileLogger>(L"");
+            m_BinaryLogger = std::make_shared<BinaryLogger>(L"");
+            m_JsonLogger = std::make_shared<FileLogger>(L"", L".jsonl");
+            m_CsvLogger = std::make_shared<FileLogger>(L"", L".csv");
             m_Reader = std::make_shared<FirewallCaptureSession>(m_Params);
+            m_Dependencies = CallbackDependencies{};
+            m_Dependencies.fileLogger = m_FileLogger;
+            m_Dependencies.binaryLogger = m_BinaryLogger;
+            m_Dependencies.jsonLogger = m_JsonLogger;
+            m_Dependencies.csvLogger = m_CsvLogger;
+            m_Dependencies.timer = m_Timer;
+            m_Dependencies.eventCounter = m_EventCounter;
             m_Callback = std::make_shared<FirewallEtwTraceCallback>(
                 std::weak_ptr<FirewallCaptureSession>(m_Reader),
                 m_Params,
-                m_FileLogger,
-                m_Timer,
-                m_EventCounter);
+                m_Dependencies);
 
             // Read EtwRecord from test file.
             std::wstring file = L"..\\..\\..\\TestTraceSession.etl";
@@ -68,7 +117,9 @@ namespace FirewallEventMonitorUnitTest
             out.open("test.txt");
 
             m_FileLogger->CreateLogFile();
-            m_Callback->OutputToFile(eventData);
+            Utf8EventData utf8EventData;
+            EventFormatter::ConvertToUtf8(eventData, utf8EventData);
+            m_Callback->OutputToFile(utf8EventData);
             m_FileLogger->CloseLogFile();
             
             // Search file for code
@@ -118,6 +169,64 @@ namespace FirewallEventMonitorUnitTest
             Assert::IsTrue(result);
         }
 
+        TEST_METHOD(ProcessEventRecordAllocatesNothingOnceWarm)
+        {
+            Logger::WriteMessage(L"ProcessEventRecordAllocatesNothingOnceWarm");
+
+            // Every output off, so only the event path itself is counted.
+            Parameters params;
+            params.outputToConsole = false;
+            auto latencyMonitor = std::make_shared<LatencyMonitor>();
+            CallbackDependencies dependencies = m_Dependencies;
+            dependencies.latencyMonitor = latencyMonitor;
+            FirewallEtwTraceCallback callback(
+                std::weak_ptr<FirewallCaptureSession>(m_Reader),
+                params,
+                dependencies);
+
+            // The first event grows the reused event's strings.
+            Assert::IsTrue(callback.ProcessEventRecord(m_testRecord));
+            unsigned long long warmUpAllocations = latencyMonitor->GetAllocationCount(LatencyMonitor::Total);
+            Assert::IsTrue(warmUpAllocations > 0);
+
+            for (int i = 0; i < 10; ++i)
+            {
+                Assert::IsTrue(callback.ProcessEventRecord(m_testRecord));
+            }
+            Assert::AreEqual(warmUpAllocations, latencyMonitor->GetAllocationCount(LatencyMonitor::Total));
+            // All of them decoding the first event.
+            Assert::AreEqual(warmUpAllocations, latencyMonitor->GetAllocationCount(LatencyMonitor::Collect));
+        }
+
+        TEST_METHOD(LiveRecordsAllocateNothingOnceWarm)
+        {
+            Logger::WriteMessage(L"LiveRecordsAllocateNothingOnceWarm");
+
+            // Every output off, so only the event path itself is counted.
+            Parameters params;
+            params.outputToConsole = false;
+            auto latencyMonitor = std::make_shared<LatencyMonitor>();
+            CallbackDependencies dependencies = m_Dependencies;
+            dependencies.latencyMonitor = latencyMonitor;
+            FirewallEtwTraceCallback callback(
+                std::weak_ptr<FirewallCaptureSession>(m_Reader),
+                params,
+                dependencies);
+
+            // operator() assigns each record to the callback's own EtwRecord, as it does live.
+            RepeatedRecordResults results;
+            RepeatedRecordHandler handler = { &callback, latencyMonitor.get(), &results };
+            {
+                ntl::EtwReader<RepeatedRecordHandler> reader(handler);
+                reader.OpenSavedSession(L"..\\..\\..\\TestTraceSession.etl");
+                reader.WaitForSession();
+            }
+
+            Assert::IsTrue(results.handled);
+            Assert::IsTrue(results.warmUpAllocations > 0);
+            Assert::AreEqual(0ull, results.allocationsOnceWarm);
+        }
+
         TEST_METHOD(ProcessEventRecordFiltersEventId)
         {
             Logger::WriteMessage(L"ProcessEventRecordFiltersEventId");
@@ -138,11 +247,139 @@ namespace FirewallEventMonitorUnitTest
             Assert::IsFalse(result);
         }
 
+        TEST_METHOD(RecordsAndDecodedEventsCountTheSameStages)
+        {
+            Logger::WriteMessage(L"RecordsAndDecodedEventsCountTheSameStages");
+
+            Parameters params;
+            params.outputToConsole = false;
+            auto selfMetrics = std::make_shared<SelfMetrics>();
+            CallbackDependencies dependencies = m_Dependencies;
+            dependencies.selfMetrics = selfMetrics;
+            FirewallEtwTraceCallback callback(
+                std::weak_ptr<FirewallCaptureSession>(m_Reader),
+                params,
+                dependencies);
+
+            // A record, as a saved capture replays, then the same event decoded, as a binary log replays.
+            Assert::IsTrue(callback.ProcessEventRecord(m_testRecord));
+            VfpEventData eventData = callback.CollectEventData(m_testRecord);
+            Assert::IsTrue(callback.AdmitEvent());
+            Assert::IsTrue(callback.ProcessEventData(eventData));
+
+            Assert::AreEqual(2ull, selfMetrics->GetStageCount(SelfMetrics::Received));
+            Assert::AreEqual(2ull, selfMetrics->GetStageCount(SelfMetrics::RuleMatch));
+            Assert::AreEqual(2ull, selfMetrics->GetStageCount(SelfMetrics::Decoded));
+            Assert::AreEqual(2ull, selfMetrics->GetStageCount(SelfMetrics::PassedFilters));
+            Assert::AreEqual(2ull, selfMetrics->GetStageCount(SelfMetrics::Processed));
+
+            // A refused record was still received.
+            dependencies.eventCounter = std::make_shared<EventCounter>(0);
+            FirewallEtwTraceCallback throttledCallback(
+                std::weak_ptr<FirewallCaptureSession>(m_Reader),
+                params,
+                dependencies);
+            Assert::IsFalse(throttledCallback.ProcessEventRecord(m_testRecord));
+            Assert::AreEqual(3ull, selfMetrics->GetStageCount(SelfMetrics::Received));
+            Assert::AreEqual(2ull, selfMetrics->GetStageCount(SelfMetrics::RuleMatch));
+            Assert::AreEqual(1ull, selfMetrics->GetDropCount(SelfMetrics::Throttled));
+        }
+
+        TEST_METHOD(BurstEventsKeepTheFlowColumnsWhenAggregating)
+        {
+            Logger::WriteMessage(L"BurstEventsKeepTheFlowColumnsWhenAggregating");
+
+            Parameters params;
+            params.outputToConsole = false;
+            params.outputToCsvFile = true;
+            params.aggregateFlows = true;
+            CallbackDependencies dependencies = m_Dependencies;
+            dependencies.flowTable = std::make_shared<FlowTable>(60, 600);
+            dependencies.burstDetector = std::make_shared<BurstDetector>(4.0, 60);
+            FirewallEtwTraceCallback callback(
+                std::weak_ptr<FirewallCaptureSession>(m_Reader),
+                params,
+                dependencies);
+
+            VfpEventData eventData;
+            eventData.direction = L"Inbound";
+            eventData.ruleType = L"Deny";
+            eventData.portId = L"4";
+            eventData.source = L"10.0.0.1";
+            eventData.destination = L"10.0.0.2";
+            eventData.protocol = L"TCP";
+            eventData.sourcePort = L"50000";
+            eventData.destinationPort = L"443";
+            eventData.ruleId = L"11111111-1111-1111-1111-111111111111";
+
+            // A minute of one deny a second, all counted into one flow, then a burst whose
+            // events are written one by one.
+            const LONGLONG start = 13149295200LL * FlowTable::FileTimeTicksPerSecond;
+            m_CsvLogger->CreateLogFile();
+            for (LONGLONG second = 0; second < 60; ++second)
+            {
+                eventData.timeStamp = start + second * FlowTable::FileTimeTicksPerSecond;
+                Assert::IsTrue(callback.AdmitEvent());
+                Assert::IsTrue(callback.ProcessEventData(eventData));
+            }
+            for (LONGLONG i = 0; i < 100; ++i)
+            {
+                eventData.timeStamp = start + 60 * FlowTable::FileTimeTicksPerSecond + i * 1000;
+                Assert::IsTrue(callback.AdmitEvent());
+                Assert::IsTrue(callback.ProcessEventData(eventData));
+            }
+            m_CsvLogger->CloseLogFile();
+            Assert::IsTrue(dependencies.burstDetector->GetAlertCount() > 0);
+
+            // Every row has the 21 columns of the flow header, count included.
+            std::string header;
+            EventFormatter::FormatCsvHeader(header, true);
+            size_t headerColumns = std::count(header.begin(), header.end(), ',') + 1;
+            Assert::AreEqual(size_t(21), headerColumns);
+
+            std::ifstream csvFile(m_CsvLogger->GetLogFilePath(), std::ios::binary);
+            std::string line;
+            size_t rows = 0;
+            while (std::getline(csvFile, line))
+            {
+                Assert::AreEqual(headerColumns, static_cast<size_t>(std::count(line.begin(), line.end(), ',') + 1));
+                // A flow of one, without a SYN.
+                Assert::IsTrue(line.find(",1,0,") != std::string::npos);
+                ++rows;
+            }
+            Assert::IsTrue(rows > 0);
+        }
+
+        TEST_METHOD(TranslateNamesKnownNumbers)
+        {
+            Logger::WriteMessage(L"TranslateNamesKnownNumbers");
+
+            VfpEventData eventData;
+            FirewallEtwTraceCallback::TranslateDirection(L"1", eventData.direction);
+            FirewallEtwTraceCallback::TranslateRuleType(L"2", eventData.ruleType);
+            FirewallEtwTraceCallback::TranslateProtocol(L"17", eventData.protocol);
+            FirewallEtwTraceCallback::TranslateIcmpType(L"", eventData.icmpType);
+            Assert::AreEqual(std::wstring(L"Inbound"), eventData.direction);
+            Assert::AreEqual(std::wstring(L"Deny"), eventData.ruleType);
+            Assert::AreEqual(std::wstring(L"UDP"), eventData.protocol);
+            Assert::IsTrue(eventData.icmpType.empty());
+
+            // Unknown numbers leave the names as they were.
+            FirewallEtwTraceCallback::TranslateProtocol(L"99", eventData.protocol);
+            FirewallEtwTraceCallback::TranslateIcmpType(L"128", eventData.icmpType);
+            Assert::AreEqual(std::wstring(L"UDP"), eventData.protocol);
+            Assert::AreEqual(std::wstring(L"V6EchoRequest"), eventData.icmpType);
+        }
+
     private:
         Parameters m_Params;
         std::shared_ptr<Timer> m_Timer;
         std::shared_ptr<EventCounter> m_EventCounter;
         std::shared_ptr<FileLogger> m_FileLogger;
+        std::shared_ptr<BinaryLogger> m_BinaryLogger;
+        std::shared_ptr<FileLogger> m_JsonLogger;
+        std::shared_ptr<FileLogger> m_CsvLogger;
+        CallbackDependencies m_Dependencies;
         std::shared_ptr<FirewallCaptureSession> m_Reader;
         std::shared_ptr<FirewallEtwTraceCallback> m_Callback;
         
@@ -0,0 +1,253 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "FlowTable.h"
+// c++ headers
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    const LONGLONG StartTime = 131492977481230000LL; // 2017-09-07T22:42:28.123Z
+
+    TEST_CLASS(FlowTableTests)
+    {
+    public:
+
+        TEST_METHOD_INITIALIZE(MethodInit)
+        {
+            Logger::WriteMessage(L"MethodInit");
+
+            m_EventData = VfpEventData{};
+            m_EventData.timeStamp = StartTime;
+            m_EventData.direction = L"Inbound";
+            m_EventData.ruleType = L"Deny";
+            m_EventData.portId = L"4";
+            m_EventData.source = L"10.0.0.1";
+            m_EventData.destination = L"10.0.0.2";
+            m_EventData.protocol = L"TCP";
+            m_EventData.sourcePort = L"50000";
+            m_EventData.destinationPort = L"443";
+            m_EventData.isTcpSyn = L"1";
+            m_EventData.ruleId = L"43cff06e-a520-4ad3-9fd9-1894f4a3489b";
+        }
+
+        TEST_METHOD(IdenticalEventsBecomeOneFlow)
+        {
+            Logger::WriteMessage(L"IdenticalEventsBecomeOneFlow");
+
+            FlowTable flowTable(15, 300);
+            for (int i = 0; i < 1000000; ++i)
+            {
+                m_EventData.timeStamp = StartTime + i;
+                m_EventData.isTcpSyn = (i < 10) ? L"1" : L"0";
+                Assert::IsTrue(flowTable.AddEvent(m_EventData));
+            }
+            Assert::AreEqual(static_cast<size_t>(1), flowTable.GetFlowCount());
+
+            std::vector<VfpEventData> expired;
+            Assert::AreEqual(static_cast<size_t>(1), flowTable.ExpireAllFlows(expired));
+            Assert::AreEqual(0ull + 1000000, expired[0].eventCount);
+            Assert::AreEqual(0ull + 10, expired[0].synCount);
+            Assert::AreEqual(StartTime, expired[0].timeStamp);
+            Assert::AreEqual(StartTime + 999999, expired[0].lastTimeStamp);
+            Assert::AreEqual(static_cast<size_t>(0), flowTable.GetFlowCount());
+        }
+
+        TEST_METHOD(KeyFieldsSeparateFlows)
+        {
+            Logger::WriteMessage(L"KeyFieldsSeparateFlows");
+
+            // Enough flows to grow the slot array several times.
+            FlowTable flowTable(15, 300);
+            for (int port = 1; port <= 5000; ++port)
+            {
+                m_EventData.sourcePort = std::to_wstring(port);
+                Assert::IsTrue(flowTable.AddEvent(m_EventData));
+                Assert::IsTrue(flowTable.AddEvent(m_EventData));
+            }
+            Assert::AreEqual(static_cast<size_t>(5000), flowTable.GetFlowCount());
+
+            // Non-key fields do not start a new flow.
+            m_EventData.status = L"STATUS_SUCCESS";
+            m_EventData.gftFlags = L"1";
+            Assert::IsTrue(flowTable.AddEvent(m_EventData));
+            Assert::AreEqual(static_cast<size_t>(5000), flowTable.GetFlowCount());
+
+            std::vector<VfpEventData> expired;
+            flowTable.ExpireAllFlows(expired);
+            unsigned long long total = 0;
+            for (const auto& flow : expired)
+            {
+                total += flow.eventCount;
+            }
+            Assert::AreEqual(0ull + 10001, total);
+        }
+
+        TEST_METHOD(IdleAndActiveTimeoutsExpireFlows)
+        {
+            Logger::WriteMessage(L"IdleAndActiveTimeoutsExpireFlows");
+
+            const LONGLONG second = FlowTable::FileTimeTicksPerSecond;
+            FlowTable flowTable(15, 300);
+
+            // Idle: no events after the start.
+            m_EventData.destinationPort = L"80";
+            flowTable.AddEvent(m_EventData);
+
+            // Active: an event every 10 seconds, so never idle.
+            m_EventData.destinationPort = L"443";
+            for (LONGLONG t = 0; t <= 300; t += 10)
+            {
+                m_EventData.timeStamp = StartTime + t * second;
+                flowTable.AddEvent(m_EventData);
+            }
+
+            std::vector<VfpEventData> expired;
+            Assert::AreEqual(static_cast<size_t>(0), flowTable.ExpireFlows(StartTime + 14 * second, expired));
+
+            Assert::AreEqual(static_cast<size_t>(1), flowTable.ExpireFlows(StartTime + 15 * second, expired));
+            Assert::IsTrue(expired[0].destinationPort == L"80");
+
+            Assert::AreEqual(static_cast<size_t>(1), flowTable.ExpireFlows(StartTime + 300 * second, expired));
+            Assert::IsTrue(expired[1].destinationPort == L"443");
+            Assert::AreEqual(0ull + 31, expired[1].eventCount);
+            Assert::AreEqual(static_cast<size_t>(0), flowTable.GetFlowCount());
+
+            // Removed flows leave no holes in the probe runs: the flow can start again.
+            m_EventData.timeStamp = StartTime + 301 * second;
+            flowTable.AddEvent(m_EventData);
+            Assert::AreEqual(static_cast<size_t>(1), flowTable.GetFlowCount());
+        }
+
+        TEST_METHOD(FullTableRejectsNewFlows)
+        {
+            Logger::WriteMessage(L"FullTableRejectsNewFlows");
+
+            FlowTable flowTable(15, 300, 2);
+            m_EventData.sourcePort = L"1";
+            Assert::IsTrue(flowTable.AddEvent(m_EventData));
+            m_EventData.sourcePort = L"2";
+            Assert::IsTrue(flowTable.AddEvent(m_EventData));
+            m_EventData.sourcePort = L"3";
+            Assert::IsFalse(flowTable.AddEvent(m_EventData));
+
+            // Existing flows are still counted.
+            m_EventData.sourcePort = L"1";
+            Assert::IsTrue(flowTable.AddEvent(m_EventData));
+        }
+
+        TEST_METHOD(EveryKeyFieldSeparatesFlows)
+        {
+            Logger::WriteMessage(L"EveryKeyFieldSeparatesFlows");
+
+            FlowTable flowTable(15, 300);
+            Assert::IsTrue(flowTable.AddEvent(m_EventData));
+
+            const VfpEventData first = m_EventData;
+            std::wstring VfpEventData::* fields[] = {
+                &VfpEventData::direction,
+                &VfpEventData::ruleType,
+                &VfpEventData::portId,
+                &VfpEventData::source,
+                &VfpEventData::destination,
+                &VfpEventData::protocol,
+                &VfpEventData::sourcePort,
+                &VfpEventData::destinationPort,
+                &VfpEventData::ruleId };
+            const wchar_t* changed[] = {
+                L"Outbound",
+                L"Allow",
+                L"5",
+                L"::ffff:10.0.0.3",
+                L"fe80::1",
+                L"UDP",
+                L"50001",
+                L"",
+                L"{43CFF06E-A520-4AD3-9FD9-1894F4A3489C}" };
+
+            for (size_t i = 0; i < ARRAYSIZE(fields); ++i)
+            {
+                m_EventData = first;
+                m_EventData.*fields[i] = changed[i];
+                Assert::IsTrue(flowTable.AddEvent(m_EventData));
+                Assert::AreEqual(i + 2, flowTable.GetFlowCount());
+            }
+
+            // The record is the flow's first event, as it was added.
+            std::vector<VfpEventData> expired;
+            flowTable.ExpireAllFlows(expired);
+            Assert::IsTrue(expired[0].source == first.source);
+            Assert::IsTrue(expired[0].ruleId == first.ruleId);
+            Assert::IsTrue(expired[5].destination == L"fe80::1");
+            Assert::IsTrue(expired[8].destinationPort.empty());
+        }
+
+        TEST_METHOD(UnparsedKeysAreNotAggregated)
+        {
+            Logger::WriteMessage(L"UnparsedKeysAreNotAggregated");
+
+            FlowTable flowTable(15, 300);
+            m_EventData.source = L"not an address";
+            Assert::IsFalse(flowTable.AddEvent(m_EventData));
+
+            m_EventData.source = L"10.0.0.1";
+            m_EventData.sourcePort = L"port";
+            Assert::IsFalse(flowTable.AddEvent(m_EventData));
+
+            m_EventData.sourcePort = L"50000";
+            m_EventData.protocol = L"AVeryLongProtocolName";
+            Assert::IsFalse(flowTable.AddEvent(m_EventData));
+            Assert::AreEqual(static_cast<size_t>(0), flowTable.GetFlowCount());
+        }
+
+        TEST_METHOD(ExpiryRunsWhileEventsAreAdded)
+        {
+            Logger::WriteMessage(L"ExpiryRunsWhileEventsAreAdded");
+
+            // Every flow is idle as soon as it starts, so each expiry takes what is there.
+            FlowTable flowTable(1, 300);
+            const int eventCount = 200000;
+            std::atomic<bool> adding(true);
+            int rejected = 0;
+            std::thread adder([&]()
+            {
+                for (int i = 0; i < eventCount; ++i)
+                {
+                    m_EventData.sourcePort = std::to_wstring(i % 1000);
+                    if (!flowTable.AddEvent(m_EventData))
+                    {
+                        ++rejected;
+                    }
+                }
+                adding = false;
+            });
+
+            std::vector<VfpEventData> expired;
+            while (adding)
+            {
+                flowTable.ExpireFlows(StartTime + 2 * FlowTable::FileTimeTicksPerSecond, expired);
+            }
+            adder.join();
+            Assert::AreEqual(0, rejected);
+            flowTable.ExpireAllFlows(expired);
+
+            unsigned long long total = 0;
+            for (const auto& flow : expired)
+            {
+                total += flow.eventCount;
+            }
+            Assert::AreEqual(0ull + eventCount, total);
+        }
+
+    private:
+        VfpEventData m_EventData;
+    };
+}
\ No newline at end of file
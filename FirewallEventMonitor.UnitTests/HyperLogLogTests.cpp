@@ -0,0 +1,88 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "HyperLogLog.h"
+#include "EventKeys.h"
+// c++ headers
+#include <cmath>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(HyperLogLogTests)
+    {
+    public:
+
+        TEST_METHOD(EstimatesAcrossCardinalities)
+        {
+            Logger::WriteMessage(L"EstimatesAcrossCardinalities");
+
+            const unsigned long long cardinalities[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+            for (const auto cardinality : cardinalities)
+            {
+                HyperLogLog sketch;
+                for (unsigned long long i = 0; i < cardinality; ++i)
+                {
+                    // Every item twice: duplicates must not count.
+                    sketch.Add(HashOf(i));
+                    sketch.Add(HashOf(i));
+                }
+
+                // Three standard errors at the default precision.
+                double error = std::fabs(sketch.Estimate() - static_cast<double>(cardinality)) / static_cast<double>(cardinality);
+                Assert::IsTrue(error < 0.1);
+            }
+
+            HyperLogLog empty;
+            Assert::AreEqual(0.0, empty.Estimate());
+        }
+
+        TEST_METHOD(MergeEstimatesTheUnion)
+        {
+            Logger::WriteMessage(L"MergeEstimatesTheUnion");
+
+            // Two halves overlapping by 10000 items: 30000 distinct in all.
+            HyperLogLog first;
+            HyperLogLog second;
+            HyperLogLog both;
+            for (unsigned long long i = 0; i < 20000; ++i)
+            {
+                first.Add(HashOf(i));
+                second.Add(HashOf(i + 10000));
+                both.Add(HashOf(i));
+                both.Add(HashOf(i + 10000));
+            }
+
+            first.Merge(second);
+            Assert::AreEqual(both.Estimate(), first.Estimate());
+            Assert::IsTrue(std::fabs(first.Estimate() - 30000.0) < 3000.0);
+
+            first.Reset();
+            Assert::AreEqual(0.0, first.Estimate());
+        }
+
+        TEST_METHOD(PrecisionIsChecked)
+        {
+            Logger::WriteMessage(L"PrecisionIsChecked");
+
+            Assert::ExpectException<std::exception>([]() { HyperLogLog sketch(3); });
+            Assert::ExpectException<std::exception>([]() { HyperLogLog sketch(17); });
+
+            HyperLogLog small(4);
+            HyperLogLog large(16);
+            Assert::ExpectException<std::exception>([&]() { small.Merge(large); });
+        }
+
+    private:
+        static unsigned long long HashOf(unsigned long long value)
+        {
+            EventKey key = {};
+            memcpy_s(key.bytes, sizeof(key.bytes), &value, sizeof(value));
+            return EventKeys::Hash(key);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "LatencyHistogram.h"
+// c++ headers
+#include <climits>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(LatencyHistogramTests)
+    {
+    public:
+
+        TEST_METHOD(BucketsCoverEveryValueWithinPrecision)
+        {
+            Logger::WriteMessage(L"BucketsCoverEveryValueWithinPrecision");
+
+            // Walk the buckets: each must start right after the previous one ends.
+            unsigned long long lowest = 0;
+            for (size_t index = 0; index < LatencyHistogram::BucketCount; ++index)
+            {
+                unsigned long long highest = LatencyHistogram::GetBucketHighestValue(index);
+                Assert::IsTrue(highest >= lowest);
+                Assert::AreEqual(index, LatencyHistogram::GetBucketIndex(lowest));
+                Assert::AreEqual(index, LatencyHistogram::GetBucketIndex(highest));
+
+                // The bucket is no wider than 1/32 of the values in it.
+                Assert::IsTrue((highest - lowest) <= lowest / 32);
+
+                lowest = highest + 1;
+            }
+
+            // The last bucket ends at the largest value.
+            Assert::AreEqual(0ull, lowest);
+            Assert::AreEqual(LatencyHistogram::BucketCount - 1, LatencyHistogram::GetBucketIndex(ULLONG_MAX));
+        }
+
+        TEST_METHOD(PercentilesAreWithinPrecision)
+        {
+            Logger::WriteMessage(L"PercentilesAreWithinPrecision");
+
+            LatencyHistogram histogram;
+            for (unsigned long long value = 1; value <= 100000; ++value)
+            {
+                histogram.Record(value);
+            }
+
+            LatencySnapshot interval;
+            LatencySnapshot total;
+            histogram.Snapshot(interval, total);
+
+            Assert::AreEqual(100000ull, total.count);
+            Assert::AreEqual(100000ull, total.max);
+
+            const double percentiles[] = { 50.0, 99.0, 99.9 };
+            for (double percentile : percentiles)
+            {
+                double expected = percentile * 1000.0;
+                double value = static_cast<double>(total.ValueAtPercentile(percentile));
+                Assert::IsTrue(value >= expected);
+                Assert::IsTrue(value <= expected * (1.0 + 1.0 / 32));
+            }
+            Assert::AreEqual(100000ull, total.ValueAtPercentile(100.0));
+            Assert::AreEqual(1ull, total.ValueAtPercentile(0.0));
+        }
+
+        TEST_METHOD(SnapshotSplitsIntervals)
+        {
+            Logger::WriteMessage(L"SnapshotSplitsIntervals");
+
+            LatencyHistogram histogram;
+            LatencySnapshot interval;
+            LatencySnapshot total;
+
+            histogram.Snapshot(interval, total);
+            Assert::AreEqual(0ull, interval.count);
+            Assert::AreEqual(0ull, interval.ValueAtPercentile(99.0));
+
+            for (unsigned long long value = 0; value < 10; ++value)
+            {
+                histogram.Record(1000000 + value);
+            }
+            histogram.Snapshot(interval, total);
+            Assert::AreEqual(10ull, interval.count);
+            Assert::AreEqual(1000009ull, interval.max);
+
+            histogram.Record(5);
+            histogram.Record(7);
+            histogram.Snapshot(interval, total);
+            Assert::AreEqual(2ull, interval.count);
+            Assert::AreEqual(7ull, interval.max);
+            Assert::AreEqual(5ull, interval.ValueAtPercentile(50.0));
+            Assert::AreEqual(12ull, total.count);
+            Assert::AreEqual(1000009ull, total.max);
+        }
+
+        TEST_METHOD(ReadCumulativeCountsAtBounds)
+        {
+            Logger::WriteMessage(L"ReadCumulativeCountsAtBounds");
+
+            LatencyHistogram histogram;
+            histogram.Record(5);
+            histogram.Record(7);
+            histogram.Record(100);
+            for (unsigned long long value = 0; value < 10; ++value)
+            {
+                histogram.Record(1000000 + value);
+            }
+
+            const unsigned long long bounds[] = { 4, 10, 1000, 2000000 };
+            unsigned long long counts[4] = {};
+            double sum = 0.0;
+            Assert::AreEqual(13ull, histogram.ReadCumulativeCounts(bounds, 4, counts, sum));
+            Assert::AreEqual(0ull, counts[0]);
+            Assert::AreEqual(2ull, counts[1]);
+            Assert::AreEqual(3ull, counts[2]);
+            Assert::AreEqual(13ull, counts[3]);
+
+            // The sum is within the precision of the buckets.
+            double expected = 5.0 + 7.0 + 100.0 + 10000045.0;
+            Assert::IsTrue(sum >= expected * (1.0 - 1.0 / 32));
+            Assert::IsTrue(sum <= expected * (1.0 + 1.0 / 32));
+
+            // Reading does not take the values out, as Snapshot's interval does.
+            LatencySnapshot interval;
+            LatencySnapshot total;
+            histogram.Snapshot(interval, total);
+            Assert::AreEqual(13ull, interval.count);
+        }
+    };
+}
\ No newline at end of file
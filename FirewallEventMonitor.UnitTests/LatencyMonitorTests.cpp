@@ -0,0 +1,123 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "LatencyMonitor.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(LatencyMonitorTests)
+    {
+    public:
+
+        TEST_METHOD(ReportListsEveryStage)
+        {
+            Logger::WriteMessage(L"ReportListsEveryStage");
+
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+
+            LatencyMonitor monitor;
+            // One millisecond of Collect, twice.
+            monitor.RecordStage(LatencyMonitor::Collect, 0, frequency.QuadPart / 1000);
+            monitor.RecordStage(LatencyMonitor::Collect, 0, frequency.QuadPart / 1000);
+            // Three allocations of 100 bytes between them.
+            monitor.RecordAllocations(LatencyMonitor::Collect, 3, 300);
+
+            std::string buffer;
+            monitor.Report(10, buffer);
+            Assert::IsTrue(buffer.find("Event latency in the last 10 seconds") == 0);
+            for (size_t i = 0; i < LatencyMonitor::StageCount; ++i)
+            {
+                Assert::IsTrue(buffer.find(LatencyMonitor::GetStageName(static_cast<LatencyMonitor::Stage>(i))) != std::string::npos);
+            }
+            Assert::IsTrue(buffer.find(
+                "  Collect                            2      1000.0      1000.0      1000.0      1000.0         1.5         150\r\n") != std::string::npos);
+
+            // The next interval is empty, the totals are not.
+            buffer.clear();
+            monitor.Report(10, buffer);
+            Assert::IsTrue(buffer.find(
+                "  Collect                            0         0.0         0.0         0.0         0.0         0.0           0\r\n") != std::string::npos);
+
+            buffer.clear();
+            monitor.ReportTotals(buffer);
+            Assert::IsTrue(buffer.find("Event latency since the capture started") == 0);
+            Assert::IsTrue(buffer.find(
+                "  Collect                            2      1000.0      1000.0      1000.0      1000.0         1.5         150\r\n") != std::string::npos);
+            Assert::AreEqual(3ull, monitor.GetAllocationCount(LatencyMonitor::Collect));
+            Assert::AreEqual(300ull, monitor.GetAllocatedBytes(LatencyMonitor::Collect));
+        }
+
+        TEST_METHOD(ReportTotalsLeavesTheIntervalToReport)
+        {
+            Logger::WriteMessage(L"ReportTotalsLeavesTheIntervalToReport");
+
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+
+            LatencyMonitor monitor;
+            monitor.RecordStage(LatencyMonitor::Collect, 0, frequency.QuadPart / 1000);
+            monitor.RecordAllocations(LatencyMonitor::Collect, 2, 200);
+
+            std::string buffer;
+            monitor.ReportTotals(buffer);
+            Assert::IsTrue(buffer.find(
+                "  Collect                            1      1000.0      1000.0      1000.0      1000.0         2.0         200\r\n") != std::string::npos);
+
+            // The partial interval at the end of a capture is still reported.
+            buffer.clear();
+            monitor.Report(10, buffer);
+            Assert::IsTrue(buffer.find(
+                "  Collect                            1      1000.0      1000.0      1000.0      1000.0         2.0         200\r\n") != std::string::npos);
+        }
+
+        TEST_METHOD(StageClockCountsEachStagesAllocations)
+        {
+            Logger::WriteMessage(L"StageClockCountsEachStagesAllocations");
+
+            LatencyMonitor monitor;
+            {
+                LatencyMonitor::StageClock clock(&monitor);
+                std::unique_ptr<int> allocated(new int(1));
+                clock.EndStage(LatencyMonitor::Collect);
+                clock.EndStage(LatencyMonitor::Filter);
+            }
+
+            Assert::AreEqual(1ull, monitor.GetAllocationCount(LatencyMonitor::Collect));
+            Assert::AreEqual(static_cast<unsigned long long>(sizeof(int)), monitor.GetAllocatedBytes(LatencyMonitor::Collect));
+            Assert::AreEqual(0ull, monitor.GetAllocationCount(LatencyMonitor::Filter));
+            Assert::AreEqual(1ull, monitor.GetAllocationCount(LatencyMonitor::Total));
+        }
+
+        TEST_METHOD(StageClockTimesEachStage)
+        {
+            Logger::WriteMessage(L"StageClockTimesEachStage");
+
+            LatencyMonitor monitor;
+            {
+                LatencyMonitor::StageClock clock(&monitor);
+                clock.EndStage(LatencyMonitor::Collect);
+                clock.EndStage(LatencyMonitor::Output);
+            }
+            {
+                // Without a monitor nothing is recorded.
+                LatencyMonitor::StageClock clock(nullptr);
+                clock.EndStage(LatencyMonitor::Collect);
+            }
+            monitor.RecordEventAge(0);
+
+            std::string buffer;
+            monitor.ReportTotals(buffer);
+            Assert::IsTrue(buffer.find("  Collect                            1") != std::string::npos);
+            Assert::IsTrue(buffer.find("  Filter                             0") != std::string::npos);
+            Assert::IsTrue(buffer.find("  Output                             1") != std::string::npos);
+            Assert::IsTrue(buffer.find("  Total                              1") != std::string::npos);
+            Assert::IsTrue(buffer.find("  Event age                          1") != std::string::npos);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,185 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "FileLogger.h"
+#include "LogCompression.h"
+// c++ headers
+#include <memory>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(LogCompressionTests)
+    {
+    public:
+
+        TEST_METHOD(CompressedLogReadsBack)
+        {
+            Logger::WriteMessage(L"CompressedLogReadsBack");
+
+            // More than one buffer, so the file holds several blocks.
+            std::string line = "[20170914 224228] Inbound Allow rule status = STATUS_SUCCESS \r\n";
+            std::string expected;
+            while (expected.size() < 3 * FileLogger::LogBufferSizeInBytes)
+            {
+                expected.append(line);
+            }
+
+            FileLogger fileLogger(L"", L".log", true);
+            fileLogger.CreateLogFile();
+            for (size_t offset = 0; offset < expected.size(); offset += line.size())
+            {
+                fileLogger.Write(expected.data() + offset, line.size());
+            }
+            fileLogger.CloseLogFile();
+
+            std::wstring filePath = fileLogger.GetLogFilePath();
+            Assert::IsTrue(filePath.find(CompressedFileExtension) != std::wstring::npos);
+
+            std::ifstream compressedFile(filePath, std::ios::binary | std::ios::ate);
+            Assert::IsTrue(compressedFile.tellg() < static_cast<std::streampos>(expected.size() / 4));
+            compressedFile.close();
+
+            CompressedFileReader reader(filePath);
+            Assert::IsTrue(reader.IsCompressed());
+
+            std::string actual(expected.size() + 1, '\0');
+            size_t bytesRead = reader.Read(&actual[0], actual.size());
+            actual.resize(bytesRead);
+            Assert::IsTrue(actual == expected);
+        }
+
+        TEST_METHOD(FullBufferIsCompressedByMaintenanceCheck)
+        {
+            Logger::WriteMessage(L"FullBufferIsCompressedByMaintenanceCheck");
+
+            std::string line = "[20170914 224228] Inbound Allow rule status = STATUS_SUCCESS \r\n";
+            std::string expected;
+            while (expected.size() < FileLogger::LogBufferSizeInBytes + line.size())
+            {
+                expected.append(line);
+            }
+
+            FileLogger fileLogger(L"", L".log", true);
+            fileLogger.CreateLogFile();
+            for (size_t offset = 0; offset < expected.size(); offset += line.size())
+            {
+                fileLogger.Write(expected.data() + offset, line.size());
+            }
+
+            // The writer only sealed the full buffer; the main loop compresses and writes it.
+            Assert::AreEqual(0ull, fileLogger.GetTotalBytesWritten());
+            fileLogger.MaintenanceCheck();
+            unsigned long long blockBytes = fileLogger.GetTotalBytesWritten();
+            Assert::IsTrue(blockBytes > 0);
+            Assert::IsTrue(blockBytes < FileLogger::LogBufferSizeInBytes / 4);
+
+            // The partial buffer left is not flushed early.
+            fileLogger.FlushDeadlineCheck();
+            Assert::AreEqual(blockBytes, fileLogger.GetTotalBytesWritten());
+            fileLogger.CloseLogFile();
+
+            CompressedFileReader reader(fileLogger.GetLogFilePath());
+            std::string actual(expected.size() + 1, '\0');
+            size_t bytesRead = reader.Read(&actual[0], actual.size());
+            actual.resize(bytesRead);
+            Assert::IsTrue(actual == expected);
+        }
+
+        TEST_METHOD(UncompressedFileIsPassedThrough)
+        {
+            Logger::WriteMessage(L"UncompressedFileIsPassedThrough");
+
+            std::string expected = "plain line\r\n";
+
+            FileLogger fileLogger(L"");
+            fileLogger.CreateLogFile();
+            fileLogger.Write(expected.data(), expected.size());
+            fileLogger.CloseLogFile();
+
+            CompressedFileReader reader(fileLogger.GetLogFilePath());
+            Assert::IsFalse(reader.IsCompressed());
+
+            std::string actual(64, '\0');
+            size_t bytesRead = reader.Read(&actual[0], actual.size());
+            actual.resize(bytesRead);
+            Assert::IsTrue(actual == expected);
+        }
+
+        TEST_METHOD(IncompressibleBlockIsStored)
+        {
+            Logger::WriteMessage(L"IncompressibleBlockIsStored");
+
+            std::vector<char> data(4096);
+            unsigned int state = 2463534242u;
+            for (auto& byte : data)
+            {
+                // xorshift32
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                byte = static_cast<char>(state);
+            }
+
+            BlockCompressor compressor;
+            std::vector<char> block;
+            compressor.CompressBlock(data.data(), data.size(), block);
+
+            CompressedBlockHeader header;
+            memcpy_s(&header, sizeof(header), block.data(), sizeof(header));
+            Assert::AreEqual(static_cast<unsigned long>(data.size()), header.uncompressedSize);
+            Assert::AreEqual(header.uncompressedSize, header.storedSize);
+            Assert::AreEqual(sizeof(header) + data.size(), block.size());
+        }
+
+        TEST_METHOD(TruncatedFinalBlockIsDropped)
+        {
+            Logger::WriteMessage(L"TruncatedFinalBlockIsDropped");
+
+            std::string firstBlock(8192, 'a');
+            std::string secondBlock = "[20170914 224228] Inbound Allow rule status = STATUS_SUCCESS \r\n";
+            std::string finalBlock(4096, 'c');
+
+            BlockCompressor compressor;
+            std::vector<char> block;
+            std::string complete;
+            compressor.CompressBlock(firstBlock.data(), firstBlock.size(), block);
+            complete.append(block.data(), block.size());
+            compressor.CompressBlock(secondBlock.data(), secondBlock.size(), block);
+            complete.append(block.data(), block.size());
+            compressor.CompressBlock(finalBlock.data(), finalBlock.size(), block);
+
+            // Cut off in the final block's data, then in its header, as a crash mid-write leaves it.
+            const size_t cutAt[] = { block.size() / 2, sizeof(CompressedBlockHeader) / 2 };
+            for (size_t length : cutAt)
+            {
+                {
+                    std::ofstream file("TruncatedFinalBlock.log.xpress", std::ios::binary | std::ios::trunc);
+                    file.write(complete.data(), complete.size());
+                    file.write(block.data(), length);
+                }
+
+                unsigned long long byteCount = CompressedFileReader::DecompressFile(
+                    L"TruncatedFinalBlock.log.xpress",
+                    L"TruncatedFinalBlock.log");
+                Assert::AreEqual(static_cast<unsigned long long>(firstBlock.size() + secondBlock.size()), byteCount);
+
+                std::ifstream file("TruncatedFinalBlock.log", std::ios::binary);
+                std::string actual((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                file.close();
+                Assert::IsTrue(actual == firstBlock + secondBlock);
+            }
+
+            ::DeleteFileW(L"TruncatedFinalBlock.log.xpress");
+            ::DeleteFileW(L"TruncatedFinalBlock.log");
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,161 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "BinaryLogger.h"
+#include "EventPredicate.h"
+#include "LogMerger.h"
+#include "UserInput.h"
+// c++ headers
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(LogMergerTests)
+    {
+    public:
+
+        TEST_METHOD(HostNames)
+        {
+            Logger::WriteMessage(L"HostNames");
+
+            Assert::AreEqual(std::wstring(L"host1"), LogStream::GetHostName(L"C:\\logs\\host1\\", true));
+            Assert::AreEqual(std::wstring(L"host1.contoso.com"), LogStream::GetHostName(L"C:\\logs\\host1.contoso.com", true));
+            Assert::AreEqual(std::wstring(L"host2"), LogStream::GetHostName(L"C:\\traces\\host2.etl", false));
+            Assert::AreEqual(std::wstring(L"host3"), LogStream::GetHostName(L"host3.20170914T224228.bin.xpress", false));
+        }
+
+        TEST_METHOD(MergesInTimeOrder)
+        {
+            Logger::WriteMessage(L"MergesInTimeOrder");
+
+            // Host 1 at 0, 3, 6, ... seconds; host 2 at 0, 2, 4, ... seconds.
+            WriteLog(L"LogMergerHost1.bin", 3, 100);
+            WriteLog(L"LogMergerHost2.bin", 2, 100);
+
+            std::vector<std::wstring> inputs;
+            inputs.push_back(L"LogMergerHost1.bin");
+            inputs.push_back(L"LogMergerHost2.bin");
+            inputs.push_back(L"LogMergerMissing.bin");
+
+            Parameters parameters;
+            EventPredicate predicate(parameters, 0);
+            LogMerger merger(predicate, 8);
+
+            std::vector<size_t> hosts;
+            LONGLONG lastTimeStamp = 0;
+            bool inOrder = true;
+            LogMergeResults results = merger.Merge(
+                inputs,
+                [&](size_t input, const VfpEventData& eventData)
+                {
+                    inOrder = inOrder && eventData.timeStamp >= lastTimeStamp;
+                    lastTimeStamp = eventData.timeStamp;
+                    hosts.push_back(input);
+                });
+
+            Assert::AreEqual(2ull, results.inputsRead);
+            Assert::AreEqual(1ull, results.inputsFailed);
+            Assert::AreEqual(200ull, results.eventsMerged);
+            Assert::AreEqual(0ull, results.eventsOutOfOrder);
+            Assert::IsTrue(inOrder);
+            // Equal time stamps keep the order of the inputs.
+            Assert::AreEqual(static_cast<size_t>(0), hosts[0]);
+            Assert::AreEqual(static_cast<size_t>(1), hosts[1]);
+            Assert::AreEqual(static_cast<size_t>(1), hosts[2]);
+
+            ::DeleteFileW(L"LogMergerHost1.bin");
+            ::DeleteFileW(L"LogMergerHost2.bin");
+        }
+
+        TEST_METHOD(MergesSavedCaptures)
+        {
+            Logger::WriteMessage(L"MergesSavedCaptures");
+
+            WriteLog(L"LogMergerHost1.bin", 1, 10);
+
+            std::vector<std::wstring> inputs;
+            inputs.push_back(L"..\\..\\..\\TestTraceSession.etl");
+            inputs.push_back(L"LogMergerHost1.bin");
+
+            Parameters parameters;
+            EventPredicate predicate(parameters, 0);
+            LogMerger merger(predicate, 2);
+
+            ULONGLONG captureEvents = 0;
+            LONGLONG lastTimeStamp = 0;
+            bool inOrder = true;
+            LogMergeResults results = merger.Merge(
+                inputs,
+                [&](size_t input, const VfpEventData& eventData)
+                {
+                    inOrder = inOrder && eventData.timeStamp >= lastTimeStamp;
+                    lastTimeStamp = eventData.timeStamp;
+                    if (input == 0)
+                    {
+                        ++captureEvents;
+                        Assert::IsFalse(eventData.direction.empty());
+                    }
+                });
+
+            Assert::AreEqual(2ull, results.inputsRead);
+            Assert::AreEqual(0ull, results.inputsFailed);
+            Assert::IsTrue(captureEvents > 0);
+            Assert::AreEqual(captureEvents + 10, results.eventsMerged);
+            Assert::AreEqual(0ull, results.eventsOutOfOrder);
+            Assert::IsTrue(inOrder);
+
+            ::DeleteFileW(L"LogMergerHost1.bin");
+        }
+
+        TEST_METHOD(TagsEveryLineOfARecord)
+        {
+            Logger::WriteMessage(L"TagsEveryLineOfARecord");
+
+            std::string text;
+            LogMerger::AppendTaggedLines("[host1] ", "[date time] Inbound\r\n  port {4}\r\n  flow {TCP}\r\n\r\n", text);
+            LogMerger::AppendTaggedLines("[host2] ", "[date time] Outbound\r\n  rule {7}", text);
+
+            Assert::AreEqual(
+                std::string(
+                    "[host1] [date time] Inbound\r\n"
+                    "[host1]   port {4}\r\n"
+                    "[host1]   flow {TCP}\r\n"
+                    "\r\n"
+                    "[host2] [date time] Outbound\r\n"
+                    "[host2]   rule {7}"),
+                text);
+        }
+
+    private:
+        static void WriteLog(
+            const std::wstring& filePath,
+            LONGLONG secondsApart,
+            int eventCount)
+        {
+            VfpEventData eventData;
+            eventData.direction = L"Inbound";
+            eventData.ruleType = L"Allow";
+            eventData.source = L"192.168.100.21";
+            eventData.destination = L"192.168.100.22";
+            eventData.protocol = L"TCP";
+
+            BinaryLogger binaryLogger(L"");
+            binaryLogger.CreateLogFile();
+            for (int i = 0; i < eventCount; ++i)
+            {
+                // 2017-09-14 22:42:28 UTC onwards.
+                eventData.timeStamp = 131499025480000000 + i * secondsApart * 10000000;
+                binaryLogger.WriteEvent(eventData);
+            }
+            binaryLogger.CloseLogFile();
+
+            Assert::IsTrue(::MoveFileExW(binaryLogger.GetLogFilePath().c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,182 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "ntlEtwReader.hpp"
+#include "ntlEtwRecord.hpp"
+// c++ headers
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FirewallEventMonitorUnitTest
+{
+    // What the reused and the fresh records were seen to do over a saved capture.
+    struct RecordReuseResults
+    {
+        // Assigned every record in turn.
+        ntl::EtwRecord reused;
+        // The last rule match record, and whether it was an IPv4 event.
+        ntl::EtwRecord ruleMatch;
+        bool ruleMatchIsIpv4 = false;
+        unsigned long records = 0;
+        unsigned long mismatches = 0;
+        // Records with fewer properties than the rule match record they were assigned over.
+        unsigned long fewerProperties = 0;
+        // IPv6 records assigned over an IPv4 rule match record.
+        unsigned long ipv6OverIpv4 = 0;
+    };
+
+    // True when the two records give the same result for a property queried by name.
+    bool SameNamedProperty(const ntl::EtwRecord& reused, const ntl::EtwRecord& fresh, const wchar_t* name)
+    {
+        std::wstring reusedValue;
+        std::wstring freshValue;
+        bool reusedFound = reused.queryEventProperty(name, reusedValue);
+        bool freshFound = fresh.queryEventProperty(name, freshValue);
+        return reusedFound == freshFound && reusedValue == freshValue;
+    }
+
+    // True when every property, by index and by name, and both formatted messages match.
+    bool SameRecordContents(const ntl::EtwRecord& reused, const ntl::EtwRecord& fresh)
+    {
+        if (reused.getEventId() != fresh.getEventId())
+        {
+            return false;
+        }
+
+        ULONG reusedCount = 0;
+        ULONG freshCount = 0;
+        if (reused.queryTopLevelPropertyCount(&reusedCount) != fresh.queryTopLevelPropertyCount(&freshCount) ||
+            reusedCount != freshCount)
+        {
+            return false;
+        }
+
+        std::wstring reusedValue;
+        std::wstring freshValue;
+        std::wstring name;
+        for (ULONG index = 0; index < freshCount; ++index)
+        {
+            if (reused.queryEventPropertyName(index, reusedValue) != fresh.queryEventPropertyName(index, name) ||
+                reusedValue != name)
+            {
+                return false;
+            }
+
+            if (!SameNamedProperty(reused, fresh, name.c_str()))
+            {
+                return false;
+            }
+
+            // Values by index count from 1.
+            if (reused.queryEventProperty(index + 1, reusedValue) != fresh.queryEventProperty(index + 1, freshValue) ||
+                reusedValue != freshValue)
+            {
+                return false;
+            }
+        }
+
+        // Properties an earlier record may have had and this one may not.
+        const wchar_t* const namesOfEarlierRecords[] =
+        {
+            L"SrcIpv4Addr", L"DstIpv4Addr", L"SrcIpv6Addr", L"DstIpv6Addr",
+            L"SrcPort", L"DstPort", L"PortName", L"RuleId", L"IcmpType"
+        };
+        for (const wchar_t* earlierName : namesOfEarlierRecords)
+        {
+            if (!SameNamedProperty(reused, fresh, earlierName))
+            {
+                return false;
+            }
+        }
+
+        return reused.writeFormattedMessage(true) == fresh.writeFormattedMessage(true) &&
+            reused.writeFormattedMessage(false) == fresh.writeFormattedMessage(false);
+    }
+
+    // Assigns each record of a saved capture over the record before it, and over a copy of the
+    // last rule match record, and compares both with the record parsed afresh.
+    struct RecordReuseComparer
+    {
+        RecordReuseResults* results;
+
+        bool operator()(const PEVENT_RECORD pEventRecord)
+        {
+            RecordReuseResults& seen = *results;
+            ntl::EtwRecord fresh(pEventRecord);
+            ++seen.records;
+
+            seen.reused.assign(pEventRecord);
+            if (!SameRecordContents(seen.reused, fresh))
+            {
+                ++seen.mismatches;
+            }
+
+            std::wstring address;
+            bool isIpv4 = fresh.queryEventProperty(L"SrcIpv4Addr", address) && !address.empty();
+            bool isIpv6 = fresh.queryEventProperty(L"SrcIpv6Addr", address) && !address.empty();
+            ULONG propertyCount = 0;
+            fresh.queryTopLevelPropertyCount(&propertyCount);
+
+            ULONG ruleMatchPropertyCount = 0;
+            if (seen.ruleMatch.queryTopLevelPropertyCount(&ruleMatchPropertyCount))
+            {
+                ntl::EtwRecord overRuleMatch(seen.ruleMatch);
+                overRuleMatch.assign(pEventRecord);
+                if (!SameRecordContents(overRuleMatch, fresh))
+                {
+                    ++seen.mismatches;
+                }
+
+                if (propertyCount < ruleMatchPropertyCount)
+                {
+                    ++seen.fewerProperties;
+                }
+                if (isIpv6 && seen.ruleMatchIsIpv4)
+                {
+                    ++seen.ipv6OverIpv4;
+                }
+            }
+
+            USHORT eventId = fresh.getEventId();
+            if (eventId >= 400 && eventId <= 402)
+            {
+                seen.ruleMatch = fresh;
+                seen.ruleMatchIsIpv4 = isIpv4;
+            }
+
+            // The reader must not keep the record.
+            return false;
+        }
+    };
+
+    TEST_CLASS(NtlEtwRecordTests)
+    {
+    public:
+
+        TEST_METHOD(ReassignedRecordReadsAsAFreshOne)
+        {
+            Logger::WriteMessage(L"ReassignedRecordReadsAsAFreshOne");
+
+            RecordReuseResults results;
+            RecordReuseComparer comparer = { &results };
+            {
+                ntl::EtwReader<RecordReuseComparer> reader(comparer);
+                reader.OpenSavedSession(L"..\\..\\..\\TestTraceSession.etl");
+                reader.WaitForSession();
+            }
+
+            std::wstring summary = std::to_wstring(results.records) + L" records, " +
+                std::to_wstring(results.fewerProperties) + L" with fewer properties than a rule match, " +
+                std::to_wstring(results.ipv6OverIpv4) + L" IPv6 over an IPv4 rule match.";
+            Logger::WriteMessage(summary.c_str());
+
+            Assert::IsTrue(results.records > 0);
+            // The capture mixes events, so records were assigned over rule matches with more properties.
+            Assert::IsTrue(results.fewerProperties > 0);
+            Assert::AreEqual(0ul, results.mismatches);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "ntlMath.hpp"
+// c++ headers
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FirewallEventMonitorUnitTest
+{
+    // Inter-arrival-like values: exponentially distributed, mean 50.
+    std::vector<double> MakeExponentialValues(size_t count, unsigned int seed)
+    {
+        std::mt19937 engine(seed);
+        std::exponential_distribution<double> distribution(1.0 / 50.0);
+        std::vector<double> values(count);
+        for (auto& value : values)
+        {
+            value = distribution(engine);
+        }
+        return values;
+    }
+
+    // Fraction of the sorted values below value.
+    double RankOf(const std::vector<double>& sortedValues, double value)
+    {
+        auto position = std::lower_bound(sortedValues.begin(), sortedValues.end(), value);
+        return static_cast<double>(position - sortedValues.begin()) / static_cast<double>(sortedValues.size());
+    }
+
+    TEST_CLASS(NtlMathTests)
+    {
+    public:
+
+        TEST_METHOD(RunningStatisticsMatchesSampledStandardDeviation)
+        {
+            Logger::WriteMessage(L"RunningStatisticsMatchesSampledStandardDeviation");
+
+            // Large offset, small spread: the naive sum-of-squares formula loses every digit here.
+            std::vector<double> values = MakeExponentialValues(10000, 1);
+            for (auto& value : values)
+            {
+                value += 1e9;
+            }
+
+            ntl::RunningStatistics statistics;
+            for (double value : values)
+            {
+                statistics.add(value);
+            }
+
+            auto expected = ntl::SampledStandardDeviation(values.begin(), values.end());
+            auto actual = statistics.mean_and_deviation();
+            Assert::AreEqual(std::get<1>(expected), std::get<1>(actual), 1e-3);
+            Assert::AreEqual(std::get<2>(expected) - std::get<1>(expected), statistics.standard_deviation(), 1e-6);
+            Assert::AreEqual(10000ull, statistics.count());
+            Assert::AreEqual(*std::min_element(values.begin(), values.end()), statistics.minimum());
+            Assert::AreEqual(*std::max_element(values.begin(), values.end()), statistics.maximum());
+
+            // Too few samples, as for the batch function.
+            ntl::RunningStatistics single;
+            single.add(5.0);
+            Assert::AreEqual(0.0, std::get<1>(single.mean_and_deviation()));
+            Assert::AreEqual(5.0, single.mean());
+        }
+
+        TEST_METHOD(RunningStatisticsMergeIsExact)
+        {
+            Logger::WriteMessage(L"RunningStatisticsMergeIsExact");
+
+            std::vector<double> values = MakeExponentialValues(1000, 2);
+            ntl::RunningStatistics whole;
+            ntl::RunningStatistics first;
+            ntl::RunningStatistics second;
+            ntl::RunningStatistics empty;
+            for (size_t i = 0; i < values.size(); ++i)
+            {
+                whole.add(values[i]);
+                (i < 300 ? first : second).add(values[i]);
+            }
+
+            first.merge(empty);
+            first.merge(second);
+            Assert::AreEqual(whole.count(), first.count());
+            Assert::AreEqual(whole.mean(), first.mean(), 1e-9);
+            Assert::AreEqual(whole.variance(), first.variance(), 1e-6);
+            Assert::AreEqual(whole.minimum(), first.minimum());
+            Assert::AreEqual(whole.maximum(), first.maximum());
+
+            empty.merge(whole);
+            Assert::AreEqual(whole.variance(), empty.variance());
+        }
+
+        TEST_METHOD(QuantileSketchTracksInterquartileRange)
+        {
+            Logger::WriteMessage(L"QuantileSketchTracksInterquartileRange");
+
+            std::vector<double> values = MakeExponentialValues(100000, 3);
+            ntl::QuantileSketch sketch;
+            for (double value : values)
+            {
+                sketch.add(value);
+            }
+            Assert::AreEqual(100000ull, sketch.count());
+            // Constant memory: about 3 * k values kept.
+            Assert::IsTrue(sketch.retained() <= 3 * ntl::QuantileSketch::default_k + 64);
+
+            std::vector<double> sorted(values);
+            std::sort(sorted.begin(), sorted.end());
+            auto expected = ntl::InterquartileRange(sorted.begin(), sorted.end());
+            auto actual = sketch.quartiles();
+
+            // Compared by rank: within 1% of the true position.
+            Assert::AreEqual(RankOf(sorted, std::get<0>(expected)), RankOf(sorted, std::get<0>(actual)), 0.01);
+            Assert::AreEqual(RankOf(sorted, std::get<1>(expected)), RankOf(sorted, std::get<1>(actual)), 0.01);
+            Assert::AreEqual(RankOf(sorted, std::get<2>(expected)), RankOf(sorted, std::get<2>(actual)), 0.01);
+
+            const double ranks[] = { 0.01, 0.1, 0.9, 0.99 };
+            for (double rank : ranks)
+            {
+                Assert::AreEqual(rank, RankOf(sorted, sketch.quantile(rank)), 0.01);
+            }
+            Assert::AreEqual(sorted.front(), sketch.quantile(0.0));
+            Assert::AreEqual(sorted.back(), sketch.quantile(1.0));
+        }
+
+        TEST_METHOD(QuantileSketchMergeCoversBothStreams)
+        {
+            Logger::WriteMessage(L"QuantileSketchMergeCoversBothStreams");
+
+            // Two disjoint halves: 0..49999 in one sketch, 50000..99999 in the other.
+            ntl::QuantileSketch lower;
+            ntl::QuantileSketch upper;
+            for (int i = 0; i < 50000; ++i)
+            {
+                lower.add(static_cast<double>(i));
+                upper.add(static_cast<double>(i + 50000));
+            }
+
+            lower.merge(upper);
+            Assert::AreEqual(100000ull, lower.count());
+            Assert::IsTrue(lower.retained() <= 3 * ntl::QuantileSketch::default_k + 64);
+            Assert::AreEqual(50000.0, lower.quantile(0.5), 1000.0);
+            Assert::AreEqual(90000.0, lower.quantile(0.9), 1000.0);
+
+            ntl::QuantileSketch empty;
+            Assert::AreEqual(0.0, empty.quantile(0.5));
+
+            ntl::QuantileSketch otherK(100);
+            Assert::ExpectException<ntl::Exception>([&]() { lower.merge(otherK); });
+        }
+    };
+}
\ No newline at end of file
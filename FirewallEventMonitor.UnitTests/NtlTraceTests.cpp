@@ -0,0 +1,86 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#if !defined(NTL_TRACE_SCOPES)
+#define NTL_TRACE_SCOPES
+#endif
+#include "ntlTrace.hpp"
+// c++ headers
+#include <string>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FirewallEventMonitorUnitTest
+{
+    size_t CountOccurrences(const std::string& text, const std::string& pattern)
+    {
+        size_t count = 0;
+        for (size_t position = text.find(pattern); position != std::string::npos; position = text.find(pattern, position + 1))
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    void TraceNestedScopes()
+    {
+        NTL_TRACE_SCOPE("Outer");
+        {
+            NTL_TRACE_SCOPE("Inner");
+        }
+    }
+
+    TEST_CLASS(NtlTraceTests)
+    {
+    public:
+
+        TEST_METHOD(WriteChromeTraceHoldsEveryThreadsScopes)
+        {
+            Logger::WriteMessage(L"WriteChromeTraceHoldsEveryThreadsScopes");
+
+            ntl::Trace::start(1024);
+            TraceNestedScopes();
+            std::thread worker(TraceNestedScopes);
+            worker.join();
+            ntl::Trace::stop();
+
+            // Nothing is recorded once stopped.
+            TraceNestedScopes();
+
+            std::string trace;
+            Assert::AreEqual(0ull, ntl::Trace::write_chrome_trace(trace));
+            Logger::WriteMessage(trace.c_str());
+
+            Assert::AreEqual(0u, static_cast<unsigned>(trace.find("{\"traceEvents\":[")));
+            Assert::AreEqual(2u, static_cast<unsigned>(CountOccurrences(trace, "\"name\":\"Outer\"")));
+            Assert::AreEqual(2u, static_cast<unsigned>(CountOccurrences(trace, "\"name\":\"Inner\"")));
+            Assert::AreEqual(4u, static_cast<unsigned>(CountOccurrences(trace, "\"ph\":\"X\"")));
+            Assert::IsTrue(trace.find("\"displayTimeUnit\":\"ns\"") != std::string::npos);
+        }
+
+        TEST_METHOD(WriteChromeTraceKeepsTheLastRecordsOfAFullBuffer)
+        {
+            Logger::WriteMessage(L"WriteChromeTraceKeepsTheLastRecordsOfAFullBuffer");
+
+            // Rounded up to 4; applies to the worker, which has not traced before.
+            ntl::Trace::start(3);
+            std::thread worker([]()
+            {
+                for (int i = 0; i < 10; ++i)
+                {
+                    NTL_TRACE_SCOPE("Scope");
+                }
+            });
+            worker.join();
+            ntl::Trace::stop();
+
+            std::string trace;
+            Assert::AreEqual(6ull, ntl::Trace::write_chrome_trace(trace));
+            Assert::AreEqual(4u, static_cast<unsigned>(CountOccurrences(trace, "\"name\":\"Scope\"")));
+            Assert::IsTrue(trace.find("\"lostRecords\":\"6\"") != std::string::npos);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "RateHistory.h"
+// c++ headers
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    // 2017-09-07T22:00:00Z, on an hour boundary, in seconds since 1601.
+    const LONGLONG HourStartInSeconds = 13149295200LL;
+
+    TEST_CLASS(RateHistoryTests)
+    {
+    public:
+
+        TEST_METHOD(CategoriesSplitDirectionRuleTypeAndProtocol)
+        {
+            Logger::WriteMessage(L"CategoriesSplitDirectionRuleTypeAndProtocol");
+
+            Assert::AreEqual(static_cast<size_t>(0), RateHistory::GetCategory(MakeEvent(L"Inbound", L"Allow", L"TCP")));
+            Assert::AreEqual(static_cast<size_t>(2), RateHistory::GetCategory(MakeEvent(L"Inbound", L"Allow", L"ICMPv6")));
+            Assert::AreEqual(static_cast<size_t>(5), RateHistory::GetCategory(MakeEvent(L"Inbound", L"Deny", L"UDP")));
+            Assert::AreEqual(static_cast<size_t>(19), RateHistory::GetCategory(MakeEvent(L"Outbound", L"Deny", L"GRE")));
+            Assert::AreEqual(RateHistory::CategoryCount - 1, RateHistory::GetCategory(MakeEvent(L"", L"", L"")));
+        }
+
+        TEST_METHOD(SecondsFoldIntoMinutesAndHours)
+        {
+            Logger::WriteMessage(L"SecondsFoldIntoMinutesAndHours");
+
+            RateHistory history;
+            const size_t inboundTcp = RateHistory::GetCategory(MakeEvent(L"Inbound", L"Allow", L"TCP"));
+            Assert::IsFalse(history.Tick(AtSecond(0)));
+
+            // One event in every second of the first hour, and one more in the first second.
+            AddEvents(history, L"Inbound", L"Allow", L"TCP", 1);
+            for (LONGLONG second = 0; second < 3600; ++second)
+            {
+                AddEvents(history, L"Inbound", L"Allow", L"TCP", 1);
+                bool minuteClosed = history.Tick(AtSecond(second + 1));
+                Assert::AreEqual((second + 1) % 60 == 0, minuteClosed);
+            }
+
+            Assert::AreEqual(1ull, history.GetCount(RateHistory::Second, 0, inboundTcp));
+            Assert::AreEqual(60ull, history.GetCount(RateHistory::Minute, 0, inboundTcp));
+            Assert::AreEqual(61ull, history.GetCount(RateHistory::Minute, 59, inboundTcp));
+            Assert::AreEqual(3601ull, history.GetCount(RateHistory::Hour, 0, inboundTcp));
+            // Nothing before the first tick.
+            Assert::AreEqual(0ull, history.GetCount(RateHistory::Hour, 1, inboundTcp));
+            Assert::AreEqual(0ull, history.GetCount(RateHistory::Second, 0, inboundTcp + 1));
+        }
+
+        TEST_METHOD(SkippedSecondsAreEmpty)
+        {
+            Logger::WriteMessage(L"SkippedSecondsAreEmpty");
+
+            RateHistory history;
+            const size_t outboundDeny = RateHistory::GetCategory(MakeEvent(L"Outbound", L"Deny", L"UDP"));
+            history.Tick(AtSecond(0));
+
+            AddEvents(history, L"Outbound", L"Deny", L"UDP", 7);
+            Assert::IsFalse(history.Tick(AtSecond(10)));
+            Assert::AreEqual(0ull, history.GetCount(RateHistory::Second, 0, outboundDeny));
+            Assert::AreEqual(7ull, history.GetCount(RateHistory::Second, 9, outboundDeny));
+
+            // The ring keeps one minute: the second with the events falls out of it, into the minute.
+            Assert::IsTrue(history.Tick(AtSecond(70)));
+            Assert::AreEqual(0ull, history.GetCount(RateHistory::Second, 59, outboundDeny));
+            Assert::AreEqual(7ull, history.GetCount(RateHistory::Minute, 0, outboundDeny));
+
+            // After a day without ticks, the history starts over.
+            AddEvents(history, L"Outbound", L"Deny", L"UDP", 1);
+            Assert::IsFalse(history.Tick(AtSecond(3 * 86400)));
+            Assert::AreEqual(0ull, history.GetCount(RateHistory::Minute, 0, outboundDeny));
+        }
+
+        TEST_METHOD(FormatCsvWritesNonZeroCounts)
+        {
+            Logger::WriteMessage(L"FormatCsvWritesNonZeroCounts");
+
+            RateHistory history;
+            history.Tick(AtSecond(58));
+            AddEvents(history, L"Inbound", L"Deny", L"TCP", 3);
+            history.Tick(AtSecond(59));
+            AddEvents(history, L"Outbound", L"Allow", L"ICMPv4", 2);
+            history.Tick(AtSecond(60));
+
+            std::string buffer;
+            history.FormatCsv(buffer);
+            Logger::WriteMessage(buffer.c_str());
+
+            std::string expected =
+                "resolution,time,direction,ruleType,protocol,count\r\n"
+                "second,2017-09-07T22:00:58.000Z,Inbound,Deny,TCP,3\r\n"
+                "second,2017-09-07T22:00:59.000Z,Outbound,Allow,ICMP,2\r\n"
+                "minute,2017-09-07T22:00:00.000Z,Inbound,Deny,TCP,3\r\n"
+                "minute,2017-09-07T22:00:00.000Z,Outbound,Allow,ICMP,2\r\n";
+            Assert::IsTrue(buffer == expected);
+        }
+
+    private:
+        static LONGLONG AtSecond(LONGLONG second)
+        {
+            return (HourStartInSeconds + second) * RateHistory::FileTimeTicksPerSecond;
+        }
+
+        static VfpEventData MakeEvent(
+            const std::wstring& direction,
+            const std::wstring& ruleType,
+            const std::wstring& protocol)
+        {
+            VfpEventData eventData;
+            eventData.direction = direction;
+            eventData.ruleType = ruleType;
+            eventData.protocol = protocol;
+            return eventData;
+        }
+
+        static void AddEvents(
+            RateHistory& history,
+            const std::wstring& direction,
+            const std::wstring& ruleType,
+            const std::wstring& protocol,
+            int count)
+        {
+            VfpEventData eventData = MakeEvent(direction, ruleType, protocol);
+            for (int i = 0; i < count; ++i)
+            {
+                history.AddEvent(eventData);
+            }
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "RuleHitCounter.h"
+// c++ headers
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(RuleHitCounterTests)
+    {
+    public:
+
+        TEST_METHOD(ParseRuleIdAcceptsBracesAndCase)
+        {
+            Logger::WriteMessage(L"ParseRuleIdAcceptsBracesAndCase");
+
+            GUID lower;
+            GUID braced;
+            Assert::IsTrue(RuleHitCounter::ParseRuleId(L"43cff06e-a520-4ad3-9fd9-1894f4a3489b", &lower));
+            Assert::IsTrue(RuleHitCounter::ParseRuleId(L"{43CFF06E-A520-4AD3-9FD9-1894F4A3489B}", &braced));
+            Assert::IsTrue(memcmp(&lower, &braced, sizeof(GUID)) == 0);
+
+            Assert::AreEqual(0x43cff06eul, static_cast<unsigned long>(lower.Data1));
+            Assert::AreEqual(static_cast<unsigned short>(0xa520), static_cast<unsigned short>(lower.Data2));
+            Assert::AreEqual(static_cast<unsigned char>(0x9b), static_cast<unsigned char>(lower.Data4[7]));
+
+            GUID invalid;
+            Assert::IsFalse(RuleHitCounter::ParseRuleId(L"", &invalid));
+            Assert::IsFalse(RuleHitCounter::ParseRuleId(L"43cff06e-a520-4ad3-9fd9-1894f4a3489", &invalid));
+            Assert::IsFalse(RuleHitCounter::ParseRuleId(L"43cff06e_a520-4ad3-9fd9-1894f4a3489b", &invalid));
+            Assert::IsFalse(RuleHitCounter::ParseRuleId(L"43cff06g-a520-4ad3-9fd9-1894f4a3489b", &invalid));
+        }
+
+        TEST_METHOD(SnapshotReportsDeltasBusiestFirst)
+        {
+            Logger::WriteMessage(L"SnapshotReportsDeltasBusiestFirst");
+
+            RuleHitCounter counter;
+            AddHits(counter, L"11111111-1111-1111-1111-111111111111", L"Allow", L"Inbound", 2);
+            AddHits(counter, L"22222222-2222-2222-2222-222222222222", L"Deny", L"Outbound", 5);
+            AddHits(counter, L"22222222-2222-2222-2222-222222222222", L"Allow", L"Inbound", 1);
+
+            std::vector<RuleHitCounts> deltas;
+            counter.Snapshot(deltas);
+            Assert::AreEqual(static_cast<size_t>(2), deltas.size());
+            Assert::AreEqual(0x22222222ul, static_cast<unsigned long>(deltas[0].ruleId.Data1));
+            Assert::AreEqual(1ull, deltas[0].allow);
+            Assert::AreEqual(5ull, deltas[0].deny);
+            Assert::AreEqual(1ull, deltas[0].inbound);
+            Assert::AreEqual(5ull, deltas[0].outbound);
+            Assert::AreEqual(2ull, deltas[1].GetHits());
+
+            // Only the change since the previous snapshot is reported.
+            AddHits(counter, L"11111111-1111-1111-1111-111111111111", L"Allow", L"Inbound", 3);
+            counter.Snapshot(deltas);
+            Assert::AreEqual(static_cast<size_t>(1), deltas.size());
+            Assert::AreEqual(0x11111111ul, static_cast<unsigned long>(deltas[0].ruleId.Data1));
+            Assert::AreEqual(3ull, deltas[0].allow);
+
+            counter.Snapshot(deltas);
+            Assert::IsTrue(deltas.empty());
+        }
+
+        TEST_METHOD(ConcurrentHitsAreAllCounted)
+        {
+            Logger::WriteMessage(L"ConcurrentHitsAreAllCounted");
+
+            RuleHitCounter counter;
+            const unsigned long long hitsPerThread = 100000;
+            std::vector<std::thread> threads;
+            for (int i = 0; i < 4; ++i)
+            {
+                threads.emplace_back([&counter, hitsPerThread]()
+                {
+                    AddHits(counter, L"33333333-3333-3333-3333-333333333333", L"Deny", L"Inbound", hitsPerThread);
+                });
+            }
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            std::vector<RuleHitCounts> deltas;
+            counter.Snapshot(deltas);
+            Assert::AreEqual(static_cast<size_t>(1), deltas.size());
+            Assert::AreEqual(4 * hitsPerThread, deltas[0].deny);
+            Assert::AreEqual(0ull, counter.GetDroppedHits());
+        }
+
+        TEST_METHOD(FormatTableAlignsColumns)
+        {
+            Logger::WriteMessage(L"FormatTableAlignsColumns");
+
+            RuleHitCounts delta;
+            RuleHitCounter::ParseRuleId(L"43cff06e-a520-4ad3-9fd9-1894f4a3489b", &delta.ruleId);
+            delta.allow = 1234;
+            delta.inbound = 1200;
+            delta.outbound = 34;
+
+            std::string buffer;
+            RuleHitCounter::FormatTable({ delta }, 10, buffer);
+            Logger::WriteMessage(buffer.c_str());
+
+            std::string expected =
+                "Rule hits in the last 10 seconds:\r\n"
+                "  Rule Id                                    Hits      Allow       Deny    Inbound   Outbound\r\n"
+                "  43cff06e-a520-4ad3-9fd9-1894f4a3489b       1234       1234          0       1200         34\r\n"
+                "\r\n";
+            Assert::IsTrue(buffer == expected);
+
+            buffer.clear();
+            RuleHitCounter::FormatCsv({ delta }, 131492977481230000LL, buffer);
+            Assert::IsTrue(buffer == "2017-09-07T22:42:28.123Z,43cff06e-a520-4ad3-9fd9-1894f4a3489b,1234,0,1200,34\r\n");
+        }
+
+    private:
+        static void AddHits(
+            RuleHitCounter& counter,
+            const std::wstring& ruleId,
+            const std::wstring& ruleType,
+            const std::wstring& direction,
+            unsigned long long count)
+        {
+            VfpEventData eventData;
+            eventData.ruleId = ruleId;
+            eventData.ruleType = ruleType;
+            eventData.direction = direction;
+            for (unsigned long long i = 0; i < count; ++i)
+            {
+                counter.AddHit(eventData);
+            }
+        }
+    };
+}
\ No newline at end of file
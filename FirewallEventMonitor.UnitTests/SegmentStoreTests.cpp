@@ -0,0 +1,368 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "SegmentFormat.h"
+#include "SegmentQuery.h"
+#include "SegmentWriter.h"
+#include "BinaryEventFormat.h"
+// c++ headers
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(SegmentStoreTests)
+    {
+    public:
+
+        TEST_METHOD(SealedSegmentReadsBack)
+        {
+            Logger::WriteMessage(L"SealedSegmentReadsBack");
+
+            SegmentBuilder builder;
+            std::vector<VfpEventData> events;
+            for (unsigned long i = 0; i < 1000; ++i)
+            {
+                events.push_back(MakeEvent(
+                    BaseTimeStamp + (i * TicksPerSecond),
+                    L"10.0.0." + std::to_wstring(1 + (i % 200)),
+                    L"192.168.1.1",
+                    RuleA));
+                events.back().sourcePort = std::to_wstring(50000 + i);
+                builder.Add(events.back());
+            }
+            Assert::AreEqual(1000ull, builder.GetEventCount());
+
+            std::string segment;
+            builder.Seal(segment);
+            Assert::AreEqual(0ull, builder.GetEventCount());
+
+            SegmentFooter footer;
+            size_t bodyLength = SegmentFooter::DecodeSegment(segment.data(), segment.size(), &footer);
+            Assert::AreEqual(1000ull, footer.eventCount);
+            Assert::AreEqual(BaseTimeStamp, footer.minTimeStamp);
+            Assert::AreEqual(BaseTimeStamp + (999 * TicksPerSecond), footer.maxTimeStamp);
+            Assert::AreEqual(50000ul, footer.minSourcePort);
+            Assert::AreEqual(50999ul, footer.maxSourcePort);
+            Assert::AreEqual(443ul, footer.minDestinationPort);
+            Assert::AreEqual(443ul, footer.maxDestinationPort);
+            Assert::AreEqual(0ull, footer.addresslessEvents);
+            Assert::IsTrue(SegmentFooter::InRange(KeyOf(L"10.0.0.100"), footer.minSource, footer.maxSource));
+            Assert::IsFalse(SegmentFooter::InRange(KeyOf(L"10.0.1.1"), footer.minSource, footer.maxSource));
+
+            // The body is a binary log on its own.
+            BinaryEventDecoder decoder;
+            size_t offset = BinaryEventDecoder::DecodeHeader(segment.data(), bodyLength);
+            size_t decoded = 0;
+            VfpEventData eventData;
+            while (offset < bodyLength)
+            {
+                bool eventDecoded = false;
+                size_t consumed = decoder.DecodeRecord(segment.data() + offset, bodyLength - offset, &eventData, &eventDecoded);
+                Assert::AreNotEqual(static_cast<size_t>(0), consumed);
+                offset += consumed;
+                if (eventDecoded)
+                {
+                    Assert::IsTrue(events[decoded].source == eventData.source);
+                    Assert::IsTrue(events[decoded].sourcePort == eventData.sourcePort);
+                    Assert::AreEqual(events[decoded].timeStamp, eventData.timeStamp);
+                    ++decoded;
+                }
+            }
+            Assert::AreEqual(events.size(), decoded);
+
+            // The next segment starts from scratch.
+            builder.Add(events[0]);
+            std::string next;
+            builder.Seal(next);
+            SegmentFooter nextFooter;
+            SegmentFooter::DecodeSegment(next.data(), next.size(), &nextFooter);
+            Assert::AreEqual(1ull, nextFooter.eventCount);
+            Assert::AreEqual(50000ul, nextFooter.maxSourcePort);
+        }
+
+        TEST_METHOD(FooterRulesOutSegments)
+        {
+            Logger::WriteMessage(L"FooterRulesOutSegments");
+
+            // An older segment of 10.0.0.1 and 10.0.0.9 hitting rule A, a newer one of 172.16.0.1 hitting rule B.
+            SegmentFooter older = BuildFooter({
+                MakeEvent(BaseTimeStamp, L"10.0.0.1", L"192.168.1.1", RuleA),
+                MakeEvent(BaseTimeStamp + TicksPerSecond, L"10.0.0.9", L"192.168.1.1", RuleA) });
+            SegmentFooter newer = BuildFooter({
+                MakeEvent(BaseTimeStamp + (3600 * TicksPerSecond), L"172.16.0.1", L"192.168.1.2", RuleB) });
+
+            std::vector<std::wstring> none;
+
+            SegmentQuery sourceQuery(Filters({ L"10.0.0.9" }, none, 0));
+            Assert::IsTrue(sourceQuery.CanMatch(older));
+            Assert::IsFalse(sourceQuery.CanMatch(newer));
+
+            // Inside the older segment's address range, but never seen.
+            SegmentQuery gapQuery(Filters({ L"10.0.0.5" }, none, 0));
+            Assert::IsFalse(gapQuery.CanMatch(older));
+
+            SegmentQuery destinationQuery(Filters({ L"192.168.1.2" }, none, 0));
+            Assert::IsFalse(destinationQuery.CanMatch(older));
+            Assert::IsTrue(destinationQuery.CanMatch(newer));
+
+            SegmentQuery ruleQuery(Filters(none, { RuleB }, 0));
+            Assert::IsFalse(ruleQuery.CanMatch(older));
+            Assert::IsTrue(ruleQuery.CanMatch(newer));
+
+            SegmentQuery timeQuery(Filters(none, none, BaseTimeStamp + (1800 * TicksPerSecond)));
+            Assert::IsFalse(timeQuery.CanMatch(older));
+            Assert::IsTrue(timeQuery.CanMatch(newer));
+
+            // Filters that do not parse can only be checked event by event.
+            SegmentQuery textQuery(Filters({ L"not an address" }, none, 0));
+            Assert::IsTrue(textQuery.CanMatch(older));
+            Assert::IsTrue(textQuery.CanMatch(newer));
+
+            // An event without a destination passes any address filter.
+            SegmentFooter addressless = BuildFooter({
+                MakeEvent(BaseTimeStamp, L"10.0.0.1", L"", RuleA) });
+            Assert::AreEqual(1ull, addressless.addresslessEvents);
+            Assert::IsTrue(destinationQuery.CanMatch(addressless));
+        }
+
+        TEST_METHOD(QueryMatchesLikeCapture)
+        {
+            Logger::WriteMessage(L"QueryMatchesLikeCapture");
+
+            SegmentBuilder builder;
+            builder.Add(MakeEvent(BaseTimeStamp, L"10.0.0.1", L"192.168.1.1", RuleA));
+            builder.Add(MakeEvent(BaseTimeStamp, L"192.168.1.1", L"10.0.0.1", RuleB));
+            builder.Add(MakeEvent(BaseTimeStamp, L"10.0.0.2", L"192.168.1.1", RuleA));
+            builder.Add(MakeEvent(BaseTimeStamp, L"10.0.0.2", L"", RuleA));
+            std::string segment;
+            builder.Seal(segment);
+
+            // Either address may match; an empty one does not count against the event.
+            SegmentQuery addressQuery(Filters({ L"10.0.0.1" }, {}, 0));
+            SegmentQueryResults results;
+            std::string text;
+            addressQuery.QuerySegment(segment.data(), segment.size(), text, results);
+            Assert::AreEqual(1ull, results.segmentsScanned);
+            Assert::AreEqual(0ull, results.segmentsSkipped);
+            Assert::AreEqual(4ull, results.eventsScanned);
+            Assert::AreEqual(3ull, results.eventsMatched);
+            Assert::IsTrue(text.find("192.168.1.1") != std::string::npos);
+
+            SegmentQuery ruleQuery(Filters({ L"10.0.0.1" }, { RuleA }, 0));
+            results = SegmentQueryResults{};
+            text.clear();
+            ruleQuery.QuerySegment(segment.data(), segment.size(), text, results);
+            Assert::AreEqual(2ull, results.eventsMatched);
+
+            // Skipped without decoding the events.
+            SegmentQuery missQuery(Filters({ L"172.16.0.1" }, { L"{5E1EF2D1-6A1B-4A83-9A6C-8C1F9E2D3B4A}" }, 0));
+            results = SegmentQueryResults{};
+            text.clear();
+            missQuery.QuerySegment(segment.data(), segment.size(), text, results);
+            Assert::AreEqual(1ull, results.segmentsSkipped);
+            Assert::AreEqual(0ull, results.eventsScanned);
+            Assert::IsTrue(text.empty());
+        }
+
+        TEST_METHOD(QueryAppliesEveryPredicate)
+        {
+            Logger::WriteMessage(L"QueryAppliesEveryPredicate");
+
+            std::vector<VfpEventData> events = {
+                MakeEvent(BaseTimeStamp, L"10.0.0.1", L"192.168.1.1", RuleA),
+                MakeEvent(BaseTimeStamp, L"10.0.0.2", L"192.168.1.1", RuleA) };
+            events[1].destinationPort = L"3389";
+            events[1].ruleType = L"Deny";
+            events[1].protocol = L"UDP";
+            SegmentFooter footer = BuildFooter(events);
+
+            // Ports outside the footer's ranges rule the segment out.
+            Parameters parameters;
+            parameters.portFilters = { L"22" };
+            Assert::IsFalse(SegmentQuery(EventPredicate(parameters, 0)).CanMatch(footer));
+
+            parameters.portFilters = { L"3389" };
+            SegmentQuery portQuery(EventPredicate(parameters, 0));
+            Assert::IsTrue(portQuery.CanMatch(footer));
+            Assert::IsFalse(portQuery.Matches(events[0]));
+            Assert::IsTrue(portQuery.Matches(events[1]));
+
+            parameters.portFilters.clear();
+            parameters.actionFilter = L"Deny";
+            SegmentQuery actionQuery(EventPredicate(parameters, 0));
+            Assert::IsFalse(actionQuery.Matches(events[0]));
+            Assert::IsTrue(actionQuery.Matches(events[1]));
+
+            parameters.actionFilter.clear();
+            parameters.protocolFilters = { L"UDP" };
+            SegmentQuery protocolQuery(EventPredicate(parameters, 0));
+            Assert::IsFalse(protocolQuery.Matches(events[0]));
+            Assert::IsTrue(protocolQuery.Matches(events[1]));
+        }
+
+        TEST_METHOD(CorruptSegmentsAreRejected)
+        {
+            Logger::WriteMessage(L"CorruptSegmentsAreRejected");
+
+            SegmentBuilder builder;
+            builder.Add(MakeEvent(BaseTimeStamp, L"10.0.0.1", L"192.168.1.1", RuleA));
+            std::string segment;
+            builder.Seal(segment);
+
+            SegmentFooter footer;
+            Assert::ExpectException<std::exception>([&]()
+            {
+                SegmentFooter::DecodeSegment(segment.data(), segment.size() - 1, &footer);
+            });
+            Assert::ExpectException<std::exception>([&]()
+            {
+                std::string binaryLog;
+                BinaryEventEncoder encoder;
+                encoder.Reset(binaryLog);
+                encoder.Encode(MakeEvent(BaseTimeStamp, L"10.0.0.1", L"192.168.1.1", RuleA), binaryLog);
+                SegmentFooter::DecodeSegment(binaryLog.data(), binaryLog.size(), &footer);
+            });
+
+            // A footer length reaching past the body.
+            std::string tooLong(segment);
+            tooLong[tooLong.size() - SegmentTrailerSize + 3] = static_cast<char>(0x7F);
+            Assert::ExpectException<std::exception>([&]()
+            {
+                SegmentFooter::DecodeSegment(tooLong.data(), tooLong.size(), &footer);
+            });
+        }
+
+        TEST_METHOD(SegmentFilesSortInWriteOrder)
+        {
+            Logger::WriteMessage(L"SegmentFilesSortInWriteOrder");
+
+            std::vector<std::wstring> fileNames = {
+                L"FirewallEventMonitor.20170914T224229.seg",
+                L"FirewallEventMonitor.20170914T224228.10.seg",
+                L"FirewallEventMonitor.20170914T224228.2.seg",
+                L"FirewallEventMonitor.20170914T224228.1.seg",
+                L"FirewallEventMonitor.20170914T224228.seg" };
+            SegmentQuery::SortSegmentFileNames(fileNames);
+
+            std::vector<std::wstring> expected = {
+                L"FirewallEventMonitor.20170914T224228.seg",
+                L"FirewallEventMonitor.20170914T224228.1.seg",
+                L"FirewallEventMonitor.20170914T224228.2.seg",
+                L"FirewallEventMonitor.20170914T224228.10.seg",
+                L"FirewallEventMonitor.20170914T224229.seg" };
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                Assert::AreEqual(expected[i], fileNames[i]);
+            }
+        }
+
+        TEST_METHOD(WriterSealsFullSegmentsOnMaintenance)
+        {
+            Logger::WriteMessage(L"WriterSealsFullSegmentsOnMaintenance");
+
+            std::wstring directory = FileLogger(L"").GetLogDirectory() + L"\\SegmentWriterTest";
+            ::CreateDirectoryW(directory.c_str(), NULL);
+
+            LogRotationPolicy policy;
+            policy.maxFileAgeInSeconds = 0;
+            {
+                SegmentWriter writer(directory, policy, 2);
+                for (unsigned long i = 0; i < 5; ++i)
+                {
+                    writer.WriteEvent(MakeEvent(BaseTimeStamp + i, L"10.0.0.1", L"192.168.1.1", RuleA));
+                }
+
+                // Full segments wait for the main loop to seal and write them.
+                Assert::AreEqual(0ull, writer.GetSegmentsWritten());
+                writer.MaintenanceCheck();
+                Assert::AreEqual(2ull, writer.GetSegmentsWritten());
+
+                writer.Close();
+                Assert::AreEqual(3ull, writer.GetSegmentsWritten());
+            }
+
+            std::vector<std::wstring> none;
+            SegmentQuery query(Filters(none, none, 0));
+            SegmentQueryResults results = query.Run(directory);
+            Assert::AreEqual(3ull, results.segmentsScanned);
+            Assert::AreEqual(5ull, results.eventsScanned);
+
+            std::wstring pattern = directory + L"\\FirewallEventMonitor.*.seg";
+            WIN32_FIND_DATAW findData;
+            HANDLE find = ::FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, NULL, 0);
+            Assert::IsTrue(find != INVALID_HANDLE_VALUE);
+            do
+            {
+                ::DeleteFileW((directory + L"\\" + findData.cFileName).c_str());
+            } while (::FindNextFileW(find, &findData));
+            ::FindClose(find);
+        }
+
+    private:
+        // 2017-09-14 22:42:28 UTC
+        const LONGLONG BaseTimeStamp = 131499025480000000;
+        const LONGLONG TicksPerSecond = 10000000;
+        const std::wstring RuleA = L"43cff06e-a520-4ad3-9fd9-1894f4a3489b";
+        const std::wstring RuleB = L"{0B5A3C2E-8F47-4D21-9C1B-77E6A0D4F5C3}";
+
+        static VfpEventData MakeEvent(
+            LONGLONG timeStamp,
+            const std::wstring& source,
+            const std::wstring& destination,
+            const std::wstring& ruleId)
+        {
+            VfpEventData eventData;
+            eventData.timeStamp = timeStamp;
+            eventData.direction = L"Inbound";
+            eventData.ruleType = L"Allow";
+            eventData.portId = L"4";
+            eventData.source = source;
+            eventData.destination = destination;
+            eventData.protocol = L"TCP";
+            eventData.sourcePort = L"49152";
+            eventData.destinationPort = L"443";
+            eventData.ruleId = ruleId;
+            return eventData;
+        }
+
+        static EventPredicate Filters(
+            const std::vector<std::wstring>& ipAddressFilters,
+            const std::vector<std::wstring>& ruleIdFilters,
+            LONGLONG minimumTimeStamp)
+        {
+            Parameters parameters;
+            parameters.ipAddressFilters = ipAddressFilters;
+            parameters.ruleIdFilters = ruleIdFilters;
+            return EventPredicate(parameters, minimumTimeStamp);
+        }
+
+        static SegmentFooter BuildFooter(const std::vector<VfpEventData>& events)
+        {
+            SegmentBuilder builder;
+            for (const auto& eventData : events)
+            {
+                builder.Add(eventData);
+            }
+
+            std::string segment;
+            builder.Seal(segment);
+
+            SegmentFooter footer;
+            SegmentFooter::DecodeSegment(segment.data(), segment.size(), &footer);
+            return footer;
+        }
+
+        static EventKey KeyOf(const std::wstring& address)
+        {
+            EventKey key;
+            EventKeys::ParseAddress(address, &key);
+            return key;
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "SelfMetrics.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(SelfMetricsTests)
+    {
+    public:
+
+        TEST_METHOD(FormatPrometheusWritesCountersAndGauges)
+        {
+            Logger::WriteMessage(L"FormatPrometheusWritesCountersAndGauges");
+
+            SelfMetrics metrics;
+            metrics.AddStage(SelfMetrics::Received);
+            metrics.AddStage(SelfMetrics::Received);
+            metrics.AddStage(SelfMetrics::Received);
+            metrics.AddStage(SelfMetrics::Processed);
+            metrics.AddDrop(SelfMetrics::Throttled);
+            metrics.AddDrop(SelfMetrics::Throttled);
+            Assert::AreEqual(3ull, metrics.GetStageCount(SelfMetrics::Received));
+            Assert::AreEqual(2ull, metrics.GetDropCount(SelfMetrics::Throttled));
+
+            SelfMetricsGauges gauges;
+            gauges.logs.push_back(LogMetrics{ "binary", 4096, 2 });
+            gauges.activeFlows = 17;
+            gauges.workingSetBytes = 1048576;
+
+            std::string buffer;
+            metrics.FormatPrometheus(gauges, nullptr, buffer);
+            Logger::WriteMessage(buffer.c_str());
+
+            Assert::IsTrue(buffer.find("# TYPE firewalleventmonitor_events_total counter\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_events_total{stage=\"received\"} 3\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_events_total{stage=\"decoded\"} 0\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_events_total{stage=\"processed\"} 1\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_events_dropped_total{reason=\"throttled\"} 2\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_queue_depth{queue=\"flows\"} 17\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_log_bytes_written_total{log=\"binary\"} 4096\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_log_rotations_total{log=\"binary\"} 2\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_working_set_bytes 1048576\n") != std::string::npos);
+
+            // No histograms without a latency monitor.
+            Assert::IsTrue(buffer.find("histogram") == std::string::npos);
+        }
+
+        TEST_METHOD(FormatPrometheusWritesLatencyHistograms)
+        {
+            Logger::WriteMessage(L"FormatPrometheusWritesLatencyHistograms");
+
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+
+            LatencyMonitor monitor;
+            // One millisecond of Collect, twice.
+            monitor.RecordStage(LatencyMonitor::Collect, 0, frequency.QuadPart / 1000);
+            monitor.RecordStage(LatencyMonitor::Collect, 0, frequency.QuadPart / 1000);
+            monitor.RecordAllocations(LatencyMonitor::Collect, 3, 96);
+
+            SelfMetrics metrics;
+            std::string buffer;
+            metrics.FormatPrometheus(SelfMetricsGauges(), &monitor, buffer);
+            Logger::WriteMessage(buffer.c_str());
+
+            Assert::IsTrue(buffer.find("# TYPE firewalleventmonitor_stage_duration_seconds histogram\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_stage_duration_seconds_bucket{stage=\"collect\",le=\"1e-06\"} 0\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_stage_duration_seconds_bucket{stage=\"collect\",le=\"0.0025\"} 2\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_stage_duration_seconds_bucket{stage=\"collect\",le=\"+Inf\"} 2\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_stage_duration_seconds_count{stage=\"collect\"} 2\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_stage_duration_seconds_count{stage=\"filter\"} 0\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_stage_allocations_total{stage=\"collect\"} 3\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_stage_allocated_bytes_total{stage=\"collect\"} 96\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_stage_allocations_total{stage=\"filter\"} 0\n") != std::string::npos);
+            Assert::IsTrue(buffer.find("firewalleventmonitor_event_age_seconds_bucket{le=\"+Inf\"} 0\n") != std::string::npos);
+        }
+    };
+}
\ No newline at end of file
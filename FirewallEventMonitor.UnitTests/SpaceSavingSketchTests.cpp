@@ -0,0 +1,121 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "SpaceSavingSketch.h"
+// c++ headers
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(SpaceSavingSketchTests)
+    {
+    public:
+
+        TEST_METHOD(CountsAreExactBelowCapacity)
+        {
+            Logger::WriteMessage(L"CountsAreExactBelowCapacity");
+
+            SpaceSavingSketch sketch(10);
+            for (unsigned int key = 1; key <= 10; ++key)
+            {
+                for (unsigned int i = 0; i < key; ++i)
+                {
+                    sketch.Add(MakeKey(key));
+                }
+            }
+            Assert::AreEqual(55ull, sketch.GetTotal());
+
+            std::vector<SpaceSavingSketch::Entry> top;
+            sketch.GetTop(3, top);
+            Assert::AreEqual(static_cast<size_t>(3), top.size());
+            for (size_t i = 0; i < top.size(); ++i)
+            {
+                Assert::AreEqual(static_cast<unsigned int>(10 - i), ReadKey(top[i].key));
+                Assert::AreEqual(static_cast<unsigned long long>(10 - i), top[i].count);
+                Assert::AreEqual(0ull, top[i].error);
+            }
+
+            sketch.Reset();
+            sketch.GetTop(3, top);
+            Assert::IsTrue(top.empty());
+            Assert::AreEqual(0ull, sketch.GetTotal());
+        }
+
+        TEST_METHOD(ErrorBoundHoldsAfterEvictions)
+        {
+            Logger::WriteMessage(L"ErrorBoundHoldsAfterEvictions");
+
+            // A few heavy keys hidden in a long tail of keys seen once or twice.
+            const size_t capacity = 50;
+            SpaceSavingSketch sketch(capacity);
+            std::map<unsigned int, unsigned long long> exact;
+            std::mt19937 random(42);
+            std::uniform_int_distribution<unsigned int> tail(100, 100000);
+            for (int i = 0; i < 200000; ++i)
+            {
+                unsigned int key = (i % 4 == 0) ? static_cast<unsigned int>(i % 5) : tail(random);
+                sketch.Add(MakeKey(key));
+                ++exact[key];
+            }
+
+            std::vector<SpaceSavingSketch::Entry> top;
+            sketch.GetTop(capacity, top);
+            Assert::AreEqual(capacity, top.size());
+
+            unsigned long long total = sketch.GetTotal();
+            for (const auto& entry : top)
+            {
+                unsigned long long trueCount = exact[ReadKey(entry.key)];
+                Assert::IsTrue(entry.count >= trueCount);
+                Assert::IsTrue(entry.count - entry.error <= trueCount);
+                Assert::IsTrue(entry.error <= total / capacity);
+            }
+
+            // Every key above total / capacity is reported; the heavy keys lead.
+            for (size_t i = 0; i < 4; ++i)
+            {
+                Assert::IsTrue(ReadKey(top[i].key) < 5);
+            }
+        }
+
+        TEST_METHOD(GetTopDoesNotReallocate)
+        {
+            Logger::WriteMessage(L"GetTopDoesNotReallocate");
+
+            SpaceSavingSketch sketch(16);
+            for (unsigned int key = 0; key < 1000; ++key)
+            {
+                sketch.Add(MakeKey(key));
+            }
+
+            std::vector<SpaceSavingSketch::Entry> top;
+            top.reserve(sketch.GetCapacity());
+            const SpaceSavingSketch::Entry* data = top.data();
+            sketch.GetTop(5, top);
+            Assert::AreEqual(static_cast<size_t>(5), top.size());
+            Assert::IsTrue(data == top.data());
+        }
+
+    private:
+        static SpaceSavingSketch::Key MakeKey(unsigned int value)
+        {
+            SpaceSavingSketch::Key key = {};
+            memcpy_s(key.bytes, sizeof(key.bytes), &value, sizeof(value));
+            return key;
+        }
+
+        static unsigned int ReadKey(const SpaceSavingSketch::Key& key)
+        {
+            unsigned int value;
+            memcpy_s(&value, sizeof(value), key.bytes, sizeof(value));
+            return value;
+        }
+    };
+}
\ No newline at end of file
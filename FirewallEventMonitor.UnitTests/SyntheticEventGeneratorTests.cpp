@@ -0,0 +1,224 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// os headers
+#include <ws2tcpip.h>
+// code under test headers
+#include "SyntheticEventGenerator.h"
+// c++ headers
+#include <climits>
+#include <cmath>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(SyntheticEventGeneratorTests)
+    {
+    public:
+
+        TEST_METHOD(ZipfDrawsFollowTheLaw)
+        {
+            Logger::WriteMessage(L"ZipfDrawsFollowTheLaw");
+
+            ZipfDistribution zipf(10, 1.0);
+            // 1 / H(10), the first harmonic numbers summed.
+            Assert::IsTrue(std::fabs(zipf.GetProbability(0) - 0.3414) < 0.001);
+            Assert::IsTrue(std::fabs(zipf.GetProbability(0) / zipf.GetProbability(9) - 10.0) < 0.001);
+
+            ntl::RandomTwister random(7);
+            const unsigned long draws = 200000;
+            std::vector<unsigned long> counts(10);
+            for (unsigned long i = 0; i < draws; ++i)
+            {
+                ++counts[zipf.Draw(random.uniform_int<unsigned long long>(0, ULLONG_MAX))];
+            }
+
+            for (unsigned long rank = 0; rank < 10; ++rank)
+            {
+                double share = static_cast<double>(counts[rank]) / draws;
+                Assert::IsTrue(std::fabs(share - zipf.GetProbability(rank)) < 0.01);
+            }
+
+            // Exponent 0 is uniform.
+            ZipfDistribution uniform(4, 0.0);
+            Assert::AreEqual(0.25, uniform.GetProbability(3));
+
+            Assert::ExpectException<std::exception>([]() { ZipfDistribution empty(0, 1.0); });
+        }
+
+        TEST_METHOD(SameSeedMakesSameEvents)
+        {
+            Logger::WriteMessage(L"SameSeedMakesSameEvents");
+
+            SyntheticTrafficProfile profile;
+            profile.seed = 42;
+            profile.synFloodFraction = 0.1;
+            profile.icmpSweepFraction = 0.1;
+            SyntheticEventGenerator first(profile);
+            SyntheticEventGenerator second(profile);
+
+            VfpEventData firstEvent;
+            VfpEventData secondEvent;
+            for (int i = 0; i < 1000; ++i)
+            {
+                first.Generate(131499025480000000 + i, firstEvent);
+                second.Generate(131499025480000000 + i, secondEvent);
+                Assert::AreEqual(firstEvent.source, secondEvent.source);
+                Assert::AreEqual(firstEvent.destination, secondEvent.destination);
+                Assert::AreEqual(firstEvent.sourcePort, secondEvent.sourcePort);
+                Assert::AreEqual(firstEvent.ruleId, secondEvent.ruleId);
+                Assert::AreEqual(firstEvent.portName, secondEvent.portName);
+            }
+
+            // 2017-09-14 22:42:28 UTC
+            Assert::AreEqual(std::wstring(L"20170914"), firstEvent.date);
+            Assert::AreEqual(std::wstring(L"224228"), firstEvent.time);
+        }
+
+        TEST_METHOD(OrdinaryTrafficMixesFamiliesAndProtocols)
+        {
+            Logger::WriteMessage(L"OrdinaryTrafficMixesFamiliesAndProtocols");
+
+            SyntheticTrafficProfile profile;
+            profile.seed = 7;
+            profile.sourceCount = 1000;
+            profile.ipv6Fraction = 0.3;
+            SyntheticEventGenerator generator(profile);
+
+            const int events = 100000;
+            int ipv6 = 0;
+            int icmp = 0;
+            int busiest = 0;
+            VfpEventData eventData;
+            for (int i = 0; i < events; ++i)
+            {
+                generator.Generate(131499025480000000, eventData);
+                if (eventData.source.find(L':') != std::wstring::npos)
+                {
+                    ++ipv6;
+                    Assert::AreEqual(std::wstring::npos, eventData.destination.find(L'.'));
+                    Assert::AreNotEqual(std::wstring(L"ICMPv4"), eventData.protocol);
+                }
+
+                if (eventData.protocol == L"ICMPv4")
+                {
+                    ++icmp;
+                    Assert::AreEqual(std::wstring(L"V4EchoRequest"), eventData.icmpType);
+                    Assert::IsTrue(eventData.sourcePort.empty());
+                }
+                else
+                {
+                    Assert::IsTrue(eventData.icmpType.empty());
+                    Assert::IsFalse(eventData.destinationPort.empty());
+                }
+
+                if (eventData.source == L"10.0.0.1" ||
+                    eventData.source == L"fd00::1")
+                {
+                    ++busiest;
+                }
+
+                Assert::IsTrue(eventData.direction == L"Inbound" || eventData.direction == L"Outbound");
+                Assert::IsTrue(eventData.ruleType == L"Allow" || eventData.ruleType == L"Deny");
+            }
+
+            Assert::IsTrue(std::fabs(static_cast<double>(ipv6) / events - 0.3) < 0.01);
+            // ICMP is 5% of the IPv4 share.
+            Assert::IsTrue(std::fabs(static_cast<double>(icmp) / events - 0.7 * 0.05) < 0.01);
+            // The busiest of 1000 hosts sends 1 / H(1000) of the traffic, about 13%.
+            Assert::IsTrue(std::fabs(static_cast<double>(busiest) / events - 0.1336) < 0.01);
+        }
+
+        TEST_METHOD(FormatsAsTheLiveDecoderDoes)
+        {
+            Logger::WriteMessage(L"FormatsAsTheLiveDecoderDoes");
+
+            // Enough hosts that some IPv6 sources use both of the last two groups.
+            SyntheticTrafficProfile profile;
+            profile.seed = 7;
+            profile.sourceCount = 100000;
+            profile.zipfExponent = 0.0;
+            profile.ipv6Fraction = 0.5;
+            SyntheticEventGenerator generator(profile);
+
+            VfpEventData eventData;
+            for (int i = 0; i < 10000; ++i)
+            {
+                // 2017-09-14 22:42:28 UTC
+                generator.Generate(131499025480000000, eventData);
+                Assert::AreEqual(std::wstring(L"20170914"), eventData.date);
+                Assert::AreEqual(std::wstring(L"224228"), eventData.time);
+
+                // Addresses read back by Winsock format the same.
+                for (const std::wstring* address : { &eventData.source, &eventData.destination })
+                {
+                    int family = (address->find(L':') != std::wstring::npos) ? AF_INET6 : AF_INET;
+                    IN6_ADDR parsed = {};
+                    Assert::AreEqual(1, ::InetPtonW(family, address->c_str(), &parsed));
+                    WCHAR formatted[INET6_ADDRSTRLEN];
+                    ::InetNtopW(family, &parsed, formatted, ARRAYSIZE(formatted));
+                    Assert::AreEqual(*address, std::wstring(formatted));
+                }
+            }
+        }
+
+        TEST_METHOD(FloodsAndSweepsHaveTheirShapes)
+        {
+            Logger::WriteMessage(L"FloodsAndSweepsHaveTheirShapes");
+
+            SyntheticTrafficProfile flood;
+            flood.seed = 7;
+            flood.synFloodFraction = 1.0;
+            SyntheticEventGenerator floodGenerator(flood);
+
+            std::set<std::wstring> spoofedSources;
+            VfpEventData eventData;
+            for (int i = 0; i < 1000; ++i)
+            {
+                floodGenerator.Generate(131499025480000000, eventData);
+                Assert::AreEqual(std::wstring(L"192.168.0.1"), eventData.destination);
+                Assert::AreEqual(std::wstring(L"443"), eventData.destinationPort);
+                Assert::AreEqual(std::wstring(L"TCP"), eventData.protocol);
+                Assert::AreEqual(std::wstring(L"1"), eventData.isTcpSyn);
+                spoofedSources.insert(eventData.source);
+
+                // Never from private, loopback or the made-up hosts' and servers' space.
+                IN_ADDR source = {};
+                Assert::AreEqual(1, ::InetPtonW(AF_INET, eventData.source.c_str(), &source));
+                unsigned long address = ntohl(source.s_addr);
+                Assert::AreNotEqual(0x0aul, address >> 24);
+                Assert::AreNotEqual(0x7ful, address >> 24);
+                Assert::AreNotEqual(0xac1ul, address >> 20);
+                Assert::AreNotEqual(0xc0a8ul, address >> 16);
+                Assert::IsTrue(address < 0xe0000000);
+            }
+            Assert::IsTrue(spoofedSources.size() > 990);
+
+            SyntheticTrafficProfile sweep;
+            sweep.seed = 7;
+            sweep.icmpSweepFraction = 1.0;
+            SyntheticEventGenerator sweepGenerator(sweep);
+
+            const wchar_t* expected[] = { L"172.16.0.1", L"172.16.0.2", L"172.16.0.3" };
+            for (const auto destination : expected)
+            {
+                sweepGenerator.Generate(131499025480000000, eventData);
+                Assert::AreEqual(std::wstring(L"203.0.113.7"), eventData.source);
+                Assert::AreEqual(std::wstring(destination), eventData.destination);
+                Assert::AreEqual(std::wstring(L"ICMPv4"), eventData.protocol);
+                Assert::IsTrue(eventData.isTcpSyn.empty());
+            }
+
+            SyntheticTrafficProfile invalid;
+            invalid.synFloodFraction = 0.6;
+            invalid.icmpSweepFraction = 0.6;
+            Assert::ExpectException<std::exception>([&]() { SyntheticEventGenerator generator(invalid); });
+        }
+    };
+}
\ No newline at end of file
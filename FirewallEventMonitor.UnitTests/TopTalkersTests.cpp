@@ -0,0 +1,64 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "TopTalkers.h"
+// c++ headers
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(TopTalkersTests)
+    {
+    public:
+
+        TEST_METHOD(ReportListsBusiestKeysAndResets)
+        {
+            Logger::WriteMessage(L"ReportListsBusiestKeysAndResets");
+
+            TopTalkers topTalkers;
+            VfpEventData eventData;
+            eventData.source = L"192.168.100.21";
+            eventData.destination = L"fe80::1";
+            eventData.destinationPort = L"443";
+            eventData.portId = L"4";
+            eventData.ruleId = L"{43CFF06E-A520-4AD3-9FD9-1894F4A3489B}";
+            for (int i = 0; i < 3; ++i)
+            {
+                topTalkers.AddEvent(eventData);
+            }
+            eventData.source = L"10.0.0.1";
+            topTalkers.AddEvent(eventData);
+
+            std::string buffer;
+            topTalkers.Report(TopTalkers::ReportedKeys, 10, buffer);
+            Logger::WriteMessage(buffer.c_str());
+
+            std::string expected =
+                "Top talkers in the last 10 seconds (true count is between count - error and count):\r\n"
+                "  Source (4 events)                             Count      Error\r\n"
+                "    192.168.100.21                                  3          0\r\n"
+                "    10.0.0.1                                        1          0\r\n"
+                "  Destination (4 events)                        Count      Error\r\n"
+                "    fe80::1                                         4          0\r\n"
+                "  Destination port (4 events)                   Count      Error\r\n"
+                "    443                                             4          0\r\n"
+                "  Rule Id (4 events)                            Count      Error\r\n"
+                "    43cff06e-a520-4ad3-9fd9-1894f4a3489b            4          0\r\n"
+                "  Port Id (4 events)                            Count      Error\r\n"
+                "    4                                               4          0\r\n"
+                "\r\n";
+            Assert::IsTrue(buffer == expected);
+
+            // Each report covers only its own interval.
+            buffer.clear();
+            topTalkers.Report(TopTalkers::ReportedKeys, 10, buffer);
+            Assert::IsTrue(buffer.find("Source (0 events)") != std::string::npos);
+            Assert::IsTrue(buffer.find("    none\r\n") != std::string::npos);
+        }
+    };
+}
\ No newline at end of file
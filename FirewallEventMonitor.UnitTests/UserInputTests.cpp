@@ -107,6 +107,160 @@ namespace UserInputUnitTest
             Assert::IsTrue(result == ArgumentParsingResults::Success);
         }
 
+        TEST_METHOD(ParseQueryPredicatesRequireQueryOrInput)
+        {
+            Logger::WriteMessage(L"ParseQueryPredicatesRequireQueryOrInput");
+
+            args.clear();
+            args.push_back(L"-Port");
+            args.push_back(L"443,03389");
+            args.push_back(L"-Protocol");
+            args.push_back(L"tcp");
+            Assert::IsFalse(input.ParsePortFilters(args));
+
+            args.push_back(L"-Input");
+            args.push_back(L"host1.etl,host2.etl");
+            Assert::IsTrue(input.ParseInput(args));
+            Assert::IsTrue(input.ParsePortFilters(args));
+            Assert::IsTrue(input.ParseProtocolFilters(args));
+
+            auto parameters = input.GetParameters();
+            Assert::AreEqual(static_cast<size_t>(2), parameters.inputFilePaths.size());
+            Assert::AreEqual(std::wstring(L"3389"), parameters.portFilters[1]);
+            Assert::AreEqual(std::wstring(L"TCP"), parameters.protocolFilters[0]);
+
+            // Segment queries take the same predicates.
+            UserInput queryInput;
+            args.clear();
+            args.push_back(L"-Query");
+            args.push_back(L"C:\\temp");
+            args.push_back(L"-Action");
+            args.push_back(L"deny");
+            Assert::IsTrue(queryInput.ParseQuery(args));
+            Assert::IsTrue(queryInput.ParseAction(args));
+            Assert::AreEqual(std::wstring(L"Deny"), queryInput.GetParameters().actionFilter);
+
+            Assert::IsFalse(input.ValidatePort(L"65536"));
+            Assert::IsFalse(input.ValidateProtocol(L"SCTP"));
+        }
+
+        TEST_METHOD(ParseReplaySpeed)
+        {
+            Logger::WriteMessage(L"ParseReplaySpeed");
+
+            args.clear();
+            args.push_back(L"-ReplaySpeed");
+            args.push_back(L"max");
+            Assert::IsFalse(input.ParseReplaySpeed(args));
+
+            args.push_back(L"-Replay");
+            args.push_back(L"host1.bin");
+            Assert::IsTrue(input.ParseReplay(args));
+            Assert::IsTrue(input.ParseReplaySpeed(args));
+            Assert::AreEqual(0.0, input.GetParameters().replaySpeed);
+
+            args[1] = L"2.5";
+            Assert::IsTrue(input.ParseReplaySpeed(args));
+            Assert::AreEqual(2.5, input.GetParameters().replaySpeed);
+
+            args[1] = L"0";
+            Assert::IsFalse(input.ParseReplaySpeed(args));
+        }
+
+        TEST_METHOD(ParseDecodeThreads)
+        {
+            Logger::WriteMessage(L"ParseDecodeThreads");
+
+            args.clear();
+            Assert::IsTrue(input.ParseDecodeThreads(args));
+            Assert::AreEqual(0ul, input.GetParameters().decodeThreads);
+
+            args.push_back(L"-DecodeThreads");
+            args.push_back(L"16");
+            Assert::IsTrue(input.ParseDecodeThreads(args));
+            Assert::AreEqual(16ul, input.GetParameters().decodeThreads);
+
+            args[1] = L"0";
+            Assert::IsFalse(input.ParseDecodeThreads(args));
+        }
+
+        TEST_METHOD(ParseMetrics)
+        {
+            Logger::WriteMessage(L"ParseMetrics");
+
+            args.clear();
+            Assert::IsTrue(input.ParseMetrics(args));
+            Assert::AreEqual(0ul, input.GetParameters().metricsIntervalInSeconds);
+
+            args.push_back(L"-Metrics");
+            args.push_back(L"15");
+            Assert::IsTrue(input.ParseMetrics(args));
+            Assert::AreEqual(15ul, input.GetParameters().metricsIntervalInSeconds);
+
+            args[1] = L"0";
+            Assert::IsFalse(input.ParseMetrics(args));
+        }
+
+        TEST_METHOD(ParseSynthetic)
+        {
+            Logger::WriteMessage(L"ParseSynthetic");
+
+            args.clear();
+            args.push_back(L"-Synthetic");
+            args.push_back(L"max");
+            Assert::IsTrue(input.ParseSynthetic(args));
+            Assert::IsTrue(input.GetParameters().synthetic);
+            Assert::AreEqual(0ul, input.GetParameters().syntheticEventsPerSecond);
+
+            args[1] = L"1000000";
+            Assert::IsTrue(input.ParseSynthetic(args));
+            Assert::AreEqual(1000000ul, input.GetParameters().syntheticEventsPerSecond);
+
+            args[1] = L"0";
+            Assert::IsFalse(input.ParseSynthetic(args));
+
+            UserInput replaying;
+            args[1] = L"Max";
+            args.push_back(L"-Replay");
+            args.push_back(L"host1.bin");
+            Assert::IsTrue(replaying.ParseReplay(args));
+            Assert::IsFalse(replaying.ParseSynthetic(args));
+        }
+
+        TEST_METHOD(ParseSyntheticMix)
+        {
+            Logger::WriteMessage(L"ParseSyntheticMix");
+
+            args.clear();
+            args.push_back(L"-SyntheticMix");
+            args.push_back(L"Sources=500,IPv6=50,SynFlood=30,IcmpSweep=5,Zipf=1.2,Rules=10,Seed=7");
+            Assert::IsFalse(input.ParseSyntheticMix(args));
+
+            args.push_back(L"-Synthetic");
+            args.push_back(L"Max");
+            Assert::IsTrue(input.ParseSynthetic(args));
+            Assert::IsTrue(input.ParseSyntheticMix(args));
+            Assert::AreEqual(500ul, input.GetParameters().syntheticSources);
+            Assert::AreEqual(10ul, input.GetParameters().syntheticRules);
+            Assert::AreEqual(1.2, input.GetParameters().syntheticZipfExponent);
+            Assert::AreEqual(50.0, input.GetParameters().syntheticIpv6Percent);
+            Assert::AreEqual(30.0, input.GetParameters().syntheticSynFloodPercent);
+            Assert::AreEqual(5.0, input.GetParameters().syntheticIcmpSweepPercent);
+            Assert::AreEqual(7ul, input.GetParameters().syntheticSeed);
+
+            args[1] = L"IPv6=101";
+            Assert::IsFalse(input.ParseSyntheticMix(args));
+
+            args[1] = L"SynFlood=60,IcmpSweep=60";
+            Assert::IsFalse(input.ParseSyntheticMix(args));
+
+            args[1] = L"Sources=0";
+            Assert::IsFalse(input.ParseSyntheticMix(args));
+
+            args[1] = L"Hosts=10";
+            Assert::IsFalse(input.ParseSyntheticMix(args));
+        }
+
     private:
         UserInput input;
         std::vector<const wchar_t*> args;
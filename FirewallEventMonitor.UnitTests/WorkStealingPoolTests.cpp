@@ -0,0 +1,107 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include <CppUnitTest.h>
+// code under test headers
+#include "WorkStealingPool.h"
+// c++ headers
+#include <atomic>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FirewallEventMonitor;
+
+namespace FirewallEventMonitorUnitTest
+{
+    TEST_CLASS(WorkStealingPoolTests)
+    {
+    public:
+
+        TEST_METHOD(WaitCoversFollowUpTasks)
+        {
+            Logger::WriteMessage(L"WaitCoversFollowUpTasks");
+
+            WorkStealingPool pool(4);
+            Assert::AreEqual(static_cast<size_t>(4), pool.GetWorkerCount());
+
+            std::atomic<unsigned long> ran(0);
+            for (int i = 0; i < 100; ++i)
+            {
+                pool.Submit([&](size_t worker)
+                {
+                    ++ran;
+                    // Each task queues ten more on its own worker.
+                    for (int j = 0; j < 10; ++j)
+                    {
+                        pool.Submit(worker, [&](size_t) { ++ran; });
+                    }
+                });
+            }
+            pool.Wait();
+
+            Assert::AreEqual(1100ul, ran.load());
+            Assert::AreEqual(static_cast<size_t>(0), pool.GetPendingTasks());
+
+            // The pool is reusable after Wait.
+            pool.Submit([&](size_t) { ++ran; });
+            pool.Wait();
+            Assert::AreEqual(1101ul, ran.load());
+        }
+
+        TEST_METHOD(IdleWorkersStealQueuedTasks)
+        {
+            Logger::WriteMessage(L"IdleWorkersStealQueuedTasks");
+
+            WorkStealingPool pool(4);
+            std::atomic<bool> release(false);
+            std::vector<std::atomic<unsigned long>> ranOn(pool.GetWorkerCount());
+            for (auto& count : ranOn)
+            {
+                count = 0;
+            }
+
+            // One worker blocks, like a worker waiting for a file to be read, while its deque fills up.
+            std::atomic<size_t> blocked(pool.GetWorkerCount());
+            pool.Submit([&](size_t worker)
+            {
+                blocked = worker;
+                while (!release)
+                {
+                    ::Sleep(1);
+                }
+            });
+            while (blocked == pool.GetWorkerCount())
+            {
+                ::Sleep(1);
+            }
+            for (int i = 0; i < 200; ++i)
+            {
+                pool.Submit(blocked, [&](size_t worker) { ++ranOn[worker]; });
+            }
+
+            // Only the other workers can run them.
+            while (pool.GetPendingTasks() > 1)
+            {
+                ::Sleep(1);
+            }
+            Assert::AreEqual(0ul, ranOn[blocked].load());
+            Assert::IsTrue(pool.GetStolenTasks() >= 200ull);
+
+            release = true;
+            pool.Wait();
+        }
+
+        TEST_METHOD(TaskExceptionsDoNotStopTheWorker)
+        {
+            Logger::WriteMessage(L"TaskExceptionsDoNotStopTheWorker");
+
+            WorkStealingPool pool(1);
+            std::atomic<unsigned long> ran(0);
+            pool.Submit([&](size_t) { throw std::exception("Task failed"); });
+            pool.Submit([&](size_t) { ++ran; });
+            pool.Wait();
+
+            Assert::AreEqual(1ul, ran.load());
+        }
+    };
+}
\ No newline at end of file
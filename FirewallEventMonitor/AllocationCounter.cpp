@@ -0,0 +1,49 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "AllocationCounter.h"
+
+// c++ headers
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    // Constant-initialized, so reading them needs no guard for their construction.
+    thread_local unsigned long long allocationCount = 0;
+    thread_local unsigned long long allocatedBytes = 0;
+}
+
+// Replace the global operator new and delete of the whole program. The array and nothrow forms
+// of the CRT call these.
+void* __cdecl operator new(size_t size)
+{
+    ++allocationCount;
+    allocatedBytes += size;
+
+    // operator new(0) must still return a unique pointer.
+    void* memory = malloc(size > 0 ? size : 1);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void __cdecl operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+namespace FirewallEventMonitor
+{
+    unsigned long long AllocationCounter::GetAllocationCount()
+    {
+        return allocationCount;
+    }
+
+    unsigned long long AllocationCounter::GetAllocatedBytes()
+    {
+        return allocatedBytes;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+namespace FirewallEventMonitor
+{
+    // Counts the allocations of this program, whose global operator new and delete are replaced
+    // (see AllocationCounter.cpp). Allocations made straight from the heap, as the OS and the CRT
+    // make theirs, are not counted.
+    //
+    // The counts are kept per thread, so counting costs a thread-local increment and no thread
+    // writes a cache line another reads. Take the difference of two reads on the same thread to
+    // count the allocations of the code between them.
+    class AllocationCounter
+    {
+    public:
+        // Calls to operator new on the calling thread since it started.
+        static unsigned long long GetAllocationCount();
+
+        static unsigned long long GetAllocatedBytes();
+    };
+}
\ No newline at end of file
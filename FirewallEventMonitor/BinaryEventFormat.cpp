@@ -0,0 +1,503 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "BinaryEventFormat.h"
+#include "Timer.h"
+
+// os headers
+#include <ws2tcpip.h>
+// ntl headers
+#include "ntlString.hpp"
+
+namespace FirewallEventMonitor
+{
+    // Address field tags.
+    const unsigned char ADDRESS_EMPTY = 0;
+    const unsigned char ADDRESS_STRING = 1;
+    const unsigned char ADDRESS_IPV4 = 4;
+    const unsigned char ADDRESS_IPV6 = 6;
+
+    // ETW events are at most 64KB, so a larger record can only come from a corrupt file.
+    const unsigned long long MAX_RECORD_LENGTH = 64 * 1024;
+
+    const LPCSTR CORRUPT_RECORD_MESSAGE = "Binary log record is corrupt";
+
+    //
+    // Varint
+    //
+
+    void Varint::Append(
+        unsigned long long value,
+        _Inout_ std::string& buffer)
+    {
+        while (value >= 0x80)
+        {
+            buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<char>(value));
+    }
+
+    bool Varint::Read(
+        const char*& data,
+        const char* end,
+        _Out_ unsigned long long* value)
+    {
+        *value = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7)
+        {
+            if (data >= end)
+            {
+                return false;
+            }
+
+            unsigned char byte = static_cast<unsigned char>(*data++);
+            *value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+
+        throw std::exception(CORRUPT_RECORD_MESSAGE);
+    }
+
+    //
+    // BinaryEventEncoder
+    //
+
+    BinaryEventEncoder::BinaryEventEncoder()
+    {
+        m_Payload.reserve(256);
+    }
+
+    void BinaryEventEncoder::Reset(
+        _Inout_ std::string& buffer)
+    {
+        m_Dictionary.clear();
+        m_LastTimeStamp = 0;
+
+        buffer.append(BinaryLogMagic, sizeof(BinaryLogMagic));
+        buffer.push_back(static_cast<char>(BinaryLogVersion));
+    }
+
+    void BinaryEventEncoder::Encode(
+        const VfpEventData& eventData,
+        _Inout_ std::string& buffer)
+    {
+        // Bound memory on long-lived files. Checked once per event so that every id
+        // in this event's payload refers to the same dictionary.
+        if (m_Dictionary.size() >= MaxDictionaryEntries)
+        {
+            m_Dictionary.clear();
+            Varint::Append(1, buffer);
+            buffer.push_back(static_cast<char>(BinaryRecordType::DictionaryReset));
+        }
+
+        m_Payload.clear();
+        m_Payload.push_back(static_cast<char>(BinaryRecordType::Event));
+
+        Varint::Append(Varint::ZigZag(eventData.timeStamp - m_LastTimeStamp), m_Payload);
+        m_LastTimeStamp = eventData.timeStamp;
+
+        EncodeString(eventData.direction, buffer);
+        EncodeString(eventData.ruleType, buffer);
+        EncodeString(eventData.status, buffer);
+        // Port
+        EncodeNumber(eventData.portId, buffer);
+        EncodeString(eventData.portName, buffer);
+        EncodeString(eventData.portFriendlyName, buffer);
+        // Flow
+        EncodeAddress(eventData.source, buffer);
+        EncodeAddress(eventData.destination, buffer);
+        EncodeString(eventData.protocol, buffer);
+        EncodeNumber(eventData.sourcePort, buffer);
+        EncodeNumber(eventData.destinationPort, buffer);
+        EncodeString(eventData.icmpType, buffer);
+        EncodeString(eventData.isTcpSyn, buffer);
+        // Rule
+        EncodeString(eventData.ruleId, buffer);
+        EncodeString(eventData.layerId, buffer);
+        EncodeString(eventData.groupId, buffer);
+        EncodeString(eventData.gftFlags, buffer);
+        // Flow record
+        if (eventData.eventCount > 0)
+        {
+            Varint::Append(eventData.eventCount, m_Payload);
+            Varint::Append(eventData.synCount, m_Payload);
+            Varint::Append(Varint::ZigZag(eventData.lastTimeStamp - eventData.timeStamp), m_Payload);
+        }
+
+        Varint::Append(m_Payload.size(), buffer);
+        buffer.append(m_Payload);
+    }
+
+    unsigned long BinaryEventEncoder::LookupString(
+        const std::wstring& value,
+        _Inout_ std::string& buffer)
+    {
+        if (value.empty())
+        {
+            return 0;
+        }
+
+        auto found = m_Dictionary.find(value);
+        if (found != m_Dictionary.end())
+        {
+            return found->second;
+        }
+
+        unsigned long id = static_cast<unsigned long>(m_Dictionary.size() + 1);
+        m_Dictionary.emplace(value, id);
+
+        // First use in this file: define it ahead of the event that refers to it.
+        std::string record;
+        record.push_back(static_cast<char>(BinaryRecordType::Dictionary));
+        Varint::Append(id, record);
+        ntl::String::append_utf8(value, record);
+
+        Varint::Append(record.size(), buffer);
+        buffer.append(record);
+
+        return id;
+    }
+
+    void BinaryEventEncoder::EncodeString(
+        const std::wstring& value,
+        _Inout_ std::string& buffer)
+    {
+        Varint::Append(LookupString(value, buffer), m_Payload);
+    }
+
+    void BinaryEventEncoder::EncodeNumber(
+        const std::wstring& value,
+        _Inout_ std::string& buffer)
+    {
+        // 0 is empty, odd is (number << 1) | 1, even is (dictionary id << 1).
+        if (value.empty())
+        {
+            m_Payload.push_back(0);
+            return;
+        }
+
+        // Only canonical decimals (no sign or leading zero) are guaranteed to read back unchanged.
+        bool canonical = value.size() <= 9 && (value[0] != L'0' || value.size() == 1);
+        unsigned long long number = 0;
+        for (auto ch : value)
+        {
+            if (!canonical)
+            {
+                break;
+            }
+
+            if (ch < L'0' || ch > L'9')
+            {
+                canonical = false;
+                break;
+            }
+            number = (number * 10) + (ch - L'0');
+        }
+
+        if (canonical)
+        {
+            Varint::Append((number << 1) | 1, m_Payload);
+        }
+        else
+        {
+            Varint::Append(static_cast<unsigned long long>(LookupString(value, buffer)) << 1, m_Payload);
+        }
+    }
+
+    void BinaryEventEncoder::EncodeAddress(
+        const std::wstring& value,
+        _Inout_ std::string& buffer)
+    {
+        if (value.empty())
+        {
+            m_Payload.push_back(ADDRESS_EMPTY);
+            return;
+        }
+
+        // Only take the compact form when it formats back to the same text.
+        WCHAR formatted[INET6_ADDRSTRLEN] = { 0 };
+
+        IN_ADDR ipv4;
+        if (::InetPtonW(AF_INET, value.c_str(), &ipv4) == 1 &&
+            ::InetNtopW(AF_INET, &ipv4, formatted, ARRAYSIZE(formatted)) != NULL &&
+            value.compare(formatted) == 0)
+        {
+            m_Payload.push_back(ADDRESS_IPV4);
+            m_Payload.append(reinterpret_cast<const char*>(&ipv4), sizeof(ipv4));
+            return;
+        }
+
+        IN6_ADDR ipv6;
+        if (::InetPtonW(AF_INET6, value.c_str(), &ipv6) == 1 &&
+            ::InetNtopW(AF_INET6, &ipv6, formatted, ARRAYSIZE(formatted)) != NULL &&
+            value.compare(formatted) == 0)
+        {
+            m_Payload.push_back(ADDRESS_IPV6);
+            m_Payload.append(reinterpret_cast<const char*>(&ipv6), sizeof(ipv6));
+            return;
+        }
+
+        m_Payload.push_back(ADDRESS_STRING);
+        Varint::Append(LookupString(value, buffer), m_Payload);
+    }
+
+    //
+    // BinaryEventDecoder
+    //
+
+    size_t BinaryEventDecoder::DecodeHeader(
+        _In_reads_bytes_(length) const char* data,
+        size_t length)
+    {
+        if (length < BinaryLogHeaderSize ||
+            memcmp(data, BinaryLogMagic, sizeof(BinaryLogMagic)) != 0)
+        {
+            throw std::exception("File is not a binary event log");
+        }
+
+        if (static_cast<unsigned char>(data[sizeof(BinaryLogMagic)]) != BinaryLogVersion)
+        {
+            throw std::exception("Binary event log version is not supported");
+        }
+
+        return BinaryLogHeaderSize;
+    }
+
+    void BinaryEventDecoder::Reset()
+    {
+        m_Dictionary.clear();
+        m_LastTimeStamp = 0;
+    }
+
+    size_t BinaryEventDecoder::DecodeRecord(
+        _In_reads_bytes_(length) const char* data,
+        size_t length,
+        _Out_ VfpEventData* eventData,
+        _Out_ bool* eventDecoded)
+    {
+        *eventDecoded = false;
+
+        const char* current = data;
+        const char* end = data + length;
+
+        unsigned long long recordLength;
+        if (!Varint::Read(current, end, &recordLength))
+        {
+            return 0;
+        }
+
+        if (recordLength == 0 ||
+            recordLength > MAX_RECORD_LENGTH)
+        {
+            throw std::exception(CORRUPT_RECORD_MESSAGE);
+        }
+
+        if (recordLength > static_cast<unsigned long long>(end - current))
+        {
+            return 0;
+        }
+
+        const char* recordEnd = current + recordLength;
+        auto type = static_cast<BinaryRecordType>(*current++);
+        switch (type)
+        {
+        case BinaryRecordType::Dictionary:
+        {
+            unsigned long long id;
+            if (!Varint::Read(current, recordEnd, &id) ||
+                id != m_Dictionary.size() + 1)
+            {
+                throw std::exception(CORRUPT_RECORD_MESSAGE);
+            }
+
+            std::wstring value;
+            int utf8Length = static_cast<int>(recordEnd - current);
+            if (utf8Length > 0)
+            {
+                int wideLength = ::MultiByteToWideChar(CP_UTF8, 0, current, utf8Length, NULL, 0);
+                value.resize(wideLength);
+                ::MultiByteToWideChar(CP_UTF8, 0, current, utf8Length, &value[0], wideLength);
+            }
+            m_Dictionary.push_back(std::move(value));
+            break;
+        }
+
+        case BinaryRecordType::Event:
+            DecodeEvent(current, recordEnd, eventData);
+            *eventDecoded = true;
+            break;
+
+        case BinaryRecordType::DictionaryReset:
+            m_Dictionary.clear();
+            break;
+
+        default:
+            // Skip record types added by later versions.
+            break;
+        }
+
+        return static_cast<size_t>(recordEnd - data);
+    }
+
+    void BinaryEventDecoder::DecodeEvent(
+        const char*& data,
+        const char* end,
+        _Out_ VfpEventData* eventData)
+    {
+        unsigned long long delta;
+        if (!Varint::Read(data, end, &delta))
+        {
+            throw std::exception(CORRUPT_RECORD_MESSAGE);
+        }
+        m_LastTimeStamp += Varint::UnZigZag(delta);
+        eventData->timeStamp = m_LastTimeStamp;
+
+        LARGE_INTEGER timeStamp;
+        timeStamp.QuadPart = m_LastTimeStamp;
+        Timer::GetDateAndTime(timeStamp, &eventData->date, &eventData->time);
+
+        eventData->direction = DecodeString(data, end);
+        eventData->ruleType = DecodeString(data, end);
+        eventData->status = DecodeString(data, end);
+        // Port
+        DecodeNumber(data, end, &eventData->portId);
+        eventData->portName = DecodeString(data, end);
+        eventData->portFriendlyName = DecodeString(data, end);
+        // Flow
+        DecodeAddress(data, end, &eventData->source);
+        DecodeAddress(data, end, &eventData->destination);
+        eventData->protocol = DecodeString(data, end);
+        DecodeNumber(data, end, &eventData->sourcePort);
+        DecodeNumber(data, end, &eventData->destinationPort);
+        eventData->icmpType = DecodeString(data, end);
+        eventData->isTcpSyn = DecodeString(data, end);
+        // Rule
+        eventData->ruleId = DecodeString(data, end);
+        eventData->layerId = DecodeString(data, end);
+        eventData->groupId = DecodeString(data, end);
+        eventData->gftFlags = DecodeString(data, end);
+        // Flow record
+        eventData->eventCount = 0;
+        eventData->synCount = 0;
+        eventData->lastTimeStamp = 0;
+        if (data < end)
+        {
+            unsigned long long lastDelta;
+            if (!Varint::Read(data, end, &eventData->eventCount) ||
+                !Varint::Read(data, end, &eventData->synCount) ||
+                !Varint::Read(data, end, &lastDelta))
+            {
+                throw std::exception(CORRUPT_RECORD_MESSAGE);
+            }
+            eventData->lastTimeStamp = eventData->timeStamp + Varint::UnZigZag(lastDelta);
+        }
+    }
+
+    const std::wstring& BinaryEventDecoder::DecodeString(
+        const char*& data,
+        const char* end)
+    {
+        static const std::wstring empty;
+
+        unsigned long long id;
+        if (!Varint::Read(data, end, &id) ||
+            id > m_Dictionary.size())
+        {
+            throw std::exception(CORRUPT_RECORD_MESSAGE);
+        }
+
+        return (id == 0) ? empty : m_Dictionary[static_cast<size_t>(id - 1)];
+    }
+
+    void BinaryEventDecoder::DecodeNumber(
+        const char*& data,
+        const char* end,
+        _Out_ std::wstring* value)
+    {
+        unsigned long long encoded;
+        if (!Varint::Read(data, end, &encoded))
+        {
+            throw std::exception(CORRUPT_RECORD_MESSAGE);
+        }
+
+        if (encoded == 0)
+        {
+            value->clear();
+        }
+        else if ((encoded & 1) != 0)
+        {
+            *value = std::to_wstring(encoded >> 1);
+        }
+        else
+        {
+            unsigned long long id = encoded >> 1;
+            if (id > m_Dictionary.size())
+            {
+                throw std::exception(CORRUPT_RECORD_MESSAGE);
+            }
+            *value = m_Dictionary[static_cast<size_t>(id - 1)];
+        }
+    }
+
+    void BinaryEventDecoder::DecodeAddress(
+        const char*& data,
+        const char* end,
+        _Out_ std::wstring* value)
+    {
+        if (data >= end)
+        {
+            throw std::exception(CORRUPT_RECORD_MESSAGE);
+        }
+
+        unsigned char tag = static_cast<unsigned char>(*data++);
+        WCHAR formatted[INET6_ADDRSTRLEN] = { 0 };
+
+        switch (tag)
+        {
+        case ADDRESS_EMPTY:
+            value->clear();
+            break;
+
+        case ADDRESS_STRING:
+            *value = DecodeString(data, end);
+            break;
+
+        case ADDRESS_IPV4:
+        {
+            IN_ADDR ipv4;
+            if (static_cast<size_t>(end - data) < sizeof(ipv4))
+            {
+                throw std::exception(CORRUPT_RECORD_MESSAGE);
+            }
+            memcpy_s(&ipv4, sizeof(ipv4), data, sizeof(ipv4));
+            data += sizeof(ipv4);
+
+            ::InetNtopW(AF_INET, &ipv4, formatted, ARRAYSIZE(formatted));
+            value->assign(formatted);
+            break;
+        }
+
+        case ADDRESS_IPV6:
+        {
+            IN6_ADDR ipv6;
+            if (static_cast<size_t>(end - data) < sizeof(ipv6))
+            {
+                throw std::exception(CORRUPT_RECORD_MESSAGE);
+            }
+            memcpy_s(&ipv6, sizeof(ipv6), data, sizeof(ipv6));
+            data += sizeof(ipv6);
+
+            ::InetNtopW(AF_INET6, &ipv6, formatted, ARRAYSIZE(formatted));
+            value->assign(formatted);
+            break;
+        }
+
+        default:
+            throw std::exception(CORRUPT_RECORD_MESSAGE);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    //
+    // Binary log layout (.bin):
+    //   header  : 8 bytes, BinaryLogMagic followed by BinaryLogVersion.
+    //   records : varint length of (type + payload), 1 byte type, payload.
+    //
+    // Strings with few distinct values (GUIDs, labels) are written once per file as
+    // Dictionary records and referenced by id. Timestamps are deltas from the previous
+    // event, ports are varints and addresses are stored in network byte order.
+    //
+    enum class BinaryRecordType : unsigned char
+    {
+        // varint id, UTF-8 string.
+        Dictionary = 1,
+        // Event fields in BinaryEventEncoder::Encode order. Flow records append
+        // varint count, varint SYN count and the zigzag last - first timestamp delta.
+        Event = 2,
+        // Clears the dictionary; ids restart at 1.
+        DictionaryReset = 3,
+    };
+
+    const char BinaryLogMagic[7] = { 'F', 'W', 'E', 'M', 'B', 'I', 'N' };
+    const unsigned char BinaryLogVersion = 1;
+    const size_t BinaryLogHeaderSize = sizeof(BinaryLogMagic) + sizeof(BinaryLogVersion);
+
+    class BinaryEventEncoder
+    {
+    public:
+        BinaryEventEncoder();
+
+        // Starts a new file: forgets the dictionary and timestamp, appends the file header.
+        void Reset(_Inout_ std::string& buffer);
+
+        // Appends the event record, preceded by Dictionary records for strings new to this file.
+        void Encode(
+            const VfpEventData& eventData,
+            _Inout_ std::string& buffer);
+
+        // Constants
+        static const size_t MaxDictionaryEntries = 65536;
+
+        BinaryEventEncoder(BinaryEventEncoder const&) = delete;
+        BinaryEventEncoder& operator=(BinaryEventEncoder const&) = delete;
+
+    private:
+        std::unordered_map<std::wstring, unsigned long> m_Dictionary;
+        LONGLONG m_LastTimeStamp = 0;
+        // Event payload scratch; the record length is only known once it is encoded.
+        std::string m_Payload;
+
+        // Returns the id of value, appending a Dictionary record to buffer if it is new. Empty is id 0.
+        unsigned long LookupString(
+            const std::wstring& value,
+            _Inout_ std::string& buffer);
+
+        void EncodeString(
+            const std::wstring& value,
+            _Inout_ std::string& buffer);
+
+        // Decimal strings are written as numbers, anything else through the dictionary.
+        void EncodeNumber(
+            const std::wstring& value,
+            _Inout_ std::string& buffer);
+
+        void EncodeAddress(
+            const std::wstring& value,
+            _Inout_ std::string& buffer);
+    };
+
+    class BinaryEventDecoder
+    {
+    public:
+        // Returns the size of the file header. Throws if data does not start with one.
+        static size_t DecodeHeader(
+            _In_reads_bytes_(length) const char* data,
+            size_t length);
+
+        // Decodes the next record. Returns 0 if data does not hold a complete record,
+        // otherwise the bytes consumed. eventDecoded is set when eventData was filled.
+        size_t DecodeRecord(
+            _In_reads_bytes_(length) const char* data,
+            size_t length,
+            _Out_ VfpEventData* eventData,
+            _Out_ bool* eventDecoded);
+
+        // Starts a new file.
+        void Reset();
+
+    private:
+        // Index is id - 1.
+        std::vector<std::wstring> m_Dictionary;
+        LONGLONG m_LastTimeStamp = 0;
+
+        void DecodeEvent(
+            const char*& data,
+            const char* end,
+            _Out_ VfpEventData* eventData);
+
+        const std::wstring& DecodeString(
+            const char*& data,
+            const char* end);
+
+        void DecodeNumber(
+            const char*& data,
+            const char* end,
+            _Out_ std::wstring* value);
+
+        void DecodeAddress(
+            const char*& data,
+            const char* end,
+            _Out_ std::wstring* value);
+    };
+
+    // Variable-length integer helpers shared by the encoder and decoder.
+    class Varint
+    {
+    public:
+        static void Append(
+            unsigned long long value,
+            _Inout_ std::string& buffer);
+
+        // Returns false if data ends before the varint does.
+        static bool Read(
+            const char*& data,
+            const char* end,
+            _Out_ unsigned long long* value);
+
+        static unsigned long long ZigZag(LONGLONG value)
+        {
+            return (static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63);
+        }
+
+        static LONGLONG UnZigZag(unsigned long long value)
+        {
+            return static_cast<LONGLONG>(value >> 1) ^ -static_cast<LONGLONG>(value & 1);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,175 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "BinaryLogReader.h"
+#include "EventFormatter.h"
+// ntl headers
+#include "ntlString.hpp"
+
+namespace FirewallEventMonitor
+{
+    BinaryLogReader::BinaryLogReader(
+        const std::wstring &filePath,
+        size_t readBufferSizeInBytes)
+        : m_FilePath(filePath),
+        m_File(filePath),
+        m_Buffer(readBufferSizeInBytes)
+    {
+        FillBuffer();
+        m_BufferBegin = BinaryEventDecoder::DecodeHeader(m_Buffer.data(), m_BufferEnd);
+    }
+
+    bool BinaryLogReader::ReadNext(
+        _Out_ VfpEventData* eventData)
+    {
+        for (;;)
+        {
+            bool eventDecoded = false;
+            size_t consumed = m_Decoder.DecodeRecord(
+                m_Buffer.data() + m_BufferBegin,
+                m_BufferEnd - m_BufferBegin,
+                eventData,
+                &eventDecoded);
+
+            if (consumed == 0)
+            {
+                if (FillBuffer())
+                {
+                    continue;
+                }
+
+                // A capture that was stopped abruptly can leave a partial record behind.
+                if (m_BufferEnd != m_BufferBegin)
+                {
+                    wprintf(L"Warning: Ignoring %Iu bytes of incomplete record at the end of %ls.\n",
+                        m_BufferEnd - m_BufferBegin,
+                        m_FilePath.c_str());
+                    m_BufferBegin = m_BufferEnd;
+                }
+                return false;
+            }
+
+            m_BufferBegin += consumed;
+            if (eventDecoded)
+            {
+                return true;
+            }
+        }
+    }
+
+    bool BinaryLogReader::FillBuffer()
+    {
+        if (m_EndOfFile)
+        {
+            return false;
+        }
+
+        size_t remaining = m_BufferEnd - m_BufferBegin;
+        if (remaining > 0 && m_BufferBegin > 0)
+        {
+            memmove(m_Buffer.data(), m_Buffer.data() + m_BufferBegin, remaining);
+        }
+        m_BufferBegin = 0;
+        m_BufferEnd = remaining;
+
+        size_t bytesRead = m_File.Read(m_Buffer.data() + m_BufferEnd, m_Buffer.size() - m_BufferEnd);
+        if (bytesRead == 0)
+        {
+            m_EndOfFile = true;
+            return false;
+        }
+
+        m_BufferEnd += bytesRead;
+        return true;
+    }
+
+    bool BinaryLogReader::IsBinaryLog(
+        const std::wstring& filePath)
+    {
+        std::wstring binaryExtension(L".bin");
+        std::wstring compressedBinaryExtension(binaryExtension);
+        compressedBinaryExtension.append(CompressedFileExtension);
+
+        auto endsWith = [&](const std::wstring& extension)
+        {
+            return filePath.size() >= extension.size() &&
+                ntl::String::iordinal_equals(filePath.substr(filePath.size() - extension.size()), extension);
+        };
+
+        return endsWith(binaryExtension) || endsWith(compressedBinaryExtension);
+    }
+
+    unsigned long BinaryLogReader::ExportToText(
+        const std::wstring &binaryFilePath,
+        const std::wstring &textFilePath)
+    {
+        BinaryLogReader reader(binaryFilePath);
+
+        HANDLE textFile = ::CreateFileW(
+            textFilePath.c_str(),
+            GENERIC_WRITE,
+            FILE_SHARE_READ,
+            NULL,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            NULL);
+
+        if (textFile == INVALID_HANDLE_VALUE)
+        {
+            std::string errorMessage = "Unable to open text file ";
+            errorMessage += ntl::String::convert_to_string(textFilePath);
+            throw std::exception(errorMessage.c_str());
+        }
+
+        unsigned long eventCount = 0;
+        bool writeFailed = false;
+        std::string text;
+        text.reserve(ReadBufferSizeInBytes);
+
+        auto writeText = [&]()
+        {
+            DWORD bytesWritten = 0;
+            if (!text.empty() &&
+                !::WriteFile(textFile, text.data(), static_cast<DWORD>(text.size()), &bytesWritten, NULL))
+            {
+                writeFailed = true;
+            }
+            text.clear();
+        };
+
+        try
+        {
+            VfpEventData eventData;
+            Utf8EventData utf8EventData;
+            while (!writeFailed &&
+                reader.ReadNext(&eventData))
+            {
+                EventFormatter::ConvertToUtf8(eventData, utf8EventData);
+                EventFormatter::FormatText(utf8EventData, text);
+                ++eventCount;
+
+                if (text.size() >= ReadBufferSizeInBytes)
+                {
+                    writeText();
+                }
+            }
+            writeText();
+        }
+        catch (...)
+        {
+            ::CloseHandle(textFile);
+            throw;
+        }
+
+        ::CloseHandle(textFile);
+
+        if (writeFailed)
+        {
+            std::string errorMessage = "Writing text file failed ";
+            errorMessage += ntl::String::convert_to_string(textFilePath);
+            throw std::exception(errorMessage.c_str());
+        }
+
+        return eventCount;
+    }
+}
\ No newline at end of file
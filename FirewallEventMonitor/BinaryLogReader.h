@@ -0,0 +1,59 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <string>
+#include <vector>
+
+#include "BinaryEventFormat.h"
+#include "LogCompression.h"
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    // Streams events back out of a .bin file written by BinaryLogger, compressed or not.
+    class BinaryLogReader
+    {
+    public:
+        // Opens the file and validates its header. Throws on failure.
+        // The buffer must hold the header and the largest record.
+        BinaryLogReader(
+            const std::wstring &filePath,
+            size_t readBufferSizeInBytes = ReadBufferSizeInBytes);
+
+        // Returns false once the end of the file is reached.
+        bool ReadNext(_Out_ VfpEventData* eventData);
+
+        // Converts a .bin file to the text layout written by -Output File.
+        // Returns the number of events converted.
+        static unsigned long ExportToText(
+            const std::wstring &binaryFilePath,
+            const std::wstring &textFilePath);
+
+        // True for .bin and .bin.xpress files.
+        static bool IsBinaryLog(const std::wstring& filePath);
+
+        // Constant
+        static const size_t ReadBufferSizeInBytes = 1024 * 1024; // 1 MB.
+
+        BinaryLogReader(BinaryLogReader const&) = delete;
+        BinaryLogReader& operator=(BinaryLogReader const&) = delete;
+
+    private:
+        std::wstring m_FilePath;
+        CompressedFileReader m_File;
+        BinaryEventDecoder m_Decoder;
+        // Bytes [m_BufferBegin, m_BufferEnd) have been read but not decoded.
+        std::vector<char> m_Buffer;
+        size_t m_BufferBegin = 0;
+        size_t m_BufferEnd = 0;
+        bool m_EndOfFile = false;
+
+        // Moves undecoded bytes to the front of the buffer and reads more. Returns false at end of file.
+        bool FillBuffer();
+    };
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "BinaryLogger.h"
+// ntl headers
+#include "ntlLocks.hpp"
+
+namespace FirewallEventMonitor
+{
+    const LPCWSTR BINARY_LOG_FILE_EXTENSION =
+        L".bin";
+
+    BinaryLogger::BinaryLogger(
+        const std::wstring &directory,
+        bool compress,
+        const LogRotationPolicy &rotationPolicy)
+        : BinaryLogger(std::make_shared<FileLogger>(directory, BINARY_LOG_FILE_EXTENSION, compress, rotationPolicy))
+    {
+    }
+
+    BinaryLogger::BinaryLogger(std::shared_ptr<FileLogger> fileLogger)
+        : m_FileLogger(fileLogger)
+    {
+        ::InitializeCriticalSectionEx(&m_CriticalSection, 4000, 0);
+        m_EncodeBuffer.reserve(EncodeBufferReserveInBytes);
+    }
+
+    BinaryLogger::~BinaryLogger()
+    {
+        CloseLogFile();
+        ::DeleteCriticalSection(&m_CriticalSection);
+    }
+
+    void BinaryLogger::CreateLogFile()
+    {
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        m_FileLogger->CreateLogFile();
+        WriteHeader();
+    }
+
+    void BinaryLogger::CloseLogFile()
+    {
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        m_FileLogger->CloseLogFile();
+    }
+
+    void BinaryLogger::WriteEvent(
+        const VfpEventData& eventData)
+    {
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        if (m_FileLogger->GetLogFile() == NULL)
+        {
+            wprintf(L"Warning: Unable to log to null file.\n");
+            return;
+        }
+
+        m_EncodeBuffer.clear();
+        m_Encoder.Encode(eventData, m_EncodeBuffer);
+        m_FileLogger->Write(m_EncodeBuffer.data(), m_EncodeBuffer.size());
+    }
+
+    bool BinaryLogger::RotateIfDue()
+    {
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+            // Holding the lock keeps events encoded against the old dictionary out of the new file.
+            if (!m_FileLogger->SwitchLogFileIfDue())
+            {
+                return false;
+            }
+
+            WriteHeader();
+        }
+
+        // The old file is written out and closed without holding up WriteEvent.
+        m_FileLogger->FinishRotation();
+        return true;
+    }
+
+    void BinaryLogger::MaintenanceCheck()
+    {
+        m_FileLogger->MaintenanceCheck();
+    }
+
+    void BinaryLogger::WriteHeader()
+    {
+        m_EncodeBuffer.clear();
+        m_Encoder.Reset(m_EncodeBuffer);
+        m_FileLogger->Write(m_EncodeBuffer.data(), m_EncodeBuffer.size());
+    }
+
+    const std::wstring& BinaryLogger::GetLogFilePath() const
+    {
+        return m_FileLogger->GetLogFilePath();
+    }
+
+    unsigned long long BinaryLogger::GetTotalBytesWritten() const
+    {
+        return m_FileLogger->GetTotalBytesWritten();
+    }
+
+    unsigned long long BinaryLogger::GetRotationCount() const
+    {
+        return m_FileLogger->GetRotationCount();
+    }
+}
\ No newline at end of file
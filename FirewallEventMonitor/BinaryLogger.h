@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <memory>
+#include <string>
+
+#include "FileLogger.h"
+#include "BinaryEventFormat.h"
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    // Writes events to a .bin file in the compact binary layout (see BinaryEventFormat.h).
+    class BinaryLogger
+    {
+    public:
+        BinaryLogger(
+            const std::wstring &directory,
+            bool compress = false,
+            const LogRotationPolicy &rotationPolicy = LogRotationPolicy{});
+
+        BinaryLogger(std::shared_ptr<FileLogger> fileLogger);
+
+        ~BinaryLogger();
+
+        // Opens a new file; dictionary ids and timestamp deltas restart with it.
+        void CreateLogFile();
+
+        void CloseLogFile();
+
+        void WriteEvent(const VfpEventData& eventData);
+
+        // Rotates the file per FileLogger::RotateIfDue and starts the new file with a header
+        // and an empty dictionary, so every file decodes on its own. Only the switch to the
+        // new file is made under the lock.
+        bool RotateIfDue();
+
+        // Forwards to FileLogger::MaintenanceCheck.
+        void MaintenanceCheck();
+
+        const std::wstring& GetLogFilePath() const;
+
+        // Forward to FileLogger.
+        unsigned long long GetTotalBytesWritten() const;
+
+        unsigned long long GetRotationCount() const;
+
+        BinaryLogger(BinaryLogger const&) = delete;
+        BinaryLogger& operator=(BinaryLogger const&) = delete;
+
+    private:
+        // Keeps encoder state and the file it describes in step across rotation.
+        CRITICAL_SECTION m_CriticalSection;
+        std::shared_ptr<FileLogger> m_FileLogger;
+        BinaryEventEncoder m_Encoder;
+        // Reused for every event to avoid per-event allocations.
+        std::string m_EncodeBuffer;
+
+        static const size_t EncodeBufferReserveInBytes = 1024;
+
+        // Resets the encoder and writes the file header. Caller must hold m_CriticalSection.
+        void WriteHeader();
+    };
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "BloomFilter.h"
+#include "BinaryEventFormat.h"
+
+namespace FirewallEventMonitor
+{
+    const LPCSTR CORRUPT_BLOOM_FILTER_MESSAGE = "Bloom filter is corrupt";
+
+    BloomFilter::BloomFilter()
+    {
+    }
+
+    BloomFilter::BloomFilter(
+        size_t keyCount,
+        size_t bitsPerKey)
+    {
+        // Round up to whole bytes; a minimum keeps tiny filters from saturating.
+        size_t bitCount = keyCount * bitsPerKey;
+        if (bitCount < 64)
+        {
+            bitCount = 64;
+        }
+        if (bitCount > MaxBitCount)
+        {
+            bitCount = MaxBitCount;
+        }
+        bitCount = (bitCount + 7) & ~static_cast<size_t>(7);
+
+        m_BitCount = bitCount;
+        m_Bits.resize(bitCount / 8);
+    }
+
+    void BloomFilter::Add(unsigned long long hash)
+    {
+        if (m_BitCount == 0)
+        {
+            throw std::exception("Cannot add to an empty bloom filter");
+        }
+
+        // Double hashing: the rotated hash is the step, made odd so it is never zero.
+        unsigned long long step = ((hash >> 32) | (hash << 32)) | 1;
+        for (unsigned int i = 0; i < m_HashCount; ++i)
+        {
+            size_t bit = static_cast<size_t>(hash % m_BitCount);
+            m_Bits[bit / 8] |= static_cast<unsigned char>(1 << (bit % 8));
+            hash += step;
+        }
+    }
+
+    bool BloomFilter::MayContain(unsigned long long hash) const
+    {
+        if (m_BitCount == 0)
+        {
+            return false;
+        }
+
+        unsigned long long step = ((hash >> 32) | (hash << 32)) | 1;
+        for (unsigned int i = 0; i < m_HashCount; ++i)
+        {
+            size_t bit = static_cast<size_t>(hash % m_BitCount);
+            if ((m_Bits[bit / 8] & (1 << (bit % 8))) == 0)
+            {
+                return false;
+            }
+            hash += step;
+        }
+        return true;
+    }
+
+    size_t BloomFilter::GetBitCount() const
+    {
+        return m_BitCount;
+    }
+
+    void BloomFilter::Encode(_Inout_ std::string& buffer) const
+    {
+        Varint::Append(m_BitCount, buffer);
+        buffer.push_back(static_cast<char>(m_HashCount));
+        if (!m_Bits.empty())
+        {
+            buffer.append(reinterpret_cast<const char*>(m_Bits.data()), m_Bits.size());
+        }
+    }
+
+    void BloomFilter::Decode(
+        const char*& data,
+        const char* end)
+    {
+        unsigned long long bitCount;
+        if (!Varint::Read(data, end, &bitCount) ||
+            bitCount > MaxBitCount ||
+            bitCount % 8 != 0 ||
+            data >= end)
+        {
+            throw std::exception(CORRUPT_BLOOM_FILTER_MESSAGE);
+        }
+
+        unsigned int hashCount = static_cast<unsigned char>(*data++);
+        size_t byteCount = static_cast<size_t>(bitCount / 8);
+        if (hashCount == 0 ||
+            byteCount > static_cast<size_t>(end - data))
+        {
+            throw std::exception(CORRUPT_BLOOM_FILTER_MESSAGE);
+        }
+
+        m_BitCount = static_cast<size_t>(bitCount);
+        m_HashCount = hashCount;
+        m_Bits.assign(
+            reinterpret_cast<const unsigned char*>(data),
+            reinterpret_cast<const unsigned char*>(data) + byteCount);
+        data += byteCount;
+    }
+}
\ No newline at end of file
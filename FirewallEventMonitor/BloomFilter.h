@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <string>
+#include <vector>
+
+namespace FirewallEventMonitor
+{
+    // Set membership with no false negatives and a tunable false positive rate.
+    //
+    // Each item sets HashCount bits, derived from its 64-bit hash by double hashing (Kirsch,
+    // Mitzenmacher), so callers hash once with EventKeys::Hash. At DefaultBitsPerKey bits per
+    // item about 1% of absent items are reported as present.
+    class BloomFilter
+    {
+    public:
+        // An empty filter, which contains nothing.
+        BloomFilter();
+
+        // Sized for keyCount items at bitsPerKey bits each.
+        explicit BloomFilter(
+            size_t keyCount,
+            size_t bitsPerKey = DefaultBitsPerKey);
+
+        void Add(unsigned long long hash);
+
+        // False if the item was never added; true if it was, or by chance.
+        bool MayContain(unsigned long long hash) const;
+
+        size_t GetBitCount() const;
+
+        // Appends varint bit count, hash count byte, then the bits.
+        void Encode(_Inout_ std::string& buffer) const;
+
+        // Reads a filter written by Encode, advancing data. Throws if it is malformed.
+        void Decode(
+            const char*& data,
+            const char* end);
+
+        // Constants
+        static const size_t DefaultBitsPerKey = 10;
+        static const unsigned int DefaultHashCount = 7; // bitsPerKey * ln 2, rounded.
+        static const size_t MaxBitCount = 64 * 1024 * 1024;
+
+    private:
+        std::vector<unsigned char> m_Bits;
+        size_t m_BitCount = 0;
+        unsigned int m_HashCount = DefaultHashCount;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,251 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "BurstDetector.h"
+#include "EventFormatter.h"
+
+// c++ headers
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace FirewallEventMonitor
+{
+    const double BurstDetector::Smoothing = 2.0 / (30.0 + 1.0);
+    const double BurstDetector::DefaultThresholdDeviations = 4.0;
+
+    BurstDetector::BurstDetector(
+        double thresholdDeviations,
+        unsigned long highFidelitySeconds)
+        : m_ThresholdDeviations(thresholdDeviations),
+        m_HighFidelitySeconds(highFidelitySeconds),
+        m_AlertCount(0),
+        m_DroppedEvents(0)
+    {
+        if (thresholdDeviations <= 0.0)
+        {
+            throw std::exception("BurstDetector threshold must be greater than 0");
+        }
+
+        m_Ports.baselines.reserve(MaxKeys);
+        m_Ports.slots.resize(SlotCount);
+        m_Rules.baselines.reserve(MaxKeys);
+        m_Rules.slots.resize(SlotCount);
+    }
+
+    void BurstDetector::AddDeny(
+        const EventKeys& eventKeys,
+        LONGLONG timeStamp,
+        _Inout_ std::vector<Alert>& alerts)
+    {
+        if (m_FirstSecond < 0)
+        {
+            m_FirstSecond = timeStamp / FileTimeTicksPerSecond;
+        }
+
+        AddToTable(m_Ports, EventKeys::PortId, eventKeys, timeStamp, alerts);
+        AddToTable(m_Rules, EventKeys::RuleId, eventKeys, timeStamp, alerts);
+    }
+
+    bool BurstDetector::IsHighFidelity(
+        const EventKeys& eventKeys,
+        LONGLONG timeStamp) const
+    {
+        LONGLONG second = timeStamp / FileTimeTicksPerSecond;
+        if (eventKeys.parsed[EventKeys::PortId])
+        {
+            const Baseline* baseline = Find(m_Ports, eventKeys.keys[EventKeys::PortId], eventKeys.hashes[EventKeys::PortId]);
+            if (baseline != nullptr && second <= baseline->highFidelityUntil)
+            {
+                return true;
+            }
+        }
+        if (eventKeys.parsed[EventKeys::RuleId])
+        {
+            const Baseline* baseline = Find(m_Rules, eventKeys.keys[EventKeys::RuleId], eventKeys.hashes[EventKeys::RuleId]);
+            if (baseline != nullptr && second <= baseline->highFidelityUntil)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    unsigned long long BurstDetector::GetAlertCount() const
+    {
+        return m_AlertCount.load(std::memory_order_relaxed);
+    }
+
+    unsigned long long BurstDetector::GetDroppedEvents() const
+    {
+        return m_DroppedEvents.load(std::memory_order_relaxed);
+    }
+
+    void BurstDetector::FormatAlert(
+        const Alert& alert,
+        _Inout_ std::string& buffer)
+    {
+        EventFormatter::AppendTimestamp(alert.timeStamp, buffer);
+        buffer.append(" Deny burst on ");
+        buffer.append(EventKeys::GetFieldName(alert.field));
+        buffer.append(" ");
+        EventKeys::AppendKey(alert.field, alert.key, buffer);
+        buffer.append(": ");
+        buffer.append(std::to_string(alert.count));
+        buffer.append(" denies this second, baseline ");
+
+        char text[64];
+        int length = sprintf_s(text, "%.1f +/- %.1f", alert.average, alert.deviation);
+        if (length > 0)
+        {
+            buffer.append(text, static_cast<size_t>(length));
+        }
+        buffer.append(" per second\r\n");
+    }
+
+    bool BurstDetector::IsDeny(const VfpEventData& eventData)
+    {
+        return eventData.ruleType == L"Deny";
+    }
+
+    void BurstDetector::AddToTable(
+        Table& table,
+        EventKeys::Field field,
+        const EventKeys& eventKeys,
+        LONGLONG timeStamp,
+        _Inout_ std::vector<Alert>& alerts)
+    {
+        if (!eventKeys.parsed[field])
+        {
+            return;
+        }
+
+        LONGLONG second = timeStamp / FileTimeTicksPerSecond;
+        Baseline* baseline = Find(table, eventKeys.keys[field], eventKeys.hashes[field], true);
+        if (baseline == nullptr)
+        {
+            m_DroppedEvents.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        if (baseline->second < 0)
+        {
+            // First deny for the key: its baseline starts at zero.
+            baseline->second = second;
+        }
+        else if (second > baseline->second)
+        {
+            CloseSeconds(*baseline, second);
+        }
+        // An event a little out of order counts towards the open second.
+
+        ++baseline->count;
+        if (baseline->alerted ||
+            baseline->count < MinimumBurst ||
+            second < m_FirstSecond + WarmUpSeconds)
+        {
+            return;
+        }
+
+        // A key that has been steady has no deviation to speak of; one deny a second is the floor.
+        double deviation = std::sqrt(baseline->variance);
+        double threshold = baseline->average + m_ThresholdDeviations * (std::max)(deviation, 1.0);
+        if (static_cast<double>(baseline->count) <= threshold)
+        {
+            return;
+        }
+
+        baseline->alerted = true;
+        baseline->highFidelityUntil = second + m_HighFidelitySeconds;
+        m_AlertCount.fetch_add(1, std::memory_order_relaxed);
+
+        Alert alert;
+        alert.field = field;
+        alert.key = baseline->key;
+        alert.timeStamp = timeStamp;
+        alert.count = baseline->count;
+        alert.average = baseline->average;
+        alert.deviation = deviation;
+        alerts.push_back(alert);
+    }
+
+    void BurstDetector::CloseSeconds(
+        Baseline& baseline,
+        LONGLONG second)
+    {
+        // The closed second, then a zero for each silent second since, up to MaxIdleSeconds.
+        LONGLONG idleSeconds = second - baseline.second - 1;
+        if (idleSeconds > MaxIdleSeconds)
+        {
+            idleSeconds = MaxIdleSeconds;
+        }
+        double value = static_cast<double>(baseline.count);
+        for (LONGLONG i = 0; i <= idleSeconds; ++i)
+        {
+            double difference = value - baseline.average;
+            double increment = Smoothing * difference;
+            baseline.average += increment;
+            baseline.variance = (1.0 - Smoothing) * (baseline.variance + difference * increment);
+            value = 0.0;
+        }
+
+        baseline.second = second;
+        baseline.count = 0;
+        baseline.alerted = false;
+    }
+
+    BurstDetector::Baseline* BurstDetector::Find(
+        Table& table,
+        const EventKey& key,
+        unsigned long long hash,
+        bool add)
+    {
+        const size_t mask = SlotCount - 1;
+        size_t slot = static_cast<size_t>(hash) & mask;
+        while (table.slots[slot] != 0)
+        {
+            Baseline& baseline = table.baselines[table.slots[slot] - 1];
+            if (baseline.hash == hash &&
+                EventKeys::Equal(baseline.key, key))
+            {
+                return &baseline;
+            }
+            slot = (slot + 1) & mask;
+        }
+
+        // Keep the table at most half full so probe runs stay short.
+        if (!add ||
+            table.baselines.size() >= MaxKeys)
+        {
+            return nullptr;
+        }
+
+        // Reserved for MaxKeys up front, so the baselines never move.
+        table.baselines.emplace_back();
+        Baseline& baseline = table.baselines.back();
+        baseline.key = key;
+        baseline.hash = hash;
+        table.slots[slot] = table.baselines.size();
+        return &baseline;
+    }
+
+    const BurstDetector::Baseline* BurstDetector::Find(
+        const Table& table,
+        const EventKey& key,
+        unsigned long long hash) const
+    {
+        const size_t mask = SlotCount - 1;
+        size_t slot = static_cast<size_t>(hash) & mask;
+        while (table.slots[slot] != 0)
+        {
+            const Baseline& baseline = table.baselines[table.slots[slot] - 1];
+            if (baseline.hash == hash &&
+                EventKeys::Equal(baseline.key, key))
+            {
+                return &baseline;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return nullptr;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "EventKeys.h"
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    // Flags bursts of denied events on a port or a rule against that key's own baseline.
+    //
+    // Each port and rule keeps an exponentially weighted moving average and variance of its
+    // denies per second, updated as each second of event time closes. A second whose count
+    // exceeds the average by thresholdDeviations standard deviations raises one alert, as
+    // soon as the count crosses the threshold. A burst that goes on widens the deviation, so
+    // it is reported once rather than every second; a key that then stays quiet decays
+    // towards zero, so a new burst after a lull is flagged again.
+    //
+    // Keys are found through the hashes in EventKeys and updated in place: an event costs a
+    // table lookup and a few floating point operations per key, with no lock and no
+    // allocation once the key is known. Only the ETW callback thread may call AddDeny and
+    // IsHighFidelity.
+    class BurstDetector
+    {
+    public:
+        struct Alert
+        {
+            EventKeys::Field field; // PortId or RuleId.
+            EventKey key;
+            LONGLONG timeStamp; // FILETIME of the event that crossed the threshold.
+            unsigned long long count; // Denies so far in that second.
+            double average;
+            double deviation;
+        };
+
+        // highFidelitySeconds: how long IsHighFidelity holds for a key after its alert.
+        BurstDetector(
+            double thresholdDeviations,
+            unsigned long highFidelitySeconds);
+
+        // Counts a denied event against its port and rule. Appends an alert for each of them
+        // that it takes over the threshold.
+        void AddDeny(
+            const EventKeys& eventKeys,
+            LONGLONG timeStamp,
+            _Inout_ std::vector<Alert>& alerts);
+
+        // True if the event's port or rule raised an alert within the last highFidelitySeconds.
+        bool IsHighFidelity(
+            const EventKeys& eventKeys,
+            LONGLONG timeStamp) const;
+
+        unsigned long long GetAlertCount() const;
+
+        // Denies not tracked because MaxKeys ports or rules were already tracked.
+        unsigned long long GetDroppedEvents() const;
+
+        // Appends the alert as one line of text.
+        static void FormatAlert(
+            const Alert& alert,
+            _Inout_ std::string& buffer);
+
+        static bool IsDeny(const VfpEventData& eventData);
+
+        // Constants
+        static const size_t MaxKeys = 1024; // Per ports and per rules.
+        static const size_t SlotCount = MaxKeys * 2; // Power of two.
+        static const unsigned long long MinimumBurst = 10; // Denies in a second; fewer never alert.
+        static const LONGLONG WarmUpSeconds = 30; // From the first deny; no alerts before.
+        static const LONGLONG MaxIdleSeconds = 300; // Longer gaps decay the baseline no further.
+        static const LONGLONG FileTimeTicksPerSecond = 10000000;
+        // Weight of each new second, 2 / (N + 1) for an average over about N = 30 seconds.
+        static const double Smoothing;
+        static const double DefaultThresholdDeviations;
+
+        BurstDetector(BurstDetector const&) = delete;
+        BurstDetector& operator=(BurstDetector const&) = delete;
+
+    private:
+        struct Baseline
+        {
+            EventKey key;
+            unsigned long long hash = 0;
+            // Second (since 1601) being counted, and its denies so far. -1 before the first deny.
+            LONGLONG second = -1;
+            unsigned long long count = 0;
+            bool alerted = false;
+            double average = 0.0;
+            double variance = 0.0;
+            // Last second of high-fidelity capture after an alert.
+            LONGLONG highFidelityUntil = -1;
+        };
+
+        struct Table
+        {
+            std::vector<Baseline> baselines;
+            // Index into baselines plus one; 0 marks an empty slot. Keys are never removed.
+            std::vector<size_t> slots;
+        };
+
+        // Returns null if the key is not tracked and the table is full, or if add is false.
+        Baseline* Find(
+            Table& table,
+            const EventKey& key,
+            unsigned long long hash,
+            bool add);
+
+        const Baseline* Find(
+            const Table& table,
+            const EventKey& key,
+            unsigned long long hash) const;
+
+        void AddToTable(
+            Table& table,
+            EventKeys::Field field,
+            const EventKeys& eventKeys,
+            LONGLONG timeStamp,
+            _Inout_ std::vector<Alert>& alerts);
+
+        // Folds the counted second, and the empty seconds after it, into the baseline.
+        void CloseSeconds(
+            Baseline& baseline,
+            LONGLONG second);
+
+        double m_ThresholdDeviations;
+        LONGLONG m_HighFidelitySeconds;
+        Table m_Ports;
+        Table m_Rules;
+        // Second of the first deny; alerts start WarmUpSeconds later.
+        LONGLONG m_FirstSecond = -1;
+        std::atomic<unsigned long long> m_AlertCount;
+        std::atomic<unsigned long long> m_DroppedEvents;
+    };
+}
\ No newline at end of file
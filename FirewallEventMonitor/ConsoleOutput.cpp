@@ -0,0 +1,44 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "ConsoleOutput.h"
+// os headers
+#include <Windows.h>
+// c++ headers
+#include <atomic>
+#include <cstdio>
+
+namespace FirewallEventMonitor
+{
+    bool WriteConsoleUtf8(
+        const std::string& text)
+    {
+        static std::atomic<bool> s_WarnedWriteFailed(false);
+
+        fflush(stdout);
+        HANDLE output = ::GetStdHandle(STD_OUTPUT_HANDLE);
+        bool written = output != NULL && output != INVALID_HANDLE_VALUE;
+
+        const char* remaining = text.data();
+        size_t length = text.size();
+        while (written && length > 0)
+        {
+            DWORD chunk = length > MAXDWORD ? MAXDWORD : static_cast<DWORD>(length);
+            DWORD bytesWritten = 0;
+            if (!::WriteFile(output, remaining, chunk, &bytesWritten, NULL) ||
+                bytesWritten == 0)
+            {
+                written = false;
+                break;
+            }
+            remaining += bytesWritten;
+            length -= bytesWritten;
+        }
+
+        if (!written && !s_WarnedWriteFailed.exchange(true))
+        {
+            wprintf(L"Warning: Writing to the console failed with error %lu.\n", ::GetLastError());
+        }
+        return written;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// c++ headers
+#include <string>
+
+namespace FirewallEventMonitor
+{
+    // Hands UTF-8 bytes straight to the console or redirected file, bypassing CRT
+    // wide-character translation. CRT output is flushed first so the two stay in order.
+    // Returns false, warning once per process, if the bytes could not all be written.
+    bool WriteConsoleUtf8(const std::string& text);
+}
\ No newline at end of file
@@ -0,0 +1,374 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "DecodePipeline.h"
+// ntl headers
+#include "ntlLocks.hpp"
+#include "ntlTrace.hpp"
+// c++ headers
+#include <algorithm>
+
+namespace FirewallEventMonitor
+{
+    // EVENT_HEADER_EXTENDED_DATA_ITEMs and their data hold 64-bit fields.
+    const size_t EVENT_RECORD_PAYLOAD_ALIGNMENT = 8;
+
+    EventRecordBatch::EventRecordBatch()
+        : eventCount(0),
+        m_Sealed(false)
+    {
+    }
+
+    void EventRecordBatch::Add(
+        const EVENT_RECORD& record)
+    {
+        if (m_Sealed)
+        {
+            throw std::exception("EventRecordBatch is sealed");
+        }
+
+        EVENT_RECORD copy = record;
+        // The reader's context is not the batch's to keep.
+        copy.UserContext = nullptr;
+        copy.UserData = reinterpret_cast<PVOID>(AppendPayload(record.UserData, record.UserDataLength));
+
+        if (record.ExtendedDataCount > 0)
+        {
+            size_t itemsOffset = AppendPayload(
+                record.ExtendedData,
+                record.ExtendedDataCount * sizeof(EVENT_HEADER_EXTENDED_DATA_ITEM));
+
+            for (USHORT i = 0; i < record.ExtendedDataCount; ++i)
+            {
+                const EVENT_HEADER_EXTENDED_DATA_ITEM& item = record.ExtendedData[i];
+                size_t dataOffset = AppendPayload(reinterpret_cast<const void*>(item.DataPtr), item.DataSize);
+                // Looked up again, as the append may have moved the buffer.
+                reinterpret_cast<PEVENT_HEADER_EXTENDED_DATA_ITEM>(&m_Payloads[itemsOffset])[i].DataPtr = dataOffset;
+            }
+            copy.ExtendedData = reinterpret_cast<PEVENT_HEADER_EXTENDED_DATA_ITEM>(itemsOffset);
+        }
+
+        m_Records.push_back(copy);
+    }
+
+    void EventRecordBatch::Seal()
+    {
+        if (m_Sealed)
+        {
+            return;
+        }
+        m_Sealed = true;
+
+        BYTE* payloads = m_Payloads.data();
+        for (auto& record : m_Records)
+        {
+            record.UserData = (record.UserDataLength > 0) ?
+                payloads + reinterpret_cast<size_t>(record.UserData) :
+                nullptr;
+
+            if (record.ExtendedDataCount > 0)
+            {
+                record.ExtendedData = reinterpret_cast<PEVENT_HEADER_EXTENDED_DATA_ITEM>(
+                    payloads + reinterpret_cast<size_t>(record.ExtendedData));
+                for (USHORT i = 0; i < record.ExtendedDataCount; ++i)
+                {
+                    record.ExtendedData[i].DataPtr = reinterpret_cast<ULONGLONG>(payloads + record.ExtendedData[i].DataPtr);
+                }
+            }
+            else
+            {
+                record.ExtendedData = nullptr;
+            }
+        }
+    }
+
+    void EventRecordBatch::Clear()
+    {
+        m_Records.clear();
+        m_Payloads.clear();
+        eventCount = 0;
+        m_Sealed = false;
+    }
+
+    EVENT_RECORD& EventRecordBatch::operator[](
+        size_t index)
+    {
+        return m_Records[index];
+    }
+
+    size_t EventRecordBatch::size() const
+    {
+        return m_Records.size();
+    }
+
+    bool EventRecordBatch::empty() const
+    {
+        return m_Records.empty();
+    }
+
+    size_t EventRecordBatch::AppendPayload(
+        const void* data,
+        size_t sizeInBytes)
+    {
+        size_t offset = (m_Payloads.size() + EVENT_RECORD_PAYLOAD_ALIGNMENT - 1) & ~(EVENT_RECORD_PAYLOAD_ALIGNMENT - 1);
+        m_Payloads.resize(offset + sizeInBytes);
+        if (sizeInBytes > 0)
+        {
+            memcpy_s(&m_Payloads[offset], sizeInBytes, data, sizeInBytes);
+        }
+        return offset;
+    }
+
+    DecodePipeline::DecodePipeline(
+        size_t workerCount,
+        const Decoder& decoder,
+        const Sink& sink,
+        size_t batchSize)
+        : m_Decoder(decoder),
+        m_Sink(sink),
+        m_BatchSize((std::max)(batchSize, static_cast<size_t>(1))),
+        m_Batch(std::make_unique<EventRecordBatch>()),
+        m_BatchesInFlight(0),
+        m_ReorderDepth(0),
+        m_Pool(workerCount, WorkStealingPool::OldestFirst)
+    {
+        ::InitializeCriticalSectionEx(&m_BatchCriticalSection, 4000, 0);
+        ::InitializeCriticalSectionEx(&m_ReorderCriticalSection, 4000, 0);
+        ::InitializeConditionVariable(&m_BatchDelivered);
+    }
+
+    DecodePipeline::~DecodePipeline()
+    {
+        Drain();
+        ::DeleteCriticalSection(&m_ReorderCriticalSection);
+        ::DeleteCriticalSection(&m_BatchCriticalSection);
+    }
+
+    void DecodePipeline::AddEventRecord(
+        const EVENT_RECORD& record)
+    {
+        std::unique_ptr<EventRecordBatch> fullBatch;
+        unsigned long long sequence = 0;
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_BatchCriticalSection);
+            if (m_Batch->empty())
+            {
+                m_BatchStartTick = ::GetTickCount64();
+            }
+
+            m_Batch->Add(record);
+            if (m_Batch->size() >= m_BatchSize)
+            {
+                fullBatch = TakeBatch(&sequence);
+            }
+        }
+
+        if (fullBatch)
+        {
+            QueueBatch(sequence, std::move(fullBatch));
+        }
+    }
+
+    void DecodePipeline::FlushCheck()
+    {
+        std::unique_ptr<EventRecordBatch> batch;
+        unsigned long long sequence = 0;
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_BatchCriticalSection);
+            if (!m_Batch->empty() &&
+                ::GetTickCount64() - m_BatchStartTick >= FlushIntervalInMilliseconds)
+            {
+                batch = TakeBatch(&sequence);
+            }
+        }
+
+        if (batch)
+        {
+            QueueBatch(sequence, std::move(batch));
+        }
+    }
+
+    void DecodePipeline::Drain()
+    {
+        std::unique_ptr<EventRecordBatch> batch;
+        unsigned long long sequence = 0;
+        unsigned long long batchesTaken = 0;
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_BatchCriticalSection);
+            if (!m_Batch->empty())
+            {
+                batch = TakeBatch(&sequence);
+            }
+            batchesTaken = m_NextSequence;
+        }
+
+        if (batch)
+        {
+            QueueBatch(sequence, std::move(batch));
+        }
+
+        // Batches are delivered by the tasks that decode them, so this waits for the sink too,
+        // including for a batch another thread has taken but is still waiting to queue.
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_ReorderCriticalSection);
+            while (m_NextDelivery < batchesTaken)
+            {
+                ::SleepConditionVariableCS(&m_BatchDelivered, &m_ReorderCriticalSection, INFINITE);
+            }
+        }
+        m_Pool.Wait();
+    }
+
+    size_t DecodePipeline::GetWorkerCount() const
+    {
+        return m_Pool.GetWorkerCount();
+    }
+
+    DecodePipelineResults DecodePipeline::GetResults()
+    {
+        ntl::AutoReleaseCriticalSection csScoped(&m_ReorderCriticalSection);
+        return m_Results;
+    }
+
+    size_t DecodePipeline::GetBatchesInFlight() const
+    {
+        return m_BatchesInFlight.load(std::memory_order_relaxed);
+    }
+
+    size_t DecodePipeline::GetReorderDepth() const
+    {
+        return m_ReorderDepth.load(std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<EventRecordBatch> DecodePipeline::TakeBatch(
+        _Out_ unsigned long long* sequence)
+    {
+        std::unique_ptr<EventRecordBatch> batch;
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_ReorderCriticalSection);
+            if (!m_FreeBatches.empty())
+            {
+                batch = std::move(m_FreeBatches.back());
+                m_FreeBatches.pop_back();
+            }
+        }
+
+        if (!batch)
+        {
+            batch = std::make_unique<EventRecordBatch>();
+        }
+        batch.swap(m_Batch);
+        *sequence = m_NextSequence++;
+        return batch;
+    }
+
+    void DecodePipeline::QueueBatch(
+        unsigned long long sequence,
+        std::unique_ptr<EventRecordBatch> batch)
+    {
+        NTL_TRACE_SCOPE("QueueBatch");
+        batch->Seal();
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_ReorderCriticalSection);
+            const size_t maxBatchesInFlight = m_Pool.GetWorkerCount() * MaxQueuedBatchesPerWorker;
+            // The batch due next never waits: every batch in flight is behind it in the reorder buffer.
+            if (m_BatchesInFlight >= maxBatchesInFlight && sequence != m_NextDelivery)
+            {
+                ++m_Results.backpressureWaits;
+                while (m_BatchesInFlight >= maxBatchesInFlight && sequence != m_NextDelivery)
+                {
+                    ::SleepConditionVariableCS(&m_BatchDelivered, &m_ReorderCriticalSection, INFINITE);
+                }
+            }
+
+            ++m_BatchesInFlight;
+            ++m_Results.batchesQueued;
+            m_Results.eventsQueued += batch->size();
+        }
+
+        // Released into the task, which always runs: the pool waits for its tasks before it stops.
+        EventRecordBatch* records = batch.release();
+        m_Pool.Submit([this, sequence, records](size_t)
+        {
+            DecodeBatch(sequence, std::unique_ptr<EventRecordBatch>(records));
+        });
+    }
+
+    void DecodePipeline::DecodeBatch(
+        unsigned long long sequence,
+        std::unique_ptr<EventRecordBatch> batch)
+    {
+        NTL_TRACE_SCOPE("DecodeBatch");
+        for (size_t i = 0; i < batch->size(); ++i)
+        {
+            try
+            {
+                // Decoded in place; a dropped event's slot is decoded into again by the next one.
+                if (batch->eventCount == batch->events.size())
+                {
+                    batch->events.emplace_back();
+                }
+                if (m_Decoder((*batch)[i], batch->events[batch->eventCount]))
+                {
+                    ++batch->eventCount;
+                }
+            }
+            catch (const std::exception &ex)
+            {
+                wprintf(L"Warning: Skipping event: %S.\n", ex.what());
+            }
+        }
+
+        ntl::AutoReleaseCriticalSection csScoped(&m_ReorderCriticalSection);
+        if (sequence != m_NextDelivery)
+        {
+            ++m_Results.batchesReordered;
+        }
+        m_Decoded.emplace(sequence, std::move(batch));
+        m_ReorderDepth = m_Decoded.size();
+        m_Results.maximumReorderDepth = (std::max)(m_Results.maximumReorderDepth, m_Decoded.size());
+
+        // The worker already delivering picks this batch up when it gets to it.
+        if (!m_Delivering)
+        {
+            DeliverBatches();
+        }
+    }
+
+    void DecodePipeline::DeliverBatches()
+    {
+        NTL_TRACE_SCOPE("DeliverBatches");
+        m_Delivering = true;
+        while (!m_Decoded.empty() &&
+            m_Decoded.begin()->first == m_NextDelivery)
+        {
+            std::unique_ptr<EventRecordBatch> batch(std::move(m_Decoded.begin()->second));
+            m_Decoded.erase(m_Decoded.begin());
+            m_ReorderDepth = m_Decoded.size();
+
+            // Other workers park their batches while the sink runs.
+            ::LeaveCriticalSection(&m_ReorderCriticalSection);
+            for (size_t i = 0; i < batch->eventCount; ++i)
+            {
+                try
+                {
+                    m_Sink(batch->events[i]);
+                }
+                catch (const std::exception &ex)
+                {
+                    wprintf(L"Exception: %S.\n", ex.what());
+                }
+            }
+            size_t eventsDelivered = batch->eventCount;
+            batch->Clear();
+            ::EnterCriticalSection(&m_ReorderCriticalSection);
+
+            m_Results.eventsDelivered += eventsDelivered;
+            ++m_NextDelivery;
+            --m_BatchesInFlight;
+            m_FreeBatches.push_back(std::move(batch));
+            ::WakeAllConditionVariable(&m_BatchDelivered);
+        }
+        m_Delivering = false;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,181 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+#include <evntcons.h>
+// c++ headers
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "VfpEventData.h"
+#include "WorkStealingPool.h"
+
+namespace FirewallEventMonitor
+{
+    // Copies of EVENT_RECORDs and their payloads (user data and extended data items), packed
+    // into one buffer that keeps its capacity from batch to batch.
+    //
+    // Records are added with their payload pointers held as offsets into the buffer, since it
+    // moves as it grows. Seal turns them back into pointers, after which nothing may be added.
+    class EventRecordBatch
+    {
+    public:
+        EventRecordBatch();
+
+        void Add(const EVENT_RECORD& record);
+
+        void Seal();
+
+        // Empties the batch, keeping the memory it had.
+        void Clear();
+
+        // Only valid once sealed.
+        EVENT_RECORD& operator[](size_t index);
+
+        size_t size() const;
+
+        bool empty() const;
+
+        // Events decoded from the records, filled in by a worker: the first eventCount of them.
+        // Clear keeps the events, so decoding into them again reuses their strings' memory.
+        std::vector<VfpEventData> events;
+        size_t eventCount;
+
+        EventRecordBatch(EventRecordBatch const&) = delete;
+        EventRecordBatch& operator=(EventRecordBatch const&) = delete;
+
+    private:
+        std::vector<EVENT_RECORD> m_Records;
+        std::vector<BYTE> m_Payloads;
+        bool m_Sealed;
+
+        // Copies the bytes to the end of m_Payloads, 8-byte aligned, and returns their offset.
+        size_t AppendPayload(
+            const void* data,
+            size_t sizeInBytes);
+    };
+
+    struct DecodePipelineResults
+    {
+        unsigned long long eventsQueued = 0;
+        unsigned long long eventsDelivered = 0;
+        unsigned long long batchesQueued = 0;
+        // Batches decoded before an earlier one, held until it was done.
+        unsigned long long batchesReordered = 0;
+        // The most batches held back at once.
+        size_t maximumReorderDepth = 0;
+        // Times ETW waited for the workers to catch up.
+        unsigned long long backpressureWaits = 0;
+    };
+
+    // Moves decoding and filtering off the single thread ETW delivers real-time events on.
+    //
+    // That thread only copies each record into the current batch, and every BatchSize records
+    // (or FlushIntervalInMilliseconds, whichever comes first) the batch becomes a task on a
+    // WorkStealingPool, numbered in the order it was queued. Workers decode their batches in
+    // parallel, oldest first, and park them in a reorder buffer; whichever worker completes the
+    // batch due next hands it, and any held-back batches that follow it, to the sink in sequence
+    // order. So the statistics and loggers still see one event at a time, in the order ETW
+    // delivered them, and the reorder buffer holds about one batch per worker.
+    //
+    // At most MaxQueuedBatchesPerWorker batches per worker are in flight; beyond that AddEventRecord
+    // waits, which pushes back on the ETW buffers as a slow callback would. It waits with the full
+    // batch already swapped out, so FlushCheck and Drain are never stuck behind it.
+    class DecodePipeline
+    {
+    public:
+        // Decodes a record into eventData, which may hold an event decoded before and must have
+        // every field overwritten. Returns false to drop it. Called on many workers at once.
+        typedef std::function<bool(EVENT_RECORD& record, _Inout_ VfpEventData& eventData)> Decoder;
+        // Receives the events the decoder kept, in the order they were added, from one worker at a time.
+        typedef std::function<void(VfpEventData& eventData)> Sink;
+
+        DecodePipeline(
+            size_t workerCount,
+            const Decoder& decoder,
+            const Sink& sink,
+            size_t batchSize = BatchSize);
+
+        // Delivers the events added so far.
+        ~DecodePipeline();
+
+        // Copies the record into the current batch, and queues the batch once it is full.
+        void AddEventRecord(const EVENT_RECORD& record);
+
+        // Queues the current batch if its first record has waited FlushIntervalInMilliseconds.
+        // Lets a quiet capture's events through without waiting for a full batch.
+        void FlushCheck();
+
+        // Queues the current batch and waits until every event added has reached the sink.
+        void Drain();
+
+        size_t GetWorkerCount() const;
+
+        DecodePipelineResults GetResults();
+
+        // Batches queued to the workers and not yet delivered, and decoded batches waiting for
+        // an earlier one. Read without the locks, so they can be polled while events flow.
+        size_t GetBatchesInFlight() const;
+
+        size_t GetReorderDepth() const;
+
+        // Constants
+        static const size_t BatchSize = 1024;
+        static const size_t MaxQueuedBatchesPerWorker = 4;
+        static const ULONGLONG FlushIntervalInMilliseconds = 50;
+
+        DecodePipeline(DecodePipeline const&) = delete;
+        DecodePipeline& operator=(DecodePipeline const&) = delete;
+
+    private:
+        Decoder m_Decoder;
+        Sink m_Sink;
+        size_t m_BatchSize;
+        // Guards the current batch, which ETW fills and FlushCheck may queue from another thread.
+        CRITICAL_SECTION m_BatchCriticalSection;
+        std::unique_ptr<EventRecordBatch> m_Batch;
+        ULONGLONG m_BatchStartTick = 0;
+        unsigned long long m_NextSequence = 0;
+        // Guards everything below it.
+        CRITICAL_SECTION m_ReorderCriticalSection;
+        CONDITION_VARIABLE m_BatchDelivered;
+        // Decoded batches waiting for an earlier one, by sequence number.
+        std::map<unsigned long long, std::unique_ptr<EventRecordBatch>> m_Decoded;
+        unsigned long long m_NextDelivery = 0;
+        // A worker is handing batches to the sink; others leave theirs in m_Decoded.
+        bool m_Delivering = false;
+        // Atomic only so they can be read without the lock.
+        std::atomic<size_t> m_BatchesInFlight;
+        std::atomic<size_t> m_ReorderDepth;
+        // Emptied batches, reused so steady state allocates no batch memory.
+        std::vector<std::unique_ptr<EventRecordBatch>> m_FreeBatches;
+        DecodePipelineResults m_Results;
+        // Last, so the workers stop before the rest is destroyed.
+        WorkStealingPool m_Pool;
+
+        // Swaps the current batch for an empty one and numbers it. Called with
+        // m_BatchCriticalSection held.
+        std::unique_ptr<EventRecordBatch> TakeBatch(_Out_ unsigned long long* sequence);
+
+        // Waits for room among the batches in flight, then hands the batch to a worker. Called
+        // without m_BatchCriticalSection held.
+        void QueueBatch(
+            unsigned long long sequence,
+            std::unique_ptr<EventRecordBatch> batch);
+
+        void DecodeBatch(
+            unsigned long long sequence,
+            std::unique_ptr<EventRecordBatch> batch);
+
+        // Hands the batches due to the sink while the next one is ready. Called by the worker
+        // that completed the batch due next, with m_ReorderCriticalSection held; releases it
+        // while the sink runs.
+        void DeliverBatches();
+    };
+}
\ No newline at end of file
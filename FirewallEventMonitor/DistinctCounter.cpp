@@ -0,0 +1,205 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "DistinctCounter.h"
+
+// c++ headers
+#include <algorithm>
+
+namespace FirewallEventMonitor
+{
+    const size_t DISTINCT_COUNTER_COLUMN_WIDTH = 14;
+
+    // Appends an estimate rounded to a whole count, right-aligned.
+    void AppendEstimateColumn(
+        double estimate,
+        _Inout_ std::string& buffer)
+    {
+        EventKeys::AppendValueColumn(
+            std::to_string(static_cast<unsigned long long>(estimate + 0.5)),
+            DISTINCT_COUNTER_COLUMN_WIDTH,
+            buffer);
+    }
+
+    DistinctCounter::DistinctCounter()
+        : m_DroppedEvents(0)
+    {
+        m_Rules.counts.reserve(MaxKeys);
+        m_Rules.slots.resize(SlotCount);
+        m_Ports.counts.reserve(MaxKeys);
+        m_Ports.slots.resize(SlotCount);
+        m_Rows.reserve(MaxKeys);
+    }
+
+    void DistinctCounter::AddEvent(
+        const EventKeys& eventKeys)
+    {
+        ntl::AutoReleaseHotLock lockScoped(m_Lock);
+        AddToTable(m_Rules, EventKeys::RuleId, eventKeys);
+        AddToTable(m_Ports, EventKeys::PortId, eventKeys);
+    }
+
+    void DistinctCounter::AddEvent(
+        const VfpEventData& eventData)
+    {
+        EventKeys eventKeys;
+        eventKeys.Parse(eventData);
+        AddEvent(eventKeys);
+    }
+
+    void DistinctCounter::AddToTable(
+        Table& table,
+        EventKeys::Field field,
+        const EventKeys& eventKeys)
+    {
+        if (!eventKeys.parsed[field])
+        {
+            return;
+        }
+
+        Counts* counts = FindOrAdd(table, eventKeys.keys[field], eventKeys.hashes[field]);
+        if (counts == nullptr)
+        {
+            m_DroppedEvents.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        ++counts->events;
+        if (eventKeys.parsed[EventKeys::SourceAddress])
+        {
+            counts->sources.Add(eventKeys.hashes[EventKeys::SourceAddress]);
+        }
+        if (eventKeys.parsed[EventKeys::DestinationPort])
+        {
+            counts->destinationPorts.Add(eventKeys.hashes[EventKeys::DestinationPort]);
+        }
+    }
+
+    DistinctCounter::Counts* DistinctCounter::FindOrAdd(
+        Table& table,
+        const EventKey& key,
+        unsigned long long hash)
+    {
+        const size_t mask = SlotCount - 1;
+        size_t slot = static_cast<size_t>(hash) & mask;
+        while (table.slots[slot] != 0)
+        {
+            Counts* counts = &table.counts[table.slots[slot] - 1];
+            if (counts->hash == hash &&
+                EventKeys::Equal(counts->key, key))
+            {
+                return counts;
+            }
+            slot = (slot + 1) & mask;
+        }
+
+        // Keep the table at most half full so probe runs stay short.
+        if (table.counts.size() >= MaxKeys)
+        {
+            return nullptr;
+        }
+
+        table.counts.emplace_back();
+        Counts* counts = &table.counts.back();
+        counts->key = key;
+        counts->hash = hash;
+        table.slots[slot] = table.counts.size();
+        return counts;
+    }
+
+    void DistinctCounter::Report(
+        size_t topCount,
+        unsigned long intervalInSeconds,
+        _Inout_ std::string& buffer)
+    {
+        buffer.append("Distinct counts in the last ");
+        buffer.append(std::to_string(intervalInSeconds));
+        buffer.append(" seconds (estimates, typically within 3%):\r\n");
+
+        {
+            ntl::AutoReleaseColdLock lockScoped(m_Lock);
+            CollectRows(m_Rules);
+        }
+        FormatRows(EventKeys::RuleId, topCount, buffer);
+
+        {
+            ntl::AutoReleaseColdLock lockScoped(m_Lock);
+            CollectRows(m_Ports);
+        }
+        FormatRows(EventKeys::PortId, topCount, buffer);
+
+        buffer.append("\r\n");
+    }
+
+    unsigned long long DistinctCounter::GetDroppedEvents() const
+    {
+        return m_DroppedEvents.load(std::memory_order_relaxed);
+    }
+
+    void DistinctCounter::CollectRows(
+        Table& table)
+    {
+        m_Rows.clear();
+        for (auto& counts : table.counts)
+        {
+            if (counts.events == 0)
+            {
+                continue;
+            }
+
+            counts.totalSources.Merge(counts.sources);
+            counts.totalDestinationPorts.Merge(counts.destinationPorts);
+
+            Row row;
+            row.key = counts.key;
+            row.events = counts.events;
+            row.sources = counts.sources.Estimate();
+            row.destinationPorts = counts.destinationPorts.Estimate();
+            row.totalSources = counts.totalSources.Estimate();
+            row.totalDestinationPorts = counts.totalDestinationPorts.Estimate();
+            m_Rows.push_back(row);
+
+            counts.events = 0;
+            counts.sources.Reset();
+            counts.destinationPorts.Reset();
+        }
+    }
+
+    void DistinctCounter::FormatRows(
+        EventKeys::Field field,
+        size_t topCount,
+        _Inout_ std::string& buffer)
+    {
+        topCount = (topCount < m_Rows.size()) ? topCount : m_Rows.size();
+        std::partial_sort(m_Rows.begin(), m_Rows.begin() + topCount, m_Rows.end(), [](const Row& lhs, const Row& rhs)
+        {
+            return lhs.sources > rhs.sources;
+        });
+
+        const char* columns[] = { "Events", "Sources", "Dst ports", "All sources", "All dst ports" };
+
+        EventKeys::AppendTitleColumn(EventKeys::GetFieldName(field), buffer);
+        for (const auto column : columns)
+        {
+            EventKeys::AppendValueColumn(column, DISTINCT_COUNTER_COLUMN_WIDTH, buffer);
+        }
+        buffer.append("\r\n");
+
+        if (topCount == 0)
+        {
+            buffer.append("    none\r\n");
+        }
+
+        for (size_t i = 0; i < topCount; ++i)
+        {
+            const Row& row = m_Rows[i];
+            EventKeys::AppendKeyColumn(field, row.key, buffer);
+            AppendEstimateColumn(static_cast<double>(row.events), buffer);
+            AppendEstimateColumn(row.sources, buffer);
+            AppendEstimateColumn(row.destinationPorts, buffer);
+            AppendEstimateColumn(row.totalSources, buffer);
+            AppendEstimateColumn(row.totalDestinationPorts, buffer);
+            buffer.append("\r\n");
+        }
+    }
+}
\ No newline at end of file
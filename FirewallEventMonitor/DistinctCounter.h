@@ -0,0 +1,119 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "EventKeys.h"
+#include "HyperLogLog.h"
+#include "VfpEventData.h"
+// ntl headers
+#include "ntlLocks.hpp"
+
+namespace FirewallEventMonitor
+{
+    // Distinct source addresses and distinct destination ports seen by each rule and each port,
+    // estimated with HyperLogLog: a single noisy client shows one source, a distributed scan many.
+    //
+    // Each rule or port gets its sketches the first time it is seen, at most MaxKeys times per
+    // table; after that an event costs a table lookup and a register update per sketch, using
+    // the hashes in EventKeys, and allocates nothing. Every report rolls the interval's sketches
+    // into capture-wide totals by merging them.
+    //
+    // As in TopTalkers, the event path updates the tables under the hot side of an
+    // ntl::AsymmetricLock and Report collects them under the cold side.
+    class DistinctCounter
+    {
+    public:
+        DistinctCounter();
+
+        // Called by one thread at a time.
+        void AddEvent(const EventKeys& eventKeys);
+
+        void AddEvent(const VfpEventData& eventData);
+
+        // Appends the rules and ports with the most distinct sources in the interval, with their
+        // estimates for the interval and since the capture started, then starts a new interval.
+        void Report(
+            size_t topCount,
+            unsigned long intervalInSeconds,
+            _Inout_ std::string& buffer);
+
+        // Events not counted against a rule or port because MaxKeys of them were already tracked.
+        unsigned long long GetDroppedEvents() const;
+
+        // Constants
+        static const size_t MaxKeys = 1024; // Per rules and per ports.
+        static const size_t SlotCount = MaxKeys * 2; // Power of two.
+        static const size_t ReportedKeys = 10;
+
+        DistinctCounter(DistinctCounter const&) = delete;
+        DistinctCounter& operator=(DistinctCounter const&) = delete;
+
+    private:
+        struct Counts
+        {
+            EventKey key;
+            unsigned long long hash = 0;
+            unsigned long long events = 0;
+            // This interval.
+            HyperLogLog sources;
+            HyperLogLog destinationPorts;
+            // Previous intervals, merged in by Report.
+            HyperLogLog totalSources;
+            HyperLogLog totalDestinationPorts;
+        };
+
+        struct Table
+        {
+            // Reserved for MaxKeys, so it never moves.
+            std::vector<Counts> counts;
+            // Index into counts plus one; 0 marks an empty slot. Keys are never removed.
+            std::vector<size_t> slots;
+        };
+
+        struct Row
+        {
+            EventKey key;
+            unsigned long long events;
+            double sources;
+            double destinationPorts;
+            double totalSources;
+            double totalDestinationPorts;
+        };
+
+        // Guards the tables.
+        ntl::AsymmetricLock m_Lock;
+        Table m_Rules;
+        Table m_Ports;
+        std::atomic<unsigned long long> m_DroppedEvents;
+        // Only used by Report.
+        std::vector<Row> m_Rows;
+
+        // Returns null if the table is full.
+        Counts* FindOrAdd(
+            Table& table,
+            const EventKey& key,
+            unsigned long long hash);
+
+        void AddToTable(
+            Table& table,
+            EventKeys::Field field,
+            const EventKeys& eventKeys);
+
+        // Fills m_Rows from the table's interval and rolls the interval into the totals.
+        // Called with the lock held.
+        void CollectRows(Table& table);
+
+        void FormatRows(
+            EventKeys::Field field,
+            size_t topCount,
+            _Inout_ std::string& buffer);
+    };
+}
\ No newline at end of file
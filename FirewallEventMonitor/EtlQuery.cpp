@@ -0,0 +1,274 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "EtlQuery.h"
+#include "ConsoleOutput.h"
+#include "EventFormatter.h"
+#include "FirewallEtwTraceCallback.h"
+#include "TimeOrderedMerge.h"
+// ntl headers
+#include "ntlEtwReader.hpp"
+#include "ntlLocks.hpp"
+// c++ headers
+#include <algorithm>
+#include <iterator>
+
+namespace FirewallEventMonitor
+{
+    // Merged matches are printed once this much text has built up.
+    const size_t ETL_QUERY_OUTPUT_BUFFER_SIZE = 1024 * 1024;
+
+    void WriteEtlQueryOutput(
+        _Inout_ std::string& text)
+    {
+        WriteConsoleUtf8(text);
+        text.clear();
+    }
+
+    EtlQuery::EtlQuery(
+        const EventPredicate& predicate,
+        bool ordered,
+        size_t workerCount)
+        : m_Predicate(predicate),
+        m_Ordered(ordered),
+        m_FilesFailed(0),
+        m_EventsScanned(0),
+        m_EventsMatched(0),
+        m_QueuedBatches(0),
+        m_Pool(workerCount)
+    {
+        ::InitializeCriticalSectionEx(&m_OutputCriticalSection, 4000, 0);
+    }
+
+    EtlQuery::~EtlQuery()
+    {
+        ::DeleteCriticalSection(&m_OutputCriticalSection);
+    }
+
+    EtlQueryResults EtlQuery::Run(
+        const std::vector<std::wstring>& filePaths)
+    {
+        m_Files.clear();
+        m_FilesFailed = 0;
+        m_EventsScanned = 0;
+        m_EventsMatched = 0;
+        unsigned long long stolenTasks = m_Pool.GetStolenTasks();
+
+        for (const auto& filePath : filePaths)
+        {
+            std::unique_ptr<FileResults> file(new FileResults);
+            file->filePath = filePath;
+            m_Files.push_back(std::move(file));
+        }
+
+        for (const auto& file : m_Files)
+        {
+            FileResults* fileResults = file.get();
+            m_Pool.Submit([this, fileResults](size_t worker) { QueryFile(*fileResults, worker); });
+        }
+        m_Pool.Wait();
+
+        if (m_Ordered)
+        {
+            WriteMergedMatches();
+        }
+
+        EtlQueryResults results;
+        results.filesFailed = m_FilesFailed;
+        results.filesRead = m_Files.size() - results.filesFailed;
+        results.eventsScanned = m_EventsScanned;
+        results.eventsMatched = m_EventsMatched;
+        results.tasksStolen = m_Pool.GetStolenTasks() - stolenTasks;
+
+        m_Files.clear();
+        return results;
+    }
+
+    void EtlQuery::MergeByTimeStamp(
+        const std::vector<std::vector<MatchedEvent>>& runs,
+        const std::function<void(const MatchedEvent&)>& output)
+    {
+        std::vector<RunCursor> cursors;
+        cursors.reserve(runs.size());
+        for (const auto& run : runs)
+        {
+            cursors.push_back(RunCursor{ &run, 0 });
+        }
+
+        MergeInTimeOrder(cursors, [&](size_t run)
+        {
+            output(cursors[run].GetEvent());
+        });
+    }
+
+    bool EtlQuery::RunCursor::Advance()
+    {
+        if (taken >= events->size())
+        {
+            return false;
+        }
+
+        ++taken;
+        return true;
+    }
+
+    LONGLONG EtlQuery::RunCursor::GetTimeStamp() const
+    {
+        return GetEvent().timeStamp;
+    }
+
+    const EtlQuery::MatchedEvent& EtlQuery::RunCursor::GetEvent() const
+    {
+        return (*events)[taken - 1];
+    }
+
+    bool EtlQuery::FileReader::operator()(
+        const PEVENT_RECORD pEventRecord)
+    {
+        // Only copies; workers do the decoding.
+        if (FirewallEtwTraceCallback::IsRuleMatchEvent(pEventRecord->EventHeader.EventDescriptor.Id))
+        {
+            batch->emplace_back(pEventRecord);
+            if (batch->size() >= BatchSize)
+            {
+                query->QueueBatch(*file, worker, *batch);
+            }
+        }
+
+        // The reader never keeps the events itself.
+        return false;
+    }
+
+    void EtlQuery::QueryFile(
+        FileResults& file,
+        size_t worker)
+    {
+        std::vector<ntl::EtwRecord> batch;
+        batch.reserve(BatchSize);
+
+        try
+        {
+            FileReader fileReader = { this, &file, worker, &batch };
+            ntl::EtwReader<FileReader> reader(fileReader);
+            reader.OpenSavedSession(file.filePath.c_str());
+            reader.WaitForSession();
+        }
+        catch (const std::exception &ex)
+        {
+            ++m_FilesFailed;
+            wprintf(L"Warning: Skipping capture %ls: %S.\n", file.filePath.c_str(), ex.what());
+            return;
+        }
+
+        if (!batch.empty())
+        {
+            QueueBatch(file, worker, batch);
+        }
+    }
+
+    void EtlQuery::QueueBatch(
+        FileResults& file,
+        size_t worker,
+        _Inout_ std::vector<ntl::EtwRecord>& batch)
+    {
+        file.batches.emplace_back();
+        std::vector<MatchedEvent>* matches = &file.batches.back();
+
+        if (m_QueuedBatches >= m_Pool.GetWorkerCount() * MaxQueuedBatchesPerWorker)
+        {
+            ProcessBatch(batch, *matches);
+            batch.clear();
+            return;
+        }
+
+        std::vector<ntl::EtwRecord> records;
+        records.swap(batch);
+        batch.reserve(BatchSize);
+
+        // Queued on the worker reading the file, which is blocked until the file ends,
+        // so the batch is stolen by whichever worker is idle first.
+        ++m_QueuedBatches;
+        m_Pool.Submit(worker, [this, matches, records = std::move(records)](size_t)
+        {
+            --m_QueuedBatches;
+            ProcessBatch(records, *matches);
+        });
+    }
+
+    void EtlQuery::ProcessBatch(
+        const std::vector<ntl::EtwRecord>& batch,
+        _Out_ std::vector<MatchedEvent>& matches)
+    {
+        Utf8EventData utf8EventData;
+        for (const auto& record : batch)
+        {
+            try
+            {
+                VfpEventData eventData = FirewallEtwTraceCallback::CollectEventData(record);
+                if (!m_Predicate.Matches(eventData))
+                {
+                    continue;
+                }
+
+                EventFormatter::ConvertToUtf8(eventData, utf8EventData);
+                MatchedEvent match;
+                match.timeStamp = eventData.timeStamp;
+                EventFormatter::FormatText(utf8EventData, match.text);
+                matches.push_back(std::move(match));
+            }
+            catch (const std::exception &ex)
+            {
+                wprintf(L"Warning: Skipping event: %S.\n", ex.what());
+            }
+        }
+
+        m_EventsScanned += batch.size();
+        m_EventsMatched += matches.size();
+
+        if (!m_Ordered && !matches.empty())
+        {
+            std::string text;
+            for (const auto& match : matches)
+            {
+                text.append(match.text);
+            }
+            std::vector<MatchedEvent>().swap(matches);
+
+            ntl::AutoReleaseCriticalSection csScoped(&m_OutputCriticalSection);
+            WriteEtlQueryOutput(text);
+        }
+    }
+
+    void EtlQuery::WriteMergedMatches()
+    {
+        // ETW delivers each file in time order, so each file's batches make one run.
+        std::vector<std::vector<MatchedEvent>> runs(m_Files.size());
+        for (size_t i = 0; i < m_Files.size(); ++i)
+        {
+            auto& run = runs[i];
+            for (auto& batch : m_Files[i]->batches)
+            {
+                std::move(batch.begin(), batch.end(), std::back_inserter(run));
+            }
+            m_Files[i]->batches.clear();
+
+            auto earlier = [](const MatchedEvent& a, const MatchedEvent& b) { return a.timeStamp < b.timeStamp; };
+            if (!std::is_sorted(run.begin(), run.end(), earlier))
+            {
+                std::stable_sort(run.begin(), run.end(), earlier);
+            }
+        }
+
+        std::string text;
+        text.reserve(ETL_QUERY_OUTPUT_BUFFER_SIZE);
+        MergeByTimeStamp(runs, [&](const MatchedEvent& match)
+        {
+            text.append(match.text);
+            if (text.size() >= ETL_QUERY_OUTPUT_BUFFER_SIZE)
+            {
+                WriteEtlQueryOutput(text);
+            }
+        });
+        WriteEtlQueryOutput(text);
+    }
+}
\ No newline at end of file
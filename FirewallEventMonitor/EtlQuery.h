@@ -0,0 +1,148 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ntl headers
+#include "ntlEtwRecord.hpp"
+
+#include "EventPredicate.h"
+#include "WorkStealingPool.h"
+
+namespace FirewallEventMonitor
+{
+    struct EtlQueryResults
+    {
+    public:
+        unsigned long long filesRead = 0;
+        unsigned long long filesFailed = 0;
+        // Rule match events decoded.
+        unsigned long long eventsScanned = 0;
+        unsigned long long eventsMatched = 0;
+        // Files and batches run by a worker other than the one they were queued on.
+        unsigned long long tasksStolen = 0;
+    };
+
+    // Finds the events in saved captures (.etl) that pass an EventPredicate, instead of
+    // opening a live session.
+    //
+    // Each file is a task on a WorkStealingPool. ETW delivers a file's events on one thread,
+    // which only copies them: every BatchSize events become a task on the deque of the worker
+    // that opened the file, and idle workers steal those batches to decode, filter and format
+    // them. So a single large file still uses every worker.
+    //
+    // Ordered output holds the matches until every file is read, then merges them by time;
+    // unordered output prints each batch's matches as soon as they are decoded.
+    class EtlQuery
+    {
+    public:
+        // 0 workers: one per logical processor.
+        EtlQuery(
+            const EventPredicate& predicate,
+            bool ordered,
+            size_t workerCount = 0);
+
+        ~EtlQuery();
+
+        // Queries every file, printing the matches to the console.
+        EtlQueryResults Run(const std::vector<std::wstring>& filePaths);
+
+        struct MatchedEvent
+        {
+            LONGLONG timeStamp;
+            // Text log line.
+            std::string text;
+        };
+
+        // Calls output for each event of runs, which are each in time order, in time order.
+        // Events with equal timestamps keep the order of their runs.
+        static void MergeByTimeStamp(
+            const std::vector<std::vector<MatchedEvent>>& runs,
+            const std::function<void(const MatchedEvent&)>& output);
+
+        // Constants
+        static const size_t BatchSize = 4096;
+        // Batches queued per worker before the reading thread decodes them itself,
+        // which bounds the copied events held in memory.
+        static const size_t MaxQueuedBatchesPerWorker = 4;
+
+        EtlQuery(EtlQuery const&) = delete;
+        EtlQuery& operator=(EtlQuery const&) = delete;
+
+    private:
+        struct FileResults
+        {
+            std::wstring filePath;
+            // The matches of each batch, in file order. Only the reading thread adds batches,
+            // and push_back keeps the earlier ones in place while workers fill them in.
+            std::deque<std::vector<MatchedEvent>> batches;
+        };
+
+        // Callback of the ntl::EtwReader reading one file.
+        struct FileReader
+        {
+            EtlQuery* query;
+            FileResults* file;
+            size_t worker;
+            // Events copied since the last batch was queued.
+            std::vector<ntl::EtwRecord>* batch;
+
+            bool operator()(const PEVENT_RECORD pEventRecord);
+        };
+
+        // Walks one run for MergeInTimeOrder.
+        struct RunCursor
+        {
+            const std::vector<MatchedEvent>* events;
+            // Events moved past; the cursor is on the last of them.
+            size_t taken;
+
+            bool Advance();
+
+            LONGLONG GetTimeStamp() const;
+
+            const MatchedEvent& GetEvent() const;
+        };
+
+        EventPredicate m_Predicate;
+        bool m_Ordered;
+        std::vector<std::unique_ptr<FileResults>> m_Files;
+        std::atomic<unsigned long long> m_FilesFailed;
+        std::atomic<unsigned long long> m_EventsScanned;
+        std::atomic<unsigned long long> m_EventsMatched;
+        // Batches handed to the pool and not started yet.
+        std::atomic<size_t> m_QueuedBatches;
+        // Guards the console for unordered output.
+        CRITICAL_SECTION m_OutputCriticalSection;
+        // Last, so the workers stop before the rest is destroyed.
+        WorkStealingPool m_Pool;
+
+        void QueryFile(
+            FileResults& file,
+            size_t worker);
+
+        // Hands the events to a worker, or decodes them on this thread if enough are queued.
+        void QueueBatch(
+            FileResults& file,
+            size_t worker,
+            _Inout_ std::vector<ntl::EtwRecord>& batch);
+
+        // Decodes the events and keeps those that match. Unordered, prints them right away instead.
+        void ProcessBatch(
+            const std::vector<ntl::EtwRecord>& batch,
+            _Out_ std::vector<MatchedEvent>& matches);
+
+        // Prints the matches of every file merged by time.
+        void WriteMergedMatches();
+    };
+}
\ No newline at end of file
@@ -0,0 +1,408 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "EventFormatter.h"
+// ntl headers
+#include "ntlString.hpp"
+
+namespace FirewallEventMonitor
+{
+    const char HEX_DIGITS[] = "0123456789abcdef";
+
+    void EventFormatter::FormatText(
+        const Utf8EventData& eventData,
+        _Inout_ std::string& buffer)
+    {
+        // Header
+        AppendLiteral("[", buffer);
+        buffer.append(eventData.date);
+        AppendLiteral(" ", buffer);
+        buffer.append(eventData.time);
+        AppendLiteral("] ", buffer);
+        buffer.append(eventData.direction);
+        AppendLiteral(" ", buffer);
+        buffer.append(eventData.ruleType);
+        AppendLiteral(" rule status = ", buffer);
+        buffer.append(eventData.status);
+        AppendLiteral(" \r\n", buffer);
+
+        // Port
+        AppendLiteral("  port {id = ", buffer);
+        buffer.append(eventData.portId);
+        AppendLiteral(", portName = ", buffer);
+        buffer.append(eventData.portName);
+        AppendLiteral(", portFriendlyName = ", buffer);
+        buffer.append(eventData.portFriendlyName);
+        AppendLiteral("} \r\n", buffer);
+
+        // Flow
+        AppendLiteral("  flow {src = ", buffer);
+        buffer.append(eventData.source);
+        AppendLiteral(", dst = ", buffer);
+        buffer.append(eventData.destination);
+        AppendLiteral(", protocol = ", buffer);
+        buffer.append(eventData.protocol);
+
+        if (!eventData.sourcePort.empty())
+        {
+            AppendLiteral(", srcPort = ", buffer);
+            buffer.append(eventData.sourcePort);
+        }
+
+        if (!eventData.destinationPort.empty())
+        {
+            AppendLiteral(", dstPort = ", buffer);
+            buffer.append(eventData.destinationPort);
+        }
+
+        if (!eventData.icmpType.empty())
+        {
+            AppendLiteral(", icmp type = ", buffer);
+            buffer.append(eventData.icmpType);
+        }
+
+        if (!eventData.isTcpSyn.empty())
+        {
+            AppendLiteral(", isTcpSyn = ", buffer);
+            buffer.append(eventData.isTcpSyn);
+        }
+
+        AppendLiteral("} \r\n", buffer);
+
+        // Rule
+        AppendLiteral("  rule {id = ", buffer);
+        buffer.append(eventData.ruleId);
+        AppendLiteral(", layer = ", buffer);
+        buffer.append(eventData.layerId);
+        AppendLiteral(", group = ", buffer);
+        buffer.append(eventData.groupId);
+        AppendLiteral(", gftFlags = ", buffer);
+        buffer.append(eventData.gftFlags);
+        AppendLiteral("} \r\n", buffer);
+
+        // Flow record
+        if (eventData.eventCount > 0)
+        {
+            AppendLiteral("  stats {count = ", buffer);
+            AppendNumber(eventData.eventCount, buffer);
+            AppendLiteral(", tcpSyn = ", buffer);
+            AppendNumber(eventData.synCount, buffer);
+            AppendLiteral(", last = ", buffer);
+            AppendTimestamp(eventData.lastTimeStamp, buffer);
+            AppendLiteral("} \r\n", buffer);
+        }
+
+        AppendLiteral("\r\n", buffer);
+    }
+
+    void EventFormatter::FormatJson(
+        const Utf8EventData& eventData,
+        _Inout_ std::string& buffer)
+    {
+        AppendLiteral("{\"time\":\"", buffer);
+        AppendTimestamp(eventData.timeStamp, buffer);
+        AppendLiteral("\"", buffer);
+
+        AppendJsonField("direction", eventData.direction, buffer);
+        AppendJsonField("ruleType", eventData.ruleType, buffer);
+        AppendJsonField("status", eventData.status, buffer);
+        // Port
+        AppendJsonNumberField("portId", eventData.portId, buffer);
+        AppendJsonField("portName", eventData.portName, buffer);
+        AppendJsonField("portFriendlyName", eventData.portFriendlyName, buffer);
+        // Flow
+        AppendJsonField("src", eventData.source, buffer);
+        AppendJsonField("dst", eventData.destination, buffer);
+        AppendJsonField("protocol", eventData.protocol, buffer);
+        if (!eventData.sourcePort.empty())
+        {
+            AppendJsonNumberField("srcPort", eventData.sourcePort, buffer);
+        }
+        if (!eventData.destinationPort.empty())
+        {
+            AppendJsonNumberField("dstPort", eventData.destinationPort, buffer);
+        }
+        if (!eventData.icmpType.empty())
+        {
+            AppendJsonField("icmpType", eventData.icmpType, buffer);
+        }
+        if (!eventData.isTcpSyn.empty())
+        {
+            AppendJsonField("isTcpSyn", eventData.isTcpSyn, buffer);
+        }
+        // Rule
+        AppendJsonField("ruleId", eventData.ruleId, buffer);
+        AppendJsonField("layer", eventData.layerId, buffer);
+        AppendJsonField("group", eventData.groupId, buffer);
+        AppendJsonField("gftFlags", eventData.gftFlags, buffer);
+        // Flow record
+        if (eventData.eventCount > 0)
+        {
+            AppendLiteral(",\"count\":", buffer);
+            AppendNumber(eventData.eventCount, buffer);
+            AppendLiteral(",\"synCount\":", buffer);
+            AppendNumber(eventData.synCount, buffer);
+            AppendLiteral(",\"lastTime\":\"", buffer);
+            AppendTimestamp(eventData.lastTimeStamp, buffer);
+            AppendLiteral("\"", buffer);
+        }
+
+        AppendLiteral("}\n", buffer);
+    }
+
+    void EventFormatter::FormatCsv(
+        const Utf8EventData& eventData,
+        _Inout_ std::string& buffer)
+    {
+        AppendTimestamp(eventData.timeStamp, buffer);
+
+        const std::string* fields[] = {
+            &eventData.direction,
+            &eventData.ruleType,
+            &eventData.status,
+            &eventData.portId,
+            &eventData.portName,
+            &eventData.portFriendlyName,
+            &eventData.source,
+            &eventData.destination,
+            &eventData.protocol,
+            &eventData.sourcePort,
+            &eventData.destinationPort,
+            &eventData.icmpType,
+            &eventData.isTcpSyn,
+            &eventData.ruleId,
+            &eventData.layerId,
+            &eventData.groupId,
+            &eventData.gftFlags };
+
+        for (const auto field : fields)
+        {
+            buffer.push_back(',');
+            AppendCsvField(*field, buffer);
+        }
+
+        // Flow record
+        if (eventData.eventCount > 0)
+        {
+            buffer.push_back(',');
+            AppendNumber(eventData.eventCount, buffer);
+            buffer.push_back(',');
+            AppendNumber(eventData.synCount, buffer);
+            buffer.push_back(',');
+            AppendTimestamp(eventData.lastTimeStamp, buffer);
+        }
+
+        AppendLiteral("\r\n", buffer);
+    }
+
+    void EventFormatter::FormatCsvHeader(
+        _Inout_ std::string& buffer,
+        bool flowRecords)
+    {
+        AppendLiteral(
+            "time,direction,ruleType,status,portId,portName,portFriendlyName,"
+            "src,dst,protocol,srcPort,dstPort,icmpType,isTcpSyn,ruleId,layer,group,gftFlags",
+            buffer);
+
+        if (flowRecords)
+        {
+            AppendLiteral(",count,synCount,lastTime", buffer);
+        }
+
+        AppendLiteral("\r\n", buffer);
+    }
+
+    void EventFormatter::AppendTimestamp(
+        LONGLONG timeStamp,
+        _Inout_ std::string& buffer)
+    {
+        FILETIME fileTime;
+        fileTime.dwLowDateTime = static_cast<DWORD>(timeStamp);
+        fileTime.dwHighDateTime = static_cast<DWORD>(timeStamp >> 32);
+        SYSTEMTIME systemTime = {};
+        ::FileTimeToSystemTime(&fileTime, &systemTime);
+
+        // yyyy-MM-ddTHH:mm:ss.fffZ
+        char text[24];
+        auto putDigits = [&text](size_t offset, unsigned int value, size_t count)
+        {
+            for (size_t i = count; i > 0; --i)
+            {
+                text[offset + i - 1] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            }
+        };
+        putDigits(0, systemTime.wYear, 4);
+        text[4] = '-';
+        putDigits(5, systemTime.wMonth, 2);
+        text[7] = '-';
+        putDigits(8, systemTime.wDay, 2);
+        text[10] = 'T';
+        putDigits(11, systemTime.wHour, 2);
+        text[13] = ':';
+        putDigits(14, systemTime.wMinute, 2);
+        text[16] = ':';
+        putDigits(17, systemTime.wSecond, 2);
+        text[19] = '.';
+        putDigits(20, systemTime.wMilliseconds, 3);
+        text[23] = 'Z';
+
+        buffer.append(text, sizeof(text));
+    }
+
+    void EventFormatter::AppendNumber(
+        unsigned long long value,
+        _Inout_ std::string& buffer)
+    {
+        // Digits are produced least significant first.
+        char digits[20];
+        size_t count = 0;
+        do
+        {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+
+        while (count > 0)
+        {
+            buffer.push_back(digits[--count]);
+        }
+    }
+
+    void EventFormatter::AppendJsonField(
+        const char* name,
+        const std::string& value,
+        _Inout_ std::string& buffer)
+    {
+        AppendLiteral(",\"", buffer);
+        buffer.append(name);
+        AppendLiteral("\":", buffer);
+        AppendJsonString(value, buffer);
+    }
+
+    void EventFormatter::AppendJsonNumberField(
+        const char* name,
+        const std::string& value,
+        _Inout_ std::string& buffer)
+    {
+        AppendLiteral(",\"", buffer);
+        buffer.append(name);
+        AppendLiteral("\":", buffer);
+
+        // Leading zeros would not be valid JSON; a value that is not a number keeps the field's type.
+        bool isNumber =
+            !value.empty() &&
+            (value[0] != '0' || value.size() == 1) &&
+            value.find_first_not_of("0123456789") == std::string::npos;
+
+        if (!isNumber)
+        {
+            AppendLiteral("null", buffer);
+            return;
+        }
+
+        buffer.append(value);
+    }
+
+    void EventFormatter::AppendJsonString(
+        const std::string& value,
+        _Inout_ std::string& buffer)
+    {
+        buffer.push_back('"');
+
+        // Multi-byte UTF-8 sequences are all >= 0x80 and pass through unchanged.
+        size_t runStart = 0;
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            unsigned char ch = static_cast<unsigned char>(value[i]);
+            if (ch >= 0x20 && ch != '"' && ch != '\\')
+            {
+                continue;
+            }
+
+            // Copy the run of characters that need no escaping, then escape this one.
+            buffer.append(value, runStart, i - runStart);
+            runStart = i + 1;
+
+            buffer.push_back('\\');
+            switch (ch)
+            {
+            case '"': buffer.push_back('"'); break;
+            case '\\': buffer.push_back('\\'); break;
+            case '\n': buffer.push_back('n'); break;
+            case '\r': buffer.push_back('r'); break;
+            case '\t': buffer.push_back('t'); break;
+            default:
+                AppendLiteral("u00", buffer);
+                buffer.push_back(HEX_DIGITS[(ch >> 4) & 0xF]);
+                buffer.push_back(HEX_DIGITS[ch & 0xF]);
+            }
+        }
+        buffer.append(value, runStart, value.size() - runStart);
+
+        buffer.push_back('"');
+    }
+
+    void EventFormatter::AppendCsvField(
+        const std::string& value,
+        _Inout_ std::string& buffer)
+    {
+        if (value.find_first_of(",\"\r\n") == std::string::npos)
+        {
+            buffer.append(value);
+            return;
+        }
+
+        // Quote the field and double any embedded quotes.
+        buffer.push_back('"');
+        size_t runStart = 0;
+        for (size_t quote = value.find('"'); quote != std::string::npos; quote = value.find('"', quote + 1))
+        {
+            buffer.append(value, runStart, quote + 1 - runStart);
+            buffer.push_back('"');
+            runStart = quote + 1;
+        }
+        buffer.append(value, runStart, value.size() - runStart);
+        buffer.push_back('"');
+    }
+
+    void EventFormatter::ConvertToUtf8(
+        const VfpEventData& eventData,
+        _Inout_ Utf8EventData& utf8EventData)
+    {
+        // clear() keeps each string's capacity, so steady state conversion does not allocate.
+        auto convert = [](const std::wstring& value, std::string& utf8Value)
+        {
+            utf8Value.clear();
+            ntl::String::append_utf8(value, utf8Value);
+        };
+
+        utf8EventData.timeStamp = eventData.timeStamp;
+        convert(eventData.date, utf8EventData.date);
+        convert(eventData.time, utf8EventData.time);
+        convert(eventData.direction, utf8EventData.direction);
+        convert(eventData.ruleType, utf8EventData.ruleType);
+        convert(eventData.status, utf8EventData.status);
+        // Port
+        convert(eventData.portId, utf8EventData.portId);
+        convert(eventData.portName, utf8EventData.portName);
+        convert(eventData.portFriendlyName, utf8EventData.portFriendlyName);
+        // Flow
+        convert(eventData.source, utf8EventData.source);
+        convert(eventData.destination, utf8EventData.destination);
+        convert(eventData.protocol, utf8EventData.protocol);
+        convert(eventData.sourcePort, utf8EventData.sourcePort);
+        convert(eventData.destinationPort, utf8EventData.destinationPort);
+        convert(eventData.icmpType, utf8EventData.icmpType);
+        convert(eventData.isTcpSyn, utf8EventData.isTcpSyn);
+        // Rule
+        convert(eventData.ruleId, utf8EventData.ruleId);
+        convert(eventData.layerId, utf8EventData.layerId);
+        convert(eventData.groupId, utf8EventData.groupId);
+        convert(eventData.gftFlags, utf8EventData.gftFlags);
+        // Flow record
+        utf8EventData.eventCount = eventData.eventCount;
+        utf8EventData.synCount = eventData.synCount;
+        utf8EventData.lastTimeStamp = eventData.lastTimeStamp;
+    }
+}
\ No newline at end of file
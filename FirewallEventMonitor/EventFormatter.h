@@ -0,0 +1,88 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// c++ headers
+#include <string>
+
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    // Hand-written formatting of events into reusable UTF-8 buffers.
+    // Avoids the locale-aware wide formatting of the CRT printf family on the event path.
+    // Formatters work on Utf8EventData so fields are transcoded once no matter how many sinks run.
+    class EventFormatter
+    {
+    public:
+        // Appends the multi-line text layout written to .log files (CRLF line endings).
+        // Flow records (eventCount > 0) get an extra stats line; likewise extra fields in JSON and CSV.
+        static void FormatText(
+            const Utf8EventData& eventData,
+            _Inout_ std::string& buffer);
+
+        // Appends one JSON object per event followed by a newline (JSON Lines).
+        // Empty optional flow fields are left out, as in the text layout.
+        static void FormatJson(
+            const Utf8EventData& eventData,
+            _Inout_ std::string& buffer);
+
+        // Appends one RFC 4180 record per event, in the columns of FormatCsvHeader.
+        static void FormatCsv(
+            const Utf8EventData& eventData,
+            _Inout_ std::string& buffer);
+
+        // Appends the CSV header line written at the top of every .csv file.
+        // flowRecords adds the columns FormatCsv writes for flow records.
+        static void FormatCsvHeader(
+            _Inout_ std::string& buffer,
+            bool flowRecords = false);
+
+        // Transcodes every field once; the formatters above then only copy bytes.
+        static void ConvertToUtf8(
+            const VfpEventData& eventData,
+            _Inout_ Utf8EventData& utf8EventData);
+
+        // Appends the event FILETIME as ISO 8601 UTC with milliseconds: 2017-09-07T22:42:28.123Z
+        static void AppendTimestamp(
+            LONGLONG timeStamp,
+            _Inout_ std::string& buffer);
+
+    private:
+
+        static void AppendNumber(
+            unsigned long long value,
+            _Inout_ std::string& buffer);
+
+        // Appends "name":"value", preceded by a comma.
+        static void AppendJsonField(
+            const char* name,
+            const std::string& value,
+            _Inout_ std::string& buffer);
+
+        // Appends "name":value for a numeric field, or "name":null if value is not a decimal number.
+        static void AppendJsonNumberField(
+            const char* name,
+            const std::string& value,
+            _Inout_ std::string& buffer);
+
+        // Appends value as a quoted JSON string, escaping quotes, backslashes and control characters.
+        static void AppendJsonString(
+            const std::string& value,
+            _Inout_ std::string& buffer);
+
+        // Appends value, quoted only if it contains a comma, quote or line break.
+        static void AppendCsvField(
+            const std::string& value,
+            _Inout_ std::string& buffer);
+
+        template <size_t N>
+        static void AppendLiteral(
+            const char (&literal)[N],
+            _Inout_ std::string& buffer)
+        {
+            buffer.append(literal, N - 1);
+        }
+    };
+}
\ No newline at end of file
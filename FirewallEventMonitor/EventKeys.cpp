@@ -0,0 +1,238 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "EventKeys.h"
+#include "RuleHitCounter.h"
+
+// os headers
+#include <ws2tcpip.h>
+
+namespace FirewallEventMonitor
+{
+    const size_t MAX_NUMBER_KEY_DIGITS = 19;
+
+    const unsigned char IPV4_MAPPED_PREFIX[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+
+    // MurmurHash3 finalizer.
+    unsigned long long MixBits(unsigned long long value)
+    {
+        value ^= value >> 33;
+        value *= 0xFF51AFD7ED558CCDull;
+        value ^= value >> 33;
+        value *= 0xC4CEB9FE1A85EC53ull;
+        value ^= value >> 33;
+        return value;
+    }
+
+    void EventKeys::Parse(
+        const VfpEventData& eventData)
+    {
+        parsed[SourceAddress] = ParseAddress(eventData.source, &keys[SourceAddress]);
+        parsed[DestinationAddress] = ParseAddress(eventData.destination, &keys[DestinationAddress]);
+        parsed[DestinationPort] = ParseNumber(eventData.destinationPort, &keys[DestinationPort]);
+        parsed[RuleId] = ParseRuleId(eventData.ruleId, &keys[RuleId]);
+        parsed[PortId] = ParseNumber(eventData.portId, &keys[PortId]);
+
+        for (size_t i = 0; i < FieldCount; ++i)
+        {
+            hashes[i] = parsed[i] ? Hash(keys[i]) : 0;
+        }
+    }
+
+    bool EventKeys::ParseAddress(
+        const std::wstring& address,
+        _Out_ EventKey* key)
+    {
+        memset(key->bytes, 0, sizeof(key->bytes));
+        if (address.empty())
+        {
+            return false;
+        }
+
+        IN_ADDR ipv4;
+        if (::InetPtonW(AF_INET, address.c_str(), &ipv4) == 1)
+        {
+            memcpy_s(key->bytes, sizeof(key->bytes), IPV4_MAPPED_PREFIX, sizeof(IPV4_MAPPED_PREFIX));
+            memcpy_s(key->bytes + sizeof(IPV4_MAPPED_PREFIX), sizeof(key->bytes) - sizeof(IPV4_MAPPED_PREFIX), &ipv4, sizeof(ipv4));
+            return true;
+        }
+
+        IN6_ADDR ipv6;
+        if (::InetPtonW(AF_INET6, address.c_str(), &ipv6) == 1)
+        {
+            static_assert(sizeof(IN6_ADDR) == sizeof(EventKey), "IN6_ADDR is 16 bytes");
+            memcpy_s(key->bytes, sizeof(key->bytes), &ipv6, sizeof(ipv6));
+            return true;
+        }
+
+        return false;
+    }
+
+    bool EventKeys::ParseNumber(
+        const std::wstring& number,
+        _Out_ EventKey* key)
+    {
+        memset(key->bytes, 0, sizeof(key->bytes));
+        if (number.empty() ||
+            number.size() > MAX_NUMBER_KEY_DIGITS)
+        {
+            return false;
+        }
+
+        unsigned long long value = 0;
+        for (const auto ch : number)
+        {
+            if (ch < L'0' || ch > L'9')
+            {
+                return false;
+            }
+            value = (value * 10) + (ch - L'0');
+        }
+
+        memcpy_s(key->bytes, sizeof(key->bytes), &value, sizeof(value));
+        return true;
+    }
+
+    bool EventKeys::ParseRuleId(
+        const std::wstring& ruleId,
+        _Out_ EventKey* key)
+    {
+        memset(key->bytes, 0, sizeof(key->bytes));
+
+        GUID guid;
+        if (!RuleHitCounter::ParseRuleId(ruleId, &guid))
+        {
+            return false;
+        }
+
+        static_assert(sizeof(GUID) == sizeof(EventKey), "GUID is 16 bytes");
+        memcpy_s(key->bytes, sizeof(key->bytes), &guid, sizeof(guid));
+        return true;
+    }
+
+    unsigned long long EventKeys::Hash(
+        const EventKey& key)
+    {
+        unsigned long long halves[2];
+        static_assert(sizeof(halves) == sizeof(EventKey), "EventKey is 16 bytes");
+        memcpy_s(halves, sizeof(halves), key.bytes, sizeof(key.bytes));
+
+        return MixBits(halves[0] ^ MixBits(halves[1]));
+    }
+
+    bool EventKeys::Equal(
+        const EventKey& lhs,
+        const EventKey& rhs)
+    {
+        return memcmp(lhs.bytes, rhs.bytes, sizeof(lhs.bytes)) == 0;
+    }
+
+    void EventKeys::AppendKey(
+        Field field,
+        const EventKey& key,
+        _Inout_ std::string& buffer)
+    {
+        switch (field)
+        {
+        case SourceAddress:
+        case DestinationAddress:
+        {
+            WCHAR formatted[INET6_ADDRSTRLEN] = { 0 };
+            if (memcmp(key.bytes, IPV4_MAPPED_PREFIX, sizeof(IPV4_MAPPED_PREFIX)) == 0)
+            {
+                IN_ADDR ipv4;
+                memcpy_s(&ipv4, sizeof(ipv4), key.bytes + sizeof(IPV4_MAPPED_PREFIX), sizeof(ipv4));
+                ::InetNtopW(AF_INET, &ipv4, formatted, ARRAYSIZE(formatted));
+            }
+            else
+            {
+                IN6_ADDR ipv6;
+                memcpy_s(&ipv6, sizeof(ipv6), key.bytes, sizeof(ipv6));
+                ::InetNtopW(AF_INET6, &ipv6, formatted, ARRAYSIZE(formatted));
+            }
+
+            // Formatted addresses are ASCII.
+            for (const WCHAR* ch = formatted; *ch != L'\0'; ++ch)
+            {
+                buffer.push_back(static_cast<char>(*ch));
+            }
+            break;
+        }
+
+        case RuleId:
+        {
+            GUID ruleId;
+            memcpy_s(&ruleId, sizeof(ruleId), key.bytes, sizeof(key.bytes));
+            RuleHitCounter::AppendRuleId(ruleId, buffer);
+            break;
+        }
+
+        default:
+        {
+            unsigned long long value;
+            memcpy_s(&value, sizeof(value), key.bytes, sizeof(value));
+            buffer.append(std::to_string(value));
+            break;
+        }
+        }
+    }
+
+    const char* EventKeys::GetFieldName(
+        Field field)
+    {
+        switch (field)
+        {
+        case SourceAddress:
+            return "Source";
+        case DestinationAddress:
+            return "Destination";
+        case DestinationPort:
+            return "Destination port";
+        case RuleId:
+            return "Rule Id";
+        case PortId:
+            return "Port Id";
+        default:
+            return "Unknown";
+        }
+    }
+
+    void EventKeys::AppendTitleColumn(
+        const std::string& title,
+        _Inout_ std::string& buffer)
+    {
+        buffer.append("  ");
+        buffer.append(title);
+        if (title.size() < KeyColumnWidth)
+        {
+            buffer.append(KeyColumnWidth - title.size(), ' ');
+        }
+    }
+
+    void EventKeys::AppendKeyColumn(
+        Field field,
+        const EventKey& key,
+        _Inout_ std::string& buffer)
+    {
+        size_t keyStart = buffer.size();
+        buffer.append("    ");
+        AppendKey(field, key, buffer);
+        size_t keyLength = buffer.size() - keyStart;
+        if (keyLength < KeyColumnWidth + 2)
+        {
+            buffer.append(KeyColumnWidth + 2 - keyLength, ' ');
+        }
+    }
+
+    void EventKeys::AppendValueColumn(
+        const std::string& value,
+        size_t width,
+        _Inout_ std::string& buffer)
+    {
+        if (value.size() < width)
+        {
+            buffer.append(width - value.size(), ' ');
+        }
+        buffer.append(value);
+    }
+}
\ No newline at end of file
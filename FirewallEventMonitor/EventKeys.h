@@ -0,0 +1,92 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <string>
+
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    // Binary key: an address, a GUID or a number, zero padded.
+    struct EventKey
+    {
+        unsigned char bytes[16];
+    };
+
+    // The fields the live statistics group events by, parsed to binary keys and hashed
+    // once per event and shared by every statistic (see TopTalkers, DistinctCounter).
+    // Fields that do not parse are marked and not counted.
+    struct EventKeys
+    {
+    public:
+        enum Field
+        {
+            SourceAddress,
+            DestinationAddress,
+            DestinationPort,
+            RuleId,
+            PortId,
+            FieldCount
+        };
+
+        EventKey keys[FieldCount];
+        unsigned long long hashes[FieldCount];
+        bool parsed[FieldCount];
+
+        void Parse(const VfpEventData& eventData);
+
+        // Parses an IPv4 or IPv6 address. IPv4 addresses are stored IPv4-mapped (::ffff:a.b.c.d).
+        static bool ParseAddress(
+            const std::wstring& address,
+            _Out_ EventKey* key);
+
+        // Parses a decimal number of up to 19 digits.
+        static bool ParseNumber(
+            const std::wstring& number,
+            _Out_ EventKey* key);
+
+        // Parses a rule id GUID (see RuleHitCounter::ParseRuleId).
+        static bool ParseRuleId(
+            const std::wstring& ruleId,
+            _Out_ EventKey* key);
+
+        // 64-bit hash with every bit depending on every key byte, as HyperLogLog requires.
+        static unsigned long long Hash(const EventKey& key);
+
+        static bool Equal(
+            const EventKey& lhs,
+            const EventKey& rhs);
+
+        // Appends the key as text: a formatted address, a rule id or a number.
+        static void AppendKey(
+            Field field,
+            const EventKey& key,
+            _Inout_ std::string& buffer);
+
+        static const char* GetFieldName(Field field);
+
+        // Report layout shared by the statistics grouped by these keys (see TopTalkers, DistinctCounter):
+        // a key column, indented and padded to KeyColumnWidth, then right-aligned value columns.
+        static void AppendTitleColumn(
+            const std::string& title,
+            _Inout_ std::string& buffer);
+
+        static void AppendKeyColumn(
+            Field field,
+            const EventKey& key,
+            _Inout_ std::string& buffer);
+
+        static void AppendValueColumn(
+            const std::string& value,
+            size_t width,
+            _Inout_ std::string& buffer);
+
+        // Constants
+        static const size_t KeyColumnWidth = 40;
+    };
+}
\ No newline at end of file
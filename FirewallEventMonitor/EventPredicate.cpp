@@ -0,0 +1,121 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "EventPredicate.h"
+// ntl headers
+#include "ntlString.hpp"
+// c++ headers
+#include <algorithm>
+
+namespace FirewallEventMonitor
+{
+    EventPredicate::EventPredicate(
+        const Parameters& parameters,
+        LONGLONG minimumTimeStamp)
+        : m_IpAddressFilters(parameters.ipAddressFilters),
+        m_RuleIdFilters(parameters.ruleIdFilters),
+        m_PortFilters(parameters.portFilters),
+        m_ProtocolFilters(parameters.protocolFilters),
+        m_ActionFilter(parameters.actionFilter),
+        m_MinimumTimeStamp(minimumTimeStamp)
+    {
+    }
+
+    bool EventPredicate::Matches(
+        const VfpEventData& eventData) const
+    {
+        if ((std::max)(eventData.timeStamp, eventData.lastTimeStamp) < m_MinimumTimeStamp)
+        {
+            return false;
+        }
+
+        // An event passes the address filters if either its source or its destination does.
+        bool sourceNotMatching =
+            !eventData.source.empty() &&
+            !MatchFilter(m_IpAddressFilters, eventData.source);
+        bool destinationNotMatching =
+            !eventData.destination.empty() &&
+            !MatchFilter(m_IpAddressFilters, eventData.destination);
+        if (sourceNotMatching && destinationNotMatching)
+        {
+            return false;
+        }
+
+        if (!MatchFilter(m_RuleIdFilters, eventData.ruleId))
+        {
+            return false;
+        }
+
+        // ICMP events have no ports, so they never pass a port filter.
+        if (!m_PortFilters.empty())
+        {
+            bool sourcePortMatching =
+                !eventData.sourcePort.empty() &&
+                MatchFilter(m_PortFilters, eventData.sourcePort);
+            bool destinationPortMatching =
+                !eventData.destinationPort.empty() &&
+                MatchFilter(m_PortFilters, eventData.destinationPort);
+            if (!sourcePortMatching && !destinationPortMatching)
+            {
+                return false;
+            }
+        }
+
+        if (!m_ActionFilter.empty() &&
+            !ntl::String::iordinal_equals(eventData.ruleType, m_ActionFilter))
+        {
+            return false;
+        }
+
+        if (!m_ProtocolFilters.empty())
+        {
+            auto found = std::find_if(
+                m_ProtocolFilters.begin(),
+                m_ProtocolFilters.end(),
+                [&](const std::wstring& protocol) { return ntl::String::iordinal_equals(eventData.protocol, protocol); });
+            if (found == m_ProtocolFilters.end())
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    const std::vector<std::wstring>& EventPredicate::GetIpAddressFilters() const
+    {
+        return m_IpAddressFilters;
+    }
+
+    const std::vector<std::wstring>& EventPredicate::GetRuleIdFilters() const
+    {
+        return m_RuleIdFilters;
+    }
+
+    const std::vector<std::wstring>& EventPredicate::GetPortFilters() const
+    {
+        return m_PortFilters;
+    }
+
+    LONGLONG EventPredicate::GetMinimumTimeStamp() const
+    {
+        return m_MinimumTimeStamp;
+    }
+
+    bool EventPredicate::MatchFilter(
+        const std::vector<std::wstring>& filters,
+        const std::wstring& value)
+    {
+        if (filters.empty())
+        {
+            return true;
+        }
+
+        auto found = std::find(
+            filters.begin(),
+            filters.end(),
+            value);
+
+        return found != filters.end();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <string>
+#include <vector>
+
+#include "UserInput.h"
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    // The event filters: -IP, -Rule, -Port, -Action and -Protocol, and the time window of -Last.
+    // Live capture, replay, -Query, -Input and -Merge all match events here.
+    // Every filter that was given must match; an empty filter matches every event.
+    class EventPredicate
+    {
+    public:
+        // minimumTimeStamp is a FILETIME; 0 matches all times.
+        EventPredicate(
+            const Parameters& parameters,
+            LONGLONG minimumTimeStamp);
+
+        bool Matches(const VfpEventData& eventData) const;
+
+        // For queries that rule out whole files by their index before matching events.
+        const std::vector<std::wstring>& GetIpAddressFilters() const;
+
+        const std::vector<std::wstring>& GetRuleIdFilters() const;
+
+        const std::vector<std::wstring>& GetPortFilters() const;
+
+        LONGLONG GetMinimumTimeStamp() const;
+
+    private:
+        std::vector<std::wstring> m_IpAddressFilters;
+        std::vector<std::wstring> m_RuleIdFilters;
+        std::vector<std::wstring> m_PortFilters;
+        std::vector<std::wstring> m_ProtocolFilters;
+        std::wstring m_ActionFilter;
+        LONGLONG m_MinimumTimeStamp;
+
+        static bool MatchFilter(
+            const std::vector<std::wstring>& filters,
+            const std::wstring& value);
+    };
+}
\ No newline at end of file
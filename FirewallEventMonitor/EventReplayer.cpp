@@ -0,0 +1,241 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "EventReplayer.h"
+#include "BinaryLogReader.h"
+#include "LatencyMonitor.h"
+#include "Timer.h"
+// c++ headers
+#include <algorithm>
+
+namespace FirewallEventMonitor
+{
+    const LONGLONG FILETIME_TICKS_PER_MILLISECOND = 10000;
+
+    EventReplayer::EventReplayer(
+        const std::wstring& filePath,
+        double speed,
+        const FirewallEtwTraceCallback& callback)
+        : m_FilePath(filePath),
+        m_Speed(speed),
+        m_Callback(callback),
+        m_Stopping(false),
+        m_Finished(false)
+    {
+        LARGE_INTEGER frequency;
+        ::QueryPerformanceFrequency(&frequency);
+        m_FileTimeTicksPerCounterTick = 1e7 / static_cast<double>(frequency.QuadPart);
+    }
+
+    EventReplayer::~EventReplayer()
+    {
+        Stop();
+    }
+
+    void EventReplayer::Start()
+    {
+        m_Thread = std::thread(&EventReplayer::Run, this);
+    }
+
+    void EventReplayer::Stop()
+    {
+        m_Stopping = true;
+        if (m_Thread.joinable())
+        {
+            m_Thread.join();
+        }
+    }
+
+    bool EventReplayer::IsFinished() const
+    {
+        return m_Finished;
+    }
+
+    void EventReplayer::WriteResults() const
+    {
+        double eventsPerSecond = m_Results.elapsedInSeconds > 0.0 ?
+            static_cast<double>(m_Results.eventsRead - m_Results.eventsDropped) / m_Results.elapsedInSeconds :
+            0.0;
+
+        wprintf(L"Replayed %llu events from %ls in %.2f seconds: %.0f events per second sustained. Dropped %llu events.\n",
+            m_Results.eventsRead,
+            m_FilePath.c_str(),
+            m_Results.elapsedInSeconds,
+            eventsPerSecond,
+            m_Results.eventsDropped);
+
+        if (m_Speed > 0.0)
+        {
+            wprintf(L"Fell behind the original timing by up to %.1f milliseconds at %gx.\n",
+                m_Results.maximumLagInMilliseconds,
+                m_Speed);
+        }
+    }
+
+    EventReplayResults EventReplayer::GetResults() const
+    {
+        return m_Results;
+    }
+
+    LONGLONG EventReplayer::GetReplayOffset(
+        LONGLONG timeStamp,
+        LONGLONG firstTimeStamp,
+        double speed)
+    {
+        if (speed <= 0.0 ||
+            timeStamp <= firstTimeStamp)
+        {
+            return 0;
+        }
+
+        return static_cast<LONGLONG>(static_cast<double>(timeStamp - firstTimeStamp) / speed);
+    }
+
+    void EventReplayer::Run()
+    {
+        LONGLONG startCounter = LatencyMonitor::Now();
+        try
+        {
+            if (BinaryLogReader::IsBinaryLog(m_FilePath))
+            {
+                ReplayBinaryLog();
+            }
+            else
+            {
+                ReplaySavedCapture();
+            }
+        }
+        catch (const std::exception &ex)
+        {
+            wprintf(L"Error: Replaying %ls raised exception: %S.\n", m_FilePath.c_str(), ex.what());
+        }
+
+        m_Results.elapsedInSeconds =
+            static_cast<double>(LatencyMonitor::Now() - startCounter) * m_FileTimeTicksPerCounterTick / 1e7;
+        m_Finished = true;
+    }
+
+    void EventReplayer::ReplaySavedCapture()
+    {
+        RecordReplayer recordReplayer = { this };
+        ntl::EtwReader<RecordReplayer> reader(recordReplayer);
+        reader.OpenSavedSession(m_FilePath.c_str());
+        reader.WaitForSession();
+    }
+
+    bool EventReplayer::RecordReplayer::operator()(
+        const PEVENT_RECORD pEventRecord) try
+    {
+        // ETW cannot be asked to stop reading a saved capture, so the rest is skipped instead.
+        if (replayer->m_Stopping ||
+            !FirewallEtwTraceCallback::IsRuleMatchEvent(pEventRecord->EventHeader.EventDescriptor.Id))
+        {
+            return false;
+        }
+
+        ++replayer->m_Results.eventsRead;
+        // The record belongs to the reader: the callback gets a copy stamped with its due time.
+        EVENT_RECORD eventRecord = *pEventRecord;
+        eventRecord.EventHeader.TimeStamp.QuadPart = replayer->Pace(pEventRecord->EventHeader.TimeStamp.QuadPart);
+        if (!replayer->Admit())
+        {
+            return false;
+        }
+
+        replayer->m_Callback.ProcessAdmittedEvent(&eventRecord);
+        // The reader must not keep the record.
+        return false;
+    }
+    catch (const std::exception &ex)
+    {
+        wprintf(L"Exception: %S.\n", ex.what());
+        return false;
+    }
+
+    void EventReplayer::ReplayBinaryLog()
+    {
+        BinaryLogReader reader(m_FilePath);
+        VfpEventData eventData;
+        LARGE_INTEGER timeStamp;
+
+        while (!m_Stopping &&
+            reader.ReadNext(&eventData))
+        {
+            ++m_Results.eventsRead;
+            timeStamp.QuadPart = Pace(eventData.timeStamp);
+            if (!Admit())
+            {
+                continue;
+            }
+
+            // A flow record replays as a single event, its first.
+            eventData.timeStamp = timeStamp.QuadPart;
+            Timer::GetDateAndTime(timeStamp, &eventData.date, &eventData.time);
+            eventData.eventCount = 0;
+            eventData.synCount = 0;
+            eventData.lastTimeStamp = 0;
+
+            m_Callback.ProcessEventData(eventData);
+        }
+    }
+
+    LONGLONG EventReplayer::Pace(
+        LONGLONG timeStamp)
+    {
+        if (!m_Started)
+        {
+            m_Started = true;
+            m_FirstTimeStamp = timeStamp;
+            m_StartCounter = LatencyMonitor::Now();
+
+            FILETIME fileTime;
+            ::GetSystemTimeAsFileTime(&fileTime);
+            ULARGE_INTEGER now;
+            now.LowPart = fileTime.dwLowDateTime;
+            now.HighPart = fileTime.dwHighDateTime;
+            m_StartTimeStamp = static_cast<LONGLONG>(now.QuadPart);
+        }
+
+        if (m_Speed <= 0.0)
+        {
+            return m_StartTimeStamp + GetElapsedTicks();
+        }
+
+        LONGLONG offset = GetReplayOffset(timeStamp, m_FirstTimeStamp, m_Speed);
+        LONGLONG elapsed = GetElapsedTicks();
+        // Sleeps in slices so Stop is not kept waiting by a long gap between events.
+        // Less than a millisecond early is close enough.
+        while (offset - elapsed >= FILETIME_TICKS_PER_MILLISECOND &&
+            !m_Stopping)
+        {
+            LONGLONG sleepInMilliseconds = (offset - elapsed) / FILETIME_TICKS_PER_MILLISECOND;
+            ::Sleep(static_cast<DWORD>((std::min)(sleepInMilliseconds, static_cast<LONGLONG>(MaximumSleepInMilliseconds))));
+            elapsed = GetElapsedTicks();
+        }
+
+        if (elapsed > offset)
+        {
+            m_Results.maximumLagInMilliseconds = (std::max)(
+                m_Results.maximumLagInMilliseconds,
+                static_cast<double>(elapsed - offset) / FILETIME_TICKS_PER_MILLISECOND);
+        }
+
+        return m_StartTimeStamp + offset;
+    }
+
+    bool EventReplayer::Admit()
+    {
+        // The callback counts the event and the drop in SelfMetrics, as for a live one.
+        if (!m_Callback.AdmitEvent())
+        {
+            ++m_Results.eventsDropped;
+            return false;
+        }
+        return true;
+    }
+
+    LONGLONG EventReplayer::GetElapsedTicks() const
+    {
+        return static_cast<LONGLONG>(static_cast<double>(LatencyMonitor::Now() - m_StartCounter) * m_FileTimeTicksPerCounterTick);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "EventSource.h"
+#include "FirewallEtwTraceCallback.h"
+
+namespace FirewallEventMonitor
+{
+    struct EventReplayResults
+    {
+        unsigned long long eventsRead = 0;
+        // Refused because -EventThrottle or -TimeLimit was reached, as the live callback refuses them.
+        unsigned long long eventsDropped = 0;
+        double elapsedInSeconds = 0.0;
+        // How far the callback fell behind the original timing; 0 when replaying as fast as possible.
+        double maximumLagInMilliseconds = 0.0;
+    };
+
+    // Feeds the rule match events of a saved capture (.etl) or binary log (.bin) to the event
+    // callback from its own thread, as ETW would, with no VFP provider or trace session.
+    //
+    // Events are due at their original spacing divided by the speed, and are stamped with the
+    // time they are due, so flow timeouts, rate history, bursts and event age behave as they
+    // would live. At the maximum speed they are stamped with the time they are replayed.
+    class EventReplayer : public EventSource
+    {
+    public:
+        // speed: 1.0 keeps the original timing, 4.0 replays four times faster, 0.0 as fast as possible.
+        EventReplayer(
+            const std::wstring& filePath,
+            double speed,
+            const FirewallEtwTraceCallback& callback);
+
+        // Stops the replay.
+        ~EventReplayer();
+
+        // Starts replaying on a new thread.
+        void Start() override;
+
+        // Skips the rest of the file and waits for the replay thread.
+        void Stop() override;
+
+        // True once every event has been replayed, or the file could not be read.
+        bool IsFinished() const override;
+
+        // Prints the replay's sustained rate, drops and lag.
+        void WriteResults() const override;
+
+        // Complete once IsFinished or Stop has returned.
+        EventReplayResults GetResults() const;
+
+        // When an event is due, in FILETIME ticks after the first event is replayed.
+        // Events earlier than the first are due straight away.
+        static LONGLONG GetReplayOffset(
+            LONGLONG timeStamp,
+            LONGLONG firstTimeStamp,
+            double speed);
+
+        // Constant
+        static const DWORD MaximumSleepInMilliseconds = 100; // How long Stop waits at most for a sleeping replay.
+
+        EventReplayer(EventReplayer const&) = delete;
+        EventReplayer& operator=(EventReplayer const&) = delete;
+
+    private:
+        // Replays each record ETW reads from the saved capture.
+        struct RecordReplayer
+        {
+            EventReplayer* replayer;
+
+            bool operator()(const PEVENT_RECORD pEventRecord);
+        };
+
+        std::wstring m_FilePath;
+        double m_Speed;
+        FirewallEtwTraceCallback m_Callback;
+        std::thread m_Thread;
+        std::atomic<bool> m_Stopping;
+        std::atomic<bool> m_Finished;
+        // Set when the first event is replayed; only the replay thread touches these.
+        bool m_Started = false;
+        LONGLONG m_FirstTimeStamp = 0;
+        LONGLONG m_StartTimeStamp = 0;
+        LONGLONG m_StartCounter = 0;
+        double m_FileTimeTicksPerCounterTick = 0.0;
+        EventReplayResults m_Results;
+
+        void Run();
+
+        void ReplaySavedCapture();
+
+        void ReplayBinaryLog();
+
+        // Waits until the event is due and returns the time stamp to give it.
+        LONGLONG Pace(LONGLONG timeStamp);
+
+        // False when the callback would refuse the event; counts it as dropped.
+        bool Admit();
+
+        // FILETIME ticks since the first event was replayed.
+        LONGLONG GetElapsedTicks() const;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// c++ headers
+#include <functional>
+#include <memory>
+
+namespace FirewallEventMonitor
+{
+    struct FirewallEtwTraceCallback;
+
+    // Where a capture session's events come from: a live trace session, a saved capture or
+    // binary log being replayed, or events held in memory.
+    //
+    // A source hands each event to the FirewallEtwTraceCallback it was built around, from a
+    // thread of its own (ETW's, for a trace session), so the filters, statistics, flow table and
+    // outputs behind the callback run the same whatever the source. Raw ETW records go to the
+    // callback's operator(); a source that checks the throttle itself passes each event to
+    // AdmitEvent once, then hands it to ProcessAdmittedEvent, or ProcessEventData when it is
+    // decoded already.
+    //
+    // This interface, and the memory and synthetic sources and generator behind it, use only the
+    // standard library for their threads, clocks and formatting. They reach Win32 only through
+    // the callback, EventCounter and Timer they are handed; the trace session and replay sources
+    // are ETW by nature.
+    class EventSource
+    {
+    public:
+        virtual ~EventSource() {}
+
+        // Starts handing events to the callback.
+        virtual void Start() = 0;
+
+        // Stops handing events to the callback. No more arrive once it returns.
+        virtual void Stop() = 0;
+
+        // True once a source with an end has handed over its last event.
+        virtual bool IsFinished() const = 0;
+
+        // Prints a summary of the events handed over, if the source keeps one.
+        virtual void WriteResults() const
+        {
+        }
+    };
+
+    // Builds a capture session's source around the session's callback.
+    typedef std::function<std::unique_ptr<EventSource>(const FirewallEtwTraceCallback& callback)> EventSourceFactory;
+}
\ No newline at end of file
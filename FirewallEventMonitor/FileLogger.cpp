@@ -5,58 +5,794 @@
 #include "Timer.h"
 // ntl headers
 #include "ntlString.hpp"
+#include "ntlLocks.hpp"
+// c++ headers
+#include <algorithm>
 
 namespace FirewallEventMonitor
 {
     const LPCWSTR LOG_FILE_PREFIX =
         L"FirewallEventMonitor";
 
-    FileLogger::FileLogger(const std::wstring &directory)
-        : m_LogDirectory(directory)
+    // Name of the pre-opened file until rotation renames it: FirewallEventMonitor.next.<pid><ext>
+    const LPCWSTR NEXT_LOG_FILE_INFIX =
+        L".next.";
+
+    FileLogger::FileLogger(
+        const std::wstring &directory,
+        const std::wstring &extension,
+        bool compress,
+        const LogRotationPolicy &rotationPolicy)
+        : m_LogDirectory(directory),
+        m_LogFileExtension(extension),
+        m_RotationPolicy(rotationPolicy),
+        m_FileBytesWritten(0),
+        m_TotalBytesWritten(0),
+        m_RotationCount(0),
+        m_RetiredBuffer(LogBufferSizeInBytes),
+        m_Buffer(LogBufferSizeInBytes),
+        m_BufferUsed(0),
+        m_LastFlushTick(0),
+        m_SealedBufferUsed(0)
     {
+        if (compress)
+        {
+            m_Compressor = std::make_unique<BlockCompressor>();
+            m_CompressedBlock.reserve(sizeof(CompressedBlockHeader) + MaxCompressedBlockSizeInBytes);
+            m_SealedBuffer.resize(LogBufferSizeInBytes);
+            m_RetiredCompressor = std::make_unique<BlockCompressor>();
+            m_RetiredBlock.reserve(sizeof(CompressedBlockHeader) + MaxCompressedBlockSizeInBytes);
+            m_RetiredSealedBuffer.resize(LogBufferSizeInBytes);
+            m_LogFileExtension.append(CompressedFileExtension);
+        }
+
+        ::InitializeCriticalSectionEx(&m_CriticalSection, 4000, 0);
+        ::InitializeConditionVariable(&m_SealedBufferWritten);
     }
 
     FileLogger::~FileLogger()
     {
         CloseLogFile();
+        ::DeleteCriticalSection(&m_CriticalSection);
     }
 
     void FileLogger::CreateLogFile()
     {
-        if (m_LogFile != NULL)
         {
-            throw std::exception("Log file is in use. Cannot create a new file without closing existing file.");
-        }
-
-        GenerateLogFilePath();
-        auto filePath = GetLogFilePath();
+            ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
 
-        errno_t result = _wfopen_s(&m_LogFile, filePath.c_str(), L"w");
+            if (m_LogFile != NULL)
+            {
+                throw std::exception("Log file is in use. Cannot create a new file without closing existing file.");
+            }
 
-        if (result != 0 ||
-            m_LogFile == NULL)
-        {
-            std::string errorMessage = "Unable to open log file ";
-            errorMessage += ntl::String::convert_to_string(filePath);
-            throw std::exception(errorMessage.c_str());
+            auto filePath = GenerateLogFilePath();
+            ActivateLogFile(OpenLogFile(filePath, false), filePath);
         }
 
-        wprintf(L"\tWriting events to log file: %ls\n", filePath.c_str());
+        PruneLogFiles();
     }
 
     void FileLogger::CloseLogFile()
     {
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
         if (m_LogFile == NULL)
         {
             return;
         }
 
-        fclose(m_LogFile);
+        FlushBuffer();
+        if (m_RenamePending)
+        {
+            if (!RenameLogFile(m_LogFile, m_LogFilePath))
+            {
+                wprintf(L"Warning: Renaming %ls to %ls failed with error %lu.\n",
+                    m_NextLogFilePath.c_str(),
+                    m_LogFilePath.c_str(),
+                    ::GetLastError());
+                m_LogFilePath = m_NextLogFilePath;
+            }
+            m_RenamePending = false;
+        }
+        ::CloseHandle(m_LogFile);
         m_LogFile = NULL;
 
+        if (m_RetiredLogFile != NULL)
+        {
+            WriteRetiredBuffer(m_RetiredLogFile, m_RetiredSealedBuffer.data(), m_RetiredSealedBufferUsed);
+            WriteRetiredBuffer(m_RetiredLogFile, m_RetiredBuffer.data(), m_RetiredBufferUsed);
+            m_RetiredSealedBufferUsed = 0;
+            m_RetiredBufferUsed = 0;
+            ::CloseHandle(m_RetiredLogFile);
+            m_RetiredLogFile = NULL;
+        }
+
+        if (m_NextLogFile != NULL)
+        {
+            // Never used: remove the empty placeholder.
+            DiscardLogFile(m_NextLogFile);
+            m_NextLogFile = NULL;
+        }
+
         wprintf(L"\tClosed log file: %ls\n", GetLogFilePath().c_str());
     }
 
+    void FileLogger::Write(
+        _In_reads_bytes_(length) const char* data,
+        size_t length)
+    {
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        if (m_BufferUsed.load(std::memory_order_relaxed) + length > m_Buffer.size())
+        {
+            if (m_Compressor)
+            {
+                SealBuffer();
+            }
+            else
+            {
+                FlushBuffer();
+            }
+        }
+
+        if (length > m_Buffer.size())
+        {
+            // Too large to buffer: write it through.
+            WriteBlock(data, length);
+            return;
+        }
+
+        size_t bufferUsed = m_BufferUsed.load(std::memory_order_relaxed);
+        memcpy_s(m_Buffer.data() + bufferUsed, m_Buffer.size() - bufferUsed, data, length);
+        m_BufferUsed.store(bufferUsed + length, std::memory_order_relaxed);
+    }
+
+    std::wstring FileLogger::WriteWholeFile(
+        _In_reads_bytes_(length) const char* data,
+        size_t length)
+    {
+        std::wstring filePath;
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+            filePath = GenerateLogFilePath();
+        }
+
+        HANDLE logFile = OpenLogFile(filePath, false);
+        WriteToHandle(logFile, data, length);
+        ::CloseHandle(logFile);
+
+        PruneLogFiles();
+        return filePath;
+    }
+
+    void FileLogger::SetFileHeader(const std::string &header)
+    {
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        m_FileHeader = header;
+    }
+
+    void FileLogger::Flush()
+    {
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        FlushBuffer();
+    }
+
+    void FileLogger::FlushDeadlineCheck()
+    {
+        // Unlocked pre-check: called continuously from the main loop.
+        if (m_Compressor ||
+            m_BufferUsed.load(std::memory_order_relaxed) == 0 ||
+            ::GetTickCount64() - m_LastFlushTick.load(std::memory_order_relaxed) < LogFlushIntervalInMilliseconds)
+        {
+            return;
+        }
+
+        Flush();
+    }
+
+    bool FileLogger::RotateIfDue()
+    {
+        if (!SwitchLogFileIfDue())
+        {
+            return false;
+        }
+
+        FinishRotation();
+        return true;
+    }
+
+    bool FileLogger::SwitchLogFileIfDue()
+    {
+        // Unlocked pre-check: called continuously from the main loop.
+        if (!IsRotationDue())
+        {
+            return false;
+        }
+
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        return m_LogFile != NULL &&
+            IsRotationDue() &&
+            RotateLogFile();
+    }
+
+    void FileLogger::FinishRotation()
+    {
+        NameRotatedLogFile();
+        // Closed before pruning so the directory reports the retired file's final size.
+        FinishRetiredLogFile();
+        PruneLogFiles();
+    }
+
+    void FileLogger::MaintenanceCheck()
+    {
+        CompressSealedBuffer();
+        FlushDeadlineCheck();
+        NameRotatedLogFile();
+        FinishRetiredLogFile();
+        PrepareNextLogFile();
+    }
+
+    bool FileLogger::IsRotationDue() const
+    {
+        if (m_RotationPolicy.maxFileSizeInBytes != 0 &&
+            m_FileBytesWritten.load(std::memory_order_relaxed) + m_SealedBufferUsed.load(std::memory_order_relaxed) + m_BufferUsed.load(std::memory_order_relaxed) >= m_RotationPolicy.maxFileSizeInBytes)
+        {
+            return true;
+        }
+
+        if (m_RotationPolicy.maxFileAgeInSeconds != 0 &&
+            ::GetTickCount64() - m_FileCreatedTick >= m_RotationPolicy.maxFileAgeInSeconds * 1000ull)
+        {
+            return true;
+        }
+
+        return false;
+    }
+
+    bool FileLogger::RotateLogFile()
+    {
+        // The last rotation's files are still being finished; switch once they are.
+        if (m_RetiredLogFile != NULL ||
+            m_RenamePending ||
+            m_RetiredBuffer.size() != m_Buffer.size())
+        {
+            return false;
+        }
+
+        // The main loop may be compressing the sealed buffer, which is retired with the file.
+        while (m_CompressingSealedBuffer)
+        {
+            ::SleepConditionVariableCS(&m_SealedBufferWritten, &m_CriticalSection, INFINITE);
+        }
+
+        auto filePath = GenerateLogFilePath();
+        HANDLE nextLogFile = m_NextLogFile;
+        m_NextLogFile = NULL;
+        bool renamePending = (nextLogFile != NULL);
+
+        if (nextLogFile == NULL)
+        {
+            // MaintenanceCheck has not caught up: open the file on the writer's time.
+            try
+            {
+                nextLogFile = OpenLogFile(filePath, false);
+            }
+            catch (const std::exception &ex)
+            {
+                wprintf(L"Warning: %S. Continuing with the current log file.\n", ex.what());
+                return false;
+            }
+        }
+
+        // Everything written so far belongs to the old file, and is written to it by
+        // FinishRetiredLogFile: the writers carry on in a fresh buffer straight away.
+        m_RetiredLogFile = m_LogFile;
+        m_Buffer.swap(m_RetiredBuffer);
+        m_RetiredBufferUsed = m_BufferUsed.load(std::memory_order_relaxed);
+        if (m_Compressor)
+        {
+            m_SealedBuffer.swap(m_RetiredSealedBuffer);
+            m_RetiredSealedBufferUsed = m_SealedBufferUsed.load(std::memory_order_relaxed);
+            m_SealedBufferUsed.store(0, std::memory_order_relaxed);
+        }
+
+        ActivateLogFile(nextLogFile, filePath);
+        m_RenamePending = renamePending;
+        m_RotationCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void FileLogger::NameRotatedLogFile()
+    {
+        // Unlocked pre-check: called continuously from the main loop.
+        if (!m_RenamePending)
+        {
+            return;
+        }
+
+        HANDLE logFile = NULL;
+        std::wstring filePath;
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+            if (!m_RenamePending)
+            {
+                return;
+            }
+            logFile = m_LogFile;
+            filePath = m_LogFilePath;
+        }
+
+        // Writers keep writing through the handle while the file is renamed.
+        bool renamed = RenameLogFile(logFile, filePath);
+        DWORD error = ::GetLastError();
+
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        m_RenamePending = false;
+        if (!renamed)
+        {
+            wprintf(L"Warning: Renaming %ls to %ls failed with error %lu. Continuing under the temporary name.\n",
+                m_NextLogFilePath.c_str(),
+                filePath.c_str(),
+                error);
+
+            m_LogFilePath = m_NextLogFilePath;
+            ++m_StrandedNextLogFiles;
+            m_NextLogFilePath.clear();
+        }
+    }
+
+    bool FileLogger::RenameLogFile(
+        HANDLE logFile,
+        const std::wstring &filePath)
+    {
+        // Requires DELETE access (see OpenLogFile).
+        size_t fileNameBytes = filePath.size() * sizeof(WCHAR);
+        std::vector<BYTE> renameBuffer(sizeof(FILE_RENAME_INFO) + fileNameBytes);
+        auto renameInfo = reinterpret_cast<FILE_RENAME_INFO*>(renameBuffer.data());
+        renameInfo->ReplaceIfExists = FALSE;
+        renameInfo->RootDirectory = NULL;
+        renameInfo->FileNameLength = static_cast<DWORD>(fileNameBytes);
+        memcpy_s(renameInfo->FileName, renameBuffer.size() - offsetof(FILE_RENAME_INFO, FileName), filePath.c_str(), fileNameBytes);
+
+        return ::SetFileInformationByHandle(logFile, FileRenameInfo, renameInfo, static_cast<DWORD>(renameBuffer.size())) != FALSE;
+    }
+
+    void FileLogger::FinishRetiredLogFile()
+    {
+        // Unlocked pre-check: called continuously from the main loop.
+        if (m_RetiredLogFile == NULL)
+        {
+            return;
+        }
+
+        HANDLE retiredLogFile = NULL;
+        std::vector<char> sealedBuffer;
+        std::vector<char> buffer;
+        size_t sealedBufferUsed = 0;
+        size_t bufferUsed = 0;
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+            retiredLogFile = m_RetiredLogFile;
+            m_RetiredLogFile = NULL;
+            if (retiredLogFile == NULL)
+            {
+                return;
+            }
+
+            sealedBuffer.swap(m_RetiredSealedBuffer);
+            buffer.swap(m_RetiredBuffer);
+            sealedBufferUsed = m_RetiredSealedBufferUsed;
+            bufferUsed = m_RetiredBufferUsed;
+            m_RetiredSealedBufferUsed = 0;
+            m_RetiredBufferUsed = 0;
+        }
+
+        WriteRetiredBuffer(retiredLogFile, sealedBuffer.data(), sealedBufferUsed);
+        WriteRetiredBuffer(retiredLogFile, buffer.data(), bufferUsed);
+        ::CloseHandle(retiredLogFile);
+
+        // Handed back for the next rotation to swap in.
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        m_RetiredSealedBuffer.swap(sealedBuffer);
+        m_RetiredBuffer.swap(buffer);
+    }
+
+    void FileLogger::WriteRetiredBuffer(
+        HANDLE logFile,
+        _In_reads_bytes_(length) const char* data,
+        size_t length)
+    {
+        if (length == 0)
+        {
+            return;
+        }
+
+        if (!m_RetiredCompressor)
+        {
+            WriteToHandle(logFile, data, length);
+            return;
+        }
+
+        // A buffer is at most one block.
+        try
+        {
+            m_RetiredCompressor->CompressBlock(data, length, m_RetiredBlock);
+        }
+        catch (const std::exception &ex)
+        {
+            wprintf(L"Warning: %S. %Iu bytes dropped.\n", ex.what(), length);
+            return;
+        }
+        WriteToHandle(logFile, m_RetiredBlock.data(), m_RetiredBlock.size());
+    }
+
+    void FileLogger::PrepareNextLogFile()
+    {
+        // Unlocked pre-check: called continuously from the main loop.
+        if (m_LogFile == NULL ||
+            m_NextLogFile != NULL ||
+            m_RenamePending ||
+            (m_RotationPolicy.maxFileSizeInBytes == 0 && m_RotationPolicy.maxFileAgeInSeconds == 0))
+        {
+            return;
+        }
+
+        if (m_NextLogFilePath.empty())
+        {
+            m_NextLogFilePath = GetLogDirectory();
+            m_NextLogFilePath.push_back(L'\\');
+            m_NextLogFilePath.append(LOG_FILE_PREFIX);
+            m_NextLogFilePath.append(NEXT_LOG_FILE_INFIX);
+            m_NextLogFilePath.append(std::to_wstring(::GetCurrentProcessId()));
+            if (m_StrandedNextLogFiles != 0)
+            {
+                m_NextLogFilePath.push_back(L'.');
+                m_NextLogFilePath.append(std::to_wstring(m_StrandedNextLogFiles));
+            }
+            m_NextLogFilePath.append(m_LogFileExtension);
+        }
+
+        // Created outside the lock so writers never wait on the file system.
+        HANDLE nextLogFile = NULL;
+        try
+        {
+            nextLogFile = OpenLogFile(m_NextLogFilePath, true);
+        }
+        catch (const std::exception &ex)
+        {
+            wprintf(L"Warning: %S. Rotation will open the next file itself.\n", ex.what());
+            return;
+        }
+
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        if (m_LogFile == NULL ||
+            m_NextLogFile != NULL ||
+            m_RenamePending)
+        {
+            DiscardLogFile(nextLogFile);
+            return;
+        }
+
+        m_NextLogFile = nextLogFile;
+    }
+
+    void FileLogger::PruneLogFiles()
+    {
+        if (m_RotationPolicy.maxTotalSizeInBytes == 0)
+        {
+            return;
+        }
+
+        std::wstring currentFilePath;
+        unsigned long long totalBytes = 0;
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+            // The directory entry of an open file lags behind; count what has been written.
+            currentFilePath = m_LogFilePath;
+            totalBytes = m_FileBytesWritten.load(std::memory_order_relaxed);
+        }
+
+        struct OldLogFile
+        {
+            std::wstring filePath;
+            unsigned long long sizeInBytes;
+            ULONGLONG lastWriteTime;
+        };
+        std::vector<OldLogFile> oldLogFiles;
+
+        std::wstring directory(GetLogDirectory());
+        directory.push_back(L'\\');
+        std::wstring pattern(directory);
+        pattern.append(LOG_FILE_PREFIX);
+        pattern.append(L".*");
+        pattern.append(m_LogFileExtension);
+
+        WIN32_FIND_DATAW findData;
+        HANDLE find = ::FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, NULL, 0);
+        if (find == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+
+        do
+        {
+            std::wstring fileName(findData.cFileName);
+            std::wstring filePath(directory + fileName);
+
+            // Wildcards also match 8.3 names and other writers' files, so check the whole name.
+            if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0 ||
+                !IsLogFileName(fileName) ||
+                ntl::String::iordinal_equals(filePath, currentFilePath) ||
+                ntl::String::iordinal_equals(filePath, m_NextLogFilePath))
+            {
+                continue;
+            }
+
+            OldLogFile oldLogFile;
+            oldLogFile.filePath = filePath;
+            oldLogFile.sizeInBytes = (static_cast<unsigned long long>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+            oldLogFile.lastWriteTime = (static_cast<ULONGLONG>(findData.ftLastWriteTime.dwHighDateTime) << 32) | findData.ftLastWriteTime.dwLowDateTime;
+            totalBytes += oldLogFile.sizeInBytes;
+            oldLogFiles.push_back(oldLogFile);
+        } while (::FindNextFileW(find, &findData));
+
+        ::FindClose(find);
+
+        std::sort(oldLogFiles.begin(), oldLogFiles.end(), [](const OldLogFile& lhs, const OldLogFile& rhs)
+        {
+            return lhs.lastWriteTime < rhs.lastWriteTime;
+        });
+
+        for (const auto& oldLogFile : oldLogFiles)
+        {
+            if (totalBytes <= m_RotationPolicy.maxTotalSizeInBytes)
+            {
+                break;
+            }
+
+            if (!::DeleteFileW(oldLogFile.filePath.c_str()))
+            {
+                wprintf(L"Warning: Deleting log file %ls failed with error %lu.\n",
+                    oldLogFile.filePath.c_str(),
+                    ::GetLastError());
+                continue;
+            }
+
+            totalBytes -= oldLogFile.sizeInBytes;
+            wprintf(L"\tDeleted log file over retention limit: %ls\n", oldLogFile.filePath.c_str());
+        }
+    }
+
+    bool FileLogger::IsLogFileName(const std::wstring &fileName) const
+    {
+        std::wstring timestamp;
+        unsigned long sequence = 0;
+        return ParseLogFileName(fileName, m_LogFileExtension, &timestamp, &sequence);
+    }
+
+    bool FileLogger::ParseLogFileName(
+        const std::wstring &fileName,
+        const std::wstring &extension,
+        _Out_ std::wstring* timestamp,
+        _Out_ unsigned long* sequence)
+    {
+        timestamp->clear();
+        *sequence = 0;
+
+        // FirewallEventMonitor.<yyyyMMdd>T<HHmmss>[.<sequence>]<extension>
+        std::wstring prefix(LOG_FILE_PREFIX);
+        prefix.push_back(L'.');
+        const size_t timestampLength = 15;
+        if (fileName.size() < prefix.size() + timestampLength + extension.size() ||
+            !ntl::String::istarts_with(fileName, prefix) ||
+            !ntl::String::iends_with(fileName, extension))
+        {
+            return false;
+        }
+
+        const wchar_t* name = fileName.c_str() + prefix.size();
+        const wchar_t* nameEnd = fileName.c_str() + fileName.size() - extension.size();
+        for (size_t i = 0; i < timestampLength; ++i)
+        {
+            bool expected = (i == 8) ? name[i] == L'T' : iswdigit(name[i]) != 0;
+            if (!expected)
+            {
+                return false;
+            }
+        }
+        const wchar_t* timestampStart = name;
+        name += timestampLength;
+
+        // The sequence number of a file started in the same second as the one before.
+        unsigned long fileSequence = 0;
+        if (name != nameEnd)
+        {
+            if (*name != L'.' || ++name == nameEnd)
+            {
+                return false;
+            }
+            for (; name != nameEnd; ++name)
+            {
+                if (!iswdigit(*name) ||
+                    fileSequence > (ULONG_MAX - 9) / 10)
+                {
+                    return false;
+                }
+                fileSequence = (fileSequence * 10) + static_cast<unsigned long>(*name - L'0');
+            }
+        }
+
+        timestamp->assign(timestampStart, timestampLength);
+        *sequence = fileSequence;
+        return true;
+    }
+
+    void FileLogger::FlushBuffer()
+    {
+        m_LastFlushTick.store(::GetTickCount64(), std::memory_order_relaxed);
+
+        // The sealed buffer was written to before the pending one.
+        WriteSealedBuffer();
+
+        size_t bufferUsed = m_BufferUsed.load(std::memory_order_relaxed);
+        if (bufferUsed == 0)
+        {
+            return;
+        }
+
+        WriteBlock(m_Buffer.data(), bufferUsed);
+        m_BufferUsed.store(0, std::memory_order_relaxed);
+    }
+
+    void FileLogger::SealBuffer()
+    {
+        m_LastFlushTick.store(::GetTickCount64(), std::memory_order_relaxed);
+
+        // Only when the main loop falls a whole buffer behind is a block compressed here.
+        WriteSealedBuffer();
+
+        size_t bufferUsed = m_BufferUsed.load(std::memory_order_relaxed);
+        if (bufferUsed == 0)
+        {
+            return;
+        }
+
+        m_Buffer.swap(m_SealedBuffer);
+        m_SealedBufferUsed.store(bufferUsed, std::memory_order_relaxed);
+        m_BufferUsed.store(0, std::memory_order_relaxed);
+    }
+
+    void FileLogger::WriteSealedBuffer()
+    {
+        while (m_CompressingSealedBuffer)
+        {
+            ::SleepConditionVariableCS(&m_SealedBufferWritten, &m_CriticalSection, INFINITE);
+        }
+
+        size_t sealedBufferUsed = m_SealedBufferUsed.load(std::memory_order_relaxed);
+        if (sealedBufferUsed == 0)
+        {
+            return;
+        }
+
+        WriteBlock(m_SealedBuffer.data(), sealedBufferUsed);
+        m_SealedBufferUsed.store(0, std::memory_order_relaxed);
+    }
+
+    void FileLogger::CompressSealedBuffer()
+    {
+        // Unlocked pre-check: called continuously from the main loop.
+        if (m_SealedBufferUsed.load(std::memory_order_relaxed) == 0)
+        {
+            return;
+        }
+
+        size_t sealedBufferUsed = 0;
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+            sealedBufferUsed = m_SealedBufferUsed.load(std::memory_order_relaxed);
+            if (sealedBufferUsed == 0 ||
+                m_CompressingSealedBuffer)
+            {
+                return;
+            }
+            m_CompressingSealedBuffer = true;
+        }
+
+        // Writers keep filling m_Buffer meanwhile; one that fills it too waits for this block.
+        try
+        {
+            m_Compressor->CompressBlock(m_SealedBuffer.data(), sealedBufferUsed, m_CompressedBlock);
+        }
+        catch (const std::exception &ex)
+        {
+            wprintf(L"Warning: %S. %Iu bytes dropped.\n", ex.what(), sealedBufferUsed);
+            m_CompressedBlock.clear();
+        }
+
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        WriteToFile(m_CompressedBlock.data(), m_CompressedBlock.size());
+        m_SealedBufferUsed.store(0, std::memory_order_relaxed);
+        m_CompressingSealedBuffer = false;
+        ::WakeAllConditionVariable(&m_SealedBufferWritten);
+    }
+
+    void FileLogger::WriteBlock(
+        _In_reads_bytes_(length) const char* data,
+        size_t length)
+    {
+        if (!m_Compressor)
+        {
+            WriteToFile(data, length);
+            return;
+        }
+
+        // Compressed under the lock, one block per buffer: only buffers flushed before they
+        // filled, and full ones the main loop fell behind on (see CompressSealedBuffer).
+        while (length > 0)
+        {
+            size_t blockLength = (length > MaxCompressedBlockSizeInBytes) ? MaxCompressedBlockSizeInBytes : length;
+            m_Compressor->CompressBlock(data, blockLength, m_CompressedBlock);
+            WriteToFile(m_CompressedBlock.data(), m_CompressedBlock.size());
+
+            data += blockLength;
+            length -= blockLength;
+        }
+    }
+
+    void FileLogger::WriteToFile(
+        _In_reads_bytes_(length) const char* data,
+        size_t length)
+    {
+        if (m_LogFile == NULL)
+        {
+            wprintf(L"Warning: Unable to log to null file.\n");
+            return;
+        }
+
+        size_t bytesWritten = WriteToHandle(m_LogFile, data, length);
+        m_FileBytesWritten.fetch_add(bytesWritten, std::memory_order_relaxed);
+    }
+
+    size_t FileLogger::WriteToHandle(
+        HANDLE logFile,
+        _In_reads_bytes_(length) const char* data,
+        size_t length)
+    {
+        size_t totalBytesWritten = 0;
+        while (length > 0)
+        {
+            DWORD bytesToWrite = (length > MAXDWORD) ? MAXDWORD : static_cast<DWORD>(length);
+            DWORD bytesWritten = 0;
+            if (!::WriteFile(logFile, data, bytesToWrite, &bytesWritten, NULL))
+            {
+                wprintf(L"Warning: Writing to log file failed with error %lu. %Iu bytes dropped.\n",
+                    ::GetLastError(),
+                    length);
+                break;
+            }
+
+            data += bytesWritten;
+            length -= bytesWritten;
+            totalBytesWritten += bytesWritten;
+            m_TotalBytesWritten.fetch_add(bytesWritten, std::memory_order_relaxed);
+        }
+        return totalBytesWritten;
+    }
+
     const std::wstring& FileLogger::GetLogDirectory()
     {
         if (m_LogDirectory.empty())
@@ -77,7 +813,7 @@ namespace FirewallEventMonitor
         return m_LogDirectory;
     }
 
-    void FileLogger::GenerateLogFilePath()
+    std::wstring FileLogger::GenerateLogFilePath()
     {
         // Get directory
         std::wstring filePath(GetLogDirectory());
@@ -91,15 +827,81 @@ namespace FirewallEventMonitor
         SYSTEMTIME systemTime;
         GetSystemTime(&systemTime);
         Timer::GetDateAndTime(systemTime, &date, &time);
+        std::wstring timestamp(date);
+        timestamp.push_back(L'T'); // ISO 8601
+        timestamp.append(time);
         filePath.push_back(L'.');
-        filePath.append(date);
-        filePath.push_back(L'T'); // ISO 8601
-        filePath.append(time);
+        filePath.append(timestamp);
+
+        // Add sequence number if a file was already started this second
+        if (timestamp == m_LastLogFileTimestamp)
+        {
+            ++m_LogFileSequence;
+            filePath.push_back(L'.');
+            filePath.append(std::to_wstring(m_LogFileSequence));
+        }
+        else
+        {
+            m_LastLogFileTimestamp = timestamp;
+            m_LogFileSequence = 0;
+        }
 
         // Add file extension
-        filePath.append(L".log");
+        filePath.append(m_LogFileExtension);
 
+        return filePath;
+    }
+
+    HANDLE FileLogger::OpenLogFile(
+        const std::wstring &filePath,
+        bool allowRename)
+    {
+        HANDLE logFile = ::CreateFileW(
+            filePath.c_str(),
+            allowRename ? (GENERIC_WRITE | DELETE) : GENERIC_WRITE,
+            allowRename ? (FILE_SHARE_READ | FILE_SHARE_DELETE) : FILE_SHARE_READ,
+            NULL,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            NULL);
+
+        if (logFile == INVALID_HANDLE_VALUE)
+        {
+            std::string errorMessage = "Unable to open log file ";
+            errorMessage += ntl::String::convert_to_string(filePath);
+            throw std::exception(errorMessage.c_str());
+        }
+
+        return logFile;
+    }
+
+    void FileLogger::DiscardLogFile(
+        HANDLE logFile)
+    {
+        // Requires DELETE access (see OpenLogFile).
+        FILE_DISPOSITION_INFO disposition = { TRUE };
+        ::SetFileInformationByHandle(logFile, FileDispositionInfo, &disposition, sizeof(disposition));
+        ::CloseHandle(logFile);
+    }
+
+    void FileLogger::ActivateLogFile(
+        HANDLE logFile,
+        const std::wstring &filePath)
+    {
+        m_LogFile = logFile;
         m_LogFilePath = filePath;
+        m_BufferUsed.store(0, std::memory_order_relaxed);
+        m_FileBytesWritten.store(0, std::memory_order_relaxed);
+        m_FileCreatedTick = ::GetTickCount64();
+        m_LastFlushTick.store(m_FileCreatedTick, std::memory_order_relaxed);
+
+        if (!m_FileHeader.empty())
+        {
+            memcpy_s(m_Buffer.data(), m_Buffer.size(), m_FileHeader.data(), m_FileHeader.size());
+            m_BufferUsed.store(m_FileHeader.size(), std::memory_order_relaxed);
+        }
+
+        wprintf(L"\tWriting events to log file: %ls\n", filePath.c_str());
     }
 
     const std::wstring& FileLogger::GetLogFilePath() const
@@ -107,7 +909,17 @@ namespace FirewallEventMonitor
         return m_LogFilePath;
     }
 
-    FILE* FileLogger::GetLogFile() const
+    unsigned long long FileLogger::GetTotalBytesWritten() const
+    {
+        return m_TotalBytesWritten.load(std::memory_order_relaxed);
+    }
+
+    unsigned long long FileLogger::GetRotationCount() const
+    {
+        return m_RotationCount.load(std::memory_order_relaxed);
+    }
+
+    HANDLE FileLogger::GetLogFile() const
     {
         return m_LogFile;
     }
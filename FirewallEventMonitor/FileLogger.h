@@ -6,15 +6,37 @@
 // os headers
 #include <winsock2.h>
 // c++ headers
+#include <atomic>
+#include <memory>
 #include <utility>
 #include <string>
+#include <vector>
+
+#include "LogCompression.h"
 
 namespace FirewallEventMonitor
 {
+    // When a FileLogger starts a new file and how many old files it keeps. Zero disables a limit.
+    struct LogRotationPolicy
+    {
+    public:
+        unsigned long long maxFileSizeInBytes = 0;
+        unsigned long maxFileAgeInSeconds = DefaultMaxFileAgeInSeconds;
+        // Total size of this logger's files in the log directory, the current file included.
+        unsigned long long maxTotalSizeInBytes = 0;
+
+        // Constant
+        static const unsigned long DefaultMaxFileAgeInSeconds = 3600ul; // 1 hour.
+    };
+
     class FileLogger
     {
     public:
-        FileLogger(const std::wstring &directory);
+        FileLogger(
+            const std::wstring &directory,
+            const std::wstring &extension = L".log",
+            bool compress = false,
+            const LogRotationPolicy &rotationPolicy = LogRotationPolicy{});
 
         ~FileLogger();
 
@@ -22,24 +44,205 @@ namespace FirewallEventMonitor
 
         void CloseLogFile();
 
-        FILE* GetLogFile() const;
+        HANDLE GetLogFile() const;
+
+        // Copies data into the write buffer; the file is written once per full buffer.
+        // When compressing, each write to the file is one independently decompressible block,
+        // and a full buffer is handed to MaintenanceCheck to compress rather than compressed here.
+        void Write(
+            _In_reads_bytes_(length) const char* data,
+            size_t length);
+
+        // Writes data as a file of its own, named and pruned like the logger's other files,
+        // without printing its name or touching the current file. Returns the file's path.
+        std::wstring WriteWholeFile(
+            _In_reads_bytes_(length) const char* data,
+            size_t length);
+
+        // Sets bytes written at the start of every file, such as a column header.
+        void SetFileHeader(const std::string &header);
+
+        // Writes all buffered data to the log file.
+        void Flush();
+
+        // Flushes buffered data that has waited longer than LogFlushIntervalInMilliseconds.
+        // Compressed logs wait for a full block instead, so their blocks compress well.
+        void FlushDeadlineCheck();
+
+        // Switches to a new file once the current one exceeds the rotation policy, then
+        // deletes the oldest files over the retention limit. Returns true if a new file began.
+        // Writes before and after the switch land whole in the old and new file respectively.
+        bool RotateIfDue();
+
+        // The two halves of RotateIfDue, for callers that hold a lock of their own across the
+        // switch. SwitchLogFileIfDue only swaps in the pre-opened file and a fresh buffer under
+        // the lock; FinishRotation then names the new file, writes out and closes the old one
+        // and prunes, all outside it, so writers never wait on the file system. Main loop only.
+        bool SwitchLogFileIfDue();
+
+        void FinishRotation();
+
+        // Main loop housekeeping that keeps the file system and the compressor off the
+        // writers' path: compresses and writes the last full buffer, flushes on the deadline,
+        // finishes the file retired by the last rotation and pre-opens the file the next
+        // rotation will switch to.
+        void MaintenanceCheck();
 
         // Returns user-supplied directory or (if blank) the current directory.
         const std::wstring& GetLogDirectory();
 
         const std::wstring& GetLogFilePath() const;
 
+        // Bytes written to all of this logger's files, and the number of rotations. Read
+        // without the lock, so they can be polled while events are written.
+        unsigned long long GetTotalBytesWritten() const;
+
+        unsigned long long GetRotationCount() const;
+
+        // Parses a file name GenerateLogFilePath produces with the given extension. Files
+        // started in the same second share timestamp; the first has sequence 0.
+        static bool ParseLogFileName(
+            const std::wstring &fileName,
+            const std::wstring &extension,
+            _Out_ std::wstring* timestamp,
+            _Out_ unsigned long* sequence);
+
         // Constant
-        static const DWORD LogFileLimitInSeconds = 3600; // 1 hour.
+        static const size_t LogBufferSizeInBytes = 1024 * 1024; // 1 MB.
+        static const ULONGLONG LogFlushIntervalInMilliseconds = 1000; // 1 second.
 
         FileLogger(FileLogger const&) = delete;
         FileLogger& operator=(FileLogger const&) = delete;
     private:
-        FILE *m_LogFile = NULL;
+        CRITICAL_SECTION m_CriticalSection;
+        HANDLE m_LogFile = NULL;
         std::wstring m_LogDirectory;
         std::wstring m_LogFilePath;
+        std::wstring m_LogFileExtension;
+        std::string m_FileHeader;
+        LogRotationPolicy m_RotationPolicy;
+        // Bytes written to the current file and when it was opened. The byte count is
+        // written by the writers under m_CriticalSection and read by the rotation pre-check.
+        std::atomic<unsigned long long> m_FileBytesWritten;
+        ULONGLONG m_FileCreatedTick = 0;
+        // Changed under m_CriticalSection, except by WriteWholeFile.
+        std::atomic<unsigned long long> m_TotalBytesWritten;
+        std::atomic<unsigned long long> m_RotationCount;
+        // Pre-opened under a temporary name and renamed once rotation has switched to it;
+        // m_RenamePending is set in between. Each failed rename strands its temporary name,
+        // so the next file takes another.
+        HANDLE m_NextLogFile = NULL;
+        std::wstring m_NextLogFilePath;
+        bool m_RenamePending = false;
+        unsigned long m_StrandedNextLogFiles = 0;
+        // Swapped out by rotation with the bytes not yet written to it, the sealed buffer's
+        // before the pending buffer's, and finished by FinishRotation or MaintenanceCheck
+        // rather than by the writer. The buffers are out of the lock while being written.
+        HANDLE m_RetiredLogFile = NULL;
+        std::vector<char> m_RetiredSealedBuffer;
+        size_t m_RetiredSealedBufferUsed = 0;
+        std::vector<char> m_RetiredBuffer;
+        size_t m_RetiredBufferUsed = 0;
+        // Compresses the retired buffers, so finishing a file never waits on m_Compressor.
+        std::unique_ptr<BlockCompressor> m_RetiredCompressor;
+        std::vector<char> m_RetiredBlock;
+        // Disambiguates file names when rotating more than once per second.
+        std::wstring m_LastLogFileTimestamp;
+        unsigned long m_LogFileSequence = 0;
+        // Preallocated write buffer; m_BufferUsed bytes are pending. Both counters are only
+        // changed under m_CriticalSection, and atomic so the main loop's pre-checks can read them.
+        std::vector<char> m_Buffer;
+        std::atomic<size_t> m_BufferUsed;
+        std::atomic<ULONGLONG> m_LastFlushTick;
+        // Set when compressing; blocks are built in m_CompressedBlock.
+        std::unique_ptr<BlockCompressor> m_Compressor;
+        std::vector<char> m_CompressedBlock;
+        // Compressed logs only: the last full buffer, waiting for MaintenanceCheck to compress
+        // it. m_SealedBufferUsed is 0 when there is none. While m_CompressingSealedBuffer is
+        // set the main loop owns the compressor and the sealed buffer outside the lock, and a
+        // writer that needs either waits on m_SealedBufferWritten.
+        std::vector<char> m_SealedBuffer;
+        std::atomic<size_t> m_SealedBufferUsed;
+        bool m_CompressingSealedBuffer = false;
+        CONDITION_VARIABLE m_SealedBufferWritten;
 
         // Appends directory with time-stamped file name.
-        void GenerateLogFilePath();
+        std::wstring GenerateLogFilePath();
+
+        // Opens path for writing. DELETE access allows the file to be renamed or discarded later.
+        HANDLE OpenLogFile(
+            const std::wstring &filePath,
+            bool allowRename);
+
+        // Deletes and closes a file opened with allowRename.
+        static void DiscardLogFile(
+            HANDLE logFile);
+
+        // Renames a file opened with allowRename. False, with the error in GetLastError, if it fails.
+        static bool RenameLogFile(
+            HANDLE logFile,
+            const std::wstring &filePath);
+
+        // Makes logFile the current file. Caller must hold m_CriticalSection.
+        void ActivateLogFile(
+            HANDLE logFile,
+            const std::wstring &filePath);
+
+        // Whether the current file exceeds the rotation policy. Safe to call unlocked as a pre-check.
+        bool IsRotationDue() const;
+
+        // Switches to the pre-opened file (or opens one if none is ready), retiring the current
+        // file with its buffers unwritten. Caller must hold m_CriticalSection.
+        bool RotateLogFile();
+
+        // Gives the file rotation switched to its time-stamped name.
+        void NameRotatedLogFile();
+
+        // Writes the retired file's remaining bytes outside the lock, then closes it.
+        void FinishRetiredLogFile();
+
+        // Writes a retired buffer to logFile, compressed if enabled, with m_RetiredCompressor.
+        void WriteRetiredBuffer(
+            HANDLE logFile,
+            _In_reads_bytes_(length) const char* data,
+            size_t length);
+
+        void PrepareNextLogFile();
+
+        // Deletes this logger's oldest files until the total is within maxTotalSizeInBytes.
+        void PruneLogFiles();
+
+        // Whether fileName is one GenerateLogFilePath produces with this logger's extension, so
+        // pruning leaves alone other files that share the prefix or the extension.
+        bool IsLogFileName(const std::wstring &fileName) const;
+
+        // Writes the sealed and the pending buffer to the file. Caller must hold m_CriticalSection.
+        void FlushBuffer();
+
+        // Hands the pending buffer to MaintenanceCheck as the sealed buffer, first writing the
+        // one before if the main loop has not got to it. Caller must hold m_CriticalSection.
+        void SealBuffer();
+
+        // Waits for the main loop to finish with the sealed buffer, then writes it if it is
+        // still pending. Caller must hold m_CriticalSection.
+        void WriteSealedBuffer();
+
+        // Compresses the sealed buffer outside the lock, then writes it.
+        void CompressSealedBuffer();
+
+        // Compresses data if enabled, then writes it to the file.
+        void WriteBlock(
+            _In_reads_bytes_(length) const char* data,
+            size_t length);
+
+        void WriteToFile(
+            _In_reads_bytes_(length) const char* data,
+            size_t length);
+
+        // Returns the bytes written to logFile, warning about the rest.
+        size_t WriteToHandle(
+            HANDLE logFile,
+            _In_reads_bytes_(length) const char* data,
+            size_t length);
     };
 }
\ No newline at end of file
@@ -2,17 +2,51 @@
 // Licensed under the MIT License. See License.txt in the project root for license information.
 
 #include "FirewallCaptureSession.h"
+#include "ConsoleOutput.h"
+#include "EventFormatter.h"
+#include "EventReplayer.h"
+#include "RealTimeEventSource.h"
+#include "SyntheticEventSource.h"
+
+// os headers
+#include <psapi.h>
+// ntl headers
+#include "ntlString.hpp"
+#include "ntlTrace.hpp"
 
 namespace FirewallEventMonitor
 {
-    const GUID VFP_PROVIDER_GUID = {
-        0x9F2660EA,
-        0xCFE7,
-        0x428F,
-        { 0x98, 0x50, 0xAE, 0xCA, 0x61, 0x26, 0x19, 0xB0 } };
+    const LPCWSTR RATE_HISTORY_FILE_NAME =
+        L"\\FirewallEventMonitor.rates.csv";
+
+    // The .prom extension is what the node_exporter textfile collector picks up.
+    const LPCWSTR METRICS_FILE_NAME =
+        L"\\FirewallEventMonitor.prom";
+
+    const LPCWSTR TRACE_FILE_NAME =
+        L"\\FirewallEventMonitor.trace.json";
 
-    const LPCWSTR TRACE_SESSION_NAME_PREFIX =
-        L"FirewallEventCaptureSession";
+    // The current time as a FILETIME, the unit of event timestamps.
+    LONGLONG GetSystemTimeAsLongLong()
+    {
+        FILETIME fileTime;
+        ::GetSystemTimeAsFileTime(&fileTime);
+        ULARGE_INTEGER now;
+        now.LowPart = fileTime.dwLowDateTime;
+        now.HighPart = fileTime.dwHighDateTime;
+        return static_cast<LONGLONG>(now.QuadPart);
+    }
+
+    LogRotationPolicy GetLogRotationPolicy(const Parameters &params)
+    {
+        const unsigned long long bytesPerMB = 1024ull * 1024ull;
+
+        LogRotationPolicy policy;
+        policy.maxFileSizeInBytes = params.logFileSizeInMB * bytesPerMB;
+        policy.maxFileAgeInSeconds = params.logFileIntervalInSeconds;
+        policy.maxTotalSizeInBytes = params.logRetentionInMB * bytesPerMB;
+        return policy;
+    }
 
     FirewallCaptureSession::FirewallCaptureSession()
         : FirewallCaptureSession(Parameters{})
@@ -22,7 +56,10 @@ namespace FirewallEventMonitor
     FirewallCaptureSession::FirewallCaptureSession(const Parameters &params)
         : FirewallCaptureSession(
             params,
-            std::make_shared<FileLogger>(params.logDirectory),
+            std::make_shared<FileLogger>(params.logDirectory, L".log", params.compressLogFiles, GetLogRotationPolicy(params)),
+            std::make_shared<BinaryLogger>(params.logDirectory, params.compressLogFiles, GetLogRotationPolicy(params)),
+            std::make_shared<FileLogger>(params.logDirectory, L".jsonl", params.compressLogFiles, GetLogRotationPolicy(params)),
+            std::make_shared<FileLogger>(params.logDirectory, L".csv", params.compressLogFiles, GetLogRotationPolicy(params)),
             std::make_shared<Timer>(params.maxRuntimeInSeconds, params.noTimeout),
             std::make_shared<EventCounter>(params.maxEventsPerEpoc))
     {
@@ -31,71 +68,171 @@ namespace FirewallEventMonitor
     FirewallCaptureSession::FirewallCaptureSession(
         const Parameters &params,
         std::shared_ptr<FileLogger> fileLogger,
+        std::shared_ptr<BinaryLogger> binaryLogger,
+        std::shared_ptr<FileLogger> jsonLogger,
+        std::shared_ptr<FileLogger> csvLogger,
         std::shared_ptr<Timer> timer,
-        std::shared_ptr<EventCounter> eventCounter)
+        std::shared_ptr<EventCounter> eventCounter,
+        EventSourceFactory eventSourceFactory)
         : m_CaptureSessionRunning(false),
         m_FileLogger(fileLogger),
+        m_BinaryLogger(binaryLogger),
+        m_JsonLogger(jsonLogger),
+        m_CsvLogger(csvLogger),
         m_Parameters(params),
         m_Timer(timer),
-        m_EventCounter(eventCounter)
+        m_EventCounter(eventCounter),
+        m_EventSourceFactory(eventSourceFactory)
     {
-        m_ProviderGuids.push_back(VFP_PROVIDER_GUID);
+        if (m_Parameters.aggregateFlows)
+        {
+            m_FlowTable = std::make_shared<FlowTable>(
+                m_Parameters.flowIdleTimeoutInSeconds,
+                m_Parameters.flowActiveTimeoutInSeconds);
+        }
 
-        GenerateTraceSessionName();
-    }
+        if (m_Parameters.ruleStatsIntervalInSeconds > 0)
+        {
+            m_RuleHitCounter = std::make_shared<RuleHitCounter>();
+        }
 
-    FirewallCaptureSession::~FirewallCaptureSession()
-    {
-        CloseSession();
-    }
+        if (m_Parameters.topTalkersIntervalInSeconds > 0)
+        {
+            m_TopTalkers = std::make_shared<TopTalkers>();
+        }
 
-    void FirewallCaptureSession::GenerateTraceSessionName()
-    {
-        m_TraceSessionName = TRACE_SESSION_NAME_PREFIX;
+        if (m_Parameters.distinctCountsIntervalInSeconds > 0)
+        {
+            m_DistinctCounter = std::make_shared<DistinctCounter>();
+        }
 
-        // Randomly generate a UUID for the TraceSession name and guid.
-        // This prevents collisions, allowing multiple instances of FirewallEventMontior to run simultaneously.
-        UUID uuid;
-        RPC_STATUS uuidcreate_status = UuidCreate(&uuid);
-        if (uuidcreate_status == RPC_S_OK)
+        if (m_Parameters.rateHistory)
         {
-            m_TraceSessionGuid = uuid;
+            m_RateHistory = std::make_shared<RateHistory>();
+        }
 
-            // convert UUID to wstring
-            WCHAR* wszUuid = NULL;
-            RPC_STATUS uuidtostring_status = UuidToStringW(&uuid, (RPC_WSTR*)&wszUuid);
-            // Make sure to free wszUuid
-            std::unique_ptr<WCHAR, ntl::WCharDeleter> free_string(wszUuid);
+        // A replay always reports its latency at the end, and the metrics export the histograms.
+        if (m_Parameters.latencyIntervalInSeconds > 0 ||
+            !m_Parameters.replayFilePath.empty() ||
+            m_Parameters.metricsIntervalInSeconds > 0)
+        {
+            m_LatencyMonitor = std::make_shared<LatencyMonitor>();
+        }
 
-            if (uuidtostring_status == RPC_S_OK &&
-                wszUuid != NULL)
-            {
-                m_TraceSessionName += L".";
-                m_TraceSessionName += wszUuid;
-            }
-            else
-            {
-                throw std::exception("Unable to convert UUID to wstring.");
-            }
+        if (m_Parameters.metricsIntervalInSeconds > 0)
+        {
+            m_SelfMetrics = std::make_shared<SelfMetrics>();
+        }
+
+        if (m_Parameters.burstThresholdDeviations > 0.0)
+        {
+            m_BurstDetector = std::make_shared<BurstDetector>(
+                m_Parameters.burstThresholdDeviations,
+                m_Parameters.burstCaptureInSeconds);
+            m_AlertLogger = std::make_shared<FileLogger>(
+                m_Parameters.logDirectory,
+                L".alerts.log",
+                m_Parameters.compressLogFiles,
+                GetLogRotationPolicy(m_Parameters));
+        }
+
+        if (m_Parameters.outputToSegmentFiles)
+        {
+            m_SegmentWriter = std::make_shared<SegmentWriter>(
+                m_Parameters.logDirectory,
+                GetLogRotationPolicy(m_Parameters));
         }
-        else
+
+        if (m_Parameters.ruleStatsToFile)
         {
-            throw std::exception("Unable to create UUID.");
+            m_RuleStatsLogger = std::make_shared<FileLogger>(
+                m_Parameters.logDirectory,
+                L".rules.csv",
+                m_Parameters.compressLogFiles,
+                GetLogRotationPolicy(m_Parameters));
+
+            std::string ruleStatsHeader;
+            RuleHitCounter::FormatCsvHeader(ruleStatsHeader);
+            m_RuleStatsLogger->SetFileHeader(ruleStatsHeader);
         }
+
+        // Every .csv file starts with the column names.
+        std::string csvHeader;
+        EventFormatter::FormatCsvHeader(csvHeader, m_Parameters.aggregateFlows);
+        m_CsvLogger->SetFileHeader(csvHeader);
+    }
+
+    FirewallCaptureSession::~FirewallCaptureSession()
+    {
+        CloseSession();
     }
 
     void FirewallCaptureSession::OpenSession()
     {
-        m_EtwReader = std::make_unique<ntl::EtwReader<FirewallEtwTraceCallback>>(
-            FirewallEtwTraceCallback(
+        CallbackDependencies dependencies;
+        dependencies.fileLogger = m_FileLogger;
+        dependencies.binaryLogger = m_BinaryLogger;
+        dependencies.jsonLogger = m_JsonLogger;
+        dependencies.csvLogger = m_CsvLogger;
+        dependencies.timer = m_Timer;
+        dependencies.eventCounter = m_EventCounter;
+        dependencies.flowTable = m_FlowTable;
+        dependencies.ruleHitCounter = m_RuleHitCounter;
+        dependencies.topTalkers = m_TopTalkers;
+        dependencies.distinctCounter = m_DistinctCounter;
+        dependencies.rateHistory = m_RateHistory;
+        dependencies.latencyMonitor = m_LatencyMonitor;
+        dependencies.burstDetector = m_BurstDetector;
+        dependencies.alertLogger = m_AlertLogger;
+        dependencies.segmentWriter = m_SegmentWriter;
+        dependencies.selfMetrics = m_SelfMetrics;
+
+        if (m_Parameters.decodeThreads > 0)
+        {
+            m_DecodeSink = std::make_unique<FirewallEtwTraceCallback>(
                 shared_from_this(),
                 m_Parameters,
-                m_FileLogger,
-                m_Timer,
-                m_EventCounter));
-        // NULL szFileName to not create a file.
-        m_EtwReader->StartSession(m_TraceSessionName.c_str(), NULL, m_TraceSessionGuid);
-        m_EtwReader->EnableProviders(m_ProviderGuids);
+                dependencies);
+
+            FirewallEtwTraceCallback* decodeSink = m_DecodeSink.get();
+            m_DecodePipeline = std::make_shared<DecodePipeline>(
+                m_Parameters.decodeThreads,
+                [decodeSink](EVENT_RECORD& eventRecord, VfpEventData& eventData)
+                {
+                    return decodeSink->DecodeEventRecord(eventRecord, eventData);
+                },
+                [decodeSink](VfpEventData& eventData)
+                {
+                    decodeSink->ProcessDecodedEvent(eventData);
+                });
+            m_LastDecodeBatchCheck = ::GetTickCount64();
+        }
+
+        CallbackDependencies callbackDependencies = dependencies;
+        callbackDependencies.decodePipeline = m_DecodePipeline;
+        FirewallEtwTraceCallback callback(
+            shared_from_this(),
+            m_Parameters,
+            callbackDependencies);
+        if (m_FlowTable)
+        {
+            // Writes expired flows: only the outputs.
+            CallbackDependencies flowWriterDependencies;
+            flowWriterDependencies.fileLogger = m_FileLogger;
+            flowWriterDependencies.binaryLogger = m_BinaryLogger;
+            flowWriterDependencies.jsonLogger = m_JsonLogger;
+            flowWriterDependencies.csvLogger = m_CsvLogger;
+            flowWriterDependencies.timer = m_Timer;
+            flowWriterDependencies.eventCounter = m_EventCounter;
+            flowWriterDependencies.segmentWriter = m_SegmentWriter;
+            m_FlowWriter = std::make_unique<FirewallEtwTraceCallback>(
+                shared_from_this(),
+                m_Parameters,
+                flowWriterDependencies);
+            m_LastFlowExpiryCheck = ::GetTickCount64();
+        }
+        // Started once the logs are open.
+        m_EventSource = CreateEventSource(callback);
         m_CaptureSessionRunning = true;
         // Timer
         m_Timer->SetEpocStart();
@@ -103,8 +240,136 @@ namespace FirewallEventMonitor
         if (m_Parameters.outputToFile)
         {
             m_FileLogger->CreateLogFile();
-            m_Timer->SetLogCreated();
         }
+        if (m_Parameters.outputToBinaryFile)
+        {
+            m_BinaryLogger->CreateLogFile();
+        }
+        if (m_Parameters.outputToJsonFile)
+        {
+            m_JsonLogger->CreateLogFile();
+        }
+        if (m_Parameters.outputToCsvFile)
+        {
+            m_CsvLogger->CreateLogFile();
+        }
+        if (m_RuleStatsLogger)
+        {
+            m_RuleStatsLogger->CreateLogFile();
+        }
+        if (m_AlertLogger)
+        {
+            m_AlertLogger->CreateLogFile();
+        }
+        m_Timer->SetLogCreated();
+        // Rate history
+        if (m_RateHistory)
+        {
+            m_RateHistoryFilePath = m_FileLogger->GetLogDirectory();
+            m_RateHistoryFilePath.append(RATE_HISTORY_FILE_NAME);
+            m_LastRateHistoryTick = ::GetTickCount64();
+            m_RateHistory->Tick(GetSystemTimeAsLongLong());
+        }
+        // Self metrics
+        if (m_SelfMetrics)
+        {
+            m_MetricsFilePath = m_FileLogger->GetLogDirectory();
+            m_MetricsFilePath.append(METRICS_FILE_NAME);
+        }
+        // Periodic reports
+        if (m_RuleHitCounter || m_TopTalkers || m_DistinctCounter || m_Parameters.latencyIntervalInSeconds > 0 || m_SelfMetrics)
+        {
+            m_ReportTimer = std::make_unique<ntl::ThreadpoolTimer>();
+        }
+        if (m_RuleHitCounter)
+        {
+            const unsigned long intervalInMilliseconds = m_Parameters.ruleStatsIntervalInSeconds * 1000;
+            m_LastRuleStatsTick = ::GetTickCount64();
+            m_ReportTimer->schedule_reoccuring(
+                [this]() { WriteRuleStats(); },
+                intervalInMilliseconds,
+                intervalInMilliseconds);
+        }
+        if (m_TopTalkers)
+        {
+            const unsigned long intervalInMilliseconds = m_Parameters.topTalkersIntervalInSeconds * 1000;
+            m_LastTopTalkersTick = ::GetTickCount64();
+            m_ReportTimer->schedule_reoccuring(
+                [this]() { WriteTopTalkers(); },
+                intervalInMilliseconds,
+                intervalInMilliseconds);
+        }
+        if (m_DistinctCounter)
+        {
+            const unsigned long intervalInMilliseconds = m_Parameters.distinctCountsIntervalInSeconds * 1000;
+            m_LastDistinctCountsTick = ::GetTickCount64();
+            m_ReportTimer->schedule_reoccuring(
+                [this]() { WriteDistinctCounts(); },
+                intervalInMilliseconds,
+                intervalInMilliseconds);
+        }
+        if (m_Parameters.latencyIntervalInSeconds > 0)
+        {
+            const unsigned long intervalInMilliseconds = m_Parameters.latencyIntervalInSeconds * 1000;
+            m_LastLatencyTick = ::GetTickCount64();
+            m_ReportTimer->schedule_reoccuring(
+                [this]() { WriteLatency(); },
+                intervalInMilliseconds,
+                intervalInMilliseconds);
+        }
+        if (m_SelfMetrics)
+        {
+            const unsigned long intervalInMilliseconds = m_Parameters.metricsIntervalInSeconds * 1000;
+            m_ReportTimer->schedule_reoccuring(
+                [this]() { WriteMetrics(); },
+                intervalInMilliseconds,
+                intervalInMilliseconds);
+        }
+        // Trace
+        if (m_Parameters.traceScopes)
+        {
+            ntl::Trace::start(Parameters::TraceRecordsPerThread);
+        }
+        // Events
+        m_EventSource->Start();
+    }
+
+    std::unique_ptr<EventSource> FirewallCaptureSession::CreateEventSource(
+        const FirewallEtwTraceCallback& callback) const
+    {
+        if (m_EventSourceFactory)
+        {
+            return m_EventSourceFactory(callback);
+        }
+
+        if (!m_Parameters.replayFilePath.empty())
+        {
+            return std::make_unique<EventReplayer>(
+                m_Parameters.replayFilePath,
+                m_Parameters.replaySpeed,
+                callback);
+        }
+
+        if (m_Parameters.synthetic)
+        {
+            SyntheticTrafficProfile profile;
+            profile.sourceCount = m_Parameters.syntheticSources;
+            profile.ruleCount = m_Parameters.syntheticRules;
+            profile.zipfExponent = m_Parameters.syntheticZipfExponent;
+            profile.ipv6Fraction = m_Parameters.syntheticIpv6Percent / 100.0;
+            profile.synFloodFraction = m_Parameters.syntheticSynFloodPercent / 100.0;
+            profile.icmpSweepFraction = m_Parameters.syntheticIcmpSweepPercent / 100.0;
+            profile.seed = m_Parameters.syntheticSeed;
+
+            return std::make_unique<SyntheticEventSource>(
+                profile,
+                m_Parameters.syntheticEventsPerSecond,
+                callback,
+                m_EventCounter,
+                m_Timer);
+        }
+
+        return std::make_unique<RealTimeEventSource>(callback);
     }
 
     void FirewallCaptureSession::CloseSession() try
@@ -114,21 +379,138 @@ namespace FirewallEventMonitor
             return;
         }
 
+        if (!m_EventSource)
+        {
+            wprintf(L"Error: Event source not defined.\n");
+            return;
+        }
+
+        // Stop waits for the thread handing events to the callback, so no events arrive after this.
+        m_EventSource->Stop();
+        m_CaptureSessionRunning = false;
+
+        // Events the workers are still decoding reach the flow table and logs before they close.
+        if (m_DecodePipeline)
+        {
+            m_DecodePipeline->Drain();
+        }
+
+        // Flows still open are written before the logs close.
+        if (m_FlowWriter)
+        {
+            m_FlowTable->ExpireAllFlows(m_ExpiredFlows);
+            WriteExpiredFlows();
+            WriteFlowDurations();
+        }
+
+        // Destroying the timer waits for a report in progress; then write the final partial interval.
+        m_ReportTimer.reset();
+        if (m_TopTalkers)
+        {
+            WriteTopTalkers();
+        }
+        if (m_DistinctCounter)
+        {
+            WriteDistinctCounts();
+
+            if (m_DistinctCounter->GetDroppedEvents() > 0)
+            {
+                wprintf(L"Warning: %llu events were not counted per rule or port: more than %Iu of them were seen.\n",
+                    m_DistinctCounter->GetDroppedEvents(),
+                    DistinctCounter::MaxKeys);
+            }
+        }
+        if (m_RuleHitCounter)
+        {
+            WriteRuleStats();
+
+            if (m_RuleHitCounter->GetDroppedHits() > 0)
+            {
+                wprintf(L"Warning: %llu rule hits were not counted: more than %Iu rules were seen.\n",
+                    m_RuleHitCounter->GetDroppedHits(),
+                    RuleHitCounter::MaxRules);
+            }
+        }
+        if (m_BurstDetector)
+        {
+            wprintf(L"Flagged %llu deny bursts.\n", m_BurstDetector->GetAlertCount());
+
+            if (m_BurstDetector->GetDroppedEvents() > 0)
+            {
+                wprintf(L"Warning: %llu denies were not checked for bursts: more than %Iu ports or rules were seen.\n",
+                    m_BurstDetector->GetDroppedEvents(),
+                    BurstDetector::MaxKeys);
+            }
+        }
+        if (m_LatencyMonitor)
+        {
+            if (m_Parameters.latencyIntervalInSeconds > 0)
+            {
+                WriteLatency();
+            }
+
+            m_LatencyBuffer.clear();
+            m_LatencyMonitor->ReportTotals(m_LatencyBuffer);
+            WriteConsoleUtf8(m_LatencyBuffer);
+        }
+
+        // The partial second is closed into the final rates file.
+        if (m_RateHistory)
+        {
+            m_RateHistory->Tick(GetSystemTimeAsLongLong() + RateHistory::FileTimeTicksPerSecond);
+            WriteRateHistory();
+        }
+
         // Log
         if (m_Parameters.outputToFile)
         {
             m_FileLogger->CloseLogFile();
         }
+        if (m_Parameters.outputToBinaryFile)
+        {
+            m_BinaryLogger->CloseLogFile();
+        }
+        if (m_Parameters.outputToJsonFile)
+        {
+            m_JsonLogger->CloseLogFile();
+        }
+        if (m_Parameters.outputToCsvFile)
+        {
+            m_CsvLogger->CloseLogFile();
+        }
+        if (m_RuleStatsLogger)
+        {
+            m_RuleStatsLogger->CloseLogFile();
+        }
+        if (m_AlertLogger)
+        {
+            m_AlertLogger->CloseLogFile();
+        }
+        if (m_SegmentWriter)
+        {
+            m_SegmentWriter->Close();
+            wprintf(L"Wrote %llu segments.\n", m_SegmentWriter->GetSegmentsWritten());
+        }
 
-        if (!m_EtwReader)
+        // The final metrics count every event and log byte.
+        if (m_SelfMetrics)
         {
-            wprintf(L"Error: Event reader not defined.\n");
-            return;
+            WriteMetrics();
         }
 
-        m_EtwReader->DisableProviders(m_ProviderGuids);
-        m_EtwReader->StopSession();
-        m_CaptureSessionRunning = false;
+        // Every thread that traced has stopped: the source, the decode workers and the report timer.
+        if (m_Parameters.traceScopes)
+        {
+            ntl::Trace::stop();
+            WriteTrace();
+        }
+
+        if (m_DecodePipeline)
+        {
+            WriteDecodeResults();
+        }
+
+        m_EventSource->WriteResults();
 
         wprintf(L"FirewallEventWatcher ran for %.2f seconds. Captured %d events.\n",
             m_Timer->GetTimeElapsedSinceStartInSeconds(),
@@ -141,7 +523,9 @@ namespace FirewallEventMonitor
 
     bool FirewallCaptureSession::CaptureSessionRunning() const
     {
-        return m_CaptureSessionRunning;
+        // A replay ends with its file.
+        return m_CaptureSessionRunning &&
+            !m_EventSource->IsFinished();
     }
 
     bool FirewallCaptureSession::TimeLimitReached() const
@@ -171,50 +555,346 @@ namespace FirewallEventMonitor
 
     void FirewallCaptureSession::LogFileIntervalCheck()
     {
+        if (!m_Parameters.outputToFile &&
+            !m_Parameters.outputToBinaryFile &&
+            !m_Parameters.outputToJsonFile &&
+            !m_Parameters.outputToCsvFile &&
+            !m_RuleStatsLogger &&
+            !m_AlertLogger &&
+            !m_SegmentWriter)
+        {
+            return;
+        }
+
+        // Rotation swaps in a pre-opened file under the logger's lock, so the ETW callback
+        // keeps writing throughout. Housekeeping then prepares the file for the next rotation.
         if (m_Parameters.outputToFile)
         {
-            // If log file is sufficiently old, close it and open a new file.
-            double logFileLifetime = m_Timer->GetTimeElapsedLoggingInSeconds();
-            if (logFileLifetime >= FileLogger::LogFileLimitInSeconds)
-            {
-                wprintf(L"LogFile as been open for %.2f seconds. Closing old file and opening a new one.\n",
-                    logFileLifetime);
-                m_FileLogger->CloseLogFile();
-                m_FileLogger->CreateLogFile();
-                m_Timer->SetLogCreated();
-            }
+            m_FileLogger->RotateIfDue();
+            m_FileLogger->MaintenanceCheck();
+        }
+        if (m_Parameters.outputToBinaryFile)
+        {
+            m_BinaryLogger->RotateIfDue();
+            m_BinaryLogger->MaintenanceCheck();
+        }
+        if (m_Parameters.outputToJsonFile)
+        {
+            m_JsonLogger->RotateIfDue();
+            m_JsonLogger->MaintenanceCheck();
+        }
+        if (m_Parameters.outputToCsvFile)
+        {
+            m_CsvLogger->RotateIfDue();
+            m_CsvLogger->MaintenanceCheck();
+        }
+        if (m_RuleStatsLogger)
+        {
+            m_RuleStatsLogger->RotateIfDue();
+            m_RuleStatsLogger->MaintenanceCheck();
+        }
+        if (m_AlertLogger)
+        {
+            m_AlertLogger->RotateIfDue();
+            m_AlertLogger->MaintenanceCheck();
+        }
+        // Seals segments that have been open too long and writes the sealed ones.
+        if (m_SegmentWriter)
+        {
+            m_SegmentWriter->MaintenanceCheck();
+        }
+    }
+
+    void FirewallCaptureSession::FlowExpiryCheck()
+    {
+        if (!m_FlowWriter)
+        {
+            return;
+        }
+
+        ULONGLONG tickCount = ::GetTickCount64();
+        if (tickCount - m_LastFlowExpiryCheck < FlowExpiryIntervalInMilliseconds)
+        {
+            return;
+        }
+        m_LastFlowExpiryCheck = tickCount;
+
+        // Event timestamps are FILETIMEs, so timeouts are measured against the system time.
+        m_FlowTable->ExpireFlows(GetSystemTimeAsLongLong(), m_ExpiredFlows);
+        WriteExpiredFlows();
+    }
+
+    void FirewallCaptureSession::DecodeBatchCheck()
+    {
+        if (!m_DecodePipeline)
+        {
+            return;
+        }
+
+        // The batch is shared with the ETW thread, so it is not checked on every pass.
+        ULONGLONG tickCount = ::GetTickCount64();
+        if (tickCount - m_LastDecodeBatchCheck < DecodePipeline::FlushIntervalInMilliseconds)
+        {
+            return;
+        }
+        m_LastDecodeBatchCheck = tickCount;
+
+        m_DecodePipeline->FlushCheck();
+    }
+
+    void FirewallCaptureSession::RateHistoryCheck()
+    {
+        if (!m_RateHistory)
+        {
+            return;
+        }
+
+        ULONGLONG tickCount = ::GetTickCount64();
+        if (tickCount - m_LastRateHistoryTick < RateHistoryTickIntervalInMilliseconds)
+        {
+            return;
+        }
+        m_LastRateHistoryTick = tickCount;
+
+        if (m_RateHistory->Tick(GetSystemTimeAsLongLong()))
+        {
+            WriteRateHistory();
+        }
+    }
+
+    void FirewallCaptureSession::WriteRateHistory() try
+    {
+        m_RateHistoryBuffer.clear();
+        m_RateHistory->FormatCsv(m_RateHistoryBuffer);
+        ReplaceFile(m_RateHistoryFilePath, m_RateHistoryBuffer);
+    }
+    catch (const std::exception &ex)
+    {
+        wprintf(L"Warning: Writing rate history raised exception: %S.\n", ex.what());
+    }
+
+    void FirewallCaptureSession::WriteExpiredFlows()
+    {
+        for (const auto& flow : m_ExpiredFlows)
+        {
+            m_FlowWriter->OutputEventData(flow);
+
+            double durationInSeconds = static_cast<double>(flow.lastTimeStamp - flow.timeStamp) / RateHistory::FileTimeTicksPerSecond;
+            m_FlowDurations.add(durationInSeconds);
+            m_FlowDurationQuantiles.add(durationInSeconds);
+        }
+        m_ExpiredFlows.clear();
+    }
+
+    void FirewallCaptureSession::WriteFlowDurations() const
+    {
+        if (m_FlowDurations.count() == 0)
+        {
+            return;
+        }
+
+        const double ranks[] = { 0.5, 0.9, 0.99 };
+        double quantiles[3] = {};
+        m_FlowDurationQuantiles.quantiles(ranks, ranks + 3, quantiles);
+        wprintf(L"Flow durations in seconds (%llu flows): mean %.3f, deviation %.3f, p50 %.3f, p90 %.3f, p99 %.3f, max %.3f.\n",
+            m_FlowDurations.count(),
+            m_FlowDurations.mean(),
+            m_FlowDurations.standard_deviation(),
+            quantiles[0],
+            quantiles[1],
+            quantiles[2],
+            m_FlowDurations.maximum());
+    }
+
+    void FirewallCaptureSession::WriteRuleStats() try
+    {
+        ULONGLONG tickCount = ::GetTickCount64();
+        unsigned long elapsedInSeconds = static_cast<unsigned long>((tickCount - m_LastRuleStatsTick + 500) / 1000);
+        m_LastRuleStatsTick = tickCount;
+
+        m_RuleHitCounter->Snapshot(m_RuleHitDeltas);
+
+        m_RuleStatsBuffer.clear();
+        RuleHitCounter::FormatTable(m_RuleHitDeltas, elapsedInSeconds, m_RuleStatsBuffer);
+        WriteConsoleUtf8(m_RuleStatsBuffer);
+
+        if (m_RuleStatsLogger)
+        {
+            m_RuleStatsBuffer.clear();
+            RuleHitCounter::FormatCsv(m_RuleHitDeltas, GetSystemTimeAsLongLong(), m_RuleStatsBuffer);
+            m_RuleStatsLogger->Write(m_RuleStatsBuffer.data(), m_RuleStatsBuffer.size());
         }
     }
+    catch (const std::exception &ex)
+    {
+        wprintf(L"Error: Writing rule statistics raised exception: %S.\n", ex.what());
+    }
+
+    void FirewallCaptureSession::WriteTopTalkers() try
+    {
+        ULONGLONG tickCount = ::GetTickCount64();
+        unsigned long elapsedInSeconds = static_cast<unsigned long>((tickCount - m_LastTopTalkersTick + 500) / 1000);
+        m_LastTopTalkersTick = tickCount;
+
+        m_TopTalkersBuffer.clear();
+        m_TopTalkers->Report(TopTalkers::ReportedKeys, elapsedInSeconds, m_TopTalkersBuffer);
+        WriteConsoleUtf8(m_TopTalkersBuffer);
+    }
+    catch (const std::exception &ex)
+    {
+        wprintf(L"Error: Writing top talkers raised exception: %S.\n", ex.what());
+    }
+
+    void FirewallCaptureSession::WriteDistinctCounts() try
+    {
+        ULONGLONG tickCount = ::GetTickCount64();
+        unsigned long elapsedInSeconds = static_cast<unsigned long>((tickCount - m_LastDistinctCountsTick + 500) / 1000);
+        m_LastDistinctCountsTick = tickCount;
+
+        m_DistinctCountsBuffer.clear();
+        m_DistinctCounter->Report(DistinctCounter::ReportedKeys, elapsedInSeconds, m_DistinctCountsBuffer);
+        WriteConsoleUtf8(m_DistinctCountsBuffer);
+    }
+    catch (const std::exception &ex)
+    {
+        wprintf(L"Error: Writing distinct counts raised exception: %S.\n", ex.what());
+    }
+
+    void FirewallCaptureSession::WriteLatency() try
+    {
+        ULONGLONG tickCount = ::GetTickCount64();
+        unsigned long elapsedInSeconds = static_cast<unsigned long>((tickCount - m_LastLatencyTick + 500) / 1000);
+        m_LastLatencyTick = tickCount;
+
+        m_LatencyBuffer.clear();
+        m_LatencyMonitor->Report(elapsedInSeconds, m_LatencyBuffer);
+        WriteConsoleUtf8(m_LatencyBuffer);
+    }
+    catch (const std::exception &ex)
+    {
+        wprintf(L"Error: Writing latency raised exception: %S.\n", ex.what());
+    }
 
-    bool FirewallCaptureSession::MatchIpAddressFilter(
-        const std::wstring& address) const
+    void FirewallCaptureSession::WriteMetrics() try
     {
-        if (m_Parameters.ipAddressFilters.empty())
+        SelfMetricsGauges& gauges = m_MetricsGauges;
+        gauges.uptimeInSeconds = m_Timer->GetTimeElapsedSinceStartInSeconds();
+
+        gauges.logs.clear();
+        if (m_Parameters.outputToFile)
+        {
+            gauges.logs.push_back(LogMetrics{ "text", m_FileLogger->GetTotalBytesWritten(), m_FileLogger->GetRotationCount() });
+        }
+        if (m_Parameters.outputToBinaryFile)
         {
-            return true;
+            gauges.logs.push_back(LogMetrics{ "binary", m_BinaryLogger->GetTotalBytesWritten(), m_BinaryLogger->GetRotationCount() });
         }
+        if (m_Parameters.outputToJsonFile)
+        {
+            gauges.logs.push_back(LogMetrics{ "json", m_JsonLogger->GetTotalBytesWritten(), m_JsonLogger->GetRotationCount() });
+        }
+        if (m_Parameters.outputToCsvFile)
+        {
+            gauges.logs.push_back(LogMetrics{ "csv", m_CsvLogger->GetTotalBytesWritten(), m_CsvLogger->GetRotationCount() });
+        }
+        if (m_SegmentWriter)
+        {
+            // Each segment is a file of its own; none rotate.
+            gauges.logs.push_back(LogMetrics{ "segments", m_SegmentWriter->GetTotalBytesWritten(), 0 });
+        }
+
+        gauges.decodeBatchesInFlight = m_DecodePipeline ? m_DecodePipeline->GetBatchesInFlight() : 0;
+        gauges.decodeReorderDepth = m_DecodePipeline ? m_DecodePipeline->GetReorderDepth() : 0;
+        gauges.activeFlows = m_FlowTable ? m_FlowTable->GetFlowCount() : 0;
 
-        auto found = std::find(
-            m_Parameters.ipAddressFilters.begin(),
-            m_Parameters.ipAddressFilters.end(),
-            address);
+        PROCESS_MEMORY_COUNTERS_EX memoryCounters = {};
+        memoryCounters.cb = sizeof(memoryCounters);
+        if (::K32GetProcessMemoryInfo(
+            ::GetCurrentProcess(),
+            reinterpret_cast<PPROCESS_MEMORY_COUNTERS>(&memoryCounters),
+            sizeof(memoryCounters)))
+        {
+            gauges.workingSetBytes = memoryCounters.WorkingSetSize;
+            gauges.privateBytes = memoryCounters.PrivateUsage;
+        }
 
-        return found != m_Parameters.ipAddressFilters.end();
+        m_MetricsBuffer.clear();
+        m_SelfMetrics->FormatPrometheus(gauges, m_LatencyMonitor.get(), m_MetricsBuffer);
+        ReplaceFile(m_MetricsFilePath, m_MetricsBuffer);
+    }
+    catch (const std::exception &ex)
+    {
+        wprintf(L"Warning: Writing metrics raised exception: %S.\n", ex.what());
     }
 
-    bool FirewallCaptureSession::MatchRuleIdFilter(
-        const std::wstring& ruleId) const
+    void FirewallCaptureSession::WriteTrace() try
     {
-        if (m_Parameters.ruleIdFilters.empty())
+        std::string trace;
+        unsigned long long lostRecords = ntl::Trace::write_chrome_trace(trace);
+
+        std::wstring traceFilePath = m_FileLogger->GetLogDirectory();
+        traceFilePath.append(TRACE_FILE_NAME);
+        ReplaceFile(traceFilePath, trace);
+        wprintf(L"Wrote the timed scopes to %ls.\n", traceFilePath.c_str());
+
+        if (lostRecords > 0)
         {
-            return true;
+            wprintf(L"Warning: %llu timed scopes were overwritten: the trace holds the last %lu of each thread.\n",
+                lostRecords,
+                Parameters::TraceRecordsPerThread);
         }
+    }
+    catch (const std::exception &ex)
+    {
+        wprintf(L"Warning: Writing the trace raised exception: %S.\n", ex.what());
+    }
 
-        auto found = std::find(
-            m_Parameters.ruleIdFilters.begin(),
-            m_Parameters.ruleIdFilters.end(),
-            ruleId);
+    void FirewallCaptureSession::WriteDecodeResults()
+    {
+        DecodePipelineResults results = m_DecodePipeline->GetResults();
+        wprintf(L"Decoded %llu events in %llu batches on %Iu workers; %llu events passed the filters.\n",
+            results.eventsQueued,
+            results.batchesQueued,
+            m_DecodePipeline->GetWorkerCount(),
+            results.eventsDelivered);
+        wprintf(L"%llu batches were decoded ahead of an earlier one (at most %Iu waiting to be delivered). ETW waited for the workers %llu times.\n",
+            results.batchesReordered,
+            results.maximumReorderDepth,
+            results.backpressureWaits);
+    }
 
-        return found != m_Parameters.ruleIdFilters.end();
+    void FirewallCaptureSession::ReplaceFile(
+        const std::wstring& filePath,
+        const std::string& text)
+    {
+        std::wstring temporaryFilePath(filePath);
+        temporaryFilePath.append(L".tmp");
+
+        HANDLE file = ::CreateFileW(
+            temporaryFilePath.c_str(),
+            GENERIC_WRITE,
+            0,
+            NULL,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL,
+            NULL);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            std::string errorMessage = "Unable to open file ";
+            errorMessage += ntl::String::convert_to_string(temporaryFilePath);
+            throw std::exception(errorMessage.c_str());
+        }
+
+        DWORD bytesWritten = 0;
+        BOOL written = ::WriteFile(file, text.data(), static_cast<DWORD>(text.size()), &bytesWritten, NULL);
+        ::CloseHandle(file);
+        if (!written ||
+            !::MoveFileExW(temporaryFilePath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING))
+        {
+            ::DeleteFileW(temporaryFilePath.c_str());
+            std::string errorMessage = "Unable to write file ";
+            errorMessage += ntl::String::convert_to_string(filePath);
+            throw std::exception(errorMessage.c_str());
+        }
     }
 }
\ No newline at end of file
@@ -12,10 +12,24 @@
 #include "ntlEtwReader.hpp"
 #include "ntlEtwRecord.hpp"
 #include "ntlEtwRecordQuery.hpp"
+#include "ntlThreadPoolTimer.hpp"
+#include "ntlMath.hpp"
 
 #include "FileLogger.h"
+#include "BinaryLogger.h"
+#include "SegmentWriter.h"
 #include "Timer.h"
 #include "EventCounter.h"
+#include "FlowTable.h"
+#include "RuleHitCounter.h"
+#include "TopTalkers.h"
+#include "DistinctCounter.h"
+#include "RateHistory.h"
+#include "LatencyMonitor.h"
+#include "BurstDetector.h"
+#include "EventSource.h"
+#include "DecodePipeline.h"
+#include "SelfMetrics.h"
 #include "FirewallEtwTraceCallback.h"
 
 namespace FirewallEventMonitor
@@ -30,8 +44,12 @@ namespace FirewallEventMonitor
         FirewallCaptureSession(
             const Parameters &params,
             std::shared_ptr<FileLogger> fileLogger,
+            std::shared_ptr<BinaryLogger> binaryLogger,
+            std::shared_ptr<FileLogger> jsonLogger,
+            std::shared_ptr<FileLogger> csvLogger,
             std::shared_ptr<Timer> timer,
-            std::shared_ptr<EventCounter> eventCounter);
+            std::shared_ptr<EventCounter> eventCounter,
+            EventSourceFactory eventSourceFactory = EventSourceFactory());
 
         ~FirewallCaptureSession();
 
@@ -45,37 +63,130 @@ namespace FirewallEventMonitor
 
         void LogFileIntervalCheck();
 
+        // If aggregating flows, writes the flows that have timed out (checked once per second).
+        void FlowExpiryCheck();
+
+        // If decoding on workers, queues the events that have waited too long for a full batch.
+        void DecodeBatchCheck();
+
+        // If keeping rate history, closes the seconds that have passed and rewrites the
+        // rates file each time a minute closes.
+        void RateHistoryCheck();
+
         double GetTimeRemainingInEpoc() const;
 
         bool EventCountLimitPerEpocReached() const;
 
         void ResetEpoc();
 
-        // Returns true if the address matches one of the filters, or if there are no filters.
-        bool MatchIpAddressFilter(const std::wstring& address) const;
-
-        // Returns true if the rule matches one of the filters, or if there are no filters.
-        bool MatchRuleIdFilter(const std::wstring& ruleId) const;
-
         // Constants
         const double EpocTimeInMilliseconds = 1000.0; // 1 second.
+        const ULONGLONG FlowExpiryIntervalInMilliseconds = 1000; // 1 second.
+        const ULONGLONG RateHistoryTickIntervalInMilliseconds = 100; // Events land at most this late in the next second.
 
         FirewallCaptureSession(FirewallCaptureSession const&) = delete;
         FirewallCaptureSession& operator=(FirewallCaptureSession const&) = delete;
 
     private:
-        void GenerateTraceSessionName();
+        // The factory's source if one was given, else a replay or generator if -Replay or -Synthetic was,
+        // else a live trace session.
+        std::unique_ptr<EventSource> CreateEventSource(const FirewallEtwTraceCallback& callback) const;
+
+        // Writes and clears m_ExpiredFlows.
+        void WriteExpiredFlows();
+
+        // Prints a summary of the durations of the flows written.
+        void WriteFlowDurations() const;
+
+        // Writes the rule hits since the previous call. Runs on the report timer.
+        void WriteRuleStats();
+
+        // Writes the top talkers since the previous call. Runs on the report timer.
+        void WriteTopTalkers();
+
+        // Writes the distinct counts since the previous call. Runs on the report timer.
+        void WriteDistinctCounts();
+
+        // Writes the latency percentiles since the previous call. Runs on the report timer.
+        void WriteLatency();
+
+        // Rewrites the rates file from m_RateHistory.
+        void WriteRateHistory();
+
+        // Rewrites the metrics file. Runs on the report timer.
+        void WriteMetrics();
+
+        // Writes the scopes ntl::Trace recorded. Only once no thread records any more.
+        void WriteTrace();
+
+        // Prints how the decode workers' batches were delivered.
+        void WriteDecodeResults();
+
+        // Replaces the file's contents by writing a temporary file and renaming it over the
+        // original, so readers never see a partial file.
+        static void ReplaceFile(
+            const std::wstring& filePath,
+            const std::string& text);
 
         // Helpers
         std::shared_ptr<FileLogger> m_FileLogger;
+        std::shared_ptr<BinaryLogger> m_BinaryLogger;
+        std::shared_ptr<FileLogger> m_JsonLogger;
+        std::shared_ptr<FileLogger> m_CsvLogger;
         std::shared_ptr<Timer> m_Timer;
         std::shared_ptr<EventCounter> m_EventCounter;
+        std::shared_ptr<FlowTable> m_FlowTable;
         Parameters m_Parameters;
         // Members
-        std::unique_ptr<ntl::EtwReader<FirewallEtwTraceCallback>> m_EtwReader;
-        std::vector<GUID> m_ProviderGuids;
-        std::wstring m_TraceSessionName;
-        GUID m_TraceSessionGuid;
+        // Decoding on workers: m_DecodeSink counts and writes what they decode, in order. Declared
+        // before the event source, whose callback shares the pipeline, so it outlives it.
+        std::unique_ptr<FirewallEtwTraceCallback> m_DecodeSink;
+        std::shared_ptr<DecodePipeline> m_DecodePipeline;
+        ULONGLONG m_LastDecodeBatchCheck = 0;
+        EventSourceFactory m_EventSourceFactory;
+        std::unique_ptr<EventSource> m_EventSource;
         bool m_CaptureSessionRunning;
+        // Writes expired flows from the main thread; the ETW callback only adds to the table.
+        std::unique_ptr<FirewallEtwTraceCallback> m_FlowWriter;
+        std::vector<VfpEventData> m_ExpiredFlows;
+        // Durations of the flows written, in seconds, in constant memory.
+        ntl::RunningStatistics m_FlowDurations;
+        ntl::QuantileSketch m_FlowDurationQuantiles;
+        ULONGLONG m_LastFlowExpiryCheck = 0;
+        // Rule statistics
+        std::shared_ptr<RuleHitCounter> m_RuleHitCounter;
+        std::shared_ptr<FileLogger> m_RuleStatsLogger;
+        std::vector<RuleHitCounts> m_RuleHitDeltas;
+        std::string m_RuleStatsBuffer;
+        ULONGLONG m_LastRuleStatsTick = 0;
+        // Top talkers
+        std::shared_ptr<TopTalkers> m_TopTalkers;
+        std::string m_TopTalkersBuffer;
+        ULONGLONG m_LastTopTalkersTick = 0;
+        // Distinct counts
+        std::shared_ptr<DistinctCounter> m_DistinctCounter;
+        std::string m_DistinctCountsBuffer;
+        ULONGLONG m_LastDistinctCountsTick = 0;
+        // Rate history
+        std::shared_ptr<RateHistory> m_RateHistory;
+        std::wstring m_RateHistoryFilePath;
+        std::string m_RateHistoryBuffer;
+        ULONGLONG m_LastRateHistoryTick = 0;
+        // Latency
+        std::shared_ptr<LatencyMonitor> m_LatencyMonitor;
+        std::string m_LatencyBuffer;
+        ULONGLONG m_LastLatencyTick = 0;
+        // Deny bursts
+        std::shared_ptr<BurstDetector> m_BurstDetector;
+        std::shared_ptr<FileLogger> m_AlertLogger;
+        // Segments
+        std::shared_ptr<SegmentWriter> m_SegmentWriter;
+        // Self metrics
+        std::shared_ptr<SelfMetrics> m_SelfMetrics;
+        std::wstring m_MetricsFilePath;
+        SelfMetricsGauges m_MetricsGauges;
+        std::string m_MetricsBuffer;
+        // Runs the periodic reports (rule statistics, top talkers, distinct counts, latency, metrics) off the capture thread.
+        std::unique_ptr<ntl::ThreadpoolTimer> m_ReportTimer;
     };
 }
\ No newline at end of file
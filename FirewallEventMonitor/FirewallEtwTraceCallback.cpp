@@ -3,6 +3,10 @@
 
 #include "FirewallEtwTraceCallback.h"
 #include "FirewallCaptureSession.h"
+#include "ConsoleOutput.h"
+#include "EventFormatter.h"
+// ntl headers
+#include "ntlTrace.hpp"
 
 namespace FirewallEventMonitor
 {
@@ -10,99 +14,443 @@ namespace FirewallEventMonitor
     const INT IPV6_RULE_MATCH_EVENT_ID = 401;
     const INT IPV4_ICMP_RULE_MATCH_EVENT_ID = 402;
 
+    // ETW tells a real-time consumer what it lost with events of this class.
+    const GUID RT_LOST_EVENT_GUID = {
+        0x6A399AE0,
+        0x4BC6,
+        0x4DE9,
+        { 0x87, 0x0B, 0x36, 0x57, 0xF8, 0x94, 0x7E, 0x7E } };
+    const UCHAR RT_LOST_EVENT_OPCODE = 32;
+    const UCHAR RT_LOST_BUFFER_OPCODE = 33;
+
     FirewallEtwTraceCallback::FirewallEtwTraceCallback(
         const std::weak_ptr<FirewallCaptureSession> eventWatcher,
         const Parameters &parameters,
-        const std::shared_ptr<FileLogger> fileLogger,
-        const std::shared_ptr<Timer> timer,
-        const std::shared_ptr<EventCounter> eventCounter)
+        const CallbackDependencies& dependencies)
         : m_EventWatcher(eventWatcher),
         m_Parameters(parameters),
-        m_FileLogger(fileLogger),
-        m_Timer(timer),
-        m_EventCounter(eventCounter)
+        m_Predicate(parameters, 0),
+        m_FileLogger(dependencies.fileLogger),
+        m_BinaryLogger(dependencies.binaryLogger),
+        m_JsonLogger(dependencies.jsonLogger),
+        m_CsvLogger(dependencies.csvLogger),
+        m_Timer(dependencies.timer),
+        m_EventCounter(dependencies.eventCounter),
+        m_FlowTable(dependencies.flowTable),
+        m_RuleHitCounter(dependencies.ruleHitCounter),
+        m_TopTalkers(dependencies.topTalkers),
+        m_DistinctCounter(dependencies.distinctCounter),
+        m_RateHistory(dependencies.rateHistory),
+        m_LatencyMonitor(dependencies.latencyMonitor),
+        m_BurstDetector(dependencies.burstDetector),
+        m_AlertLogger(dependencies.alertLogger),
+        m_SegmentWriter(dependencies.segmentWriter),
+        m_DecodePipeline(dependencies.decodePipeline),
+        m_SelfMetrics(dependencies.selfMetrics)
     {
+        m_FormatBuffer.reserve(FormatBufferReserveInBytes);
+        // An event raises at most one alert for its port and one for its rule.
+        m_Alerts.reserve(2);
     }
 
     bool FirewallEtwTraceCallback::operator()(
+        const PEVENT_RECORD pEventRecord)
+    {
+        NTL_TRACE_SCOPE("EventCallback");
+        if (m_SelfMetrics)
+        {
+            if (::IsEqualGUID(pEventRecord->EventHeader.ProviderId, RT_LOST_EVENT_GUID))
+            {
+                UCHAR opcode = pEventRecord->EventHeader.EventDescriptor.Opcode;
+                if (opcode == RT_LOST_EVENT_OPCODE)
+                {
+                    m_SelfMetrics->AddDrop(SelfMetrics::EtwEventsLost);
+                }
+                else if (opcode == RT_LOST_BUFFER_OPCODE)
+                {
+                    m_SelfMetrics->AddDrop(SelfMetrics::EtwBuffersLost);
+                }
+                return false;
+            }
+        }
+
+        if (!AdmitEvent())
+        {
+            return false;
+        }
+
+        return ProcessAdmittedEvent(pEventRecord);
+    }
+
+    bool FirewallEtwTraceCallback::ProcessAdmittedEvent(
         const PEVENT_RECORD pEventRecord) try
     {
-        if (m_EventCounter->EpocEventCountLimitReached() ||
-            m_Timer->TimeLimitReached())
+        if (m_DecodePipeline)
         {
+            // Copied without decoding, so this thread keeps up with as many workers as decode.
+            if (IsRuleMatchEvent(pEventRecord->EventHeader.EventDescriptor.Id))
+            {
+                if (m_SelfMetrics)
+                {
+                    m_SelfMetrics->AddStage(SelfMetrics::RuleMatch);
+                }
+                m_DecodePipeline->AddEventRecord(*pEventRecord);
+            }
+            // The reader must not keep the record.
             return false;
         }
 
-        ntl::EtwRecord record(pEventRecord);
+        if (!IsRuleMatchEvent(pEventRecord->EventHeader.EventDescriptor.Id))
+        {
+            return false;
+        }
 
-        return ProcessEventRecord(record);
+        // Parsing the record is part of Collect.
+        LatencyMonitor::StageClock clock(m_LatencyMonitor.get());
+        m_EtwRecord.assign(pEventRecord);
+
+        return ProcessRuleMatchRecord(m_EtwRecord, clock);
     }
     catch (const std::exception &ex)
     {
         wprintf(L"Exception: %S.\n", ex.what());
+        if (m_SelfMetrics)
+        {
+            m_SelfMetrics->AddDrop(SelfMetrics::Error);
+        }
         return false;
     }
 
+    bool FirewallEtwTraceCallback::AdmitEvent() const
+    {
+        if (m_SelfMetrics)
+        {
+            m_SelfMetrics->AddStage(SelfMetrics::Received);
+        }
+
+        if (m_EventCounter->EpocEventCountLimitReached())
+        {
+            if (m_SelfMetrics)
+            {
+                m_SelfMetrics->AddDrop(SelfMetrics::Throttled);
+            }
+            return false;
+        }
+
+        if (m_Timer->TimeLimitReached())
+        {
+            if (m_SelfMetrics)
+            {
+                m_SelfMetrics->AddDrop(SelfMetrics::TimeLimit);
+            }
+            return false;
+        }
+
+        return true;
+    }
+
     bool FirewallEtwTraceCallback::ProcessEventRecord(
         const ntl::EtwRecord& record)
     {
-        INT eventId = record.getEventId();
-        bool vfpEventIdMatch =
-            eventId == IPV4_RULE_MATCH_EVENT_ID ||
-            eventId == IPV6_RULE_MATCH_EVENT_ID ||
-            eventId == IPV4_ICMP_RULE_MATCH_EVENT_ID;
-        if (!vfpEventIdMatch)
+        NTL_TRACE_SCOPE("ProcessEventRecord");
+        if (!AdmitEvent() ||
+            !IsRuleMatchEvent(record.getEventId()))
         {
             return false;
         }
 
-        auto captureSession = m_EventWatcher.lock();
-        if (!captureSession)
+        LatencyMonitor::StageClock clock(m_LatencyMonitor.get());
+        return ProcessRuleMatchRecord(record, clock);
+    }
+
+    bool FirewallEtwTraceCallback::ProcessRuleMatchRecord(
+        const ntl::EtwRecord& record,
+        LatencyMonitor::StageClock& clock)
+    {
+        if (m_LatencyMonitor)
+        {
+            m_LatencyMonitor->RecordEventAge(record.getTimeStamp().QuadPart);
+        }
+        if (m_SelfMetrics)
         {
+            m_SelfMetrics->AddStage(SelfMetrics::RuleMatch);
+        }
+
+        if (m_EventWatcher.expired())
+        {
+            if (m_SelfMetrics)
+            {
+                m_SelfMetrics->AddDrop(SelfMetrics::SessionClosed);
+            }
             return false;
         }
 
-        VfpEventData eventData = CollectEventData(record);
+        CollectEventData(record, m_EventData);
+        clock.EndStage(LatencyMonitor::Collect);
+        if (m_SelfMetrics)
+        {
+            m_SelfMetrics->AddStage(SelfMetrics::Decoded);
+        }
+
+        return ProcessCollectedEvent(m_EventData, clock);
+    }
 
-        // If Ip Filters were specified, filter out events
-        //     where neither the Source nor Destination match.
-        bool sourceNotMatching =
-            !eventData.source.empty() &&
-            !captureSession->MatchIpAddressFilter(eventData.source);
-        bool destinationNotMatching =
-            !eventData.destination.empty() &&
-            !captureSession->MatchIpAddressFilter(eventData.destination);
-        if (sourceNotMatching && destinationNotMatching)
+    bool FirewallEtwTraceCallback::ProcessEventData(
+        VfpEventData& eventData)
+    {
+        NTL_TRACE_SCOPE("ProcessEventData");
+        LatencyMonitor::StageClock clock(m_LatencyMonitor.get());
+        if (m_LatencyMonitor)
         {
-            return false;
+            m_LatencyMonitor->RecordEventAge(eventData.timeStamp);
+        }
+        // Decoded before it got here.
+        clock.EndStage(LatencyMonitor::Collect);
+        if (m_SelfMetrics)
+        {
+            m_SelfMetrics->AddStage(SelfMetrics::RuleMatch);
+            m_SelfMetrics->AddStage(SelfMetrics::Decoded);
         }
 
-        // If RuleId Filters were specified, filter out events
-        //     where the RuleId does not match.
-        if (!captureSession->MatchRuleIdFilter(eventData.ruleId))
+        return ProcessCollectedEvent(eventData, clock);
+    }
+
+    bool FirewallEtwTraceCallback::DecodeEventRecord(
+        EVENT_RECORD& eventRecord,
+        _Inout_ VfpEventData& eventData) const
+    {
+        NTL_TRACE_SCOPE("DecodeEventRecord");
+        // Timed stage by stage; the ordered stages record the event's age and total.
+        LONGLONG start = m_LatencyMonitor ? LatencyMonitor::Now() : 0;
+        unsigned long long startAllocations = m_LatencyMonitor ? AllocationCounter::GetAllocationCount() : 0;
+        unsigned long long startAllocatedBytes = m_LatencyMonitor ? AllocationCounter::GetAllocatedBytes() : 0;
+
+        // One per worker, parsed into again for each of its events.
+        static thread_local ntl::EtwRecord record;
+        record.assign(&eventRecord);
+        CollectEventData(record, eventData);
+        LONGLONG collected = m_LatencyMonitor ? LatencyMonitor::Now() : 0;
+        unsigned long long collectedAllocations = m_LatencyMonitor ? AllocationCounter::GetAllocationCount() : 0;
+        unsigned long long collectedAllocatedBytes = m_LatencyMonitor ? AllocationCounter::GetAllocatedBytes() : 0;
+
+        bool matched = MatchFilters(eventData);
+        if (m_LatencyMonitor)
         {
+            m_LatencyMonitor->RecordStage(LatencyMonitor::Collect, start, collected);
+            m_LatencyMonitor->RecordStage(LatencyMonitor::Filter, collected, LatencyMonitor::Now());
+            m_LatencyMonitor->RecordAllocations(
+                LatencyMonitor::Collect,
+                collectedAllocations - startAllocations,
+                collectedAllocatedBytes - startAllocatedBytes);
+            m_LatencyMonitor->RecordAllocations(
+                LatencyMonitor::Filter,
+                AllocationCounter::GetAllocationCount() - collectedAllocations,
+                AllocationCounter::GetAllocatedBytes() - collectedAllocatedBytes);
+        }
+        if (m_SelfMetrics)
+        {
+            m_SelfMetrics->AddStage(SelfMetrics::Decoded);
+            if (matched)
+            {
+                m_SelfMetrics->AddStage(SelfMetrics::PassedFilters);
+            }
+            else
+            {
+                m_SelfMetrics->AddDrop(SelfMetrics::FilteredOut);
+            }
+        }
+        return matched;
+    }
+
+    void FirewallEtwTraceCallback::ProcessDecodedEvent(
+        VfpEventData& eventData)
+    {
+        NTL_TRACE_SCOPE("ProcessDecodedEvent");
+        LatencyMonitor::StageClock clock(m_LatencyMonitor.get());
+        if (m_LatencyMonitor)
+        {
+            m_LatencyMonitor->RecordEventAge(eventData.timeStamp);
+        }
+
+        ProcessFilteredEvent(eventData, clock);
+    }
+
+    bool FirewallEtwTraceCallback::ProcessCollectedEvent(
+        VfpEventData& eventData,
+        LatencyMonitor::StageClock& clock)
+    {
+        if (!MatchFilters(eventData))
+        {
+            if (m_SelfMetrics)
+            {
+                m_SelfMetrics->AddDrop(SelfMetrics::FilteredOut);
+            }
             return false;
         }
+        clock.EndStage(LatencyMonitor::Filter);
+        if (m_SelfMetrics)
+        {
+            m_SelfMetrics->AddStage(SelfMetrics::PassedFilters);
+        }
+
+        ProcessFilteredEvent(eventData, clock);
+        return true;
+    }
+
+    bool FirewallEtwTraceCallback::MatchFilters(
+        const VfpEventData& eventData) const
+    {
+        NTL_TRACE_SCOPE("MatchFilters");
+        return m_Predicate.Matches(eventData);
+    }
+
+    void FirewallEtwTraceCallback::ProcessFilteredEvent(
+        VfpEventData& eventData,
+        LatencyMonitor::StageClock& clock)
+    {
+        NTL_TRACE_SCOPE("ProcessFilteredEvent");
+        if (m_RuleHitCounter)
+        {
+            m_RuleHitCounter->AddHit(eventData);
+        }
+
+        if (m_RateHistory)
+        {
+            m_RateHistory->AddEvent(eventData);
+        }
+
+        if (m_TopTalkers || m_DistinctCounter || m_BurstDetector || m_FlowTable)
+        {
+            m_EventKeys.Parse(eventData);
+            if (m_TopTalkers)
+            {
+                m_TopTalkers->AddEvent(m_EventKeys);
+            }
+            if (m_DistinctCounter)
+            {
+                m_DistinctCounter->AddEvent(m_EventKeys);
+            }
+            if (m_BurstDetector &&
+                BurstDetector::IsDeny(eventData))
+            {
+                m_BurstDetector->AddDeny(m_EventKeys, eventData.timeStamp, m_Alerts);
+                if (!m_Alerts.empty())
+                {
+                    OutputAlerts();
+                }
+            }
+        }
+        clock.EndStage(LatencyMonitor::Statistics);
+
+        // Events of a port or rule in a deny burst are written one by one while it lasts.
+        bool highFidelity =
+            m_BurstDetector &&
+            m_BurstDetector->IsHighFidelity(m_EventKeys, eventData.timeStamp);
+
+        if (m_FlowTable && !highFidelity)
+        {
+            // Counted now and written when the flow expires (see FirewallCaptureSession::FlowExpiryCheck).
+            // With the table full, the event is written straight away as a flow of one.
+            if (!m_FlowTable->AddEvent(eventData, m_EventKeys))
+            {
+                FlowTable::StartFlow(eventData);
+                OutputEventData(eventData);
+            }
+        }
+        else if (m_FlowTable)
+        {
+            // Still a flow of one, so it fills the flow columns of the aggregated outputs.
+            FlowTable::StartFlow(eventData);
+            OutputEventData(eventData);
+        }
+        else
+        {
+            OutputEventData(eventData);
+        }
+        clock.EndStage(LatencyMonitor::Output);
+
+        m_EventCounter->IncrementEventCount();
+        if (m_SelfMetrics)
+        {
+            m_SelfMetrics->AddStage(SelfMetrics::Processed);
+        }
+    }
+
+    void FirewallEtwTraceCallback::OutputEventData(
+        const VfpEventData& eventData)
+    {
+        NTL_TRACE_SCOPE("OutputEventData");
+        // Transcode once for all of the text sinks.
+        if (m_Parameters.outputToConsole ||
+            m_Parameters.outputToFile ||
+            m_Parameters.outputToJsonFile ||
+            m_Parameters.outputToCsvFile)
+        {
+            EventFormatter::ConvertToUtf8(eventData, m_Utf8EventData);
+        }
 
         if (m_Parameters.outputToConsole)
         {
-            OutputToConsole(eventData);
+            OutputToConsole(m_Utf8EventData);
         }
 
         if (m_Parameters.outputToFile)
         {
-            OutputToFile(eventData);
+            OutputToFile(m_Utf8EventData);
         }
 
-        m_EventCounter->IncrementEventCount();
+        if (m_Parameters.outputToBinaryFile)
+        {
+            OutputToBinaryFile(eventData);
+        }
 
-        return true;
+        if (m_Parameters.outputToJsonFile)
+        {
+            OutputToJsonFile(m_Utf8EventData);
+        }
+
+        if (m_Parameters.outputToCsvFile)
+        {
+            OutputToCsvFile(m_Utf8EventData);
+        }
+
+        if (m_Parameters.outputToSegmentFiles)
+        {
+            OutputToSegmentFile(eventData);
+        }
+    }
+
+    bool FirewallEtwTraceCallback::IsRuleMatchEvent(
+        INT eventId)
+    {
+        return
+            eventId == IPV4_RULE_MATCH_EVENT_ID ||
+            eventId == IPV6_RULE_MATCH_EVENT_ID ||
+            eventId == IPV4_ICMP_RULE_MATCH_EVENT_ID;
     }
 
     VfpEventData FirewallEtwTraceCallback::CollectEventData(
         const ntl::EtwRecord& record)
     {
         VfpEventData eventData;
+        CollectEventData(record, eventData);
+        return eventData;
+    }
+
+    void FirewallEtwTraceCallback::CollectEventData(
+        const ntl::EtwRecord& record,
+        _Inout_ VfpEventData& eventData)
+    {
+        NTL_TRACE_SCOPE("CollectEventData");
+        // Every other field is assigned below, or cleared when the event does not have it.
+        // Clearing keeps the strings' memory.
+        eventData.direction.clear();
+        eventData.ruleType.clear();
+        eventData.protocol.clear();
+        eventData.icmpType.clear();
+        eventData.eventCount = 0;
+        eventData.synCount = 0;
+        eventData.lastTimeStamp = 0;
 
         record.queryEventProperty(L"SrcIpv4Addr", eventData.source);
         record.queryEventProperty(L"DstIpv4Addr", eventData.destination);
@@ -113,105 +461,25 @@ namespace FirewallEventMonitor
             record.queryEventProperty(L"DstIpv6Addr", eventData.destination);
         }
 
+        eventData.timeStamp = record.getTimeStamp().QuadPart;
         Timer::GetDateAndTime(record.getTimeStamp(), &eventData.date, &eventData.time);
 
         {
             std::wstring direction;
             record.queryEventProperty(L"Direction", direction);
-            if (direction.empty())
-            {
-                wprintf(L"Warning: Direction empty.\n");
-            }
-            else
-            {
-                // Translate Direction for certain values.
-                int i = std::stoi(direction);
-                switch (i)
-                {
-                case 0: eventData.direction = L"Outbound"; break;
-                case 1: eventData.direction = L"Inbound"; break;
-                default: wprintf(L"Warning: Direction %i did not match expected values.\n", i);
-                }
-            }
-        }
+            TranslateDirection(direction, eventData.direction);
 
-        {
             std::wstring ruleType;
             record.queryEventProperty(L"RuleType", ruleType);
-            if (ruleType.empty())
-            {
-                wprintf(L"Warning: RuleType empty.\n");
-            }
-            else
-            {
-                // Translate Rule Type for certain values.
-                int i = std::stoi(ruleType);
-                switch (i)
-                {
-                case 1: eventData.ruleType = L"Allow"; break;
-                case 2: eventData.ruleType = L"Deny"; break;
-                default: wprintf(L"Warning: RuleType %i did not match expected values.\n", i);
-                }
-            }
-        }
+            TranslateRuleType(ruleType, eventData.ruleType);
 
-        {
             std::wstring protocol;
             record.queryEventProperty(L"IpProtocol", protocol);
-            if (protocol.empty())
-            {
-                wprintf(L"Warning: IpProtocol empty.\n");
-            }
-            else
-            {
-                // Translate Protocol for certain values.
-                int i = std::stoi(protocol);
-                switch (i)
-                {
-                case 0: eventData.protocol = L"HOPOPT"; break;
-                case 1: eventData.protocol = L"ICMPv4"; break;
-                case 2: eventData.protocol = L"IGMP"; break;
-                case 6: eventData.protocol = L"TCP"; break;
-                case 17: eventData.protocol = L"UDP"; break;
-                case 41: eventData.protocol = L"IPv6"; break;
-                case 43: eventData.protocol = L"IPv6Route"; break;
-                case 44: eventData.protocol = L"IPv6Frag"; break;
-                case 47: eventData.protocol = L"GRE"; break;
-                case 58: eventData.protocol = L"ICMPv6"; break;
-                case 59: eventData.protocol = L"IPv6NoNxt"; break;
-                case 60: eventData.protocol = L"IPv6Opts"; break;
-                case 256: eventData.protocol = L"ANY"; break;
-                default: wprintf(L"Warning: IpProtocol %i did not match expected values.\n", i);
-                }
-            }
-        }
+            TranslateProtocol(protocol, eventData.protocol);
 
-        {
             std::wstring icmpType;
             record.queryEventProperty(L"IcmpType", icmpType);
-            // IcmpType not always present
-            if (!icmpType.empty())
-            {
-                // Translate ICMP Type for certain values.
-                int i = std::stoi(icmpType);
-                switch (i)
-                {
-                case 0: eventData.icmpType = L"V4EchoReply"; break;
-                case 5: eventData.icmpType = L"V4Redirect"; break;
-                case 8: eventData.icmpType = L"V4EchoRequest"; break;
-                case 9: eventData.icmpType = L"V4RouterAdvert"; break;
-                case 10: eventData.icmpType = L"V4RouterSolicit"; break;
-                case 13: eventData.icmpType = L"V4TimestampRequest"; break;
-                case 14: eventData.icmpType = L"V4TimestampReply"; break;
-                case 128: eventData.icmpType = L"V6EchoRequest"; break;
-                case 129: eventData.icmpType = L"V6EchoReply"; break;
-                case 133: eventData.icmpType = L"V6RouterSolicit"; break;
-                case 134: eventData.icmpType = L"V6RouterAdvert"; break;
-                case 135: eventData.icmpType = L"V6NeighborSolicit"; break;
-                case 136: eventData.icmpType = L"V6NeighborAdvert"; break;
-                default: wprintf(L"Warning: IcmpType %i did not match expected values.\n", i);
-                }
-            }
+            TranslateIcmpType(icmpType, eventData.icmpType);
         }
 
         {
@@ -234,85 +502,182 @@ namespace FirewallEventMonitor
         record.queryEventProperty(L"LayerId", eventData.layerId);
         record.queryEventProperty(L"GroupId", eventData.groupId);
         record.queryEventProperty(L"GftFlags", eventData.gftFlags);
-
-        return eventData;
     }
 
-    void FirewallEtwTraceCallback::OutputToConsole(
-        const VfpEventData& eventData)
+    void FirewallEtwTraceCallback::TranslateDirection(
+        const std::wstring& value,
+        _Inout_ std::wstring& direction)
     {
-        OutputToStream(eventData, stdout);
+        if (value.empty())
+        {
+            wprintf(L"Warning: Direction empty.\n");
+            return;
+        }
+
+        int i = std::stoi(value);
+        switch (i)
+        {
+        case 0: direction = L"Outbound"; break;
+        case 1: direction = L"Inbound"; break;
+        default: wprintf(L"Warning: Direction %i did not match expected values.\n", i);
+        }
     }
 
-    void FirewallEtwTraceCallback::OutputToFile(
-        const VfpEventData& eventData)
+    void FirewallEtwTraceCallback::TranslateRuleType(
+        const std::wstring& value,
+        _Inout_ std::wstring& ruleType)
     {
-        FILE *logFile = m_FileLogger->GetLogFile();
-
-        if (logFile == NULL)
+        if (value.empty())
         {
-            wprintf(L"Warning: Unable to log to null file.\n");
+            wprintf(L"Warning: RuleType empty.\n");
             return;
         }
 
-        OutputToStream(eventData, logFile);
+        int i = std::stoi(value);
+        switch (i)
+        {
+        case 1: ruleType = L"Allow"; break;
+        case 2: ruleType = L"Deny"; break;
+        default: wprintf(L"Warning: RuleType %i did not match expected values.\n", i);
+        }
     }
 
-    void FirewallEtwTraceCallback::OutputToStream(
-        const VfpEventData& eventData,
-        _In_ FILE *stream)
+    void FirewallEtwTraceCallback::TranslateProtocol(
+        const std::wstring& value,
+        _Inout_ std::wstring& protocol)
     {
-        // Header
-        fwprintf(stream, L"[%ls %ls] %ls %ls rule status = %ls \n",
-            eventData.date.c_str(),
-            eventData.time.c_str(),
-            eventData.direction.c_str(),
-            eventData.ruleType.c_str(),
-            eventData.status.c_str());
-
-        // Port
-        fwprintf(stream, L"  port {id = %ls, portName = %ls, portFriendlyName = %ls} \n",
-            eventData.portId.c_str(),
-            eventData.portName.c_str(),
-            eventData.portFriendlyName.c_str());
+        if (value.empty())
+        {
+            wprintf(L"Warning: IpProtocol empty.\n");
+            return;
+        }
 
-        // Flow
-        fwprintf(stream, L"  flow {src = %ls, dst = %ls, protocol = %ls",
-            eventData.source.c_str(),
-            eventData.destination.c_str(),
-            eventData.protocol.c_str());
+        int i = std::stoi(value);
+        switch (i)
+        {
+        case 0: protocol = L"HOPOPT"; break;
+        case 1: protocol = L"ICMPv4"; break;
+        case 2: protocol = L"IGMP"; break;
+        case 6: protocol = L"TCP"; break;
+        case 17: protocol = L"UDP"; break;
+        case 41: protocol = L"IPv6"; break;
+        case 43: protocol = L"IPv6Route"; break;
+        case 44: protocol = L"IPv6Frag"; break;
+        case 47: protocol = L"GRE"; break;
+        case 58: protocol = L"ICMPv6"; break;
+        case 59: protocol = L"IPv6NoNxt"; break;
+        case 60: protocol = L"IPv6Opts"; break;
+        case 256: protocol = L"ANY"; break;
+        default: wprintf(L"Warning: IpProtocol %i did not match expected values.\n", i);
+        }
+    }
 
-        if (!eventData.sourcePort.empty())
+    void FirewallEtwTraceCallback::TranslateIcmpType(
+        const std::wstring& value,
+        _Inout_ std::wstring& icmpType)
+    {
+        // IcmpType not always present
+        if (value.empty())
         {
-            fwprintf(stream, L", srcPort = %ls",
-                eventData.sourcePort.c_str());
+            return;
         }
 
-        if (!eventData.destinationPort.empty())
+        int i = std::stoi(value);
+        switch (i)
         {
-            fwprintf(stream, L", dstPort = %ls",
-                eventData.destinationPort.c_str());
+        case 0: icmpType = L"V4EchoReply"; break;
+        case 5: icmpType = L"V4Redirect"; break;
+        case 8: icmpType = L"V4EchoRequest"; break;
+        case 9: icmpType = L"V4RouterAdvert"; break;
+        case 10: icmpType = L"V4RouterSolicit"; break;
+        case 13: icmpType = L"V4TimestampRequest"; break;
+        case 14: icmpType = L"V4TimestampReply"; break;
+        case 128: icmpType = L"V6EchoRequest"; break;
+        case 129: icmpType = L"V6EchoReply"; break;
+        case 133: icmpType = L"V6RouterSolicit"; break;
+        case 134: icmpType = L"V6RouterAdvert"; break;
+        case 135: icmpType = L"V6NeighborSolicit"; break;
+        case 136: icmpType = L"V6NeighborAdvert"; break;
+        default: wprintf(L"Warning: IcmpType %i did not match expected values.\n", i);
         }
+    }
 
-        if (!eventData.icmpType.empty())
+    void FirewallEtwTraceCallback::OutputAlerts()
+    {
+        NTL_TRACE_SCOPE("OutputAlerts");
+        m_FormatBuffer.clear();
+        for (const auto& alert : m_Alerts)
         {
-            fwprintf(stream, L", icmp type = %ls",
-                eventData.icmpType.c_str());
+            BurstDetector::FormatAlert(alert, m_FormatBuffer);
         }
+        m_Alerts.clear();
+
+        // Printed whatever the outputs, so operators see them among the events.
+        WriteConsoleUtf8(m_FormatBuffer);
 
-        if (!eventData.isTcpSyn.empty())
+        if (m_AlertLogger)
         {
-            fwprintf(stream, L", isTcpSyn = %ls",
-                eventData.isTcpSyn.c_str());
+            m_AlertLogger->Write(m_FormatBuffer.data(), m_FormatBuffer.size());
         }
+    }
 
-        fwprintf(stream, L"} \n");
+    void FirewallEtwTraceCallback::OutputToConsole(
+        const Utf8EventData& eventData)
+    {
+        NTL_TRACE_SCOPE("OutputToConsole");
+        m_FormatBuffer.clear();
+        EventFormatter::FormatText(eventData, m_FormatBuffer);
+        WriteConsoleUtf8(m_FormatBuffer);
+    }
 
-        // Rule
-        fwprintf(stream, L"  rule {id = %ls, layer = %ls, group = %ls, gftFlags = %ls} \n\n",
-            eventData.ruleId.c_str(),
-            eventData.layerId.c_str(),
-            eventData.groupId.c_str(),
-            eventData.gftFlags.c_str());
+    void FirewallEtwTraceCallback::OutputToFile(
+        const Utf8EventData& eventData)
+    {
+        NTL_TRACE_SCOPE("OutputToFile");
+        OutputFormatted(eventData, EventFormatter::FormatText, *m_FileLogger);
+    }
+
+    void FirewallEtwTraceCallback::OutputToBinaryFile(
+        const VfpEventData& eventData)
+    {
+        NTL_TRACE_SCOPE("OutputToBinaryFile");
+        m_BinaryLogger->WriteEvent(eventData);
+    }
+
+    void FirewallEtwTraceCallback::OutputToJsonFile(
+        const Utf8EventData& eventData)
+    {
+        NTL_TRACE_SCOPE("OutputToJsonFile");
+        OutputFormatted(eventData, EventFormatter::FormatJson, *m_JsonLogger);
+    }
+
+    void FirewallEtwTraceCallback::OutputToCsvFile(
+        const Utf8EventData& eventData)
+    {
+        NTL_TRACE_SCOPE("OutputToCsvFile");
+        OutputFormatted(eventData, EventFormatter::FormatCsv, *m_CsvLogger);
+    }
+
+    void FirewallEtwTraceCallback::OutputToSegmentFile(
+        const VfpEventData& eventData)
+    {
+        NTL_TRACE_SCOPE("OutputToSegmentFile");
+        m_SegmentWriter->WriteEvent(eventData);
+    }
+
+    void FirewallEtwTraceCallback::OutputFormatted(
+        const Utf8EventData& eventData,
+        FormatFunction format,
+        FileLogger& logger)
+    {
+        if (logger.GetLogFile() == NULL)
+        {
+            wprintf(L"Warning: Unable to log to null file.\n");
+            return;
+        }
+
+        m_FormatBuffer.clear();
+        format(eventData, m_FormatBuffer);
+        logger.Write(m_FormatBuffer.data(), m_FormatBuffer.size());
     }
 }
\ No newline at end of file
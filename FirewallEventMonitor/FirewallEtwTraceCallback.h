@@ -16,37 +16,57 @@
 #include "EventCounter.h"
 #include "UserInput.h"
 #include "FileLogger.h"
+#include "BinaryLogger.h"
+#include "SegmentWriter.h"
+#include "FlowTable.h"
+#include "RuleHitCounter.h"
+#include "TopTalkers.h"
+#include "DistinctCounter.h"
+#include "EventKeys.h"
+#include "EventPredicate.h"
+#include "RateHistory.h"
+#include "LatencyMonitor.h"
+#include "BurstDetector.h"
+#include "DecodePipeline.h"
+#include "SelfMetrics.h"
+#include "VfpEventData.h"
 
 namespace FirewallEventMonitor
 {
     class FirewallCaptureSession;
 
-    // Collection of Firewall event data.
-    struct VfpEventData
+    // The session's components a callback hands events to. timer and eventCounter are required;
+    // any other member left null turns its stage or output off.
+    struct CallbackDependencies
     {
     public:
-        std::wstring date;
-        std::wstring time;
-        std::wstring direction;
-        std::wstring ruleType;
-        std::wstring status;
-        // Port
-        std::wstring portId;
-        std::wstring portName;
-        std::wstring portFriendlyName;
-        // Flow
-        std::wstring source;
-        std::wstring destination;
-        std::wstring protocol;
-        std::wstring sourcePort;
-        std::wstring destinationPort;
-        std::wstring icmpType;
-        std::wstring isTcpSyn;
-        // Rule
-        std::wstring ruleId;
-        std::wstring layerId;
-        std::wstring groupId;
-        std::wstring gftFlags;
+        std::shared_ptr<FileLogger> fileLogger;
+        std::shared_ptr<BinaryLogger> binaryLogger;
+        std::shared_ptr<FileLogger> jsonLogger;
+        std::shared_ptr<FileLogger> csvLogger;
+        std::shared_ptr<Timer> timer;
+        std::shared_ptr<EventCounter> eventCounter;
+        // Set when aggregating flows.
+        std::shared_ptr<FlowTable> flowTable;
+        // Set when counting rule hits.
+        std::shared_ptr<RuleHitCounter> ruleHitCounter;
+        // Set when tracking top talkers.
+        std::shared_ptr<TopTalkers> topTalkers;
+        // Set when counting distinct sources and ports.
+        std::shared_ptr<DistinctCounter> distinctCounter;
+        // Set when keeping rate history.
+        std::shared_ptr<RateHistory> rateHistory;
+        // Set when timing the callback.
+        std::shared_ptr<LatencyMonitor> latencyMonitor;
+        // Set when detecting deny bursts.
+        std::shared_ptr<BurstDetector> burstDetector;
+        std::shared_ptr<FileLogger> alertLogger;
+        // Set when writing segments.
+        std::shared_ptr<SegmentWriter> segmentWriter;
+        // Set when decoding on workers, when the callback only copies records into it.
+        std::shared_ptr<DecodePipeline> decodePipeline;
+        // Set when exporting metrics.
+        std::shared_ptr<SelfMetrics> selfMetrics;
     };
 
     // Callback function for capturing events.
@@ -56,29 +76,153 @@ namespace FirewallEventMonitor
         FirewallEtwTraceCallback(
             const std::weak_ptr<FirewallCaptureSession> eventWatcher,
             const Parameters &parameters,
-            const std::shared_ptr<FileLogger> fileLogger,
-            const std::shared_ptr<Timer> timer,
-            const std::shared_ptr<EventCounter> eventCounter);
+            const CallbackDependencies& dependencies);
 
         bool operator()(const PEVENT_RECORD pEventRecord);
 
+        // Counts the event as Received in SelfMetrics, then returns false, counting the drop,
+        // once -EventThrottle or -TimeLimit refuses events. Every event passes here exactly once:
+        // operator() and ProcessEventRecord call it themselves; sources call it before handing
+        // an event to ProcessAdmittedEvent or ProcessEventData.
+        bool AdmitEvent() const;
+
+        // operator() for a record AdmitEvent has admitted already, as when replaying a saved capture.
+        bool ProcessAdmittedEvent(const PEVENT_RECORD pEventRecord);
+
         bool ProcessEventRecord(const ntl::EtwRecord& record);
 
-        VfpEventData CollectEventData(const ntl::EtwRecord& record);
+        // Filters, counts and writes an admitted event that was decoded elsewhere, as when
+        // replaying a binary log.
+        bool ProcessEventData(VfpEventData& eventData);
+
+        // The stages a DecodePipeline runs on its workers: decodes the record and applies the
+        // filters. Returns false for an event filtered out. Safe to call from many threads at once.
+        bool DecodeEventRecord(
+            EVENT_RECORD& eventRecord,
+            _Inout_ VfpEventData& eventData) const;
+
+        // The stages a DecodePipeline runs in delivery order: counts and writes a decoded event
+        // that passed the filters.
+        void ProcessDecodedEvent(VfpEventData& eventData);
+
+        // True for the VFP rule match events (IPv4, IPv6 and ICMP) that are collected.
+        static bool IsRuleMatchEvent(INT eventId);
+
+        // Decodes a rule match event. Keeps no state, so offline queries decode on many threads.
+        static VfpEventData CollectEventData(const ntl::EtwRecord& record);
+
+        // Decodes into an event that may hold an earlier one, overwriting every field. Its strings
+        // keep their memory, so decoding into the same event again and again stops allocating.
+        static void CollectEventData(
+            const ntl::EtwRecord& record,
+            _Inout_ VfpEventData& eventData);
+
+        // Translate the numbers VFP logs (as decoded by TDH) into names, leaving the name as it
+        // was and warning for a number not known.
+        static void TranslateDirection(
+            const std::wstring& value,
+            _Inout_ std::wstring& direction);
+
+        static void TranslateRuleType(
+            const std::wstring& value,
+            _Inout_ std::wstring& ruleType);
+
+        static void TranslateProtocol(
+            const std::wstring& value,
+            _Inout_ std::wstring& protocol);
+
+        // An empty value is no ICMP type, not a warning: only ICMP events have one.
+        static void TranslateIcmpType(
+            const std::wstring& value,
+            _Inout_ std::wstring& icmpType);
+
+        // Writes the event (or flow record) to every enabled output.
+        void OutputEventData(const VfpEventData& eventData);
 
-        void OutputToConsole(const VfpEventData& eventData);
+        void OutputToConsole(const Utf8EventData& eventData);
 
-        void OutputToFile(const VfpEventData& eventData);
+        void OutputToFile(const Utf8EventData& eventData);
+
+        void OutputToBinaryFile(const VfpEventData& eventData);
+
+        void OutputToJsonFile(const Utf8EventData& eventData);
+
+        void OutputToCsvFile(const Utf8EventData& eventData);
+
+        void OutputToSegmentFile(const VfpEventData& eventData);
+
+        // Prints and logs the alerts in m_Alerts, then clears them.
+        void OutputAlerts();
 
     private:
         std::weak_ptr<FirewallCaptureSession> m_EventWatcher;
         Parameters m_Parameters;
+        // Built from m_Parameters once, so matching never reaches the capture session.
+        EventPredicate m_Predicate;
         std::shared_ptr<FileLogger> m_FileLogger;
+        std::shared_ptr<BinaryLogger> m_BinaryLogger;
+        std::shared_ptr<FileLogger> m_JsonLogger;
+        std::shared_ptr<FileLogger> m_CsvLogger;
         std::shared_ptr<Timer> m_Timer;
         std::shared_ptr<EventCounter> m_EventCounter;
+        // Null unless aggregating flows.
+        std::shared_ptr<FlowTable> m_FlowTable;
+        // Null unless counting rule hits.
+        std::shared_ptr<RuleHitCounter> m_RuleHitCounter;
+        // Null unless tracking top talkers.
+        std::shared_ptr<TopTalkers> m_TopTalkers;
+        // Null unless counting distinct sources and ports.
+        std::shared_ptr<DistinctCounter> m_DistinctCounter;
+        // Null unless keeping rate history.
+        std::shared_ptr<RateHistory> m_RateHistory;
+        // Null unless timing the callback.
+        std::shared_ptr<LatencyMonitor> m_LatencyMonitor;
+        // Null unless detecting deny bursts.
+        std::shared_ptr<BurstDetector> m_BurstDetector;
+        std::shared_ptr<FileLogger> m_AlertLogger;
+        // Null unless writing segments.
+        std::shared_ptr<SegmentWriter> m_SegmentWriter;
+        // Null unless decoding on workers, when this callback only copies records into it.
+        std::shared_ptr<DecodePipeline> m_DecodePipeline;
+        // Null unless exporting metrics.
+        std::shared_ptr<SelfMetrics> m_SelfMetrics;
+        std::vector<BurstDetector::Alert> m_Alerts;
+        // Reused for every event to avoid per-event allocations.
+        Utf8EventData m_Utf8EventData;
+        std::string m_FormatBuffer;
+        // Parsed once per event for every live statistic.
+        EventKeys m_EventKeys;
+        // Each live event is parsed and decoded into these, so once they have grown to the
+        // largest event it allocates nothing.
+        ntl::EtwRecord m_EtwRecord;
+        VfpEventData m_EventData;
+
+        static const size_t FormatBufferReserveInBytes = 1024;
+
+        typedef void (*FormatFunction)(const Utf8EventData& eventData, std::string& buffer);
+
+        // False if the filters rule the event out.
+        bool MatchFilters(const VfpEventData& eventData) const;
+
+        // The stages of a rule match record, timed by a clock started before it was parsed.
+        bool ProcessRuleMatchRecord(
+            const ntl::EtwRecord& record,
+            LatencyMonitor::StageClock& clock);
+
+        // The stages after Collect, shared by live and replayed events.
+        bool ProcessCollectedEvent(
+            VfpEventData& eventData,
+            LatencyMonitor::StageClock& clock);
+
+        // The stages after Filter.
+        void ProcessFilteredEvent(
+            VfpEventData& eventData,
+            LatencyMonitor::StageClock& clock);
 
-        void OutputToStream(
-            const VfpEventData& eventData,
-            _In_ FILE *stream);
+        // Formats into the reusable buffer and hands the bytes to the logger, which batches the writes.
+        void OutputFormatted(
+            const Utf8EventData& eventData,
+            FormatFunction format,
+            FileLogger& logger);
     };
 }
\ No newline at end of file
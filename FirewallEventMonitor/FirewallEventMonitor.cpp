@@ -6,6 +6,11 @@
 #include <memory>
 
 #include "FirewallCaptureSession.h"
+#include "BinaryLogReader.h"
+#include "LogCompression.h"
+#include "SegmentQuery.h"
+#include "EtlQuery.h"
+#include "LogMerger.h"
 
 using namespace FirewallEventMonitor;
 
@@ -20,6 +25,40 @@ BOOL WINAPI CtrlCHandler(DWORD fdwCtrlType)
     return TRUE;
 }
 
+// Removes extension from the end of path. Returns false if path does not end with it.
+bool RemoveFileExtension(
+    _Inout_ std::wstring& path,
+    const std::wstring& extension)
+{
+    if (path.size() < extension.size() ||
+        !ntl::String::iordinal_equals(path.substr(path.size() - extension.size()), extension))
+    {
+        return false;
+    }
+
+    path.erase(path.size() - extension.size());
+    return true;
+}
+
+// FILETIME of hours ago, for -Last; 0 matches all times when hours is 0.
+LONGLONG GetMinimumTimeStamp(
+    unsigned long hours)
+{
+    if (hours == 0)
+    {
+        return 0;
+    }
+
+    // Event timestamps are FILETIMEs: 100ns ticks.
+    const LONGLONG ticksPerHour = 3600ll * 10000000ll;
+    FILETIME fileTime;
+    ::GetSystemTimeAsFileTime(&fileTime);
+    ULARGE_INTEGER now;
+    now.LowPart = fileTime.dwLowDateTime;
+    now.HighPart = fileTime.dwHighDateTime;
+    return static_cast<LONGLONG>(now.QuadPart) - (hours * ticksPerHour);
+}
+
 INT __cdecl wmain(
     INT argc,
     __in_ecount(argc) const wchar_t** argv
@@ -37,12 +76,101 @@ INT __cdecl wmain(
     }
 
     auto parameters = input.GetParameters();
+
+    // Convert a binary log to text instead of capturing.
+    if (!parameters.exportFilePath.empty())
+    {
+        // Keeps .bin in the name, so a text logger's retention does not take it for one of its own.
+        std::wstring textFilePath = parameters.exportFilePath;
+        RemoveFileExtension(textFilePath, CompressedFileExtension);
+        textFilePath.append(L".log");
+
+        unsigned long eventCount = BinaryLogReader::ExportToText(parameters.exportFilePath, textFilePath);
+        wprintf(L"Exported %lu events to %ls\n", eventCount, textFilePath.c_str());
+        return ERROR_SUCCESS;
+    }
+
+    // Decompress a compressed log instead of capturing.
+    if (!parameters.decompressFilePath.empty())
+    {
+        std::wstring filePath = parameters.decompressFilePath;
+        if (!RemoveFileExtension(filePath, CompressedFileExtension))
+        {
+            wprintf(L"Compressed log file name must end with %ls.\n", CompressedFileExtension);
+            return ERROR_INVALID_DATA;
+        }
+
+        unsigned long long byteCount = CompressedFileReader::DecompressFile(parameters.decompressFilePath, filePath);
+        wprintf(L"Decompressed %llu bytes to %ls\n", byteCount, filePath.c_str());
+        return ERROR_SUCCESS;
+    }
+
+    // Search segments instead of capturing.
+    if (!parameters.queryDirectory.empty())
+    {
+        EventPredicate predicate(parameters, GetMinimumTimeStamp(parameters.queryLastInHours));
+
+        SetConsoleOutputCP(CP_UTF8);
+
+        SegmentQuery query(predicate);
+        SegmentQueryResults results = query.Run(parameters.queryDirectory);
+        wprintf(L"Matched %llu of %llu events read. Skipped %llu of %llu segments by their footer.\n",
+            results.eventsMatched,
+            results.eventsScanned,
+            results.segmentsSkipped,
+            results.segmentsScanned);
+        return ERROR_SUCCESS;
+    }
+
+    // Search saved captures instead of capturing.
+    if (!parameters.inputFilePaths.empty())
+    {
+        EventPredicate predicate(parameters, GetMinimumTimeStamp(parameters.queryLastInHours));
+
+        SetConsoleOutputCP(CP_UTF8);
+
+        EtlQuery query(predicate, !parameters.unorderedOutput, parameters.queryThreads);
+        EtlQueryResults results = query.Run(parameters.inputFilePaths);
+        wprintf(L"Matched %llu of %llu events read from %llu captures (%llu unreadable). Workers stole %llu tasks.\n",
+            results.eventsMatched,
+            results.eventsScanned,
+            results.filesRead,
+            results.filesFailed,
+            results.tasksStolen);
+        return ERROR_SUCCESS;
+    }
+
+    // Merge the logs of several hosts instead of capturing.
+    if (!parameters.mergeInputs.empty())
+    {
+        EventPredicate predicate(parameters, 0);
+
+        SetConsoleOutputCP(CP_UTF8);
+
+        LogMerger merger(predicate);
+        LogMergeResults results = merger.Run(parameters.mergeInputs);
+        wprintf(L"Merged %llu of %llu events read from %llu hosts (%llu unreadable).\n",
+            results.eventsMerged,
+            results.eventsScanned,
+            results.inputsRead,
+            results.inputsFailed);
+        if (results.eventsOutOfOrder > 0)
+        {
+            wprintf(L"Warning: %llu events were earlier than events merged before them. Logs written with -Aggregate are in the order their flows expired.\n",
+                results.eventsOutOfOrder);
+        }
+        return ERROR_SUCCESS;
+    }
+
     auto captureSession = std::make_shared<FirewallCaptureSession>(parameters);
     captureSession->OpenSession();
 
     // CTRL+C handler to signal termination.
     SetConsoleCtrlHandler(CtrlCHandler, TRUE);
 
+    // Console output is written as UTF-8 bytes.
+    SetConsoleOutputCP(CP_UTF8);
+
     wprintf(L"Events will appear below. Press Ctrl + C to end the session...\n");
 
     while (captureSession->CaptureSessionRunning())
@@ -56,6 +184,15 @@ INT __cdecl wmain(
         // If logging to file, close log file an open a new one on an interval (1 hour).
         captureSession->LogFileIntervalCheck();
 
+        // If aggregating, write the flows that have timed out.
+        captureSession->FlowExpiryCheck();
+
+        // If decoding on workers, hand them the events that have waited too long for a full batch.
+        captureSession->DecodeBatchCheck();
+
+        // If keeping rate history, close the seconds that have passed.
+        captureSession->RateHistoryCheck();
+
         // Throttle the number of events recorded to prevent performance degredation during DDOS.
         if (captureSession->EventCountLimitPerEpocReached())
         {
@@ -0,0 +1,335 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "FlowTable.h"
+// ntl headers
+#include "ntlString.hpp"
+
+namespace FirewallEventMonitor
+{
+    bool IsTcpSyn(const std::wstring& isTcpSyn)
+    {
+        return !isTcpSyn.empty() &&
+            isTcpSyn.compare(L"0") != 0 &&
+            !ntl::String::iordinal_equals(isTcpSyn, L"false");
+    }
+
+    // Folds value into hash (see EventKeys::Hash).
+    unsigned long long CombineHash(
+        unsigned long long hash,
+        unsigned long long value)
+    {
+        EventKey key;
+        memcpy_s(key.bytes, sizeof(key.bytes), &hash, sizeof(hash));
+        memcpy_s(key.bytes + sizeof(hash), sizeof(key.bytes) - sizeof(hash), &value, sizeof(value));
+        return EventKeys::Hash(key);
+    }
+
+    FlowTable::FlowTable(
+        unsigned long idleTimeoutInSeconds,
+        unsigned long activeTimeoutInSeconds,
+        size_t maxFlows)
+        : m_IdleTimeout(idleTimeoutInSeconds * FileTimeTicksPerSecond),
+        m_ActiveTimeout(activeTimeoutInSeconds * FileTimeTicksPerSecond),
+        m_MaxFlows(maxFlows),
+        m_Slots(InitialSlotCount),
+        m_FlowCount(0)
+    {
+    }
+
+    void FlowTable::StartFlow(
+        _Inout_ VfpEventData& eventData)
+    {
+        eventData.eventCount = 1;
+        eventData.synCount = IsTcpSyn(eventData.isTcpSyn) ? 1 : 0;
+        eventData.lastTimeStamp = eventData.timeStamp;
+    }
+
+    bool FlowTable::AddEvent(
+        const VfpEventData& eventData)
+    {
+        m_EventKeys.Parse(eventData);
+        return AddEvent(eventData, m_EventKeys);
+    }
+
+    bool FlowTable::AddEvent(
+        const VfpEventData& eventData,
+        const EventKeys& eventKeys)
+    {
+        ntl::AutoReleaseHotLock lockScoped(m_Lock);
+
+        unsigned long long hash;
+        if (!BuildKey(eventData, eventKeys, &hash))
+        {
+            return false;
+        }
+
+        size_t mask = m_Slots.size() - 1;
+        for (size_t slot = static_cast<size_t>(hash) & mask; m_Slots[slot].flow != 0; slot = (slot + 1) & mask)
+        {
+            if (m_Slots[slot].hash != hash)
+            {
+                continue;
+            }
+
+            Flow& flow = m_Flows[m_Slots[slot].flow - 1];
+            if (memcmp(&flow.key, &m_Key, sizeof(m_Key)) != 0)
+            {
+                continue;
+            }
+
+            ++flow.eventCount;
+            if (IsTcpSyn(eventData.isTcpSyn))
+            {
+                ++flow.synCount;
+            }
+            // ETW can deliver events from different CPUs slightly out of order.
+            if (eventData.timeStamp > flow.lastTimeStamp)
+            {
+                flow.lastTimeStamp = eventData.timeStamp;
+            }
+            return true;
+        }
+
+        if (m_Flows.size() >= m_MaxFlows)
+        {
+            return false;
+        }
+
+        // Keep the load factor at or below one half so probe runs stay short.
+        if ((m_Flows.size() + 1) * 2 > m_Slots.size())
+        {
+            Grow();
+        }
+
+        Flow flow;
+        flow.key = m_Key;
+        flow.hash = hash;
+        flow.eventCount = 1;
+        flow.synCount = IsTcpSyn(eventData.isTcpSyn) ? 1 : 0;
+        flow.firstTimeStamp = eventData.timeStamp;
+        flow.lastTimeStamp = eventData.timeStamp;
+        m_Flows.push_back(flow);
+        m_Records.push_back(eventData);
+        InsertSlot(hash, m_Flows.size() - 1);
+        m_FlowCount.store(m_Flows.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    size_t FlowTable::ExpireFlows(
+        LONGLONG now,
+        _Inout_ std::vector<VfpEventData>& expired)
+    {
+        ntl::AutoReleaseColdLock lockScoped(m_Lock);
+
+        size_t expiredCount = 0;
+        // Walk backwards: RemoveFlow moves the last flow, which has already been checked, into the hole.
+        for (size_t i = m_Flows.size(); i > 0; --i)
+        {
+            const Flow& flow = m_Flows[i - 1];
+            bool idle = m_IdleTimeout > 0 && now - flow.lastTimeStamp >= m_IdleTimeout;
+            bool active = m_ActiveTimeout > 0 && now - flow.firstTimeStamp >= m_ActiveTimeout;
+            if (idle || active)
+            {
+                MoveRecord(i - 1, expired);
+                RemoveFlow(i - 1);
+                ++expiredCount;
+            }
+        }
+
+        return expiredCount;
+    }
+
+    size_t FlowTable::ExpireAllFlows(
+        _Inout_ std::vector<VfpEventData>& expired)
+    {
+        ntl::AutoReleaseColdLock lockScoped(m_Lock);
+
+        size_t expiredCount = m_Flows.size();
+        for (size_t i = 0; i < m_Flows.size(); ++i)
+        {
+            MoveRecord(i, expired);
+        }
+
+        m_Flows.clear();
+        m_Records.clear();
+        m_FlowCount.store(0, std::memory_order_relaxed);
+        for (auto& slot : m_Slots)
+        {
+            slot.flow = 0;
+        }
+
+        return expiredCount;
+    }
+
+    size_t FlowTable::GetFlowCount() const
+    {
+        return m_FlowCount.load(std::memory_order_relaxed);
+    }
+
+    bool FlowTable::BuildKey(
+        const VfpEventData& eventData,
+        const EventKeys& eventKeys,
+        _Out_ unsigned long long* hash)
+    {
+        if (!eventKeys.parsed[EventKeys::SourceAddress] ||
+            !eventKeys.parsed[EventKeys::DestinationAddress] ||
+            !eventKeys.parsed[EventKeys::RuleId])
+        {
+            return false;
+        }
+
+        memset(&m_Key, 0, sizeof(m_Key));
+        m_Key.source = eventKeys.keys[EventKeys::SourceAddress];
+        m_Key.destination = eventKeys.keys[EventKeys::DestinationAddress];
+        m_Key.ruleId = eventKeys.keys[EventKeys::RuleId];
+        if (!PackName(eventData.protocol, &m_Key.protocol) ||
+            !ParseOptionalNumber(eventData.portId, &m_Key.portId) ||
+            !ParseOptionalNumber(eventData.sourcePort, &m_Key.sourcePort) ||
+            !ParseOptionalNumber(eventData.destinationPort, &m_Key.destinationPort))
+        {
+            return false;
+        }
+        m_Key.direction = eventData.direction.empty() ? 0 : static_cast<unsigned char>(eventData.direction[0]);
+        m_Key.ruleType = eventData.ruleType.empty() ? 0 : static_cast<unsigned char>(eventData.ruleType[0]);
+
+        // The address and rule hashes are already mixed; the short fields are folded in once.
+        unsigned long long value = EventKeys::Hash(m_Key.protocol);
+        value ^= m_Key.portId;
+        value ^= m_Key.sourcePort << 16;
+        value ^= m_Key.destinationPort << 32;
+        value ^= static_cast<unsigned long long>(m_Key.direction) << 48;
+        value ^= static_cast<unsigned long long>(m_Key.ruleType) << 56;
+        *hash = CombineHash(
+            eventKeys.hashes[EventKeys::SourceAddress] ^ eventKeys.hashes[EventKeys::RuleId],
+            eventKeys.hashes[EventKeys::DestinationAddress] ^ value);
+        return true;
+    }
+
+    bool FlowTable::ParseOptionalNumber(
+        const std::wstring& number,
+        _Out_ unsigned long long* value)
+    {
+        *value = 0;
+        if (number.empty())
+        {
+            return true;
+        }
+
+        EventKey key;
+        if (!EventKeys::ParseNumber(number, &key))
+        {
+            return false;
+        }
+
+        memcpy_s(value, sizeof(*value), key.bytes, sizeof(*value));
+        *value += 1;
+        return true;
+    }
+
+    bool FlowTable::PackName(
+        const std::wstring& name,
+        _Out_ EventKey* key)
+    {
+        memset(key->bytes, 0, sizeof(key->bytes));
+        if (name.size() > sizeof(key->bytes))
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < name.size(); ++i)
+        {
+            if (name[i] == L'\0' || name[i] > 0x7F)
+            {
+                return false;
+            }
+            key->bytes[i] = static_cast<unsigned char>(name[i]);
+        }
+        return true;
+    }
+
+    void FlowTable::MoveRecord(
+        size_t flowIndex,
+        _Inout_ std::vector<VfpEventData>& expired)
+    {
+        const Flow& flow = m_Flows[flowIndex];
+        expired.push_back(std::move(m_Records[flowIndex]));
+        VfpEventData& record = expired.back();
+        record.eventCount = flow.eventCount;
+        record.synCount = flow.synCount;
+        record.lastTimeStamp = flow.lastTimeStamp;
+    }
+
+    size_t FlowTable::FindSlot(
+        unsigned long long hash,
+        size_t flowIndex) const
+    {
+        size_t mask = m_Slots.size() - 1;
+        size_t slot = static_cast<size_t>(hash) & mask;
+        while (m_Slots[slot].flow != flowIndex + 1)
+        {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void FlowTable::InsertSlot(
+        unsigned long long hash,
+        size_t flowIndex)
+    {
+        size_t mask = m_Slots.size() - 1;
+        size_t slot = static_cast<size_t>(hash) & mask;
+        while (m_Slots[slot].flow != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+
+        m_Slots[slot].hash = hash;
+        m_Slots[slot].flow = flowIndex + 1;
+    }
+
+    void FlowTable::RemoveSlot(
+        size_t slot)
+    {
+        size_t mask = m_Slots.size() - 1;
+        size_t hole = slot;
+        for (size_t next = (hole + 1) & mask; m_Slots[next].flow != 0; next = (next + 1) & mask)
+        {
+            // An entry may fill the hole only if its home slot is not between the hole and itself.
+            size_t home = static_cast<size_t>(m_Slots[next].hash) & mask;
+            if (((next - home) & mask) >= ((next - hole) & mask))
+            {
+                m_Slots[hole] = m_Slots[next];
+                hole = next;
+            }
+        }
+
+        m_Slots[hole].flow = 0;
+    }
+
+    void FlowTable::RemoveFlow(
+        size_t flowIndex)
+    {
+        RemoveSlot(FindSlot(m_Flows[flowIndex].hash, flowIndex));
+
+        size_t lastIndex = m_Flows.size() - 1;
+        if (flowIndex != lastIndex)
+        {
+            m_Slots[FindSlot(m_Flows[lastIndex].hash, lastIndex)].flow = flowIndex + 1;
+            m_Flows[flowIndex] = m_Flows[lastIndex];
+            m_Records[flowIndex] = std::move(m_Records[lastIndex]);
+        }
+        m_Flows.pop_back();
+        m_Records.pop_back();
+        m_FlowCount.store(m_Flows.size(), std::memory_order_relaxed);
+    }
+
+    void FlowTable::Grow()
+    {
+        m_Slots.assign(m_Slots.size() * 2, Slot{ 0, 0 });
+        for (size_t i = 0; i < m_Flows.size(); ++i)
+        {
+            InsertSlot(m_Flows[i].hash, i);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,164 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "EventKeys.h"
+#include "VfpEventData.h"
+// ntl headers
+#include "ntlLocks.hpp"
+
+namespace FirewallEventMonitor
+{
+    // Aggregates filtered events into NetFlow-style flow records.
+    //
+    // Events with the same direction, rule type, rule, port, addresses, protocol and ports
+    // belong to one flow. The first event of a flow is kept as its record; later events only
+    // update the count, SYN count and last timestamp (see VfpEventData::eventCount).
+    //
+    // Flows are keyed on the binary fields EventKeys parses, plus the source port and the
+    // protocol, direction and rule type names packed into bytes, and hashed from the key hashes
+    // EventKeys already computed. They live in a dense vector of keys and counts indexed by an
+    // open-addressing (linear probing) table of 16 byte slots; the first events themselves are
+    // kept apart, only touched when a flow starts or expires.
+    //
+    // Events are added on the event path under the hot side of an ntl::AsymmetricLock, which
+    // takes no interlocked instruction; the main loop's expiry takes the cold side.
+    class FlowTable
+    {
+    public:
+        FlowTable(
+            unsigned long idleTimeoutInSeconds,
+            unsigned long activeTimeoutInSeconds,
+            size_t maxFlows = DefaultMaxFlows);
+
+        // Counts the event against its flow, starting a new flow if needed. eventKeys are the
+        // event's parsed keys. Called by one thread at a time.
+        // Returns false if the event starts a new flow but the table is full, or if its key
+        // fields do not parse; either way the caller writes it as a flow of one.
+        bool AddEvent(
+            const VfpEventData& eventData,
+            const EventKeys& eventKeys);
+
+        bool AddEvent(const VfpEventData& eventData);
+
+        // Moves flows out of the table that have seen no event for the idle timeout, or that
+        // started more than the active timeout ago. now is a FILETIME, as is VfpEventData::timeStamp.
+        // Returns the number of flows appended to expired.
+        size_t ExpireFlows(
+            LONGLONG now,
+            _Inout_ std::vector<VfpEventData>& expired);
+
+        // Moves every flow out of the table.
+        size_t ExpireAllFlows(_Inout_ std::vector<VfpEventData>& expired);
+
+        // Read without the lock, so it can be polled while events are added.
+        size_t GetFlowCount() const;
+
+        // Fills the flow fields of a single event so it can be emitted as a flow of one.
+        static void StartFlow(_Inout_ VfpEventData& eventData);
+
+        // Constants
+        static const size_t DefaultMaxFlows = 65536;
+        static const size_t InitialSlotCount = 1024; // Power of two.
+        static const LONGLONG FileTimeTicksPerSecond = 10000000; // 100 ns ticks.
+
+        FlowTable(FlowTable const&) = delete;
+        FlowTable& operator=(FlowTable const&) = delete;
+
+    private:
+        struct Slot
+        {
+            unsigned long long hash;
+            // Index into m_Flows plus one; 0 marks an empty slot.
+            size_t flow;
+        };
+
+        // Zero filled before it is set, so keys compare with memcmp.
+        struct FlowKey
+        {
+            EventKey source;
+            EventKey destination;
+            EventKey ruleId;
+            // Up to 16 ASCII characters (see PackName).
+            EventKey protocol;
+            // Numbers plus one; 0 when the event has no such field.
+            unsigned long long portId;
+            unsigned long long sourcePort;
+            unsigned long long destinationPort;
+            // First character of the name, or 0 (see FirewallEtwTraceCallback::TranslateDirection).
+            unsigned char direction;
+            unsigned char ruleType;
+            unsigned char reserved[6];
+        };
+        static_assert(sizeof(FlowKey) == 96, "FlowKey has no padding left unset");
+
+        struct Flow
+        {
+            FlowKey key;
+            unsigned long long hash;
+            unsigned long long eventCount;
+            unsigned long long synCount;
+            LONGLONG firstTimeStamp;
+            LONGLONG lastTimeStamp;
+        };
+
+        ntl::AsymmetricLock m_Lock;
+        LONGLONG m_IdleTimeout = 0;
+        LONGLONG m_ActiveTimeout = 0;
+        size_t m_MaxFlows = 0;
+        // Size is a power of two, kept at least twice the number of flows.
+        std::vector<Slot> m_Slots;
+        std::vector<Flow> m_Flows;
+        // The first event of each flow, in the same order as m_Flows.
+        std::vector<VfpEventData> m_Records;
+        // m_Flows.size(), kept to be read without the lock.
+        std::atomic<size_t> m_FlowCount;
+        // Reused to build the key of each event.
+        FlowKey m_Key;
+        EventKeys m_EventKeys;
+
+        // Fills m_Key from the event and returns its hash, or returns false if a key field does not parse.
+        bool BuildKey(
+            const VfpEventData& eventData,
+            const EventKeys& eventKeys,
+            _Out_ unsigned long long* hash);
+
+        // Parses an optional number into value plus one, 0 if empty.
+        static bool ParseOptionalNumber(
+            const std::wstring& number,
+            _Out_ unsigned long long* value);
+
+        // Copies an ASCII name of up to 16 characters into a key.
+        static bool PackName(
+            const std::wstring& name,
+            _Out_ EventKey* key);
+
+        // Moves the flow's first event, with its counts, to the end of expired.
+        void MoveRecord(
+            size_t flowIndex,
+            _Inout_ std::vector<VfpEventData>& expired);
+
+        // Returns the slot holding flowIndex + 1.
+        size_t FindSlot(unsigned long long hash, size_t flowIndex) const;
+
+        void InsertSlot(unsigned long long hash, size_t flowIndex);
+
+        // Empties the slot, shifting later entries of the probe run back so lookups
+        // never stop early at a hole (no tombstones).
+        void RemoveSlot(size_t slot);
+
+        // Removes the flow, filling its place with the last flow.
+        void RemoveFlow(size_t flowIndex);
+
+        // Doubles the slot array and reinserts every flow.
+        void Grow();
+    };
+}
\ No newline at end of file
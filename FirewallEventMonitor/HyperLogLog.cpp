@@ -0,0 +1,91 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "HyperLogLog.h"
+// c++ headers
+#include <algorithm>
+#include <cmath>
+
+namespace FirewallEventMonitor
+{
+    HyperLogLog::HyperLogLog(unsigned int precision)
+        : m_Precision(precision)
+    {
+        if (precision < MinPrecision ||
+            precision > MaxPrecision)
+        {
+            throw std::exception("HyperLogLog precision must be between 4 and 16");
+        }
+
+        m_Registers.resize(static_cast<size_t>(1) << precision);
+    }
+
+    double HyperLogLog::Estimate() const
+    {
+        const double registerCount = static_cast<double>(m_Registers.size());
+
+        double alpha;
+        switch (m_Registers.size())
+        {
+        case 16:
+            alpha = 0.673;
+            break;
+        case 32:
+            alpha = 0.697;
+            break;
+        case 64:
+            alpha = 0.709;
+            break;
+        default:
+            alpha = 0.7213 / (1.0 + (1.079 / registerCount));
+            break;
+        }
+
+        double sum = 0.0;
+        size_t zeroRegisters = 0;
+        for (const auto value : m_Registers)
+        {
+            sum += std::ldexp(1.0, -static_cast<int>(value));
+            if (value == 0)
+            {
+                ++zeroRegisters;
+            }
+        }
+
+        double estimate = alpha * registerCount * registerCount / sum;
+
+        // Small cardinalities leave registers empty; counting them is more accurate.
+        // With 64-bit hashes no large-range correction is needed.
+        if (estimate <= 2.5 * registerCount &&
+            zeroRegisters > 0)
+        {
+            estimate = registerCount * std::log(registerCount / static_cast<double>(zeroRegisters));
+        }
+
+        return estimate;
+    }
+
+    void HyperLogLog::Merge(
+        const HyperLogLog& other)
+    {
+        if (other.m_Precision != m_Precision)
+        {
+            throw std::exception("HyperLogLog sketches of different precision cannot be merged");
+        }
+
+        for (size_t i = 0; i < m_Registers.size(); ++i)
+        {
+            m_Registers[i] = (std::max)(m_Registers[i], other.m_Registers[i]);
+        }
+    }
+
+    void HyperLogLog::Reset()
+    {
+        std::fill(m_Registers.begin(), m_Registers.end(), static_cast<unsigned char>(0));
+    }
+
+    unsigned int HyperLogLog::GetPrecision() const
+    {
+        return m_Precision;
+    }
+}
\ No newline at end of file
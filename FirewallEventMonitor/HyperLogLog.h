@@ -0,0 +1,59 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+#include <intrin.h>
+// c++ headers
+#include <vector>
+
+namespace FirewallEventMonitor
+{
+    // Distinct-count estimator (Flajolet, Fusy, Gandouet, Meunier), with linear counting for
+    // small cardinalities.
+    //
+    // 2^precision one-byte registers keep the highest rank seen for their share of the hash
+    // space. The standard error is about 1.04 / sqrt(2^precision): 3.25% at the default
+    // precision, in 1KB. Sketches of the same precision merge losslessly by taking the
+    // larger register, so interval sketches can be rolled up into totals.
+    class HyperLogLog
+    {
+    public:
+        explicit HyperLogLog(unsigned int precision = DefaultPrecision);
+
+        // Adds a uniformly distributed 64-bit hash of the item (see EventKeys::Hash).
+        void Add(unsigned long long hash)
+        {
+            size_t index = static_cast<size_t>(hash >> (64 - m_Precision));
+            // The guard bit caps the rank when the remaining bits are all zero.
+            unsigned long long remaining = (hash << m_Precision) | (1ull << (m_Precision - 1));
+            unsigned long highestBit;
+            _BitScanReverse64(&highestBit, remaining);
+            unsigned char rank = static_cast<unsigned char>(64 - highestBit);
+            if (m_Registers[index] < rank)
+            {
+                m_Registers[index] = rank;
+            }
+        }
+
+        double Estimate() const;
+
+        // Adds every item of other. Both sketches must have the same precision.
+        void Merge(const HyperLogLog& other);
+
+        void Reset();
+
+        unsigned int GetPrecision() const;
+
+        // Constants
+        static const unsigned int DefaultPrecision = 10;
+        static const unsigned int MinPrecision = 4;
+        static const unsigned int MaxPrecision = 16;
+
+    private:
+        unsigned int m_Precision;
+        std::vector<unsigned char> m_Registers;
+    };
+}
\ No newline at end of file
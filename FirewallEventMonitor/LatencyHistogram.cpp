@@ -0,0 +1,127 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "LatencyHistogram.h"
+
+namespace FirewallEventMonitor
+{
+    LatencySnapshot::LatencySnapshot()
+        : counts(new unsigned long long[LatencyHistogram::BucketCount]())
+    {
+    }
+
+    unsigned long long LatencySnapshot::ValueAtPercentile(double percentile) const
+    {
+        if (count == 0)
+        {
+            return 0;
+        }
+
+        // The rank of the value at the percentile, counting from 1.
+        unsigned long long rank = static_cast<unsigned long long>(percentile / 100.0 * count + 0.5);
+        if (rank < 1)
+        {
+            rank = 1;
+        }
+
+        unsigned long long seen = 0;
+        for (size_t index = 0; index < LatencyHistogram::BucketCount; ++index)
+        {
+            seen += counts[index];
+            if (seen >= rank)
+            {
+                return (std::min)(LatencyHistogram::GetBucketHighestValue(index), max);
+            }
+        }
+        return max;
+    }
+
+    LatencyHistogram::LatencyHistogram()
+        : m_Counts(new std::atomic<unsigned long long>[BucketCount]),
+        m_Max(0),
+        m_IntervalMax(0),
+        m_PreviousCounts(new unsigned long long[BucketCount]())
+    {
+        for (size_t index = 0; index < BucketCount; ++index)
+        {
+            m_Counts[index].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void LatencyHistogram::Snapshot(
+        _Out_ LatencySnapshot& interval,
+        _Out_ LatencySnapshot& total)
+    {
+        interval.count = 0;
+        total.count = 0;
+        for (size_t index = 0; index < BucketCount; ++index)
+        {
+            unsigned long long count = m_Counts[index].load(std::memory_order_relaxed);
+            total.counts[index] = count;
+            total.count += count;
+            interval.counts[index] = count - m_PreviousCounts[index];
+            interval.count += interval.counts[index];
+            m_PreviousCounts[index] = count;
+        }
+
+        // Read after the counts so the maximums cover every value counted.
+        interval.max = m_IntervalMax.exchange(0, std::memory_order_relaxed);
+        total.max = m_Max.load(std::memory_order_relaxed);
+    }
+
+    void LatencyHistogram::SnapshotTotal(_Out_ LatencySnapshot& total) const
+    {
+        total.count = 0;
+        for (size_t index = 0; index < BucketCount; ++index)
+        {
+            unsigned long long count = m_Counts[index].load(std::memory_order_relaxed);
+            total.counts[index] = count;
+            total.count += count;
+        }
+
+        total.max = m_Max.load(std::memory_order_relaxed);
+    }
+
+    unsigned long long LatencyHistogram::ReadCumulativeCounts(
+        _In_reads_(boundCount) const unsigned long long* bounds,
+        size_t boundCount,
+        _Out_writes_(boundCount) unsigned long long* counts,
+        _Out_ double& sum) const
+    {
+        unsigned long long total = 0;
+        unsigned long long lowest = 0;
+        size_t bound = 0;
+        sum = 0.0;
+        for (size_t index = 0; index < BucketCount; ++index)
+        {
+            unsigned long long highest = GetBucketHighestValue(index);
+            while (bound < boundCount && highest > bounds[bound])
+            {
+                counts[bound++] = total;
+            }
+
+            unsigned long long count = m_Counts[index].load(std::memory_order_relaxed);
+            total += count;
+            sum += static_cast<double>(count) * (static_cast<double>(lowest) + static_cast<double>(highest)) / 2.0;
+            lowest = highest + 1;
+        }
+
+        while (bound < boundCount)
+        {
+            counts[bound++] = total;
+        }
+        return total;
+    }
+
+    unsigned long long LatencyHistogram::GetBucketHighestValue(size_t index)
+    {
+        if (index < SubBucketCount * 2)
+        {
+            return index;
+        }
+
+        unsigned long shift = static_cast<unsigned long>(index / SubBucketCount - 1);
+        unsigned long long lowest = static_cast<unsigned long long>(index % SubBucketCount + SubBucketCount) << shift;
+        return lowest + ((1ull << shift) - 1);
+    }
+}
\ No newline at end of file
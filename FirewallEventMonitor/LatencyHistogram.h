@@ -0,0 +1,109 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+#include <intrin.h>
+// c++ headers
+#include <atomic>
+#include <memory>
+
+namespace FirewallEventMonitor
+{
+    // Counts of a histogram at one point, as handed out by LatencyHistogram::Snapshot.
+    struct LatencySnapshot
+    {
+        std::unique_ptr<unsigned long long[]> counts;
+        unsigned long long count = 0;
+        unsigned long long max = 0;
+
+        LatencySnapshot();
+
+        // Highest value recorded in the bucket holding the given percentile (0 to 100),
+        // capped at max. Returns 0 for an empty snapshot.
+        unsigned long long ValueAtPercentile(double percentile) const;
+    };
+
+    // Log-linear (HDR-style) histogram of 64-bit values, safe to record into from any thread
+    // without a lock.
+    //
+    // Values below SubBucketCount get a bucket each; above that every power of two is split
+    // into SubBucketCount linear buckets, so a percentile read back is within 1/SubBucketCount
+    // (3.1%) of the value recorded, from nanoseconds to centuries, in a fixed 15KB.
+    class LatencyHistogram
+    {
+    public:
+        LatencyHistogram();
+
+        void Record(unsigned long long value)
+        {
+            m_Counts[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+            UpdateMax(m_Max, value);
+            UpdateMax(m_IntervalMax, value);
+        }
+
+        // Fills interval with the values recorded since the previous call and total with all
+        // values recorded. Must not be called from more than one thread at a time.
+        void Snapshot(
+            _Out_ LatencySnapshot& interval,
+            _Out_ LatencySnapshot& total);
+
+        // Fills total with all values recorded, leaving the interval Snapshot reports untouched.
+        void SnapshotTotal(_Out_ LatencySnapshot& total) const;
+
+        // Fills counts with the number of values recorded at or below each of the ascending
+        // bounds, and sum with their total, and returns the number of values recorded. A value
+        // counts as the highest value of its bucket against a bound, and as the middle of it in
+        // the sum. Takes no lock and may run alongside Record and Snapshot.
+        unsigned long long ReadCumulativeCounts(
+            _In_reads_(boundCount) const unsigned long long* bounds,
+            size_t boundCount,
+            _Out_writes_(boundCount) unsigned long long* counts,
+            _Out_ double& sum) const;
+
+        static size_t GetBucketIndex(unsigned long long value)
+        {
+            if (value < SubBucketCount)
+            {
+                return static_cast<size_t>(value);
+            }
+
+            unsigned long highestBit;
+            _BitScanReverse64(&highestBit, value);
+            unsigned long shift = highestBit - SubBucketBits;
+            return (shift + 1) * SubBucketCount + static_cast<size_t>((value >> shift) - SubBucketCount);
+        }
+
+        // Highest value that lands in the bucket.
+        static unsigned long long GetBucketHighestValue(size_t index);
+
+        // Constants
+        static const unsigned long SubBucketBits = 5;
+        static const size_t SubBucketCount = 1 << SubBucketBits;
+        static const size_t BucketCount = (64 - SubBucketBits + 1) * SubBucketCount;
+
+        LatencyHistogram(LatencyHistogram const&) = delete;
+        LatencyHistogram& operator=(LatencyHistogram const&) = delete;
+
+    private:
+        static void UpdateMax(
+            std::atomic<unsigned long long>& max,
+            unsigned long long value)
+        {
+            unsigned long long current = max.load(std::memory_order_relaxed);
+            while (current < value &&
+                !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        std::unique_ptr<std::atomic<unsigned long long>[]> m_Counts;
+        std::atomic<unsigned long long> m_Max;
+        // Reset by each Snapshot.
+        std::atomic<unsigned long long> m_IntervalMax;
+        // Counts as of the previous Snapshot. Only used by Snapshot.
+        std::unique_ptr<unsigned long long[]> m_PreviousCounts;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,198 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+// c++ headers
+#include <cstdio>
+
+#include "LatencyMonitor.h"
+// ntl headers
+#include "ntlLocks.hpp"
+
+namespace FirewallEventMonitor
+{
+    const char* const LatencyStageNames[] =
+    {
+        "Collect",
+        "Filter",
+        "Statistics",
+        "Output",
+        "Total",
+        "Event age"
+    };
+
+    const double LatencyReportedPercentiles[] = { 50.0, 99.0, 99.9 };
+
+    LatencyMonitor::LatencyMonitor()
+    {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        m_NanosecondsPerTick = 1000000000.0 / static_cast<double>(frequency.QuadPart);
+
+        for (size_t i = 0; i < StageCount; ++i)
+        {
+            m_Histograms[i] = std::make_unique<LatencyHistogram>();
+            m_Allocations[i].store(0, std::memory_order_relaxed);
+            m_AllocatedBytes[i].store(0, std::memory_order_relaxed);
+        }
+
+        InitializeCriticalSectionEx(&m_CriticalSection, 4000, 0);
+    }
+
+    LatencyMonitor::~LatencyMonitor()
+    {
+        DeleteCriticalSection(&m_CriticalSection);
+    }
+
+    void LatencyMonitor::RecordEventAge(LONGLONG eventTimeStamp)
+    {
+        FILETIME now;
+        ::GetSystemTimePreciseAsFileTime(&now);
+        LONGLONG nowTimeStamp = static_cast<LONGLONG>(
+            (static_cast<ULONGLONG>(now.dwHighDateTime) << 32) | now.dwLowDateTime);
+
+        // Clocks can disagree by a little; an event from the future is treated as brand new.
+        LONGLONG age = nowTimeStamp > eventTimeStamp ? nowTimeStamp - eventTimeStamp : 0;
+        m_Histograms[EventAge]->Record(static_cast<unsigned long long>(age) * 100);
+    }
+
+    void LatencyMonitor::Report(
+        unsigned long intervalInSeconds,
+        _Inout_ std::string& buffer)
+    {
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        TakeSnapshots();
+
+        buffer.append("Event latency in the last ");
+        buffer.append(std::to_string(intervalInSeconds));
+        buffer.append(" seconds (microseconds; allocations and bytes per event):\r\n");
+        FormatSnapshots(m_Interval, m_IntervalAllocations, buffer);
+    }
+
+    void LatencyMonitor::ReportTotals(_Inout_ std::string& buffer)
+    {
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        // Read without ending the interval, which the next Report still covers.
+        AllocationSnapshot totalAllocations[StageCount];
+        for (size_t i = 0; i < StageCount; ++i)
+        {
+            m_Histograms[i]->SnapshotTotal(m_Totals[i]);
+            totalAllocations[i].allocations = m_Allocations[i].load(std::memory_order_relaxed);
+            totalAllocations[i].allocatedBytes = m_AllocatedBytes[i].load(std::memory_order_relaxed);
+        }
+
+        buffer.append("Event latency since the capture started (microseconds; allocations and bytes per event):\r\n");
+        FormatSnapshots(m_Totals, totalAllocations, buffer);
+    }
+
+    const char* LatencyMonitor::GetStageName(Stage stage)
+    {
+        return LatencyStageNames[stage];
+    }
+
+    const LatencyHistogram& LatencyMonitor::GetHistogram(Stage stage) const
+    {
+        return *m_Histograms[stage];
+    }
+
+    unsigned long long LatencyMonitor::GetAllocationCount(Stage stage) const
+    {
+        return m_Allocations[stage].load(std::memory_order_relaxed);
+    }
+
+    unsigned long long LatencyMonitor::GetAllocatedBytes(Stage stage) const
+    {
+        return m_AllocatedBytes[stage].load(std::memory_order_relaxed);
+    }
+
+    void LatencyMonitor::TakeSnapshots()
+    {
+        for (size_t i = 0; i < StageCount; ++i)
+        {
+            m_Histograms[i]->Snapshot(m_Interval[i], m_Totals[i]);
+
+            // The counters only grow, so the interval is what they grew by since the last snapshot.
+            unsigned long long allocations = m_Allocations[i].load(std::memory_order_relaxed);
+            unsigned long long allocatedBytes = m_AllocatedBytes[i].load(std::memory_order_relaxed);
+            m_IntervalAllocations[i].allocations = allocations - m_TotalAllocations[i].allocations;
+            m_IntervalAllocations[i].allocatedBytes = allocatedBytes - m_TotalAllocations[i].allocatedBytes;
+            m_TotalAllocations[i].allocations = allocations;
+            m_TotalAllocations[i].allocatedBytes = allocatedBytes;
+        }
+    }
+
+    void LatencyMonitor::FormatSnapshots(
+        const LatencySnapshot* snapshots,
+        const AllocationSnapshot* allocations,
+        _Inout_ std::string& buffer)
+    {
+        buffer.append("  Stage");
+        buffer.append(StageColumnWidth - 5, ' ');
+        buffer.append("       Count         p50         p99       p99.9         Max      Allocs       Bytes\r\n");
+
+        for (size_t i = 0; i < StageCount; ++i)
+        {
+            const LatencySnapshot& snapshot = snapshots[i];
+            std::string name = GetStageName(static_cast<Stage>(i));
+            buffer.append("  ");
+            buffer.append(name);
+            buffer.append(StageColumnWidth - name.size(), ' ');
+
+            std::string count = std::to_string(snapshot.count);
+            if (count.size() < NumberColumnWidth)
+            {
+                buffer.append(NumberColumnWidth - count.size(), ' ');
+            }
+            buffer.append(count);
+
+            for (double percentile : LatencyReportedPercentiles)
+            {
+                AppendMicroseconds(snapshot.ValueAtPercentile(percentile), buffer);
+            }
+            AppendMicroseconds(snapshot.max, buffer);
+
+            // The event age is not spent in the callback, so nothing is allocated in it.
+            if (i != EventAge)
+            {
+                AppendPerEvent(allocations[i].allocations, snapshot.count, 1, buffer);
+                AppendPerEvent(allocations[i].allocatedBytes, snapshot.count, 0, buffer);
+            }
+            buffer.append("\r\n");
+        }
+        buffer.append("\r\n");
+    }
+
+    void LatencyMonitor::AppendMicroseconds(
+        unsigned long long nanoseconds,
+        _Inout_ std::string& buffer)
+    {
+        char text[32];
+        int length = sprintf_s(text, "%*.1f",
+            static_cast<int>(NumberColumnWidth),
+            static_cast<double>(nanoseconds) / 1000.0);
+        if (length > 0)
+        {
+            buffer.append(text, static_cast<size_t>(length));
+        }
+    }
+
+    void LatencyMonitor::AppendPerEvent(
+        unsigned long long total,
+        unsigned long long count,
+        int precision,
+        _Inout_ std::string& buffer)
+    {
+        double perEvent = count > 0 ? static_cast<double>(total) / static_cast<double>(count) : 0.0;
+
+        char text[32];
+        int length = sprintf_s(text, "%*.*f",
+            static_cast<int>(NumberColumnWidth),
+            precision,
+            perEvent);
+        if (length > 0)
+        {
+            buffer.append(text, static_cast<size_t>(length));
+        }
+    }
+}
\ No newline at end of file
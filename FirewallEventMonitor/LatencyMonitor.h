@@ -0,0 +1,209 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "AllocationCounter.h"
+#include "LatencyHistogram.h"
+
+namespace FirewallEventMonitor
+{
+    // Where the event callback spends its time, and how old events are by the time it sees them.
+    //
+    // Each stage of FirewallEtwTraceCallback::ProcessEventRecord is timed with the performance
+    // counter and recorded in nanoseconds; the event age is the system time less the ETW time
+    // stamp. An age that keeps growing means the callback is falling behind the ETW buffers,
+    // which will start dropping events once they fill.
+    //
+    // With a DecodePipeline, Collect and Filter are timed on its workers, Total covers the stages
+    // after them, and the age is taken once the event has come out of the pipeline.
+    //
+    // The calls to operator new made in each stage are counted as well (see AllocationCounter),
+    // and reported per event next to the latencies. Once its buffers have grown, an event should
+    // allocate nothing on its way through.
+    class LatencyMonitor
+    {
+    public:
+        enum Stage
+        {
+            Collect,    // Parsing the record and CollectEventData.
+            Filter,     // Address and rule filters.
+            Statistics, // Rule hits, rate history, top talkers, distinct counts.
+            Output,     // Flow table and loggers.
+            Total,      // Every rule match event, including those filtered out.
+            EventAge,   // From the ETW time stamp to the callback.
+            StageCount
+        };
+
+        // Times the stages of one event in turn, and counts their allocations. Does nothing
+        // without a monitor. Must end on the thread it was started on.
+        class StageClock
+        {
+        public:
+            explicit StageClock(LatencyMonitor* monitor)
+                : m_Monitor(monitor),
+                m_Start(monitor ? Now() : 0),
+                m_StageStart(m_Start),
+                m_StartAllocations(monitor ? AllocationCounter::GetAllocationCount() : 0),
+                m_StartAllocatedBytes(monitor ? AllocationCounter::GetAllocatedBytes() : 0),
+                m_StageStartAllocations(m_StartAllocations),
+                m_StageStartAllocatedBytes(m_StartAllocatedBytes)
+            {
+            }
+
+            ~StageClock()
+            {
+                if (m_Monitor)
+                {
+                    m_Monitor->RecordStage(Total, m_Start, Now());
+                    m_Monitor->RecordAllocations(
+                        Total,
+                        AllocationCounter::GetAllocationCount() - m_StartAllocations,
+                        AllocationCounter::GetAllocatedBytes() - m_StartAllocatedBytes);
+                }
+            }
+
+            // Records the time and allocations since the previous stage ended.
+            void EndStage(Stage stage)
+            {
+                if (m_Monitor)
+                {
+                    LONGLONG now = Now();
+                    m_Monitor->RecordStage(stage, m_StageStart, now);
+                    m_StageStart = now;
+
+                    unsigned long long allocations = AllocationCounter::GetAllocationCount();
+                    unsigned long long allocatedBytes = AllocationCounter::GetAllocatedBytes();
+                    m_Monitor->RecordAllocations(
+                        stage,
+                        allocations - m_StageStartAllocations,
+                        allocatedBytes - m_StageStartAllocatedBytes);
+                    m_StageStartAllocations = allocations;
+                    m_StageStartAllocatedBytes = allocatedBytes;
+                }
+            }
+
+            StageClock(StageClock const&) = delete;
+            StageClock& operator=(StageClock const&) = delete;
+
+        private:
+            LatencyMonitor* m_Monitor;
+            LONGLONG m_Start;
+            LONGLONG m_StageStart;
+            unsigned long long m_StartAllocations;
+            unsigned long long m_StartAllocatedBytes;
+            unsigned long long m_StageStartAllocations;
+            unsigned long long m_StageStartAllocatedBytes;
+        };
+
+        LatencyMonitor();
+
+        ~LatencyMonitor();
+
+        // Performance counter ticks.
+        static LONGLONG Now()
+        {
+            LARGE_INTEGER now;
+            QueryPerformanceCounter(&now);
+            return now.QuadPart;
+        }
+
+        void RecordStage(
+            Stage stage,
+            LONGLONG startTicks,
+            LONGLONG endTicks)
+        {
+            LONGLONG elapsed = endTicks > startTicks ? endTicks - startTicks : 0;
+            m_Histograms[stage]->Record(static_cast<unsigned long long>(elapsed * m_NanosecondsPerTick));
+        }
+
+        // Adds the calls to operator new, and the bytes they asked for, made in a stage by one event.
+        void RecordAllocations(
+            Stage stage,
+            unsigned long long allocations,
+            unsigned long long allocatedBytes)
+        {
+            // Nothing shared is written for an event that allocated nothing, as in the steady state.
+            if (allocations != 0)
+            {
+                m_Allocations[stage].fetch_add(allocations, std::memory_order_relaxed);
+                m_AllocatedBytes[stage].fetch_add(allocatedBytes, std::memory_order_relaxed);
+            }
+        }
+
+        // eventTimeStamp is the event's FILETIME, as given by EtwRecord::getTimeStamp.
+        void RecordEventAge(LONGLONG eventTimeStamp);
+
+        // Appends the percentiles of the values recorded since the previous report.
+        void Report(
+            unsigned long intervalInSeconds,
+            _Inout_ std::string& buffer);
+
+        // Appends the percentiles of every value recorded since the capture started. The
+        // interval the next Report covers is left as it is.
+        void ReportTotals(_Inout_ std::string& buffer);
+
+        static const char* GetStageName(Stage stage);
+
+        // For reading without the lock (see LatencyHistogram::ReadCumulativeCounts). In nanoseconds.
+        const LatencyHistogram& GetHistogram(Stage stage) const;
+
+        // Allocations and bytes allocated in a stage since the capture started. Read without the lock.
+        unsigned long long GetAllocationCount(Stage stage) const;
+
+        unsigned long long GetAllocatedBytes(Stage stage) const;
+
+        // Constants
+        static const size_t StageColumnWidth = 24;
+        static const size_t NumberColumnWidth = 12;
+
+        LatencyMonitor(LatencyMonitor const&) = delete;
+        LatencyMonitor& operator=(LatencyMonitor const&) = delete;
+
+    private:
+        // Allocations of a stage over the events of a snapshot.
+        struct AllocationSnapshot
+        {
+            unsigned long long allocations = 0;
+            unsigned long long allocatedBytes = 0;
+        };
+
+        // Snapshots every histogram into m_Interval and m_Totals, and the allocations into
+        // m_IntervalAllocations and m_TotalAllocations. Called with the lock held.
+        void TakeSnapshots();
+
+        void FormatSnapshots(
+            const LatencySnapshot* snapshots,
+            const AllocationSnapshot* allocations,
+            _Inout_ std::string& buffer);
+
+        static void AppendMicroseconds(
+            unsigned long long nanoseconds,
+            _Inout_ std::string& buffer);
+
+        // Appends total / count, right-aligned in a column. 0 if there were no events.
+        static void AppendPerEvent(
+            unsigned long long total,
+            unsigned long long count,
+            int precision,
+            _Inout_ std::string& buffer);
+
+        double m_NanosecondsPerTick;
+        std::unique_ptr<LatencyHistogram> m_Histograms[StageCount];
+        std::atomic<unsigned long long> m_Allocations[StageCount];
+        std::atomic<unsigned long long> m_AllocatedBytes[StageCount];
+        // Guards the snapshots, which are only used when reporting.
+        CRITICAL_SECTION m_CriticalSection;
+        LatencySnapshot m_Interval[StageCount];
+        LatencySnapshot m_Totals[StageCount];
+        AllocationSnapshot m_IntervalAllocations[StageCount];
+        AllocationSnapshot m_TotalAllocations[StageCount];
+    };
+}
\ No newline at end of file
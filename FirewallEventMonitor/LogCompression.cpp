@@ -0,0 +1,311 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "LogCompression.h"
+// ntl headers
+#include "ntlString.hpp"
+
+namespace FirewallEventMonitor
+{
+    const LPCSTR CORRUPT_BLOCK_MESSAGE = "Compressed log block is corrupt";
+
+    //
+    // BlockCompressor
+    //
+
+    BlockCompressor::BlockCompressor()
+    {
+        if (!::CreateCompressor(COMPRESS_ALGORITHM_XPRESS, NULL, &m_Compressor))
+        {
+            throw std::exception("Unable to create XPRESS compressor");
+        }
+    }
+
+    BlockCompressor::~BlockCompressor()
+    {
+        if (m_Compressor != NULL)
+        {
+            ::CloseCompressor(m_Compressor);
+            m_Compressor = NULL;
+        }
+    }
+
+    void BlockCompressor::CompressBlock(
+        _In_reads_bytes_(length) const char* data,
+        size_t length,
+        _Inout_ std::vector<char>& block)
+    {
+        if (length > MaxCompressedBlockSizeInBytes)
+        {
+            throw std::exception("Block is too large to compress");
+        }
+
+        block.resize(sizeof(CompressedBlockHeader) + length);
+        char* storedData = block.data() + sizeof(CompressedBlockHeader);
+
+        // Offer no more room than the input: data that does not shrink is stored as-is.
+        SIZE_T compressedSize = 0;
+        if (!::Compress(m_Compressor, data, length, storedData, length, &compressedSize) ||
+            compressedSize >= length)
+        {
+            memcpy_s(storedData, length, data, length);
+            compressedSize = length;
+        }
+
+        CompressedBlockHeader header;
+        memcpy_s(header.magic, sizeof(header.magic), CompressedBlockMagic, sizeof(CompressedBlockMagic));
+        header.uncompressedSize = static_cast<unsigned long>(length);
+        header.storedSize = static_cast<unsigned long>(compressedSize);
+        memcpy_s(block.data(), block.size(), &header, sizeof(header));
+
+        block.resize(sizeof(CompressedBlockHeader) + compressedSize);
+    }
+
+    //
+    // CompressedFileReader
+    //
+
+    CompressedFileReader::CompressedFileReader(const std::wstring &filePath)
+        : m_FilePath(filePath),
+        m_Block(MaxCompressedBlockSizeInBytes),
+        m_StoredData(MaxCompressedBlockSizeInBytes)
+    {
+        // Allow reading a file that is still being written.
+        HANDLE file = ::CreateFileW(
+            filePath.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ | FILE_SHARE_WRITE,
+            NULL,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            NULL);
+
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            std::string errorMessage = "Unable to open file ";
+            errorMessage += ntl::String::convert_to_string(filePath);
+            throw std::exception(errorMessage.c_str());
+        }
+
+        m_File = file;
+
+        // Files that do not start with a block header are read as-is.
+        m_BlockEnd = ReadFromFile(m_Block.data(), sizeof(CompressedBlockMagic));
+        m_Compressed =
+            m_BlockEnd == sizeof(CompressedBlockMagic) &&
+            memcmp(m_Block.data(), CompressedBlockMagic, sizeof(CompressedBlockMagic)) == 0;
+
+        if (m_Compressed)
+        {
+            m_BlockEnd = 0;
+            m_FirstBlock = true;
+
+            if (!::CreateDecompressor(COMPRESS_ALGORITHM_XPRESS, NULL, &m_Decompressor))
+            {
+                ::CloseHandle(m_File);
+                m_File = NULL;
+                throw std::exception("Unable to create XPRESS decompressor");
+            }
+        }
+    }
+
+    CompressedFileReader::~CompressedFileReader()
+    {
+        if (m_Decompressor != NULL)
+        {
+            ::CloseDecompressor(m_Decompressor);
+            m_Decompressor = NULL;
+        }
+
+        if (m_File != NULL)
+        {
+            ::CloseHandle(m_File);
+            m_File = NULL;
+        }
+    }
+
+    bool CompressedFileReader::IsCompressed() const
+    {
+        return m_Compressed;
+    }
+
+    size_t CompressedFileReader::Read(
+        _Out_writes_bytes_(length) char* data,
+        size_t length)
+    {
+        size_t bytesRead = 0;
+        while (bytesRead < length)
+        {
+            if (m_BlockBegin == m_BlockEnd)
+            {
+                if (!m_Compressed)
+                {
+                    // Pass-through: the first bytes came from the header probe, the rest from the file.
+                    bytesRead += ReadFromFile(data + bytesRead, length - bytesRead);
+                    break;
+                }
+
+                if (!ReadBlock())
+                {
+                    break;
+                }
+            }
+
+            size_t available = m_BlockEnd - m_BlockBegin;
+            size_t count = (available < length - bytesRead) ? available : length - bytesRead;
+            memcpy_s(data + bytesRead, length - bytesRead, m_Block.data() + m_BlockBegin, count);
+            m_BlockBegin += count;
+            bytesRead += count;
+        }
+
+        return bytesRead;
+    }
+
+    bool CompressedFileReader::ReadBlock()
+    {
+        m_BlockBegin = 0;
+        m_BlockEnd = 0;
+
+        CompressedBlockHeader header;
+        size_t headerOffset = 0;
+        if (m_FirstBlock)
+        {
+            // The constructor has already read the first block's magic.
+            memcpy_s(header.magic, sizeof(header.magic), CompressedBlockMagic, sizeof(CompressedBlockMagic));
+            headerOffset = sizeof(header.magic);
+            m_FirstBlock = false;
+        }
+
+        size_t bytesRead = ReadFromFile(reinterpret_cast<char*>(&header) + headerOffset, sizeof(header) - headerOffset);
+        if (bytesRead == 0 &&
+            headerOffset == 0)
+        {
+            return false;
+        }
+
+        // A capture that was stopped abruptly can leave a partial block behind.
+        if (bytesRead != sizeof(header) - headerOffset)
+        {
+            wprintf(L"Warning: Ignoring %Iu bytes of incomplete block header at the end of %ls.\n",
+                headerOffset + bytesRead,
+                m_FilePath.c_str());
+            return false;
+        }
+
+        if (memcmp(header.magic, CompressedBlockMagic, sizeof(CompressedBlockMagic)) != 0 ||
+            header.uncompressedSize > MaxCompressedBlockSizeInBytes ||
+            header.storedSize > header.uncompressedSize)
+        {
+            throw std::exception(CORRUPT_BLOCK_MESSAGE);
+        }
+
+        size_t storedRead = ReadFromFile(m_StoredData.data(), header.storedSize);
+        if (storedRead != header.storedSize)
+        {
+            wprintf(L"Warning: Ignoring incomplete block of %Iu of %lu bytes at the end of %ls.\n",
+                storedRead,
+                header.storedSize,
+                m_FilePath.c_str());
+            return false;
+        }
+
+        if (header.storedSize == header.uncompressedSize)
+        {
+            memcpy_s(m_Block.data(), m_Block.size(), m_StoredData.data(), header.storedSize);
+        }
+        else
+        {
+            SIZE_T decompressedSize = 0;
+            if (!::Decompress(
+                    m_Decompressor,
+                    m_StoredData.data(),
+                    header.storedSize,
+                    m_Block.data(),
+                    header.uncompressedSize,
+                    &decompressedSize) ||
+                decompressedSize != header.uncompressedSize)
+            {
+                throw std::exception(CORRUPT_BLOCK_MESSAGE);
+            }
+        }
+
+        m_BlockEnd = header.uncompressedSize;
+        return true;
+    }
+
+    size_t CompressedFileReader::ReadFromFile(
+        _Out_writes_bytes_(length) char* data,
+        size_t length)
+    {
+        size_t bytesRead = 0;
+        while (bytesRead < length)
+        {
+            DWORD bytesToRead = static_cast<DWORD>(length - bytesRead);
+            DWORD chunkRead = 0;
+            if (!::ReadFile(m_File, data + bytesRead, bytesToRead, &chunkRead, NULL))
+            {
+                throw std::exception("Reading file failed");
+            }
+
+            if (chunkRead == 0)
+            {
+                break;
+            }
+            bytesRead += chunkRead;
+        }
+
+        return bytesRead;
+    }
+
+    unsigned long long CompressedFileReader::DecompressFile(
+        const std::wstring &compressedFilePath,
+        const std::wstring &filePath)
+    {
+        CompressedFileReader reader(compressedFilePath);
+
+        HANDLE file = ::CreateFileW(
+            filePath.c_str(),
+            GENERIC_WRITE,
+            FILE_SHARE_READ,
+            NULL,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            NULL);
+
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            std::string errorMessage = "Unable to open file ";
+            errorMessage += ntl::String::convert_to_string(filePath);
+            throw std::exception(errorMessage.c_str());
+        }
+
+        unsigned long long totalBytes = 0;
+        std::vector<char> buffer(MaxCompressedBlockSizeInBytes);
+        try
+        {
+            for (;;)
+            {
+                size_t bytesRead = reader.Read(buffer.data(), buffer.size());
+                if (bytesRead == 0)
+                {
+                    break;
+                }
+
+                DWORD bytesWritten = 0;
+                if (!::WriteFile(file, buffer.data(), static_cast<DWORD>(bytesRead), &bytesWritten, NULL))
+                {
+                    throw std::exception("Writing decompressed file failed");
+                }
+                totalBytes += bytesRead;
+            }
+        }
+        catch (...)
+        {
+            ::CloseHandle(file);
+            throw;
+        }
+
+        ::CloseHandle(file);
+        return totalBytes;
+    }
+}
\ No newline at end of file
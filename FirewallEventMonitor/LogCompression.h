@@ -0,0 +1,103 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+#include <compressapi.h>
+// c++ headers
+#include <string>
+#include <vector>
+
+namespace FirewallEventMonitor
+{
+    //
+    // Compressed log layout (.xpress): a sequence of independently decompressible blocks.
+    // Each block is a CompressedBlockHeader followed by storedSize bytes. Readers can skip
+    // to any block by walking the headers without decompressing the data in between.
+    //
+    struct CompressedBlockHeader
+    {
+        char magic[4];
+        // Size of the block once decompressed.
+        unsigned long uncompressedSize;
+        // Size of the data following the header. Equal to uncompressedSize when the block
+        // did not compress and is stored as-is.
+        unsigned long storedSize;
+    };
+
+    const char CompressedBlockMagic[4] = { 'F', 'W', 'Z', 'B' };
+    const LPCWSTR CompressedFileExtension = L".xpress";
+    const size_t MaxCompressedBlockSizeInBytes = 1024 * 1024; // 1 MB.
+
+    // Compresses blocks with the built-in XPRESS (LZ77) codec of the Windows Compression API.
+    class BlockCompressor
+    {
+    public:
+        BlockCompressor();
+
+        ~BlockCompressor();
+
+        // Replaces block with the header and stored data for [data, data + length).
+        // length must not exceed MaxCompressedBlockSizeInBytes.
+        void CompressBlock(
+            _In_reads_bytes_(length) const char* data,
+            size_t length,
+            _Inout_ std::vector<char>& block);
+
+        BlockCompressor(BlockCompressor const&) = delete;
+        BlockCompressor& operator=(BlockCompressor const&) = delete;
+
+    private:
+        COMPRESSOR_HANDLE m_Compressor = NULL;
+    };
+
+    // Reads a file written with BlockCompressor as a plain byte stream.
+    // Files without a block header are passed through unchanged. A final block cut short, as a
+    // crash mid-write leaves it, ends the stream with a warning; every complete block before it
+    // is read.
+    class CompressedFileReader
+    {
+    public:
+        CompressedFileReader(const std::wstring &filePath);
+
+        ~CompressedFileReader();
+
+        // Reads up to length bytes of decompressed data. Returns 0 at the end of the file.
+        size_t Read(
+            _Out_writes_bytes_(length) char* data,
+            size_t length);
+
+        bool IsCompressed() const;
+
+        // Writes the decompressed contents of a compressed file. Returns the bytes written.
+        static unsigned long long DecompressFile(
+            const std::wstring &compressedFilePath,
+            const std::wstring &filePath);
+
+        CompressedFileReader(CompressedFileReader const&) = delete;
+        CompressedFileReader& operator=(CompressedFileReader const&) = delete;
+
+    private:
+        std::wstring m_FilePath;
+        HANDLE m_File = NULL;
+        DECOMPRESSOR_HANDLE m_Decompressor = NULL;
+        bool m_Compressed = false;
+        bool m_FirstBlock = false;
+        // Decompressed bytes [m_BlockBegin, m_BlockEnd) not yet returned by Read.
+        std::vector<char> m_Block;
+        size_t m_BlockBegin = 0;
+        size_t m_BlockEnd = 0;
+        std::vector<char> m_StoredData;
+
+        // Loads the next block into m_Block. Returns false at the end of the file, or at a
+        // truncated final block.
+        bool ReadBlock();
+
+        // Reads until length bytes arrive or the file ends. Returns the bytes read.
+        size_t ReadFromFile(
+            _Out_writes_bytes_(length) char* data,
+            size_t length);
+    };
+}
\ No newline at end of file
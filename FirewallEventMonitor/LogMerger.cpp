@@ -0,0 +1,396 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "LogMerger.h"
+#include "ConsoleOutput.h"
+#include "EventFormatter.h"
+#include "FirewallEtwTraceCallback.h"
+#include "TimeOrderedMerge.h"
+// ntl headers
+#include "ntlLocks.hpp"
+#include "ntlString.hpp"
+// c++ headers
+#include <algorithm>
+
+namespace FirewallEventMonitor
+{
+    // Merged events are printed once this much text has built up.
+    const size_t LOG_MERGER_OUTPUT_BUFFER_SIZE = 1024 * 1024;
+
+    void WriteLogMergerOutput(
+        _Inout_ std::string& text)
+    {
+        WriteConsoleUtf8(text);
+        text.clear();
+    }
+
+    bool IsLogMergerDirectory(
+        const std::wstring& input)
+    {
+        DWORD attributes = ::GetFileAttributesW(input.c_str());
+        return attributes != INVALID_FILE_ATTRIBUTES &&
+            (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    }
+
+    LogStream::LogStream(
+        const std::wstring& input,
+        size_t readAheadEvents)
+        : m_ReadAheadEvents((std::max)(readAheadEvents, static_cast<size_t>(1)))
+    {
+        if (IsLogMergerDirectory(input))
+        {
+            std::wstring directoryPath(input);
+            if (directoryPath.back() != L'\\')
+            {
+                directoryPath.push_back(L'\\');
+            }
+            std::wstring pattern(directoryPath);
+            pattern.append(L"*.bin*");
+
+            WIN32_FIND_DATAW findData;
+            HANDLE find = ::FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, NULL, 0);
+            if (find != INVALID_HANDLE_VALUE)
+            {
+                do
+                {
+                    std::wstring fileName(findData.cFileName);
+                    if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 &&
+                        BinaryLogReader::IsBinaryLog(fileName))
+                    {
+                        m_FilePaths.push_back(directoryPath + fileName);
+                    }
+                } while (::FindNextFileW(find, &findData));
+
+                ::FindClose(find);
+            }
+
+            // File names are time stamped, so this is the order they were written in.
+            std::sort(m_FilePaths.begin(), m_FilePaths.end());
+        }
+        else if (BinaryLogReader::IsBinaryLog(input))
+        {
+            m_FilePaths.push_back(input);
+        }
+        else
+        {
+            m_SavedCapture = true;
+            ::InitializeCriticalSectionEx(&m_CriticalSection, 4000, 0);
+            ::InitializeConditionVariable(&m_EventsQueued);
+            ::InitializeConditionVariable(&m_EventsTaken);
+            m_EtwThread = std::thread(&LogStream::ReadSavedCapture, this, input);
+            return;
+        }
+
+        if (m_FilePaths.empty())
+        {
+            throw std::exception("No binary logs in directory");
+        }
+        OpenNextBinaryLog();
+    }
+
+    LogStream::~LogStream()
+    {
+        if (!m_SavedCapture)
+        {
+            return;
+        }
+
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+            m_Stopping = true;
+            ::WakeAllConditionVariable(&m_EventsTaken);
+        }
+        m_EtwThread.join();
+        ::DeleteCriticalSection(&m_CriticalSection);
+    }
+
+    bool LogStream::ReadNext(
+        _Out_ VfpEventData* eventData)
+    {
+        return m_SavedCapture ?
+            ReadNextSavedCaptureEvent(eventData) :
+            ReadNextBinaryLogEvent(eventData);
+    }
+
+    std::wstring LogStream::GetHostName(
+        const std::wstring& input,
+        bool isDirectory)
+    {
+        size_t end = input.find_last_not_of(L"\\/");
+        if (end == std::wstring::npos)
+        {
+            return input;
+        }
+
+        size_t begin = input.find_last_of(L"\\/:", end);
+        begin = (begin == std::wstring::npos) ? 0 : begin + 1;
+        std::wstring name(input.substr(begin, end + 1 - begin));
+
+        if (!isDirectory)
+        {
+            size_t dot = name.find(L'.');
+            if (dot != 0 && dot != std::wstring::npos)
+            {
+                name.resize(dot);
+            }
+        }
+        return name;
+    }
+
+    void LogStream::ReadSavedCapture(
+        const std::wstring& filePath)
+    {
+        try
+        {
+            EventCollector eventCollector = { this };
+            ntl::EtwReader<EventCollector> reader(eventCollector);
+            reader.OpenSavedSession(filePath.c_str());
+            reader.WaitForSession();
+        }
+        catch (const std::exception &ex)
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+            m_EtwError = ex.what();
+        }
+
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+        m_EtwFinished = true;
+        ::WakeConditionVariable(&m_EventsQueued);
+    }
+
+    bool LogStream::EventCollector::operator()(
+        const PEVENT_RECORD pEventRecord) try
+    {
+        if (!FirewallEtwTraceCallback::IsRuleMatchEvent(pEventRecord->EventHeader.EventDescriptor.Id))
+        {
+            return false;
+        }
+
+        // Decoded here, so each saved capture is decoded on its own thread.
+        ntl::EtwRecord record(pEventRecord);
+        stream->QueueEvent(FirewallEtwTraceCallback::CollectEventData(record));
+        // The reader must not keep the record.
+        return false;
+    }
+    catch (const std::exception &ex)
+    {
+        wprintf(L"Warning: Skipping event: %S.\n", ex.what());
+        return false;
+    }
+
+    bool LogStream::QueueEvent(
+        VfpEventData&& eventData)
+    {
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+        // ETW cannot be asked to stop reading a saved capture, so the rest is skipped instead.
+        while (m_Queue.size() >= m_ReadAheadEvents && !m_Stopping)
+        {
+            ::SleepConditionVariableCS(&m_EventsTaken, &m_CriticalSection, INFINITE);
+        }
+        if (m_Stopping)
+        {
+            return false;
+        }
+
+        m_Queue.push_back(std::move(eventData));
+        if (m_Queue.size() == 1)
+        {
+            ::WakeConditionVariable(&m_EventsQueued);
+        }
+        return true;
+    }
+
+    bool LogStream::ReadNextSavedCaptureEvent(
+        _Out_ VfpEventData* eventData)
+    {
+        if (m_Ready.empty())
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+            while (m_Queue.empty() && !m_EtwFinished)
+            {
+                ::SleepConditionVariableCS(&m_EventsQueued, &m_CriticalSection, INFINITE);
+            }
+            if (m_Queue.empty())
+            {
+                if (!m_EtwError.empty())
+                {
+                    throw std::exception(m_EtwError.c_str());
+                }
+                return false;
+            }
+
+            // Takes every queued event at once, leaving ETW a whole buffer's worth of room.
+            m_Ready.swap(m_Queue);
+            ::WakeConditionVariable(&m_EventsTaken);
+        }
+
+        *eventData = std::move(m_Ready.front());
+        m_Ready.pop_front();
+        return true;
+    }
+
+    bool LogStream::ReadNextBinaryLogEvent(
+        _Out_ VfpEventData* eventData)
+    {
+        while (m_BinaryLogReader)
+        {
+            if (m_BinaryLogReader->ReadNext(eventData))
+            {
+                return true;
+            }
+
+            m_BinaryLogReader.reset();
+            if (m_NextFile < m_FilePaths.size())
+            {
+                OpenNextBinaryLog();
+            }
+        }
+        return false;
+    }
+
+    void LogStream::OpenNextBinaryLog()
+    {
+        m_BinaryLogReader.reset(new BinaryLogReader(m_FilePaths[m_NextFile++], BinaryReadBufferSizeInBytes));
+    }
+
+    LogMerger::LogMerger(
+        const EventPredicate& predicate,
+        size_t readAheadEvents)
+        : m_Predicate(predicate),
+        m_ReadAheadEvents(readAheadEvents)
+    {
+    }
+
+    LogMergeResults LogMerger::Run(
+        const std::vector<std::wstring>& inputs) const
+    {
+        std::vector<std::string> hostTags;
+        hostTags.reserve(inputs.size());
+        for (const auto& input : inputs)
+        {
+            std::string hostTag("[");
+            hostTag.append(ntl::String::convert_to_string(LogStream::GetHostName(input, IsLogMergerDirectory(input))));
+            hostTag.append("] ");
+            hostTags.push_back(hostTag);
+        }
+
+        Utf8EventData utf8EventData;
+        std::string record;
+        std::string text;
+        text.reserve(LOG_MERGER_OUTPUT_BUFFER_SIZE);
+
+        LogMergeResults results = Merge(
+            inputs,
+            [&](size_t input, const VfpEventData& eventData)
+            {
+                EventFormatter::ConvertToUtf8(eventData, utf8EventData);
+                record.clear();
+                EventFormatter::FormatText(utf8EventData, record);
+                AppendTaggedLines(hostTags[input], record, text);
+
+                if (text.size() >= LOG_MERGER_OUTPUT_BUFFER_SIZE)
+                {
+                    WriteLogMergerOutput(text);
+                }
+            });
+
+        WriteLogMergerOutput(text);
+        return results;
+    }
+
+    void LogMerger::AppendTaggedLines(
+        const std::string& tag,
+        const std::string& record,
+        _Inout_ std::string& text)
+    {
+        size_t lineStart = 0;
+        while (lineStart < record.size())
+        {
+            size_t lineEnd = record.find('\n', lineStart);
+            lineEnd = (lineEnd == std::string::npos) ? record.size() : lineEnd + 1;
+
+            // The blank line that ends a record stays blank.
+            if (record.compare(lineStart, lineEnd - lineStart, "\r\n") != 0 &&
+                record.compare(lineStart, lineEnd - lineStart, "\n") != 0)
+            {
+                text.append(tag);
+            }
+            text.append(record, lineStart, lineEnd - lineStart);
+            lineStart = lineEnd;
+        }
+    }
+
+    LogMergeResults LogMerger::Merge(
+        const std::vector<std::wstring>& inputs,
+        const Output& output) const
+    {
+        LogMergeResults results;
+        std::vector<InputCursor> cursors(inputs.size());
+        for (size_t input = 0; input < inputs.size(); ++input)
+        {
+            InputCursor& cursor = cursors[input];
+            cursor.input = &inputs[input];
+            cursor.predicate = &m_Predicate;
+            cursor.results = &results;
+            try
+            {
+                cursor.stream = std::make_unique<LogStream>(inputs[input], m_ReadAheadEvents);
+            }
+            catch (const std::exception &ex)
+            {
+                ++results.inputsFailed;
+                wprintf(L"Warning: Skipping %ls: %S.\n", inputs[input].c_str(), ex.what());
+            }
+        }
+
+        LONGLONG lastTimeStamp = 0;
+        MergeInTimeOrder(cursors, [&](size_t input)
+        {
+            const VfpEventData& eventData = cursors[input].eventData;
+            if (eventData.timeStamp < lastTimeStamp)
+            {
+                ++results.eventsOutOfOrder;
+            }
+            lastTimeStamp = (std::max)(lastTimeStamp, eventData.timeStamp);
+
+            output(input, eventData);
+            ++results.eventsMerged;
+        });
+
+        return results;
+    }
+
+    bool LogMerger::InputCursor::Advance()
+    {
+        if (!stream)
+        {
+            return false;
+        }
+
+        try
+        {
+            while (stream->ReadNext(&eventData))
+            {
+                ++results->eventsScanned;
+                if (predicate->Matches(eventData))
+                {
+                    return true;
+                }
+            }
+            ++results->inputsRead;
+        }
+        catch (const std::exception &ex)
+        {
+            ++results->inputsFailed;
+            wprintf(L"Warning: Stopped reading %ls: %S.\n", input->c_str(), ex.what());
+        }
+
+        stream.reset();
+        return false;
+    }
+
+    LONGLONG LogMerger::InputCursor::GetTimeStamp() const
+    {
+        return eventData.timeStamp;
+    }
+}
\ No newline at end of file
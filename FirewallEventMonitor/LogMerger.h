@@ -0,0 +1,162 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+// ntl headers
+#include "ntlEtwReader.hpp"
+
+#include "BinaryLogReader.h"
+#include "EventPredicate.h"
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    // One host's events in the order they were logged, read ahead a bounded amount at a time.
+    //
+    // The input is a binary log (.bin or .bin.xpress), a directory of one host's rotated binary
+    // logs, read oldest first, or a saved capture (.etl). ETW pushes a saved capture's events
+    // from a thread of its own, which waits while readAheadEvents of them are waiting to be read.
+    class LogStream
+    {
+    public:
+        // Throws if the input cannot be opened.
+        LogStream(
+            const std::wstring& input,
+            size_t readAheadEvents);
+
+        // Skips the rest of a saved capture and waits for its thread.
+        ~LogStream();
+
+        // Returns false at the end of the stream. Throws if a file cannot be read.
+        bool ReadNext(_Out_ VfpEventData* eventData);
+
+        // The directory's name for a directory of logs, else the file name up to its first '.'.
+        static std::wstring GetHostName(
+            const std::wstring& input,
+            bool isDirectory);
+
+        // Constant
+        static const size_t BinaryReadBufferSizeInBytes = 64 * 1024;
+
+        LogStream(LogStream const&) = delete;
+        LogStream& operator=(LogStream const&) = delete;
+
+    private:
+        // Decodes each rule match event ETW reads and queues it for ReadNext.
+        struct EventCollector
+        {
+            LogStream* stream;
+
+            bool operator()(const PEVENT_RECORD pEventRecord);
+        };
+
+        // Binary logs, oldest first.
+        std::vector<std::wstring> m_FilePaths;
+        size_t m_NextFile = 0;
+        std::unique_ptr<BinaryLogReader> m_BinaryLogReader;
+        // Saved capture: ETW fills m_Queue while ReadNext drains m_Ready, and they swap when m_Ready runs dry.
+        bool m_SavedCapture = false;
+        size_t m_ReadAheadEvents;
+        std::thread m_EtwThread;
+        // Guards m_Queue and the flags below it. Only initialized for a saved capture.
+        CRITICAL_SECTION m_CriticalSection;
+        CONDITION_VARIABLE m_EventsQueued;
+        CONDITION_VARIABLE m_EventsTaken;
+        std::deque<VfpEventData> m_Queue;
+        std::deque<VfpEventData> m_Ready;
+        bool m_EtwFinished = false;
+        bool m_Stopping = false;
+        std::string m_EtwError;
+
+        void ReadSavedCapture(const std::wstring& filePath);
+
+        // Waits for room in the read-ahead buffer. Returns false once the stream is stopping.
+        bool QueueEvent(VfpEventData&& eventData);
+
+        bool ReadNextSavedCaptureEvent(_Out_ VfpEventData* eventData);
+
+        bool ReadNextBinaryLogEvent(_Out_ VfpEventData* eventData);
+
+        void OpenNextBinaryLog();
+    };
+
+    struct LogMergeResults
+    {
+        unsigned long long inputsRead = 0;
+        // Inputs that could not be opened, or stopped part way through.
+        unsigned long long inputsFailed = 0;
+        unsigned long long eventsScanned = 0;
+        unsigned long long eventsMerged = 0;
+        // Earlier than an event already merged. Each input is assumed to be in time order,
+        // which the flow records of an -Aggregate log, written as flows expire, are not.
+        unsigned long long eventsOutOfOrder = 0;
+    };
+
+    // Merges the logs of many hosts into one stream in time order, each event tagged with its host,
+    // to follow a flow from its source to its destination hypervisor.
+    //
+    // The inputs are merged by MergeInTimeOrder, so merging E events from N inputs takes
+    // O(E log N) time, and memory for N read-ahead buffers whatever the size of the logs.
+    class LogMerger
+    {
+    public:
+        // Receives the index of the input an event came from.
+        typedef std::function<void(size_t input, const VfpEventData& eventData)> Output;
+
+        // Only events that pass the predicate are merged.
+        LogMerger(
+            const EventPredicate& predicate,
+            size_t readAheadEvents = DefaultReadAheadEvents);
+
+        // Prints the merged events in the text log layout, each line led by "[host] ".
+        LogMergeResults Run(const std::vector<std::wstring>& inputs) const;
+
+        // Hands the merged events to output, earliest first. Equal time stamps keep the order of the inputs.
+        LogMergeResults Merge(
+            const std::vector<std::wstring>& inputs,
+            const Output& output) const;
+
+        // Appends each line of a formatted record to text, led by tag, so every line can be
+        // searched by host.
+        static void AppendTaggedLines(
+            const std::string& tag,
+            const std::string& record,
+            _Inout_ std::string& text);
+
+        // Constant
+        static const size_t DefaultReadAheadEvents = 256;
+
+        LogMerger(LogMerger const&) = delete;
+        LogMerger& operator=(LogMerger const&) = delete;
+
+    private:
+        // Reads one input's matching events for MergeInTimeOrder.
+        struct InputCursor
+        {
+            const std::wstring* input = nullptr;
+            const EventPredicate* predicate = nullptr;
+            LogMergeResults* results = nullptr;
+            // Reset once the input is done with, which frees its read-ahead buffer.
+            std::unique_ptr<LogStream> stream;
+            VfpEventData eventData;
+
+            // Reads up to the input's next matching event. False once the input is finished or fails.
+            bool Advance();
+
+            LONGLONG GetTimeStamp() const;
+        };
+
+        EventPredicate m_Predicate;
+        size_t m_ReadAheadEvents;
+    };
+}
\ No newline at end of file
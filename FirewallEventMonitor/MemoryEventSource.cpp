@@ -0,0 +1,126 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "MemoryEventSource.h"
+#include "FirewallEtwTraceCallback.h"
+
+// c++ headers
+#include <chrono>
+#include <thread>
+
+namespace FirewallEventMonitor
+{
+    MemoryEventSource::MemoryEventSource(
+        const std::vector<VfpEventData>& events,
+        unsigned long long repeatCount,
+        const FirewallEtwTraceCallback& callback,
+        const std::shared_ptr<EventCounter> eventCounter,
+        const std::shared_ptr<Timer> timer)
+        : m_Events(events),
+        m_RepeatCount(repeatCount),
+        m_Callback(std::make_unique<FirewallEtwTraceCallback>(callback)),
+        m_EventCounter(eventCounter),
+        m_Timer(timer),
+        m_Stopping(false),
+        m_Finished(false)
+    {
+    }
+
+    MemoryEventSource::~MemoryEventSource()
+    {
+        Stop();
+    }
+
+    void MemoryEventSource::Start()
+    {
+        m_Thread = std::thread(&MemoryEventSource::Run, this);
+    }
+
+    void MemoryEventSource::Stop()
+    {
+        m_Stopping = true;
+        if (m_Thread.joinable())
+        {
+            m_Thread.join();
+        }
+    }
+
+    bool MemoryEventSource::IsFinished() const
+    {
+        return m_Finished;
+    }
+
+    void MemoryEventSource::WriteResults() const
+    {
+        double eventsPerSecond = m_Results.elapsedInSeconds > 0.0 ?
+            static_cast<double>(m_Results.eventsDelivered) / m_Results.elapsedInSeconds :
+            0.0;
+
+        wprintf(L"Handed %llu events from memory to the callback in %.2f seconds: %.0f events per second sustained. Dropped %llu events.\n",
+            m_Results.eventsDelivered,
+            m_Results.elapsedInSeconds,
+            eventsPerSecond,
+            m_Results.eventsDropped);
+    }
+
+    MemoryEventSourceResults MemoryEventSource::GetResults() const
+    {
+        return m_Results;
+    }
+
+    void MemoryEventSource::Run()
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        try
+        {
+            // The callback may change the event (a flow record's counts), so each pass works on a copy.
+            VfpEventData eventData;
+            for (unsigned long long pass = 0;
+                (m_RepeatCount == 0 || pass < m_RepeatCount) && !m_Stopping && !m_Events.empty();
+                ++pass)
+            {
+                for (const auto& event : m_Events)
+                {
+                    if (m_Stopping)
+                    {
+                        break;
+                    }
+
+                    WaitWhileRefused();
+                    if (m_Stopping)
+                    {
+                        break;
+                    }
+
+                    if (!m_Callback->AdmitEvent())
+                    {
+                        ++m_Results.eventsDropped;
+                        continue;
+                    }
+
+                    eventData = event;
+                    m_Callback->ProcessEventData(eventData);
+                    ++m_Results.eventsDelivered;
+                }
+            }
+        }
+        catch (const std::exception &ex)
+        {
+            wprintf(L"Error: Handing events from memory raised exception: %S.\n", ex.what());
+        }
+
+        m_Results.elapsedInSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        m_Finished = true;
+    }
+
+    void MemoryEventSource::WaitWhileRefused()
+    {
+        // The main loop reopens the throttle each second; a time limit never reopens.
+        while ((m_EventCounter->EpocEventCountLimitReached() || m_Timer->TimeLimitReached()) &&
+            !m_Stopping)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
\ No newline at end of file
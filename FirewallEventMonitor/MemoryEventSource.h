@@ -0,0 +1,80 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// c++ headers
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "EventCounter.h"
+#include "EventSource.h"
+#include "Timer.h"
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    struct MemoryEventSourceResults
+    {
+        unsigned long long eventsDelivered = 0;
+        // Refused by -EventThrottle or -TimeLimit after the wait for them to reopen lost a race.
+        unsigned long long eventsDropped = 0;
+        double elapsedInSeconds = 0.0;
+    };
+
+    // Decoded events held in memory, handed to the callback over and over as fast as it takes
+    // them, from a thread of its own. Needs no provider, file or decoding, so it measures the
+    // filters, statistics and outputs alone.
+    //
+    // Events are handed over as they are, time stamps included. While -EventThrottle or -TimeLimit
+    // refuses events the source waits rather than spinning through them.
+    class MemoryEventSource : public EventSource
+    {
+    public:
+        // repeatCount: times to hand over every event; 0 repeats until stopped.
+        MemoryEventSource(
+            const std::vector<VfpEventData>& events,
+            unsigned long long repeatCount,
+            const FirewallEtwTraceCallback& callback,
+            const std::shared_ptr<EventCounter> eventCounter,
+            const std::shared_ptr<Timer> timer);
+
+        // Stops the source.
+        ~MemoryEventSource();
+
+        // Starts handing over events on a new thread.
+        void Start() override;
+
+        // Waits for the thread to finish the event in hand.
+        void Stop() override;
+
+        bool IsFinished() const override;
+
+        // Prints the events per second sustained.
+        void WriteResults() const override;
+
+        // Complete once IsFinished or Stop has returned.
+        MemoryEventSourceResults GetResults() const;
+
+        MemoryEventSource(MemoryEventSource const&) = delete;
+        MemoryEventSource& operator=(MemoryEventSource const&) = delete;
+
+    private:
+        std::vector<VfpEventData> m_Events;
+        unsigned long long m_RepeatCount;
+        std::unique_ptr<FirewallEtwTraceCallback> m_Callback;
+        std::shared_ptr<EventCounter> m_EventCounter;
+        std::shared_ptr<Timer> m_Timer;
+        std::thread m_Thread;
+        std::atomic<bool> m_Stopping;
+        std::atomic<bool> m_Finished;
+        MemoryEventSourceResults m_Results;
+
+        void Run();
+
+        // Sleeps while the callback would refuse events, until stopped.
+        void WaitWhileRefused();
+    };
+}
\ No newline at end of file
@@ -0,0 +1,291 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "RateHistory.h"
+#include "EventFormatter.h"
+
+namespace FirewallEventMonitor
+{
+    const char* RATE_DIRECTION_NAMES[RateHistory::DirectionCount] = { "Inbound", "Outbound", "Other" };
+    const char* RATE_RULE_TYPE_NAMES[RateHistory::RuleTypeCount] = { "Allow", "Deny", "Other" };
+    const char* RATE_PROTOCOL_NAMES[RateHistory::ProtocolCount] = { "TCP", "UDP", "ICMP", "Other" };
+    const char* RATE_RESOLUTION_NAMES[RateHistory::ResolutionCount] = { "second", "minute", "hour" };
+
+    const LONGLONG SECONDS_PER_MINUTE = 60;
+    const LONGLONG SECONDS_PER_HOUR = 3600;
+    // A longer gap between ticks (the machine slept) leaves nothing in any ring worth keeping.
+    const LONGLONG MAX_TICK_GAP_IN_SECONDS = SECONDS_PER_HOUR * RateHistory::HourSlots;
+
+    RateHistory::RateHistory()
+    {
+        for (auto& count : m_Current)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+        Clear();
+    }
+
+    void RateHistory::AddEvent(
+        const VfpEventData& eventData)
+    {
+        m_Current[GetCategory(eventData)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t RateHistory::GetCategory(
+        const VfpEventData& eventData)
+    {
+        size_t direction = 2;
+        if (eventData.direction == L"Inbound")
+        {
+            direction = 0;
+        }
+        else if (eventData.direction == L"Outbound")
+        {
+            direction = 1;
+        }
+
+        size_t ruleType = 2;
+        if (eventData.ruleType == L"Allow")
+        {
+            ruleType = 0;
+        }
+        else if (eventData.ruleType == L"Deny")
+        {
+            ruleType = 1;
+        }
+
+        size_t protocol = 3;
+        if (eventData.protocol == L"TCP")
+        {
+            protocol = 0;
+        }
+        else if (eventData.protocol == L"UDP")
+        {
+            protocol = 1;
+        }
+        else if (eventData.protocol == L"ICMPv4" ||
+            eventData.protocol == L"ICMPv6")
+        {
+            protocol = 2;
+        }
+
+        return (((direction * RuleTypeCount) + ruleType) * ProtocolCount) + protocol;
+    }
+
+    bool RateHistory::Tick(
+        LONGLONG now)
+    {
+        LONGLONG second = now / FileTimeTicksPerSecond;
+        if (m_OpenSecond == 0)
+        {
+            m_StartSecond = second;
+            m_OpenSecond = second;
+            return false;
+        }
+
+        if (second <= m_OpenSecond)
+        {
+            return false;
+        }
+
+        if (second - m_OpenSecond > MAX_TICK_GAP_IN_SECONDS)
+        {
+            Clear();
+            for (auto& count : m_Current)
+            {
+                count.store(0, std::memory_order_relaxed);
+            }
+            m_StartSecond = second;
+            m_OpenSecond = second;
+            return false;
+        }
+
+        // Everything counted since the previous tick goes to the open second; any further
+        // seconds skipped over were empty.
+        unsigned long long counts[CategoryCount];
+        for (size_t i = 0; i < CategoryCount; ++i)
+        {
+            counts[i] = m_Current[i].exchange(0, std::memory_order_relaxed);
+        }
+
+        bool minuteClosed = CloseSecond(counts);
+        memset(counts, 0, sizeof(counts));
+        while (m_OpenSecond < second)
+        {
+            minuteClosed |= CloseSecond(counts);
+        }
+
+        return minuteClosed;
+    }
+
+    bool RateHistory::CloseSecond(
+        const unsigned long long counts[CategoryCount])
+    {
+        LONGLONG second = m_OpenSecond++;
+
+        unsigned long long* slot = m_Seconds[second % SecondSlots];
+        for (size_t i = 0; i < CategoryCount; ++i)
+        {
+            slot[i] = counts[i];
+            m_OpenMinute[i] += counts[i];
+        }
+
+        if ((second + 1) % SECONDS_PER_MINUTE != 0)
+        {
+            return false;
+        }
+
+        LONGLONG minute = second / SECONDS_PER_MINUTE;
+        slot = m_Minutes[minute % MinuteSlots];
+        for (size_t i = 0; i < CategoryCount; ++i)
+        {
+            slot[i] = m_OpenMinute[i];
+            m_OpenHour[i] += m_OpenMinute[i];
+            m_OpenMinute[i] = 0;
+        }
+
+        if ((second + 1) % SECONDS_PER_HOUR == 0)
+        {
+            LONGLONG hour = second / SECONDS_PER_HOUR;
+            slot = m_Hours[hour % HourSlots];
+            for (size_t i = 0; i < CategoryCount; ++i)
+            {
+                slot[i] = m_OpenHour[i];
+                m_OpenHour[i] = 0;
+            }
+        }
+
+        return true;
+    }
+
+    void RateHistory::Clear()
+    {
+        memset(m_Seconds, 0, sizeof(m_Seconds));
+        memset(m_Minutes, 0, sizeof(m_Minutes));
+        memset(m_Hours, 0, sizeof(m_Hours));
+        memset(m_OpenMinute, 0, sizeof(m_OpenMinute));
+        memset(m_OpenHour, 0, sizeof(m_OpenHour));
+    }
+
+    unsigned long long RateHistory::GetCount(
+        Resolution resolution,
+        size_t periodsAgo,
+        size_t category) const
+    {
+        if (category >= CategoryCount ||
+            periodsAgo >= GetSlotCount(resolution) ||
+            static_cast<LONGLONG>(periodsAgo) >= GetClosedPeriods(resolution))
+        {
+            return 0;
+        }
+
+        LONGLONG period = GetNewestPeriod(resolution) - static_cast<LONGLONG>(periodsAgo);
+        switch (resolution)
+        {
+        case Second:
+            return m_Seconds[period % SecondSlots][category];
+        case Minute:
+            return m_Minutes[period % MinuteSlots][category];
+        default:
+            return m_Hours[period % HourSlots][category];
+        }
+    }
+
+    void RateHistory::FormatCsv(
+        _Inout_ std::string& buffer) const
+    {
+        buffer.append("resolution,time,direction,ruleType,protocol,count\r\n");
+
+        for (size_t r = 0; r < ResolutionCount; ++r)
+        {
+            Resolution resolution = static_cast<Resolution>(r);
+            LONGLONG closedPeriods = GetClosedPeriods(resolution);
+            LONGLONG periods = (closedPeriods < static_cast<LONGLONG>(GetSlotCount(resolution))) ?
+                closedPeriods :
+                static_cast<LONGLONG>(GetSlotCount(resolution));
+            LONGLONG newest = GetNewestPeriod(resolution);
+
+            for (LONGLONG ago = periods - 1; ago >= 0; --ago)
+            {
+                std::string time;
+                LONGLONG startSecond = (newest - ago) * GetSecondsPerPeriod(resolution);
+                EventFormatter::AppendTimestamp(startSecond * FileTimeTicksPerSecond, time);
+
+                for (size_t category = 0; category < CategoryCount; ++category)
+                {
+                    unsigned long long count = GetCount(resolution, static_cast<size_t>(ago), category);
+                    if (count == 0)
+                    {
+                        continue;
+                    }
+
+                    size_t protocol = category % ProtocolCount;
+                    size_t ruleType = (category / ProtocolCount) % RuleTypeCount;
+                    size_t direction = category / (ProtocolCount * RuleTypeCount);
+
+                    buffer.append(RATE_RESOLUTION_NAMES[resolution]);
+                    buffer.push_back(',');
+                    buffer.append(time);
+                    buffer.push_back(',');
+                    buffer.append(RATE_DIRECTION_NAMES[direction]);
+                    buffer.push_back(',');
+                    buffer.append(RATE_RULE_TYPE_NAMES[ruleType]);
+                    buffer.push_back(',');
+                    buffer.append(RATE_PROTOCOL_NAMES[protocol]);
+                    buffer.push_back(',');
+                    buffer.append(std::to_string(count));
+                    buffer.append("\r\n");
+                }
+            }
+        }
+    }
+
+    LONGLONG RateHistory::GetNewestPeriod(
+        Resolution resolution) const
+    {
+        // The newest closed period ends at or before the open second.
+        return (m_OpenSecond / GetSecondsPerPeriod(resolution)) - 1;
+    }
+
+    LONGLONG RateHistory::GetClosedPeriods(
+        Resolution resolution) const
+    {
+        if (m_OpenSecond == 0)
+        {
+            return 0;
+        }
+
+        // Periods that ended after the first tick; the first may be partial.
+        LONGLONG secondsPerPeriod = GetSecondsPerPeriod(resolution);
+        LONGLONG closedPeriods = (m_OpenSecond / secondsPerPeriod) - (m_StartSecond / secondsPerPeriod);
+        return (closedPeriods > 0) ? closedPeriods : 0;
+    }
+
+    LONGLONG RateHistory::GetSecondsPerPeriod(
+        Resolution resolution)
+    {
+        switch (resolution)
+        {
+        case Second:
+            return 1;
+        case Minute:
+            return SECONDS_PER_MINUTE;
+        default:
+            return SECONDS_PER_HOUR;
+        }
+    }
+
+    size_t RateHistory::GetSlotCount(
+        Resolution resolution)
+    {
+        switch (resolution)
+        {
+        case Second:
+            return SecondSlots;
+        case Minute:
+            return MinuteSlots;
+        default:
+            return HourSlots;
+        }
+    }
+}
\ No newline at end of file
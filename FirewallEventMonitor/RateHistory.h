@@ -0,0 +1,95 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <atomic>
+#include <string>
+
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    // Event counts over the last minute by second, the last hour by minute and the last day
+    // by hour, broken down by direction, rule type and protocol.
+    //
+    // The ETW callback only does a relaxed atomic increment. Tick, called from the main loop,
+    // moves those counts into the ring of seconds and folds each second into the running
+    // minute, and each minute into the running hour, as it closes. All memory is part of
+    // the object: nothing is allocated after construction.
+    class RateHistory
+    {
+    public:
+        enum Resolution
+        {
+            Second,
+            Minute,
+            Hour,
+            ResolutionCount
+        };
+
+        RateHistory();
+
+        void AddEvent(const VfpEventData& eventData);
+
+        // Closes every second before now (a FILETIME). Returns true if a minute was closed.
+        // Not thread safe with the other methods except AddEvent.
+        bool Tick(LONGLONG now);
+
+        // Count for one category over the period at periodsAgo (0 is the newest closed period).
+        // Categories are indexed by GetCategory.
+        unsigned long long GetCount(
+            Resolution resolution,
+            size_t periodsAgo,
+            size_t category) const;
+
+        // Appends a CSV header and one row per non-zero count, oldest first within each resolution.
+        void FormatCsv(_Inout_ std::string& buffer) const;
+
+        static size_t GetCategory(const VfpEventData& eventData);
+
+        // Constants
+        static const size_t DirectionCount = 3; // Inbound, Outbound, other.
+        static const size_t RuleTypeCount = 3; // Allow, Deny, other.
+        static const size_t ProtocolCount = 4; // TCP, UDP, ICMP, other.
+        static const size_t CategoryCount = DirectionCount * RuleTypeCount * ProtocolCount;
+        static const size_t SecondSlots = 60;
+        static const size_t MinuteSlots = 60;
+        static const size_t HourSlots = 24;
+        static const LONGLONG FileTimeTicksPerSecond = 10000000;
+
+        RateHistory(RateHistory const&) = delete;
+        RateHistory& operator=(RateHistory const&) = delete;
+
+    private:
+        // Counted by the callback since the last Tick.
+        std::atomic<unsigned long long> m_Current[CategoryCount];
+        // Rings of closed periods, indexed by period number modulo the ring size.
+        unsigned long long m_Seconds[SecondSlots][CategoryCount];
+        unsigned long long m_Minutes[MinuteSlots][CategoryCount];
+        unsigned long long m_Hours[HourSlots][CategoryCount];
+        // The minute and hour still being filled.
+        unsigned long long m_OpenMinute[CategoryCount];
+        unsigned long long m_OpenHour[CategoryCount];
+        // Seconds since 1601 (FILETIME epoch): the first tick, and the second still open.
+        LONGLONG m_StartSecond = 0;
+        LONGLONG m_OpenSecond = 0;
+
+        // Returns true if the second also closed a minute.
+        bool CloseSecond(const unsigned long long counts[CategoryCount]);
+
+        void Clear();
+
+        // Period number of the newest closed period, and the number of periods closed since the start.
+        LONGLONG GetNewestPeriod(Resolution resolution) const;
+
+        LONGLONG GetClosedPeriods(Resolution resolution) const;
+
+        static LONGLONG GetSecondsPerPeriod(Resolution resolution);
+
+        static size_t GetSlotCount(Resolution resolution);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "RealTimeEventSource.h"
+
+namespace FirewallEventMonitor
+{
+    const GUID VFP_PROVIDER_GUID = {
+        0x9F2660EA,
+        0xCFE7,
+        0x428F,
+        { 0x98, 0x50, 0xAE, 0xCA, 0x61, 0x26, 0x19, 0xB0 } };
+
+    const LPCWSTR TRACE_SESSION_NAME_PREFIX =
+        L"FirewallEventCaptureSession";
+
+    RealTimeEventSource::RealTimeEventSource(
+        const FirewallEtwTraceCallback& callback)
+        : m_EtwReader(callback),
+        m_Started(false)
+    {
+        m_ProviderGuids.push_back(VFP_PROVIDER_GUID);
+        GenerateTraceSessionName();
+    }
+
+    void RealTimeEventSource::Start()
+    {
+        // NULL szFileName to not create a file.
+        m_EtwReader.StartSession(m_TraceSessionName.c_str(), NULL, m_TraceSessionGuid);
+        m_Started = true;
+        m_EtwReader.EnableProviders(m_ProviderGuids);
+    }
+
+    void RealTimeEventSource::Stop()
+    {
+        if (!m_Started)
+        {
+            return;
+        }
+        m_Started = false;
+
+        m_EtwReader.DisableProviders(m_ProviderGuids);
+        m_EtwReader.StopSession();
+    }
+
+    bool RealTimeEventSource::IsFinished() const
+    {
+        return false;
+    }
+
+    void RealTimeEventSource::GenerateTraceSessionName()
+    {
+        m_TraceSessionName = TRACE_SESSION_NAME_PREFIX;
+
+        // Randomly generate a UUID for the TraceSession name and guid.
+        // This prevents collisions, allowing multiple instances of FirewallEventMontior to run simultaneously.
+        UUID uuid;
+        RPC_STATUS uuidcreate_status = UuidCreate(&uuid);
+        if (uuidcreate_status == RPC_S_OK)
+        {
+            m_TraceSessionGuid = uuid;
+
+            // convert UUID to wstring
+            WCHAR* wszUuid = NULL;
+            RPC_STATUS uuidtostring_status = UuidToStringW(&uuid, (RPC_WSTR*)&wszUuid);
+            // Make sure to free wszUuid
+            std::unique_ptr<WCHAR, ntl::WCharDeleter> free_string(wszUuid);
+
+            if (uuidtostring_status == RPC_S_OK &&
+                wszUuid != NULL)
+            {
+                m_TraceSessionName += L".";
+                m_TraceSessionName += wszUuid;
+            }
+            else
+            {
+                throw std::exception("Unable to convert UUID to wstring.");
+            }
+        }
+        else
+        {
+            throw std::exception("Unable to create UUID.");
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <string>
+#include <vector>
+// ntl headers
+#include "ntlEtwReader.hpp"
+
+#include "EventSource.h"
+#include "FirewallEtwTraceCallback.h"
+
+namespace FirewallEventMonitor
+{
+    // The VFP provider's events, delivered live by ETW on a real-time trace session of our own.
+    class RealTimeEventSource : public EventSource
+    {
+    public:
+        // Throws if the trace session cannot be named.
+        explicit RealTimeEventSource(const FirewallEtwTraceCallback& callback);
+
+        // Starts the trace session and enables the VFP provider on it.
+        void Start() override;
+
+        // Disables the provider and stops the session, which waits for the callback to return.
+        void Stop() override;
+
+        // A live session has no end.
+        bool IsFinished() const override;
+
+        RealTimeEventSource(RealTimeEventSource const&) = delete;
+        RealTimeEventSource& operator=(RealTimeEventSource const&) = delete;
+
+    private:
+        ntl::EtwReader<FirewallEtwTraceCallback> m_EtwReader;
+        std::vector<GUID> m_ProviderGuids;
+        std::wstring m_TraceSessionName;
+        GUID m_TraceSessionGuid;
+        bool m_Started;
+
+        void GenerateTraceSessionName();
+    };
+}
\ No newline at end of file
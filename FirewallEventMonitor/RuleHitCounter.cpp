@@ -0,0 +1,363 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "RuleHitCounter.h"
+#include "EventFormatter.h"
+// ntl headers
+#include "ntlLocks.hpp"
+// c++ headers
+#include <algorithm>
+
+namespace FirewallEventMonitor
+{
+    const char RULE_HEX_DIGITS[] = "0123456789abcdef";
+
+    // Offsets of the dashes in XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX.
+    const size_t RULE_ID_LENGTH = 36;
+    const size_t RULE_ID_DASHES[] = { 8, 13, 18, 23 };
+
+    int HexValue(wchar_t ch)
+    {
+        if (ch >= L'0' && ch <= L'9')
+        {
+            return ch - L'0';
+        }
+        if (ch >= L'a' && ch <= L'f')
+        {
+            return ch - L'a' + 10;
+        }
+        if (ch >= L'A' && ch <= L'F')
+        {
+            return ch - L'A' + 10;
+        }
+        return -1;
+    }
+
+    // Appends text right-aligned in width characters.
+    void AppendColumn(
+        const std::string& text,
+        size_t width,
+        _Inout_ std::string& buffer)
+    {
+        if (text.size() < width)
+        {
+            buffer.append(width - text.size(), ' ');
+        }
+        buffer.append(text);
+    }
+
+    RuleHitCounter::RuleHitCounter()
+        : m_Slots(new Slot[SlotCount]()),
+        m_RuleCount(0),
+        m_DroppedHits(0)
+    {
+        ::InitializeCriticalSectionEx(&m_SnapshotLock, 4000, 0);
+    }
+
+    RuleHitCounter::~RuleHitCounter()
+    {
+        ::DeleteCriticalSection(&m_SnapshotLock);
+    }
+
+    void RuleHitCounter::AddHit(
+        const VfpEventData& eventData)
+    {
+        GUID ruleId;
+        if (!ParseRuleId(eventData.ruleId, &ruleId))
+        {
+            ruleId = GUID{};
+        }
+
+        Slot* slot = FindOrAddSlot(ruleId);
+        if (slot == nullptr)
+        {
+            m_DroppedHits.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        // Only the counts need to be atomic; the snapshot does not order them against each other.
+        if (eventData.ruleType == L"Allow")
+        {
+            slot->allow.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (eventData.ruleType == L"Deny")
+        {
+            slot->deny.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (eventData.direction == L"Inbound")
+        {
+            slot->inbound.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (eventData.direction == L"Outbound")
+        {
+            slot->outbound.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void RuleHitCounter::Snapshot(
+        _Inout_ std::vector<RuleHitCounts>& deltas)
+    {
+        ntl::AutoReleaseCriticalSection csScoped(&m_SnapshotLock);
+
+        deltas.clear();
+        if (m_Previous.empty())
+        {
+            m_Previous.resize(SlotCount);
+        }
+
+        for (size_t i = 0; i < SlotCount; ++i)
+        {
+            Slot& slot = m_Slots[i];
+            if (slot.state.load(std::memory_order_acquire) != SlotReady)
+            {
+                continue;
+            }
+
+            RuleHitCounts current;
+            current.ruleId = slot.ruleId;
+            current.allow = slot.allow.load(std::memory_order_relaxed);
+            current.deny = slot.deny.load(std::memory_order_relaxed);
+            current.inbound = slot.inbound.load(std::memory_order_relaxed);
+            current.outbound = slot.outbound.load(std::memory_order_relaxed);
+
+            RuleHitCounts& previous = m_Previous[i];
+            RuleHitCounts delta;
+            delta.ruleId = current.ruleId;
+            delta.allow = current.allow - previous.allow;
+            delta.deny = current.deny - previous.deny;
+            delta.inbound = current.inbound - previous.inbound;
+            delta.outbound = current.outbound - previous.outbound;
+            previous = current;
+
+            if (delta.GetHits() > 0 ||
+                delta.inbound + delta.outbound > 0)
+            {
+                deltas.push_back(delta);
+            }
+        }
+
+        std::sort(deltas.begin(), deltas.end(), [](const RuleHitCounts& lhs, const RuleHitCounts& rhs)
+        {
+            return lhs.GetHits() > rhs.GetHits();
+        });
+    }
+
+    unsigned long long RuleHitCounter::GetDroppedHits() const
+    {
+        return m_DroppedHits.load(std::memory_order_relaxed);
+    }
+
+    RuleHitCounter::Slot* RuleHitCounter::FindOrAddSlot(
+        const GUID& ruleId)
+    {
+        const size_t mask = SlotCount - 1;
+        size_t index = HashRuleId(ruleId) & mask;
+        for (size_t probes = 0; probes < SlotCount; ++probes, index = (index + 1) & mask)
+        {
+            Slot& slot = m_Slots[index];
+            long state = slot.state.load(std::memory_order_acquire);
+
+            if (state == SlotEmpty)
+            {
+                // Keep the table at most half full so probe runs stay short.
+                if (m_RuleCount.load(std::memory_order_relaxed) >= MaxRules)
+                {
+                    return nullptr;
+                }
+
+                long expected = SlotEmpty;
+                if (slot.state.compare_exchange_strong(expected, SlotClaimed, std::memory_order_acquire))
+                {
+                    slot.ruleId = ruleId;
+                    m_RuleCount.fetch_add(1, std::memory_order_relaxed);
+                    slot.state.store(SlotReady, std::memory_order_release);
+                    return &slot;
+                }
+                state = expected;
+            }
+
+            // Another thread is writing the id of a new rule into this slot.
+            while (state == SlotClaimed)
+            {
+                YieldProcessor();
+                state = slot.state.load(std::memory_order_acquire);
+            }
+
+            if (memcmp(&slot.ruleId, &ruleId, sizeof(GUID)) == 0)
+            {
+                return &slot;
+            }
+        }
+
+        return nullptr;
+    }
+
+    size_t RuleHitCounter::HashRuleId(
+        const GUID& ruleId)
+    {
+        unsigned long long halves[2];
+        static_assert(sizeof(halves) == sizeof(GUID), "GUID is 16 bytes");
+        memcpy_s(halves, sizeof(halves), &ruleId, sizeof(ruleId));
+
+        unsigned long long hash = halves[0] ^ (halves[1] * 0x9E3779B97F4A7C15ull);
+        hash ^= hash >> 32;
+        hash *= 0xD6E8FEB86659FD93ull;
+        hash ^= hash >> 32;
+        return static_cast<size_t>(hash);
+    }
+
+    bool RuleHitCounter::ParseRuleId(
+        const std::wstring& ruleId,
+        _Out_ GUID* guid)
+    {
+        const wchar_t* text = ruleId.c_str();
+        size_t length = ruleId.size();
+        if (length == RULE_ID_LENGTH + 2 &&
+            text[0] == L'{' &&
+            text[length - 1] == L'}')
+        {
+            ++text;
+            length -= 2;
+        }
+
+        if (length != RULE_ID_LENGTH)
+        {
+            return false;
+        }
+
+        unsigned char bytes[16];
+        size_t byteCount = 0;
+        size_t dash = 0;
+        for (size_t i = 0; i < RULE_ID_LENGTH;)
+        {
+            if (dash < ARRAYSIZE(RULE_ID_DASHES) && i == RULE_ID_DASHES[dash])
+            {
+                if (text[i] != L'-')
+                {
+                    return false;
+                }
+                ++dash;
+                ++i;
+                continue;
+            }
+
+            int high = HexValue(text[i]);
+            int low = HexValue(text[i + 1]);
+            if (high < 0 || low < 0)
+            {
+                return false;
+            }
+            bytes[byteCount++] = static_cast<unsigned char>((high << 4) | low);
+            i += 2;
+        }
+
+        // Data1-3 are written most significant byte first.
+        guid->Data1 =
+            (static_cast<unsigned long>(bytes[0]) << 24) |
+            (static_cast<unsigned long>(bytes[1]) << 16) |
+            (static_cast<unsigned long>(bytes[2]) << 8) |
+            bytes[3];
+        guid->Data2 = static_cast<unsigned short>((bytes[4] << 8) | bytes[5]);
+        guid->Data3 = static_cast<unsigned short>((bytes[6] << 8) | bytes[7]);
+        memcpy_s(guid->Data4, sizeof(guid->Data4), bytes + 8, 8);
+        return true;
+    }
+
+    void RuleHitCounter::AppendRuleId(
+        const GUID& ruleId,
+        _Inout_ std::string& buffer)
+    {
+        auto appendHex = [&buffer](unsigned long value, size_t digits)
+        {
+            for (size_t i = digits; i > 0; --i)
+            {
+                buffer.push_back(RULE_HEX_DIGITS[(value >> ((i - 1) * 4)) & 0xF]);
+            }
+        };
+
+        appendHex(ruleId.Data1, 8);
+        buffer.push_back('-');
+        appendHex(ruleId.Data2, 4);
+        buffer.push_back('-');
+        appendHex(ruleId.Data3, 4);
+        buffer.push_back('-');
+        appendHex(ruleId.Data4[0], 2);
+        appendHex(ruleId.Data4[1], 2);
+        buffer.push_back('-');
+        for (size_t i = 2; i < 8; ++i)
+        {
+            appendHex(ruleId.Data4[i], 2);
+        }
+    }
+
+    void RuleHitCounter::FormatTable(
+        const std::vector<RuleHitCounts>& deltas,
+        unsigned long intervalInSeconds,
+        _Inout_ std::string& buffer)
+    {
+        buffer.append("Rule hits in the last ");
+        buffer.append(std::to_string(intervalInSeconds));
+        buffer.append(" seconds:\r\n");
+
+        if (deltas.empty())
+        {
+            buffer.append("  none\r\n\r\n");
+            return;
+        }
+
+        const size_t columnWidth = 11;
+        const char* columns[] = { "Hits", "Allow", "Deny", "Inbound", "Outbound" };
+
+        buffer.append("  Rule Id");
+        buffer.append(RULE_ID_LENGTH - 7, ' ');
+        for (const auto column : columns)
+        {
+            AppendColumn(column, columnWidth, buffer);
+        }
+        buffer.append("\r\n");
+
+        for (const auto& delta : deltas)
+        {
+            buffer.append("  ");
+            AppendRuleId(delta.ruleId, buffer);
+            AppendColumn(std::to_string(delta.GetHits()), columnWidth, buffer);
+            AppendColumn(std::to_string(delta.allow), columnWidth, buffer);
+            AppendColumn(std::to_string(delta.deny), columnWidth, buffer);
+            AppendColumn(std::to_string(delta.inbound), columnWidth, buffer);
+            AppendColumn(std::to_string(delta.outbound), columnWidth, buffer);
+            buffer.append("\r\n");
+        }
+        buffer.append("\r\n");
+    }
+
+    void RuleHitCounter::FormatCsv(
+        const std::vector<RuleHitCounts>& deltas,
+        LONGLONG timeStamp,
+        _Inout_ std::string& buffer)
+    {
+        std::string time;
+        EventFormatter::AppendTimestamp(timeStamp, time);
+        for (const auto& delta : deltas)
+        {
+            buffer.append(time);
+            buffer.push_back(',');
+            AppendRuleId(delta.ruleId, buffer);
+            buffer.push_back(',');
+            buffer.append(std::to_string(delta.allow));
+            buffer.push_back(',');
+            buffer.append(std::to_string(delta.deny));
+            buffer.push_back(',');
+            buffer.append(std::to_string(delta.inbound));
+            buffer.push_back(',');
+            buffer.append(std::to_string(delta.outbound));
+            buffer.append("\r\n");
+        }
+    }
+
+    void RuleHitCounter::FormatCsvHeader(
+        _Inout_ std::string& buffer)
+    {
+        buffer.append("time,ruleId,allow,deny,inbound,outbound\r\n");
+    }
+}
\ No newline at end of file
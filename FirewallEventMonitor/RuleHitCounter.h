@@ -0,0 +1,117 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    // Hits for one rule, as totals or as the change between two snapshots.
+    struct RuleHitCounts
+    {
+    public:
+        GUID ruleId = {};
+        unsigned long long allow = 0;
+        unsigned long long deny = 0;
+        unsigned long long inbound = 0;
+        unsigned long long outbound = 0;
+
+        unsigned long long GetHits() const
+        {
+            return allow + deny;
+        }
+    };
+
+    // Live per-rule hit counters, keyed by the binary RuleId.
+    //
+    // The ETW callback counts every event with relaxed atomic increments into a fixed
+    // open-addressing table; no lock is taken once a rule has been seen. Snapshot runs on
+    // another thread and reports the change since the previous snapshot.
+    class RuleHitCounter
+    {
+    public:
+        RuleHitCounter();
+
+        ~RuleHitCounter();
+
+        // Counts the event against its rule. Rule ids that are not GUIDs are counted under GUID_NULL.
+        void AddHit(const VfpEventData& eventData);
+
+        // Replaces deltas with the hits of every rule since the previous call, busiest rule first.
+        // Rules without new hits are left out.
+        void Snapshot(_Inout_ std::vector<RuleHitCounts>& deltas);
+
+        // Hits not counted because the table was full.
+        unsigned long long GetDroppedHits() const;
+
+        // Parses XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX, with or without braces.
+        static bool ParseRuleId(
+            const std::wstring& ruleId,
+            _Out_ GUID* guid);
+
+        // Appends a fixed-width table of deltas for the console.
+        static void FormatTable(
+            const std::vector<RuleHitCounts>& deltas,
+            unsigned long intervalInSeconds,
+            _Inout_ std::string& buffer);
+
+        // Appends one CSV row per rule, in the columns of FormatCsvHeader.
+        static void FormatCsv(
+            const std::vector<RuleHitCounts>& deltas,
+            LONGLONG timeStamp,
+            _Inout_ std::string& buffer);
+
+        static void FormatCsvHeader(_Inout_ std::string& buffer);
+
+        // Appends the rule id in lower case, without braces.
+        static void AppendRuleId(
+            const GUID& ruleId,
+            _Inout_ std::string& buffer);
+
+        // Constants
+        static const size_t SlotCount = 16384; // Power of two.
+        static const size_t MaxRules = SlotCount / 2;
+
+        RuleHitCounter(RuleHitCounter const&) = delete;
+        RuleHitCounter& operator=(RuleHitCounter const&) = delete;
+
+    private:
+        enum SlotState : long
+        {
+            SlotEmpty = 0,
+            SlotClaimed = 1, // ruleId is being written.
+            SlotReady = 2,
+        };
+
+        struct Slot
+        {
+            std::atomic<long> state;
+            GUID ruleId;
+            std::atomic<unsigned long long> allow;
+            std::atomic<unsigned long long> deny;
+            std::atomic<unsigned long long> inbound;
+            std::atomic<unsigned long long> outbound;
+        };
+
+        std::unique_ptr<Slot[]> m_Slots;
+        std::atomic<size_t> m_RuleCount;
+        std::atomic<unsigned long long> m_DroppedHits;
+        // Totals at the previous snapshot, by slot. Guarded by m_SnapshotLock.
+        CRITICAL_SECTION m_SnapshotLock;
+        std::vector<RuleHitCounts> m_Previous;
+
+        // Returns the slot for ruleId, claiming an empty one for a new rule. Null if the table is full.
+        Slot* FindOrAddSlot(const GUID& ruleId);
+
+        static size_t HashRuleId(const GUID& ruleId);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,320 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "SegmentFormat.h"
+// c++ headers
+#include <algorithm>
+#include <climits>
+
+namespace FirewallEventMonitor
+{
+    const LPCSTR CORRUPT_SEGMENT_MESSAGE = "Segment footer is corrupt";
+
+    void ReadSegmentBytes(
+        const char*& data,
+        const char* end,
+        _Out_writes_bytes_(length) void* destination,
+        size_t length)
+    {
+        if (length > static_cast<size_t>(end - data))
+        {
+            throw std::exception(CORRUPT_SEGMENT_MESSAGE);
+        }
+
+        memcpy_s(destination, length, data, length);
+        data += length;
+    }
+
+    unsigned long long ReadSegmentVarint(
+        const char*& data,
+        const char* end)
+    {
+        unsigned long long value;
+        if (!Varint::Read(data, end, &value))
+        {
+            throw std::exception(CORRUPT_SEGMENT_MESSAGE);
+        }
+        return value;
+    }
+
+    //
+    // SegmentFooter
+    //
+
+    SegmentFooter::SegmentFooter()
+    {
+        memset(minSource.bytes, 0xFF, sizeof(minSource.bytes));
+        memset(maxSource.bytes, 0, sizeof(maxSource.bytes));
+        minDestination = minSource;
+        maxDestination = maxSource;
+        minSourcePort = ULONG_MAX;
+        minDestinationPort = ULONG_MAX;
+    }
+
+    void SegmentFooter::Encode(
+        _Inout_ std::string& buffer) const
+    {
+        Varint::Append(eventCount, buffer);
+        Varint::Append(Varint::ZigZag(minTimeStamp), buffer);
+        Varint::Append(Varint::ZigZag(maxTimeStamp), buffer);
+
+        for (const auto key : { &minSource, &maxSource, &minDestination, &maxDestination })
+        {
+            buffer.append(reinterpret_cast<const char*>(key->bytes), sizeof(key->bytes));
+        }
+
+        Varint::Append(minSourcePort, buffer);
+        Varint::Append(maxSourcePort, buffer);
+        Varint::Append(minDestinationPort, buffer);
+        Varint::Append(maxDestinationPort, buffer);
+        Varint::Append(addresslessEvents, buffer);
+
+        sources.Encode(buffer);
+        destinations.Encode(buffer);
+        ruleIds.Encode(buffer);
+    }
+
+    void SegmentFooter::Decode(
+        _In_reads_bytes_(length) const char* data,
+        size_t length)
+    {
+        const char* end = data + length;
+
+        eventCount = ReadSegmentVarint(data, end);
+        minTimeStamp = Varint::UnZigZag(ReadSegmentVarint(data, end));
+        maxTimeStamp = Varint::UnZigZag(ReadSegmentVarint(data, end));
+
+        for (const auto key : { &minSource, &maxSource, &minDestination, &maxDestination })
+        {
+            ReadSegmentBytes(data, end, key->bytes, sizeof(key->bytes));
+        }
+
+        for (const auto port : { &minSourcePort, &maxSourcePort, &minDestinationPort, &maxDestinationPort })
+        {
+            unsigned long long value = ReadSegmentVarint(data, end);
+            if (value > ULONG_MAX)
+            {
+                throw std::exception(CORRUPT_SEGMENT_MESSAGE);
+            }
+            *port = static_cast<unsigned long>(value);
+        }
+        addresslessEvents = ReadSegmentVarint(data, end);
+
+        sources.Decode(data, end);
+        destinations.Decode(data, end);
+        ruleIds.Decode(data, end);
+        // Fields appended by later versions are ignored.
+    }
+
+    size_t SegmentFooter::DecodeTrailer(
+        _In_reads_bytes_(SegmentTrailerSize) const char* trailer)
+    {
+        const char* magic = trailer + sizeof(UINT32);
+        if (memcmp(magic, SegmentMagic, sizeof(SegmentMagic)) != 0)
+        {
+            throw std::exception("File is not an event segment");
+        }
+
+        if (static_cast<unsigned char>(magic[sizeof(SegmentMagic)]) != SegmentVersion)
+        {
+            throw std::exception("Event segment version is not supported");
+        }
+
+        const unsigned char* length = reinterpret_cast<const unsigned char*>(trailer);
+        return static_cast<size_t>(length[0]) |
+            (static_cast<size_t>(length[1]) << 8) |
+            (static_cast<size_t>(length[2]) << 16) |
+            (static_cast<size_t>(length[3]) << 24);
+    }
+
+    size_t SegmentFooter::DecodeSegment(
+        _In_reads_bytes_(length) const char* data,
+        size_t length,
+        _Out_ SegmentFooter* footer)
+    {
+        if (length < BinaryLogHeaderSize + SegmentTrailerSize)
+        {
+            throw std::exception("File is not an event segment");
+        }
+
+        size_t footerLength = DecodeTrailer(data + length - SegmentTrailerSize);
+        if (footerLength > length - SegmentTrailerSize - BinaryLogHeaderSize)
+        {
+            throw std::exception(CORRUPT_SEGMENT_MESSAGE);
+        }
+
+        size_t bodyLength = length - SegmentTrailerSize - footerLength;
+        footer->Decode(data + bodyLength, footerLength);
+        return bodyLength;
+    }
+
+    bool SegmentFooter::InRange(
+        const EventKey& key,
+        const EventKey& minimum,
+        const EventKey& maximum)
+    {
+        return memcmp(key.bytes, minimum.bytes, sizeof(key.bytes)) >= 0 &&
+            memcmp(key.bytes, maximum.bytes, sizeof(key.bytes)) <= 0;
+    }
+
+    //
+    // SegmentBuilder
+    //
+
+    SegmentBuilder::SegmentBuilder()
+    {
+        m_SourceHashes.reserve(DefaultEventsPerSegment);
+        m_DestinationHashes.reserve(DefaultEventsPerSegment);
+        m_RuleIdHashes.reserve(DefaultEventsPerSegment);
+        Reset();
+    }
+
+    void SegmentBuilder::Add(
+        const VfpEventData& eventData)
+    {
+        m_Encoder.Encode(eventData, m_Body);
+
+        LONGLONG lastTimeStamp = (std::max)(eventData.timeStamp, eventData.lastTimeStamp);
+        if (m_Footer.eventCount == 0)
+        {
+            m_Footer.minTimeStamp = eventData.timeStamp;
+            m_Footer.maxTimeStamp = lastTimeStamp;
+        }
+        else
+        {
+            m_Footer.minTimeStamp = (std::min)(m_Footer.minTimeStamp, eventData.timeStamp);
+            m_Footer.maxTimeStamp = (std::max)(m_Footer.maxTimeStamp, lastTimeStamp);
+        }
+        ++m_Footer.eventCount;
+
+        if (AddAddress(eventData.source, m_Footer.minSource, m_Footer.maxSource))
+        {
+            m_SourceHashes.push_back(EventKeys::Hash(m_Key));
+        }
+        if (AddAddress(eventData.destination, m_Footer.minDestination, m_Footer.maxDestination))
+        {
+            m_DestinationHashes.push_back(EventKeys::Hash(m_Key));
+        }
+        if (eventData.source.empty() ||
+            eventData.destination.empty())
+        {
+            ++m_Footer.addresslessEvents;
+        }
+
+        if (EventKeys::ParseRuleId(eventData.ruleId, &m_Key))
+        {
+            m_RuleIdHashes.push_back(EventKeys::Hash(m_Key));
+        }
+
+        AddPort(eventData.sourcePort, m_Footer.minSourcePort, m_Footer.maxSourcePort);
+        AddPort(eventData.destinationPort, m_Footer.minDestinationPort, m_Footer.maxDestinationPort);
+    }
+
+    void SegmentBuilder::Seal(
+        _Inout_ std::string& segment)
+    {
+        m_Footer.sources = BuildFilter(m_SourceHashes);
+        m_Footer.destinations = BuildFilter(m_DestinationHashes);
+        m_Footer.ruleIds = BuildFilter(m_RuleIdHashes);
+
+        segment.append(m_Body);
+
+        size_t footerStart = segment.size();
+        m_Footer.Encode(segment);
+        size_t footerLength = segment.size() - footerStart;
+        if (footerLength > ULONG_MAX)
+        {
+            throw std::exception("Segment footer is too large");
+        }
+
+        for (unsigned int shift = 0; shift < 32; shift += 8)
+        {
+            segment.push_back(static_cast<char>((footerLength >> shift) & 0xFF));
+        }
+        segment.append(SegmentMagic, sizeof(SegmentMagic));
+        segment.push_back(static_cast<char>(SegmentVersion));
+
+        Reset();
+    }
+
+    unsigned long long SegmentBuilder::GetEventCount() const
+    {
+        return m_Footer.eventCount;
+    }
+
+    void SegmentBuilder::Reset()
+    {
+        m_Body.clear();
+        m_Encoder.Reset(m_Body);
+        m_Footer = SegmentFooter();
+        m_SourceHashes.clear();
+        m_DestinationHashes.clear();
+        m_RuleIdHashes.clear();
+    }
+
+    bool SegmentBuilder::AddAddress(
+        const std::wstring& address,
+        _Inout_ EventKey& minimum,
+        _Inout_ EventKey& maximum)
+    {
+        if (!EventKeys::ParseAddress(address, &m_Key))
+        {
+            return false;
+        }
+
+        if (memcmp(m_Key.bytes, minimum.bytes, sizeof(m_Key.bytes)) < 0)
+        {
+            minimum = m_Key;
+        }
+        if (memcmp(m_Key.bytes, maximum.bytes, sizeof(m_Key.bytes)) > 0)
+        {
+            maximum = m_Key;
+        }
+        return true;
+    }
+
+    void SegmentBuilder::AddPort(
+        const std::wstring& port,
+        _Inout_ unsigned long& minimum,
+        _Inout_ unsigned long& maximum)
+    {
+        if (port.empty() ||
+            port.size() > 5)
+        {
+            return;
+        }
+
+        unsigned long value = 0;
+        for (auto ch : port)
+        {
+            if (ch < L'0' || ch > L'9')
+            {
+                return;
+            }
+            value = (value * 10) + (ch - L'0');
+        }
+
+        if (value < minimum)
+        {
+            minimum = value;
+        }
+        if (value > maximum)
+        {
+            maximum = value;
+        }
+    }
+
+    BloomFilter SegmentBuilder::BuildFilter(
+        _Inout_ std::vector<unsigned long long>& hashes)
+    {
+        std::sort(hashes.begin(), hashes.end());
+        hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+        BloomFilter filter(hashes.size());
+        for (const auto hash : hashes)
+        {
+            filter.Add(hash);
+        }
+        return filter;
+    }
+}
\ No newline at end of file
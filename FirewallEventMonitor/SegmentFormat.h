@@ -0,0 +1,129 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <string>
+#include <vector>
+
+#include "BinaryEventFormat.h"
+#include "BloomFilter.h"
+#include "EventKeys.h"
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    //
+    // Segment layout (.seg):
+    //   body    : a complete binary event log (see BinaryEventFormat.h).
+    //   footer  : SegmentFooter::Encode.
+    //   trailer : 4-byte little-endian footer length, SegmentMagic, SegmentVersion.
+    //
+    // A segment is written once, whole, and never appended to. Queries read the trailer
+    // and footer first and only decode the body when the footer says it may hold a match.
+    //
+    const char SegmentMagic[7] = { 'F', 'W', 'E', 'M', 'S', 'E', 'G' };
+    const unsigned char SegmentVersion = 1;
+    const size_t SegmentTrailerSize = sizeof(UINT32) + sizeof(SegmentMagic) + sizeof(SegmentVersion);
+    const LPCWSTR SegmentFileExtension = L".seg";
+
+    // Zone map and bloom filters of a segment's events.
+    //
+    // Addresses are compared as EventKeys::ParseAddress keys and the filters hold
+    // EventKeys::Hash values, so both are part of the file format.
+    struct SegmentFooter
+    {
+    public:
+        SegmentFooter();
+
+        unsigned long long eventCount = 0;
+        // Flow records count up to their last timestamp.
+        LONGLONG minTimeStamp = 0;
+        LONGLONG maxTimeStamp = 0;
+        // Empty ranges (min above max) when no address or port parsed.
+        EventKey minSource;
+        EventKey maxSource;
+        EventKey minDestination;
+        EventKey maxDestination;
+        unsigned long minSourcePort = 0;
+        unsigned long maxSourcePort = 0;
+        unsigned long minDestinationPort = 0;
+        unsigned long maxDestinationPort = 0;
+        // Events with an empty source or destination, which pass any address filter.
+        unsigned long long addresslessEvents = 0;
+        BloomFilter sources;
+        BloomFilter destinations;
+        BloomFilter ruleIds;
+
+        void Encode(_Inout_ std::string& buffer) const;
+
+        // Throws if the footer is malformed.
+        void Decode(
+            _In_reads_bytes_(length) const char* data,
+            size_t length);
+
+        // Validates the SegmentTrailerSize bytes at trailer and returns the footer length.
+        // Throws if they are not a segment trailer.
+        static size_t DecodeTrailer(_In_reads_bytes_(SegmentTrailerSize) const char* trailer);
+
+        // Decodes the footer of a whole segment in memory and returns the body length.
+        static size_t DecodeSegment(
+            _In_reads_bytes_(length) const char* data,
+            size_t length,
+            _Out_ SegmentFooter* footer);
+
+        // Whether key lies within [minimum, maximum].
+        static bool InRange(
+            const EventKey& key,
+            const EventKey& minimum,
+            const EventKey& maximum);
+    };
+
+    // Encodes events into a segment body while keeping its footer up to date.
+    class SegmentBuilder
+    {
+    public:
+        SegmentBuilder();
+
+        void Add(const VfpEventData& eventData);
+
+        // Appends body, footer and trailer to segment, then starts a new, empty segment.
+        void Seal(_Inout_ std::string& segment);
+
+        unsigned long long GetEventCount() const;
+
+        // Constants
+        static const size_t DefaultEventsPerSegment = 64 * 1024;
+
+        SegmentBuilder(SegmentBuilder const&) = delete;
+        SegmentBuilder& operator=(SegmentBuilder const&) = delete;
+
+    private:
+        BinaryEventEncoder m_Encoder;
+        std::string m_Body;
+        SegmentFooter m_Footer;
+        // Hashes for the bloom filters, which are sized for the distinct count at Seal.
+        std::vector<unsigned long long> m_SourceHashes;
+        std::vector<unsigned long long> m_DestinationHashes;
+        std::vector<unsigned long long> m_RuleIdHashes;
+        EventKey m_Key;
+
+        void Reset();
+
+        // Returns false for an empty or unparsable key; fills m_Key and widens the range.
+        bool AddAddress(
+            const std::wstring& address,
+            _Inout_ EventKey& minimum,
+            _Inout_ EventKey& maximum);
+
+        static void AddPort(
+            const std::wstring& port,
+            _Inout_ unsigned long& minimum,
+            _Inout_ unsigned long& maximum);
+
+        static BloomFilter BuildFilter(_Inout_ std::vector<unsigned long long>& hashes);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,403 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "SegmentQuery.h"
+#include "BinaryEventFormat.h"
+#include "ConsoleOutput.h"
+#include "EventFormatter.h"
+#include "FileLogger.h"
+// ntl headers
+#include "ntlString.hpp"
+// c++ headers
+#include <algorithm>
+
+namespace FirewallEventMonitor
+{
+    const LPCWSTR SEGMENT_FILE_PATTERN =
+        L"FirewallEventMonitor.*.seg";
+
+    // Matches are printed once this much text has built up.
+    const size_t QUERY_OUTPUT_BUFFER_SIZE = 1024 * 1024;
+
+    void ReadSegmentFile(
+        HANDLE file,
+        unsigned long long offset,
+        _Out_writes_bytes_(length) char* buffer,
+        size_t length)
+    {
+        LARGE_INTEGER position;
+        position.QuadPart = static_cast<LONGLONG>(offset);
+        if (!::SetFilePointerEx(file, position, NULL, FILE_BEGIN))
+        {
+            throw std::exception("Seeking in segment file failed");
+        }
+
+        while (length > 0)
+        {
+            DWORD chunk = length > MAXDWORD ? MAXDWORD : static_cast<DWORD>(length);
+            DWORD bytesRead = 0;
+            if (!::ReadFile(file, buffer, chunk, &bytesRead, NULL) ||
+                bytesRead == 0)
+            {
+                throw std::exception("Reading segment file failed");
+            }
+            buffer += bytesRead;
+            length -= bytesRead;
+        }
+    }
+
+    void WriteQueryOutput(
+        _Inout_ std::string& text)
+    {
+        WriteConsoleUtf8(text);
+        text.clear();
+    }
+
+    // Parses a port as the segment footer does (see SegmentBuilder::AddPort).
+    bool ParseSegmentPort(
+        const std::wstring& port,
+        _Out_ unsigned long* value)
+    {
+        *value = 0;
+        if (port.empty() ||
+            port.size() > 5)
+        {
+            return false;
+        }
+
+        for (auto ch : port)
+        {
+            if (ch < L'0' || ch > L'9')
+            {
+                return false;
+            }
+            *value = (*value * 10) + (ch - L'0');
+        }
+        return true;
+    }
+
+    SegmentQuery::SegmentQuery(
+        const EventPredicate& predicate)
+        : m_Predicate(predicate)
+    {
+        EventKey key;
+
+        const auto& ipAddressFilters = m_Predicate.GetIpAddressFilters();
+        m_AddressesIndexed = !ipAddressFilters.empty();
+        for (const auto& address : ipAddressFilters)
+        {
+            if (!EventKeys::ParseAddress(address, &key))
+            {
+                m_AddressesIndexed = false;
+                break;
+            }
+            m_AddressKeys.push_back(key);
+            m_AddressHashes.push_back(EventKeys::Hash(key));
+        }
+
+        const auto& ruleIdFilters = m_Predicate.GetRuleIdFilters();
+        m_RuleIdsIndexed = !ruleIdFilters.empty();
+        for (const auto& ruleId : ruleIdFilters)
+        {
+            if (!EventKeys::ParseRuleId(ruleId, &key))
+            {
+                m_RuleIdsIndexed = false;
+                break;
+            }
+            m_RuleIdHashes.push_back(EventKeys::Hash(key));
+        }
+
+        const auto& portFilters = m_Predicate.GetPortFilters();
+        m_PortsIndexed = !portFilters.empty();
+        for (const auto& port : portFilters)
+        {
+            unsigned long value = 0;
+            if (!ParseSegmentPort(port, &value))
+            {
+                m_PortsIndexed = false;
+                break;
+            }
+            m_Ports.push_back(value);
+        }
+    }
+
+    bool SegmentQuery::CanMatch(
+        const SegmentFooter& footer) const
+    {
+        if (footer.eventCount == 0 ||
+            footer.maxTimeStamp < m_Predicate.GetMinimumTimeStamp())
+        {
+            return false;
+        }
+
+        if (m_RuleIdsIndexed)
+        {
+            auto found = std::find_if(m_RuleIdHashes.begin(), m_RuleIdHashes.end(), [&](unsigned long long hash)
+            {
+                return footer.ruleIds.MayContain(hash);
+            });
+            if (found == m_RuleIdHashes.end())
+            {
+                return false;
+            }
+        }
+
+        // An event without a source or destination passes any address filter.
+        if (m_AddressesIndexed &&
+            footer.addresslessEvents == 0)
+        {
+            bool addressFound = false;
+            for (size_t i = 0; i < m_AddressKeys.size() && !addressFound; ++i)
+            {
+                addressFound =
+                    (SegmentFooter::InRange(m_AddressKeys[i], footer.minSource, footer.maxSource) &&
+                        footer.sources.MayContain(m_AddressHashes[i])) ||
+                    (SegmentFooter::InRange(m_AddressKeys[i], footer.minDestination, footer.maxDestination) &&
+                        footer.destinations.MayContain(m_AddressHashes[i]));
+            }
+            if (!addressFound)
+            {
+                return false;
+            }
+        }
+
+        // Events without ports never pass a port filter (see EventPredicate::Matches).
+        if (m_PortsIndexed)
+        {
+            auto found = std::find_if(m_Ports.begin(), m_Ports.end(), [&](unsigned long port)
+            {
+                return (port >= footer.minSourcePort && port <= footer.maxSourcePort) ||
+                    (port >= footer.minDestinationPort && port <= footer.maxDestinationPort);
+            });
+            if (found == m_Ports.end())
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool SegmentQuery::Matches(
+        const VfpEventData& eventData) const
+    {
+        return m_Predicate.Matches(eventData);
+    }
+
+    void SegmentQuery::QueryBody(
+        _In_reads_bytes_(length) const char* data,
+        size_t length,
+        _Inout_ std::string& text,
+        _Inout_ SegmentQueryResults& results) const
+    {
+        BinaryEventDecoder decoder;
+        size_t offset = BinaryEventDecoder::DecodeHeader(data, length);
+
+        VfpEventData eventData;
+        Utf8EventData utf8EventData;
+        while (offset < length)
+        {
+            bool eventDecoded = false;
+            size_t consumed = decoder.DecodeRecord(data + offset, length - offset, &eventData, &eventDecoded);
+            if (consumed == 0)
+            {
+                throw std::exception("Segment ends with an incomplete record");
+            }
+            offset += consumed;
+
+            if (!eventDecoded)
+            {
+                continue;
+            }
+
+            ++results.eventsScanned;
+            if (Matches(eventData))
+            {
+                ++results.eventsMatched;
+                EventFormatter::ConvertToUtf8(eventData, utf8EventData);
+                EventFormatter::FormatText(utf8EventData, text);
+            }
+        }
+    }
+
+    void SegmentQuery::QuerySegment(
+        _In_reads_bytes_(length) const char* data,
+        size_t length,
+        _Inout_ std::string& text,
+        _Inout_ SegmentQueryResults& results) const
+    {
+        SegmentFooter footer;
+        size_t bodyLength = SegmentFooter::DecodeSegment(data, length, &footer);
+
+        ++results.segmentsScanned;
+        if (!CanMatch(footer))
+        {
+            ++results.segmentsSkipped;
+            return;
+        }
+
+        QueryBody(data, bodyLength, text, results);
+    }
+
+    SegmentQueryResults SegmentQuery::Run(
+        const std::wstring& directory) const
+    {
+        std::wstring directoryPath(directory.empty() ? L"." : directory);
+        directoryPath.push_back(L'\\');
+        std::wstring pattern(directoryPath);
+        pattern.append(SEGMENT_FILE_PATTERN);
+
+        std::vector<std::wstring> fileNames;
+        WIN32_FIND_DATAW findData;
+        HANDLE find = ::FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, NULL, 0);
+        if (find != INVALID_HANDLE_VALUE)
+        {
+            do
+            {
+                // Wildcards also match 8.3 names, so check the extension exactly.
+                std::wstring fileName(findData.cFileName);
+                if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 &&
+                    ntl::String::iends_with(fileName, SegmentFileExtension))
+                {
+                    fileNames.push_back(fileName);
+                }
+            } while (::FindNextFileW(find, &findData));
+
+            ::FindClose(find);
+        }
+
+        SortSegmentFileNames(fileNames);
+
+        SegmentQueryResults results;
+        std::string text;
+        text.reserve(QUERY_OUTPUT_BUFFER_SIZE);
+        for (const auto& fileName : fileNames)
+        {
+            std::wstring filePath(directoryPath + fileName);
+            try
+            {
+                QueryFile(filePath, text, results);
+            }
+            catch (const std::exception &ex)
+            {
+                WriteQueryOutput(text);
+                wprintf(L"Warning: Skipping segment %ls: %S.\n", filePath.c_str(), ex.what());
+            }
+
+            if (text.size() >= QUERY_OUTPUT_BUFFER_SIZE)
+            {
+                WriteQueryOutput(text);
+            }
+        }
+        WriteQueryOutput(text);
+
+        return results;
+    }
+
+    void SegmentQuery::SortSegmentFileNames(
+        _Inout_ std::vector<std::wstring>& fileNames)
+    {
+        struct SegmentFileName
+        {
+            std::wstring timestamp;
+            unsigned long sequence;
+            std::wstring fileName;
+        };
+
+        std::vector<SegmentFileName> parsedNames;
+        parsedNames.reserve(fileNames.size());
+        for (auto& fileName : fileNames)
+        {
+            SegmentFileName parsedName;
+            FileLogger::ParseLogFileName(fileName, SegmentFileExtension, &parsedName.timestamp, &parsedName.sequence);
+            parsedName.fileName = std::move(fileName);
+            parsedNames.push_back(std::move(parsedName));
+        }
+
+        // A plain name sort would put X.1.seg before X.seg, the file started first.
+        std::sort(parsedNames.begin(), parsedNames.end(), [](const SegmentFileName& lhs, const SegmentFileName& rhs)
+        {
+            if (lhs.timestamp != rhs.timestamp)
+            {
+                return lhs.timestamp < rhs.timestamp;
+            }
+            if (lhs.sequence != rhs.sequence)
+            {
+                return lhs.sequence < rhs.sequence;
+            }
+            return lhs.fileName < rhs.fileName;
+        });
+
+        for (size_t i = 0; i < parsedNames.size(); ++i)
+        {
+            fileNames[i] = std::move(parsedNames[i].fileName);
+        }
+    }
+
+    bool SegmentQuery::QueryFile(
+        const std::wstring& filePath,
+        _Inout_ std::string& text,
+        _Inout_ SegmentQueryResults& results) const
+    {
+        HANDLE file = ::CreateFileW(
+            filePath.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ | FILE_SHARE_DELETE,
+            NULL,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL,
+            NULL);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::exception("Unable to open segment file");
+        }
+
+        bool queried = false;
+        try
+        {
+            LARGE_INTEGER fileSize;
+            if (!::GetFileSizeEx(file, &fileSize) ||
+                static_cast<unsigned long long>(fileSize.QuadPart) < BinaryLogHeaderSize + SegmentTrailerSize)
+            {
+                throw std::exception("File is not an event segment");
+            }
+            unsigned long long length = static_cast<unsigned long long>(fileSize.QuadPart);
+
+            // Only the trailer and footer are read unless the segment may match.
+            char trailer[SegmentTrailerSize];
+            ReadSegmentFile(file, length - SegmentTrailerSize, trailer, sizeof(trailer));
+            size_t footerLength = SegmentFooter::DecodeTrailer(trailer);
+            if (footerLength > length - SegmentTrailerSize - BinaryLogHeaderSize)
+            {
+                throw std::exception("Segment footer is corrupt");
+            }
+            unsigned long long bodyLength = length - SegmentTrailerSize - footerLength;
+
+            std::vector<char> buffer(footerLength);
+            ReadSegmentFile(file, bodyLength, buffer.data(), buffer.size());
+            SegmentFooter footer;
+            footer.Decode(buffer.data(), buffer.size());
+
+            ++results.segmentsScanned;
+            if (CanMatch(footer))
+            {
+                buffer.resize(static_cast<size_t>(bodyLength));
+                ReadSegmentFile(file, 0, buffer.data(), buffer.size());
+                QueryBody(buffer.data(), buffer.size(), text, results);
+                queried = true;
+            }
+            else
+            {
+                ++results.segmentsSkipped;
+            }
+        }
+        catch (...)
+        {
+            ::CloseHandle(file);
+            throw;
+        }
+
+        ::CloseHandle(file);
+        return queried;
+    }
+}
\ No newline at end of file
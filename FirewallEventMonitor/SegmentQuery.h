@@ -0,0 +1,85 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <string>
+#include <vector>
+
+#include "EventKeys.h"
+#include "EventPredicate.h"
+#include "SegmentFormat.h"
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    struct SegmentQueryResults
+    {
+    public:
+        unsigned long long segmentsScanned = 0;
+        // Ruled out by their footer without reading the events.
+        unsigned long long segmentsSkipped = 0;
+        unsigned long long eventsScanned = 0;
+        unsigned long long eventsMatched = 0;
+    };
+
+    // Finds the events in .seg files that pass an EventPredicate.
+    //
+    // Footers are checked first: a segment is skipped when its time range ends too early,
+    // or when no filtered address, port or rule id is in its zone map range and bloom filter.
+    class SegmentQuery
+    {
+    public:
+        explicit SegmentQuery(const EventPredicate& predicate);
+
+        // False if no event in the segment can match.
+        bool CanMatch(const SegmentFooter& footer) const;
+
+        bool Matches(const VfpEventData& eventData) const;
+
+        // Decodes a segment body and appends each matching event as a text log line.
+        void QueryBody(
+            _In_reads_bytes_(length) const char* data,
+            size_t length,
+            _Inout_ std::string& text,
+            _Inout_ SegmentQueryResults& results) const;
+
+        // Queries a whole segment held in memory.
+        void QuerySegment(
+            _In_reads_bytes_(length) const char* data,
+            size_t length,
+            _Inout_ std::string& text,
+            _Inout_ SegmentQueryResults& results) const;
+
+        // Queries every .seg file in directory, oldest first, printing the matches to the console.
+        SegmentQueryResults Run(const std::wstring& directory) const;
+
+        // Orders segment file names as they were written: by their timestamp, then by the
+        // sequence number of files started in the same second. Other names go first.
+        static void SortSegmentFileNames(_Inout_ std::vector<std::wstring>& fileNames);
+
+        SegmentQuery(SegmentQuery const&) = delete;
+        SegmentQuery& operator=(SegmentQuery const&) = delete;
+
+    private:
+        EventPredicate m_Predicate;
+        // Parsed filters. A filter that does not parse can only match by text, which
+        // the footer does not index, so then the footer cannot rule the filter out.
+        std::vector<EventKey> m_AddressKeys;
+        std::vector<unsigned long long> m_AddressHashes;
+        std::vector<unsigned long long> m_RuleIdHashes;
+        std::vector<unsigned long> m_Ports;
+        bool m_AddressesIndexed = false;
+        bool m_RuleIdsIndexed = false;
+        bool m_PortsIndexed = false;
+
+        // Reads the footer of the file and, if it may match, the body. Returns false if skipped.
+        bool QueryFile(
+            const std::wstring& filePath,
+            _Inout_ std::string& text,
+            _Inout_ SegmentQueryResults& results) const;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,174 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "SegmentWriter.h"
+// ntl headers
+#include "ntlLocks.hpp"
+
+namespace FirewallEventMonitor
+{
+    // Only the retention limit applies to segment files.
+    LogRotationPolicy GetSegmentRetentionPolicy(const LogRotationPolicy &rotationPolicy)
+    {
+        LogRotationPolicy policy;
+        policy.maxFileSizeInBytes = 0;
+        policy.maxFileAgeInSeconds = 0;
+        policy.maxTotalSizeInBytes = rotationPolicy.maxTotalSizeInBytes;
+        return policy;
+    }
+
+    SegmentWriter::SegmentWriter(
+        const std::wstring &directory,
+        const LogRotationPolicy &rotationPolicy,
+        size_t eventsPerSegment)
+        : SegmentWriter(
+            // Queries seek to the footer, so segments are never compressed.
+            std::make_shared<FileLogger>(directory, SegmentFileExtension, false, GetSegmentRetentionPolicy(rotationPolicy)),
+            rotationPolicy.maxFileAgeInSeconds,
+            eventsPerSegment)
+    {
+    }
+
+    SegmentWriter::SegmentWriter(
+        std::shared_ptr<FileLogger> fileLogger,
+        unsigned long maxSegmentAgeInSeconds,
+        size_t eventsPerSegment)
+        : m_FileLogger(fileLogger),
+        m_Builder(std::make_unique<SegmentBuilder>()),
+        m_EventsPerSegment(eventsPerSegment),
+        m_MaxSegmentAgeInSeconds(maxSegmentAgeInSeconds)
+    {
+        if (eventsPerSegment == 0)
+        {
+            throw std::exception("Segments must hold at least one event");
+        }
+
+        m_FreeBuilders.push_back(std::make_unique<SegmentBuilder>());
+
+        ::InitializeCriticalSectionEx(&m_CriticalSection, 4000, 0);
+    }
+
+    SegmentWriter::~SegmentWriter()
+    {
+        try
+        {
+            Close();
+        }
+        catch (const std::exception &ex)
+        {
+            wprintf(L"Warning: Closing segments raised exception: %S.\n", ex.what());
+        }
+        ::DeleteCriticalSection(&m_CriticalSection);
+    }
+
+    void SegmentWriter::WriteEvent(
+        const VfpEventData& eventData)
+    {
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        if (m_Builder->GetEventCount() == 0)
+        {
+            m_SegmentStartTick = ::GetTickCount64();
+        }
+
+        m_Builder->Add(eventData);
+        if (m_Builder->GetEventCount() >= m_EventsPerSegment)
+        {
+            HandOverSegment();
+        }
+    }
+
+    void SegmentWriter::MaintenanceCheck()
+    {
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+            if (m_MaxSegmentAgeInSeconds != 0 &&
+                m_Builder->GetEventCount() > 0 &&
+                ::GetTickCount64() - m_SegmentStartTick >= m_MaxSegmentAgeInSeconds * 1000ull)
+            {
+                HandOverSegment();
+            }
+        }
+
+        WriteSegments();
+    }
+
+    void SegmentWriter::Close()
+    {
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+            if (m_Builder->GetEventCount() > 0)
+            {
+                HandOverSegment();
+            }
+        }
+
+        WriteSegments();
+    }
+
+    unsigned long long SegmentWriter::GetSegmentsWritten() const
+    {
+        return m_SegmentsWritten;
+    }
+
+    unsigned long long SegmentWriter::GetTotalBytesWritten() const
+    {
+        return m_FileLogger->GetTotalBytesWritten();
+    }
+
+    void SegmentWriter::HandOverSegment()
+    {
+        m_FullBuilders.push_back(std::move(m_Builder));
+        if (m_FreeBuilders.empty())
+        {
+            // The main loop is more than a segment behind.
+            m_Builder = std::make_unique<SegmentBuilder>();
+        }
+        else
+        {
+            m_Builder = std::move(m_FreeBuilders.back());
+            m_FreeBuilders.pop_back();
+        }
+    }
+
+    void SegmentWriter::WriteSegments()
+    {
+        std::vector<std::unique_ptr<SegmentBuilder>> builders;
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+            if (m_FullBuilders.empty())
+            {
+                return;
+            }
+            builders.swap(m_FullBuilders);
+        }
+
+        // Sealed and written outside the lock so the event callback keeps encoding meanwhile.
+        for (const auto& builder : builders)
+        {
+            unsigned long long eventCount = builder->GetEventCount();
+            m_Segment.clear();
+
+            try
+            {
+                builder->Seal(m_Segment);
+                m_FileLogger->WriteWholeFile(m_Segment.data(), m_Segment.size());
+                ++m_SegmentsWritten;
+            }
+            catch (const std::exception &ex)
+            {
+                wprintf(L"Warning: %S. Segment of %llu events dropped.\n", ex.what(), eventCount);
+            }
+        }
+
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+
+        for (auto& builder : builders)
+        {
+            m_FreeBuilders.push_back(std::move(builder));
+        }
+    }
+}
\ No newline at end of file
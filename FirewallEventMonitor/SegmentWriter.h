@@ -0,0 +1,79 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FileLogger.h"
+#include "SegmentFormat.h"
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    // Writes events to immutable .seg files (see SegmentFormat.h) of up to eventsPerSegment
+    // events, or of the events seen in the rotation policy's file age, whichever comes first.
+    //
+    // The writer only encodes into memory and hands full segments over; MaintenanceCheck seals
+    // them on the main loop, which sorts their bloom filter hashes, and writes one file each.
+    class SegmentWriter
+    {
+    public:
+        SegmentWriter(
+            const std::wstring &directory,
+            const LogRotationPolicy &rotationPolicy = LogRotationPolicy{},
+            size_t eventsPerSegment = SegmentBuilder::DefaultEventsPerSegment);
+
+        // Segments never rotate within a file, so fileLogger's policy only sets retention.
+        SegmentWriter(
+            std::shared_ptr<FileLogger> fileLogger,
+            unsigned long maxSegmentAgeInSeconds,
+            size_t eventsPerSegment);
+
+        ~SegmentWriter();
+
+        void WriteEvent(const VfpEventData& eventData);
+
+        // Hands over the open segment once it is older than the maximum age, then seals and
+        // writes every full one.
+        void MaintenanceCheck();
+
+        // Hands over the open segment, then seals and writes every full one.
+        void Close();
+
+        unsigned long long GetSegmentsWritten() const;
+
+        // Forwards to FileLogger, so it can be read while segments are written.
+        unsigned long long GetTotalBytesWritten() const;
+
+        SegmentWriter(SegmentWriter const&) = delete;
+        SegmentWriter& operator=(SegmentWriter const&) = delete;
+
+    private:
+        // Guards the builders.
+        CRITICAL_SECTION m_CriticalSection;
+        std::shared_ptr<FileLogger> m_FileLogger;
+        std::unique_ptr<SegmentBuilder> m_Builder;
+        size_t m_EventsPerSegment;
+        unsigned long m_MaxSegmentAgeInSeconds;
+        // When the open segment's first event arrived.
+        ULONGLONG m_SegmentStartTick = 0;
+        // Handed over by the writer, sealed by WriteSegments and returned empty to
+        // m_FreeBuilders, which holds a spare so the writer need not allocate one.
+        std::vector<std::unique_ptr<SegmentBuilder>> m_FullBuilders;
+        std::vector<std::unique_ptr<SegmentBuilder>> m_FreeBuilders;
+        // Main loop only: the segment being written.
+        std::string m_Segment;
+        unsigned long long m_SegmentsWritten = 0;
+
+        // Replaces the open builder with an empty one. Caller must hold m_CriticalSection.
+        void HandOverSegment();
+
+        void WriteSegments();
+    };
+}
\ No newline at end of file
@@ -0,0 +1,282 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+// c++ headers
+#include <algorithm>
+#include <cstdio>
+
+#include "SelfMetrics.h"
+
+namespace FirewallEventMonitor
+{
+    const char* const SelfMetricsStageNames[] =
+    {
+        "received",
+        "rule_match",
+        "decoded",
+        "passed_filters",
+        "processed"
+    };
+
+    const char* const SelfMetricsDropReasonNames[] =
+    {
+        "throttled",
+        "time_limit",
+        "filtered_out",
+        "session_closed",
+        "error",
+        "etw_events_lost",
+        "etw_buffers_lost"
+    };
+
+    // Label values of the LatencyMonitor stages timed per event; EventAge has a histogram of its own.
+    const char* const SelfMetricsLatencyStageNames[] =
+    {
+        "collect",
+        "filter",
+        "statistics",
+        "output",
+        "total"
+    };
+
+    // Bucket bounds in nanoseconds: 1 microsecond to 1 second for the stages, 1 millisecond
+    // to 5 minutes for the event age.
+    const unsigned long long SelfMetricsStageBounds[] =
+    {
+        1000ull, 2500ull, 5000ull, 10000ull, 25000ull, 50000ull, 100000ull, 250000ull, 500000ull,
+        1000000ull, 2500000ull, 5000000ull, 10000000ull, 25000000ull, 100000000ull, 1000000000ull
+    };
+
+    const unsigned long long SelfMetricsEventAgeBounds[] =
+    {
+        1000000ull, 10000000ull, 100000000ull, 250000000ull, 500000000ull,
+        1000000000ull, 2500000000ull, 5000000000ull, 10000000000ull, 30000000000ull,
+        60000000000ull, 300000000000ull
+    };
+
+    SelfMetrics::SelfMetrics()
+    {
+        for (size_t i = 0; i < StageCount; ++i)
+        {
+            m_Stages[i].value.store(0, std::memory_order_relaxed);
+        }
+
+        for (size_t i = 0; i < DropReasonCount; ++i)
+        {
+            m_Drops[i].value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    unsigned long long SelfMetrics::GetStageCount(Stage stage) const
+    {
+        return m_Stages[stage].value.load(std::memory_order_relaxed);
+    }
+
+    unsigned long long SelfMetrics::GetDropCount(DropReason reason) const
+    {
+        return m_Drops[reason].value.load(std::memory_order_relaxed);
+    }
+
+    void SelfMetrics::FormatPrometheus(
+        const SelfMetricsGauges& gauges,
+        const LatencyMonitor* latencyMonitor,
+        _Inout_ std::string& buffer) const
+    {
+        AppendHeader("firewalleventmonitor_uptime_seconds", "gauge", "Seconds since the capture started.", buffer);
+        AppendSample("firewalleventmonitor_uptime_seconds", std::string(), gauges.uptimeInSeconds, buffer);
+
+        AppendHeader("firewalleventmonitor_events_total", "counter", "Events that reached each stage of the event path.", buffer);
+        for (size_t i = 0; i < StageCount; ++i)
+        {
+            std::string labels = "stage=\"";
+            labels.append(GetStageName(static_cast<Stage>(i)));
+            labels.append("\"");
+            AppendSample("firewalleventmonitor_events_total", labels, static_cast<double>(GetStageCount(static_cast<Stage>(i))), buffer);
+        }
+
+        AppendHeader("firewalleventmonitor_events_dropped_total", "counter", "Events dropped, by reason. The ETW reasons count reports of loss, not events.", buffer);
+        for (size_t i = 0; i < DropReasonCount; ++i)
+        {
+            std::string labels = "reason=\"";
+            labels.append(GetDropReasonName(static_cast<DropReason>(i)));
+            labels.append("\"");
+            AppendSample("firewalleventmonitor_events_dropped_total", labels, static_cast<double>(GetDropCount(static_cast<DropReason>(i))), buffer);
+        }
+
+        AppendHeader("firewalleventmonitor_queue_depth", "gauge", "Work waiting: decode batches queued or decoded but not delivered, and open flows.", buffer);
+        AppendSample("firewalleventmonitor_queue_depth", "queue=\"decode_batches\"", static_cast<double>(gauges.decodeBatchesInFlight), buffer);
+        AppendSample("firewalleventmonitor_queue_depth", "queue=\"decode_reorder\"", static_cast<double>(gauges.decodeReorderDepth), buffer);
+        AppendSample("firewalleventmonitor_queue_depth", "queue=\"flows\"", static_cast<double>(gauges.activeFlows), buffer);
+
+        if (!gauges.logs.empty())
+        {
+            AppendHeader("firewalleventmonitor_log_bytes_written_total", "counter", "Bytes written to each kind of log, compressed if compressing.", buffer);
+            for (const auto& log : gauges.logs)
+            {
+                std::string labels = "log=\"";
+                labels.append(log.name);
+                labels.append("\"");
+                AppendSample("firewalleventmonitor_log_bytes_written_total", labels, static_cast<double>(log.bytesWritten), buffer);
+            }
+
+            AppendHeader("firewalleventmonitor_log_rotations_total", "counter", "Times each kind of log started a new file.", buffer);
+            for (const auto& log : gauges.logs)
+            {
+                std::string labels = "log=\"";
+                labels.append(log.name);
+                labels.append("\"");
+                AppendSample("firewalleventmonitor_log_rotations_total", labels, static_cast<double>(log.rotations), buffer);
+            }
+        }
+
+        AppendHeader("firewalleventmonitor_working_set_bytes", "gauge", "Physical memory in use by the process.", buffer);
+        AppendSample("firewalleventmonitor_working_set_bytes", std::string(), static_cast<double>(gauges.workingSetBytes), buffer);
+        AppendHeader("firewalleventmonitor_private_bytes", "gauge", "Memory committed to the process alone.", buffer);
+        AppendSample("firewalleventmonitor_private_bytes", std::string(), static_cast<double>(gauges.privateBytes), buffer);
+
+        if (latencyMonitor == nullptr)
+        {
+            return;
+        }
+
+        AppendHeader("firewalleventmonitor_stage_duration_seconds", "histogram", "Time the event callback spends in each stage per event.", buffer);
+        for (size_t i = 0; i < LatencyMonitor::EventAge; ++i)
+        {
+            std::string labels = "stage=\"";
+            labels.append(SelfMetricsLatencyStageNames[i]);
+            labels.append("\"");
+            AppendHistogram(
+                "firewalleventmonitor_stage_duration_seconds",
+                labels,
+                latencyMonitor->GetHistogram(static_cast<LatencyMonitor::Stage>(i)),
+                SelfMetricsStageBounds,
+                _countof(SelfMetricsStageBounds),
+                buffer);
+        }
+
+        AppendHeader("firewalleventmonitor_stage_allocations_total", "counter", "Calls to operator new in each stage. Flat once the event path's buffers have grown.", buffer);
+        for (size_t i = 0; i < LatencyMonitor::EventAge; ++i)
+        {
+            std::string labels = "stage=\"";
+            labels.append(SelfMetricsLatencyStageNames[i]);
+            labels.append("\"");
+            AppendSample("firewalleventmonitor_stage_allocations_total", labels, static_cast<double>(latencyMonitor->GetAllocationCount(static_cast<LatencyMonitor::Stage>(i))), buffer);
+        }
+
+        AppendHeader("firewalleventmonitor_stage_allocated_bytes_total", "counter", "Bytes asked of operator new in each stage.", buffer);
+        for (size_t i = 0; i < LatencyMonitor::EventAge; ++i)
+        {
+            std::string labels = "stage=\"";
+            labels.append(SelfMetricsLatencyStageNames[i]);
+            labels.append("\"");
+            AppendSample("firewalleventmonitor_stage_allocated_bytes_total", labels, static_cast<double>(latencyMonitor->GetAllocatedBytes(static_cast<LatencyMonitor::Stage>(i))), buffer);
+        }
+
+        AppendHeader("firewalleventmonitor_event_age_seconds", "histogram", "Time from the ETW time stamp to the callback. Growing ages mean the monitor is falling behind.", buffer);
+        AppendHistogram(
+            "firewalleventmonitor_event_age_seconds",
+            std::string(),
+            latencyMonitor->GetHistogram(LatencyMonitor::EventAge),
+            SelfMetricsEventAgeBounds,
+            _countof(SelfMetricsEventAgeBounds),
+            buffer);
+    }
+
+    const char* SelfMetrics::GetStageName(Stage stage)
+    {
+        return SelfMetricsStageNames[stage];
+    }
+
+    const char* SelfMetrics::GetDropReasonName(DropReason reason)
+    {
+        return SelfMetricsDropReasonNames[reason];
+    }
+
+    void SelfMetrics::AppendHeader(
+        const char* name,
+        const char* type,
+        const char* help,
+        _Inout_ std::string& buffer)
+    {
+        buffer.append("# HELP ");
+        buffer.append(name);
+        buffer.append(" ");
+        buffer.append(help);
+        buffer.append("\n# TYPE ");
+        buffer.append(name);
+        buffer.append(" ");
+        buffer.append(type);
+        buffer.append("\n");
+    }
+
+    void SelfMetrics::AppendSample(
+        const char* name,
+        const std::string& labels,
+        double value,
+        _Inout_ std::string& buffer)
+    {
+        buffer.append(name);
+        if (!labels.empty())
+        {
+            buffer.append("{");
+            buffer.append(labels);
+            buffer.append("}");
+        }
+
+        char text[32];
+        int length = sprintf_s(text, " %.15g\n", value);
+        if (length > 0)
+        {
+            buffer.append(text, static_cast<size_t>(length));
+        }
+    }
+
+    void SelfMetrics::AppendHistogram(
+        const char* name,
+        const std::string& labels,
+        const LatencyHistogram& histogram,
+        _In_reads_(boundCount) const unsigned long long* boundsInNanoseconds,
+        size_t boundCount,
+        _Inout_ std::string& buffer)
+    {
+        const double nanosecondsPerSecond = 1000000000.0;
+
+        unsigned long long counts[32] = {};
+        boundCount = (std::min)(boundCount, _countof(counts));
+        double sum = 0.0;
+        unsigned long long count = histogram.ReadCumulativeCounts(boundsInNanoseconds, boundCount, counts, sum);
+
+        std::string bucketName(name);
+        bucketName.append("_bucket");
+        std::string bucketLabels(labels);
+        if (!bucketLabels.empty())
+        {
+            bucketLabels.append(",");
+        }
+
+        for (size_t i = 0; i <= boundCount; ++i)
+        {
+            std::string bound = "+Inf";
+            if (i < boundCount)
+            {
+                char text[32];
+                int length = sprintf_s(text, "%.15g", static_cast<double>(boundsInNanoseconds[i]) / nanosecondsPerSecond);
+                bound.assign(text, length > 0 ? static_cast<size_t>(length) : 0);
+            }
+
+            std::string sampleLabels(bucketLabels);
+            sampleLabels.append("le=\"");
+            sampleLabels.append(bound);
+            sampleLabels.append("\"");
+            AppendSample(bucketName.c_str(), sampleLabels, static_cast<double>(i < boundCount ? counts[i] : count), buffer);
+        }
+
+        std::string sumName(name);
+        sumName.append("_sum");
+        AppendSample(sumName.c_str(), labels, sum / nanosecondsPerSecond, buffer);
+
+        std::string countName(name);
+        countName.append("_count");
+        AppendSample(countName.c_str(), labels, static_cast<double>(count), buffer);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,141 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "LatencyMonitor.h"
+
+namespace FirewallEventMonitor
+{
+    // Bytes written to one kind of log and the number of times it rotated.
+    struct LogMetrics
+    {
+        const char* name;
+        unsigned long long bytesWritten;
+        unsigned long long rotations;
+    };
+
+    // Values SelfMetrics reads from the other components each time it is formatted.
+    struct SelfMetricsGauges
+    {
+        double uptimeInSeconds = 0.0;
+        // One entry per log being written.
+        std::vector<LogMetrics> logs;
+        size_t decodeBatchesInFlight = 0;
+        size_t decodeReorderDepth = 0;
+        size_t activeFlows = 0;
+        unsigned long long workingSetBytes = 0;
+        unsigned long long privateBytes = 0;
+    };
+
+    // The monitor's own health, in the Prometheus text format, so fleet dashboards can tell
+    // whether each instance keeps up with its events.
+    //
+    // The event path only does relaxed atomic increments. Everything else (queue depths, log
+    // bytes, latency histograms) is read from the other components' own atomics when the
+    // metrics are formatted, so no lock is taken on the event path to report it.
+    class SelfMetrics
+    {
+    public:
+        // Stages an event passes in turn. Each counts the events that reached it.
+        enum Stage
+        {
+            Received,       // Every event handed to the callback, live, replayed or generated.
+            RuleMatch,      // VFP rule match events, the only ones collected.
+            Decoded,        // Decoded, on the callback or a decode worker.
+            PassedFilters,  // Passed the address and rule filters.
+            Processed,      // Counted, added to the statistics and written (or added to a flow).
+            StageCount
+        };
+
+        // Why an event stopped short of Processed, or never arrived.
+        enum DropReason
+        {
+            Throttled,      // Over -EventThrottle for the second.
+            TimeLimit,      // After -TimeLimit.
+            FilteredOut,    // Ruled out by -IP or -Rule.
+            SessionClosed,  // Arrived while the capture session was going away.
+            Error,          // Raised an exception.
+            EtwEventsLost,  // ETW reported events lost before delivery (once per report).
+            EtwBuffersLost, // ETW reported buffers lost before delivery (once per report).
+            DropReasonCount
+        };
+
+        SelfMetrics();
+
+        void AddStage(Stage stage)
+        {
+            m_Stages[stage].value.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void AddDrop(DropReason reason)
+        {
+            m_Drops[reason].value.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        unsigned long long GetStageCount(Stage stage) const;
+
+        unsigned long long GetDropCount(DropReason reason) const;
+
+        // Appends every metric. latencyMonitor may be null.
+        void FormatPrometheus(
+            const SelfMetricsGauges& gauges,
+            const LatencyMonitor* latencyMonitor,
+            _Inout_ std::string& buffer) const;
+
+        // Metric label values.
+        static const char* GetStageName(Stage stage);
+
+        static const char* GetDropReasonName(DropReason reason);
+
+        SelfMetrics(SelfMetrics const&) = delete;
+        SelfMetrics& operator=(SelfMetrics const&) = delete;
+
+    private:
+        static const size_t CacheLineInBytes = 64;
+
+        // Each counter sits a cache line from the next, so no two share one and the callback,
+        // decode workers and sources incrementing different counters do not pass a line back
+        // and forth. Padded rather than alignas(64): the metrics are allocated with make_shared,
+        // which before C++17 does not honour over-alignment (C4316).
+        struct PaddedCounter
+        {
+            std::atomic<unsigned long long> value;
+            char padding[CacheLineInBytes - sizeof(std::atomic<unsigned long long>)];
+        };
+
+        PaddedCounter m_Stages[StageCount];
+        PaddedCounter m_Drops[DropReasonCount];
+
+        // Appends the # HELP and # TYPE lines that lead a metric.
+        static void AppendHeader(
+            const char* name,
+            const char* type,
+            const char* help,
+            _Inout_ std::string& buffer);
+
+        // Appends name{labels} value. labels may be empty.
+        static void AppendSample(
+            const char* name,
+            const std::string& labels,
+            double value,
+            _Inout_ std::string& buffer);
+
+        // Appends the _bucket, _sum and _count samples of a histogram recorded in nanoseconds,
+        // converted to seconds at the given (ascending) bucket bounds.
+        static void AppendHistogram(
+            const char* name,
+            const std::string& labels,
+            const LatencyHistogram& histogram,
+            _In_reads_(boundCount) const unsigned long long* boundsInNanoseconds,
+            size_t boundCount,
+            _Inout_ std::string& buffer);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,207 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "SpaceSavingSketch.h"
+// c++ headers
+#include <algorithm>
+
+namespace FirewallEventMonitor
+{
+    SpaceSavingSketch::SpaceSavingSketch(size_t capacity)
+        : m_Capacity(capacity)
+    {
+        if (capacity == 0)
+        {
+            throw std::exception("SpaceSavingSketch capacity must not be 0");
+        }
+
+        // Keep the table at most half full so probe runs stay short.
+        size_t slotCount = 1;
+        while (slotCount < capacity * 2)
+        {
+            slotCount <<= 1;
+        }
+
+        m_Counters.reserve(capacity);
+        m_Slots.resize(slotCount);
+    }
+
+    void SpaceSavingSketch::Add(
+        const Key& key)
+    {
+        Add(key, EventKeys::Hash(key));
+    }
+
+    void SpaceSavingSketch::Add(
+        const Key& key,
+        unsigned long long hash)
+    {
+        ++m_Total;
+
+        size_t slot = FindSlot(key, hash);
+        if (m_Slots[slot] != 0)
+        {
+            size_t index = m_Slots[slot] - 1;
+            ++m_Counters[index].entry.count;
+            SiftDown(index);
+            return;
+        }
+
+        if (m_Counters.size() < m_Capacity)
+        {
+            Counter counter;
+            counter.entry.key = key;
+            counter.entry.count = 1;
+            counter.entry.error = 0;
+            counter.hash = hash;
+            counter.slot = slot;
+            m_Counters.push_back(counter);
+            m_Slots[slot] = m_Counters.size();
+            SiftUp(m_Counters.size() - 1);
+            return;
+        }
+
+        // Take over the smallest counter. Its count becomes the new key's error.
+        Counter& minimum = m_Counters[0];
+        RemoveSlot(minimum.slot);
+        // Removing may have shifted the empty slot found above.
+        slot = FindSlot(key, hash);
+
+        minimum.entry.key = key;
+        minimum.entry.error = minimum.entry.count;
+        ++minimum.entry.count;
+        minimum.hash = hash;
+        minimum.slot = slot;
+        m_Slots[slot] = 1;
+        SiftDown(0);
+    }
+
+    void SpaceSavingSketch::GetTop(
+        size_t count,
+        _Inout_ std::vector<Entry>& top) const
+    {
+        top.clear();
+        for (const auto& counter : m_Counters)
+        {
+            top.push_back(counter.entry);
+        }
+
+        count = (count < top.size()) ? count : top.size();
+        std::partial_sort(top.begin(), top.begin() + count, top.end(), [](const Entry& lhs, const Entry& rhs)
+        {
+            return lhs.count > rhs.count;
+        });
+        top.resize(count);
+    }
+
+    unsigned long long SpaceSavingSketch::GetTotal() const
+    {
+        return m_Total;
+    }
+
+    size_t SpaceSavingSketch::GetCapacity() const
+    {
+        return m_Capacity;
+    }
+
+    void SpaceSavingSketch::Reset()
+    {
+        m_Total = 0;
+        m_Counters.clear();
+        std::fill(m_Slots.begin(), m_Slots.end(), 0);
+    }
+
+    size_t SpaceSavingSketch::FindSlot(
+        const Key& key,
+        unsigned long long hash) const
+    {
+        size_t mask = m_Slots.size() - 1;
+        size_t slot = static_cast<size_t>(hash) & mask;
+        while (m_Slots[slot] != 0)
+        {
+            const Counter& counter = m_Counters[m_Slots[slot] - 1];
+            if (counter.hash == hash &&
+                EventKeys::Equal(counter.entry.key, key))
+            {
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void SpaceSavingSketch::RemoveSlot(
+        size_t slot)
+    {
+        size_t mask = m_Slots.size() - 1;
+        size_t hole = slot;
+        for (size_t next = (hole + 1) & mask; m_Slots[next] != 0; next = (next + 1) & mask)
+        {
+            // An entry may fill the hole only if its home slot is not between the hole and itself.
+            Counter& counter = m_Counters[m_Slots[next] - 1];
+            size_t home = static_cast<size_t>(counter.hash) & mask;
+            if (((next - home) & mask) >= ((next - hole) & mask))
+            {
+                m_Slots[hole] = m_Slots[next];
+                counter.slot = hole;
+                hole = next;
+            }
+        }
+
+        m_Slots[hole] = 0;
+    }
+
+    void SpaceSavingSketch::SwapCounters(
+        size_t first,
+        size_t second)
+    {
+        std::swap(m_Counters[first], m_Counters[second]);
+        m_Slots[m_Counters[first].slot] = first + 1;
+        m_Slots[m_Counters[second].slot] = second + 1;
+    }
+
+    void SpaceSavingSketch::SiftDown(
+        size_t index)
+    {
+        for (;;)
+        {
+            size_t smallest = index;
+            size_t left = (index * 2) + 1;
+            size_t right = left + 1;
+            if (left < m_Counters.size() &&
+                m_Counters[left].entry.count < m_Counters[smallest].entry.count)
+            {
+                smallest = left;
+            }
+            if (right < m_Counters.size() &&
+                m_Counters[right].entry.count < m_Counters[smallest].entry.count)
+            {
+                smallest = right;
+            }
+
+            if (smallest == index)
+            {
+                return;
+            }
+
+            SwapCounters(index, smallest);
+            index = smallest;
+        }
+    }
+
+    void SpaceSavingSketch::SiftUp(
+        size_t index)
+    {
+        while (index > 0)
+        {
+            size_t parent = (index - 1) / 2;
+            if (m_Counters[parent].entry.count <= m_Counters[index].entry.count)
+            {
+                return;
+            }
+
+            SwapCounters(index, parent);
+            index = parent;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <vector>
+
+#include "EventKeys.h"
+
+namespace FirewallEventMonitor
+{
+    // Streaming top-K with the Space-Saving algorithm (Metwally, Agrawal, El Abbadi).
+    //
+    // At most capacity keys are counted. A key not being counted takes over the counter with
+    // the smallest count and inherits that count as its error, so every reported count is at
+    // most error above the true count, and any key seen more than total / capacity times is
+    // guaranteed to be reported.
+    //
+    // Counters form a min-heap on count, indexed by an open-addressing table on the key.
+    // All memory is allocated by the constructor; Add never allocates.
+    class SpaceSavingSketch
+    {
+    public:
+        typedef EventKey Key;
+
+        struct Entry
+        {
+            Key key;
+            unsigned long long count;
+            // count - error is a lower bound on the true count.
+            unsigned long long error;
+        };
+
+        explicit SpaceSavingSketch(size_t capacity);
+
+        void Add(const Key& key);
+
+        // Add with the key's precomputed EventKeys::Hash.
+        void Add(
+            const Key& key,
+            unsigned long long hash);
+
+        // Replaces top with up to count entries, largest count first.
+        // Does not allocate once top has capacity for every counter.
+        void GetTop(
+            size_t count,
+            _Inout_ std::vector<Entry>& top) const;
+
+        // Number of keys added since the last Reset.
+        unsigned long long GetTotal() const;
+
+        size_t GetCapacity() const;
+
+        void Reset();
+
+        SpaceSavingSketch(SpaceSavingSketch const&) = delete;
+        SpaceSavingSketch& operator=(SpaceSavingSketch const&) = delete;
+
+    private:
+        struct Counter
+        {
+            Entry entry;
+            unsigned long long hash;
+            // Index of the table slot pointing at this counter.
+            size_t slot;
+        };
+
+        size_t m_Capacity = 0;
+        unsigned long long m_Total = 0;
+        // Min-heap on entry.count; m_Counters[0] is the counter to evict.
+        std::vector<Counter> m_Counters;
+        // Index into m_Counters plus one; 0 marks an empty slot. Size is a power of two.
+        std::vector<size_t> m_Slots;
+
+        // Returns the slot of key, or the empty slot that ends its probe run.
+        size_t FindSlot(const Key& key, unsigned long long hash) const;
+
+        // Empties the slot, shifting later entries of the probe run back (no tombstones).
+        void RemoveSlot(size_t slot);
+
+        void SwapCounters(size_t first, size_t second);
+
+        // Restores the heap after counter index grew.
+        void SiftDown(size_t index);
+
+        // Restores the heap after counter index was appended.
+        void SiftUp(size_t index);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,529 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "SyntheticEventGenerator.h"
+
+// c++ headers
+#include <climits>
+#include <cmath>
+#include <cwchar>
+
+namespace FirewallEventMonitor
+{
+    const long long SYNTHETIC_FILETIME_TICKS_PER_SECOND = 10000000;
+    const long long SYNTHETIC_SECONDS_PER_DAY = 86400;
+    // Days from 0000-03-01, where the civil calendar arithmetic starts its years, to 1601-01-01,
+    // where FILETIMEs start.
+    const long long SYNTHETIC_DAYS_BEFORE_FILETIME_EPOCH = 584694;
+
+    // Servers answer on these; ordinary events pick one at random.
+    const unsigned short SYNTHETIC_TCP_PORTS[] = { 443, 443, 443, 80, 22, 3389, 445, 1433 };
+    const unsigned short SYNTHETIC_UDP_PORTS[] = { 53, 53, 123, 500 };
+
+    // Private, shared, loopback, link local, documentation and other special-purpose IPv4 ranges
+    // (RFC 6890), which include the hosts, servers, sweep and scanner made up here.
+    const struct
+    {
+        unsigned long prefix;
+        unsigned long mask;
+    } SYNTHETIC_SPECIAL_IPV4_RANGES[] =
+    {
+        { 0x00000000, 0xff000000 }, // 0.0.0.0/8
+        { 0x0a000000, 0xff000000 }, // 10.0.0.0/8
+        { 0x64400000, 0xffc00000 }, // 100.64.0.0/10
+        { 0x7f000000, 0xff000000 }, // 127.0.0.0/8
+        { 0xa9fe0000, 0xffff0000 }, // 169.254.0.0/16
+        { 0xac100000, 0xfff00000 }, // 172.16.0.0/12
+        { 0xc0000000, 0xffffff00 }, // 192.0.0.0/24
+        { 0xc0000200, 0xffffff00 }, // 192.0.2.0/24
+        { 0xc0586300, 0xffffff00 }, // 192.88.99.0/24
+        { 0xc0a80000, 0xffff0000 }, // 192.168.0.0/16
+        { 0xc6120000, 0xfffe0000 }, // 198.18.0.0/15
+        { 0xc6336400, 0xffffff00 }, // 198.51.100.0/24
+        { 0xcb007100, 0xffffff00 }, // 203.0.113.0/24
+        { 0xe0000000, 0xe0000000 }, // 224.0.0.0/4 and 240.0.0.0/4
+    };
+
+    // Shares of ordinary IPv4 traffic; the rest is ICMPv4 (event 402). IPv6 traffic is TCP or UDP.
+    const double SYNTHETIC_TCP_FRACTION = 0.7;
+    const double SYNTHETIC_UDP_FRACTION = 0.25;
+    // Share of ordinary TCP events that open a connection.
+    const double SYNTHETIC_SYN_FRACTION = 0.1;
+
+    // Labels as CollectEventData translates them. Strings rather than literals, so Write can tell
+    // a field already holds one.
+    const std::wstring SYNTHETIC_EMPTY;
+    const std::wstring SYNTHETIC_INBOUND(L"Inbound");
+    const std::wstring SYNTHETIC_OUTBOUND(L"Outbound");
+    const std::wstring SYNTHETIC_ALLOW(L"Allow");
+    const std::wstring SYNTHETIC_DENY(L"Deny");
+    const std::wstring SYNTHETIC_TCP(L"TCP");
+    const std::wstring SYNTHETIC_UDP(L"UDP");
+    const std::wstring SYNTHETIC_ICMPV4(L"ICMPv4");
+    const std::wstring SYNTHETIC_ECHO_REQUEST(L"V4EchoRequest");
+    const std::wstring SYNTHETIC_SYN(L"1");
+    const std::wstring SYNTHETIC_NOT_SYN(L"0");
+    const std::wstring SYNTHETIC_STATUS(L"STATUS_SUCCESS");
+    const std::wstring SYNTHETIC_PORT_FRIENDLY_NAME(L"NULL");
+    const std::wstring SYNTHETIC_LAYER_ID(L"FW_CONTROLLER_LAYER_ID");
+    const std::wstring SYNTHETIC_GFT_FLAGS(L"0");
+    const std::wstring SYNTHETIC_GROUP_IPV4_IN(L"FW_GROUP_IPv4_IN_ID");
+    const std::wstring SYNTHETIC_GROUP_IPV4_OUT(L"FW_GROUP_IPv4_OUT_ID");
+    const std::wstring SYNTHETIC_GROUP_IPV6_IN(L"FW_GROUP_IPv6_IN_ID");
+    const std::wstring SYNTHETIC_GROUP_IPV6_OUT(L"FW_GROUP_IPv6_OUT_ID");
+
+    ZipfDistribution::ZipfDistribution(
+        unsigned long count,
+        double exponent)
+        : m_Probabilities(count),
+        m_Thresholds(count),
+        m_Aliases(count)
+    {
+        if (count == 0)
+        {
+            throw std::exception("A Zipf distribution needs at least one rank.");
+        }
+
+        double total = 0.0;
+        for (unsigned long rank = 0; rank < count; ++rank)
+        {
+            m_Probabilities[rank] = 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+            total += m_Probabilities[rank];
+        }
+
+        // Scaled so the average column holds 1; columns under 1 are topped up from those over it.
+        std::vector<unsigned long> small;
+        std::vector<unsigned long> large;
+        for (unsigned long rank = 0; rank < count; ++rank)
+        {
+            m_Probabilities[rank] /= total;
+            m_Thresholds[rank] = m_Probabilities[rank] * count;
+            m_Aliases[rank] = rank;
+            if (m_Thresholds[rank] < 1.0)
+            {
+                small.push_back(rank);
+            }
+            else
+            {
+                large.push_back(rank);
+            }
+        }
+
+        while (!small.empty() && !large.empty())
+        {
+            unsigned long under = small.back();
+            small.pop_back();
+            unsigned long over = large.back();
+
+            m_Aliases[under] = over;
+            m_Thresholds[over] -= 1.0 - m_Thresholds[under];
+            if (m_Thresholds[over] < 1.0)
+            {
+                large.pop_back();
+                small.push_back(over);
+            }
+        }
+
+        // What is left is 1 but for rounding.
+        for (auto rank : small)
+        {
+            m_Thresholds[rank] = 1.0;
+        }
+        for (auto rank : large)
+        {
+            m_Thresholds[rank] = 1.0;
+        }
+    }
+
+    unsigned long ZipfDistribution::Draw(
+        unsigned long long randomBits) const
+    {
+        unsigned long column = static_cast<unsigned long>(((randomBits >> 32) * m_Thresholds.size()) >> 32);
+        double decider = static_cast<double>(randomBits & 0xffffffff) / 4294967296.0;
+        return decider < m_Thresholds[column] ?
+            column :
+            m_Aliases[column];
+    }
+
+    double ZipfDistribution::GetProbability(
+        unsigned long rank) const
+    {
+        return rank < m_Probabilities.size() ? m_Probabilities[rank] : 0.0;
+    }
+
+    SyntheticEventGenerator::SyntheticEventGenerator(
+        const SyntheticTrafficProfile& profile)
+        : m_Profile(profile),
+        m_SourceRanks(profile.sourceCount, profile.zipfExponent),
+        m_RuleRanks(profile.ruleCount, profile.zipfExponent),
+        m_PortNumbers(USHRT_MAX + 1),
+        m_State(1),
+        m_NextSweepAddress(0),
+        m_FormattedSecond(-1),
+        m_WrittenEvent(nullptr)
+    {
+        if (m_Profile.ipv6Fraction < 0.0 || m_Profile.ipv6Fraction > 1.0 ||
+            m_Profile.synFloodFraction < 0.0 ||
+            m_Profile.icmpSweepFraction < 0.0 ||
+            m_Profile.synFloodFraction + m_Profile.icmpSweepFraction > 1.0)
+        {
+            throw std::exception("Synthetic traffic fractions must be between 0 and 1, and floods and sweeps together at most 1.");
+        }
+
+        if (m_Profile.seed != 0)
+        {
+            m_Random.seed(m_Profile.seed);
+        }
+        m_State = m_Random.uniform_int<unsigned long long>(1, ULLONG_MAX);
+
+        // Hosts 10.0.0.1 and fd00::1 upwards, servers 192.168.0.1 and fd00:1::1 upwards.
+        unsigned short ipv6[8] = { 0xfd00 };
+        m_Ipv4Sources.resize(m_Profile.sourceCount);
+        m_Ipv6Sources.resize(m_Profile.sourceCount);
+        for (unsigned long rank = 0; rank < m_Profile.sourceCount; ++rank)
+        {
+            FormatIpv4(0x0a000001 + rank, m_Ipv4Sources[rank]);
+
+            unsigned long host = rank + 1;
+            ipv6[6] = static_cast<unsigned short>(host >> 16);
+            ipv6[7] = static_cast<unsigned short>(host);
+            FormatIpv6(ipv6, m_Ipv6Sources[rank]);
+        }
+
+        ipv6[1] = 0x0001;
+        ipv6[6] = 0;
+        m_Ipv4Servers.resize(ServerCount);
+        m_Ipv6Servers.resize(ServerCount);
+        for (unsigned long server = 0; server < ServerCount; ++server)
+        {
+            FormatIpv4(0xc0a80001 + server, m_Ipv4Servers[server]);
+
+            ipv6[7] = static_cast<unsigned short>(server + 1);
+            FormatIpv6(ipv6, m_Ipv6Servers[server]);
+        }
+
+        // Two rules in three match inbound traffic; every fourth rule denies.
+        m_Rules.resize(m_Profile.ruleCount);
+        for (unsigned long rank = 0; rank < m_Profile.ruleCount; ++rank)
+        {
+            m_Rules[rank].ruleId = GenerateGuid();
+            m_Rules[rank].inbound = (rank % 3) != 2;
+            m_Rules[rank].deny = (rank % 4) == 3;
+        }
+
+        m_Ports.resize(PortCount);
+        for (unsigned long port = 0; port < PortCount; ++port)
+        {
+            m_Ports[port].portId = std::to_wstring(port + 1);
+            m_Ports[port].portName = GenerateGuid();
+        }
+
+        for (unsigned long port = 0; port <= USHRT_MAX; ++port)
+        {
+            m_PortNumbers[port] = std::to_wstring(port);
+        }
+
+        FormatIpv4(0xcb007107, m_Scanner); // 203.0.113.7
+    }
+
+    void SyntheticEventGenerator::Generate(
+        long long timeStamp,
+        VfpEventData& eventData)
+    {
+        if (&eventData != m_WrittenEvent)
+        {
+            m_WrittenEvent = &eventData;
+            m_Written = WrittenFields();
+        }
+
+        SetCommonFields(timeStamp, eventData);
+
+        double kind = NextProbability();
+        if (kind < m_Profile.synFloodFraction)
+        {
+            GenerateSynFlood(eventData);
+        }
+        else if (kind < m_Profile.synFloodFraction + m_Profile.icmpSweepFraction)
+        {
+            GenerateIcmpSweep(eventData);
+        }
+        else
+        {
+            GenerateOrdinary(eventData);
+        }
+    }
+
+    void SyntheticEventGenerator::GenerateOrdinary(
+        VfpEventData& eventData)
+    {
+        bool ipv6 = NextProbability() < m_Profile.ipv6Fraction;
+        unsigned long rank = m_SourceRanks.Draw(NextRandom());
+        unsigned long server = NextBelow(ServerCount);
+        SetRule(m_Rules[m_RuleRanks.Draw(NextRandom())], ipv6, eventData);
+
+        Write(eventData.source, ipv6 ? m_Ipv6Sources[rank] : m_Ipv4Sources[rank], m_Written.source);
+        Write(eventData.destination, ipv6 ? m_Ipv6Servers[server] : m_Ipv4Servers[server], m_Written.destination);
+
+        double protocol = NextProbability();
+        if (ipv6)
+        {
+            // IPv6 traffic splits between TCP and UDP in the same proportion as IPv4's.
+            protocol *= SYNTHETIC_TCP_FRACTION + SYNTHETIC_UDP_FRACTION;
+        }
+
+        if (protocol < SYNTHETIC_TCP_FRACTION)
+        {
+            Write(eventData.protocol, SYNTHETIC_TCP, m_Written.protocol);
+            Write(eventData.sourcePort, m_PortNumbers[49152 + NextBelow(USHRT_MAX + 1 - 49152)], m_Written.sourcePort);
+            Write(eventData.destinationPort, m_PortNumbers[SYNTHETIC_TCP_PORTS[NextBelow(static_cast<unsigned long>(sizeof(SYNTHETIC_TCP_PORTS) / sizeof(SYNTHETIC_TCP_PORTS[0])))]], m_Written.destinationPort);
+            Write(eventData.icmpType, SYNTHETIC_EMPTY, m_Written.icmpType);
+            Write(eventData.isTcpSyn, NextProbability() < SYNTHETIC_SYN_FRACTION ? SYNTHETIC_SYN : SYNTHETIC_NOT_SYN, m_Written.isTcpSyn);
+        }
+        else if (protocol < SYNTHETIC_TCP_FRACTION + SYNTHETIC_UDP_FRACTION)
+        {
+            Write(eventData.protocol, SYNTHETIC_UDP, m_Written.protocol);
+            Write(eventData.sourcePort, m_PortNumbers[49152 + NextBelow(USHRT_MAX + 1 - 49152)], m_Written.sourcePort);
+            Write(eventData.destinationPort, m_PortNumbers[SYNTHETIC_UDP_PORTS[NextBelow(static_cast<unsigned long>(sizeof(SYNTHETIC_UDP_PORTS) / sizeof(SYNTHETIC_UDP_PORTS[0])))]], m_Written.destinationPort);
+            Write(eventData.icmpType, SYNTHETIC_EMPTY, m_Written.icmpType);
+            Write(eventData.isTcpSyn, SYNTHETIC_EMPTY, m_Written.isTcpSyn);
+        }
+        else
+        {
+            Write(eventData.protocol, SYNTHETIC_ICMPV4, m_Written.protocol);
+            Write(eventData.sourcePort, SYNTHETIC_EMPTY, m_Written.sourcePort);
+            Write(eventData.destinationPort, SYNTHETIC_EMPTY, m_Written.destinationPort);
+            Write(eventData.icmpType, SYNTHETIC_ECHO_REQUEST, m_Written.icmpType);
+            Write(eventData.isTcpSyn, SYNTHETIC_EMPTY, m_Written.isTcpSyn);
+        }
+    }
+
+    void SyntheticEventGenerator::GenerateSynFlood(
+        VfpEventData& eventData)
+    {
+        SetRule(m_Rules[m_RuleRanks.Draw(NextRandom())], false, eventData);
+        Write(eventData.direction, SYNTHETIC_INBOUND, m_Written.direction);
+
+        // Spoofed: any public unicast address, drawn again when it lands in a special range.
+        unsigned long source;
+        do
+        {
+            source = 0x01000000 + NextBelow(0xdfffffff - 0x01000000 + 1);
+        }
+        while (!IsPublicIpv4(source));
+        FormatIpv4(source, eventData.source);
+        m_Written.source = nullptr;
+        Write(eventData.destination, m_Ipv4Servers[0], m_Written.destination);
+        Write(eventData.protocol, SYNTHETIC_TCP, m_Written.protocol);
+        Write(eventData.sourcePort, m_PortNumbers[1024 + NextBelow(USHRT_MAX + 1 - 1024)], m_Written.sourcePort);
+        Write(eventData.destinationPort, m_PortNumbers[443], m_Written.destinationPort);
+        Write(eventData.icmpType, SYNTHETIC_EMPTY, m_Written.icmpType);
+        Write(eventData.isTcpSyn, SYNTHETIC_SYN, m_Written.isTcpSyn);
+    }
+
+    void SyntheticEventGenerator::GenerateIcmpSweep(
+        VfpEventData& eventData)
+    {
+        SetRule(m_Rules[m_RuleRanks.Draw(NextRandom())], false, eventData);
+        Write(eventData.direction, SYNTHETIC_INBOUND, m_Written.direction);
+
+        Write(eventData.source, m_Scanner, m_Written.source);
+        FormatIpv4(0xac100001 + m_NextSweepAddress, eventData.destination);
+        m_Written.destination = nullptr;
+        m_NextSweepAddress = (m_NextSweepAddress + 1) % SweepAddressCount;
+        Write(eventData.protocol, SYNTHETIC_ICMPV4, m_Written.protocol);
+        Write(eventData.sourcePort, SYNTHETIC_EMPTY, m_Written.sourcePort);
+        Write(eventData.destinationPort, SYNTHETIC_EMPTY, m_Written.destinationPort);
+        Write(eventData.icmpType, SYNTHETIC_ECHO_REQUEST, m_Written.icmpType);
+        Write(eventData.isTcpSyn, SYNTHETIC_EMPTY, m_Written.isTcpSyn);
+    }
+
+    void SyntheticEventGenerator::SetCommonFields(
+        long long timeStamp,
+        VfpEventData& eventData)
+    {
+        long long second = timeStamp / SYNTHETIC_FILETIME_TICKS_PER_SECOND;
+        if (second != m_FormattedSecond)
+        {
+            // As Timer::GetDateAndTime formats a live event's.
+            FormatDateAndTime(second, m_Date, m_Time);
+            m_FormattedSecond = second;
+            // Same strings, new text.
+            m_Written.date = nullptr;
+            m_Written.time = nullptr;
+        }
+
+        eventData.timeStamp = timeStamp;
+        Write(eventData.date, m_Date, m_Written.date);
+        Write(eventData.time, m_Time, m_Written.time);
+        Write(eventData.status, SYNTHETIC_STATUS, m_Written.status);
+
+        const SyntheticPort& port = m_Ports[NextBelow(PortCount)];
+        Write(eventData.portId, port.portId, m_Written.portId);
+        Write(eventData.portName, port.portName, m_Written.portName);
+        Write(eventData.portFriendlyName, SYNTHETIC_PORT_FRIENDLY_NAME, m_Written.portFriendlyName);
+
+        Write(eventData.layerId, SYNTHETIC_LAYER_ID, m_Written.layerId);
+        Write(eventData.gftFlags, SYNTHETIC_GFT_FLAGS, m_Written.gftFlags);
+        eventData.eventCount = 0;
+        eventData.synCount = 0;
+        eventData.lastTimeStamp = 0;
+    }
+
+    void SyntheticEventGenerator::SetRule(
+        const SyntheticRule& rule,
+        bool ipv6,
+        VfpEventData& eventData)
+    {
+        Write(eventData.ruleId, rule.ruleId, m_Written.ruleId);
+        Write(eventData.ruleType, rule.deny ? SYNTHETIC_DENY : SYNTHETIC_ALLOW, m_Written.ruleType);
+        Write(eventData.direction, rule.inbound ? SYNTHETIC_INBOUND : SYNTHETIC_OUTBOUND, m_Written.direction);
+        if (ipv6)
+        {
+            Write(eventData.groupId, rule.inbound ? SYNTHETIC_GROUP_IPV6_IN : SYNTHETIC_GROUP_IPV6_OUT, m_Written.groupId);
+        }
+        else
+        {
+            Write(eventData.groupId, rule.inbound ? SYNTHETIC_GROUP_IPV4_IN : SYNTHETIC_GROUP_IPV4_OUT, m_Written.groupId);
+        }
+    }
+
+    void SyntheticEventGenerator::Write(
+        std::wstring& field,
+        const std::wstring& value,
+        const std::wstring*& written)
+    {
+        if (written != &value)
+        {
+            field.assign(value);
+            written = &value;
+        }
+    }
+
+    std::wstring SyntheticEventGenerator::GenerateGuid()
+    {
+        wchar_t guid[40];
+        std::swprintf(guid, sizeof(guid) / sizeof(guid[0]), L"%08lx-%04x-%04x-%04x-%04x%08lx",
+            m_Random.uniform_int<unsigned long>(0, 0xffffffff),
+            m_Random.uniform_int<unsigned int>(0, USHRT_MAX),
+            m_Random.uniform_int<unsigned int>(0, USHRT_MAX),
+            m_Random.uniform_int<unsigned int>(0, USHRT_MAX),
+            m_Random.uniform_int<unsigned int>(0, USHRT_MAX),
+            m_Random.uniform_int<unsigned long>(0, 0xffffffff));
+        return guid;
+    }
+
+    unsigned long long SyntheticEventGenerator::NextRandom()
+    {
+        m_State ^= m_State >> 12;
+        m_State ^= m_State << 25;
+        m_State ^= m_State >> 27;
+        return m_State * 0x2545f4914f6cdd1dull;
+    }
+
+    unsigned long SyntheticEventGenerator::NextBelow(
+        unsigned long count)
+    {
+        // The high 32 bits scaled to the count: no division, and no bias worth measuring.
+        return static_cast<unsigned long>(((NextRandom() >> 32) * count) >> 32);
+    }
+
+    double SyntheticEventGenerator::NextProbability()
+    {
+        return static_cast<double>(NextRandom() >> 11) / 9007199254740992.0; // 2^53
+    }
+
+    bool SyntheticEventGenerator::IsPublicIpv4(
+        unsigned long hostOrderAddress)
+    {
+        for (const auto& range : SYNTHETIC_SPECIAL_IPV4_RANGES)
+        {
+            if ((hostOrderAddress & range.mask) == range.prefix)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void SyntheticEventGenerator::FormatDateAndTime(
+        long long second,
+        std::wstring& date,
+        std::wstring& time)
+    {
+        // Counted in years from March, the leap day falls last: gmtime's arithmetic without its
+        // shared buffer, so generators on different threads do not race.
+        long long day = second / SYNTHETIC_SECONDS_PER_DAY + SYNTHETIC_DAYS_BEFORE_FILETIME_EPOCH;
+        long long secondOfDay = second % SYNTHETIC_SECONDS_PER_DAY;
+        long long era = day / 146097; // Days in 400 years.
+        long long dayOfEra = day - era * 146097;
+        long long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        long long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        long long monthFromMarch = (5 * dayOfYear + 2) / 153;
+        int dayOfMonth = static_cast<int>(dayOfYear - (153 * monthFromMarch + 2) / 5 + 1);
+        int month = static_cast<int>(monthFromMarch < 10 ? monthFromMarch + 3 : monthFromMarch - 9);
+        int year = static_cast<int>(era * 400 + yearOfEra + (month <= 2 ? 1 : 0));
+
+        wchar_t formatted[16];
+        std::swprintf(formatted, sizeof(formatted) / sizeof(formatted[0]), L"%04d%02d%02d", year, month, dayOfMonth);
+        date.assign(formatted);
+        std::swprintf(formatted, sizeof(formatted) / sizeof(formatted[0]), L"%02d%02d%02d",
+            static_cast<int>(secondOfDay / 3600),
+            static_cast<int>(secondOfDay / 60 % 60),
+            static_cast<int>(secondOfDay % 60));
+        time.assign(formatted);
+    }
+
+    void SyntheticEventGenerator::FormatIpv4(
+        unsigned long hostOrderAddress,
+        std::wstring& address)
+    {
+        wchar_t formatted[16];
+        std::swprintf(formatted, sizeof(formatted) / sizeof(formatted[0]), L"%lu.%lu.%lu.%lu",
+            (hostOrderAddress >> 24) & 0xff,
+            (hostOrderAddress >> 16) & 0xff,
+            (hostOrderAddress >> 8) & 0xff,
+            hostOrderAddress & 0xff);
+        address.assign(formatted);
+    }
+
+    void SyntheticEventGenerator::FormatIpv6(
+        const unsigned short (&groups)[8],
+        std::wstring& address)
+    {
+        size_t zerosStart = 8;
+        size_t zerosLength = 1;
+        for (size_t start = 0; start < 8;)
+        {
+            size_t end = start;
+            while (end < 8 && groups[end] == 0)
+            {
+                ++end;
+            }
+            if (end - start > zerosLength)
+            {
+                zerosStart = start;
+                zerosLength = end - start;
+            }
+            start = (end == start) ? end + 1 : end;
+        }
+
+        wchar_t formatted[40];
+        size_t length = 0;
+        for (size_t group = 0; group < 8; ++group)
+        {
+            if (group == zerosStart)
+            {
+                formatted[length++] = L':';
+                if (group == 0)
+                {
+                    formatted[length++] = L':';
+                }
+                group += zerosLength - 1;
+                continue;
+            }
+            length += std::swprintf(formatted + length, sizeof(formatted) / sizeof(formatted[0]) - length, (group == 7) ? L"%x" : L"%x:", groups[group]);
+        }
+        formatted[length] = L'\0';
+        address.assign(formatted);
+    }
+}
\ No newline at end of file
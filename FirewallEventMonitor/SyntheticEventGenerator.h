@@ -0,0 +1,204 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// c++ headers
+#include <string>
+#include <vector>
+// ntl headers
+#include "ntlRandom.hpp"
+
+#include "VfpEventData.h"
+
+namespace FirewallEventMonitor
+{
+    // The traffic SyntheticEventGenerator makes up.
+    struct SyntheticTrafficProfile
+    {
+    public:
+        // Hosts sending ordinary traffic; the busiest host sends most, as Zipf's law has it.
+        unsigned long sourceCount = 10000;
+        // Rules matching ordinary traffic, busiest first by the same law.
+        unsigned long ruleCount = 100;
+        // 0 spreads traffic evenly; 1 is classic Zipf; larger concentrates it on fewer hosts and rules.
+        double zipfExponent = 1.0;
+        // Share of ordinary events sent over IPv6 (event 401) rather than IPv4 (400 or 402).
+        double ipv6Fraction = 0.2;
+        // Share of all events that are SYNs from spoofed sources at one server's port 443.
+        double synFloodFraction = 0.0;
+        // Share of all events that are echo requests from one scanner, to each address of a /16 in turn.
+        double icmpSweepFraction = 0.0;
+        // 0 seeds randomly; anything else makes the same events every run.
+        unsigned long seed = 0;
+    };
+
+    // Draws ranks 0 to count - 1, rank r with probability proportional to 1 / (r + 1) ^ exponent.
+    // Each draw takes constant time whatever the count (Walker's alias method) and 64 random bits.
+    class ZipfDistribution
+    {
+    public:
+        ZipfDistribution(
+            unsigned long count,
+            double exponent);
+
+        // randomBits: uniformly random, the high half picking a column and the low half deciding it.
+        unsigned long Draw(unsigned long long randomBits) const;
+
+        // The chance of drawing rank.
+        double GetProbability(unsigned long rank) const;
+
+    private:
+        std::vector<double> m_Probabilities;
+        // Column i keeps i with m_Thresholds[i], else gives m_Aliases[i].
+        std::vector<double> m_Thresholds;
+        std::vector<unsigned long> m_Aliases;
+    };
+
+    // Makes up the events VFP rule matches decode to (events 400, 401 and 402) without a
+    // provider, a trace session or TDH: ordinary traffic between Zipf-ranked hosts and a pool of
+    // servers, plus optional SYN floods and ICMP sweeps. The events are made up decoded, so TDH
+    // and CollectEventData never run on them; only a capture or its replay measures decoding.
+    //
+    // Every string an event can hold is formatted once up front, and Generate reuses the
+    // storage of the event it is handed, so a steady stream of events allocates nothing. Handed
+    // the same event again, it copies only the fields that changed.
+    // ntl::RandomTwister makes the rules, ports and seed; the draws for each event come from a
+    // xorshift generator it seeds, which costs a few cycles where the twister behind the STL
+    // distributions cost more than the rest of the event.
+    // Not thread safe: give each thread a generator of its own.
+    // Only the standard library is used: addresses, dates and times are formatted here rather
+    // than by Winsock, the Win32 date APIs or the CRT's secure functions, so the generator runs
+    // wherever VfpEventData does.
+    class SyntheticEventGenerator
+    {
+    public:
+        // Throws if the profile's counts are 0 or its fractions do not add up.
+        explicit SyntheticEventGenerator(const SyntheticTrafficProfile& profile);
+
+        // Overwrites every field of eventData with the next event, stamped with timeStamp (a FILETIME).
+        // The strings of an event handed back must be as this left them.
+        void Generate(
+            long long timeStamp,
+            VfpEventData& eventData);
+
+        // Constants
+        static const unsigned long ServerCount = 64;
+        static const unsigned long PortCount = 8;
+        static const unsigned long SweepAddressCount = 65534; // 172.16.0.1 to 172.16.255.254.
+
+        SyntheticEventGenerator(SyntheticEventGenerator const&) = delete;
+        SyntheticEventGenerator& operator=(SyntheticEventGenerator const&) = delete;
+
+    private:
+        struct SyntheticRule
+        {
+            std::wstring ruleId;
+            bool inbound;
+            bool deny;
+        };
+
+        struct SyntheticPort
+        {
+            std::wstring portId;
+            std::wstring portName;
+        };
+
+        SyntheticTrafficProfile m_Profile;
+        ntl::RandomTwister m_Random;
+        // xorshift64* state; never 0.
+        unsigned long long m_State;
+        ZipfDistribution m_SourceRanks;
+        ZipfDistribution m_RuleRanks;
+        // Indexed by rank: each host has an address of each family.
+        std::vector<std::wstring> m_Ipv4Sources;
+        std::vector<std::wstring> m_Ipv6Sources;
+        std::vector<std::wstring> m_Ipv4Servers;
+        std::vector<std::wstring> m_Ipv6Servers;
+        std::vector<SyntheticRule> m_Rules;
+        std::vector<SyntheticPort> m_Ports;
+        // Indexed by port number.
+        std::vector<std::wstring> m_PortNumbers;
+        std::wstring m_Scanner;
+        unsigned long m_NextSweepAddress;
+        // Date and time change once a second, so they are formatted once a second.
+        long long m_FormattedSecond;
+        std::wstring m_Date;
+        std::wstring m_Time;
+        // The string each field of m_WrittenEvent was last copied from.
+        struct WrittenFields
+        {
+            const std::wstring* date = nullptr;
+            const std::wstring* time = nullptr;
+            const std::wstring* direction = nullptr;
+            const std::wstring* ruleType = nullptr;
+            const std::wstring* status = nullptr;
+            const std::wstring* portId = nullptr;
+            const std::wstring* portName = nullptr;
+            const std::wstring* portFriendlyName = nullptr;
+            const std::wstring* source = nullptr;
+            const std::wstring* destination = nullptr;
+            const std::wstring* protocol = nullptr;
+            const std::wstring* sourcePort = nullptr;
+            const std::wstring* destinationPort = nullptr;
+            const std::wstring* icmpType = nullptr;
+            const std::wstring* isTcpSyn = nullptr;
+            const std::wstring* ruleId = nullptr;
+            const std::wstring* layerId = nullptr;
+            const std::wstring* groupId = nullptr;
+            const std::wstring* gftFlags = nullptr;
+        };
+        const VfpEventData* m_WrittenEvent;
+        WrittenFields m_Written;
+
+        void GenerateOrdinary(VfpEventData& eventData);
+
+        void GenerateSynFlood(VfpEventData& eventData);
+
+        void GenerateIcmpSweep(VfpEventData& eventData);
+
+        // Fields every kind of event sets the same way.
+        void SetCommonFields(
+            long long timeStamp,
+            VfpEventData& eventData);
+
+        void SetRule(
+            const SyntheticRule& rule,
+            bool ipv6,
+            VfpEventData& eventData);
+
+        std::wstring GenerateGuid();
+
+        unsigned long long NextRandom();
+
+        // Uniform in [0, count).
+        unsigned long NextBelow(unsigned long count);
+
+        // Uniform in [0, 1).
+        double NextProbability();
+
+        // Copies value into field unless written says the field holds it already.
+        static void Write(
+            std::wstring& field,
+            const std::wstring& value,
+            const std::wstring*& written);
+
+        // False for the private and special-purpose ranges a spoofed source should not come from.
+        static bool IsPublicIpv4(unsigned long hostOrderAddress);
+
+        // yyyyMMdd and HHmmss in UTC of a second counted from 1601, as FILETIMEs are.
+        static void FormatDateAndTime(
+            long long second,
+            std::wstring& date,
+            std::wstring& time);
+
+        static void FormatIpv4(
+            unsigned long hostOrderAddress,
+            std::wstring& address);
+
+        // In the form InetNtop gives: lower case hex, the longest run of two or more zero groups as ::.
+        static void FormatIpv6(
+            const unsigned short (&groups)[8],
+            std::wstring& address);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "SyntheticEventSource.h"
+#include "FirewallEtwTraceCallback.h"
+
+// c++ headers
+#include <algorithm>
+
+namespace FirewallEventMonitor
+{
+    SyntheticEventSource::SyntheticEventSource(
+        const SyntheticTrafficProfile& profile,
+        unsigned long eventsPerSecond,
+        const FirewallEtwTraceCallback& callback,
+        const std::shared_ptr<EventCounter> eventCounter,
+        const std::shared_ptr<Timer> timer)
+        : m_Generator(profile),
+        m_EventsPerSecond(eventsPerSecond),
+        m_Callback(std::make_unique<FirewallEtwTraceCallback>(callback)),
+        m_EventCounter(eventCounter),
+        m_Timer(timer),
+        m_Stopping(false),
+        m_Finished(false)
+    {
+    }
+
+    SyntheticEventSource::~SyntheticEventSource()
+    {
+        Stop();
+    }
+
+    void SyntheticEventSource::Start()
+    {
+        m_Thread = std::thread(&SyntheticEventSource::Run, this);
+    }
+
+    void SyntheticEventSource::Stop()
+    {
+        m_Stopping = true;
+        if (m_Thread.joinable())
+        {
+            m_Thread.join();
+        }
+    }
+
+    bool SyntheticEventSource::IsFinished() const
+    {
+        return m_Finished;
+    }
+
+    void SyntheticEventSource::WriteResults() const
+    {
+        double eventsPerSecond = m_Results.elapsedInSeconds > 0.0 ?
+            static_cast<double>(m_Results.eventsGenerated - m_Results.eventsDropped) / m_Results.elapsedInSeconds :
+            0.0;
+
+        wprintf(L"Generated %llu synthetic events in %.2f seconds: %.0f events per second sustained. Dropped %llu events.\n",
+            m_Results.eventsGenerated,
+            m_Results.elapsedInSeconds,
+            eventsPerSecond,
+            m_Results.eventsDropped);
+
+        if (m_EventsPerSecond > 0)
+        {
+            wprintf(L"Fell behind the rate of %lu events per second by up to %.1f milliseconds.\n",
+                m_EventsPerSecond,
+                m_Results.maximumLagInMilliseconds);
+        }
+    }
+
+    SyntheticEventSourceResults SyntheticEventSource::GetResults() const
+    {
+        return m_Results;
+    }
+
+    void SyntheticEventSource::Run()
+    {
+        // FILETIMEs count 100ns ticks from 1601, system_clock (in practice) from 1970.
+        typedef std::chrono::duration<long long, std::ratio<1, 10000000>> FileTimeTicks;
+        const long long fileTimeTicksBeforeUnixEpoch = 116444736000000000;
+
+        auto start = std::chrono::steady_clock::now();
+        long long startTimeStamp = fileTimeTicksBeforeUnixEpoch +
+            std::chrono::duration_cast<FileTimeTicks>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+        try
+        {
+            // Reused for every event, so its strings keep their storage.
+            VfpEventData eventData;
+            while (!m_Stopping)
+            {
+                if (m_EventsPerSecond > 0)
+                {
+                    Pace(m_Results.eventsGenerated, start);
+                }
+                else
+                {
+                    WaitWhileRefused();
+                    if (m_Stopping)
+                    {
+                        break;
+                    }
+                }
+
+                ++m_Results.eventsGenerated;
+                if (!m_Callback->AdmitEvent())
+                {
+                    ++m_Results.eventsDropped;
+                    continue;
+                }
+
+                long long elapsed = std::chrono::duration_cast<FileTimeTicks>(std::chrono::steady_clock::now() - start).count();
+                m_Generator.Generate(startTimeStamp + elapsed, eventData);
+                m_Callback->ProcessEventData(eventData);
+            }
+        }
+        catch (const std::exception &ex)
+        {
+            wprintf(L"Error: Generating synthetic events raised exception: %S.\n", ex.what());
+            m_Finished = true;
+        }
+
+        m_Results.elapsedInSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void SyntheticEventSource::WaitWhileRefused()
+    {
+        // The main loop reopens the throttle each second; a time limit never reopens.
+        while ((m_EventCounter->EpocEventCountLimitReached() || m_Timer->TimeLimitReached()) &&
+            !m_Stopping)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void SyntheticEventSource::Pace(
+        unsigned long long eventIndex,
+        std::chrono::steady_clock::time_point start)
+    {
+        auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(eventIndex) / m_EventsPerSecond));
+
+        auto now = std::chrono::steady_clock::now();
+        // Less than a millisecond early is close enough.
+        while (due - now >= std::chrono::milliseconds(1) &&
+            !m_Stopping)
+        {
+            std::this_thread::sleep_for((std::min)(
+                std::chrono::duration_cast<std::chrono::milliseconds>(due - now),
+                std::chrono::milliseconds(static_cast<long long>(MaximumSleepInMilliseconds))));
+            now = std::chrono::steady_clock::now();
+        }
+
+        if (now > due)
+        {
+            m_Results.maximumLagInMilliseconds = (std::max)(
+                m_Results.maximumLagInMilliseconds,
+                std::chrono::duration<double, std::milli>(now - due).count());
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// c++ headers
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "EventCounter.h"
+#include "EventSource.h"
+#include "SyntheticEventGenerator.h"
+#include "Timer.h"
+
+namespace FirewallEventMonitor
+{
+    struct SyntheticEventSourceResults
+    {
+        unsigned long long eventsGenerated = 0;
+        // Due at a steady rate while -EventThrottle or -TimeLimit refused events, as the live callback refuses them.
+        unsigned long long eventsDropped = 0;
+        double elapsedInSeconds = 0.0;
+        // How far the source fell behind the rate asked of it.
+        double maximumLagInMilliseconds = 0.0;
+    };
+
+    // Events made up by a SyntheticEventGenerator, handed to the callback from a thread of its
+    // own at a steady rate or as fast as the callback takes them, until stopped. Each event is
+    // stamped with the time it is handed over.
+    //
+    // At a steady rate an event due while -EventThrottle or -TimeLimit refuses events is dropped,
+    // as a live one would be. As fast as possible, the source waits for the throttle to reopen
+    // instead of making events only to drop them.
+    class SyntheticEventSource : public EventSource
+    {
+    public:
+        // eventsPerSecond: 0 generates as fast as possible.
+        SyntheticEventSource(
+            const SyntheticTrafficProfile& profile,
+            unsigned long eventsPerSecond,
+            const FirewallEtwTraceCallback& callback,
+            const std::shared_ptr<EventCounter> eventCounter,
+            const std::shared_ptr<Timer> timer);
+
+        // Stops the source.
+        ~SyntheticEventSource();
+
+        // Starts generating on a new thread.
+        void Start() override;
+
+        // Waits for the thread to finish the event in hand.
+        void Stop() override;
+
+        // Only a generator that failed finishes on its own.
+        bool IsFinished() const override;
+
+        // Prints the events per second sustained and the lag behind the rate.
+        void WriteResults() const override;
+
+        // Complete once Stop has returned.
+        SyntheticEventSourceResults GetResults() const;
+
+        // Constants
+        static const unsigned long MaximumSleepInMilliseconds = 100;
+
+        SyntheticEventSource(SyntheticEventSource const&) = delete;
+        SyntheticEventSource& operator=(SyntheticEventSource const&) = delete;
+
+    private:
+        SyntheticEventGenerator m_Generator;
+        unsigned long m_EventsPerSecond;
+        std::unique_ptr<FirewallEtwTraceCallback> m_Callback;
+        std::shared_ptr<EventCounter> m_EventCounter;
+        std::shared_ptr<Timer> m_Timer;
+        std::thread m_Thread;
+        std::atomic<bool> m_Stopping;
+        std::atomic<bool> m_Finished;
+        SyntheticEventSourceResults m_Results;
+
+        void Run();
+
+        // Sleeps while the callback would refuse events, until stopped.
+        void WaitWhileRefused();
+
+        // Sleeps until the event is due, in slices so Stop is not kept waiting.
+        void Pace(
+            unsigned long long eventIndex,
+            std::chrono::steady_clock::time_point start);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace FirewallEventMonitor
+{
+    // K-way merge of cursors that each yield items in time order, used by EtlQuery for its
+    // decoded runs and by LogMerger for its inputs.
+    //
+    // A Cursor has:
+    //   bool Advance();                 Moves to its next item. False once it has none left.
+    //   LONGLONG GetTimeStamp() const;  The time stamp of the item it is on.
+    //
+    // Each cursor is advanced to its first item, then output(index) is called for the item
+    // cursors[index] is on, earliest first, before that cursor is advanced again. A heap holds
+    // one entry per cursor, so merging E items from N cursors takes O(E log N) time. Ties go
+    // to the lower index, so equal time stamps keep the order of the cursors.
+    template <typename Cursor, typename Output>
+    void MergeInTimeOrder(
+        std::vector<Cursor>& cursors,
+        Output&& output)
+    {
+        typedef std::pair<LONGLONG, size_t> HeapEntry;
+        std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+
+        for (size_t index = 0; index < cursors.size(); ++index)
+        {
+            if (cursors[index].Advance())
+            {
+                heap.emplace(cursors[index].GetTimeStamp(), index);
+            }
+        }
+
+        while (!heap.empty())
+        {
+            size_t index = heap.top().second;
+            heap.pop();
+
+            output(index);
+            if (cursors[index].Advance())
+            {
+                heap.emplace(cursors[index].GetTimeStamp(), index);
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "TopTalkers.h"
+
+namespace FirewallEventMonitor
+{
+    const size_t TOP_TALKERS_COLUMN_WIDTH = 11;
+
+    TopTalkers::TopTalkers(size_t capacity)
+    {
+        for (size_t i = 0; i < DimensionCount; ++i)
+        {
+            m_Sketches[i] = std::make_unique<SpaceSavingSketch>(capacity);
+            m_Reports[i].top.reserve(capacity);
+            m_Reports[i].total = 0;
+        }
+    }
+
+    void TopTalkers::AddEvent(
+        const EventKeys& eventKeys)
+    {
+        ntl::AutoReleaseHotLock lockScoped(m_Lock);
+        for (size_t i = 0; i < DimensionCount; ++i)
+        {
+            if (eventKeys.parsed[i])
+            {
+                m_Sketches[i]->Add(eventKeys.keys[i], eventKeys.hashes[i]);
+            }
+        }
+    }
+
+    void TopTalkers::AddEvent(
+        const VfpEventData& eventData)
+    {
+        EventKeys eventKeys;
+        eventKeys.Parse(eventData);
+        AddEvent(eventKeys);
+    }
+
+    void TopTalkers::Report(
+        size_t topCount,
+        unsigned long intervalInSeconds,
+        _Inout_ std::string& buffer)
+    {
+        {
+            ntl::AutoReleaseColdLock lockScoped(m_Lock);
+            for (size_t i = 0; i < DimensionCount; ++i)
+            {
+                m_Sketches[i]->GetTop(topCount, m_Reports[i].top);
+                m_Reports[i].total = m_Sketches[i]->GetTotal();
+                m_Sketches[i]->Reset();
+            }
+        }
+
+        buffer.append("Top talkers in the last ");
+        buffer.append(std::to_string(intervalInSeconds));
+        buffer.append(" seconds (true count is between count - error and count):\r\n");
+
+        for (size_t i = 0; i < DimensionCount; ++i)
+        {
+            EventKeys::Field field = static_cast<EventKeys::Field>(i);
+            const DimensionReport& report = m_Reports[i];
+
+            std::string title = EventKeys::GetFieldName(field);
+            title.append(" (");
+            title.append(std::to_string(report.total));
+            title.append(" events)");
+            EventKeys::AppendTitleColumn(title, buffer);
+            EventKeys::AppendValueColumn("Count", TOP_TALKERS_COLUMN_WIDTH, buffer);
+            EventKeys::AppendValueColumn("Error", TOP_TALKERS_COLUMN_WIDTH, buffer);
+            buffer.append("\r\n");
+
+            if (report.top.empty())
+            {
+                buffer.append("    none\r\n");
+            }
+
+            for (const auto& entry : report.top)
+            {
+                EventKeys::AppendKeyColumn(field, entry.key, buffer);
+                EventKeys::AppendValueColumn(std::to_string(entry.count), TOP_TALKERS_COLUMN_WIDTH, buffer);
+                EventKeys::AppendValueColumn(std::to_string(entry.error), TOP_TALKERS_COLUMN_WIDTH, buffer);
+                buffer.append("\r\n");
+            }
+        }
+        buffer.append("\r\n");
+    }
+}
\ No newline at end of file
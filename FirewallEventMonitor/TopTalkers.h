@@ -0,0 +1,67 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "EventKeys.h"
+#include "SpaceSavingSketch.h"
+#include "VfpEventData.h"
+// ntl headers
+#include "ntlLocks.hpp"
+
+namespace FirewallEventMonitor
+{
+    // The busiest source addresses, destination addresses, destination ports, rules and ports,
+    // each tracked in a fixed-size Space-Saving sketch and reported once per interval.
+    //
+    // The event path adds the event's parsed keys under the hot side of an ntl::AsymmetricLock,
+    // which takes no interlocked instruction; Report copies the sketches out under the cold side.
+    // No memory is allocated after construction. Fields that do not parse are not counted.
+    class TopTalkers
+    {
+    public:
+        explicit TopTalkers(size_t capacity = DefaultCapacity);
+
+        // Called by one thread at a time.
+        void AddEvent(const EventKeys& eventKeys);
+
+        void AddEvent(const VfpEventData& eventData);
+
+        // Appends up to topCount keys of each dimension since the previous report, busiest first,
+        // then starts a new interval.
+        void Report(
+            size_t topCount,
+            unsigned long intervalInSeconds,
+            _Inout_ std::string& buffer);
+
+        // Constants
+        static const size_t DefaultCapacity = 100; // Counters per dimension.
+        static const size_t ReportedKeys = 10;
+
+        TopTalkers(TopTalkers const&) = delete;
+        TopTalkers& operator=(TopTalkers const&) = delete;
+
+    private:
+        // One dimension per EventKeys field.
+        static const size_t DimensionCount = EventKeys::FieldCount;
+
+        struct DimensionReport
+        {
+            std::vector<SpaceSavingSketch::Entry> top;
+            unsigned long long total;
+        };
+
+        // Guards the sketches. Held by the event path for one update and by Report for one copy.
+        ntl::AsymmetricLock m_Lock;
+        std::unique_ptr<SpaceSavingSketch> m_Sketches[DimensionCount];
+        // Copied out under the lock and formatted after it is released. Only used by Report.
+        DimensionReport m_Reports[DimensionCount];
+    };
+}
\ No newline at end of file
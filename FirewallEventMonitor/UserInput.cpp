@@ -5,6 +5,8 @@
 
 // CLSIDFromString
 #include "Objbase.h"
+// c++ headers
+#include <algorithm>
 
 using namespace FirewallEventMonitor;
 
@@ -18,7 +20,61 @@ void UserInput::PrintUsage() const
         "  -Output <output1,output2,...> : Comma-delimited list of desired output.\n"
         "    Console : Print to console.\n"
         "    File : Write to file on disk.\n"
+        "    Binary : Write to a compact binary file on disk (.bin). Convert it to text with -Export.\n"
+        "    Json : Write one JSON object per line to a file on disk (.jsonl).\n"
+        "    Csv : Write one comma-separated row per event to a file on disk (.csv).\n"
+        "    Segments : Write immutable, indexed segments of up to 64K events to files on disk (.seg). Search them with -Query.\n"
         "  -Directory <path> : Location of log file (if -Output generates one). Default: current directory.\n"
+        "  -Compress : Compress log files in blocks with XPRESS (adds .xpress to the file name).\n"
+        "  -LogFileSize <MB> : Start a new log file once the current one reaches this size. Default: no limit.\n"
+        "  -LogFileInterval <seconds> : Start a new log file after this long. 0 disables. Default: %d seconds.\n"
+        "  -LogRetention <MB> : Delete the oldest log files once each output's files exceed this total. Default: keep all.\n"
+        "  -Aggregate : Write one record per flow with event and SYN counts instead of one per event.\n"
+        "    Note: Events sharing direction, rule, port, addresses, protocol and ports form a flow.\n"
+        "  -FlowIdleTimeout <seconds> : Emit a flow once it has seen no events for this long. 0 disables. Default: %d seconds.\n"
+        "  -FlowActiveTimeout <seconds> : Emit a flow once it has been open this long. 0 disables. Default: %d seconds.\n"
+        "  -RuleStats <seconds> : Print the hits of each rule, busiest first, every interval.\n"
+        "  -RuleStatsFile : Also append the rule hits to a file on disk (.rules.csv). Requires -RuleStats.\n"
+        "  -TopTalkers <seconds> : Print the busiest source and destination addresses, destination ports, rules and ports every interval.\n"
+        "  -DistinctCounts <seconds> : Print the number of distinct source addresses and destination ports of each rule and port every interval.\n"
+        "  -RateHistory : Keep event counts per second, minute and hour for the last day in FirewallEventMonitor.rates.csv, rewritten every minute.\n"
+        "  -Latency <seconds> : Print p50/p99/p99.9/max of the callback's processing time per stage and of the event age every interval and at the end.\n"
+        "  -Metrics <seconds> : Rewrite FirewallEventMonitor.prom in the log directory every interval with this monitor's event counts per stage, drops, queue depths, latency histograms, log bytes, rotations and memory, in the Prometheus text format.\n"
+        "    Note: Point a node_exporter textfile collector at the log directory to scrape it.\n"
+        "  -Trace : Time each stage of the event path on every thread and write the last 262144 scopes of each thread to FirewallEventMonitor.trace.json in the log directory at the end, in the Chrome trace-event format.\n"
+        "    Note: Only in builds with NTL_TRACE_SCOPES defined. Open the file in chrome://tracing or ui.perfetto.dev.\n"
+        "  -DenyBursts <deviations> : Alert when a port's or rule's denies in a second exceed its moving average by this many standard deviations (4 is a good start).\n"
+        "    Note: Alerts are printed and appended to a file on disk (.alerts.log).\n"
+        "  -BurstCapture <seconds> : Write each event of a port or rule for this long after its burst alert instead of aggregating it. Requires -DenyBursts and -Aggregate.\n"
+        "  -DecodeThreads <count> : Decode and filter events on this many worker threads instead of the thread ETW delivers them on.\n"
+        "    Note: Events still reach the statistics and outputs one at a time, in the order ETW delivered them.\n"
+        "  -Export <file.bin> : Convert a binary log to a text log (<file>.log) and exit.\n"
+        "  -Decompress <file.xpress> : Decompress a compressed log (removes .xpress) and exit.\n"
+        "  -Query <path> : Print the events in the directory's segments (.seg) that pass -IP, -Rule, -Port, -Action and -Protocol, and exit.\n"
+        "    Note: Segments whose time range, address range or bloom filters rule out a match are not read.\n"
+        "  -Input <file1.etl,file2.etl,...> : Print the events in the comma-delimited list of saved captures that pass -IP, -Rule, -Port, -Action and -Protocol, and exit.\n"
+        "    Note: Files are read, and their events decoded, in parallel. Matches are printed in time order once every file is read.\n"
+        "  -Last <hours> : Only query events from the last hours. Requires -Query or -Input.\n"
+        "  -Port <port1,port2,...> : Filter for the comma-delimited list of source or destination ports. Requires -Query or -Input.\n"
+        "  -Action <Allow|Deny> : Filter for allowed or denied events. Requires -Query or -Input.\n"
+        "  -Protocol <protocol1,protocol2,...> : Filter for the comma-delimited list of protocols (TCP, UDP, ICMPv4, ...). Requires -Query or -Input.\n"
+        "  -Unordered : Print each match as soon as it is decoded instead of in time order. Requires -Input.\n"
+        "  -Threads <count> : Query saved captures with this many threads. Default: one per logical processor. Requires -Input.\n"
+        "  -Replay <file.etl|file.bin> : Feed the events of a saved capture or binary log through the filters, statistics and outputs instead of capturing, then print the events per second sustained, the drops and the latency percentiles.\n"
+        "    Note: Needs no VFP provider. -TimeLimit and -EventThrottle still apply.\n"
+        "  -ReplaySpeed <multiple|Max> : Replay at this multiple of the original pace, or as fast as possible. Default: 1. Requires -Replay.\n"
+        "  -Synthetic <eventsPerSecond|Max> : Feed made-up VFP rule match events through the filters, statistics and outputs at this rate instead of capturing, then print the events per second sustained.\n"
+        "    Note: Needs no VFP provider. -TimeLimit and -EventThrottle still apply.\n"
+        "  -SyntheticMix <Name=value,...> : Shape the synthetic traffic. Requires -Synthetic.\n"
+        "    Sources : Hosts sending ordinary traffic. Default: 10000.\n"
+        "    Rules : Rules matching ordinary traffic. Default: 100.\n"
+        "    Zipf : How much the busiest hosts and rules dominate; 0 spreads traffic evenly. Default: 1.\n"
+        "    IPv6 : Percent of ordinary traffic over IPv6. Default: 20.\n"
+        "    SynFlood : Percent of events that are SYNs from spoofed sources at one server. Default: 0.\n"
+        "    IcmpSweep : Percent of events that are echo requests from one scanner sweeping a /16. Default: 0.\n"
+        "    Seed : Make the same events every run. Default: a random seed.\n"
+        "  -Merge <input1,input2,...> : Print the events of several hosts' logs that pass -IP and -Rule in time order, each line led by its host, and exit.\n"
+        "    Note: An input is a binary log, a directory of a host's binary logs or a saved capture (.etl). The host is the directory's name, or the file's name up to its first dot.\n"
         "  -IP <address1,address2,...> : Fitler for the comma-delimited list of addresses.\n"
         "    Note: Events without the specified IP address(es) in either source or destination are ignored.\n"
         "  -Rule <guid1,guid2,...> : Fitler for the comma-delimited list of Rule Ids.\n"
@@ -26,7 +82,10 @@ void UserInput::PrintUsage() const
         "    Note: Must be valid Guids. XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX or \"{XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}\" \n"
         "\n",
         Parameters::DefaultTimeLimitInSeconds,
-        Parameters::DefaultEventCountMaxPerSecond);
+        Parameters::DefaultEventCountMaxPerSecond,
+        Parameters::DefaultLogFileIntervalInSeconds,
+        Parameters::DefaultFlowIdleTimeoutInSeconds,
+        Parameters::DefaultFlowActiveTimeoutInSeconds);
 }
 
 ArgumentParsingResults UserInput::ParseArguments(
@@ -73,131 +132,1070 @@ try
         success = false;
     }
 
+    if (!ParseCompress(args))
+    {
+        success = false;
+    }
+
+    if (!ParseLogFileSize(args))
+    {
+        success = false;
+    }
+
+    if (!ParseLogFileInterval(args))
+    {
+        success = false;
+    }
+
+    if (!ParseLogRetention(args))
+    {
+        success = false;
+    }
+
+    if (!ParseAggregate(args))
+    {
+        success = false;
+    }
+
+    if (!ParseFlowIdleTimeout(args))
+    {
+        success = false;
+    }
+
+    if (!ParseFlowActiveTimeout(args))
+    {
+        success = false;
+    }
+
+    if (!ParseRuleStats(args))
+    {
+        success = false;
+    }
+
+    if (!ParseRuleStatsFile(args))
+    {
+        success = false;
+    }
+
+    if (!ParseTopTalkers(args))
+    {
+        success = false;
+    }
+
+    if (!ParseDistinctCounts(args))
+    {
+        success = false;
+    }
+
+    if (!ParseRateHistory(args))
+    {
+        success = false;
+    }
+
+    if (!ParseLatency(args))
+    {
+        success = false;
+    }
+
+    if (!ParseMetrics(args))
+    {
+        success = false;
+    }
+
+    if (!ParseTrace(args))
+    {
+        success = false;
+    }
+
+    if (!ParseDenyBursts(args))
+    {
+        success = false;
+    }
+
+    if (!ParseBurstCapture(args))
+    {
+        success = false;
+    }
+
+    if (!ParseExport(args))
+    {
+        success = false;
+    }
+
+    if (!ParseDecompress(args))
+    {
+        success = false;
+    }
+
+    if (!ParseQuery(args))
+    {
+        success = false;
+    }
+
+    if (!ParseInput(args))
+    {
+        success = false;
+    }
+
+    if (!ParseLast(args))
+    {
+        success = false;
+    }
+
+    if (!ParsePortFilters(args))
+    {
+        success = false;
+    }
+
+    if (!ParseAction(args))
+    {
+        success = false;
+    }
+
+    if (!ParseProtocolFilters(args))
+    {
+        success = false;
+    }
+
+    if (!ParseUnordered(args))
+    {
+        success = false;
+    }
+
+    if (!ParseThreads(args))
+    {
+        success = false;
+    }
+
+    if (!ParseReplay(args))
+    {
+        success = false;
+    }
+
+    if (!ParseReplaySpeed(args))
+    {
+        success = false;
+    }
+
+    if (!ParseSynthetic(args))
+    {
+        success = false;
+    }
+
+    if (!ParseSyntheticMix(args))
+    {
+        success = false;
+    }
+
+    if (!ParseDecodeThreads(args))
+    {
+        success = false;
+    }
+
+    if (!ParseMerge(args))
+    {
+        success = false;
+    }
+
     if (!ParseIpAddressFilters(args))
     {
-        success = false;
+        success = false;
+    }
+
+    if (!ParseRuleIdFilters(args))
+    {
+        success = false;
+    }
+
+    if (!success)
+    {
+        wprintf(L"Parsing arguments failed.\n");
+        PrintUsage();
+        return ArgumentParsingResults::Fail;
+    }
+
+    return  ArgumentParsingResults::Success;
+}
+catch (const std::exception &ex)
+{
+    wprintf(L"Attempting to parse arguments raised exception: %S.\n", ex.what());
+    return ArgumentParsingResults::Fail;
+}
+
+bool UserInput::ParseHelp(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Help, -?
+    bool helpFound = ArgumentProcessing::FindParameter(_args, L"-Help");
+    bool questionmarkFound = ArgumentProcessing::FindParameter(_args, L"-?");
+    if (helpFound ||
+        questionmarkFound)
+    {
+        PrintUsage();
+        return true;
+    }
+    return false;
+}
+
+bool UserInput::ParseEventThrottle(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -MaxEvents 5
+    std::wstring numEvents;
+    bool foundEvents = ArgumentProcessing::FindParameter(_args, L"-EventThrottle", true, &numEvents);
+    if (!foundEvents)
+    {
+        return true;
+    }
+
+    m_Parameters.maxEventsPerEpoc = std::stoul(numEvents);
+    wprintf(L"\tEventThrottle: limiting collection to %d events per second.\n", m_Parameters.maxEventsPerEpoc);
+
+    return true;
+}
+
+bool UserInput::ParseTimeLimit(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -TimeLimit 60
+    std::wstring seconds;
+    bool foundTimeLimit = ArgumentProcessing::FindParameter(_args, L"-TimeLimit", true, &seconds);
+    if (!foundTimeLimit)
+    {
+        return true;
+    }
+
+    m_Parameters.maxRuntimeInSeconds = std::stoul(seconds);
+    wprintf(L"\tTimeLimit: limiting runtime to %d seconds.\n", m_Parameters.maxRuntimeInSeconds);
+
+    return true;
+}
+
+bool UserInput::ParseNoTimeout(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -NoTimeout
+    bool noTimeoutFound = ArgumentProcessing::FindParameter(_args, L"-NoTimeout");
+    if (noTimeoutFound)
+    {
+        m_Parameters.noTimeout = true;
+        wprintf(L"\tNoTimeout: program will run until forcibly stopped.\n");
+    }
+    return true;
+}
+
+bool UserInput::ParseOutput(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Output Console
+    // Example: -Output Console,File
+    std::wstring outputs;
+    bool foundOutput = ArgumentProcessing::FindParameter(_args, L"-Output", true, &outputs);
+    if (!foundOutput)
+    {
+        return true;
+    }
+
+    // Undo console default if Output is specified.
+    m_Parameters.outputToConsole = false;
+
+    ValidationFunction func = [&](const std::wstring& input)->bool 
+    { return ValidateOutputType(input); };
+
+    bool valid = ValidateCommaDelimitedInput(
+        outputs,
+        func);
+
+    return valid;
+}
+
+bool UserInput::ParseDirectory(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Directory C:\temp
+    std::wstring directory;
+    bool foundDirecotry = ArgumentProcessing::FindParameter(_args, L"-Directory", true, &directory);
+    if (!foundDirecotry)
+    {
+        return true;
+    }
+
+    // No validation at the moment.
+    m_Parameters.logDirectory.assign(directory);
+    return true;
+}
+
+bool UserInput::ParseCompress(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Compress
+    bool compressFound = ArgumentProcessing::FindParameter(_args, L"-Compress");
+    if (compressFound)
+    {
+        m_Parameters.compressLogFiles = true;
+        wprintf(L"\tCompress: compressing log files.\n");
+    }
+    return true;
+}
+
+bool UserInput::ParseLogFileSize(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -LogFileSize 256
+    std::wstring megabytes;
+    bool foundLogFileSize = ArgumentProcessing::FindParameter(_args, L"-LogFileSize", true, &megabytes);
+    if (!foundLogFileSize)
+    {
+        return true;
+    }
+
+    m_Parameters.logFileSizeInMB = std::stoul(megabytes);
+    wprintf(L"\tLogFileSize: starting a new log file every %d MB.\n", m_Parameters.logFileSizeInMB);
+    return true;
+}
+
+bool UserInput::ParseLogFileInterval(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -LogFileInterval 600
+    std::wstring seconds;
+    bool foundLogFileInterval = ArgumentProcessing::FindParameter(_args, L"-LogFileInterval", true, &seconds);
+    if (!foundLogFileInterval)
+    {
+        return true;
+    }
+
+    m_Parameters.logFileIntervalInSeconds = std::stoul(seconds);
+    wprintf(L"\tLogFileInterval: starting a new log file every %d seconds.\n", m_Parameters.logFileIntervalInSeconds);
+    return true;
+}
+
+bool UserInput::ParseLogRetention(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -LogRetention 10240
+    std::wstring megabytes;
+    bool foundLogRetention = ArgumentProcessing::FindParameter(_args, L"-LogRetention", true, &megabytes);
+    if (!foundLogRetention)
+    {
+        return true;
+    }
+
+    m_Parameters.logRetentionInMB = std::stoul(megabytes);
+    wprintf(L"\tLogRetention: keeping at most %d MB of log files per output.\n", m_Parameters.logRetentionInMB);
+    return true;
+}
+
+bool UserInput::ParseAggregate(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Aggregate
+    bool aggregateFound = ArgumentProcessing::FindParameter(_args, L"-Aggregate");
+    if (aggregateFound)
+    {
+        m_Parameters.aggregateFlows = true;
+        wprintf(L"\tAggregate: writing one record per flow.\n");
+    }
+    return true;
+}
+
+bool UserInput::ParseFlowIdleTimeout(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -FlowIdleTimeout 30
+    std::wstring seconds;
+    bool foundFlowIdleTimeout = ArgumentProcessing::FindParameter(_args, L"-FlowIdleTimeout", true, &seconds);
+    if (!foundFlowIdleTimeout)
+    {
+        return true;
+    }
+
+    m_Parameters.flowIdleTimeoutInSeconds = std::stoul(seconds);
+    wprintf(L"\tFlowIdleTimeout: emitting flows idle for %d seconds.\n", m_Parameters.flowIdleTimeoutInSeconds);
+    return true;
+}
+
+bool UserInput::ParseFlowActiveTimeout(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -FlowActiveTimeout 600
+    std::wstring seconds;
+    bool foundFlowActiveTimeout = ArgumentProcessing::FindParameter(_args, L"-FlowActiveTimeout", true, &seconds);
+    if (!foundFlowActiveTimeout)
+    {
+        return true;
+    }
+
+    m_Parameters.flowActiveTimeoutInSeconds = std::stoul(seconds);
+    wprintf(L"\tFlowActiveTimeout: emitting flows open for %d seconds.\n", m_Parameters.flowActiveTimeoutInSeconds);
+    return true;
+}
+
+bool UserInput::ParseRuleStats(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -RuleStats 10
+    std::wstring seconds;
+    bool foundRuleStats = ArgumentProcessing::FindParameter(_args, L"-RuleStats", true, &seconds);
+    if (!foundRuleStats)
+    {
+        return true;
+    }
+
+    m_Parameters.ruleStatsIntervalInSeconds = std::stoul(seconds);
+    if (m_Parameters.ruleStatsIntervalInSeconds == 0)
+    {
+        wprintf(L"RuleStats interval must be at least 1 second.\n");
+        return false;
+    }
+
+    wprintf(L"\tRuleStats: printing rule hits every %d seconds.\n", m_Parameters.ruleStatsIntervalInSeconds);
+    return true;
+}
+
+bool UserInput::ParseRuleStatsFile(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -RuleStatsFile
+    bool ruleStatsFileFound = ArgumentProcessing::FindParameter(_args, L"-RuleStatsFile");
+    if (!ruleStatsFileFound)
+    {
+        return true;
+    }
+
+    if (m_Parameters.ruleStatsIntervalInSeconds == 0)
+    {
+        wprintf(L"RuleStatsFile requires -RuleStats.\n");
+        return false;
+    }
+
+    m_Parameters.ruleStatsToFile = true;
+    wprintf(L"\tRuleStatsFile: writing rule hits to file.\n");
+    return true;
+}
+
+bool UserInput::ParseTopTalkers(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -TopTalkers 10
+    std::wstring seconds;
+    bool foundTopTalkers = ArgumentProcessing::FindParameter(_args, L"-TopTalkers", true, &seconds);
+    if (!foundTopTalkers)
+    {
+        return true;
+    }
+
+    m_Parameters.topTalkersIntervalInSeconds = std::stoul(seconds);
+    if (m_Parameters.topTalkersIntervalInSeconds == 0)
+    {
+        wprintf(L"TopTalkers interval must be at least 1 second.\n");
+        return false;
+    }
+
+    wprintf(L"\tTopTalkers: printing the busiest addresses, ports and rules every %d seconds.\n", m_Parameters.topTalkersIntervalInSeconds);
+    return true;
+}
+
+bool UserInput::ParseDistinctCounts(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -DistinctCounts 10
+    std::wstring seconds;
+    bool foundDistinctCounts = ArgumentProcessing::FindParameter(_args, L"-DistinctCounts", true, &seconds);
+    if (!foundDistinctCounts)
+    {
+        return true;
+    }
+
+    m_Parameters.distinctCountsIntervalInSeconds = std::stoul(seconds);
+    if (m_Parameters.distinctCountsIntervalInSeconds == 0)
+    {
+        wprintf(L"DistinctCounts interval must be at least 1 second.\n");
+        return false;
+    }
+
+    wprintf(L"\tDistinctCounts: printing distinct sources and destination ports per rule and port every %d seconds.\n", m_Parameters.distinctCountsIntervalInSeconds);
+    return true;
+}
+
+bool UserInput::ParseRateHistory(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -RateHistory
+    bool rateHistoryFound = ArgumentProcessing::FindParameter(_args, L"-RateHistory");
+    if (rateHistoryFound)
+    {
+        m_Parameters.rateHistory = true;
+        wprintf(L"\tRateHistory: writing event rates to FirewallEventMonitor.rates.csv every minute.\n");
+    }
+    return true;
+}
+
+bool UserInput::ParseLatency(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Latency 60
+    std::wstring seconds;
+    bool foundLatency = ArgumentProcessing::FindParameter(_args, L"-Latency", true, &seconds);
+    if (!foundLatency)
+    {
+        return true;
+    }
+
+    m_Parameters.latencyIntervalInSeconds = std::stoul(seconds);
+    if (m_Parameters.latencyIntervalInSeconds == 0)
+    {
+        wprintf(L"Latency interval must be at least 1 second.\n");
+        return false;
+    }
+
+    wprintf(L"\tLatency: printing processing time and event age percentiles every %d seconds.\n", m_Parameters.latencyIntervalInSeconds);
+    return true;
+}
+
+bool UserInput::ParseMetrics(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Metrics 15
+    std::wstring seconds;
+    bool foundMetrics = ArgumentProcessing::FindParameter(_args, L"-Metrics", true, &seconds);
+    if (!foundMetrics)
+    {
+        return true;
+    }
+
+    m_Parameters.metricsIntervalInSeconds = std::stoul(seconds);
+    if (m_Parameters.metricsIntervalInSeconds == 0)
+    {
+        wprintf(L"Metrics interval must be at least 1 second.\n");
+        return false;
+    }
+
+    wprintf(L"\tMetrics: writing FirewallEventMonitor.prom every %d seconds.\n", m_Parameters.metricsIntervalInSeconds);
+    return true;
+}
+
+bool UserInput::ParseTrace(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Trace
+    bool foundTrace = ArgumentProcessing::FindParameter(_args, L"-Trace");
+    if (!foundTrace)
+    {
+        return true;
+    }
+
+#if defined(NTL_TRACE_SCOPES)
+    m_Parameters.traceScopes = true;
+    wprintf(L"\tTrace: writing timed scopes to FirewallEventMonitor.trace.json at the end.\n");
+    return true;
+#else
+    // The scopes are compiled out, so there would be nothing to write.
+    wprintf(L"Trace requires a build with NTL_TRACE_SCOPES defined.\n");
+    return false;
+#endif
+}
+
+bool UserInput::ParseDenyBursts(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -DenyBursts 4
+    std::wstring deviations;
+    bool foundDenyBursts = ArgumentProcessing::FindParameter(_args, L"-DenyBursts", true, &deviations);
+    if (!foundDenyBursts)
+    {
+        return true;
+    }
+
+    m_Parameters.burstThresholdDeviations = std::stod(deviations);
+    if (m_Parameters.burstThresholdDeviations <= 0.0)
+    {
+        wprintf(L"DenyBursts threshold must be greater than 0 standard deviations.\n");
+        return false;
+    }
+
+    wprintf(L"\tDenyBursts: alerting on denies more than %.1f standard deviations above a port's or rule's average.\n", m_Parameters.burstThresholdDeviations);
+    return true;
+}
+
+bool UserInput::ParseBurstCapture(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -BurstCapture 60
+    std::wstring seconds;
+    bool foundBurstCapture = ArgumentProcessing::FindParameter(_args, L"-BurstCapture", true, &seconds);
+    if (!foundBurstCapture)
+    {
+        return true;
+    }
+
+    if (m_Parameters.burstThresholdDeviations == 0.0 ||
+        !m_Parameters.aggregateFlows)
+    {
+        wprintf(L"BurstCapture requires -DenyBursts and -Aggregate.\n");
+        return false;
+    }
+
+    m_Parameters.burstCaptureInSeconds = std::stoul(seconds);
+    wprintf(L"\tBurstCapture: writing every event of a bursting port or rule for %d seconds.\n", m_Parameters.burstCaptureInSeconds);
+    return true;
+}
+
+bool UserInput::ParseExport(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Export C:\temp\FirewallEventMonitor.20170914T224228.bin
+    std::wstring file;
+    bool foundExport = ArgumentProcessing::FindParameter(_args, L"-Export", true, &file);
+    if (!foundExport)
+    {
+        return true;
+    }
+
+    m_Parameters.exportFilePath.assign(file);
+    wprintf(L"\tExport: converting binary log %ls to text.\n", m_Parameters.exportFilePath.c_str());
+    return true;
+}
+
+bool UserInput::ParseDecompress(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Decompress C:\temp\FirewallEventMonitor.20170914T224228.log.xpress
+    std::wstring file;
+    bool foundDecompress = ArgumentProcessing::FindParameter(_args, L"-Decompress", true, &file);
+    if (!foundDecompress)
+    {
+        return true;
+    }
+
+    m_Parameters.decompressFilePath.assign(file);
+    wprintf(L"\tDecompress: decompressing log %ls.\n", m_Parameters.decompressFilePath.c_str());
+    return true;
+}
+
+bool UserInput::ParseQuery(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Query C:\temp
+    std::wstring directory;
+    bool foundQuery = ArgumentProcessing::FindParameter(_args, L"-Query", true, &directory);
+    if (!foundQuery)
+    {
+        return true;
+    }
+
+    m_Parameters.queryDirectory.assign(directory);
+    wprintf(L"\tQuery: searching segments in %ls.\n", m_Parameters.queryDirectory.c_str());
+    return true;
+}
+
+bool UserInput::ParseLast(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Last 168
+    std::wstring hours;
+    bool foundLast = ArgumentProcessing::FindParameter(_args, L"-Last", true, &hours);
+    if (!foundLast)
+    {
+        return true;
+    }
+
+    if (m_Parameters.queryDirectory.empty() &&
+        m_Parameters.inputFilePaths.empty())
+    {
+        wprintf(L"Last requires -Query or -Input.\n");
+        return false;
+    }
+
+    m_Parameters.queryLastInHours = std::stoul(hours);
+    wprintf(L"\tLast: querying events from the last %d hours.\n", m_Parameters.queryLastInHours);
+    return true;
+}
+
+bool UserInput::ParseInput(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Input C:\traces\host1.etl
+    // Example: -Input C:\traces\host1.etl,C:\traces\host2.etl
+    std::wstring files;
+    bool foundInput = ArgumentProcessing::FindParameter(_args, L"-Input", true, &files);
+    if (!foundInput)
+    {
+        return true;
+    }
+
+    ValidationFunction func = [&](const std::wstring& input)->bool
+    {
+        // No validation at the moment: unreadable files are reported as they are queried.
+        m_Parameters.inputFilePaths.push_back(input);
+        return true;
+    };
+
+    bool valid = ValidateCommaDelimitedInput(
+        files,
+        func);
+
+    if (!valid)
+    {
+        return false;
+    }
+
+    wprintf(L"\tInput: querying %d saved captures.\n", static_cast<int>(m_Parameters.inputFilePaths.size()));
+    return true;
+}
+
+bool UserInput::ParsePortFilters(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Port 443
+    // Example: -Port 80,443 ...
+    std::wstring ports;
+    bool foundPort = ArgumentProcessing::FindParameter(_args, L"-Port", true, &ports);
+    if (!foundPort)
+    {
+        return true;
+    }
+
+    if (m_Parameters.queryDirectory.empty() &&
+        m_Parameters.inputFilePaths.empty())
+    {
+        wprintf(L"Port requires -Query or -Input.\n");
+        return false;
+    }
+
+    ValidationFunction func = [&](const std::wstring& input)->bool
+    { return ValidatePort(input); };
+
+    bool valid = ValidateCommaDelimitedInput(
+        ports,
+        func);
+
+    if (!valid)
+    {
+        return false;
     }
 
-    if (!ParseRuleIdFilters(args))
+    wprintf(L"\tPort: filtering by the following ports [");
+    for (const auto& port : m_Parameters.portFilters)
     {
-        success = false;
+        wprintf(L"%ls ", port.c_str());
     }
+    wprintf(L"]\n");
+    return true;
+}
 
-    if (!success)
+bool UserInput::ParseAction(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Action Deny
+    std::wstring action;
+    bool foundAction = ArgumentProcessing::FindParameter(_args, L"-Action", true, &action);
+    if (!foundAction)
     {
-        wprintf(L"Parsing arguments failed.\n");
-        PrintUsage();
-        return ArgumentParsingResults::Fail;
+        return true;
     }
 
-    return  ArgumentParsingResults::Success;
+    if (m_Parameters.queryDirectory.empty() &&
+        m_Parameters.inputFilePaths.empty())
+    {
+        wprintf(L"Action requires -Query or -Input.\n");
+        return false;
+    }
+
+    if (ntl::String::iordinal_equals(action, L"Allow"))
+    {
+        m_Parameters.actionFilter = L"Allow";
+    }
+    else if (ntl::String::iordinal_equals(action, L"Deny"))
+    {
+        m_Parameters.actionFilter = L"Deny";
+    }
+    else
+    {
+        wprintf(L"Unrecognized action specified: %ls.\n", action.c_str());
+        return false;
+    }
+
+    wprintf(L"\tAction: filtering for %ls events.\n", m_Parameters.actionFilter.c_str());
+    return true;
 }
-catch (const std::exception &ex)
+
+bool UserInput::ParseProtocolFilters(
+    const std::vector<const wchar_t*>& _args)
 {
-    wprintf(L"Attempting to parse arguments raised exception: %S.\n", ex.what());
-    return ArgumentParsingResults::Fail;
+    // Example: -Protocol TCP
+    // Example: -Protocol TCP,UDP ...
+    std::wstring protocols;
+    bool foundProtocol = ArgumentProcessing::FindParameter(_args, L"-Protocol", true, &protocols);
+    if (!foundProtocol)
+    {
+        return true;
+    }
+
+    if (m_Parameters.queryDirectory.empty() &&
+        m_Parameters.inputFilePaths.empty())
+    {
+        wprintf(L"Protocol requires -Query or -Input.\n");
+        return false;
+    }
+
+    ValidationFunction func = [&](const std::wstring& input)->bool
+    { return ValidateProtocol(input); };
+
+    bool valid = ValidateCommaDelimitedInput(
+        protocols,
+        func);
+
+    if (!valid)
+    {
+        return false;
+    }
+
+    wprintf(L"\tProtocol: filtering by the following protocols [");
+    for (const auto& protocol : m_Parameters.protocolFilters)
+    {
+        wprintf(L"%ls ", protocol.c_str());
+    }
+    wprintf(L"]\n");
+    return true;
 }
 
-bool UserInput::ParseHelp(
+bool UserInput::ParseUnordered(
     const std::vector<const wchar_t*>& _args)
 {
-    // Example: -Help, -?
-    bool helpFound = ArgumentProcessing::FindParameter(_args, L"-Help");
-    bool questionmarkFound = ArgumentProcessing::FindParameter(_args, L"-?");
-    if (helpFound ||
-        questionmarkFound)
+    // Example: -Unordered
+    bool unorderedFound = ArgumentProcessing::FindParameter(_args, L"-Unordered");
+    if (!unorderedFound)
     {
-        PrintUsage();
         return true;
     }
-    return false;
+
+    if (m_Parameters.inputFilePaths.empty())
+    {
+        wprintf(L"Unordered requires -Input.\n");
+        return false;
+    }
+
+    m_Parameters.unorderedOutput = true;
+    wprintf(L"\tUnordered: printing matches as they are decoded.\n");
+    return true;
 }
 
-bool UserInput::ParseEventThrottle(
+bool UserInput::ParseThreads(
     const std::vector<const wchar_t*>& _args)
 {
-    // Example: -MaxEvents 5
-    std::wstring numEvents;
-    bool foundEvents = ArgumentProcessing::FindParameter(_args, L"-EventThrottle", true, &numEvents);
-    if (!foundEvents)
+    // Example: -Threads 8
+    std::wstring threads;
+    bool foundThreads = ArgumentProcessing::FindParameter(_args, L"-Threads", true, &threads);
+    if (!foundThreads)
     {
         return true;
     }
 
-    m_Parameters.maxEventsPerEpoc = std::stoul(numEvents);
-    wprintf(L"\tEventThrottle: limiting collection to %d events per second.\n", m_Parameters.maxEventsPerEpoc);
+    if (m_Parameters.inputFilePaths.empty())
+    {
+        wprintf(L"Threads requires -Input.\n");
+        return false;
+    }
+
+    m_Parameters.queryThreads = std::stoul(threads);
+    if (m_Parameters.queryThreads == 0)
+    {
+        wprintf(L"Threads must be at least 1.\n");
+        return false;
+    }
 
+    wprintf(L"\tThreads: querying with %d threads.\n", m_Parameters.queryThreads);
     return true;
 }
 
-bool UserInput::ParseTimeLimit(
+bool UserInput::ParseReplay(
     const std::vector<const wchar_t*>& _args)
 {
-    // Example: -TimeLimit 60
-    std::wstring seconds;
-    bool foundTimeLimit = ArgumentProcessing::FindParameter(_args, L"-TimeLimit", true, &seconds);
-    if (!foundTimeLimit)
+    // Example: -Replay C:\traces\host1.etl
+    // Example: -Replay C:\temp\FirewallEventMonitor.20170914T224228.bin
+    std::wstring file;
+    bool foundReplay = ArgumentProcessing::FindParameter(_args, L"-Replay", true, &file);
+    if (!foundReplay)
     {
         return true;
     }
 
-    m_Parameters.maxRuntimeInSeconds = std::stoul(seconds);
-    wprintf(L"\tTimeLimit: limiting runtime to %d seconds.\n", m_Parameters.maxRuntimeInSeconds);
+    m_Parameters.replayFilePath.assign(file);
+    wprintf(L"\tReplay: replaying %ls instead of capturing.\n", m_Parameters.replayFilePath.c_str());
+    return true;
+}
 
+bool UserInput::ParseReplaySpeed(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -ReplaySpeed 10
+    // Example: -ReplaySpeed Max
+    std::wstring speed;
+    bool foundReplaySpeed = ArgumentProcessing::FindParameter(_args, L"-ReplaySpeed", true, &speed);
+    if (!foundReplaySpeed)
+    {
+        return true;
+    }
+
+    if (m_Parameters.replayFilePath.empty())
+    {
+        wprintf(L"ReplaySpeed requires -Replay.\n");
+        return false;
+    }
+
+    if (ntl::String::iordinal_equals(speed, L"Max"))
+    {
+        m_Parameters.replaySpeed = 0.0;
+        wprintf(L"\tReplaySpeed: replaying as fast as possible.\n");
+        return true;
+    }
+
+    m_Parameters.replaySpeed = std::stod(speed);
+    if (m_Parameters.replaySpeed <= 0.0)
+    {
+        wprintf(L"ReplaySpeed must be greater than 0, or Max.\n");
+        return false;
+    }
+
+    wprintf(L"\tReplaySpeed: replaying at %gx the original pace.\n", m_Parameters.replaySpeed);
     return true;
 }
 
-bool UserInput::ParseNoTimeout(
+bool UserInput::ParseSynthetic(
     const std::vector<const wchar_t*>& _args)
 {
-    // Example: -NoTimeout
-    bool noTimeoutFound = ArgumentProcessing::FindParameter(_args, L"-NoTimeout");
-    if (noTimeoutFound)
+    // Example: -Synthetic 1000000
+    // Example: -Synthetic Max
+    std::wstring rate;
+    bool foundSynthetic = ArgumentProcessing::FindParameter(_args, L"-Synthetic", true, &rate);
+    if (!foundSynthetic)
     {
-        m_Parameters.noTimeout = true;
-        wprintf(L"\tNoTimeout: program will run until forcibly stopped.\n");
+        return true;
+    }
+
+    if (!m_Parameters.replayFilePath.empty())
+    {
+        wprintf(L"Synthetic cannot be combined with -Replay.\n");
+        return false;
+    }
+
+    m_Parameters.synthetic = true;
+    if (ntl::String::iordinal_equals(rate, L"Max"))
+    {
+        m_Parameters.syntheticEventsPerSecond = 0;
+        wprintf(L"\tSynthetic: generating events as fast as possible instead of capturing.\n");
+        return true;
+    }
+
+    m_Parameters.syntheticEventsPerSecond = std::stoul(rate);
+    if (m_Parameters.syntheticEventsPerSecond == 0)
+    {
+        wprintf(L"Synthetic must be at least 1 event per second, or Max.\n");
+        return false;
     }
+
+    wprintf(L"\tSynthetic: generating %lu events per second instead of capturing.\n", m_Parameters.syntheticEventsPerSecond);
     return true;
 }
 
-bool UserInput::ParseOutput(
+bool UserInput::ParseSyntheticMix(
     const std::vector<const wchar_t*>& _args)
 {
-    // Example: -Output Console
-    // Example: -Output Console,File
-    std::wstring outputs;
-    bool foundOutput = ArgumentProcessing::FindParameter(_args, L"-Output", true, &outputs);
-    if (!foundOutput)
+    // Example: -SyntheticMix Sources=100000,IPv6=50
+    // Example: -SyntheticMix SynFlood=30,IcmpSweep=5,Seed=7
+    std::wstring settings;
+    bool foundSyntheticMix = ArgumentProcessing::FindParameter(_args, L"-SyntheticMix", true, &settings);
+    if (!foundSyntheticMix)
     {
         return true;
     }
 
-    // Undo console default if Output is specified.
-    m_Parameters.outputToConsole = false;
+    if (!m_Parameters.synthetic)
+    {
+        wprintf(L"SyntheticMix requires -Synthetic.\n");
+        return false;
+    }
 
-    ValidationFunction func = [&](const std::wstring& input)->bool 
-    { return ValidateOutputType(input); };
+    ValidationFunction func = [&](const std::wstring& input)->bool
+    { return ValidateSyntheticSetting(input); };
 
     bool valid = ValidateCommaDelimitedInput(
-        outputs,
+        settings,
         func);
 
-    return valid;
+    if (!valid)
+    {
+        return false;
+    }
+
+    if (m_Parameters.syntheticSynFloodPercent + m_Parameters.syntheticIcmpSweepPercent > 100.0)
+    {
+        wprintf(L"SyntheticMix SynFlood and IcmpSweep together must be at most 100 percent.\n");
+        return false;
+    }
+
+    wprintf(L"\tSyntheticMix: %lu sources, %lu rules, Zipf %g, %g%% IPv6, %g%% SYN flood, %g%% ICMP sweep.\n",
+        m_Parameters.syntheticSources,
+        m_Parameters.syntheticRules,
+        m_Parameters.syntheticZipfExponent,
+        m_Parameters.syntheticIpv6Percent,
+        m_Parameters.syntheticSynFloodPercent,
+        m_Parameters.syntheticIcmpSweepPercent);
+    return true;
 }
 
-bool UserInput::ParseDirectory(
+bool UserInput::ParseDecodeThreads(
     const std::vector<const wchar_t*>& _args)
 {
-    // Example: -Directory C:\temp
-    std::wstring directory;
-    bool foundDirecotry = ArgumentProcessing::FindParameter(_args, L"-Directory", true, &directory);
-    if (!foundDirecotry)
+    // Example: -DecodeThreads 16
+    std::wstring threads;
+    bool foundDecodeThreads = ArgumentProcessing::FindParameter(_args, L"-DecodeThreads", true, &threads);
+    if (!foundDecodeThreads)
     {
         return true;
     }
 
-    // No validation at the moment.
-    m_Parameters.logDirectory.assign(directory);
+    m_Parameters.decodeThreads = std::stoul(threads);
+    if (m_Parameters.decodeThreads == 0)
+    {
+        wprintf(L"DecodeThreads must be at least 1.\n");
+        return false;
+    }
+
+    wprintf(L"\tDecodeThreads: decoding with %d threads.\n", m_Parameters.decodeThreads);
+    return true;
+}
+
+bool UserInput::ParseMerge(
+    const std::vector<const wchar_t*>& _args)
+{
+    // Example: -Merge C:\logs\host1,C:\logs\host2
+    // Example: -Merge C:\traces\host1.etl,C:\traces\host2.etl
+    std::wstring inputs;
+    bool foundMerge = ArgumentProcessing::FindParameter(_args, L"-Merge", true, &inputs);
+    if (!foundMerge)
+    {
+        return true;
+    }
+
+    ValidationFunction func = [&](const std::wstring& input)->bool
+    {
+        // No validation at the moment: unreadable inputs are reported as they are merged.
+        m_Parameters.mergeInputs.push_back(input);
+        return true;
+    };
+
+    bool valid = ValidateCommaDelimitedInput(
+        inputs,
+        func);
+
+    if (!valid)
+    {
+        return false;
+    }
+
+    wprintf(L"\tMerge: merging the logs of %d hosts.\n", static_cast<int>(m_Parameters.mergeInputs.size()));
     return true;
 }
 
@@ -280,6 +1278,26 @@ bool UserInput::ValidateOutputType(
         wprintf(L"\tOutput: writing to File.\n");
         m_Parameters.outputToFile = true;
     }
+    else if (ntl::String::iordinal_equals(value, L"Binary"))
+    {
+        wprintf(L"\tOutput: writing to Binary file.\n");
+        m_Parameters.outputToBinaryFile = true;
+    }
+    else if (ntl::String::iordinal_equals(value, L"Json"))
+    {
+        wprintf(L"\tOutput: writing to Json file.\n");
+        m_Parameters.outputToJsonFile = true;
+    }
+    else if (ntl::String::iordinal_equals(value, L"Csv"))
+    {
+        wprintf(L"\tOutput: writing to Csv file.\n");
+        m_Parameters.outputToCsvFile = true;
+    }
+    else if (ntl::String::iordinal_equals(value, L"Segments"))
+    {
+        wprintf(L"\tOutput: writing to Segment files.\n");
+        m_Parameters.outputToSegmentFiles = true;
+    }
     else
     {
         wprintf(L"Unrecognized output type specified: %ls.\n", value.c_str());
@@ -326,6 +1344,123 @@ bool UserInput::ValidateRuleId(
     return false;
 }
 
+bool UserInput::ValidatePort(
+    const std::wstring& port)
+{
+    bool digits =
+        !port.empty() &&
+        port.size() <= 5 &&
+        std::all_of(port.begin(), port.end(), [](wchar_t _ch) -> bool { return _ch >= L'0' && _ch <= L'9'; });
+    if (!digits || std::stoul(port) > 65535)
+    {
+        wprintf(L"Invalid port: %ls.\n", port.c_str());
+        return false;
+    }
+
+    // Events report ports without leading zeros.
+    m_Parameters.portFilters.push_back(std::to_wstring(std::stoul(port)));
+    return true;
+}
+
+bool UserInput::ValidateProtocol(
+    const std::wstring& protocol)
+{
+    // As FirewallEtwTraceCallback::CollectEventData names them.
+    static const wchar_t* const protocolNames[] = {
+        L"HOPOPT", L"ICMPv4", L"IGMP", L"TCP", L"UDP", L"IPv6", L"IPv6Route",
+        L"IPv6Frag", L"GRE", L"ICMPv6", L"IPv6NoNxt", L"IPv6Opts", L"ANY" };
+
+    for (const auto& name : protocolNames)
+    {
+        if (ntl::String::iordinal_equals(protocol, name))
+        {
+            m_Parameters.protocolFilters.push_back(name);
+            return true;
+        }
+    }
+
+    wprintf(L"Unrecognized protocol specified: %ls.\n", protocol.c_str());
+    return false;
+}
+
+bool UserInput::ValidateSyntheticSetting(
+    const std::wstring& setting)
+{
+    size_t equals = setting.find(L'=');
+    if (equals == std::wstring::npos)
+    {
+        wprintf(L"SyntheticMix setting %ls is not Name=value.\n", setting.c_str());
+        return false;
+    }
+
+    std::wstring name = setting.substr(0, equals);
+    std::wstring value = setting.substr(equals + 1);
+    auto validPercent = [&](double percent)->bool
+    {
+        if (percent < 0.0 || percent > 100.0)
+        {
+            wprintf(L"SyntheticMix %ls must be a percent from 0 to 100.\n", name.c_str());
+            return false;
+        }
+        return true;
+    };
+
+    if (ntl::String::iordinal_equals(name, L"Sources"))
+    {
+        m_Parameters.syntheticSources = std::stoul(value);
+        if (m_Parameters.syntheticSources == 0 ||
+            m_Parameters.syntheticSources > Parameters::MaximumSyntheticSources)
+        {
+            wprintf(L"SyntheticMix Sources must be from 1 to %lu.\n", Parameters::MaximumSyntheticSources);
+            return false;
+        }
+    }
+    else if (ntl::String::iordinal_equals(name, L"Rules"))
+    {
+        m_Parameters.syntheticRules = std::stoul(value);
+        if (m_Parameters.syntheticRules == 0)
+        {
+            wprintf(L"SyntheticMix Rules must be at least 1.\n");
+            return false;
+        }
+    }
+    else if (ntl::String::iordinal_equals(name, L"Zipf"))
+    {
+        m_Parameters.syntheticZipfExponent = std::stod(value);
+        if (m_Parameters.syntheticZipfExponent < 0.0)
+        {
+            wprintf(L"SyntheticMix Zipf must be at least 0.\n");
+            return false;
+        }
+    }
+    else if (ntl::String::iordinal_equals(name, L"IPv6"))
+    {
+        m_Parameters.syntheticIpv6Percent = std::stod(value);
+        return validPercent(m_Parameters.syntheticIpv6Percent);
+    }
+    else if (ntl::String::iordinal_equals(name, L"SynFlood"))
+    {
+        m_Parameters.syntheticSynFloodPercent = std::stod(value);
+        return validPercent(m_Parameters.syntheticSynFloodPercent);
+    }
+    else if (ntl::String::iordinal_equals(name, L"IcmpSweep"))
+    {
+        m_Parameters.syntheticIcmpSweepPercent = std::stod(value);
+        return validPercent(m_Parameters.syntheticIcmpSweepPercent);
+    }
+    else if (ntl::String::iordinal_equals(name, L"Seed"))
+    {
+        m_Parameters.syntheticSeed = std::stoul(value);
+    }
+    else
+    {
+        wprintf(L"SyntheticMix setting %ls is not recognized.\n", name.c_str());
+        return false;
+    }
+
+    return true;
+}
+
 bool UserInput::ValidateCommaDelimitedInput(
     const std::wstring& input,
     _In_ ValidationFunction matchFunction)
@@ -29,10 +29,75 @@ namespace FirewallEventMonitor
         std::wstring logDirectory = L""; // Defaults to current directory
         bool outputToConsole = true;
         bool outputToFile = false;
+        bool outputToBinaryFile = false;
+        bool outputToJsonFile = false;
+        bool outputToCsvFile = false;
+        bool outputToSegmentFiles = false;
+        bool compressLogFiles = false;
+        unsigned long logFileSizeInMB = 0; // 0: no size limit.
+        unsigned long logFileIntervalInSeconds = DefaultLogFileIntervalInSeconds; // 0: no time limit.
+        unsigned long logRetentionInMB = 0; // 0: keep every file.
+        // FlowTable
+        bool aggregateFlows = false;
+        unsigned long flowIdleTimeoutInSeconds = DefaultFlowIdleTimeoutInSeconds; // 0: no idle timeout.
+        unsigned long flowActiveTimeoutInSeconds = DefaultFlowActiveTimeoutInSeconds; // 0: no active timeout.
+        // RuleHitCounter
+        unsigned long ruleStatsIntervalInSeconds = 0; // 0: no rule statistics.
+        bool ruleStatsToFile = false;
+        // TopTalkers
+        unsigned long topTalkersIntervalInSeconds = 0; // 0: no top talkers.
+        // DistinctCounter
+        unsigned long distinctCountsIntervalInSeconds = 0; // 0: no distinct counts.
+        // RateHistory
+        bool rateHistory = false;
+        // LatencyMonitor
+        unsigned long latencyIntervalInSeconds = 0; // 0: no latency histograms.
+        // SelfMetrics
+        unsigned long metricsIntervalInSeconds = 0; // 0: no metrics file.
+        // ntl::Trace
+        bool traceScopes = false; // Needs a build with NTL_TRACE_SCOPES defined.
+        // BurstDetector
+        double burstThresholdDeviations = 0.0; // 0: no burst detection.
+        unsigned long burstCaptureInSeconds = 0; // 0: bursts are aggregated like any other events.
+        // DecodePipeline
+        unsigned long decodeThreads = 0; // 0: decode on the ETW thread.
+        // Export
+        std::wstring exportFilePath = L""; // Binary log to convert to text instead of capturing.
+        std::wstring decompressFilePath = L""; // Compressed log to decompress instead of capturing.
+        // SegmentQuery
+        std::wstring queryDirectory = L""; // Segments to query instead of capturing.
+        unsigned long queryLastInHours = 0; // 0: no time limit.
+        // EtlQuery
+        std::vector<std::wstring> inputFilePaths; // Saved captures (.etl) to query instead of capturing.
+        std::vector<std::wstring> portFilters; // Source or destination ports.
+        std::vector<std::wstring> protocolFilters;
+        std::wstring actionFilter = L""; // Allow or Deny; empty matches both.
+        bool unorderedOutput = false; // Print matches as they are decoded instead of in time order.
+        unsigned long queryThreads = 0; // 0: one per logical processor.
+        // EventReplayer
+        std::wstring replayFilePath = L""; // Saved capture (.etl) or binary log (.bin) to replay instead of capturing.
+        double replaySpeed = 1.0; // Multiple of the original pace; 0: as fast as possible.
+        // SyntheticEventSource
+        bool synthetic = false; // Generate events instead of capturing.
+        unsigned long syntheticEventsPerSecond = 0; // 0: as fast as possible.
+        unsigned long syntheticSources = 10000;
+        unsigned long syntheticRules = 100;
+        double syntheticZipfExponent = 1.0;
+        double syntheticIpv6Percent = 20.0;
+        double syntheticSynFloodPercent = 0.0;
+        double syntheticIcmpSweepPercent = 0.0;
+        unsigned long syntheticSeed = 0; // 0: seeded randomly.
+        // LogMerger
+        std::vector<std::wstring> mergeInputs; // Logs of several hosts to merge instead of capturing.
 
         // Constants
         static const unsigned long DefaultTimeLimitInSeconds = 300ul; // 5 Minutes (ignored if noTimeout is true).
         static const unsigned long DefaultEventCountMaxPerSecond = 10000ul; // 10,000 Events.
+        static const unsigned long DefaultLogFileIntervalInSeconds = 3600ul; // 1 hour.
+        static const unsigned long DefaultFlowIdleTimeoutInSeconds = 15ul;
+        static const unsigned long DefaultFlowActiveTimeoutInSeconds = 300ul; // 5 Minutes.
+        static const unsigned long MaximumSyntheticSources = 1000000ul; // Each host's addresses are formatted up front.
+        static const unsigned long TraceRecordsPerThread = 262144ul; // 6 MB per thread; the most recent are kept.
     };
 
     enum class ArgumentParsingResults { Success, Fail, Help };
@@ -67,6 +132,72 @@ namespace FirewallEventMonitor
 
         bool ParseDirectory(const std::vector<const wchar_t*>& _args);
 
+        bool ParseCompress(const std::vector<const wchar_t*>& _args);
+
+        bool ParseLogFileSize(const std::vector<const wchar_t*>& _args);
+
+        bool ParseLogFileInterval(const std::vector<const wchar_t*>& _args);
+
+        bool ParseLogRetention(const std::vector<const wchar_t*>& _args);
+
+        bool ParseAggregate(const std::vector<const wchar_t*>& _args);
+
+        bool ParseFlowIdleTimeout(const std::vector<const wchar_t*>& _args);
+
+        bool ParseFlowActiveTimeout(const std::vector<const wchar_t*>& _args);
+
+        bool ParseRuleStats(const std::vector<const wchar_t*>& _args);
+
+        bool ParseRuleStatsFile(const std::vector<const wchar_t*>& _args);
+
+        bool ParseTopTalkers(const std::vector<const wchar_t*>& _args);
+
+        bool ParseDistinctCounts(const std::vector<const wchar_t*>& _args);
+
+        bool ParseRateHistory(const std::vector<const wchar_t*>& _args);
+
+        bool ParseLatency(const std::vector<const wchar_t*>& _args);
+
+        bool ParseMetrics(const std::vector<const wchar_t*>& _args);
+
+        bool ParseTrace(const std::vector<const wchar_t*>& _args);
+
+        bool ParseDenyBursts(const std::vector<const wchar_t*>& _args);
+
+        bool ParseBurstCapture(const std::vector<const wchar_t*>& _args);
+
+        bool ParseExport(const std::vector<const wchar_t*>& _args);
+
+        bool ParseDecompress(const std::vector<const wchar_t*>& _args);
+
+        bool ParseQuery(const std::vector<const wchar_t*>& _args);
+
+        bool ParseLast(const std::vector<const wchar_t*>& _args);
+
+        bool ParseInput(const std::vector<const wchar_t*>& _args);
+
+        bool ParsePortFilters(const std::vector<const wchar_t*>& _args);
+
+        bool ParseAction(const std::vector<const wchar_t*>& _args);
+
+        bool ParseProtocolFilters(const std::vector<const wchar_t*>& _args);
+
+        bool ParseUnordered(const std::vector<const wchar_t*>& _args);
+
+        bool ParseThreads(const std::vector<const wchar_t*>& _args);
+
+        bool ParseReplay(const std::vector<const wchar_t*>& _args);
+
+        bool ParseReplaySpeed(const std::vector<const wchar_t*>& _args);
+
+        bool ParseSynthetic(const std::vector<const wchar_t*>& _args);
+
+        bool ParseSyntheticMix(const std::vector<const wchar_t*>& _args);
+
+        bool ParseDecodeThreads(const std::vector<const wchar_t*>& _args);
+
+        bool ParseMerge(const std::vector<const wchar_t*>& _args);
+
         bool ParseIpAddressFilters(const std::vector<const wchar_t*>& _args);
 
         bool ParseRuleIdFilters(const std::vector<const wchar_t*>& _args);
@@ -85,6 +216,15 @@ namespace FirewallEventMonitor
         // Checks RuleId is a valid Guid, adds it to reader parameters.
         bool ValidateRuleId(const std::wstring& ruleId);
 
+        // Checks the port is a number from 0 to 65535, adds it to reader parameters.
+        bool ValidatePort(const std::wstring& port);
+
+        // Matches text to a protocol name as events report it, adds it to reader parameters.
+        bool ValidateProtocol(const std::wstring& protocol);
+
+        // Matches Name=value to a synthetic traffic setting, sets it in reader parameters.
+        bool ValidateSyntheticSetting(const std::wstring& setting);
+
         // Validates Comma-Delimited Input using the provided ValidationFunction.
         bool ValidateCommaDelimitedInput(
             const std::wstring& input,
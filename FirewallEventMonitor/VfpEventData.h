@@ -0,0 +1,80 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <string>
+
+namespace FirewallEventMonitor
+{
+    // Collection of Firewall event data.
+    struct VfpEventData
+    {
+    public:
+        LONGLONG timeStamp = 0; // FILETIME of the event; date and time are formatted from it.
+        std::wstring date;
+        std::wstring time;
+        std::wstring direction;
+        std::wstring ruleType;
+        std::wstring status;
+        // Port
+        std::wstring portId;
+        std::wstring portName;
+        std::wstring portFriendlyName;
+        // Flow
+        std::wstring source;
+        std::wstring destination;
+        std::wstring protocol;
+        std::wstring sourcePort;
+        std::wstring destinationPort;
+        std::wstring icmpType;
+        std::wstring isTcpSyn;
+        // Rule
+        std::wstring ruleId;
+        std::wstring layerId;
+        std::wstring groupId;
+        std::wstring gftFlags;
+        // Flow record (see FlowTable): the fields above are from the flow's first event.
+        // eventCount is 0 for a single event.
+        unsigned long long eventCount = 0;
+        unsigned long long synCount = 0;
+        LONGLONG lastTimeStamp = 0;
+    };
+
+    // VfpEventData transcoded once to UTF-8 (see EventFormatter::ConvertToUtf8),
+    // shared by every text sink so each field is converted a single time per event.
+    struct Utf8EventData
+    {
+    public:
+        LONGLONG timeStamp = 0;
+        std::string date;
+        std::string time;
+        std::string direction;
+        std::string ruleType;
+        std::string status;
+        // Port
+        std::string portId;
+        std::string portName;
+        std::string portFriendlyName;
+        // Flow
+        std::string source;
+        std::string destination;
+        std::string protocol;
+        std::string sourcePort;
+        std::string destinationPort;
+        std::string icmpType;
+        std::string isTcpSyn;
+        // Rule
+        std::string ruleId;
+        std::string layerId;
+        std::string groupId;
+        std::string gftFlags;
+        // Flow record
+        unsigned long long eventCount = 0;
+        unsigned long long synCount = 0;
+        LONGLONG lastTimeStamp = 0;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,199 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#include "WorkStealingPool.h"
+// ntl headers
+#include "ntlLocks.hpp"
+
+namespace FirewallEventMonitor
+{
+    WorkStealingPool::WorkStealingPool(
+        size_t workerCount,
+        TaskOrder taskOrder)
+        : m_TaskOrder(taskOrder),
+        m_QueuedTasks(0),
+        m_PendingTasks(0),
+        m_NextWorker(0),
+        m_StolenTasks(0)
+    {
+        if (workerCount == 0)
+        {
+            workerCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+        }
+
+        ::InitializeCriticalSectionEx(&m_CriticalSection, 4000, 0);
+        ::InitializeConditionVariable(&m_TaskQueued);
+        ::InitializeConditionVariable(&m_TasksFinished);
+
+        // Every deque exists before any worker starts stealing from them.
+        m_Workers.reserve(workerCount);
+        for (size_t i = 0; i < workerCount; ++i)
+        {
+            std::unique_ptr<Worker> worker(new Worker);
+            ::InitializeCriticalSectionEx(&worker->criticalSection, 4000, 0);
+            m_Workers.push_back(std::move(worker));
+        }
+
+        for (size_t i = 0; i < workerCount; ++i)
+        {
+            m_Workers[i]->thread = std::thread(&WorkStealingPool::RunWorker, this, i);
+        }
+    }
+
+    WorkStealingPool::~WorkStealingPool()
+    {
+        Wait();
+
+        {
+            ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+            m_Stopping = true;
+            ::WakeAllConditionVariable(&m_TaskQueued);
+        }
+
+        for (auto& worker : m_Workers)
+        {
+            worker->thread.join();
+            ::DeleteCriticalSection(&worker->criticalSection);
+        }
+        ::DeleteCriticalSection(&m_CriticalSection);
+    }
+
+    void WorkStealingPool::Submit(
+        size_t worker,
+        Task task)
+    {
+        ++m_PendingTasks;
+
+        // Queued under the lock, so a worker checking for work before sleeping cannot miss it.
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+        {
+            Worker& owner = *m_Workers[worker % m_Workers.size()];
+            ntl::AutoReleaseCriticalSection ownerScoped(&owner.criticalSection);
+            owner.tasks.push_back(std::move(task));
+            ++m_QueuedTasks;
+        }
+        ::WakeConditionVariable(&m_TaskQueued);
+    }
+
+    void WorkStealingPool::Submit(
+        Task task)
+    {
+        Submit(m_NextWorker++, std::move(task));
+    }
+
+    void WorkStealingPool::Wait()
+    {
+        ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+        while (m_PendingTasks > 0)
+        {
+            ::SleepConditionVariableCS(&m_TasksFinished, &m_CriticalSection, INFINITE);
+        }
+    }
+
+    size_t WorkStealingPool::GetWorkerCount() const
+    {
+        return m_Workers.size();
+    }
+
+    size_t WorkStealingPool::GetPendingTasks() const
+    {
+        return m_PendingTasks;
+    }
+
+    unsigned long long WorkStealingPool::GetStolenTasks() const
+    {
+        return m_StolenTasks;
+    }
+
+    void WorkStealingPool::RunWorker(
+        size_t worker)
+    {
+        Task task;
+        for (;;)
+        {
+            {
+                ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+                while (m_QueuedTasks == 0 && !m_Stopping)
+                {
+                    ::SleepConditionVariableCS(&m_TaskQueued, &m_CriticalSection, INFINITE);
+                }
+                if (m_QueuedTasks == 0)
+                {
+                    return;
+                }
+            }
+
+            // Another worker may have taken the task that woke this one.
+            if (!TakeTask(worker, task))
+            {
+                continue;
+            }
+
+            try
+            {
+                task(worker);
+            }
+            catch (const std::exception &ex)
+            {
+                wprintf(L"Warning: Worker task raised exception: %S.\n", ex.what());
+            }
+            // Release whatever the task captured before it counts as finished.
+            task = nullptr;
+
+            if (--m_PendingTasks == 0)
+            {
+                ntl::AutoReleaseCriticalSection csScoped(&m_CriticalSection);
+                ::WakeAllConditionVariable(&m_TasksFinished);
+            }
+        }
+    }
+
+    bool WorkStealingPool::TakeTask(
+        size_t worker,
+        _Out_ Task& task)
+    {
+        {
+            Worker& owner = *m_Workers[worker];
+            ntl::AutoReleaseCriticalSection csScoped(&owner.criticalSection);
+            if (!owner.tasks.empty())
+            {
+                if (m_TaskOrder == NewestFirst)
+                {
+                    task = std::move(owner.tasks.back());
+                    owner.tasks.pop_back();
+                }
+                else
+                {
+                    task = std::move(owner.tasks.front());
+                    owner.tasks.pop_front();
+                }
+                --m_QueuedTasks;
+                return true;
+            }
+        }
+
+        for (size_t i = 1; i < m_Workers.size(); ++i)
+        {
+            Worker& victim = *m_Workers[(worker + i) % m_Workers.size()];
+            ntl::AutoReleaseCriticalSection csScoped(&victim.criticalSection);
+            if (!victim.tasks.empty())
+            {
+                if (m_TaskOrder == NewestFirst)
+                {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                }
+                else
+                {
+                    task = std::move(victim.tasks.back());
+                    victim.tasks.pop_back();
+                }
+                --m_QueuedTasks;
+                ++m_StolenTasks;
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <winsock2.h>
+// c++ headers
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace FirewallEventMonitor
+{
+    // Fixed set of worker threads, each with its own deque of tasks.
+    //
+    // By default a worker runs its newest task first, while what that task's parent just
+    // touched is still in its cache. An idle worker steals the oldest task of another, the one
+    // most likely to split into more work, so uneven tasks (one huge file among small ones)
+    // still keep every worker busy.
+    //
+    // Tasks whose results are used in the order they were submitted run oldest first instead,
+    // and idle workers steal the newest, so the task due next is never left behind the others.
+    class WorkStealingPool
+    {
+    public:
+        // Receives the index of the worker running it, to queue follow-up work on that worker.
+        typedef std::function<void(size_t worker)> Task;
+
+        // The end of its own deque a worker takes from; thieves take from the other end.
+        enum TaskOrder
+        {
+            NewestFirst,
+            OldestFirst
+        };
+
+        // 0: one worker per logical processor.
+        explicit WorkStealingPool(
+            size_t workerCount = 0,
+            TaskOrder taskOrder = NewestFirst);
+
+        // Waits for the queued tasks, then stops the workers.
+        ~WorkStealingPool();
+
+        // Queues the task on the worker's deque, which need not be the caller's.
+        void Submit(
+            size_t worker,
+            Task task);
+
+        // Spreads tasks over the workers round robin.
+        void Submit(Task task);
+
+        // Blocks until every task submitted so far, and every task they submit, has run.
+        void Wait();
+
+        size_t GetWorkerCount() const;
+
+        // Tasks submitted and not finished yet.
+        size_t GetPendingTasks() const;
+
+        unsigned long long GetStolenTasks() const;
+
+        WorkStealingPool(WorkStealingPool const&) = delete;
+        WorkStealingPool& operator=(WorkStealingPool const&) = delete;
+
+    private:
+        struct Worker
+        {
+            // Guards tasks. Submit adds to the back; see TaskOrder for which end is taken.
+            CRITICAL_SECTION criticalSection;
+            std::deque<Task> tasks;
+            std::thread thread;
+        };
+
+        TaskOrder m_TaskOrder;
+        std::vector<std::unique_ptr<Worker>> m_Workers;
+        // Guards sleeping and waking; m_QueuedTasks only grows while it is held.
+        CRITICAL_SECTION m_CriticalSection;
+        CONDITION_VARIABLE m_TaskQueued;
+        CONDITION_VARIABLE m_TasksFinished;
+        bool m_Stopping = false;
+        // Tasks in the deques.
+        std::atomic<size_t> m_QueuedTasks;
+        // Tasks in the deques or running.
+        std::atomic<size_t> m_PendingTasks;
+        std::atomic<size_t> m_NextWorker;
+        std::atomic<unsigned long long> m_StolenTasks;
+
+        void RunWorker(size_t worker);
+
+        // Pops one of the worker's tasks, or else steals one from another worker, per m_TaskOrder.
+        bool TakeTask(
+            size_t worker,
+            _Out_ Task& task);
+    };
+}
\ No newline at end of file
@@ -108,6 +108,11 @@ public:
     //  - replaces the existing encapsulated EVENT_RECORD info
     //    with the specified EVENT_RECORD.
     //
+    // assign() taking an EVENT_RECORD*
+    //  - replaces it in place, reusing the buffers of the prior record
+    //    so a record reused for every event stops allocating
+    //  - if it throws, the record is left uninitialized
+    //
     /////////////////////////////////////////////////////////////
     EtwRecord() NOEXCEPT;
     EtwRecord(_In_ PEVENT_RECORD);
@@ -115,6 +120,7 @@ public:
     EtwRecord(const EtwRecord&) NOEXCEPT;
     EtwRecord& operator=(const EtwRecord&) NOEXCEPT;
     EtwRecord& operator=(_In_ PEVENT_RECORD);
+    EtwRecord& assign(_In_ PEVENT_RECORD);
     /////////////////////////////////////////////////////////////
     //
     // Implementing swap() to be a friendly container
@@ -241,9 +247,15 @@ public:
 
 private:
     //
-    // private method to build a formatted string from the specified property offset
+    // private method to deep-copy the EVENT_RECORD, shared by the c'tor and assign()
+    //
+    void parse(_In_ PEVENT_RECORD);
+    //
+    // private methods to build a formatted string from the specified property offset
+    // - the second writes into the string given, keeping its capacity
     //
     std::wstring buildEventPropertyString(ULONG) const;
+    void buildEventPropertyString(ULONG, _Out_ std::wstring&) const;
     //
     // eventHeader and etwBufferContext are just shallow-copies
     //      of the the EVENT_HEADER and ETW_BUFFER_CONTEXT structs.
@@ -268,6 +280,11 @@ private:
     typedef struct std::pair<std::vector<WCHAR>, ULONG> ntlMappingPair;
     std::vector<ntlMappingPair> vtraceMapping;
     //
+    // scratch buffer for the EVENT_MAP_INFO of each property while parsing
+    // - not copied or swapped: only kept to avoid reallocating it
+    //
+    std::vector<BYTE> vpropertyMap;
+    //
     // need to allow a default empty c'tor, so must track initialization status
     //
     bool bInit;
@@ -306,31 +323,57 @@ EtwRecord::EtwRecord(_In_ PEVENT_RECORD in_pRecord)
   vtraceProperties(),
   bInit(false)
 {
-    if (in_pRecord->ExtendedDataCount > 0)
+    this->parse(in_pRecord);
+}
+    
+    
+////////////////////////////////////////////////////////////////////////////////
+//
+//  assign()
+//
+//  - replaces any prior event record, reusing the buffers it was copied into
+//  - offers only the basic guarantee: if it throws, this is left uninitialized
+//
+////////////////////////////////////////////////////////////////////////////////
+inline
+EtwRecord& EtwRecord::assign(_In_ PEVENT_RECORD in_pRecord)
+{
+    this->bInit = false;
+    this->eventHeader = in_pRecord->EventHeader;
+    this->etwBufferContext = in_pRecord->BufferContext;
+    this->parse(in_pRecord);
+    return *this;
+}
+    
+    
+////////////////////////////////////////////////////////////////////////////////
+//
+//  parse()
+//
+//  - deep-copies the extended data, the TRACE_EVENT_INFO and every property
+//    of the EVENT_RECORD into the member buffers
+//  - each buffer is first offered at the capacity it already has, so parsing
+//    events of the same kind one after another allocates only for the first
+//
+////////////////////////////////////////////////////////////////////////////////
+inline
+void EtwRecord::parse(_In_ PEVENT_RECORD in_pRecord)
+{
+    // Copying the EVENT_HEADER_EXTENDED_DATA_ITEM requires a deep-copy its data buffer
+    //    and to point the local struct at the locally allocated and copied buffer
+    //    since we won't have direct access to the original buffer later
+    v_eventHeaderExtendedData.resize(in_pRecord->ExtendedDataCount);
+    v_pEventHeaderData.resize(in_pRecord->ExtendedDataCount);
+        
+    for (unsigned uCount = 0; uCount < v_eventHeaderExtendedData.size(); ++uCount)
     {
-        // Copying the EVENT_HEADER_EXTENDED_DATA_ITEM requires a deep-copy its data buffer
-        //    and to point the local struct at the locally allocated and copied buffer
-        //    since we won't have direct access to the original buffer later
-        v_eventHeaderExtendedData.resize(in_pRecord->ExtendedDataCount);
-        v_pEventHeaderData.resize(in_pRecord->ExtendedDataCount);
+        PEVENT_HEADER_EXTENDED_DATA_ITEM ptempItem = in_pRecord->ExtendedData;
+        ptempItem += uCount;
             
-        for (unsigned uCount = 0; uCount < v_eventHeaderExtendedData.size(); ++uCount)
-        {
-            PEVENT_HEADER_EXTENDED_DATA_ITEM ptempItem = in_pRecord->ExtendedData;
-            ptempItem += uCount;
-                
-            std::vector<BYTE> ptempBytes = std::vector<BYTE>(ptempItem->DataSize);
-            memcpy_s(
-                ptempBytes.data(),
-                ptempItem->DataSize,
-                reinterpret_cast<BYTE*>(ptempItem->DataPtr),
-                ptempItem->DataSize
-               );
-                
-            v_pEventHeaderData[uCount] = std::move(ptempBytes);
-            v_eventHeaderExtendedData[uCount] = *ptempItem;
-            v_eventHeaderExtendedData[uCount].DataPtr = reinterpret_cast<ULONGLONG>(0ULL + v_pEventHeaderData[uCount].data());
-        }
+        const BYTE* ptempBytes = reinterpret_cast<BYTE*>(ptempItem->DataPtr);
+        v_pEventHeaderData[uCount].assign(ptempBytes, ptempBytes + ptempItem->DataSize);
+        v_eventHeaderExtendedData[uCount] = *ptempItem;
+        v_eventHeaderExtendedData[uCount].DataPtr = reinterpret_cast<ULONGLONG>(0ULL + v_pEventHeaderData[uCount].data());
     }
     
     if (eventHeader.Flags & EVENT_HEADER_FLAG_STRING_ONLY)
@@ -343,15 +386,19 @@ EtwRecord::EtwRecord(_In_ PEVENT_RECORD in_pRecord)
             in_pRecord->UserData,
             cbtraceEventInfo
            );
+        vtraceProperties.clear();
+        vtraceMapping.clear();
     }
     else
     {
-        cbtraceEventInfo = 0;
+        // offer the whole buffer kept from the previous event before asking for the size
+        ptraceEventInfo.resize(ptraceEventInfo.capacity());
+        cbtraceEventInfo = static_cast<ULONG>(ptraceEventInfo.size());
         ULONG ulret = ::TdhGetEventInformation(
             in_pRecord,
             0,
             NULL,
-            NULL,
+            ptraceEventInfo.empty() ? NULL : reinterpret_cast<PTRACE_EVENT_INFO>(ptraceEventInfo.data()),
             &cbtraceEventInfo
            );
         if (ERROR_INSUFFICIENT_BUFFER == ulret)
@@ -367,14 +414,21 @@ EtwRecord::EtwRecord(_In_ PEVENT_RECORD in_pRecord)
         }
         if (ulret != ERROR_SUCCESS)
         {
-            throw ntl::Exception(ulret, L"TdhGetEventInformation", L"EtwRecord::EtwRecord", false);
+            throw ntl::Exception(ulret, L"TdhGetEventInformation", L"EtwRecord::parse", false);
         }
+        // on success cbtraceEventInfo holds the bytes used
+        ptraceEventInfo.resize(cbtraceEventInfo);
         //
-        // retrieve all property data points - need to do this in the c'tor since the original EVENT_RECORD is required
+        // retrieve all property data points - need to do this now since the original EVENT_RECORD is required
         //
         BYTE* pByteInfo = this->ptraceEventInfo.data();
         TRACE_EVENT_INFO* pTraceInfo = reinterpret_cast<TRACE_EVENT_INFO*>(this->ptraceEventInfo.data());
         unsigned long total_properties = pTraceInfo->TopLevelPropertyCount;
+        //
+        // one slot per property, each keeping the capacity of its buffers
+        //
+        this->vtraceProperties.resize(total_properties);
+        this->vtraceMapping.resize(total_properties);
         if (total_properties > 0)
         {
             //
@@ -387,6 +441,14 @@ EtwRecord::EtwRecord(_In_ PEVENT_RECORD in_pRecord)
             //
             for (unsigned long property_count = 0; property_count < total_properties; ++property_count)
             {
+                PropertyPair& propertyPair = this->vtraceProperties[property_count];
+                ntlMappingPair& mappingPair = this->vtraceMapping[property_count];
+                // store null values unless filled in below
+                propertyPair.first.clear();
+                propertyPair.second = 0;
+                mappingPair.first.clear();
+                mappingPair.second = 0;
+
                 if (pTraceInfo->EventPropertyInfoArray[property_count].Flags & PropertyStruct)
                 {
                     //
@@ -401,8 +463,6 @@ EtwRecord::EtwRecord(_In_ PEVENT_RECORD in_pRecord)
 #ifdef NTL_TDHFORMAT_FATALCONDITION
                     ::DebugBreak();
 #endif
-                    this->vtraceMapping.push_back(std::make_pair(std::vector<WCHAR>(), 0));
-                    this->vtraceProperties.push_back(std::make_pair(std::vector<BYTE>(), 0));
                 }
                 else if (pTraceInfo->EventPropertyInfoArray[property_count].count > 1)
                 {
@@ -419,8 +479,6 @@ EtwRecord::EtwRecord(_In_ PEVENT_RECORD in_pRecord)
 #ifdef NTL_TDHFORMAT_FATALCONDITION
                     ::DebugBreak();
 #endif
-                    this->vtraceMapping.push_back(std::make_pair(std::vector<WCHAR>(), 0));
-                    this->vtraceProperties.push_back(std::make_pair(std::vector<BYTE>(), 0));
                 }
                 else
                 {
@@ -445,16 +503,15 @@ EtwRecord::EtwRecord(_In_ PEVENT_RECORD in_pRecord)
                        );
                     if (ulret != ERROR_SUCCESS)
                     {
-                        throw ntl::Exception(ulret, L"TdhGetPropertySize", L"EtwRecord::EtwRecord", false);
+                        throw ntl::Exception(ulret, L"TdhGetPropertySize", L"EtwRecord::parse", false);
                     }
                     //
-                    // now allocate the required buffer, and copy the data
+                    // now size the buffer, and copy the data
                     // - only if the buffer size > 0
                     //
-                    std::vector<BYTE> pPropertyData;
                     if (cbPropertyData > 0)
                     {
-                        pPropertyData.resize(cbPropertyData);
+                        propertyPair.first.resize(cbPropertyData);
                         ulret = ::TdhGetProperty(
                             in_pRecord,
                             0,    // not using WPP or 'classic' ETW
@@ -462,35 +519,36 @@ EtwRecord::EtwRecord(_In_ PEVENT_RECORD in_pRecord)
                             1,    // one property at a time - not support structs of data at this time
                             &dataDescriptor,
                             cbPropertyData,
-                            pPropertyData.data()
+                            propertyPair.first.data()
                            );
                         if (ulret != ERROR_SUCCESS)
                         {
-                            throw ntl::Exception(ulret, L"TdhGetProperty", L"EtwRecord::EtwRecord", false);
+                            propertyPair.first.clear();
+                            throw ntl::Exception(ulret, L"TdhGetProperty", L"EtwRecord::parse", false);
                         }
                     }
-                    this->vtraceProperties.push_back(std::make_pair(std::move(pPropertyData), cbPropertyData));
+                    propertyPair.second = cbPropertyData;
 
                     //
                     // additionally capture the mapped string for the property, if it exists
+                    // - offering the scratch buffer kept from the previous property first
                     //
-                    DWORD dwMapInfoSize = 0;
-                    std::vector<BYTE> pPropertyMap;
+                    vpropertyMap.resize(vpropertyMap.capacity());
+                    DWORD dwMapInfoSize = static_cast<DWORD>(vpropertyMap.size());
                     PWSTR szMapName = reinterpret_cast<PWSTR>(pByteInfo + pTraceInfo->EventPropertyInfoArray[property_count].nonStructType.MapNameOffset);
-                    // first query the size needed
                     ulret = ::TdhGetEventMapInformation(
                         in_pRecord, 
                         szMapName,
-                        NULL, 
+                        vpropertyMap.empty() ? NULL : reinterpret_cast<PEVENT_MAP_INFO>(vpropertyMap.data()), 
                         &dwMapInfoSize
                        );
                     if (ERROR_INSUFFICIENT_BUFFER == ulret)
                     {
-                        pPropertyMap.resize(dwMapInfoSize);
+                        vpropertyMap.resize(dwMapInfoSize);
                         ulret = ::TdhGetEventMapInformation(
                             in_pRecord, 
                             szMapName, 
-                            reinterpret_cast<PEVENT_MAP_INFO>(pPropertyMap.data()), 
+                            reinterpret_cast<PEVENT_MAP_INFO>(vpropertyMap.data()), 
                             &dwMapInfoSize
                            );
                     }
@@ -501,7 +559,7 @@ EtwRecord::EtwRecord(_In_ PEVENT_RECORD in_pRecord)
                         break;
                     case ERROR_NOT_FOUND:
                         // this is OK to keep this event - there just wasn't a mapping for a formatted string
-                        pPropertyMap.clear();
+                        vpropertyMap.clear();
                         break;
                     default:
                         // any other error is an unexpected failure
@@ -511,13 +569,13 @@ EtwRecord::EtwRecord(_In_ PEVENT_RECORD in_pRecord)
                                 L"TdhGetEventMapInformation failed with error %u, EVENT_RECORD %p, TRACE_EVENT_INFO %p",
                                 ulret, in_pRecord, pTraceInfo).c_str());
 #endif
-                        pPropertyMap.clear();
+                        vpropertyMap.clear();
                     }
                     //
                     // if we successfully retreived the property info
                     // format the mapped property value
                     //
-                    if (pPropertyMap.data() != nullptr)
+                    if (!vpropertyMap.empty())
                     {
                         USHORT property_length = pTraceInfo->EventPropertyInfoArray[property_count].length;
                         // per MSDN, must manually set the length for TDH_OUTTYPE_IPV6
@@ -527,12 +585,13 @@ EtwRecord::EtwRecord(_In_ PEVENT_RECORD in_pRecord)
                             property_length = static_cast<USHORT>(sizeof IN6_ADDR);
                         }
                         ULONG pointer_size = (in_pRecord->EventHeader.Flags & EVENT_HEADER_FLAG_32_BIT_HEADER) ? 4 : 8;
-                        ULONG formattedPropertySize = 0;
                         USHORT UserDataConsumed = 0;
-                        std::vector<WCHAR> formatted_value;
+                        std::vector<WCHAR>& formatted_value = mappingPair.first;
+                        formatted_value.resize(formatted_value.capacity());
+                        ULONG formattedPropertySize = static_cast<ULONG>(formatted_value.size() * sizeof(WCHAR));
                         ulret = ::TdhFormatProperty(
                             pTraceInfo,
-                            reinterpret_cast<PEVENT_MAP_INFO>(pPropertyMap.data()), 
+                            reinterpret_cast<PEVENT_MAP_INFO>(vpropertyMap.data()), 
                             pointer_size,
                             pTraceInfo->EventPropertyInfoArray[property_count].nonStructType.InType,
                             pTraceInfo->EventPropertyInfoArray[property_count].nonStructType.OutType,
@@ -540,14 +599,14 @@ EtwRecord::EtwRecord(_In_ PEVENT_RECORD in_pRecord)
                             UserDataLength,
                             UserData,
                             &formattedPropertySize,
-                            NULL,
+                            formatted_value.empty() ? NULL : formatted_value.data(),
                             &UserDataConsumed
                            );
                         if (ERROR_INSUFFICIENT_BUFFER == ulret) {
                             formatted_value.resize(formattedPropertySize / sizeof(WCHAR));
                             ulret = ::TdhFormatProperty(
                                 pTraceInfo,
-                                reinterpret_cast<PEVENT_MAP_INFO>(pPropertyMap.data()), 
+                                reinterpret_cast<PEVENT_MAP_INFO>(vpropertyMap.data()), 
                                 pointer_size,
                                 pTraceInfo->EventPropertyInfoArray[property_count].nonStructType.InType,
                                 pTraceInfo->EventPropertyInfoArray[property_count].nonStructType.OutType,
@@ -567,23 +626,19 @@ EtwRecord::EtwRecord(_In_ PEVENT_RECORD in_pRecord)
                                     L"TdhFormatProperty failed with error %u, EVENT_RECORD %p, TRACE_EVENT_INFO %p",
                                     ulret, in_pRecord, pTraceInfo).c_str());
 #endif
-                            this->vtraceMapping.push_back(std::make_pair(std::vector<WCHAR>(), 0));
+                            formatted_value.clear();
                         }
                         else
                         {
                             UserDataLength -= UserDataConsumed;
                             UserData += UserDataConsumed;
                             //
-                            // now add the vaue/size pair to the member std::vector storing all properties
+                            // now keep the value/size pair in the member std::vector storing all properties
                             //
-                            this->vtraceMapping.push_back(std::make_pair(std::move(formatted_value), formattedPropertySize));
+                            formatted_value.resize(formattedPropertySize / sizeof(WCHAR));
+                            mappingPair.second = formattedPropertySize;
                         }
                     }
-                    else
-                    {
-                        // store null values
-                        this->vtraceMapping.push_back(std::make_pair(std::vector<WCHAR>(), 0));
-                    }
                 }
             }
         }
@@ -1082,7 +1137,7 @@ void EtwRecord::writeFormattedMessage(std::wstring& wsData, bool withDetails) co
             wsProperties.append(L"] ");
 
             // use the mapped string if it's available
-            if (this->vtraceMapping[ulCount].first.data() != NULL) 
+            if (!this->vtraceMapping[ulCount].first.empty())
             {
                 wsProperties.append(this->vtraceMapping[ulCount].first.data());
                 wsPropertyVector.push_back(this->vtraceMapping[ulCount].first.data());
@@ -1803,7 +1858,7 @@ bool EtwRecord::queryEventProperty(_In_z_ const wchar_t* szPropertyName, _Out_ s
         const wchar_t* szPropertyFound = reinterpret_cast<const wchar_t*>(pByteInfo + pTraceInfo->EventPropertyInfoArray[ulCount].NameOffset);
         if (0 == _wcsicmp(szPropertyName, szPropertyFound))
         {
-            out_wsPropertyValue.assign( this->buildEventPropertyString(ulCount));
+            this->buildEventPropertyString(ulCount, out_wsPropertyValue);
             return true;
         }
     }
@@ -1830,7 +1885,7 @@ bool  EtwRecord::queryEventProperty(const unsigned long ulIndex, _Out_ std::wstr
     bool bFoundMatch = (NULL != reinterpret_cast<const wchar_t*>(pByteInfo + pTraceInfo->EventPropertyInfoArray[ulIndex-1].NameOffset));      
     if (bFoundMatch) 
     {
-        out_wsPropertyValue.assign( this->buildEventPropertyString(ulIndex-1));
+        this->buildEventPropertyString(ulIndex-1, out_wsPropertyValue);
     }
     else
     {
@@ -1879,6 +1934,13 @@ bool  EtwRecord::queryEventProperty(_In_z_ const wchar_t* szPropertyName, _Out_
 }
 inline
 std::wstring EtwRecord::buildEventPropertyString(ULONG ulProperty) const
+{
+    std::wstring wsData;
+    this->buildEventPropertyString(ulProperty, wsData);
+    return wsData;
+}
+inline
+void EtwRecord::buildEventPropertyString(ULONG ulProperty, _Out_ std::wstring& wsData) const
 {
     //
     // immediately fail if no top level property count value or the value asked for is out of range
@@ -1891,7 +1953,7 @@ std::wstring EtwRecord::buildEventPropertyString(ULONG ulProperty) const
     static const unsigned cch_StackBuffer = 100;
     wchar_t arStackBuffer[cch_StackBuffer] = {0};
 
-    std::wstring wsData;
+    wsData.clear();
     // BYTE* pByteInfo = this->ptraceEventInfo.get();
     const TRACE_EVENT_INFO* pTraceInfo = reinterpret_cast<const TRACE_EVENT_INFO*>(this->ptraceEventInfo.data());
     // retrive the raw property information
@@ -2437,7 +2499,6 @@ std::wstring EtwRecord::buildEventPropertyString(ULONG ulProperty) const
             }
         } // switch statement
     }
-    return wsData;
 }
 
 } // namespace ntl
\ No newline at end of file
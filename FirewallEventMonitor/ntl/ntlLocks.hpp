@@ -8,6 +8,8 @@
 // ntl headers
 #include "ntlVersionConversion.hpp"
 #include "ntlException.hpp"
+// c++ headers
+#include <atomic>
 
 namespace ntl {
 
@@ -143,6 +145,120 @@ namespace ntl {
         PrioritizedCriticalSection& prioritized_cs;
     };
 
+    ///
+    /// Lock for state that one thread at a time updates on a hot path and other threads
+    /// only visit now and then
+    /// - the hot side (hot_lock / hot_release) is two plain stores and a load: no interlocked
+    ///   instruction, so a per-event update costs nothing when nobody else is waiting
+    /// - the cold side (cold_lock / cold_release) pays for that: FlushProcessWriteBuffers
+    ///   interrupts every processor so the hot side's store is seen, then it waits for the
+    ///   hot side to step out
+    /// - hot-side callers must already be serialized with one another; cold-side callers
+    ///   are serialized by the lock
+    ///
+    class AsymmetricLock {
+    public:
+        AsymmetricLock() NOEXCEPT :
+            hot_active(false),
+            cold_waiting(false)
+        {
+            ::InitializeSRWLock(&cold_srwlock);
+        }
+
+        void hot_lock() NOEXCEPT
+        {
+            for (;;) {
+                hot_active.store(true, std::memory_order_relaxed);
+                // Only the compiler must keep the store before the load:
+                // cold_lock's FlushProcessWriteBuffers orders them on the processor
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+                if (!cold_waiting.load(std::memory_order_acquire)) {
+                    return;
+                }
+                // step out and block until the cold side is done
+                hot_active.store(false, std::memory_order_release);
+                ::AcquireSRWLockShared(&cold_srwlock);
+                ::ReleaseSRWLockShared(&cold_srwlock);
+            }
+        }
+        void hot_release() NOEXCEPT
+        {
+            hot_active.store(false, std::memory_order_release);
+        }
+
+        _Acquires_exclusive_lock_(this->cold_srwlock)
+        void cold_lock() NOEXCEPT
+        {
+            ::AcquireSRWLockExclusive(&cold_srwlock);
+            cold_waiting.store(true, std::memory_order_relaxed);
+            // Either the hot side's hot_active store is now visible here,
+            // or its next load of cold_waiting sees true
+            ::FlushProcessWriteBuffers();
+            while (hot_active.load(std::memory_order_acquire)) {
+                YieldProcessor();
+            }
+        }
+        _Releases_exclusive_lock_(this->cold_srwlock)
+        void cold_release() NOEXCEPT
+        {
+            cold_waiting.store(false, std::memory_order_release);
+            ::ReleaseSRWLockExclusive(&cold_srwlock);
+        }
+
+        /// not copyable
+        AsymmetricLock(const AsymmetricLock&) = delete;
+        AsymmetricLock& operator=(const AsymmetricLock&) = delete;
+
+    private:
+        std::atomic<bool> hot_active;
+        std::atomic<bool> cold_waiting;
+        SRWLOCK cold_srwlock;
+    };
+    class AutoReleaseHotLock {
+    public:
+        explicit AutoReleaseHotLock(AsymmetricLock& _lock) NOEXCEPT :
+            lock(_lock)
+        {
+            lock.hot_lock();
+        }
+
+        ~AutoReleaseHotLock() NOEXCEPT
+        {
+            lock.hot_release();
+        }
+
+        /// no default c'tor
+        AutoReleaseHotLock() = delete;
+        /// non-copyable
+        AutoReleaseHotLock(const AutoReleaseHotLock&) = delete;
+        AutoReleaseHotLock operator=(const AutoReleaseHotLock&) = delete;
+
+    private:
+        AsymmetricLock& lock;
+    };
+    class AutoReleaseColdLock {
+    public:
+        explicit AutoReleaseColdLock(AsymmetricLock& _lock) NOEXCEPT :
+            lock(_lock)
+        {
+            lock.cold_lock();
+        }
+
+        ~AutoReleaseColdLock() NOEXCEPT
+        {
+            lock.cold_release();
+        }
+
+        /// no default c'tor
+        AutoReleaseColdLock() = delete;
+        /// non-copyable
+        AutoReleaseColdLock(const AutoReleaseColdLock&) = delete;
+        AutoReleaseColdLock operator=(const AutoReleaseColdLock&) = delete;
+
+    private:
+        AsymmetricLock& lock;
+    };
+
     //////////////////////////////////////////////////////////////////////////////////////////
     ///
     /// Can concurrent-safely read from both const and non-const
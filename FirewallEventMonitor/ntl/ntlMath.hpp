@@ -1,6 +1,9 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License. See License.txt in the project root for license information.
 
+#pragma once
+
+#include <algorithm>
 #include <tuple>
 #include <vector>
 #include <numeric>
@@ -146,4 +149,351 @@ namespace ntl {
             median,
             higher_quartile);
     }
+
+    ///
+    /// RunningStatistics
+    ///
+    /// Streaming counterpart of SampledStandardDeviation: the mean and sampled variance of
+    /// an unbounded sequence in constant memory, using Welford's update. Two instances
+    /// combine exactly with Chan et al.'s parallel formula, so per-thread or per-interval
+    /// statistics can be merged.
+    ///
+    class RunningStatistics {
+    public:
+        void add(double _value) NOEXCEPT
+        {
+            ++sample_count;
+            double delta = _value - running_mean;
+            running_mean += delta / static_cast<double>(sample_count);
+            squared_distance += delta * (_value - running_mean);
+            if (sample_count == 1) {
+                minimum_value = _value;
+                maximum_value = _value;
+            } else {
+                minimum_value = (std::min)(minimum_value, _value);
+                maximum_value = (std::max)(maximum_value, _value);
+            }
+        }
+
+        void merge(const RunningStatistics& _other) NOEXCEPT
+        {
+            if (_other.sample_count == 0) {
+                return;
+            }
+            if (sample_count == 0) {
+                *this = _other;
+                return;
+            }
+
+            double total = static_cast<double>(sample_count + _other.sample_count);
+            double delta = _other.running_mean - running_mean;
+            squared_distance += _other.squared_distance +
+                delta * delta * (static_cast<double>(sample_count) * static_cast<double>(_other.sample_count) / total);
+            running_mean += delta * (static_cast<double>(_other.sample_count) / total);
+            sample_count += _other.sample_count;
+            minimum_value = (std::min)(minimum_value, _other.minimum_value);
+            maximum_value = (std::max)(maximum_value, _other.maximum_value);
+        }
+
+        void reset() NOEXCEPT
+        {
+            *this = RunningStatistics();
+        }
+
+        unsigned long long count() const NOEXCEPT
+        {
+            return sample_count;
+        }
+
+        double mean() const NOEXCEPT
+        {
+            return running_mean;
+        }
+
+        /// sampled (n - 1) variance, as SampledStandardDeviation uses; 0 with fewer than 2 samples
+        double variance() const NOEXCEPT
+        {
+            return sample_count < 2 ? 0.0 : squared_distance / static_cast<double>(sample_count - 1);
+        }
+
+        double standard_deviation() const NOEXCEPT
+        {
+            return std::sqrt(variance());
+        }
+
+        double minimum() const NOEXCEPT
+        {
+            return minimum_value;
+        }
+
+        double maximum() const NOEXCEPT
+        {
+            return maximum_value;
+        }
+
+        ///
+        /// Returns the same tuple as SampledStandardDeviation:
+        ///   get<0> : the mean minus one standard deviation
+        ///   get<1> : the mean value
+        ///   get<2> : the mean plus one standard deviation
+        ///
+        std::tuple<double, double, double> mean_and_deviation() const NOEXCEPT
+        {
+            if (sample_count < 2) {
+                return std::make_tuple(0.0, 0.0, 0.0);
+            }
+            double stdev = standard_deviation();
+            return std::make_tuple(
+                running_mean - stdev,
+                running_mean,
+                running_mean + stdev);
+        }
+
+    private:
+        unsigned long long sample_count = 0;
+        double running_mean = 0.0;
+        // sum of squared distances from the mean
+        double squared_distance = 0.0;
+        double minimum_value = 0.0;
+        double maximum_value = 0.0;
+    };
+
+    ///
+    /// QuantileSketch
+    ///
+    /// Streaming counterpart of InterquartileRange: approximate quantiles of an unbounded,
+    /// unsorted sequence in constant memory, using the KLL sketch (Karnin, Lang, Liberty).
+    ///
+    /// Values are kept in a stack of compactors; an item at level h stands for 2^h values.
+    /// When a compactor fills it is sorted and every other item, starting at random, moves up a
+    /// level. Capacities shrink by 2/3 per level below the top, so about 3 * k values are kept
+    /// however many are added. The rank error is about 1.7 / k (under 1% at the default k).
+    /// Sketches built with the same k merge into a sketch of the combined sequence.
+    ///
+    class QuantileSketch {
+    public:
+        explicit QuantileSketch(unsigned long _k = default_k, unsigned long long _seed = 0x9E3779B97F4A7C15ull) :
+            k(_k),
+            random_state(_seed == 0 ? 1 : _seed)
+        {
+            if (_k < minimum_k) {
+                throw ntl::Exception(ERROR_INVALID_PARAMETER, L"QuantileSketch k must be at least 8", L"QuantileSketch::QuantileSketch", false);
+            }
+            grow();
+        }
+
+        void add(double _value)
+        {
+            if (value_count == 0) {
+                minimum_value = _value;
+                maximum_value = _value;
+            } else {
+                minimum_value = (std::min)(minimum_value, _value);
+                maximum_value = (std::max)(maximum_value, _value);
+            }
+            compactors[0].push_back(_value);
+            ++value_count;
+            ++retained_count;
+            if (retained_count >= maximum_retained) {
+                compress();
+            }
+        }
+
+        void merge(const QuantileSketch& _other)
+        {
+            if (_other.k != k) {
+                throw ntl::Exception(ERROR_INVALID_PARAMETER, L"QuantileSketch merge requires the same k", L"QuantileSketch::merge", false);
+            }
+            if (_other.value_count == 0) {
+                return;
+            }
+            if (value_count == 0) {
+                minimum_value = _other.minimum_value;
+                maximum_value = _other.maximum_value;
+            } else {
+                minimum_value = (std::min)(minimum_value, _other.minimum_value);
+                maximum_value = (std::max)(maximum_value, _other.maximum_value);
+            }
+            while (compactors.size() < _other.compactors.size()) {
+                grow();
+            }
+            for (size_t level = 0; level < _other.compactors.size(); ++level) {
+                compactors[level].insert(compactors[level].end(), _other.compactors[level].begin(), _other.compactors[level].end());
+            }
+            value_count += _other.value_count;
+            retained_count += _other.retained_count;
+            while (retained_count >= maximum_retained) {
+                compress();
+            }
+        }
+
+        void reset()
+        {
+            for (auto& compactor : compactors) {
+                compactor.clear();
+            }
+            value_count = 0;
+            retained_count = 0;
+            minimum_value = 0.0;
+            maximum_value = 0.0;
+        }
+
+        unsigned long long count() const NOEXCEPT
+        {
+            return value_count;
+        }
+
+        /// the number of values held, which stays around 3 * k
+        size_t retained() const NOEXCEPT
+        {
+            return retained_count;
+        }
+
+        /// the smallest and largest values are tracked exactly
+        double minimum() const NOEXCEPT
+        {
+            return minimum_value;
+        }
+
+        double maximum() const NOEXCEPT
+        {
+            return maximum_value;
+        }
+
+        ///
+        /// Returns the smallest value whose rank is at least _rank * count(), for _rank in [0, 1]:
+        /// ranks 0 and 1 give the exact minimum and maximum. Returns 0 if no values were added.
+        ///
+        double quantile(double _rank) const
+        {
+            double result = 0.0;
+            quantiles(&_rank, &_rank + 1, &result);
+            return result;
+        }
+
+        ///
+        /// Returns the same tuple as InterquartileRange:
+        ///   get<0> : quartile 1 (at the 25% mark)
+        ///   get<1> : quartile 2 (the median - at the 50% mark)
+        ///   get<2> : quartile 3 (at the 75% mark)
+        ///
+        std::tuple<double, double, double> quartiles() const
+        {
+            const double ranks[] = { 0.25, 0.5, 0.75 };
+            double results[3] = {};
+            quantiles(ranks, ranks + 3, results);
+            return std::make_tuple(results[0], results[1], results[2]);
+        }
+
+        ///
+        /// Computes the quantile for each rank in [_rank_begin, _rank_end) with a single sort,
+        /// writing them to _results. Ranks must be in increasing order.
+        ///
+        void quantiles(const double* _rank_begin, const double* _rank_end, _Out_writes_(_rank_end - _rank_begin) double* _results) const
+        {
+            if (value_count == 0) {
+                std::fill(_results, _results + (_rank_end - _rank_begin), 0.0);
+                return;
+            }
+
+            std::vector<std::pair<double, unsigned long long>> weighted;
+            weighted.reserve(retained_count);
+            for (size_t level = 0; level < compactors.size(); ++level) {
+                for (const auto& value : compactors[level]) {
+                    weighted.emplace_back(value, 1ull << level);
+                }
+            }
+            std::sort(weighted.begin(), weighted.end());
+
+            // compaction keeps the total weight equal to the count
+            unsigned long long cumulative_weight = 0;
+            auto item = weighted.begin();
+            for (auto rank = _rank_begin; rank != _rank_end; ++rank, ++_results) {
+                if (*rank <= 0.0) {
+                    *_results = minimum_value;
+                    continue;
+                }
+                if (*rank >= 1.0) {
+                    *_results = maximum_value;
+                    continue;
+                }
+                double target = *rank * static_cast<double>(value_count);
+                while (item + 1 != weighted.end() &&
+                       static_cast<double>(cumulative_weight + item->second) < target) {
+                    cumulative_weight += item->second;
+                    ++item;
+                }
+                *_results = item->first;
+            }
+        }
+
+        static const unsigned long default_k = 200;
+        static const unsigned long minimum_k = 8;
+
+    private:
+        // capacity shrinks by 2/3 for each level below the top
+        size_t capacity(size_t _level) const NOEXCEPT
+        {
+            size_t depth = compactors.size() - _level - 1;
+            double scaled = static_cast<double>(k) * std::pow(2.0 / 3.0, static_cast<double>(depth));
+            return (std::max)(static_cast<size_t>(std::ceil(scaled)), static_cast<size_t>(2));
+        }
+
+        void grow()
+        {
+            compactors.emplace_back();
+            maximum_retained = 0;
+            for (size_t level = 0; level < compactors.size(); ++level) {
+                maximum_retained += capacity(level);
+            }
+            for (size_t level = 0; level < compactors.size(); ++level) {
+                compactors[level].reserve(capacity(level) + 1);
+            }
+        }
+
+        // compacts the lowest full compactor into the level above
+        void compress()
+        {
+            for (size_t level = 0; level < compactors.size(); ++level) {
+                if (compactors[level].size() < capacity(level)) {
+                    continue;
+                }
+                if (level + 1 == compactors.size()) {
+                    grow();
+                }
+
+                auto& compactor = compactors[level];
+                auto& above = compactors[level + 1];
+                std::sort(compactor.begin(), compactor.end());
+
+                // an odd item out stays behind, so the pairs are taken from the top
+                size_t odd = compactor.size() % 2;
+                size_t offset = next_coin_flip() ? 1 : 0;
+                for (size_t index = odd + offset; index < compactor.size(); index += 2) {
+                    above.push_back(compactor[index]);
+                }
+                retained_count -= (compactor.size() - odd) / 2;
+                compactor.resize(odd);
+                return;
+            }
+        }
+
+        // xorshift64: compaction only needs a fair, cheap coin
+        bool next_coin_flip() NOEXCEPT
+        {
+            random_state ^= random_state << 13;
+            random_state ^= random_state >> 7;
+            random_state ^= random_state << 17;
+            return (random_state & 1) != 0;
+        }
+
+        std::vector<std::vector<double>> compactors;
+        unsigned long k;
+        unsigned long long random_state;
+        unsigned long long value_count = 0;
+        size_t retained_count = 0;
+        size_t maximum_retained = 0;
+        double minimum_value = 0.0;
+        double maximum_value = 0.0;
+    };
 }
\ No newline at end of file
@@ -10,6 +10,9 @@
 #include <string>
 #include <algorithm>
 #include <utility>
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 // os headers
 #include <windows.h>
 // ntl headers
@@ -97,38 +100,99 @@ namespace ntl {
         }
 
 
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// append_utf8
+        ///
+        /// Appends the UTF-8 encoding of UTF-16 text to a std::string in a single pass
+        /// - grows the string once for the worst case (3 bytes per code unit), then trims
+        /// - runs of ASCII are narrowed 8 code units at a time with SSE2 where available
+        /// - unpaired surrogates are written as U+FFFD, matching WideCharToMultiByte
+        ///
+        /// Reusing the same std::string across calls avoids allocating once its capacity settles
+        ///
+        /// Can throw std::bad_alloc() under low-resource conditions
+        ///
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        inline
+        void append_utf8(_In_reads_(_len) const wchar_t* _wsz, size_t _len, std::string& _out)
+        {
+            const size_t start = _out.size();
+            _out.resize(start + _len * 3);
+            char* out = &_out[0] + start;
+
+            const wchar_t* in = _wsz;
+            const wchar_t* end = _wsz + _len;
+            while (in < end) {
+#if defined(_M_IX86) || defined(_M_X64)
+                static_assert(sizeof(wchar_t) == 2, "the SSE2 path narrows 16-bit code units");
+                const __m128i non_ascii_bits = _mm_set1_epi16(static_cast<short>(0xFF80));
+                const __m128i zero = _mm_setzero_si128();
+                while (end - in >= 8) {
+                    const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+                    if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(units, non_ascii_bits), zero)) != 0xFFFF) {
+                        break;
+                    }
+                    // all 8 code units are < 0x80: pack them down to 8 bytes
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(units, units));
+                    in += 8;
+                    out += 8;
+                }
+                if (in == end) {
+                    break;
+                }
+#endif
+                unsigned int ch = *in++;
+                if (ch < 0x80) {
+                    *out++ = static_cast<char>(ch);
+                } else if (ch < 0x800) {
+                    *out++ = static_cast<char>(0xC0 | (ch >> 6));
+                    *out++ = static_cast<char>(0x80 | (ch & 0x3F));
+                } else if (ch >= 0xD800 && ch <= 0xDBFF && in < end && *in >= 0xDC00 && *in <= 0xDFFF) {
+                    // surrogate pair: 2 code units become 4 bytes
+                    const unsigned int code_point = 0x10000 + ((ch - 0xD800) << 10) + (*in++ - 0xDC00);
+                    *out++ = static_cast<char>(0xF0 | (code_point >> 18));
+                    *out++ = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+                } else {
+                    if (ch >= 0xD800 && ch <= 0xDFFF) {
+                        ch = 0xFFFD;
+                    }
+                    *out++ = static_cast<char>(0xE0 | (ch >> 12));
+                    *out++ = static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | (ch & 0x3F));
+                }
+            }
+
+            _out.resize(out - _out.data());
+        }
+        inline
+        void append_utf8(const std::wstring& _wstr, std::string& _out)
+        {
+            append_utf8(_wstr.c_str(), _wstr.size(), _out);
+        }
+
+
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         ///
         /// convert_to_string
         /// convert_to_wstring
         ///
-        /// Converts between std::string and std::wstring using win32 conversion functions
+        /// Converts between std::string and std::wstring
         ///
         /// These use UTF8 for all conversion operations
+        /// - convert_to_string is built on append_utf8; convert_to_wstring uses MultiByteToWideChar
         ///
-        /// Can throw ntl::Exception on failures from the underlying conversion calls
+        /// convert_to_wstring can throw ntl::Exception on failures from the underlying conversion call
         /// Can throw std::bad_alloc
         ///
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         inline
         std::string convert_to_string(const std::wstring& _wstr)
         {
-            if (_wstr.length() == 0) {
-                return std::string();
-            }
-
-            int len = ::WideCharToMultiByte(CP_UTF8, 0, _wstr.c_str(), -1, nullptr, 0, nullptr, nullptr);
-            if (len == 0) {
-                throw ntl::Exception(::GetLastError(), L"::WideCharToMultiByte", L"ntl::String::convert_to_string", false);
-            }
-
-            std::string buf(len, '\0');
-            len = ::WideCharToMultiByte(CP_UTF8, 0, _wstr.c_str(), -1, &buf[0], len, nullptr, nullptr);
-            if (len == 0) {
-                throw ntl::Exception(::GetLastError(), L"::WideCharToMultiByte", L"ntl::String::convert_to_string", false);
-            }
-
-            buf.resize(len - 1); // We needed room for it earlier, but the \0 isn't considered a part of the std::string
+            std::string buf;
+            append_utf8(_wstr, buf);
             return buf;
         }
         inline
@@ -0,0 +1,327 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License. See License.txt in the project root for license information.
+
+#pragma once
+
+// os headers
+#include <windows.h>
+#include <intrin.h>
+// c++ headers
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+// ntl headers
+#include "ntlVersionConversion.hpp"
+
+///
+/// NTL_TRACE_SCOPE(name) times the enclosing scope into the calling thread's trace buffer
+/// - compiled in only when NTL_TRACE_SCOPES is defined for the whole build; otherwise it expands to nothing
+/// - even when compiled in, nothing is recorded until ntl::Trace::start() is called
+/// - name must be a string literal: only the pointer is kept, and it is written to JSON unescaped
+///
+#define NTL_TRACE_CONCATENATE_INNER(_left, _right) _left##_right
+#define NTL_TRACE_CONCATENATE(_left, _right) NTL_TRACE_CONCATENATE_INNER(_left, _right)
+#if defined(NTL_TRACE_SCOPES)
+#define NTL_TRACE_SCOPE(_name) ::ntl::Trace::ScopedTimer NTL_TRACE_CONCATENATE(ntl_trace_scope_, __LINE__)(_name)
+#else
+#define NTL_TRACE_SCOPE(_name) ((void)0)
+#endif
+
+namespace ntl {
+
+    ///
+    /// Trace namespace records timed scopes into per-thread ring buffers and writes them
+    /// in the Chrome trace-event JSON format (chrome://tracing, Perfetto, Edge devtools)
+    ///
+    /// The hot path is two __rdtsc reads, a thread_local read and a 24-byte store: no lock, no
+    /// allocation after a thread's first scope, no shared cache line written. Time stamps are
+    /// converted from TSC ticks to microseconds only when the trace is written, by calibrating
+    /// the TSC against QueryPerformanceCounter over the whole recording.
+    ///
+    namespace Trace {
+
+        ///
+        /// One timed scope, in TSC ticks
+        ///
+        struct Record {
+            const char* name;
+            unsigned long long start;
+            unsigned long long end;
+        };
+
+        ///
+        /// The records of one thread: written only by that thread, read only when the thread is quiet
+        /// - a ring: once full the oldest records are overwritten, and counted as dropped when written out
+        ///
+        class ThreadBuffer {
+        public:
+            ThreadBuffer(DWORD _thread_id, size_t _capacity) :
+                records(_capacity),
+                mask(_capacity - 1),
+                written(0),
+                thread_id(_thread_id)
+            {
+            }
+
+            void add(_In_ const char* _name, unsigned long long _start, unsigned long long _end) NOEXCEPT
+            {
+                const unsigned long long index = written.load(std::memory_order_relaxed);
+                Record& record = records[static_cast<size_t>(index) & mask];
+                record.name = _name;
+                record.start = _start;
+                record.end = _end;
+                written.store(index + 1, std::memory_order_release);
+            }
+
+            void reset() NOEXCEPT
+            {
+                written.store(0, std::memory_order_relaxed);
+            }
+
+            /// invokes _functor on each record still held, oldest first; returns the number overwritten
+            template <typename T>
+            unsigned long long for_each(T _functor) const
+            {
+                const unsigned long long count = written.load(std::memory_order_acquire);
+                const unsigned long long first = (count > records.size()) ? count - records.size() : 0;
+                for (unsigned long long index = first; index < count; ++index) {
+                    _functor(records[static_cast<size_t>(index) & mask]);
+                }
+                return first;
+            }
+
+            DWORD get_thread_id() const NOEXCEPT
+            {
+                return thread_id;
+            }
+
+            /// non-copyable
+            ThreadBuffer(const ThreadBuffer&) = delete;
+            ThreadBuffer& operator=(const ThreadBuffer&) = delete;
+
+        private:
+            std::vector<Record> records;
+            const size_t mask;
+            std::atomic<unsigned long long> written;
+            const DWORD thread_id;
+        };
+
+        ///
+        /// Process-wide trace state
+        /// - owns every thread's buffer, so records outlive the threads that wrote them
+        ///
+        struct State {
+            State() NOEXCEPT :
+                dropped(0),
+                capacity(65536),
+                start_tsc(0),
+                start_qpc(0)
+            {
+                ::InitializeSRWLock(&lock);
+            }
+
+            /// scopes lost because their thread's buffer could not be allocated
+            std::atomic<unsigned long long> dropped;
+            SRWLOCK lock;
+            std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+            size_t capacity;
+            unsigned long long start_tsc;
+            long long start_qpc;
+        };
+
+        inline
+        State& get_state() NOEXCEPT
+        {
+            static State state;
+            return state;
+        }
+
+        ///
+        /// Kept out of State: constant-initialized, so checking it costs no guard for the static's construction
+        ///
+        inline
+        std::atomic<bool>& get_enabled() NOEXCEPT
+        {
+            static std::atomic<bool> enabled(false);
+            return enabled;
+        }
+
+        inline
+        bool is_enabled() NOEXCEPT
+        {
+            return get_enabled().load(std::memory_order_relaxed);
+        }
+
+        ///
+        /// The calling thread's buffer, created and registered on the thread's first scope
+        /// - returns nullptr if it could not be allocated
+        ///
+        inline
+        ThreadBuffer* get_thread_buffer() NOEXCEPT
+        {
+            static thread_local ThreadBuffer* thread_buffer = nullptr;
+            if (thread_buffer != nullptr) {
+                return thread_buffer;
+            }
+
+            State& state = get_state();
+            ::AcquireSRWLockExclusive(&state.lock);
+            try {
+                std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer(::GetCurrentThreadId(), state.capacity));
+                state.buffers.push_back(std::move(buffer));
+                thread_buffer = state.buffers.back().get();
+            }
+            catch (const std::bad_alloc&) {
+                thread_buffer = nullptr;
+            }
+            ::ReleaseSRWLockExclusive(&state.lock);
+            return thread_buffer;
+        }
+
+        ///
+        /// Records the time from construction to destruction, if tracing was enabled at construction
+        ///
+        class ScopedTimer {
+        public:
+            explicit ScopedTimer(_In_ const char* _name) NOEXCEPT :
+                name(_name),
+                start(is_enabled() ? __rdtsc() : 0)
+            {
+            }
+
+            ~ScopedTimer() NOEXCEPT
+            {
+                if (start != 0) {
+                    const unsigned long long end = __rdtsc();
+                    ThreadBuffer* buffer = get_thread_buffer();
+                    if (buffer != nullptr) {
+                        buffer->add(name, start, end);
+                    } else {
+                        get_state().dropped.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            /// no default c'tor
+            ScopedTimer() = delete;
+            /// non-copyable
+            ScopedTimer(const ScopedTimer&) = delete;
+            ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+        private:
+            const char* name;
+            const unsigned long long start;
+        };
+
+        ///
+        /// Starts recording, discarding anything recorded before
+        /// - _records_per_thread is rounded up to a power of two; it applies to threads that have not traced yet
+        /// - call before the instrumented threads start, or while they are quiet
+        ///
+        inline
+        void start(size_t _records_per_thread = 65536) NOEXCEPT
+        {
+            size_t capacity = 1;
+            while (capacity < _records_per_thread && capacity < (static_cast<size_t>(1) << 30)) {
+                capacity <<= 1;
+            }
+
+            State& state = get_state();
+            ::AcquireSRWLockExclusive(&state.lock);
+            state.capacity = capacity;
+            for (auto& buffer : state.buffers) {
+                buffer->reset();
+            }
+            state.dropped.store(0, std::memory_order_relaxed);
+
+            LARGE_INTEGER qpc;
+            ::QueryPerformanceCounter(&qpc);
+            state.start_qpc = qpc.QuadPart;
+            state.start_tsc = __rdtsc();
+            ::ReleaseSRWLockExclusive(&state.lock);
+
+            get_enabled().store(true, std::memory_order_relaxed);
+        }
+
+        ///
+        /// Stops recording new scopes; scopes already open still complete
+        ///
+        inline
+        void stop() NOEXCEPT
+        {
+            get_enabled().store(false, std::memory_order_relaxed);
+        }
+
+        ///
+        /// Appends every record held as a Chrome trace-event JSON document
+        /// - the instrumented threads must be quiet (stopped, or joined) while this runs
+        /// - returns the number of records lost: overwritten in full buffers, or never buffered
+        ///
+        inline
+        unsigned long long write_chrome_trace(_Inout_ std::string& _buffer)
+        {
+            State& state = get_state();
+            ::AcquireSRWLockShared(&state.lock);
+
+            // TSC ticks per microsecond, measured against QPC over the whole recording
+            LARGE_INTEGER qpc;
+            LARGE_INTEGER frequency;
+            ::QueryPerformanceCounter(&qpc);
+            ::QueryPerformanceFrequency(&frequency);
+            const unsigned long long end_tsc = __rdtsc();
+            const double elapsed_microseconds =
+                static_cast<double>(qpc.QuadPart - state.start_qpc) * 1000000.0 / static_cast<double>(frequency.QuadPart);
+            double ticks_per_microsecond = 1.0;
+            if (elapsed_microseconds > 0.0 && end_tsc > state.start_tsc) {
+                ticks_per_microsecond = static_cast<double>(end_tsc - state.start_tsc) / elapsed_microseconds;
+            }
+
+            const DWORD process_id = ::GetCurrentProcessId();
+            const unsigned long long start_tsc = state.start_tsc;
+            unsigned long long lost = state.dropped.load(std::memory_order_relaxed);
+            bool first = true;
+            char text[256];
+
+            _buffer.append("{\"traceEvents\":[");
+            for (const auto& buffer : state.buffers) {
+                const DWORD thread_id = buffer->get_thread_id();
+                lost += buffer->for_each([&](const Record& _record) {
+                    // records from before start() are skipped
+                    if (_record.start < start_tsc) {
+                        return;
+                    }
+
+                    const double timestamp = static_cast<double>(_record.start - start_tsc) / ticks_per_microsecond;
+                    const double duration = static_cast<double>(_record.end - _record.start) / ticks_per_microsecond;
+                    const int length = sprintf_s(
+                        text,
+                        "%s{\"name\":\"%s\",\"cat\":\"scope\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lu,\"tid\":%lu}",
+                        first ? "\n" : ",\n",
+                        _record.name,
+                        timestamp,
+                        duration,
+                        static_cast<unsigned long>(process_id),
+                        static_cast<unsigned long>(thread_id));
+                    if (length > 0) {
+                        _buffer.append(text, static_cast<size_t>(length));
+                        first = false;
+                    }
+                });
+            }
+
+            const int length = sprintf_s(
+                text,
+                "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"lostRecords\":\"%llu\"}}\n",
+                lost);
+            if (length > 0) {
+                _buffer.append(text, static_cast<size_t>(length));
+            }
+
+            ::ReleaseSRWLockShared(&state.lock);
+            return lost;
+        }
+    } // namespace Trace
+} // namespace ntl